@@ -1,9 +1,16 @@
 --! @brief Get active flows information.
 --! @param host_ip filter by host/host@vlan.
---! @param pag_options options for the paginator.
+--! @param pag_options options for the paginator. The "fields" option (e.g. "ports,bytes,proto,thpt") restricts the returned fields (see FlowLuaField).
 --! @return table (num_flows, flows) on success (see Flow::lua), nil otherwise.
 function interface.getFlowsInfo(string host_ip=nil, table pag_options=nil)
 
+--! @brief Write the active flows information, as returned by getFlowsInfo, as JSON to the HTTP connection.
+--! @param host_ip filter by host/host@vlan.
+--! @param pag_options options for the paginator.
+--! @return true on success, false if the answer is null or truncated, nil if nothing has been written.
+--! @note rows are encoded one by one: use it (see rest_utils.stream_answer) for large REST answers.
+function interface.streamFlowsInfo(string host_ip=nil, table pag_options=nil)
+
 --! @brief Get active flows status statistics
 --! @return a table (status -> num_flows) for every status (RST, SYN, Established, FIN) on success, nil otherwise.
 function interface.getFlowsStatus()
@@ -20,9 +20,11 @@
 --! @param anomalousOnly if true, only return hosts with anomalies (beta feature).
 --! @param dhcpOnly if true, only return hosts for which DHCP traffic was seen.
 --! @param cidr_filter filter the hosts to return by using a network CIDR.
+--! @param device_ip filter hosts by flow exporter device IP.
+--! @param fields comma separated list of fields to return (e.g. "name,traffic,flows", see HostLuaField), nil for all.
 --! @return a table (numHosts, nextSlot, hosts) where hosts is a table (hostkey -> hostinfo) on success, nil on error.
 --! @note it's better to use the more efficient helper `callback_utils.foreachHost` for generic hosts iteration.
-function interface.getHostsInfo(bool show_details=true, string sortColumn="column_ip", int maxHits=32768, int toSkip=0, bool a2zSortOrder=true, string country=nil, string os_filter=nil, int vlan_filter=nil, int asn_filter=nil, int network_filter=nil, string mac_filter=nil, int pool_filter=nil, int ipver_filter=nil, int proto_filter=nil, int traffic_type_filter=nil, bool filtered_hosts=false, bool blacklisted_hosts=false, bool hide_top_hidden=false, bool anomalousOnly=false, bool dhcpOnly=false, string cidr_filter=nil)
+function interface.getHostsInfo(bool show_details=true, string sortColumn="column_ip", int maxHits=32768, int toSkip=0, bool a2zSortOrder=true, string country=nil, string os_filter=nil, int vlan_filter=nil, int asn_filter=nil, int network_filter=nil, string mac_filter=nil, int pool_filter=nil, int ipver_filter=nil, int proto_filter=nil, int traffic_type_filter=nil, bool filtered_hosts=false, bool blacklisted_hosts=false, bool hide_top_hidden=false, bool anomalousOnly=false, bool dhcpOnly=false, string cidr_filter=nil, string device_ip=nil, string fields=nil)
 
 --! @brief Get active local hosts information. See `getHostsInfo` for parameters description.
 --! @note it's better to use the more efficient helper `callback_utils.foreachLocalHost` for generic hosts iteration.
@@ -34,6 +36,20 @@ function interface.getRemoteHostsInfo(...)
 --! @brief Get active hosts information for hosts which are in the broadcast domain. See `getHostsInfo` for parameters description.
 function interface.getBroadcastDomainHostsInfo(...)
 
+--! @brief Write the active hosts information, as returned by getHostsInfo, as JSON to the HTTP connection. See `getHostsInfo` for parameters description.
+--! @return true on success, false if the answer is null or truncated, nil if nothing has been written.
+--! @note hosts are encoded one by one: use it (see rest_utils.stream_answer) for large REST answers.
+function interface.streamHostsInfo(...)
+
+--! @brief Same as streamHostsInfo for local hosts only.
+function interface.streamLocalHostsInfo(...)
+
+--! @brief Same as streamHostsInfo for remote hosts only.
+function interface.streamRemoteHostsInfo(...)
+
+--! @brief Same as streamHostsInfo for hosts which are in the broadcast domain.
+function interface.streamBroadcastDomainHostsInfo(...)
+
 --! @brief Group active hosts by a specific criteria.
 --! @param show_details enable extended information.
 --! @param groupBy the group criteria.
@@ -42,6 +42,20 @@ function interface.getMaxIfSpeed(string ifname)
 --! @param only_drops if true, only reset the packet drops counter
 function interface.resetCounters(bool only_drops=true)
 
+--! @brief Enable or disable the packet pipeline profiler (per-stage cycle histograms).
+--! @param enabled true to start profiling (samples are reset), false to stop.
+--! @param sampling_rate optionally profile one packet out of sampling_rate.
+--! @note requires administrator privileges.
+function interface.setPacketProfiler(bool enabled, int sampling_rate)
+
+--! @brief Clear the samples collected by the packet pipeline profiler.
+--! @note requires administrator privileges.
+function interface.resetPacketProfiler()
+
+--! @brief Get the packet pipeline profiler status and per-stage statistics.
+--! @return table with a "profiler" entry (see PacketProfiler::lua), nil otherwise.
+function interface.getPacketProfiler()
+
 --! @brief Reset all the hosts and L2 devices stats (e.g. traffic and application data).
 --! @note this will also reset the stats of the inactive hosts.
 function interface.resetStats()
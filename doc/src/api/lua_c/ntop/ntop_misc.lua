@@ -154,11 +154,31 @@ function ntop.getStartupEpoch()
 --! @note This only works when ntop.isPackage() returns true
 function ntop.serviceRestart()
 
---! @brief Match the given host into an nDPI category.
+--! @brief Match the given host (IPv4 address, host name or URL) into a custom category.
 --! @param host the host to match
 --! @return value the nDPI category ID on success, nil otherwise.
 function ntop.matchCustomCategory(string host)
 
+--! @brief Load a category list file into the category lists being reloaded (between ntop.initnDPIReload() and ntop.finalizenDPIReload()).
+--! @param path the list file path
+--! @param category the nDPI category ID of the list entries
+--! @param list_name the list name
+--! @param format the list format: "ip", "domain" or "hosts"
+--! @param max_ips optional maximum number of IPs to load
+--! @param max_hosts optional maximum number of hosts to load
+--! @return a table with num_ips, num_hosts, num_excluded, num_invalid and limit_reached on success, nil if the file cannot be read.
+function ntop.loadCategoryListFile(string path, int category, string list_name, string format, int max_ips, int max_hosts)
+
+--! @brief Exclude a (whitelisted) host from the category lists being reloaded.
+--! @param host the host to exclude
+--! @param category the nDPI category ID
+--! @return true on success, false otherwise.
+function ntop.excludeCustomCategoryHost(string host, int category)
+
+--! @brief Get the stats of the loaded category lists, shared by all the interfaces.
+--! @return a table with num_ips, num_hosts, num_lists, memory (bytes), build_msec, mapped and num_interfaces, nil if no list is loaded.
+function ntop.getCategoryDBStats()
+
 --! @brief Converts a TLS version ID to the corresponding TLS version name.
 --! @param tls_version the TLS version ID
 --! @return the TLS version name
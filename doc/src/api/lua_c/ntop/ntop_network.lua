@@ -68,8 +68,9 @@ function ntop.getservbyport(int port, string proto)
 function ntop.pingHost(string host, bool is_v6)
 
 --! @brief Collect the ICMP replies after ntop.pingHost() calles.
+--! @param continuous true to collect the continuous ping stats (response_rate, min/max/mean RTT, jitter, rtt_histogram) of the hosts probed since the previous call.
 --! @return a table with IP address -> RTT mappings
-function ntop.collectPingResults()
+function ntop.collectPingResults(bool continuous)
 
 --! @brief Send an email to the specified address.
 --! @param from sender email and name
@@ -107,6 +108,29 @@ function ntop.snmpget(string agent_host, string community, string oid, int timeo
 --! @return a table with the results on success, nil otherwise
 function ntop.snmpgetnext(string agent_host, string community, string oid, int timeout=5, int version=1, string oids)
 
+--! @brief Add a device to the native SNMP poller, or refresh it. Devices not refreshed for 3 poll intervals (at least 15 minutes) are discarded.
+--! @param agent the device IPv4 address, optionally followed by :port (e.g. a local simulator at 127.0.0.1:1161)
+--! @param community the SNMP community
+--! @param version 0 for SNMP v1, 1 for v2c
+--! @param poll_interval seconds between the walks of the device interfaces
+--! @param max_requests_per_sec maximum number of requests per second sent to the device
+--! @return true on success, false otherwise.
+function ntop.snmpPollerSetDevice(string agent, string community, int version, int poll_interval=300, int max_requests_per_sec=20)
+
+--! @brief Stop polling a device of the native SNMP poller.
+--! @param agent the device, as passed to ntop.snmpPollerSetDevice
+function ntop.snmpPollerRemoveDevice(string agent)
+
+--! @brief Get the interface counters deltas between the last two walks of the native SNMP poller.
+--! @param since only return the devices polled after this epoch
+--! @param agent only return this device
+--! @return a table agent -> {last_poll, interval, reachable, ..., interfaces = {ifIndex -> {in_bytes, out_bytes, in_pkts, out_pkts, in_discards, out_discards, in_errors, out_errors, oper_status}}}.
+function ntop.snmpPollerGetDeltas(int since=0, string agent=nil)
+
+--! @brief Get the native SNMP poller statistics.
+--! @return a table with the poller statistics (requests, responses, timeouts, retries, polls).
+function ntop.snmpPollerGetStats()
+
 --! @brief Send a TCP probe and get the returned banner string.
 --! @param server_ip the server IP address
 --! @param server_port the TCP service port
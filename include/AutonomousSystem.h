@@ -90,6 +90,14 @@ public:
     GenericTrafficElement::getJSONObject(obj, iface);
   }
   inline char* getSerializationKey(char *buf, uint bufsize) { snprintf(buf, bufsize, AS_SERIALIZED_KEY, iface->get_id(), asn); return(buf); }
+  inline void getSnapshot(HostSnapshot *s) {
+    s->get()->first_seen = first_seen;
+    getTrafficSnapshot(s);
+  }
+  inline void restoreSnapshot(const HostSnapshot *s) {
+    if(s->get()->first_seen && ((time_t)s->get()->first_seen < first_seen)) first_seen = s->get()->first_seen;
+    restoreTrafficSnapshot(s);
+  }
   inline u_int32_t getTotalAlertedNumFlowsAsClient() const { return(alerted_flows_as_client);  };
   inline u_int32_t getTotalAlertedNumFlowsAsServer() const { return(alerted_flows_as_server);  };
 };
@@ -32,6 +32,7 @@ class AutonomousSystemHash : public GenericHash {
   AutonomousSystemHash(NetworkInterface *iface, u_int _num_hashes, u_int _max_hash_size);
 
   AutonomousSystem* get(IpAddress *ipa, bool is_inline_call);
+  AutonomousSystem* get(u_int32_t asn, bool is_inline_call);
 
 #ifdef AS_DEBUG
   void printHash();
@@ -0,0 +1,61 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _CEF_SYSLOG_PRODUCER_H_
+#define _CEF_SYSLOG_PRODUCER_H_
+
+#include "ntop_includes.h"
+
+#define CEF_NUM_HEADER_FIELDS    7
+#define CEF_MAX_EXTENSIONS       128
+#define CEF_MIN_ALERT_SEVERITY   4 /* 0..10: Medium and above */
+
+/*
+  ArcSight Common Event Format:
+  CEF:Version|Device Vendor|Device Product|Device Version|Signature ID|Name|Severity|Extension
+
+  Events with src/dst become flows (bytes from in/out, times from start/end),
+  with an external alert when the severity is at least Medium.
+*/
+class CEFSyslogProducer : public SyslogProducer {
+ private:
+  typedef struct {
+    const char *key, *value;
+  } cef_extension;
+
+  char *header[CEF_NUM_HEADER_FIELDS];
+  cef_extension extensions[CEF_MAX_EXTENSIONS];
+  u_int num_extensions;
+
+  bool parse(char *message);
+  void parseExtensions(char *ext);
+  const char* get(const char *key) const;
+  int getSeverity() const;
+  static void unescape(char *s);
+  static time_t str2time(const char *t);
+
+ public:
+  CEFSyslogProducer(SyslogParserInterface *_iface);
+
+  u_int8_t handleEvent(char *message, const char *host, int priority);
+};
+
+#endif /* _CEF_SYSLOG_PRODUCER_H_ */
@@ -0,0 +1,110 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _CATEGORY_DB_H_
+#define _CATEGORY_DB_H_
+
+#include "ntop_includes.h"
+
+#define CATEGORY_DB_MAGIC    0x42444343 /* "CCDB" */
+#define CATEGORY_DB_VERSION  1
+
+/*
+  The compiled image is a single block of memory, made of the sections
+  below, that only uses offsets: it can be written to disk as is and
+  mmap-ed back.
+*/
+typedef struct {
+  u_int32_t magic, version;
+  u_int64_t size;            /* Whole image */
+  u_int32_t num_ipv4, ipv4_offset;
+  u_int32_t num_host_slots, host_slots_offset; /* Power of 2 */
+  u_int32_t num_hosts;
+  u_int32_t num_lists, lists_offset;
+  u_int32_t strings_offset, strings_len;
+} category_db_header;
+
+/* Non overlapping IPv4 ranges, sorted, obtained flattening the prefixes (longest prefix wins) */
+typedef struct {
+  u_int32_t first, last; /* Host byte order */
+  u_int16_t list_id;
+  u_int8_t category, pad;
+} category_db_ipv4_range;
+
+/* Open addressing table of the (lowercase) domain names */
+typedef struct {
+  u_int32_t name;  /* Offset in the strings, 0 for empty slots */
+  u_int32_t hash;
+  u_int16_t list_id;
+  u_int8_t category, pad;
+} category_db_host_slot;
+
+/*
+  Immutable database of the custom categories and blacklists, compiled
+  once from the category lists by the CategoryDBBuilder and shared by
+  all the interfaces (see Ntop::finalizenDPIReload).
+
+  Lookups are lock-free: a database is never modified after compile and
+  is only freed one reload later, as it happens with the nDPI shadow structs.
+*/
+class CategoryDB {
+ private:
+  u_char *image;
+  bool mapped;    /* image is mmap-ed from a file */
+  const category_db_header *hdr;
+  const category_db_ipv4_range *ipv4;
+  const category_db_host_slot *hosts;
+  const char *strings;
+  char **lists;   /* list_id -> persistent list name (Ntop::getPersistentCustomListName) */
+  u_int32_t build_msec;
+
+  bool init();
+  bool matchIPv4(u_int32_t ip /* host byte order */, ndpi_protocol_category_t *category, char **list_name) const;
+  bool matchDomain(const char *name, u_int len, ndpi_protocol_category_t *category, char **list_name) const;
+
+ public:
+  /* Takes ownership of a malloc-ed image */
+  CategoryDB(u_char *_image, u_int32_t _build_msec);
+  ~CategoryDB();
+
+  static u_int32_t hashName(const char *name, u_int len);
+
+  /* Image file (e.g. to restore the lists on startup before the reload is completed) */
+  static CategoryDB* open(const char *path);
+  bool save(const char *path) const;
+
+  bool match(const char *host_or_ip, ndpi_protocol_category_t *category, char **list_name = NULL) const;
+  bool matchIP(u_int32_t ip /* network byte order */, ndpi_protocol_category_t *category, char **list_name = NULL) const;
+  bool matchHost(const char *name, ndpi_protocol_category_t *category, char **list_name = NULL) const;
+
+  /* Same semantic as ndpi_fill_ip_protocol_category: returns true on match */
+  bool fillIPCategory(u_int32_t saddr, u_int32_t daddr, ndpi_protocol *ret) const;
+  bool fillHostCategory(const char *name, ndpi_protocol *ret) const;
+
+  inline u_int32_t getNumIPv4Ranges() const { return(hdr->num_ipv4);  };
+  inline u_int32_t getNumHosts()      const { return(hdr->num_hosts); };
+  inline u_int64_t getMemory()        const { return(hdr->size);      };
+  inline u_int32_t getBuildTime()     const { return(build_msec);     };
+
+  void lua(lua_State *vm) const;
+};
+
+#endif /* _CATEGORY_DB_H_ */
@@ -0,0 +1,91 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _CATEGORY_DB_BUILDER_H_
+#define _CATEGORY_DB_BUILDER_H_
+
+#include "ntop_includes.h"
+
+typedef struct {
+  u_int32_t num_ips, num_hosts;
+  u_int32_t num_excluded, num_invalid;
+  bool limit_reached;
+} category_list_load_stats;
+
+/*
+  Collects the entries of the category lists during a reload
+  (Ntop::initnDPIReload .. Ntop::finalizenDPIReload) and compiles
+  them into a CategoryDB. Entries are added only once, regardless
+  of the number of interfaces.
+
+  Not thread safe: the reload is driven by a single Lua VM.
+*/
+class CategoryDBBuilder {
+ private:
+  typedef struct {
+    u_int32_t first, last, seq;
+    u_int16_t list_id;
+    u_int8_t category;
+  } ipv4_prefix;
+
+  typedef struct {
+    u_int32_t name, len; /* Offset in the pool */
+    u_int16_t list_id;
+    u_int8_t category;
+  } host_entry;
+
+  std::vector<ipv4_prefix> prefixes;
+  std::vector<host_entry> hosts;
+  std::string pool;  /* Host names, '\0' terminated */
+  std::set<std::pair<u_int8_t, std::string> > exclusions; /* <category, lowercase host> */
+  std::map<std::string, u_int16_t> list_ids;
+  std::vector<std::string> list_names;
+
+  u_int16_t getListId(const char *list_name);
+  static bool parseIPv4Network(const char *net, u_int32_t *first, u_int32_t *last);
+  static bool isValidHostName(const char *name);
+  bool isExcluded(const char *name, ndpi_protocol_category_t category) const;
+  void flattenPrefixes(std::vector<category_db_ipv4_range> *out);
+
+ public:
+  CategoryDBBuilder();
+
+  bool addIP(const char *net /* a.b.c.d[/len] */, ndpi_protocol_category_t category, const char *list_name);
+  bool addHost(const char *name, ndpi_protocol_category_t category, const char *list_name);
+  /* Whitelisted hosts ("!host" custom category entries) never added to the category */
+  void addExclusion(const char *name, ndpi_protocol_category_t category);
+
+  /*
+    Loads a whole list file (format: "ip", "domain" or "hosts") in place
+    of the per-entry calls from Lua: returns false if the file cannot be read.
+  */
+  bool loadFile(const char *path, const char *format, ndpi_protocol_category_t category,
+		const char *list_name, u_int32_t max_ips, u_int32_t max_hosts,
+		category_list_load_stats *stats);
+
+  inline u_int32_t getNumIPs()   const { return(prefixes.size()); };
+  inline u_int32_t getNumHosts() const { return(hosts.size());    };
+
+  /* Returns a new database, or NULL on failure */
+  CategoryDB* compile();
+};
+
+#endif /* _CATEGORY_DB_BUILDER_H_ */
@@ -30,6 +30,22 @@ class Check {
   bool packet_interface_only, nedge_exclude, nedge_only;
   bool enabled;
 
+  /* Runtime cost accounting (see ntopng.prefs.checks_profiling). Check instances
+     are shared by all interfaces, hence counters are atomic */
+  struct {
+    std::atomic<u_int64_t> num_calls, num_throttled, tot_ticks, max_ticks;
+    std::atomic<u_int64_t> hist[CHECK_STATS_NUM_BUCKETS]; /* hist[i]: calls in [2^i, 2^(i+1)) cycles */
+  } stats;
+
+  /* Optional CPU budget: when exceeded the check is throttled to 1 call out of throttle_rate */
+  struct {
+    u_int32_t cpu_usec_per_sec; /* 0 = no budget */
+    std::atomic<u_int32_t> throttle_rate, skip, last_usage_usec;
+    std::atomic<u_int64_t> window_begin, window_ticks, num_exceeded;
+  } budget;
+
+  void checkBudget(ticks t);
+
  public:
   Check(NtopngEdition _edition, bool _packet_interface_only, bool _nedge_exclude, bool _nedge_only);
   virtual ~Check();
@@ -47,6 +63,24 @@ class Check {
   inline bool isEnabled() const { return(enabled ? true : false); }
 
   virtual std::string getName()       const = 0;
+
+  /* Cost accounting */
+  inline bool hasCpuBudget() const { return(budget.cpu_usec_per_sec > 0); };
+  void setCpuBudget(u_int32_t cpu_usec_per_sec);
+
+  /* Returns false when the check is throttled and must be skipped for this entity */
+  inline bool shouldRun() {
+    u_int32_t rate = budget.throttle_rate;
+
+    if((rate <= 1) || ((++budget.skip % rate) == 0))
+      return(true);
+
+    stats.num_throttled++;
+    return(false);
+  }
+
+  void incStats(ticks t);
+  void luaStats(lua_State *vm);
 };
 
 #endif /* _CHECK_H_ */
@@ -31,6 +31,10 @@ class ChecksLoader {
   virtual void registerChecks() = 0; /* Method called at runtime to register checks */
   virtual void loadConfiguration() = 0;
 
+ protected:
+  /* Optional "cpu_budget_usec" (CPU usec per second) of a check hook configuration, 0 if missing */
+  static u_int32_t getCpuBudget(json_object *hook_config);
+
  public:
   ChecksLoader();
   virtual ~ChecksLoader();
@@ -0,0 +1,123 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _COMPILED_ADDRESS_TREE_H_
+#define _COMPILED_ADDRESS_TREE_H_
+
+#include "ntop_includes.h"
+
+#define COMPILED_TREE_ROOT_BITS    16
+#define COMPILED_TREE_IPV4_STRIDE  8  /* 16-8-8: at most 3 memory accesses */
+#define COMPILED_TREE_IPV6_STRIDE  4  /* 64 bytes nodes, to bound the memory with sparse prefixes */
+#define COMPILED_TREE_MIN_VLAN_ADDRESSES  16 /* See VLANAddressTree::compile */
+
+/*
+  Immutable longest prefix match table compiled from the IPv4/IPv6 prefixes
+  of an AddressTree (MACs are not included, see AddressTree::findMac).
+
+  Each family is a multibit trie with a 2^16 entries root table (as DIR-24-8,
+  with a smaller first level so that it fits the per VLAN trees) and
+  fixed stride nodes. Prefixes are expanded and leaf pushed at compile time, so
+  that a lookup is a few array accesses with no comparisons.
+
+  The table is never modified: it is rebuilt when the source tree changes
+  and swapped, with the previous one freed one reload later (see
+  Ntop::addLocalNetworkList and HostPools::reloadPools).
+*/
+class CompiledAddressTree {
+ private:
+  typedef struct {
+    u_int8_t max_bits, stride;
+    u_int32_t *root;             /* NULL when the family has no prefixes */
+    std::vector<u_int32_t> nodes; /* (1 << stride) entries per node */
+  } compiled_lpm;
+
+  compiled_lpm v4, v6;
+  u_int32_t num_prefixes, build_msec;
+
+  static bool insert(compiled_lpm *lpm, const u_int8_t *prefix, u_int8_t bits, u_int32_t leaf);
+  static void fill(compiled_lpm *lpm, u_int32_t *entry, u_int32_t leaf);
+  static void compile_walker(ndpi_patricia_node_t *node, void *data, void *user_data);
+
+  static inline u_int32_t getStride(const u_int8_t *addr, u_int8_t offset, u_int8_t stride) {
+    /* Offsets are multiple of the stride, 4 or 8 bits */
+    if(stride == 8)
+      return(addr[offset >> 3]);
+    else
+      return((addr[offset >> 3] >> (4 - (offset & 4))) & 0x0F);
+  }
+
+  static inline int16_t lookup(const compiled_lpm *lpm, const u_int8_t *addr, u_int8_t *network_mask_bits);
+
+  CompiledAddressTree();
+
+ public:
+  ~CompiledAddressTree();
+
+  /* Returns NULL on failure (e.g. out of memory): callers stay on the AddressTree */
+  static CompiledAddressTree* compile(const AddressTree *tree);
+
+  /* Same semantic as AddressTree::findAddress */
+  inline int16_t findAddress(int family, const void *addr, u_int8_t *network_mask_bits = NULL) const {
+    if(family == AF_INET)
+      return(lookup(&v4, (const u_int8_t*)addr, network_mask_bits));
+    else if(family == AF_INET6)
+      return(lookup(&v6, (const u_int8_t*)addr, network_mask_bits));
+    else
+      return(-1);
+  }
+
+  inline u_int32_t getNumPrefixes() const { return(num_prefixes); };
+  inline u_int32_t getBuildTime()   const { return(build_msec);   };
+  u_int64_t getMemory() const;
+};
+
+/* ******************************************* */
+
+#define COMPILED_TREE_CHILD  0x80000000 /* Lower bits: node index */
+#define COMPILED_TREE_LEAF   0x40000000 /* Bits 16-23: prefix length, 0-15: value */
+
+inline int16_t CompiledAddressTree::lookup(const compiled_lpm *lpm, const u_int8_t *addr,
+					   u_int8_t *network_mask_bits) {
+  u_int32_t entry;
+  u_int8_t offset = COMPILED_TREE_ROOT_BITS;
+
+  if(lpm->root == NULL)
+    return(-1);
+
+  entry = lpm->root[(addr[0] << 8) | addr[1]];
+
+  while(entry & COMPILED_TREE_CHILD) {
+    entry = lpm->nodes[((entry & ~COMPILED_TREE_CHILD) << lpm->stride)
+		       + getStride(addr, offset, lpm->stride)];
+    offset += lpm->stride;
+  }
+
+  if(entry == 0)
+    return(-1);
+
+  if(network_mask_bits)
+    *network_mask_bits = (entry >> 16) & 0xFF;
+
+  return((int16_t)(entry & 0xFFFF));
+}
+
+#endif /* _COMPILED_ADDRESS_TREE_H_ */
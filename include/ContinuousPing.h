@@ -19,6 +19,7 @@
  *
  */
 
+
 #ifndef _CONTINUOUS_PING_H_
 #define _CONTINUOUS_PING_H_
 
@@ -26,30 +27,71 @@
 
 /* ***************************************** */
 
+typedef union {
+  struct sockaddr_in  sin;
+  struct sockaddr_in6 sin6;
+} cping_sockaddr;
+
+typedef struct {
+  std::string name;  /* As passed to ping() */
+  bool v6, active;
+  cping_sockaddr addr;
+  u_int8_t pinger_idx;
+  u_int16_t generation; /* Replies to a recycled target id are discarded */
+  u_int16_t seq;        /* Of the last echo request */
+  bool awaiting_reply, dirty;
+  u_int64_t next_tick;
+  ContinuousPingStats *stats;
+} cping_target;
+
+struct cping_batch;
+struct cping_rx;
+
+/*
+  Pings the registered targets every CONTINUOUS_PING_INTERVAL_MSEC from a
+  single thread: sends are scheduled by a timer wheel (spread over the
+  interval) and batched per socket with sendmmsg, replies are read in
+  batches with recvmmsg and matched to the target through the id carried
+  in the echo payload, without any lookup by address.
+
+  Each collectResponses() only returns the targets probed since the
+  previous collection, with the stats of that period.
+*/
 class ContinuousPing {
  private:
-  std::map<std::string /* IP */, ContinuousPingStats* /* stats */> v4_results, v6_results;
-  std::vector<std::string /* IP */> inactiveHostsV4, inactiveHostsV6;
-  std::map<std::string /* IP */, bool> v4_pinged, v6_pinged;
+  std::vector<cping_target*> targets;   /* Indexed by target id */
+  std::vector<u_int32_t> free_ids;
+  std::unordered_map<std::string /* IP */, u_int32_t /* target id */> v4_targets, v6_targets;
+  std::vector<u_int32_t> dirty;         /* Targets probed since the last collection */
   std::map<std::string /* ifname */, Ping* /* pinger */> if_pinger;
+  std::vector<Ping*> pingers;           /* default_pinger first */
+  std::vector<cping_batch*> batches;    /* Per pinger socket: pinger index * 2 + v6 */
+  cping_rx *rx;
   Ping *default_pinger;
+  TimerWheel *wheel;
+  std::vector<u_int32_t> expired;
+  u_int64_t interval_ticks;
   pthread_t poller;
   Mutex m;
   bool started;
-  
-  void pingAll();
-  void readPingResults();
-  void cleanupInactiveHosts();
-  void collectProtoResponse(lua_State* vm, std::map<std::string,ContinuousPingStats*> *w);
+
+  static u_int64_t getTick();
+  void addTarget(const char *name, bool v6, const void *addr, u_int8_t pinger_idx);
+  void removeTarget(u_int32_t target_id);
+  void purgeInactiveTargets(time_t now);
+  void markDirty(u_int32_t target_id, cping_target *t);
+  void sendDue(u_int64_t now_tick);
+  void flushBatch(cping_batch *b, int sock, bool v6);
+  void readReplies(int sock, bool v6, Ping *pinger);
+  void handleReply(u_char *buf, u_int len, bool v6, const void *from, Ping *pinger, const struct timeval *now);
 
  public:
   ContinuousPing();
   ~ContinuousPing();
 
   void start();
-  void runPingCampaign();
+  void run();
   void ping(char *_addr, bool use_v6, char *ifname);
-  void pollResults();
   void collectResponses(lua_State* vm, bool v6);
 };
 
@@ -27,6 +27,8 @@
 struct cp_stats {
   u_int32_t num_ping_sent, num_ping_rcvd;
   float min_rtt, max_rtt, last_rtt, diff_sum, rtt_sum;
+  /* Bucket 0: < 1 msec, bucket n: [2^(n-1), 2^n) msec, last one unbounded */
+  u_int16_t rtt_histogram[CONTINUOUS_PING_RTT_BUCKETS];
 };
 
 /* ***************************************** */
@@ -44,6 +46,9 @@ class ContinuousPingStats {
   inline void getStats(struct cp_stats *out) { memcpy(out, &stats, sizeof(struct cp_stats));  }
   inline void heartbeat()                    { last_refresh = time(NULL);                     }
   inline void incSent()                      { stats.num_ping_sent++;                         }
+  inline u_int32_t getNumSent()        const { return(stats.num_ping_sent);                   }
+  inline u_int32_t getNumRcvd()        const { return(stats.num_ping_rcvd);                   }
+  inline const u_int16_t* getRTTHistogram() const { return(stats.rtt_histogram);              }
   inline time_t getLastHeartbeat()           { return(last_refresh);                          }
   void update(float rtt);
   float getSuccessRate(float *min_rtt, float *max_rtt, float *jitter, float *mean);
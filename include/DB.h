@@ -28,8 +28,9 @@ class DB {
  private:
   struct timeval lastUpdateTime;
   float exportRate;
-  u_int64_t exportedFlows, lastExportedFlows;
-  /* Multiple threads can inc in case of view interfaces */
+  u_int64_t lastExportedFlows;
+  /* Multiple threads can inc in case of view interfaces or multiple DB writers */
+  std::atomic<u_int64_t> exportedFlows;
   std::atomic<u_int32_t> droppedFlows;
   std::atomic<u_int32_t> queueDroppedFlows;
   u_int64_t checkpointExportedFlows;
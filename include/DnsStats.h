@@ -40,6 +40,8 @@ class DnsStats {
   struct dns_stats sent_stats, rcvd_stats;
 
   void deserializeStats(json_object *o, struct dns_stats *stats);
+  static void getSnapshotStats(struct dns_stats *stats, u_int32_t *s);
+  static void restoreSnapshotStats(struct dns_stats *stats, const u_int32_t *s);
   json_object* getStatsJSONObject(struct dns_stats *stats);
   void luaStats(lua_State *vm, struct dns_stats *stats, const char *label, bool verbose);
 
@@ -60,6 +62,8 @@ class DnsStats {
   char* serialize();
   void deserialize(json_object *o);
   json_object* getJSONObject();
+  void getSnapshot(struct host_snapshot_hdr *s);
+  void restoreSnapshot(const struct host_snapshot_hdr *s);
   void lua(lua_State *vm, bool verbose);
   bool hasAnomalies(time_t when);
   void luaAnomalies(lua_State* vm, time_t when);
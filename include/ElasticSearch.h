@@ -24,13 +24,42 @@
 
 #include "ntop_includes.h"
 
+/* Flow record slot: the buffer is reused (and only grown) across flows */
+typedef struct {
+  char *str;
+  u_int32_t len, size;
+} ESFlowRecord;
+
+/* Bulk request in flight on the curl multi handle */
+typedef struct {
+  CURL *curl;
+  char *body;           /* Bulk body (ES_BULK_BUFFER_SIZE) */
+  char *gz_body;        /* Compressed body, when gzip is enabled */
+  u_int32_t body_len, num_flows;
+  struct timeval sent;
+  bool busy;
+} ESBulkRequest;
+
 class ElasticSearch : public DB {
  private:
   pthread_t esThreadLoop;
-  u_int num_queued_elems;
-  struct string_list *head, *tail;
+  /* Preallocated ring of ES_MAX_QUEUE_LEN flow records, protected by listMutex */
+  ESFlowRecord *ring;
+  u_int32_t ring_head, ring_tail;
+  volatile u_int32_t num_queued_elems;
+  volatile u_int64_t num_queued_bytes;
   Mutex listMutex;
   bool reportDrops;
+
+  CURLM *multi;
+  struct curl_slist *headers;
+  ESBulkRequest requests[ES_MAX_INFLIGHT_REQUESTS];
+  bool gzip_requests;
+  u_int32_t gz_body_size; /* Worst case size of a compressed bulk */
+  u_int32_t bulk_size;  /* Current (adaptive) bulk body size */
+  u_int32_t num_inflight;
+  u_int64_t num_bulks, num_failed_bulks, tot_latency_msec;
+  u_int32_t last_latency_msec;
   char *es_template_push_url, *es_version_query_url;
   char es_version[2];
   bool es_version_inited;
@@ -38,6 +67,11 @@ class ElasticSearch : public DB {
   const char * get_es_version();
   const char * get_es_template();
   void shutdown();
+  bool initRequests();
+  void termRequests();
+  u_int32_t fillBulk(ESBulkRequest *req);
+  bool sendBulk(ESBulkRequest *req, u_int32_t len);
+  void completeBulk(ESBulkRequest *req, CURLcode res);
   
  public:
   ElasticSearch(NetworkInterface *_iface);
@@ -60,6 +94,7 @@ class ElasticSearch : public DB {
 
   virtual bool dumpFlow(time_t when, Flow *f, char *json);
   virtual bool startQueryLoop();
+  virtual void lua(lua_State* vm, bool since_last_checkpoint) const;
 };
 
 
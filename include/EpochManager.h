@@ -0,0 +1,59 @@
+/*
+ *
+ * (C) 2014-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _EPOCH_MANAGER_H_
+#define _EPOCH_MANAGER_H_
+
+#include "ntop_includes.h"
+
+/* ******************************* */
+
+/*
+  Epoch-based reclamation for hash tables walked by non-inline threads.
+
+  Readers (e.g., Lua hash walks) enter the current epoch before touching the
+  hash buckets and exit it when done, without taking any bucket lock. Entries
+  unlinked by the inline thread are retired with the epoch returned by advance()
+  and can be freed only once canReclaim() says that no reader is still in an
+  older epoch, i.e., no reader can still hold a reference to them.
+*/
+class EpochManager {
+ private:
+  std::atomic<u_int64_t> global_epoch;
+  std::atomic<u_int64_t> reader_epochs[MAX_NUM_EPOCH_READERS]; /* 0 = slot free */
+  std::atomic<u_int64_t> num_slot_exhausted;
+
+ public:
+  EpochManager();
+
+  /* Returns the slot to be passed to exit(), or -1 when all slots are busy */
+  int enter();
+  void exit(int slot);
+
+  u_int64_t advance();
+  bool canReclaim(u_int64_t retire_epoch) const;
+
+  inline u_int64_t getEpoch()               const { return(global_epoch);       };
+  inline u_int64_t getNumSlotsExhausted()   const { return(num_slot_exhausted); };
+};
+
+#endif /* _EPOCH_MANAGER_H_ */
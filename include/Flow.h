@@ -32,11 +32,89 @@ typedef struct {
   u_int64_t last, next;
 } TCPSeqNum;
 
+/*
+  Protocol-specific flow information. Only a minority of flows carry any of it,
+  so it is allocated lazily (see Flow::protosRW) the first time it is written.
+*/
+typedef union {
+  struct {
+    char *last_url, *last_user_agent;
+    ndpi_http_method last_method;
+    u_int16_t last_return_code;
+  } http;
+
+  struct {
+    char *last_query;
+    char *last_query_shadow;
+    time_t last_query_update_time; /* The time when the last query was updated */
+    u_int16_t last_query_type;
+    u_int16_t last_return_code;
+  } dns;
+
+  struct {
+    char *name, *name_txt, *ssid;
+    char *answer;
+  } mdns;
+
+  struct {
+    char *location;
+  } ssdp;
+
+  struct {
+    char *name;
+  } netbios;
+
+  struct {
+    char *client_signature, *server_signature;
+    struct {
+      /* https://engineering.salesforce.com/open-sourcing-hassh-abed3ae5044c */
+      char *client_hash, *server_hash;
+    } hassh;
+  } ssh;
+
+  struct {
+    u_int16_t tls_version;
+    u_int32_t notBefore, notAfter;
+    char *client_alpn, *client_tls_supported_versions, *issuerDN, *subjectDN;
+    char *client_requested_server_name, *server_names;
+    /* Certificate dissection */
+    struct {
+      /* https://engineering.salesforce.com/tls-fingerprinting-with-ja3-and-ja3s-247362855967 */
+      char *client_hash, *server_hash;
+      u_int16_t server_cipher;
+      ndpi_cipher_weakness server_unsafe_cipher;
+    } ja3;
+  } tls;
+
+  struct {
+    struct {
+      u_int8_t icmp_type, icmp_code;
+    } cli2srv, srv2cli;
+    u_int16_t max_icmp_payload_size;
+  } icmp;
+} FlowProtocolInfo;
+
+/* TCP sequence and three-way-handshake state, only needed for packet-based TCP flows */
+typedef struct {
+  TCPSeqNum seq_s2d, seq_d2s;
+  struct timeval synTime, synAckTime, ackTime; /* network Latency (3-way handshake) */
+} FlowTCPState;
+
 class FlowAlert;
 class FlowCheck;
 
 class Flow : public GenericHashEntry {
  private:
+  /*
+    Hot fields, read or written for every packet: keep them first and contiguous
+    so that the packet path touches as few cache lines as possible. Rarely used
+    and protocol-specific state is kept below or lazily allocated.
+
+    They are not explicitly cache line aligned: GenericHashEntry is 64 bytes, so
+    in a CACHE_LINE_LEN aligned Flow they would already start a line, and aligning
+    the allocation (posix_memalign) costs 32 bytes per flow without a measurable
+    gain on the per-packet accesses.
+  */
   Host *cli_host, *srv_host;
   IpAddress *cli_ip_addr, *srv_ip_addr;
   ICMPinfo *icmp_info;
@@ -51,6 +129,16 @@ class Flow : public GenericHashEntry {
   u_int16_t flow_score;
   u_int8_t view_cli_mac[6], view_srv_mac[6];
   struct ndpi_flow_struct *ndpiFlow;
+  FlowTCPState *tcp_state; /* Lazily allocated on the first TCP segment (packet interfaces only) */
+
+  /* Stats */
+  FlowTrafficStats stats;
+
+  /* IP stats */
+  IPPacketStats ip_stats_s2d, ip_stats_d2s;
+  u_int16_t cli2srv_window, srv2cli_window;
+
+  /* Cold fields */
   ndpi_risk ndpi_flow_risk_bitmap;
   /* The bitmap of all possible flow alerts set by FlowCheck subclasses.
      When no alert is set, the flow is in flow_alert_normal.
@@ -81,7 +169,8 @@ class Flow : public GenericHashEntry {
     swap_done:1, swap_requested:1,
     has_malicious_cli_signature:1, has_malicious_srv_signature:1,
     src2dst_tcp_zero_window:1, dst2src_tcp_zero_window:1,
-    non_zero_payload_observed:1, _notused:1;
+    non_zero_payload_observed:1, fast_accounting:1;
+  u_int8_t fast_accounting_skipped; /* Packets accounted on the fast path since the last sampled one */
   
 #ifdef ALERTED_FLOWS_DEBUG
   bool iface_alert_inc, iface_alert_dec;
@@ -120,63 +209,8 @@ class Flow : public GenericHashEntry {
   time_t next_call_periodic_update; /* The time at which the periodic lua script on this flow shall be called */
   u_int32_t periodic_update_ctr;
 
-  union {
-    struct {
-      char *last_url, *last_user_agent;
-      ndpi_http_method last_method;
-      u_int16_t last_return_code;
-    } http;
-
-    struct {
-      char *last_query;
-      char *last_query_shadow;
-      time_t last_query_update_time; /* The time when the last query was updated */
-      u_int16_t last_query_type;
-      u_int16_t last_return_code;
-    } dns;
-
-    struct {
-      char *name, *name_txt, *ssid;
-      char *answer;
-    } mdns;
-
-    struct {
-      char *location;
-    } ssdp;
-
-    struct {
-      char *name;
-    } netbios;
-
-    struct {
-      char *client_signature, *server_signature;
-      struct {
-	/* https://engineering.salesforce.com/open-sourcing-hassh-abed3ae5044c */
-	char *client_hash, *server_hash;
-      } hassh;
-    } ssh;
-
-    struct {
-      u_int16_t tls_version;
-      u_int32_t notBefore, notAfter;
-      char *client_alpn, *client_tls_supported_versions, *issuerDN, *subjectDN;
-      char *client_requested_server_name, *server_names;
-      /* Certificate dissection */
-      struct {
-	/* https://engineering.salesforce.com/tls-fingerprinting-with-ja3-and-ja3s-247362855967 */
-	char *client_hash, *server_hash;
-	u_int16_t server_cipher;
-	ndpi_cipher_weakness server_unsafe_cipher;
-      } ja3;
-    } tls;
-
-    struct {
-      struct {
-	u_int8_t icmp_type, icmp_code;
-      } cli2srv, srv2cli;
-      u_int16_t max_icmp_payload_size;
-    } icmp;
-  } protos;
+  const FlowProtocolInfo *protos; /* Points to emptyProtocolInfo until protosRW() allocates it */
+  static const FlowProtocolInfo emptyProtocolInfo;
 
   struct {
     u_int32_t device_ip;
@@ -187,21 +221,10 @@ class Flow : public GenericHashEntry {
   /* eBPF Information */
   ParsedeBPF *ebpf;
 
-  /* Stats */
-  FlowTrafficStats stats;
-
-  /* IP stats */
-  IPPacketStats ip_stats_s2d, ip_stats_d2s;
-
-  /* TCP stats */
-  TCPSeqNum tcp_seq_s2d, tcp_seq_d2s;
-  u_int16_t cli2srv_window, srv2cli_window;
-
   time_t doNotExpireBefore; /*
 			      Used for collected flows via ZMQ to make sure that they are not immediately
 			      expired if their last seen time is back in time with respect to ntopng
 			    */
-  struct timeval synTime, synAckTime, ackTime; /* network Latency (3-way handshake) */
   struct timeval clientNwLatency; /* The RTT/2 between the client and nprobe */
   struct timeval serverNwLatency; /* The RTT/2 between nprobe and the server */
   struct timeval c2sFirstGoodputTime;
@@ -220,6 +243,14 @@ class Flow : public GenericHashEntry {
   /* Lazily initialized and used by a possible view interface */
   ViewInterfaceFlowStats *viewFlowStats;
 
+  /*
+    Host pools of the peers without a Host (e.g. on flow-only and view
+    interfaces), valid for a HostPools trees generation:
+    [generation:32][cli found:1][cli pool:15][srv found:1][srv pool:15]
+  */
+  std::atomic<u_int64_t> peer_pools;
+  u_int64_t lookupPeerPools(HostPools *hp, u_int32_t generation);
+
   /* Partial used to periodically update stats out of flows */
   PartializableFlowTrafficStats *periodic_stats_update_partial;
 
@@ -243,6 +274,8 @@ class Flow : public GenericHashEntry {
   ValueTrend bytes_thpt_trend, goodput_bytes_thpt_trend, pkts_thpt_trend;
   char* intoaV4(unsigned int addr, char* buf, u_short bufLen);
   void allocDPIMemory();
+  FlowProtocolInfo* protosRW();
+  FlowTCPState* getTCPState();
   bool checkTor(char *hostname);
   void setBittorrentHash(char *hash);
   void updateThroughputStats(float tdiff_msec,
@@ -268,6 +301,7 @@ class Flow : public GenericHashEntry {
   void processDetectedProtocolData();  /* nDPI detected protocol data (e.g., ndpiFlow->host_server_name) */
   void setExtraDissectionCompleted();
   void setProtocolDetectionCompleted(u_int8_t *payload, u_int16_t payload_len);
+  void fillCustomCategory();
   void updateProtocol(ndpi_protocol proto_id);
   const char* cipher_weakness2str(ndpi_cipher_weakness w) const;
   bool get_partial_traffic_stats(PartializableFlowTrafficStats **dst, PartializableFlowTrafficStats *delta, bool *first_partial) const;
@@ -342,7 +376,7 @@ class Flow : public GenericHashEntry {
   void setProtocolJSONInfo();
   void getProtocolJSONInfo(ndpi_serializer *serializer);
  
-  inline char* getJa3CliHash() { return(protos.tls.ja3.client_hash); }
+  inline char* getJa3CliHash() { return(protos->tls.ja3.client_hash); }
   
   bool isBlacklistedFlow()   const;
   bool isBlacklistedClient() const;
@@ -399,7 +433,7 @@ class Flow : public GenericHashEntry {
     return(Utils::maskHost(get_cli_ip_addr()->isLocalHost())
 	   || Utils::maskHost(get_srv_ip_addr()->isLocalHost()));
   };
-  inline const char* getServerCipherClass()  const { return(isTLS() ? cipher_weakness2str(protos.tls.ja3.server_unsafe_cipher) : NULL); }
+  inline const char* getServerCipherClass()  const { return(isTLS() ? cipher_weakness2str(protos->tls.ja3.server_unsafe_cipher) : NULL); }
   char* serialize(bool use_labels = false);
   /* Prepares an alert JSON and puts int in the resulting `serializer`. */
   void alert2JSON(FlowAlert *alert, ndpi_serializer *serializer);
@@ -418,8 +452,8 @@ class Flow : public GenericHashEntry {
 
   inline u_int16_t getLowerProtocol() { return(ndpi_get_lower_proto(ndpiDetectedProtocol)); }
 
-  inline void updateJA3C(char *j) { if(j && (j[0] != '\0') && (protos.tls.ja3.client_hash == NULL)) protos.tls.ja3.client_hash = strdup(j); updateCliJA3(); }
-  inline void updateJA3S(char *j) { if(j && (j[0] != '\0') && (protos.tls.ja3.server_hash == NULL)) protos.tls.ja3.server_hash = strdup(j); updateSrvJA3(); }
+  inline void updateJA3C(char *j) { if(j && (j[0] != '\0') && (protos->tls.ja3.client_hash == NULL)) protosRW()->tls.ja3.client_hash = strdup(j); updateCliJA3(); }
+  inline void updateJA3S(char *j) { if(j && (j[0] != '\0') && (protos->tls.ja3.server_hash == NULL)) protosRW()->tls.ja3.server_hash = strdup(j); updateSrvJA3(); }
   
   inline u_int8_t getTcpFlags()        const { return(src2dst_tcp_flags | dst2src_tcp_flags);  };
   inline u_int8_t getTcpFlagsCli2Srv() const { return(src2dst_tcp_flags);                      };
@@ -442,7 +476,7 @@ class Flow : public GenericHashEntry {
   void timeval_diff(struct timeval *begin, const struct timeval *end, struct timeval *result, u_short divide_by_two);
   char* getFlowInfo(char *buf, u_int buf_len, bool isLuaRequest);
   inline char* getFlowServerInfo() {
-    return (isTLS() && protos.tls.client_requested_server_name) ? protos.tls.client_requested_server_name : host_server_name;
+    return (isTLS() && protos->tls.client_requested_server_name) ? protos->tls.client_requested_server_name : host_server_name;
   }
   inline char* getBitTorrentHash() { return(bt_hash);          };
   inline void  setBTHash(char *h)  { if(!h) return; if(bt_hash) free(bt_hash); bt_hash = h; }
@@ -461,6 +495,9 @@ class Flow : public GenericHashEntry {
 			     NetworkInterface *iface,
 			     u_int32_t ooo_pkts, u_int32_t retr_pkts,
 			     u_int32_t lost_pkts, u_int32_t keep_alive_pkts);
+  static void incHostTcpBadStats(bool sent, Host *host,
+				 u_int32_t ooo_pkts, u_int32_t retr_pkts,
+				 u_int32_t lost_pkts, u_int32_t keep_alive_pkts);
   
   void updateTcpSeqNum(const struct bpf_timeval *when,
 		       u_int32_t seq_num, u_int32_t ack_seq_num,
@@ -492,6 +529,14 @@ class Flow : public GenericHashEntry {
                 u_int8_t l4_proto, u_int8_t is_fragment,
 		u_int16_t tcp_flags, const struct timeval *when,
 		u_int16_t fragment_extra_overhead);
+  /*
+    Fast accounting: once detection is over and nothing else needs the
+    packet contents, packets only update the flow and host counters
+  */
+  inline bool isFastAccounting() const { return(fast_accounting ? true : false); };
+  void updateFastAccounting();
+  bool fastAccountingPacket(bool cli2srv_direction, u_int pkt_len, u_int payload_len,
+			    u_int8_t tcp_flags, bool tcp_zero_window, const struct bpf_timeval *when);
   void addFlowStats(bool new_flow,
 		    bool cli2srv_direction, u_int in_pkts, u_int in_bytes, u_int in_goodput_bytes,
 		    u_int out_pkts, u_int out_bytes, u_int out_goodput_bytes, 
@@ -555,6 +600,8 @@ class Flow : public GenericHashEntry {
   inline u_int32_t get_duration()        const { return((u_int32_t)(get_last_seen() - get_first_seen())); };
   inline char* get_protocol_name()       const { return(Utils::l4proto2name(protocol));   };
 
+  /* Pools of the peers, from their Host or from a cached address lookup */
+  void getPeerPools(u_int16_t *cli_pool, bool *cli_pool_found, u_int16_t *srv_pool, bool *srv_pool_found);
   inline Host* get_cli_host()               const { return(cli_host);    };
   inline Host* get_srv_host()               const { return(srv_host);    };
   inline const IpAddress* get_cli_ip_addr() const { return(cli_ip_addr); };
@@ -564,8 +611,8 @@ class Flow : public GenericHashEntry {
 
   inline json_object* get_json_info()	    const  { return(json_info);                       };
   inline ndpi_serializer* get_tlv_info()	    const  { return(tlv_info);                       };
-  inline void setICMPPayloadSize(u_int16_t size)     { if(isICMP()) protos.icmp.max_icmp_payload_size = max(protos.icmp.max_icmp_payload_size, size); };
-  inline u_int16_t getICMPPayloadSize()             const { return(isICMP() ? protos.icmp.max_icmp_payload_size : 0); };
+  inline void setICMPPayloadSize(u_int16_t size)     { if(isICMP()) protosRW()->icmp.max_icmp_payload_size = max(protos->icmp.max_icmp_payload_size, size); };
+  inline u_int16_t getICMPPayloadSize()             const { return(isICMP() ? protos->icmp.max_icmp_payload_size : 0); };
   inline ICMPinfo* getICMPInfo()                    const { return(isICMP() ? icmp_info : NULL); }
   inline ndpi_protocol_breed_t get_protocol_breed() const {
     return(ndpi_get_proto_breed(iface->get_ndpi_struct(), isDetectionCompleted() ? ndpi_get_upper_proto(ndpiDetectedProtocol) : NDPI_PROTOCOL_UNKNOWN));
@@ -617,6 +664,11 @@ class Flow : public GenericHashEntry {
   bool is_hash_entry_state_idle_transition_ready();
   void hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host, Host *srv_host, PartializableFlowTrafficStats *partial,
 				   bool first_partial, const struct timeval *tv) const;
+  /* The two halves of hosts_periodic_stats_update(), so that each host can be updated by the thread owning it */
+  void shared_periodic_stats_update(NetworkInterface *iface, Host *cli_host, Host *srv_host, PartializableFlowTrafficStats *partial,
+				    const struct timeval *tv) const;
+  void host_periodic_stats_update(Host *host, Host *peer, bool as_client, PartializableFlowTrafficStats *partial,
+				  bool first_partial, const struct timeval *tv) const;
   void periodic_stats_update(const struct timeval *tv);
   void  set_hash_entry_id(u_int assigned_hash_entry_id);
   u_int get_hash_entry_id() const;
@@ -630,8 +682,10 @@ class Flow : public GenericHashEntry {
 		       VLANid vlan_id,
 		       u_int16_t _observation_point_id,
 		       u_int16_t protocol);
+  /* fields is a FlowLuaField bitmap restricting what details_level would push */
   void lua(lua_State* vm, AddressTree * ptree,
-	   DetailsLevel details_level, bool asListElement);
+	   DetailsLevel details_level, bool asListElement,
+	   u_int32_t fields = FLOW_LUA_ALL_FIELDS);
   void lua_get_min_info(lua_State* vm);
   void lua_duration_info(lua_State* vm);
   void lua_snmp_info(lua_State* vm);
@@ -689,22 +743,22 @@ class Flow : public GenericHashEntry {
   inline void setICMP(bool src2dst_direction, u_int8_t icmp_type, u_int8_t icmp_code, u_int8_t *icmpdata) {
     if(isICMP()) {
       if(src2dst_direction)
-	protos.icmp.cli2srv.icmp_type = icmp_type, protos.icmp.cli2srv.icmp_code = icmp_code;
+	protosRW()->icmp.cli2srv.icmp_type = icmp_type, protosRW()->icmp.cli2srv.icmp_code = icmp_code;
       else	
-	protos.icmp.srv2cli.icmp_type = icmp_type, protos.icmp.srv2cli.icmp_code = icmp_code;
+	protosRW()->icmp.srv2cli.icmp_type = icmp_type, protosRW()->icmp.srv2cli.icmp_code = icmp_code;
       // if(get_cli_host()) get_cli_host()->incICMP(icmp_type, icmp_code, src2dst_direction ? true : false, get_srv_host());
       // if(get_srv_host()) get_srv_host()->incICMP(icmp_type, icmp_code, src2dst_direction ? false : true, get_cli_host());
     }
   }
   inline void getICMP(u_int8_t *_icmp_type, u_int8_t *_icmp_code) {
     if(isBidirectional())
-      *_icmp_type = protos.icmp.srv2cli.icmp_type, *_icmp_code = protos.icmp.srv2cli.icmp_code;
+      *_icmp_type = protos->icmp.srv2cli.icmp_type, *_icmp_code = protos->icmp.srv2cli.icmp_code;
     else
-      *_icmp_type = protos.icmp.cli2srv.icmp_type, *_icmp_code = protos.icmp.cli2srv.icmp_code;
+      *_icmp_type = protos->icmp.cli2srv.icmp_type, *_icmp_code = protos->icmp.cli2srv.icmp_code;
   }
   inline u_int8_t getICMPType() {
     if(isICMP()) {
-      return isBidirectional() ? protos.icmp.srv2cli.icmp_type : protos.icmp.cli2srv.icmp_type;
+      return isBidirectional() ? protos->icmp.srv2cli.icmp_type : protos->icmp.cli2srv.icmp_type;
     }
 
     return 0;
@@ -721,21 +775,21 @@ class Flow : public GenericHashEntry {
   void clearRisks();
   inline void setDGADomain(char *name) { if(name) { if(suspicious_dga_domain) free(suspicious_dga_domain); suspicious_dga_domain = strdup(name); } }
   inline char* getDGADomain() const { return(hasRisk(NDPI_SUSPICIOUS_DGA_DOMAIN) && suspicious_dga_domain ? suspicious_dga_domain : (char*)""); }
-  inline char* getDNSQuery()  const { return(isDNS() ? protos.dns.last_query : (char*)"");  }
+  inline char* getDNSQuery()  const { return(isDNS() ? protos->dns.last_query : (char*)"");  }
   bool setDNSQuery(char *v);
-  inline void  setDNSQueryType(u_int16_t t) { if(isDNS()) { protos.dns.last_query_type = t; } }
-  inline void  setDNSRetCode(u_int16_t c)   { if(isDNS()) { protos.dns.last_return_code = c; } }
-  inline u_int16_t getLastQueryType()       { return(isDNS() ? protos.dns.last_query_type : 0); }
-  inline u_int16_t getDNSRetCode()          { return(isDNS() ? protos.dns.last_return_code : 0); }
-  inline char* getHTTPURL()                 { return(isHTTP() ? protos.http.last_url : (char*)"");   }
-  inline void  setHTTPURL(char *v)          { if(isHTTP()) { if(!protos.http.last_url) protos.http.last_url = v; } else { if(v) free(v); } }
-  inline char* getHTTPUserAgent()           { return(isHTTP() ? protos.http.last_user_agent : (char*)"");   }
-  inline void  setHTTPUserAgent(char *v)    { if(isHTTP()) { if(!protos.http.last_user_agent) protos.http.last_user_agent = v; } else { if(v) free(v); } }
+  inline void  setDNSQueryType(u_int16_t t) { if(isDNS()) { protosRW()->dns.last_query_type = t; } }
+  inline void  setDNSRetCode(u_int16_t c)   { if(isDNS()) { protosRW()->dns.last_return_code = c; } }
+  inline u_int16_t getLastQueryType()       { return(isDNS() ? protos->dns.last_query_type : 0); }
+  inline u_int16_t getDNSRetCode()          { return(isDNS() ? protos->dns.last_return_code : 0); }
+  inline char* getHTTPURL()                 { return(isHTTP() ? protos->http.last_url : (char*)"");   }
+  inline void  setHTTPURL(char *v)          { if(isHTTP()) { if(!protos->http.last_url) protosRW()->http.last_url = v; } else { if(v) free(v); } }
+  inline char* getHTTPUserAgent()           { return(isHTTP() ? protos->http.last_user_agent : (char*)"");   }
+  inline void  setHTTPUserAgent(char *v)    { if(isHTTP()) { if(!protos->http.last_user_agent) protosRW()->http.last_user_agent = v; } else { if(v) free(v); } }
   void setHTTPMethod(const char* method, ssize_t method_len);
   void setHTTPMethod(ndpi_http_method m);
-  inline void  setHTTPRetCode(u_int16_t c)  { if(isHTTP()) { protos.http.last_return_code = c; } }
-  inline u_int16_t getHTTPRetCode()   const { return isHTTP() ? protos.http.last_return_code : 0;           };
-  inline const char* getHTTPMethod()  const { return isHTTP() ? ndpi_http_method2str(protos.http.last_method) : (char*)"";        };
+  inline void  setHTTPRetCode(u_int16_t c)  { if(isHTTP()) { protosRW()->http.last_return_code = c; } }
+  inline u_int16_t getHTTPRetCode()   const { return isHTTP() ? protos->http.last_return_code : 0;           };
+  inline const char* getHTTPMethod()  const { return isHTTP() ? ndpi_http_method2str(protos->http.last_method) : (char*)"";        };
 
   void setExternalAlert(json_object *a);
   inline bool hasExternalAlert() const { return external_alert.json != NULL; };
@@ -864,12 +918,12 @@ class Flow : public GenericHashEntry {
 	   && is_active_entry_now_idle(10 * getInterface()->getFlowMaxIdle()));
   }
 
-  inline u_int16_t getTLSVersion()   { return(isTLS() ? protos.tls.tls_version : 0); }
-  inline u_int32_t getTLSNotBefore() { return(isTLS() ? protos.tls.notBefore   : 0); };
-  inline u_int32_t getTLSNotAfter()  { return(isTLS() ? protos.tls.notAfter    : 0); };
-  inline char* getTLSCertificateIssuerDN()  { return(isTLS() ? protos.tls.issuerDN  : NULL); }
-  inline char* getTLSCertificateSubjectDN() { return(isTLS() ? protos.tls.subjectDN : NULL); }
-  inline void  setTLSCertificateIssuerDN(char *issuer)  { if(protos.tls.issuerDN) free(protos.tls.issuerDN); protos.tls.issuerDN = strdup(issuer); }
+  inline u_int16_t getTLSVersion()   { return(isTLS() ? protos->tls.tls_version : 0); }
+  inline u_int32_t getTLSNotBefore() { return(isTLS() ? protos->tls.notBefore   : 0); };
+  inline u_int32_t getTLSNotAfter()  { return(isTLS() ? protos->tls.notAfter    : 0); };
+  inline char* getTLSCertificateIssuerDN()  { return(isTLS() ? protos->tls.issuerDN  : NULL); }
+  inline char* getTLSCertificateSubjectDN() { return(isTLS() ? protos->tls.subjectDN : NULL); }
+  inline void  setTLSCertificateIssuerDN(char *issuer)  { if(protos->tls.issuerDN) free(protos->tls.issuerDN); protosRW()->tls.issuerDN = strdup(issuer); }
   inline void setTOS(u_int8_t tos, bool is_cli_tos) { if(is_cli_tos) cli2srv_tos = tos; srv2cli_tos = tos; }
   inline u_int8_t getTOS(bool is_cli_tos) const { return (is_cli_tos ? cli2srv_tos : srv2cli_tos); }
 
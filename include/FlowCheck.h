@@ -27,11 +27,6 @@
 class FlowCheck : public Check {
  private:
   bool has_protocol_detected, has_periodic_update, has_flow_end, has_flow_begin;
-#ifdef CHECKS_PROFILING
-  struct {
-    std::atomic<u_int64_t> execution_time;
-  } stats;
-#endif
 
  public:
   FlowCheck(NtopngEdition _edition, bool _packet_interface_only, bool _nedge_exclude, bool _nedge_only,
@@ -47,6 +42,9 @@ class FlowCheck : public Check {
   /* Used to build an alert when triggerAlertAsync is used */
   virtual FlowAlert *buildAlert(Flow *f) { return NULL; };
 
+  /* True for checks relying on the packets of detected flows: disables the flow fast accounting */
+  virtual bool needsPacketData() const { return(false); };
+
   void addCheck(std::list<FlowCheck*> *l, NetworkInterface *iface, FlowChecks check);
   virtual bool loadConfiguration(json_object *config);
   
@@ -54,10 +52,6 @@ class FlowCheck : public Check {
 
   static void computeCliSrvScore(FlowAlertType alert_type, risk_percentage cli_pctg, u_int8_t *cli_score, u_int8_t *srv_score);
 
-#ifdef CHECKS_PROFILING
-  inline void incStats(u_int64_t exec_time) { stats.execution_time += exec_time; };
-#endif
-
   void lua(lua_State *vm);
 };
 
@@ -30,6 +30,7 @@ class FlowChecksExecutor { /* One instance per ntopng Interface */
  private:
   NetworkInterface *iface;
   std::list<FlowCheck*> *protocol_detected, *periodic_update, *flow_end, *flow_begin;
+  bool needs_packet_data;
 
   void loadFlowChecksAlerts(std::list<FlowCheck*> *cb_list);
   void loadFlowChecks(FlowChecksLoader *fcl);
@@ -39,6 +40,7 @@ class FlowChecksExecutor { /* One instance per ntopng Interface */
   virtual ~FlowChecksExecutor();
 
   FlowAlert *execChecks(Flow *f, FlowChecks c);
+  inline bool needsPacketData() const { return(needs_packet_data); };
 };
 
 #endif /* _FLOW_CHECKS_EXECUTOR_H_ */
@@ -49,6 +49,7 @@ class FlowChecksLoader : public ChecksLoader { /* A single instance inside Ntop
   inline std::list<FlowCheck*>* getFlowBeginChecks(NetworkInterface *iface)        { return(getChecks(iface, flow_check_flow_begin));          }
   inline std::list<FlowCheck*>* getNoneFlowChecks(NetworkInterface *iface)         { return(getChecks(iface, flow_check_flow_none));         }
   inline ndpi_risk getUnhandledRisks() const { return unhandled_ndpi_risks; };
+  bool checksNeedPacketData() const;
   inline bool isRiskUnhandled(ndpi_risk_enum risk) const { return NDPI_ISSET_BIT(unhandled_ndpi_risks, risk); };
   bool luaCheckInfo(lua_State* vm, std::string check_name) const;
   void lua(lua_State *vm);
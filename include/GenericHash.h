@@ -45,7 +45,8 @@ class GenericHash {
   u_int32_t current_size; /**< Current size of hash (including idle or ready-to-purge elements) */
   u_int32_t max_hash_size; /**< Max size of hash */
   u_int32_t upper_num_visited_entries; /**< Max number of entries to purge per run */
-  RwLock **locks;
+  RwLock **locks; /**< Bucket locks. Taken by writers, and by readers only when no epoch slot is available */
+  EpochManager epochs; /**< Epochs used by non-inline readers to walk buckets without locking */
   NetworkInterface *iface; /**< Pointer of network interface for this generic hash */
   u_int last_purged_hash; /**< Index of last purged hash */
   u_int last_entry_id; /**< An uniue identifier assigned to each entry in the hash table */
@@ -57,9 +58,30 @@ class GenericHash {
   } entry_state_transition_counters;
 
   vector<GenericHashEntry*> *idle_entries_in_use;   /**< Vector used by the offline thread in charge to hold idle entries but still in use */
-  vector<GenericHashEntry*> *idle_entries;          /**< Vector used by the offline thread in charge of deleting hash table entries */
-  vector<GenericHashEntry*> *idle_entries_shadow;   /**< Vector prepared by the purgeIdle and periodically swapped to idle_entries */
-  
+  /* Vectors retired by purgeIdle with their retire epoch, deleted in order by the offline thread.
+     More can be pending, so a slow reader only holds back the entries it might have seen */
+  std::queue<std::pair<u_int64_t, vector<GenericHashEntry*>*> > idle_entries;
+  Mutex idle_entries_lock;                          /**< Protects idle_entries */
+  vector<GenericHashEntry*> *idle_entries_shadow;   /**< Vector prepared by the purgeIdle and retired to idle_entries at the next run */
+
+  /**
+   * @brief Start a non-inline read of bucket hash
+   * @details Enters the current epoch so that entries cannot be freed while being read.
+   *          Falls back to the bucket read lock when all epoch slots are busy.
+   *
+   * @param hash The bucket that is going to be read
+   * @return The epoch slot to be passed to exitReadSection()
+   */
+  int enterReadSection(u_int32_t hash);
+
+  /**
+   * @brief End a read started with enterReadSection()
+   *
+   * @param hash The bucket that has been read
+   * @param epoch_slot The value returned by enterReadSection()
+   */
+  void exitReadSection(u_int32_t hash, int epoch_slot);
+
  public:
 
   /**
@@ -113,6 +135,7 @@ class GenericHash {
    * @details This method traverses all the non-idle entries of the hash table, calling
    *          the walker function on each of them. Function idle() is called for each entry
    *          to evaluate its state, determine if the entry is idle, and possibly call the walker.
+   *          Buckets are not locked: the walk is protected by an epoch (see EpochManager).
    *
    * @param begin_slot begin hash slot. Use 0 to walk all slots
    * @param walk_all true = walk all hash, false, walk only one (non NULL) slot
@@ -124,6 +147,8 @@ class GenericHash {
 
   /**
    * @brief Purge idle entries that have been previous idled by purgeIdle() via periodic calls
+   * @details Entries are deleted only when no reader can still reference them,
+   *          that is, when all readers have left the epoch in which entries were retired.
    * @return The number of purged entries
    */
   u_int64_t purgeQueuedIdleEntries();
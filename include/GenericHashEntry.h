@@ -81,7 +81,7 @@ class Generichash;
  */
 class GenericHashEntry {
  private:
-  GenericHashEntry *hash_next; /**< Pointer of next hash entry.*/
+  std::atomic<GenericHashEntry*> hash_next; /**< Pointer of next hash entry. Atomic as buckets are read without locks */
   HashEntryState hash_entry_state;
   GenericHash *hash_table;
 
@@ -86,6 +86,9 @@ class GenericTrafficElement {
   void lua(lua_State* vm, bool host_details);
   void getJSONObject(json_object *my_object, NetworkInterface *iface);
   void deserialize(json_object *obj, NetworkInterface *iface);
+  /* Traffic counters of HostSnapshot records, restored counters are added */
+  void getTrafficSnapshot(HostSnapshot *s) const;
+  void restoreTrafficSnapshot(const HostSnapshot *s);
 
   inline nDPIStats* getnDPIStats()                          { return(ndpiStats); };
   inline DSCPStats* getDSCPStats()                          { return(dscpStats); };
@@ -105,6 +105,8 @@ class HTTPstats {
   char* serialize();
   void deserialize(json_object *o);
   json_object* getJSONObject();
+  void getSnapshot(struct host_snapshot_hdr *s);
+  void restoreSnapshot(const struct host_snapshot_hdr *s);
 
   u_int32_t getSentNumQueries();
   u_int32_t getSentNumResponses();
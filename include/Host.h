@@ -323,8 +323,10 @@ class Host : public GenericHashEntry, public HostAlertableEntity, public Score,
   void periodic_stats_update(const struct timeval *tv);
   virtual void custom_periodic_stats_update(const struct timeval *tv) { ; }
 
+  /* fields is a HostLuaField bitmap restricting what host_details/verbose would push */
   virtual void lua(lua_State* vm, AddressTree * ptree, bool host_details,
-	   bool verbose, bool returnHost, bool asListElement);
+	   bool verbose, bool returnHost, bool asListElement,
+	   u_int32_t fields = HOST_LUA_ALL_FIELDS);
 
   void lua_get_bins(lua_State* vm)            const;
   void lua_get_ip(lua_State* vm)              const;
@@ -462,6 +464,9 @@ class Host : public GenericHashEntry, public HostAlertableEntity, public Score,
   DeviceProtoStatus getDeviceAllowedProtocolStatus(ndpi_protocol proto, bool as_client);
 
   virtual void serialize(json_object *obj, DetailsLevel details_level);
+  /* Binary records of the local hosts cache and of the interface checkpoints */
+  virtual void getSnapshot(HostSnapshot *s);
+  virtual void restoreSnapshot(const HostSnapshot *s);
 
   inline void requestStatsReset()                        { stats_reset_requested = true; };
   inline void requestNameReset()                         { name_reset_requested = true; };
@@ -41,6 +41,7 @@ class HostChecksLoader : public ChecksLoader {
 
   std::list<HostCheck*>* getChecks(NetworkInterface *iface);
   bool luaCheckInfo(lua_State* vm, std::string check_name) const;
+  void lua(lua_State *vm);
 };
 
 #endif /* _HOST_CHECKS_LOADER_H_ */
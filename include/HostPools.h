@@ -31,6 +31,7 @@ class Mac;
 class HostPools {
  private:
   VLANAddressTree *tree, *tree_shadow;
+  std::atomic<u_int32_t> trees_generation; /* Incremented when the trees are swapped */
   NetworkInterface *iface;
   u_int16_t max_num_pools;
   int32_t *num_active_hosts_inline, *num_active_hosts_offline;
@@ -77,9 +78,12 @@ class HostPools {
   u_int16_t getPool(Mac *m);
   u_int16_t getPoolByName(const char * pool_name);
 
+  /* found_node (patricia node of the matched prefix) is only returned when requested, slower */
   bool findIpPool(IpAddress *ip, VLANid vlan_id,
-		  u_int16_t *found_pool, ndpi_patricia_node_t **found_node);
+		  u_int16_t *found_pool, ndpi_patricia_node_t **found_node = NULL);
   bool findMacPool(const u_int8_t * const mac, u_int16_t *found_pool);
+  /* Results of findIpPool can be cached until the generation changes */
+  inline u_int32_t getTreesGeneration() const { return(trees_generation.load()); };
   bool findMacPool(Mac *mac, u_int16_t *found_pool);
   void lua(lua_State *vm);
 
@@ -0,0 +1,114 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _HOST_SERIALIZER_H_
+#define _HOST_SERIALIZER_H_
+
+#include "ntop_includes.h"
+
+class LocalHost;
+
+typedef struct {
+  std::string key, record;
+  std::string ip_mac_key, mac; /* IP@VLAN -> MAC association of LBD hosts, if any */
+} host_serialization;
+
+typedef struct {
+  u_int32_t id;
+  std::string key;
+  IpAddress ip;
+  VLANid vlan_id;
+  u_int16_t observation_point_id;
+
+  /* Set by HostSerializer::load */
+  HostSnapshot *snapshot;
+  json_object *legacy;         /* JSON record saved by older versions */
+} host_restore;
+
+/*
+  Moves the redis I/O of the local hosts cache off the packet path.
+
+  Idle hosts are encoded (HostSnapshot) inline and written to redis by
+  a background thread. New hosts enqueue a restore request instead of
+  reading redis synchronously: the thread fetches and decodes the record
+  and the packet thread adds it to the host on the next purgeIdle
+  (NetworkInterface::checkHostsToRestore). The pending writes are always
+  performed before reading a record, so a host coming back finds its
+  latest record.
+
+  When a queue is full the operation is performed inline as before.
+  At shutdown the restores still pending are read inline (readPendingRestore)
+  so that the final purge writes the complete counters of those hosts.
+*/
+class HostSerializer {
+ private:
+  NetworkInterface *iface;
+  FifoQueue<host_serialization*> *to_write;
+  FifoQueue<host_restore*> *to_restore, *restored;
+  std::atomic<u_int32_t> next_restore_id;
+  Condvar wakeup;
+  Mutex m, writes_lock;
+  pthread_t thread;
+  bool started, terminated;
+
+  /* Stats */
+  std::atomic<u_int64_t> num_written, num_inline_writes, num_restore_requests, num_inline_restores;
+  u_int64_t num_restored, num_legacy, num_not_found, num_invalid; /* Serializer thread */
+  u_int64_t num_applied, num_stale;                                /* Packet thread */
+  /* Packet thread time (nsec) spent serializing idle hosts and restoring new ones */
+  std::atomic<u_int64_t> num_serialize_samples, serialize_nsec, serialize_max_nsec;
+  std::atomic<u_int64_t> restore_nsec, restore_max_nsec; /* Request + apply, per num_restore_requests */
+
+  void start();
+  u_int32_t drain();
+  void loadRestore(host_restore *r);
+  static void updateMax(std::atomic<u_int64_t> *max_val, u_int64_t v);
+
+ public:
+  HostSerializer(NetworkInterface *_iface);
+  ~HostSerializer();
+
+  void run();
+  void stop();
+  /* Stops the thread and performs the pending writes inline */
+  void shutdown();
+  /* Performs the pending writes: to be called before reading a record */
+  u_int32_t flushWrites();
+  /* After stop(): reads the next restore not handled by the thread, NULL if none */
+  host_restore* readPendingRestore();
+
+  /* Packet thread */
+  bool enqueueSerialization(host_serialization *w);
+  u_int32_t enqueueRestore(const char *key, LocalHost *h);
+  host_restore* dequeueRestored();
+  void incSerializeTime(u_int64_t nsec);
+  void incRestoreTime(u_int64_t nsec);
+  inline void incApplied(bool stale) { if(stale) num_stale++; else num_applied++; };
+
+  static bool write(const host_serialization *w);
+  /* Reads and decodes the record of r->key: 1 = found, 0 = missing, -1 = invalid (deleted) */
+  static int load(host_restore *r);
+  static void freeRestore(host_restore *r);
+
+  void lua(lua_State *vm);
+};
+
+#endif /* _HOST_SERIALIZER_H_ */
@@ -0,0 +1,89 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _HOST_SNAPSHOT_H_
+#define _HOST_SNAPSHOT_H_
+
+#include "ntop_includes.h"
+
+#define HOST_SNAPSHOT_MAGIC        0x4E544853 /* NTHS */
+#define HOST_SNAPSHOT_VERSION      1
+#define HOST_SNAPSHOT_DNS_COUNTERS 13 /* queries, ok, error + 10 breakdown (struct queries_breakdown) */
+#define HOST_SNAPSHOT_HTTP_COUNTERS 5
+
+/* 0 = sent, 1 = rcvd (AS_SENDER/AS_RECEIVER for HTTP) */
+PACK_ON
+struct host_snapshot_hdr {
+  u_int32_t magic;
+  u_int16_t version;
+  u_int16_t num_protos;        /* host_snapshot_proto entries following the header */
+  u_int16_t ndpi_max_protos;   /* NDPI_MAX_SUPPORTED_PROTOCOLS of the writer: protocol ids are not portable */
+  u_int8_t  os_id, _pad;
+  u_int8_t  mac[6];
+  u_int64_t first_seen, last_stats_reset;
+  u_int64_t pkts[2], bytes[2];
+  u_int64_t udp_sent_unicast, udp_sent_non_unicast;
+  u_int64_t tcp_retr[2], tcp_ooo[2], tcp_lost[2], tcp_keepalive[2];
+  u_int32_t flows[2], alerted_flows[2], unreachable_flows[2], host_unreachable_flows[2];
+  u_int32_t total_activity_time, dropped_flows;
+  u_int32_t dns[2][HOST_SNAPSHOT_DNS_COUNTERS];
+  u_int32_t http_query[2][HOST_SNAPSHOT_HTTP_COUNTERS], http_response[2][HOST_SNAPSHOT_HTTP_COUNTERS];
+} PACK_OFF;
+
+PACK_ON
+struct host_snapshot_proto {
+  u_int16_t proto_id;
+  u_int32_t duration, total_flows;
+  u_int64_t pkts[2], bytes[2];
+} PACK_OFF;
+
+/*
+  Compact binary record of the LocalHost state saved to redis when the
+  local hosts cache is enabled, replacing the JSON of Host::serialize():
+  a fixed header followed by the per-protocol nDPI counters. Counters are
+  in host byte order as records are only read back by the same ntopng.
+  The interface checkpoints (InterfaceCheckpoint) also use it for MACs,
+  ASes, networks and interfaces, leaving the host fields empty.
+
+  Records saved by older versions (JSON) are recognized by decode()
+  returning false and are handled by the caller.
+*/
+class HostSnapshot {
+ private:
+  struct host_snapshot_hdr hdr;
+  std::vector<struct host_snapshot_proto> protos;
+
+ public:
+  HostSnapshot();
+
+  /* Allows reusing the same instance for many records */
+  void reset();
+
+  inline struct host_snapshot_hdr* get()             { return(&hdr);    };
+  inline const struct host_snapshot_hdr* get() const { return(&hdr);    };
+  inline const std::vector<struct host_snapshot_proto>* getProtos() const { return(&protos); };
+  inline void addProto(const struct host_snapshot_proto *p) { protos.push_back(*p); };
+
+  void encode(std::string *out);
+  bool decode(const char *buf, u_int32_t len);
+};
+
+#endif /* _HOST_SNAPSHOT_H_ */
@@ -0,0 +1,108 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _INTERFACE_CHECKPOINT_H_
+#define _INTERFACE_CHECKPOINT_H_
+
+#include "ntop_includes.h"
+
+#ifndef WIN32
+
+#define INTERFACE_CHECKPOINT_MAGIC   0x4E544350 /* NTCP */
+#define INTERFACE_CHECKPOINT_VERSION 1
+
+/* Written (and loaded) in this order: hosts need their MACs, ASes are created by their hosts */
+typedef enum {
+  checkpoint_record_iface = 0,
+  checkpoint_record_network,
+  checkpoint_record_mac,
+  checkpoint_record_host,
+  checkpoint_record_as,
+  CHECKPOINT_NUM_RECORD_TYPES
+} CheckpointRecordType;
+
+PACK_ON
+struct checkpoint_hdr {
+  u_int32_t magic;
+  u_int16_t version;
+  u_int16_t interface_id;
+  u_int64_t when;
+  u_int32_t num_records[CHECKPOINT_NUM_RECORD_TYPES];
+} PACK_OFF;
+
+/*
+  Record keys: IPv4/IPv6 address (hosts), MAC address, ASN, local
+  network name (e.g. 192.168.1.0/24), none for the interface counters
+*/
+PACK_ON
+struct checkpoint_record {
+  u_int8_t  type;      /* CheckpointRecordType */
+  u_int8_t  key_len;   /* Key following the record */
+  u_int16_t vlan_id, observation_point_id;
+  u_int32_t len;       /* HostSnapshot following the key */
+} PACK_OFF;
+
+/*
+  File of an interface warm restart checkpoint: a header followed by a
+  HostSnapshot per interface, local network, MAC, host and AS. It is
+  written to a temporary file renamed on commit(), and read back mapping
+  it in memory. Walking the interface hashes is up to NetworkInterface.
+*/
+class InterfaceCheckpoint {
+ private:
+  char path[MAX_PATH];
+  struct checkpoint_hdr hdr;
+  std::string record;
+
+  /* Writer */
+  FILE *fd;
+  char *fd_buf;
+
+  /* Reader */
+  u_char *map;
+  size_t map_len, offset;
+
+  u_int64_t num_bytes;
+
+  void close();
+
+ public:
+  InterfaceCheckpoint(u_int16_t interface_id);
+  ~InterfaceCheckpoint();
+
+  bool create();
+  bool write(CheckpointRecordType type, const void *key, u_int8_t key_len,
+	     VLANid vlan_id, u_int16_t observation_point_id, HostSnapshot *s);
+  bool commit();
+
+  /* Checkpoints older than max_age are discarded */
+  bool open(u_int32_t max_age);
+  /* Returns 1 when a record is read, 0 for an invalid record (skipped), -1 at the end */
+  int next(struct checkpoint_record *r, const u_int8_t **key, HostSnapshot *s);
+  void remove();
+
+  inline u_int32_t getNumRecords(CheckpointRecordType t) const { return(hdr.num_records[t]); };
+  inline u_int64_t getNumBytes()                         const { return(num_bytes); };
+  inline time_t    getWhen()                             const { return((time_t)hdr.when); };
+};
+
+#endif /* WIN32 */
+#endif /* _INTERFACE_CHECKPOINT_H_ */
@@ -73,7 +73,7 @@ class IpAddress {
   inline void set(const struct ipAddress * const ip)  { memcpy(&addr, ip, sizeof(struct ipAddress)); compute_key(); };
   void set(union usa *ip);
   void set(const char * ip);
-  void reloadBlacklist(ndpi_detection_module_struct* ndpi_struct);
+  void reloadBlacklist();
   inline bool isLoopbackAddress()        const        { return(addr.loopbackIP);    };
   inline bool isPrivateAddress()         const        { return(addr.privateIP);     };
   inline bool isMulticastAddress()       const        { return(addr.multicastIP);   };
@@ -0,0 +1,79 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _JSON_STREAM_WRITER_H_
+#define _JSON_STREAM_WRITER_H_
+
+#include "ntop_includes.h"
+
+/*
+  Writes JSON straight into the HTTP connection through a fixed size
+  buffer, so that large REST answers (e.g. thousands of flows) are never
+  held in memory as a whole, neither as Lua tables nor as a string.
+
+  Separators are handled here: callers just nest begin/end calls and
+  values. Lua tables are encoded as dkjson does (see luaValue), so that
+  streamed answers are the same as json.encode() of the Lua ones.
+*/
+class JSONStreamWriter {
+ private:
+  struct mg_connection *conn;
+  char *buf;
+  u_int32_t buf_len, buf_size;
+  u_int64_t num_bytes;
+  std::vector<bool> nonempty; /* One per open object/array */
+  bool after_key, write_error;
+
+  void append(const char *s, u_int32_t len);
+  inline void append(char c) { if(buf_len == buf_size) flush(); buf[buf_len++] = c; };
+  void appendEscaped(const char *s, size_t len);
+  void separator();
+  void luaNumber(lua_State *vm, int idx);
+  void luaTable(lua_State *vm, int idx, u_int8_t depth);
+  void luaEncode(lua_State *vm, int idx, u_int8_t depth);
+
+ public:
+  JSONStreamWriter(struct mg_connection *_conn, u_int32_t _buf_size = JSON_STREAM_WRITER_BUF_LEN);
+  ~JSONStreamWriter();
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+  void key(const char *k);
+
+  void string(const char *v);
+  void uint64(u_int64_t v);
+  void int64(int64_t v);
+  void number(double v);
+  void boolean(bool v);
+  void null();
+  /* Encodes the Lua value at index idx (left on the stack) */
+  inline void luaValue(lua_State *vm, int idx) { luaEncode(vm, idx, 0); };
+
+  /* Sends the buffered data: called by the destructor too */
+  bool flush();
+
+  inline u_int64_t getNumBytes()  const { return(num_bytes + buf_len); };
+  inline bool      hasErrors()    const { return(write_error);          };
+};
+
+#endif /* _JSON_STREAM_WRITER_H_ */
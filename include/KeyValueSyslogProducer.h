@@ -0,0 +1,58 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _KEY_VALUE_SYSLOG_PRODUCER_H_
+#define _KEY_VALUE_SYSLOG_PRODUCER_H_
+
+#include "ntop_includes.h"
+
+#define SYSLOG_KV_MAX_FIELDS 128
+
+/*
+  Firewall logs made of key=value pairs (values optionally "quoted"):
+  Fortinet FortiGate, Sophos XG and Sophos UTM. The same parser handles
+  the field names of the different vendors.
+
+  Traffic logs become flows, IPS/AV/web filter logs (or any log with an
+  attack name) become flows with an external alert.
+*/
+class KeyValueSyslogProducer : public SyslogProducer {
+ private:
+  typedef struct {
+    const char *key, *value;
+  } kv_field;
+
+  kv_field fields[SYSLOG_KV_MAX_FIELDS];
+  u_int num_fields;
+
+  void parse(char *message);
+  const char* get(const char *key) const;
+  const char* get(const char * const keys[]) const;
+  u_int32_t getNumber(const char * const keys[]) const;
+  bool isAlert(const char **signature, const char **category, int *severity) const;
+
+ public:
+  KeyValueSyslogProducer(SyslogParserInterface *_iface, const char *_name);
+
+  u_int8_t handleEvent(char *message, const char *host, int priority);
+};
+
+#endif /* _KEY_VALUE_SYSLOG_PRODUCER_H_ */
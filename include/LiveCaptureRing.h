@@ -0,0 +1,65 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _LIVE_CAPTURE_RING_H_
+#define _LIVE_CAPTURE_RING_H_
+
+#include "ntop_includes.h"
+
+/*
+  Lockless Single-Producer Single-Consumer byte ring holding the pcap
+  stream of a live capture: the packet processing thread appends the
+  records (pcap_disk_pkthdr + packet) and the HTTP thread of the capture
+  sends them to the client (see NetworkInterface::streamLiveCapture).
+
+  Records are never split nor dropped partially: when there is no room
+  for a record it is discarded and counted, so that a slow client never
+  slows down packet processing.
+*/
+class LiveCaptureRing {
+ private:
+  u_char *buffer;
+  u_int32_t size, snaplen;
+  std::atomic<u_int64_t> head, tail; /* Bytes written (producer) and sent (consumer) so far */
+  u_int64_t num_enqueued_pkts, num_dropped_pkts; /* Updated by the producer only */
+
+  void copy(u_int64_t pos, const void *data, u_int32_t len);
+
+ public:
+  /* size is rounded up to the next power of 2 */
+  LiveCaptureRing(u_int32_t _size, u_int32_t _snaplen);
+  ~LiveCaptureRing();
+
+  /* Producer */
+  bool write(const void *data, u_int32_t len);
+  bool enqueue(const struct pcap_pkthdr * const h, const u_char * const packet);
+
+  /* Consumer: returns the bytes that can be read contiguously from *data */
+  u_int32_t peek(const u_char **data);
+  inline void consume(u_int32_t len) { tail.store(tail.load(std::memory_order_relaxed) + len, std::memory_order_release); };
+  inline bool isEmpty() const { return(head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed)); };
+
+  inline u_int64_t getNumEnqueuedPackets() const { return(num_enqueued_pkts); };
+  inline u_int64_t getNumDroppedPackets()  const { return(num_dropped_pkts);  };
+  inline u_int32_t getNumPendingBytes()    const { return((u_int32_t)(head.load() - tail.load())); };
+};
+
+#endif /* _LIVE_CAPTURE_RING_H_ */
@@ -54,6 +54,8 @@ class LocalHost : public Host, public SerializableElement {
   LocalHostStats *initial_ts_point;
   std::unordered_map<u_int32_t, DoHDoTStats*> doh_dot_map;
   
+  u_int32_t restore_id; /* Pending HostSerializer restore, 0 = none */
+
   /* LocalHost data: update LocalHost::deleteHostData when adding new fields */
   char *os_detail;
   bool drop_all_host_traffic;
@@ -65,6 +67,9 @@ class LocalHost : public Host, public SerializableElement {
 
   char* getMacBasedSerializationKey(char *redis_key, size_t size, char *mac_key);
   char* getIpBasedSerializationKey(char *redis_key, size_t size);
+  void requestRestore();
+  void restoreLegacy(json_object *o);
+  void refreshInitialTsPoint();
   void luaDoHDot(lua_State *vm);
   
  public:
@@ -109,9 +114,15 @@ class LocalHost : public Host, public SerializableElement {
   virtual void deserialize(json_object *obj);
   virtual void serialize(json_object *obj, DetailsLevel details_level) { return Host::serialize(obj, details_level); };
   virtual char* getSerializationKey(char *buf, uint bufsize);
+  /* Local hosts cache: replaces SerializableElement::serializeToRedis/deserializeFromRedis */
+  void serializeSnapshot(bool idle);
+  bool restore(host_restore *r);
+  virtual void restoreSnapshot(const HostSnapshot *s);
+  inline bool isRestorePending() const { return(restore_id != 0); };
 
   virtual void lua(lua_State* vm, AddressTree * ptree, bool host_details,
-		   bool verbose, bool returnHost, bool asListElement);
+		   bool verbose, bool returnHost, bool asListElement,
+		   u_int32_t fields = HOST_LUA_ALL_FIELDS);
   void custom_periodic_stats_update(const struct timeval *tv) { ; }
 
   virtual void luaHostBehaviour(lua_State* vm)    { if(stats) stats->luaHostBehaviour(vm); }
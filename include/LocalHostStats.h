@@ -71,6 +71,8 @@ class LocalHostStats: public HostStats {
   virtual void updateStats(const struct timeval *tv);
   virtual void getJSONObject(json_object *my_object, DetailsLevel details_level);
   virtual void deserialize(json_object *obj);
+  virtual void getSnapshot(HostSnapshot *s);
+  virtual void restoreSnapshot(const HostSnapshot *s);
   virtual void lua(lua_State* vm, bool mask_host, DetailsLevel details_level);
   virtual void resetTopSitesData();
   
@@ -152,6 +152,8 @@ class Mac : public GenericHashEntry, public SerializableElement {
   void deserialize(json_object *obj);
   void serialize(json_object *obj, DetailsLevel details_level);
   char* getSerializationKey(char *buf, uint bufsize);
+  void getSnapshot(HostSnapshot *s);
+  void restoreSnapshot(const HostSnapshot *s);
 
   inline u_int64_t  getNumSentArp()  { return(stats->getNumSentArp());      }
   inline u_int64_t  getNumRcvdArp()  { return(stats->getNumRcvdArp());      }
@@ -26,6 +26,18 @@
 
 #ifdef HAVE_MYSQL
 
+class StringFifoQueue;
+class Condvar;
+class MySQLDB;
+
+typedef struct {
+  MySQLDB *db;
+  u_int8_t id;
+  MYSQL conn;
+  bool connected;
+  pthread_t thread;
+} MySQLWriter;
+
 class MySQLDB : public DB {
  protected:
   MYSQL mysql;
@@ -37,12 +49,26 @@ class MySQLDB : public DB {
   volatile bool db_created;
   pthread_t queryThreadLoop;
 
+  /*
+    Flows are buffered in memory as VALUES tuples (one queue per IP version)
+    and written by MYSQL_NUM_WRITERS threads as multi-row INSERTs, each batch
+    in a single transaction. Writer 0 runs in queryThreadLoop.
+  */
+  StringFifoQueue *batch_queue[2]; /* 0: IPv4, 1: IPv6 */
+  Condvar *batch_cond;
+  MySQLWriter writers[MYSQL_NUM_WRITERS];
+  std::atomic<u_int64_t> num_batches, num_batched_flows;
+  std::atomic<u_int32_t> max_batch_len, last_batch_len;
+  std::atomic<u_int32_t> num_failed_batches;
+
   bool connectToDB(MYSQL *conn, bool select_db);
   void open_log();
   char* get_last_db_error(MYSQL *conn) { return((char*)mysql_error(conn)); }
   int exec_sql_query(MYSQL *conn, const char *sql, bool doReconnect = true,
 		     bool ignoreErrors = false, bool doLock = true);
   void try_exec_sql_query(MYSQL *conn, char *sql);
+  u_int32_t flushBatch(MySQLWriter *w, u_int8_t ip_version_idx, char *sql, u_int sql_len);
+  bool execBatch(MySQLWriter *w, const char *sql);
   virtual bool createDBSchema();
   bool createNprobeDBView();
   MYSQL* mysql_try_connect(MYSQL *conn, const char *dbname);
@@ -55,6 +81,7 @@ class MySQLDB : public DB {
   virtual ~MySQLDB();
 
   virtual void* queryLoop();
+  void* writerLoop(MySQLWriter *w);
   virtual bool dumpFlow(time_t when, Flow *f, char *json);
 
   void disconnectFromDB(MYSQL *conn);
@@ -64,6 +91,7 @@ class MySQLDB : public DB {
   int exec_sql_query(lua_State *vm, char *sql, bool limitRows, bool wait_for_db_created);
   virtual bool startQueryLoop();
   void shutdown();
+  virtual void lua(lua_State* vm, bool since_last_checkpoint) const;
   int exec_single_query(lua_State *vm, char *sql);
   int select_database(char *dbname);
 };
@@ -138,6 +138,10 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
 
   /* Queue containing the ip@vlan strings of the hosts to restore. */
   StringFifoQueue *hosts_to_restore;
+  /* Asynchronous local hosts cache */
+  HostSerializer *host_serializer;
+  /* Set while the warm restart checkpoint is loaded: skip the local hosts cache */
+  bool loading_checkpoint;
 
   /* External alerts contain alertable entities other than host/interface/network
    * which are dynamically allocated when an alert for them occurs.
@@ -177,6 +181,8 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   Mutex active_captures_lock;
   u_int8_t num_live_captures;
   struct ntopngLuaContext *live_captures[MAX_NUM_PCAP_CAPTURES];
+  std::atomic<u_int64_t> live_captures_delivery; /* Odd while the packet thread is in deliverLiveCapture() */
+  bool removeLiveCapture(struct ntopngLuaContext * const luactx);
   static bool matchLiveCapture(struct ntopngLuaContext * const luactx,
 			       const struct pcap_pkthdr * const h,
 			       const u_char * const packet,
@@ -197,6 +203,10 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   bool is_traffic_mirrored, is_loopback;
   bool discard_probing_traffic;
   bool flows_only_interface; /* Only allocates flows for the interface (e.g., no hosts, ases, etc) */
+  struct {
+    bool decode_tunnels, ignore_vlans, simulate_vlans, ignore_macs, simulate_macs;
+  } dissect_prefs; /* Snapshot of the preferences read by dissectPacket */
+  bool fast_decode; /* dissectPacket tries fastDecodePacket before the generic decoder */
   ProtoStats discardedProbingStats;
 #ifdef NTOPNG_PRO
   L7Policer *policer;
@@ -210,6 +220,8 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   EthStats ethStats;
   std::map<u_int32_t, u_int64_t> ip_mac; /* IP (network byte order) <-> MAC association [2 bytes are unused] */
   u_int32_t arp_requests, arp_replies;
+  u_int64_t num_fast_accounting_pkts; /* Flow packets accounted with Flow::fastAccountingPacket */
+  bool flow_fast_accounting_allowed; /* No loaded flow check needs the packets of detected flows */
   ICMPstats icmp_v4, icmp_v6;
   LocalTrafficStats localStats;
   int pcap_datalink_type; /**< Datalink type of pcap. */
@@ -282,6 +294,7 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   dhcp_range* dhcp_ranges, *dhcp_ranges_shadow;
 
   INTERFACE_PROFILING_DECLARE(32);
+  PacketProfiler pkt_profiler;
 
   void init(const char *interface_name);
   void deleteDataStructures();
@@ -370,11 +383,25 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
 
   u_int64_t dequeueHostAlerts(u_int budget); /* Same as above but for hosts */
   u_int16_t guessEthType(const u_char *p, u_int len, u_int8_t *is_ethernet);
+  template <int datalink> bool fastDecodePacket(const struct pcap_pkthdr *h, const u_char *packet,
+						u_int16_t *eth_type, u_int16_t *ip_offset, VLANid *vlan_id) const;
+  bool isIngressPacket(struct ndpi_ethhdr *ethernet, bool ingressPacket);
+  bool processDecodedPacket(u_int32_t bridge_iface_idx, bool ingressPacket,
+			    const u_int64_t time, struct ndpi_ethhdr *ethernet,
+			    struct ndpi_ethhdr *dummy_ethernet, VLANid vlan_id,
+			    struct ndpi_iphdr *iph, struct ndpi_ipv6hdr *ip6,
+			    u_int16_t ip_offset, u_int16_t encapsulation_overhead,
+			    u_int32_t len_on_wire, const struct pcap_pkthdr *h,
+			    const u_char *packet, u_int16_t *ndpiProtocol,
+			    Host **srcHost, Host **dstHost, Flow **flow);
   void loadProtocolsAssociations(struct ndpi_detection_module_struct *ndpi_str);
 
 #ifdef NTOPNG_PRO
   void checkDHCPStorm(time_t when, u_int32_t num_pkts);
 #endif
+#ifndef WIN32
+  bool restoreCheckpointRecord(const struct checkpoint_record *r, const u_int8_t *key, const HostSnapshot *s);
+#endif
   
  public:
   /**
@@ -504,6 +531,12 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
 #endif
   void checkPointHostTalker(lua_State* vm, char *host_ip, VLANid vlan_id);
   int dumpLocalHosts2redis(bool disable_purge);
+#ifndef WIN32
+  /* Warm restart: see InterfaceCheckpoint */
+  bool saveCheckpoint(lua_State *vm = NULL);
+  bool loadCheckpoint(lua_State *vm = NULL);
+#endif
+  inline bool isLoadingCheckpoint() const { return(loading_checkpoint); };
   inline void incRetransmittedPkts(u_int32_t num)   { tcpPacketStats.incRetr(num);      };
   inline void incOOOPkts(u_int32_t num)             { tcpPacketStats.incOOO(num);       };
   inline void incLostPkts(u_int32_t num)            { tcpPacketStats.incLost(num);      };
@@ -571,6 +604,7 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   inline EthStats* getStats()      { return(&ethStats);          };
   inline int get_datalink()        { return(pcap_datalink_type); };
   inline void set_datalink(int l)  { pcap_datalink_type = l;     };
+  inline void setFastDecode(bool enabled) { fast_decode = enabled; };
   bool isStartingUp() const;
   bool isRunning() const;
   inline bool isTrafficMirrored()           const { return is_traffic_mirrored;            };
@@ -583,8 +617,11 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   void updateLbdIdentifier();
   void updateDiscardProbingTraffic();
   void updateFlowsOnlyInterface();
+  void updateDissectionPrefs();
   bool restoreHost(char *host_ip, VLANid vlan_id);
   void checkHostsToRestore();
+  void restoreLocalHost(host_restore *r);
+  inline HostSerializer* getHostSerializer() const { return(host_serializer); };
   u_int printAvailableInterfaces(bool printHelp, int idx, char *ifname, u_int ifname_len);
   void findFlowHosts(VLANid vlan_id, u_int16_t observation_domain_id,
 		     Mac *src_mac, IpAddress *_src_ip, Host **src,
@@ -606,21 +643,22 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
 		     const struct pcap_pkthdr *h, const u_char *packet,
 		     u_int16_t *ndpiProtocol,
 		     Host **srcHost, Host **dstHost, Flow **flow);
-  bool processPacket(u_int32_t bridge_iface_idx,
-		     bool ingressPacket,
-		     const struct bpf_timeval *when,
-		     const u_int64_t time,
-		     struct ndpi_ethhdr *eth,
-		     VLANid vlan_id,
-		     struct ndpi_iphdr *iph,
-		     struct ndpi_ipv6hdr *ip6,
-		     u_int16_t ip_offset,
-		     u_int16_t encapsulation_overhead,
-		     u_int32_t len_on_wire,
-		     const struct pcap_pkthdr *h,
-		     const u_char *packet,
-		     u_int16_t *ndpiProtocol,
-		     Host **srcHost, Host **dstHost, Flow **flow);
+  /* Virtual so that the tests can check the decoded packets it receives */
+  virtual bool processPacket(u_int32_t bridge_iface_idx,
+			     bool ingressPacket,
+			     const struct bpf_timeval *when,
+			     const u_int64_t time,
+			     struct ndpi_ethhdr *eth,
+			     VLANid vlan_id,
+			     struct ndpi_iphdr *iph,
+			     struct ndpi_ipv6hdr *ip6,
+			     u_int16_t ip_offset,
+			     u_int16_t encapsulation_overhead,
+			     u_int32_t len_on_wire,
+			     const struct pcap_pkthdr *h,
+			     const u_char *packet,
+			     u_int16_t *ndpiProtocol,
+			     Host **srcHost, Host **dstHost, Flow **flow);
   void processInterfaceStats(sFlowInterfaceStats *stats);
   void getActiveFlowsStats(nDPIStats *stats, FlowStats *status_stats, AddressTree *allowed_hosts, Host *h, Host *talking_with_host, Paginator *p, lua_State *vm, bool only_traffic_stats);
   virtual u_int32_t periodicStatsUpdateFrequency() const;
@@ -676,7 +714,9 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
 			 bool anomalousOnly, bool dhcpOnly,
 			 const AddressTree * const cidr_filter,
 			 char *sortColumn, u_int32_t maxHits,
-			 u_int32_t toSkip, bool a2zSortOrder);
+			 u_int32_t toSkip, bool a2zSortOrder,
+			 u_int32_t lua_fields = HOST_LUA_ALL_FIELDS,
+			 JSONStreamWriter *writer = NULL);
   int getActiveASList(lua_State* vm, const Paginator *p, bool diff = false);
   int getActiveObsPointsList(lua_State* vm, const Paginator *p);
   int getActiveOSList(lua_State* vm, const Paginator *p);
@@ -710,13 +750,15 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   void getFlowsStats(lua_State* vm);
   void getNetworkStats(lua_State* vm, u_int16_t network_id, AddressTree *allowed_hosts, bool diff = false) const;
   void getNetworksStats(lua_State* vm, AddressTree *allowed_hosts, bool diff = false) const;
+  /* With a writer the result is streamed as JSON (same layout) instead of being pushed to vm */
   int getFlows(lua_State* vm,
 	       u_int32_t *begin_slot,
 	       bool walk_all,
 	       AddressTree *allowed_hosts,
 	       Host *host,
 	       Host *talking_with_host,
-         Paginator *p);
+         Paginator *p,
+	       JSONStreamWriter *writer = NULL);
   int getFlowsTraffic(lua_State* vm,
 	       u_int32_t *begin_slot,
 	       bool walk_all,
@@ -797,6 +839,7 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
 
   bool registerLiveCapture(struct ntopngLuaContext * const luactx, int *id);
   bool deregisterLiveCapture(struct ntopngLuaContext * const luactx);
+  void streamLiveCapture(struct ntopngLuaContext * const luactx);
   void dumpLiveCaptures(lua_State* vm);
   bool stopLiveCapture(int capture_id);
 #ifdef NTOPNG_PRO
@@ -980,6 +1023,7 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   bool enqueueFlowToCompanion(ParsedFlow * const pf, bool skip_loopback_traffic);
   bool dequeueFlowFromCompanion(ParsedFlow ** pf);
 
+  inline PacketProfiler* getPacketProfiler() { return(&pkt_profiler); };
 #ifdef INTERFACE_PROFILING
   inline void profiling_section_enter(const char *label, int id) { INTERFACE_PROFILING_SECTION_ENTER(label, id); };
   inline void profiling_section_exit(int id) { INTERFACE_PROFILING_SECTION_EXIT(id); };
@@ -1041,6 +1085,7 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
    */
   u_int64_t dequeueFlowAlertsFromChecks(u_int budget);
   inline FlowChecksExecutor* getFlowCheckExecutor() { return(flow_checks_executor); }
+  inline bool isFlowFastAccountingAllowed() const { return(flow_fast_accounting_allowed); }
 
   /* Same as above but for hosts */
   u_int64_t dequeueHostAlertsFromChecks(u_int budget);
@@ -1062,8 +1107,6 @@ class NetworkInterface : public NetworkInterfaceAlertableEntity {
   inline ndpi_protocol_category_t get_ndpi_proto_category(ndpi_protocol proto) { return(ndpi_get_proto_category(get_ndpi_struct(), proto)); };
   ndpi_protocol_category_t get_ndpi_proto_category(u_int protoid);
   void setnDPIProtocolCategory(u_int16_t protoId, ndpi_protocol_category_t protoCategory);
-  bool nDPILoadIPCategory(char *what, ndpi_protocol_category_t id, char *list_name);
-  bool nDPILoadHostnameCategory(char *what, ndpi_protocol_category_t id, char *list_name);
   int nDPILoadMaliciousJA3Signatures(const char *file_path);
 
   inline void setLastInterfacenDPIReload(time_t now)      { last_ndpi_reload = now;   }
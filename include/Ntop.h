@@ -64,6 +64,9 @@ class Ntop {
   Redis *redis; /**< Pointer to the Redis server. */
   Mutex m, users_m, speedtest_m;
   std::map<std::string, bool> cachedCustomLists; /* Cache of lists filenames */
+  std::atomic<CategoryDB*> category_db; /* Custom categories and blacklists, shared by all the interfaces */
+  CategoryDB *category_db_old;          /* Freed on the next reload, as ndpi_struct_shadow */
+  CategoryDBBuilder *category_db_builder; /* Only during a reload */
 #ifndef HAVE_NEDGE
   ElasticSearch *elastic_search; /**< Pointer of Elastic Search. */
   ZMQPublisher *zmqPublisher;
@@ -73,6 +76,7 @@ class Ntop {
   ExportInterface *export_interface;
 #endif
   TimelineExtract *extract;
+  TimeseriesTopK *ts_topk;
   PeriodicActivities *pa; /**< Instance of periodical activities. */
   AddressResolution *address;
   Prefs *prefs;
@@ -99,6 +103,8 @@ class Ntop {
   char *local_network_names[CONST_MAX_NUM_NETWORKS];
   char *local_network_aliases[CONST_MAX_NUM_NETWORKS];
   AddressTree local_network_tree;
+  std::atomic<CompiledAddressTree*> local_network_lpm; /* Compiled local_network_tree, NULL if not available */
+  CompiledAddressTree *local_network_lpm_old;          /* Freed on the next change, as category_db_old */
 
   /* Alerts */
   FlowAlertsLoader flow_alerts_loader;
@@ -121,7 +127,9 @@ class Ntop {
 #ifndef WIN32
   ContinuousPing *cping;
   Ping *default_ping;
+  SNMPPoller *snmp_poller;
   std::map<std::string /* ifname */, Ping*> ping;
+  std::atomic<TimeseriesStore*> ts_store; /* Created by the first use of the native timeseries driver */
 #endif
   
 #ifdef __linux__
@@ -131,8 +139,10 @@ class Ntop {
   /* For local network */
   inline int16_t localNetworkLookup(int family, void *addr, u_int8_t *network_mask_bits = NULL);
   bool addLocalNetwork(char *_net);
+  void compileLocalNetworks();
 
   void loadLocalInterfaceAddress();
+  void loadCategoryDB();
   void initAllowedProtocolPresets();
   
   bool getUserPasswordHashLocal(const char * user, char *password_hash) const;
@@ -409,6 +419,7 @@ public:
   inline Trace*            getTrace()                { return ((globals!=NULL) ? globals->getTrace() : NULL); };
   inline Redis*            getRedis()                { return(redis);               };
   inline TimelineExtract*  getTimelineExtract()      { return(extract);             };
+  inline TimeseriesTopK*   getTimeseriesTopK()       { return(ts_topk);             };
 #ifndef HAVE_NEDGE
   inline ExportInterface*  get_export_interface()    { return(export_interface);    };
 #endif
@@ -555,7 +566,9 @@ public:
   
 #ifndef WIN32
   inline ContinuousPing* getContinuousPing()   { return(cping); }
+  inline SNMPPoller* getSNMPPoller()           { return(snmp_poller); }
   Ping*  getPing(char *ifname);
+  TimeseriesStore* getTimeseriesStore();
 #endif
   
   inline bool hasDroppedPrivileges()         { return(privileges_dropped); }
@@ -601,6 +614,10 @@ public:
   void setnDPIProtocolCategory(u_int16_t protoId, ndpi_protocol_category_t protoCategory);  
   bool nDPILoadIPCategory(char *what, ndpi_protocol_category_t id, char *list_name);
   bool nDPILoadHostnameCategory(char *what, ndpi_protocol_category_t id, char *list_name);
+  bool nDPIExcludeCategoryHost(char *what, ndpi_protocol_category_t id);
+  bool nDPILoadCategoryFile(const char *path, const char *format, ndpi_protocol_category_t id, char *list_name,
+			    u_int32_t max_ips, u_int32_t max_hosts, category_list_load_stats *stats);
+  inline CategoryDB* getCategoryDB() const { return(category_db.load()); };
   int nDPILoadMaliciousJA3Signatures(const char *file_path);
   void setLastInterfacenDPIReload(time_t now);
   bool needsnDPICleanup();
@@ -0,0 +1,103 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _PACKET_PROFILER_H_
+#define _PACKET_PROFILER_H_
+
+#include "ntop_includes.h"
+
+/* ******************************* */
+
+/*
+  Runtime (sampling) profiler of the packet processing pipeline.
+
+  Unlike INTERFACE_PROFILING, it is always compiled in and costs a single
+  branch per packet when disabled. When enabled, one packet out of
+  sampling_rate is timed with rdtsc at every stage boundary and the elapsed
+  cycles are accounted in a per-stage log2 histogram.
+
+  Packet stages are updated by the packet processing thread only, check stages
+  by the thread running the checks: counters are not atomic and readers
+  (Lua) may see slightly inconsistent values.
+*/
+class PacketProfiler {
+ private:
+  typedef struct {
+    u_int64_t num_samples, tot_ticks, max_ticks;
+    u_int64_t hist[PROFILER_NUM_BUCKETS]; /* hist[i]: samples in [2^i, 2^(i+1)) cycles */
+    u_int32_t skip;                       /* Sampling counter of the non-packet stages */
+  } StageStats;
+
+  volatile bool enabled;
+  u_int32_t sampling_rate;
+  u_int32_t pkt_skip;
+  bool sampling;    /* Current packet is being profiled */
+  ticks last_tick;
+  StageStats stages[profiler_num_stages];
+
+  static const char* stageName(ProfilerStage s);
+  void luaStage(lua_State *vm, ticks tps, ProfilerStage s);
+
+ public:
+  PacketProfiler();
+
+  void enable(bool enable, u_int32_t rate = 0 /* Keep current */);
+  void reset();
+  void lua(lua_State *vm);
+
+  inline bool isEnabled() const { return(enabled); };
+
+  inline void record(ProfilerStage s, ticks t) {
+    StageStats *st = &stages[s];
+    int bucket = (t > 1) ? (63 - __builtin_clzll(t)) : 0;
+
+    st->num_samples++, st->tot_ticks += t, st->hist[min_val(bucket, PROFILER_NUM_BUCKETS - 1)]++;
+    if(t > st->max_ticks) st->max_ticks = t;
+  }
+
+  /* Packet stages: call startPacket() once per packet, then mark() at the end of every stage */
+  inline void startPacket() {
+    sampling = false;
+
+    if(enabled && (++pkt_skip >= sampling_rate))
+      pkt_skip = 0, sampling = true, last_tick = Utils::getticks();
+  }
+
+  inline void mark(ProfilerStage s) {
+    if(sampling) {
+      ticks now = Utils::getticks();
+
+      record(s, now - last_tick);
+      last_tick = now;
+    }
+  }
+
+  /* Other stages: time the call only when sample() returns true */
+  inline bool sample(ProfilerStage s) {
+    if(!enabled || (++stages[s].skip < sampling_rate))
+      return(false);
+
+    stages[s].skip = 0;
+    return(true);
+  }
+};
+
+#endif /* _PACKET_PROFILER_H_ */
@@ -48,6 +48,7 @@ class Paginator {
   u_int8_t *mac_filter, icmp_type, icmp_code, dscp_filter;
   DetailsLevel details_level;
   bool details_level_set;
+  u_int32_t lua_fields; /* FlowLuaField bitmap */
   LocationPolicy client_mode;
   LocationPolicy server_mode;
   TcpFlowStateFilter tcp_flow_state_filter;
@@ -62,6 +63,7 @@ class Paginator {
   inline bool a2zSortOrder() const    { return(a2z_sort_order); }
   inline char *sortColumn() const     { return(sort_column); }
   inline bool detailedResults() const { return(detailed_results); }
+  inline u_int32_t luaFields() const  { return(lua_fields); }
 
   inline bool getDetailsLevel(DetailsLevel *f) const {
     if(details_level_set) { (*f) = details_level; return true; } return false;
@@ -36,7 +36,6 @@ class Ping {
   std::map<std::string /* IP */, float /* RTT */> results_v4, results_v6;
   std::map<std::string /* IP */, bool> pinged_v4, pinged_v6;
   
-  u_int16_t checksum(void *b, int len);
   void setOpts(int fd);
   void handleICMPResponse(unsigned char *buf, u_int buf_len, struct in_addr *ip, struct in6_addr *ip6);
   
@@ -44,6 +43,11 @@ class Ping {
   Ping(char *ifname);
   ~Ping();
 
+  static u_int16_t checksum(void *b, int len);
+  /* Used by ContinuousPing that sends and reads on its own (the poller thread is not started) */
+  inline int getSocket(bool v6)  const { return(v6 ? sd6 : sd); }
+  inline u_int16_t getPingId()   const { return(ping_id);       }
+
   int  ping(char *_addr, bool use_v6);
   void pollResults();
   void collectResponses(lua_State* vm, bool v6);
@@ -54,7 +54,9 @@ class Prefs {
     service_license_check, enable_sql_log, enable_access_log, log_to_file,
     enable_mac_ndpi_stats, enable_activities_debug, enable_behaviour_analysis,
     enable_asn_behaviour_analysis, enable_network_behaviour_analysis, enable_iface_l7_behaviour_analysis,
-    emit_flow_alerts, emit_host_alerts, dump_flows_on_clickhouse;
+    emit_flow_alerts, emit_host_alerts, dump_flows_on_clickhouse, checks_profiling,
+    es_gzip_requests, syslog_native_producers;
+  u_int8_t num_view_merge_threads;
   u_int32_t behaviour_analysis_learning_period;
   u_int32_t iec60870_learning_period;
   ServiceAcceptance behaviour_analysis_learning_status_during_learning,
@@ -71,7 +73,7 @@ class Prefs {
   u_int32_t other_rrd_raw_days, other_rrd_1min_days, other_rrd_1h_days, other_rrd_1d_days;
   u_int32_t housekeeping_frequency;
   bool disable_alerts, enable_top_talkers, enable_idle_local_hosts_cache,
-    enable_active_local_hosts_cache;
+    enable_active_local_hosts_cache, enable_warm_restart_checkpoint;
   bool enable_flow_device_port_rrd_creation, enable_observation_points_rrd_creation, enable_intranet_traffic_rrd_creation;
   bool enable_tiny_flows_export;
   bool enable_captive_portal, enable_informative_captive_portal, mac_based_captive_portal;
@@ -377,6 +379,7 @@ class Prefs {
   inline bool  flow_table_duration_or_last_seen()       { return(flow_table_time);     };
   inline bool  is_idle_local_host_cache_enabled()       { return(enable_idle_local_hosts_cache);    };
   inline bool  is_active_local_host_cache_enabled()     { return(enable_active_local_hosts_cache);  };
+  inline bool  is_warm_restart_checkpoint_enabled()     { return(enable_warm_restart_checkpoint);   };
 
   inline bool is_tiny_flows_export_enabled()             { return(enable_tiny_flows_export);            };
   inline bool is_flow_device_port_rrd_creation_enabled() { return(enable_flow_device_port_rrd_creation);};
@@ -434,6 +437,10 @@ class Prefs {
   inline u_int32_t getIEC60870LearingPeriod()    { return(iec60870_learning_period);                    };
   inline bool        dontEmitFlowAlerts()        { return(!emit_flow_alerts);                           };
   inline bool        dontEmitHostAlerts()        { return(!emit_host_alerts);                           };
+  inline bool        areChecksProfilingEnabled() { return(checks_profiling);                            };
+  inline bool        useESGzipRequests()         { return(es_gzip_requests);                            };
+  inline bool        useSyslogNativeProducers()  { return(syslog_native_producers);                     };
+  inline u_int8_t    getNumViewMergeThreads()    { return(num_view_merge_threads);                      };
   inline bool        useClickHouse()             { return(dump_flows_on_clickhouse);                              };
   inline void        dontUseClickHouse()         { dump_flows_on_clickhouse = dump_flows_on_mysql = false;        };
   inline char*       getZMQPublishEventsURL()    { return(zmq_publish_events_url);                      };
@@ -90,6 +90,9 @@ class Redis {
   inline int set(const char * key, const char * value, u_int expire_secs=0) { return(_set(false, key, value, expire_secs)); }
   /* setnx = set if not existing */
   inline int setnx(const char * key, const char * value, u_int expire_secs=0) { return(_set(true, key, value, expire_secs)); }
+  /* Binary safe, not cached */
+  int setBinary(const char *key, const char *value, u_int value_len, u_int expire_secs = 0);
+  int getBinary(const char *key, std::string *rsp);
   int keys(const char *pattern, char ***keys_p);
   int hashKeys(const char *pattern, char ***keys_p);
   int hashGetAll(const char *key, char ***keys_p, char ***values_p);
@@ -0,0 +1,134 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _SNMP_POLLER_H_
+#define _SNMP_POLLER_H_
+
+#include "ntop_includes.h"
+
+#ifndef WIN32
+
+/* Interface table columns walked on every device */
+typedef enum {
+  snmp_poller_in_octets = 0,
+  snmp_poller_out_octets,
+  snmp_poller_in_ucast_pkts,
+  snmp_poller_out_ucast_pkts,
+  snmp_poller_in_discards,
+  snmp_poller_out_discards,
+  snmp_poller_in_errors,
+  snmp_poller_out_errors,
+  snmp_poller_oper_status,
+  SNMP_POLLER_NUM_COLUMNS
+} snmp_poller_column;
+
+typedef struct {
+  u_int64_t value[SNMP_POLLER_NUM_COLUMNS];
+} snmp_poller_if_counters;
+
+typedef struct {
+  std::string agent; /* As specified by the user: IPv4[:port] */
+  struct sockaddr_in addr;
+  std::string community;
+  u_int8_t version;  /* 0 = v1, 1 = v2c */
+  u_int32_t poll_interval, max_requests_per_sec;
+  time_t last_heartbeat;
+
+  /* Current walk */
+  bool polling;
+  struct timeval poll_begin;
+  std::string next_oid[SNMP_POLLER_NUM_COLUMNS];
+  bool column_done[SNMP_POLLER_NUM_COLUMNS];
+  std::map<u_int32_t /* ifIndex */, snmp_poller_if_counters> walk_counters;
+  int32_t request_id;  /* Outstanding request, if any */
+  bool request_inflight;
+  struct timeval request_sent;
+  u_int8_t num_retries;
+  float tokens;  /* Rate limit (token bucket) */
+  struct timeval tokens_refill;
+
+  /* Completed walks */
+  time_t next_poll, last_poll, prev_poll;
+  u_int32_t last_poll_msec, num_consecutive_failures;
+  std::map<u_int32_t, snmp_poller_if_counters> last_counters, deltas;
+
+  u_int64_t num_polls, num_failed_polls, num_requests, num_timeouts, num_errors;
+} snmp_poller_device;
+
+/*
+  Native SNMP (v1/v2c) engine polling the interface counters of many
+  devices: hundreds of GETBULK (GETNEXT for v1) walks are kept in flight
+  on a single socket, with per-agent rate limit, retries with timeout
+  backoff, and a backoff of the poll interval for unresponsive agents.
+
+  Counters are kept here: Lua only gets the deltas between the last two
+  completed walks (see ntop.snmpPollerGetDeltas).
+*/
+class SNMPPoller {
+ private:
+  std::map<std::string /* agent */, snmp_poller_device*> devices;
+  std::unordered_map<int32_t /* request id */, snmp_poller_device*> inflight;
+  int sock;
+  int32_t next_request_id;
+  u_int32_t num_polling;
+  u_int8_t max_repetitions;
+  pthread_t poller;
+  Mutex m;
+  bool started;
+
+  /* Stats */
+  u_int64_t num_requests, num_responses, num_timeouts, num_retries,
+    num_unexpected_responses, num_polls, num_failed_polls;
+
+  static bool parseAgent(const char *agent, struct sockaddr_in *addr);
+  static const char* getColumnOID(u_int8_t version, u_int col);
+  static u_int64_t counterDelta(u_int64_t prev, u_int64_t cur, bool is_64bit);
+
+  void tick(const struct timeval *now);
+  void startWalk(snmp_poller_device *d, const struct timeval *now);
+  bool sendRequest(snmp_poller_device *d, const struct timeval *now);
+  void removeDevice(std::map<std::string, snmp_poller_device*>::iterator it);
+  void handleResponse(u_char *buf, int len, const struct sockaddr_in *from, const struct timeval *now);
+  void walkCompleted(snmp_poller_device *d, const struct timeval *now);
+  void walkFailed(snmp_poller_device *d);
+  void cancelRequest(snmp_poller_device *d);
+  void purgeIdleDevices(time_t now);
+  void luaDevice(lua_State *vm, snmp_poller_device *d);
+
+ public:
+  SNMPPoller();
+  ~SNMPPoller();
+
+  bool start();
+  void run();
+
+  /* Adds a new device or refreshes an existing one: devices not refreshed are discarded */
+  bool setDevice(const char *agent, const char *community, u_int8_t version,
+		 u_int32_t poll_interval, u_int32_t max_requests_per_sec);
+  void removeDevice(const char *agent);
+
+  /* Pushes the deltas of the devices polled after 'since' (epoch) */
+  void luaDeltas(lua_State *vm, const char *agent, time_t since);
+  void lua(lua_State *vm);
+};
+
+#endif /* WIN32 */
+#endif /* _SNMP_POLLER_H_ */
@@ -135,6 +135,15 @@ template <typename T> class SPSCQueue {
    */
   inline u_int64_t get_num_failed_enqueues() const { return num_failed_enqueues; };
 
+  /**
+   * Return the number of queued items (approximated by up to QUEUE_WATERMARK
+   * items, and when not called by the consumer)
+   */
+  inline u_int32_t get_num_pending() const { return (head - tail - 1) & (queue_size-1); };
+
+  inline u_int32_t get_size() const { return queue_size; };
+  inline const char* get_name() const { return name; };
+
   /**
    * Writes queue stats in a table of the vm passed as parameter
    */
@@ -142,6 +151,8 @@ template <typename T> class SPSCQueue {
     if(vm) {
       lua_newtable(vm);
       lua_push_uint64_table_entry(vm, "num_failed_enqueues", num_failed_enqueues);
+      lua_push_uint64_table_entry(vm, "num_pending", get_num_pending());
+      lua_push_uint64_table_entry(vm, "size", queue_size);
       lua_pushstring(vm, name ? name : "");
       lua_insert(vm, -2);
       lua_settable(vm, -3);
@@ -0,0 +1,54 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _SURICATA_SYSLOG_PRODUCER_H_
+#define _SURICATA_SYSLOG_PRODUCER_H_
+
+#include "ntop_includes.h"
+
+/* Suricata EVE JSON events (native version of check_definitions/syslog/suricata.lua) */
+class SuricataSyslogProducer : public SyslogProducer {
+ private:
+  char external_stats_key[64];
+
+  static const char* getString(json_object *o, const char *key);
+  static json_object* getObject(json_object *o, const char *key);
+  static int64_t getInt(json_object *o, const char *key, int64_t default_value = 0);
+  static void addField(ParsedFlow *flow, const char *name, json_object *o, const char *key);
+  static u_int16_t dnsType(const char *rrtype);
+
+  void parseFiveTuple(json_object *event, ParsedFlow *flow);
+  void parseFlowMetadata(json_object *event_flow, ParsedFlow *flow);
+  void parseNetflowMetadata(json_object *event_flow, ParsedFlow *flow);
+  void parseAlertMetadata(json_object *event_alert, ParsedFlow *flow);
+  void parseHTTPMetadata(json_object *event_http, ParsedFlow *flow);
+  void parseFileInfoMetadata(json_object *event_fileinfo, ParsedFlow *flow);
+  void parseDNSMetadata(json_object *event_dns, ParsedFlow *flow);
+  void parseTLSMetadata(json_object *event_tls, ParsedFlow *flow);
+  void parseStats(json_object *event_stats);
+
+ public:
+  SuricataSyslogProducer(SyslogParserInterface *_iface);
+
+  u_int8_t handleEvent(char *message, const char *host, int priority);
+};
+
+#endif /* _SURICATA_SYSLOG_PRODUCER_H_ */
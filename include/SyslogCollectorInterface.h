@@ -32,6 +32,8 @@ typedef struct {
   int socket;
   struct sockaddr_in address;
   char ip_str[INET_ADDRSTRLEN];
+  SyslogStreamFramer *framer;
+  u_int8_t reader_id;
 } syslog_client;
 
 typedef struct {
@@ -40,7 +42,20 @@ typedef struct {
   int sock;
 } syslog_socket;
 
-#define USE_RECVLINE
+#ifdef __linux__
+#define SYSLOG_USE_EPOLL
+#endif
+
+class SyslogCollectorInterface;
+
+/* TCP reader thread: polls (epoll) the connections assigned by the acceptor */
+typedef struct {
+  SyslogCollectorInterface *iface;
+  u_int8_t id;
+  int epoll_fd;
+  SyslogParserContext *ctx;
+  pthread_t thread;
+} syslog_reader;
 
 class SyslogCollectorInterface : public SyslogParserInterface {
  private:
@@ -48,18 +63,31 @@ class SyslogCollectorInterface : public SyslogParserInterface {
   syslog_socket udp_socket;
   syslog_socket tcp_socket;
   syslog_client tcp_connections[MAX_SYSLOG_SUBSCRIBERS];
+  Mutex connections_lock;
+  SyslogParserContext *ctx; /* UDP (and TCP without epoll) parsing of the collector thread */
+#ifdef SYSLOG_USE_EPOLL
+  int accept_epoll_fd;
+  syslog_reader readers[SYSLOG_NUM_READER_THREADS];
+  u_int8_t next_reader;
+  volatile bool readers_running;
+#endif
 
   struct {
-    u_int32_t num_flows;
+    std::atomic<u_int32_t> num_flows;
+    std::atomic<u_int64_t> num_events, num_bytes;
+    std::atomic<u_int32_t> num_truncated, num_connections;
   } recvStats;
 
   bool openSocket(syslog_socket *ss, const char *server_address, int server_port, int protocol);
   void closeSocket(syslog_socket *ss, int protocol);
+#ifdef SYSLOG_USE_EPOLL
+  bool startReaders();
+  void stopReaders();
+#else
   int  initFDSetsSocket(syslog_socket *ss, fd_set *read_fds, fd_set *write_fds, fd_set *except_fds, int protocol);
   int  initFDSets(fd_set *read_fds, fd_set *write_fds, fd_set *except_fds);
-#ifdef USE_RECVLINE
-  int  recvLine(int socket, char *buffer, size_t n);
 #endif
+  void purgeIdleEntries(time_t now);
 
  public:
   SyslogCollectorInterface(const char *_endpoint);
@@ -67,9 +95,12 @@ class SyslogCollectorInterface : public SyslogParserInterface {
 
   int handleNewConnection();
   void closeConnection(syslog_client *client);
-  int receiveFromClient(syslog_client *client);
+  int receiveFromClient(SyslogParserContext *parser_ctx, syslog_client *client);
 
-  int receive(int socket, char *client_ip, bool use_recvfrom);
+  int receive(int socket);
+#ifdef SYSLOG_USE_EPOLL
+  void readerLoop(syslog_reader *r);
+#endif
 
   virtual const char* get_type()    const { return(CONST_INTERFACE_TYPE_SYSLOG); };
   virtual InterfaceType getIfType() const { return(interface_type_SYSLOG); }
@@ -22,12 +22,27 @@
 #ifndef _SYSLOG_LUA_ENGINE_H_
 #define _SYSLOG_LUA_ENGINE_H_
 
+/* An event waiting for the next handleEvents() call: strings are offsets in batch_buf */
+typedef struct {
+  u_int32_t producer, message, host;
+  int priority;
+  SyslogProducerStats *stats;
+} syslog_lua_event;
+
 class SyslogLuaEngine : public LuaEngine {
  private:
   char script_path[MAX_PATH];
-  bool initialized;
+  bool initialized, batch_supported;
+
+  /* Events are passed to Lua in batches, to amortize the lua_pcall cost */
+  syslog_lua_event *batch;
+  u_int32_t num_batched;
+  char *batch_buf;
+  u_int32_t batch_buf_len;
+  time_t batch_first_time;
 
   bool pcall(int num_args, int num_results);
+  u_int32_t copyString(const char *s);
 
  public:
   SyslogLuaEngine(NetworkInterface *iface);
@@ -35,6 +50,17 @@ class SyslogLuaEngine : public LuaEngine {
 
   void handleEvent(const char *producer, const char *message,
     const char *host, int priority);
+
+  /* True when the module of the producer is loaded and enabled */
+  bool isProducerEnabled(const char *producer);
+
+  /* Batches an event: it is delivered when the batch is full or by flushEvents() */
+  void queueEvent(const char *producer, const char *message,
+    const char *host, int priority, SyslogProducerStats *stats);
+  void flushEvents();
+  inline bool hasExpiredEvents(time_t now) const {
+    return((num_batched > 0) && (now >= batch_first_time + SYSLOG_LUA_BATCH_MAX_DELAY));
+  }
 };
 
 #endif
@@ -24,23 +24,62 @@
 
 #include "ntop_includes.h"
 
+/*
+  Parsing state of a reader thread: parseLog() runs concurrently on
+  different contexts, so the native producers (which keep per-event state
+  in members) are instantiated per context
+*/
+class SyslogParserContext {
+ public:
+  /* Producers handled in C++ (name -> producer) */
+  typedef std::map<string, SyslogProducer*> native_producers_map_t;
+  native_producers_map_t native_producers;
+
+  /* Lookups of the interface producers stats, done without locking */
+  typedef std::map<string, SyslogProducerStats*> producers_stats_map_t;
+  producers_stats_map_t producers_stats;
+
+  ~SyslogParserContext();
+};
+
 class SyslogParserInterface : public ParserInterface {
  private:
   SyslogLuaEngine *le;
+  Mutex le_lock; /* The Lua engine is not reentrant */
+
   typedef std::map<string, string> producers_map_t;
   producers_map_t producers_map;
-  bool producers_reload_requested;
+  RwLock producers_map_lock;
+  std::atomic<bool> producers_reload_requested;
+
+  /* Events and processing time per producer, native or Lua */
+  typedef SyslogParserContext::producers_stats_map_t producers_stats_map_t;
+  producers_stats_map_t producers_stats;
+  Mutex producers_stats_lock;
+
+  void addNativeProducer(SyslogParserContext *ctx, SyslogProducer *p);
+  SyslogProducer* getNativeProducer(SyslogParserContext *ctx, const char *name);
+  SyslogProducerStats* getProducerStats(SyslogParserContext *ctx, const char *name, bool native);
+  void luaProducerStats(lua_State* vm);
+
+ protected:
+  /* Serializes the flows hash updates of the readers and the purge */
+  Mutex flow_lock;
 
  public:
   SyslogParserInterface(const char *endpoint, const char *custom_interface_type = NULL);
   ~SyslogParserInterface();
 
+  SyslogParserContext* newParserContext();
+
   void addProducerMapping(const char *host, const char *producer);
   void doProducersMappingUpdate();
   void updateProducersMapping() { producers_reload_requested = true; };
-  const char *getProducerName(const char *host);
+  const char *getProducerName(const char *host, char *buf, u_int buf_len);
 
-  u_int8_t parseLog(char *log_line, char *client_ip);
+  u_int8_t parseLog(SyslogParserContext *ctx, char *log_line, char *client_ip);
+  void flushPendingEvents(bool force = false);
+  bool processFlow(ParsedFlow *zflow);
 
   u_int32_t getNumDroppedPackets() { return 0; };
   virtual void lua(lua_State* vm);
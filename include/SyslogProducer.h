@@ -0,0 +1,66 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _SYSLOG_PRODUCER_H_
+#define _SYSLOG_PRODUCER_H_
+
+#include "ntop_includes.h"
+
+class SyslogParserInterface;
+
+/* Per-producer processing statistics (updated concurrently by the reader threads) */
+typedef struct {
+  std::atomic<u_int64_t> num_events;
+  std::atomic<u_int64_t> tot_ticks; /* Time spent handling the events (parsing, flows, alerts) */
+  std::atomic<bool> native;
+} SyslogProducerStats;
+
+/*
+  Base class of the producers handled natively in C++, without going
+  through the SyslogLuaEngine. A producer turns the content of a syslog
+  event into flows and external alerts, and updates the syslog stats
+  exactly as the Lua modules do with interface.incSyslogStats().
+
+  Each reader thread has its own instances (see SyslogParserContext),
+  so producers can keep parsing state in members.
+*/
+class SyslogProducer {
+ protected:
+  SyslogParserInterface *iface;
+  const char *name;
+
+  void processFlow(ParsedFlow *flow);
+  void incStats(u_int32_t num_unhandled, u_int32_t num_alerts, u_int32_t num_collected_flows);
+  static char* buildExternalAlert(const char *source, const char *signature,
+				  const char *category, int severity);
+  static u_int8_t str2proto(const char *proto);
+
+ public:
+  SyslogProducer(SyslogParserInterface *_iface, const char *_name) { iface = _iface, name = _name; };
+  virtual ~SyslogProducer() {};
+
+  inline const char* getName() const { return(name); };
+
+  /* Handles the (writable) content of an event: returns the number of flows processed */
+  virtual u_int8_t handleEvent(char *message, const char *host, int priority) = 0;
+};
+
+#endif /* _SYSLOG_PRODUCER_H_ */
@@ -26,13 +26,13 @@
 
 class SyslogStats {
  private:
-  u_int32_t num_total_events;
-  u_int32_t num_malformed;
-  u_int32_t num_dispatched;
-  u_int32_t num_unhandled;
-  u_int32_t num_alerts;
-  u_int32_t num_host_correlations;
-  u_int32_t num_collected_flows;
+  std::atomic<u_int32_t> num_total_events;
+  std::atomic<u_int32_t> num_malformed;
+  std::atomic<u_int32_t> num_dispatched;
+  std::atomic<u_int32_t> num_unhandled;
+  std::atomic<u_int32_t> num_alerts;
+  std::atomic<u_int32_t> num_host_correlations;
+  std::atomic<u_int32_t> num_collected_flows;
 
  public:
   SyslogStats();
@@ -0,0 +1,67 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _SYSLOG_STREAM_FRAMER_H_
+#define _SYSLOG_STREAM_FRAMER_H_
+
+#include "ntop_includes.h"
+
+/*
+  Splits a TCP syslog stream into messages (RFC 6587).
+
+  Data is read in large chunks and messages are returned in place,
+  NUL-terminated. Both framing methods are supported, and detected
+  per message:
+  - octet counting: "<len> <msg>"
+  - non-transparent framing: "<msg>\n" (trailing \r and NUL are ignored)
+
+  Messages longer than the buffer are truncated.
+*/
+class SyslogStreamFramer {
+ private:
+  char *buf;
+  u_int32_t size;       /* Usable size (one byte is reserved for the NUL) */
+  u_int32_t begin, end; /* Unparsed data */
+  u_int32_t skip;       /* Bytes of a truncated message still to discard */
+  bool skip_line;       /* Rest of a truncated line still to discard, up to the LF */
+  char *saved_pos, saved_char; /* Byte overwritten by the last NUL terminator */
+  u_int32_t num_truncated;
+
+  inline void restore() {
+    if(saved_pos) *saved_pos = saved_char, saved_pos = NULL;
+  }
+
+  char* terminate(u_int32_t msg_begin, u_int32_t msg_end);
+
+ public:
+  SyslogStreamFramer(u_int32_t _size = SYSLOG_STREAM_BUFFER_SIZE);
+  ~SyslogStreamFramer();
+
+  /* Reads from the socket: returns the bytes read, 0 on EOF, -1 on error (errno is preserved) */
+  ssize_t fill(int sock);
+
+  /* Returns the next complete message, or NULL when more data is needed */
+  char* next();
+
+  inline u_int32_t getNumTruncated() const { return(num_truncated); };
+};
+
+#endif /* _SYSLOG_STREAM_FRAMER_H_ */
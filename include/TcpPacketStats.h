@@ -48,6 +48,9 @@ class TcpPacketStats {
   }
 
   inline u_int64_t get_retr() const { return pktRetr; };
+  inline u_int64_t get_ooo()  const { return pktOOO; };
+  inline u_int64_t get_lost() const { return pktLost; };
+  inline u_int64_t get_keepalive() const { return pktKeepAlive; };
 };
 
 #endif /* _TCP_PACKET_STATS_H_ */
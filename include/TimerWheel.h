@@ -0,0 +1,65 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include "ntop_includes.h"
+
+#define TIMER_WHEEL_SLOT_BITS  8
+#define TIMER_WHEEL_NUM_SLOTS  (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK  (TIMER_WHEEL_NUM_SLOTS - 1)
+
+/*
+  Two levels hierarchical timer wheel of numeric ids: the inner wheel has
+  one slot per tick, the outer one a slot every TIMER_WHEEL_NUM_SLOTS ticks
+  whose timers are moved to the inner wheel when it comes around. Timers
+  further than the outer wheel are parked in its last slot and rescheduled.
+
+  Timers can't be cancelled: owners discard the stale ids returned by
+  advance() (e.g. checking their own expire tick). Not thread safe.
+*/
+class TimerWheel {
+ private:
+  typedef struct {
+    u_int32_t id;
+    u_int64_t expire;
+  } timer_wheel_entry;
+
+  std::vector<timer_wheel_entry> inner[TIMER_WHEEL_NUM_SLOTS], outer[TIMER_WHEEL_NUM_SLOTS];
+  u_int64_t current;  /* Last processed tick */
+  u_int32_t num_timers;
+
+  void insert(u_int32_t id, u_int64_t expire);
+
+ public:
+  TimerWheel(u_int64_t now_tick);
+
+  /* Timers already expired fire on the next advance() */
+  void schedule(u_int32_t id, u_int64_t expire_tick);
+  /* Processes the ticks up to now_tick, appending the expired ids */
+  void advance(u_int64_t now_tick, std::vector<u_int32_t> *expired);
+
+  inline u_int64_t getCurrentTick() const { return(current);    };
+  inline u_int32_t getNumTimers()   const { return(num_timers); };
+};
+
+#endif /* _TIMER_WHEEL_H_ */
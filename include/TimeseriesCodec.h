@@ -0,0 +1,66 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _TIMESERIES_CODEC_H_
+#define _TIMESERIES_CODEC_H_
+
+#include "ntop_includes.h"
+
+#define TS_CODEC_DELTA 0 /* Zigzag varints of the delta of deltas: integer values */
+#define TS_CODEC_XOR   1 /* XOR with the previous value (Gorilla): any double */
+
+/*
+  Compression of the points of a series within a chunk of the native
+  timeseries store (TimeseriesStore). A block is the presence bitmap of
+  the chunk points followed by a column per metric, holding the values
+  of the present points only:
+
+    [codec (1 byte)][length (varint)][encoded values]
+
+  Counters are integers and compress best as delta of deltas, columns
+  with fractional (or NaN) values fall back to XOR.
+*/
+class TimeseriesCodec {
+ private:
+  static bool isIntegral(const double *values, u_int32_t n);
+  static void encodeDelta(const double *values, u_int32_t n, std::string *out);
+  static void encodeXOR(const double *values, u_int32_t n, std::string *out);
+  static bool decodeDelta(const u_int8_t *buf, u_int32_t len, u_int32_t n, double *values);
+  static bool decodeXOR(const u_int8_t *buf, u_int32_t len, u_int32_t n, double *values);
+
+ public:
+  static void putVarint(u_int64_t v, std::string *out);
+  /* Returns the bytes read, 0 on error */
+  static u_int32_t getVarint(const u_int8_t *buf, u_int32_t len, u_int64_t *v);
+
+  static void encodeColumn(const double *values, u_int32_t n, std::string *out);
+  /* Returns the bytes read, 0 on error */
+  static u_int32_t decodeColumn(const u_int8_t *buf, u_int32_t len, u_int32_t n, double *values);
+
+  /*
+    values are [metric][point], NaN for missing values: a point is present
+    when at least one of its metrics is. Decoding sets the missing ones to NaN.
+  */
+  static void encodeBlock(const double *values, u_int16_t num_points, u_int8_t num_metrics, std::string *out);
+  static bool decodeBlock(const u_int8_t *buf, u_int32_t len, u_int16_t num_points, u_int8_t num_metrics, double *values);
+};
+
+#endif /* _TIMESERIES_CODEC_H_ */
@@ -0,0 +1,220 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _TIMESERIES_STORE_H_
+#define _TIMESERIES_STORE_H_
+
+#include "ntop_includes.h"
+
+#ifndef WIN32
+
+#define TS_STORE_DIR           "ts"
+#define TS_CHUNK_MAGIC         0x4E545443 /* NTTC */
+#define TS_SERIES_MAGIC        0x4E545453 /* NTTS */
+#define TS_STORE_VERSION       1
+#define TS_MAX_METRICS         16
+#define TS_MAX_LEVELS          3    /* Raw, hourly and daily points */
+#define TS_CHUNK_DURATION      3600 /* Raw points kept in memory before being written */
+#define TS_MIN_CHUNK_POINTS    12
+#define TS_ROLLUP_CHUNK_POINTS 24
+#define TS_SEGMENT_NUM_CHUNKS  24   /* Chunks per segment file */
+#define TS_ROLLUP_BATCH        65536 /* Series rolled up at once */
+#define TS_MAX_ROLLUP_BACKLOG  32   /* Windows rolled up after a restart */
+
+/*
+  A chunk record of a segment file: the header, the index of the series
+  sorted by id and their blocks (TimeseriesCodec). Point i of a block is
+  at start + i * step.
+*/
+PACK_ON
+struct ts_chunk_hdr {
+  u_int32_t magic;
+  u_int32_t len;          /* Whole record, header included */
+  u_int32_t start, step;
+  u_int16_t num_points;
+  u_int8_t  num_metrics, level;
+  u_int32_t num_series;
+} PACK_OFF;
+
+PACK_ON
+struct ts_chunk_entry {
+  u_int32_t series_id;
+  u_int32_t offset;       /* Of the block from the record start */
+} PACK_OFF;
+
+/* series.idx: the header followed by a ts_series_record + key per series */
+PACK_ON
+struct ts_series_hdr {
+  u_int32_t magic;
+  u_int16_t version;
+  u_int8_t  num_metrics, is_counter;
+  u_int32_t step, next_id;
+  u_int16_t name_len;     /* Schema name following the header */
+} PACK_OFF;
+
+PACK_ON
+struct ts_series_record {
+  u_int32_t id, last_ts;
+  u_int16_t key_len;      /* 0: the series has been deleted */
+} PACK_OFF;
+
+typedef struct {
+  u_int32_t step, chunk_duration, segment_duration;
+  /* Rollup levels: end of the last window written and queued */
+  u_int32_t rolled_until, scheduled_until;
+} ts_level;
+
+typedef struct {
+  const std::string *key; /* Key in ts_schema::ids, NULL when deleted */
+  u_int32_t last_ts;
+} ts_series;
+
+/* Raw points of a chunk window: values are [slot][metric][point], NaN when missing */
+typedef struct {
+  u_int32_t start;
+  std::vector<u_int32_t> slot_of; /* series id -> slot + 1 */
+  std::vector<u_int32_t> slot_series;
+  std::vector<double> values;
+} ts_chunk;
+
+typedef struct {
+  std::string name, path;
+  u_int32_t step;
+  u_int8_t num_metrics, num_levels;
+  bool is_counter;
+  ts_level levels[TS_MAX_LEVELS];
+
+  /* Series dictionary: ids are never reused */
+  std::unordered_map<std::string, u_int32_t> ids;
+  std::vector<ts_series> series;
+  u_int32_t num_active;
+  FILE *series_fd;
+
+  /*
+    Chunk receiving the points (NULL when none) and the complete ones
+    waiting to be written by the rollup thread, oldest first. Sealed
+    chunks are no longer modified and can be read unlocked.
+  */
+  u_int16_t chunk_points;
+  std::shared_ptr<ts_chunk> open;
+  std::deque<std::shared_ptr<ts_chunk> > sealed;
+
+  Mutex m;
+} ts_schema;
+
+typedef struct {
+  ts_schema *schema;
+  u_int8_t level;   /* 0: write the sealed chunks */
+  u_int32_t window;
+} ts_rollup_task;
+
+class TsConsumer;
+class TsSegment;
+class TsSnapshot;
+
+/*
+  Native timeseries engine, an alternative to RRD files and InfluxDB
+  (scripts/lua/modules/timeseries/drivers/native.lua).
+
+  Points are on a fixed grid of the schema step. The last TS_CHUNK_DURATION
+  seconds of raw points of each schema are kept in memory as columns and
+  then compressed by a background thread into a chunk appended to the
+  segment file of the day. The same thread rolls the chunks up into hourly
+  and daily points (last value of counters, average of gauges) used to
+  answer the queries over long time ranges. Segment files are read mapping
+  them in memory, without locking the schema, and are deleted as a whole
+  once older than the data retention.
+
+  Series are identified by their tags as a "tag=value,..." key. Queries and
+  topk take a filter key with a subset of the tags and return the rates of
+  counters, as the RRD driver does.
+*/
+class TimeseriesStore {
+ private:
+  char base_path[MAX_PATH];
+  std::map<std::string, ts_schema*> schemas;
+  Mutex m;
+
+  /* Rollups */
+  std::deque<ts_rollup_task> rollups;
+  Mutex rollups_m;
+  Condvar wakeup;
+  pthread_t thread;
+  bool started, terminated;
+
+  /* Stats */
+  std::atomic<u_int64_t> num_points, num_late_points, num_chunks, num_chunk_bytes, num_raw_bytes;
+  std::atomic<u_int64_t> num_rollups, rollup_usec, num_queries, query_usec;
+
+  ts_schema* getSchema(const char *name, bool create, u_int32_t step = 0, u_int8_t num_metrics = 0, bool is_counter = false);
+  ts_schema* loadSchema(const char *path);
+  void initLevels(ts_schema *s);
+  void freeSchema(ts_schema *s);
+  bool openSeries(ts_schema *s);
+  bool rewriteSeries(ts_schema *s);
+  u_int32_t addSeries(ts_schema *s, const char *key, u_int32_t when);
+
+  void listSegments(ts_schema *s, std::vector<std::pair<u_int8_t, u_int32_t> > *out);
+  void getSegmentPath(ts_schema *s, u_int8_t level, u_int32_t segment_start, char *buf, u_int buf_len);
+  bool writeChunk(ts_schema *s, u_int8_t level, u_int32_t start, u_int32_t step, u_int16_t num_points,
+		  const std::vector<u_int32_t> &ids, const std::string &blocks, const std::vector<u_int32_t> &offsets);
+  void sealChunk(ts_schema *s);
+  void writeSealed(ts_schema *s);
+  void scheduleRollups(ts_schema *s, u_int8_t level, u_int32_t written_until);
+  void rollup(ts_schema *s, u_int8_t level, u_int32_t window);
+
+  void mapSegments(ts_schema *s, u_int8_t level, u_int32_t from, u_int32_t to, std::vector<TsSegment*> *out);
+  void scan(ts_schema *s, const std::vector<TsSegment*> &segments, u_int32_t from, u_int32_t to,
+	    const std::vector<u_int32_t> &ids, const std::vector<u_int32_t> &idx_of, TsConsumer *c);
+  void scanChunk(ts_schema *s, const ts_chunk *chunk, u_int32_t from, u_int32_t to, const std::vector<u_int32_t> &ids, TsConsumer *c);
+  void selectSeries(ts_schema *s, const char *filter, std::vector<u_int32_t> *ids, std::vector<u_int32_t> *idx_of);
+  u_int8_t getQueryLevel(ts_schema *s, u_int32_t tstart, u_int32_t tend, u_int32_t max_points, u_int32_t *out_step);
+  void takeSnapshot(ts_schema *s, u_int8_t level, u_int32_t from, u_int32_t tend, TsSnapshot *snap);
+  void scanSnapshot(ts_schema *s, TsSnapshot *snap, const std::vector<u_int32_t> &ids,
+		    const std::vector<u_int32_t> &idx_of, TsConsumer *c);
+
+  static bool keyMatches(const std::string &key, const std::vector<std::string> &filter);
+
+ public:
+  TimeseriesStore(const char *working_dir);
+  ~TimeseriesStore();
+
+  void runRollups();
+
+  bool append(const char *schema_name, u_int32_t step, bool is_counter, const char *key,
+	      u_int32_t when, const double *values, u_int8_t num_values);
+
+  /* The following functions push their result to the lua stack, returning false (nothing pushed) on error */
+  bool query(const char *schema_name, const char *filter, u_int32_t tstart, u_int32_t tend,
+	     u_int32_t max_points, lua_State *vm);
+  bool topk(const char *schema_name, const char *filter, u_int32_t tstart, u_int32_t tend,
+	    u_int32_t max_points, u_int32_t k, lua_State *vm);
+  bool listSeries(const char *schema_name, const char *filter, u_int32_t start_time, lua_State *vm);
+
+  /* Empty prefix: all the schemas, otherwise "prefix:..." schemas */
+  u_int32_t deleteSeries(const char *schema_prefix, const char *filter);
+  void deleteOldData(u_int32_t retention_sec);
+
+  void lua(lua_State *vm);
+};
+
+#endif /* WIN32 */
+#endif /* _TIMESERIES_STORE_H_ */
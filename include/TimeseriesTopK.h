@@ -0,0 +1,129 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _TIMESERIES_TOPK_H_
+#define _TIMESERIES_TOPK_H_
+
+#include "ntop_includes.h"
+
+#define TS_TOPK_NUM_LEVELS       3    /* Step, hourly and daily slots */
+#define TS_TOPK_CMS_DEPTH        4
+#define TS_TOPK_CMS_WIDTH_BITS   9
+#define TS_TOPK_CMS_WIDTH        (1 << TS_TOPK_CMS_WIDTH_BITS)
+#define TS_TOPK_CANDIDATES       32   /* Heavy items tracked per slot */
+#define TS_TOPK_MAX_METRICS      8
+#define TS_TOPK_MIN_GROUP_ITEMS  64   /* Smaller groups are cheap to query on the driver */
+#define TS_TOPK_MAX_GROUPS       64
+#define TS_TOPK_HOURLY_SLOTS     26   /* 1 day window, plus the slot being written */
+#define TS_TOPK_DAILY_SLOTS      33   /* 1 month window */
+
+/*
+  A time slot of a group: a count-min sketch with the sum of the item
+  values by metric (counter deltas, gauges value * step) and the items
+  with the highest values, used as topk candidates. Candidates values are
+  exact from when they enter the slot: at the step level, where an item
+  has a single point per slot, they are always exact. The items that are
+  not candidates have a total of at most threshold.
+*/
+typedef struct {
+  u_int32_t start;                 /* 0: never written */
+  float *cms;                      /* [depth][width][num_metrics] */
+  u_int32_t candidates[TS_TOPK_CANDIDATES];
+  float values[TS_TOPK_CANDIDATES][TS_TOPK_MAX_METRICS];
+  float totals_by_candidate[TS_TOPK_CANDIDATES];
+  bool exact[TS_TOPK_CANDIDATES];  /* false: the values of the candidate before it entered the slot are estimated */
+  float threshold;                 /* Highest total of an item dropped from (or not entered in) the candidates */
+  u_int8_t num_candidates;
+  double totals[TS_TOPK_MAX_METRICS];
+} ts_topk_slot;
+
+/*
+  The series of a schema sharing all the tags but the last one (e.g. the
+  hosts of an interface in host:traffic). Its items are the values of the
+  last tag.
+*/
+typedef struct {
+  u_int32_t step, covered_from;    /* Queries on older data go to the driver */
+  u_int32_t last_update;
+  u_int8_t num_metrics;
+  bool is_counter;
+  std::unordered_map<std::string, u_int32_t> ids;
+  std::vector<std::string> items;
+  std::vector<double> prev;        /* Last counter values, by item */
+  std::vector<u_int32_t> prev_when;
+  std::vector<ts_topk_slot> slots[TS_TOPK_NUM_LEVELS];
+  u_int32_t slot_duration[TS_TOPK_NUM_LEVELS];
+  Mutex m;
+} ts_topk_group;
+
+/*
+  Rolling topk summaries updated by ts_utils.append (when enabled with the
+  ts_topk_summaries preference), answering the topk
+  queries of the timeseries charts without reading the series of the
+  driver. Only the groups with at least TS_TOPK_MIN_GROUP_ITEMS items are
+  summarized: a group is tracked from when it reaches that size, and its
+  data is kept for a day at the schema step, a day by hour and a month by
+  day. Summaries are not persisted.
+*/
+class TimeseriesTopK {
+ private:
+  typedef struct {
+    u_int32_t slot, count;         /* Items of the group seen in the step slot */
+    u_int32_t last_update;
+  } ts_topk_pending;
+
+  Mutex m;
+  std::unordered_map<std::string, ts_topk_group*> groups;
+  std::unordered_map<std::string, ts_topk_pending> pending;
+  u_int32_t last_purge;
+  std::atomic<u_int64_t> num_updates, num_queries, num_misses, num_approximate, query_usec;
+
+  void purgeIdle(u_int32_t now);
+  static void freeGroup(ts_topk_group *g);
+
+  /* Returns the group locked */
+  ts_topk_group* getGroup(const std::string &group_key, u_int32_t when, u_int32_t step,
+			  u_int8_t num_metrics, bool is_counter);
+  static void resetSlot(ts_topk_group *g, ts_topk_slot *slot, u_int32_t start);
+  static inline u_int32_t cell(u_int32_t item_id, u_int8_t row);
+  static void updateSlot(ts_topk_group *g, ts_topk_slot *slot, u_int32_t item_id, const double *values, bool single_point);
+  static void estimate(ts_topk_group *g, const ts_topk_slot *slot, u_int32_t item_id, double *values);
+  static bool getValues(ts_topk_group *g, const ts_topk_slot *slot, u_int32_t item_id, double *values);
+
+ public:
+  TimeseriesTopK();
+  ~TimeseriesTopK();
+
+  /* group: "tag=value,..." of all the schema tags but the last one, item: the last tag value */
+  void update(const char *schema_name, const char *group, const char *item, u_int32_t when,
+	      u_int32_t step, bool is_counter, const double *values, u_int8_t num_values);
+  /*
+    Pushes the result to the lua stack, returns false (nothing pushed) when the window is not covered.
+    The result is approximate when the values of some top items are estimated, or when an item that
+    is not among the candidates of the slots could be in the topk.
+  */
+  bool query(const char *schema_name, const char *group, u_int32_t tstart, u_int32_t tend,
+	     u_int32_t k, lua_State *vm);
+
+  void lua(lua_State *vm);
+};
+
+#endif /* _TIMESERIES_TOPK_H_ */
@@ -40,6 +40,10 @@ class TrafficStats {
     numPkts.computeAnomalyIndex(t), numBytes.computeAnomalyIndex(t);
   };  
   inline void resetStats()                   { numPkts.reset(), numBytes.reset(); };
+  /* Adds the counters of a restored HostSnapshot */
+  inline void restoreStats(u_int64_t num_pkts, u_int64_t num_bytes) {
+    numPkts.setInitialValue(numPkts.get() + num_pkts), numBytes.setInitialValue(numBytes.get() + num_bytes);
+  };
   inline u_int64_t getNumPkts()      const   { return(numPkts.get());             };
   inline u_int64_t getNumBytes()     const   { return(numBytes.get());            };
   inline u_int64_t getPktsAnomaly()  const   { return(numPkts.getAnomalyIndex()); };
@@ -162,6 +162,8 @@ public:
   static const char * eBPFEvent2EventStr(eBPFEventType event);
 
   static bool str2DetailsLevel(const char *details, DetailsLevel *out);
+  static u_int32_t str2FlowLuaFields(const char *fields);
+  static u_int32_t str2HostLuaFields(const char *fields);
   static u_int32_t roundTime(u_int32_t now, u_int32_t rounder, int32_t offset_from_utc);
   static bool isCriticalNetworkProtocol(u_int16_t protocol_id);
   static u_int32_t stringHash(const char *s);
@@ -23,6 +23,7 @@
 #define _VLAN_ADDRESS_TREE_H_
 
 class AddressTree;
+class CompiledAddressTree;
 
 /*
 typedef struct {
@@ -42,6 +43,7 @@ inline u_int16_t filterVLANid(VLANid id)             { return((u_int16_t)(id & 0
 class VLANAddressTree {
  protected:
   AddressTree **tree;
+  CompiledAddressTree **compiled; /* Only after compile() */
 
  public:
   VLANAddressTree();
@@ -55,6 +57,9 @@ class VLANAddressTree {
   void *findAndGetData(VLANid vlan_id, const IpAddress * const ipa) const;
   bool addVLANAddressAndData(VLANid vlan_id, const char *_what, void *user_data);
 
+  /* To be called once all the addresses are added, before the tree is used */
+  void compile();
+
   inline AddressTree *getAddressTree(VLANid vlan_id) { return tree[vlan_id]; };
 };
 
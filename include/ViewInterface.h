@@ -24,12 +24,59 @@
 
 #include "ntop_includes.h"
 
+class ViewInterface;
+class PartializableFlowTrafficStats;
+struct ViewMergeJob; /* See ViewInterface.cpp */
+
+typedef struct {
+  ViewMergeJob *job; /* NULL to terminate the thread */
+  bool as_client;
+} ViewMergeTask;
+
+typedef struct {
+  ViewInterface *iface;
+  SPSCQueue<ViewMergeTask> *queue;
+  pthread_t thread;
+  u_int64_t num_enqueued;           /* Written by the flowPollLoop only */
+  std::atomic<u_int64_t> num_done;  /* Written by the merge thread only */
+} ViewMergeThread;
+
+typedef struct {
+  u_int64_t num_merged_flows, num_batches;
+  u_int64_t tot_latency_usec;
+  u_int32_t last_latency_usec, max_latency_usec;
+} ViewMergeStats;
+
 class ViewInterface : public NetworkInterface {
  private:
   bool is_packet_interface;
   u_int8_t num_viewed_interfaces;
   NetworkInterface *viewed_interfaces[MAX_NUM_VIEW_INTERFACES];
   SPSCQueue<Flow *> *viewed_interfaces_queues[MAX_NUM_VIEW_INTERFACES];
+  ViewMergeStats merge_stats[MAX_NUM_VIEW_INTERFACES];
+
+  /* Wake-up of the flowPollLoop when the queues are empty */
+  Condvar flows_available;
+  std::atomic<bool> poller_waiting;
+
+  /*
+    Optional threads updating the view hosts, each one owning the hosts
+    with the same hash (see Prefs::getNumViewMergeThreads)
+  */
+  u_int8_t num_merge_threads;
+  ViewMergeThread merge_threads[MAX_NUM_VIEW_MERGE_THREADS];
+  Condvar merge_done;
+  ticks ticks_per_usec;
+
+  void waitForFlows();
+  void startMergeThreads();
+  void stopMergeThreads();
+  void waitMergeThreads();
+  void dispatchMergeJob(ViewMergeJob *job);
+  void updateMergeStats(u_int8_t viewed_interface_id, u_int64_t num_flows, ticks latency);
+  void viewed_host_update(Flow *f, Host *host, Host *peer, bool as_client,
+			  PartializableFlowTrafficStats *partials, bool first_partial,
+			  const struct timeval *tv);
 
   virtual void sumStats(TcpFlowStats *_tcpFlowStats, EthStats *_ethStats,
 			LocalTrafficStats *_localStats, nDPIStats *_ndpiStats,
@@ -63,6 +110,7 @@ class ViewInterface : public NetworkInterface {
   virtual bool isSampledTraffic()   const;
   virtual u_int32_t periodicStatsUpdateFrequency() const;
   void flowPollLoop();
+  void mergeLoop(ViewMergeThread *t);
   void startPacketPolling();
   bool set_packet_filter(char *filter)    { return false ;                        };
 
@@ -31,6 +31,7 @@ class IECInvalidTransition : public FlowCheck {
 				     false /* has_protocol_detected */, false /* has_periodic_update */, false /* has_flow_end */) {};
   ~IECInvalidTransition() {};
   
+  bool needsPacketData() const { return(true); }
   std::string getName() const { return(std::string("iec_invalid_transition")); }
 };
 
@@ -34,6 +34,7 @@ class IECUnexpectedTypeId : public FlowCheck {
   void scriptDisable();
   bool loadConfiguration(json_object *config);
   
+  bool needsPacketData() const { return(true); }
   std::string getName()        const { return(std::string("iec_unexpected_type_id")); }
 };
 
@@ -80,6 +80,8 @@ class nDPIStats {
   char* serialize(NetworkInterface *iface);
   json_object* getJSONObject(NetworkInterface *iface);
   void deserialize(NetworkInterface *iface, json_object *o);
+  void getSnapshot(HostSnapshot *s) const;
+  void restoreSnapshot(const HostSnapshot *s);
   void sum(nDPIStats *s) const;
 
   inline u_int64_t getProtoBytes(u_int16_t proto_id) { 
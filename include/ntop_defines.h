@@ -193,6 +193,12 @@
 #define CONST_DEFAULT_TOP_TALKERS_ENABLED        false
 #define PURGE_FRACTION           60 /* check 1/60 of hashes per iteration */
 #define MIN_NUM_VISITED_ENTRIES  1024
+#define MAX_NUM_EPOCH_READERS    64 /* Max concurrent lock-free hash readers (GenericHash) */
+#define MAX_NUM_EPOCH_ENTRIES    1024 /* Entries walked before a hash walk re-enters the epoch */
+#define PROFILER_NUM_BUCKETS     32 /* log2(cycles) histogram buckets per profiled stage */
+#define PROFILER_DEFAULT_SAMPLING_RATE 64 /* Profile 1 packet out of N */
+#define CHECK_STATS_NUM_BUCKETS  32 /* log2(cycles) histogram buckets per flow/host check */
+#define CHECK_MAX_THROTTLE_RATE  64 /* Checks over budget run on at most 1 entity out of N */
 #define MAX_NUM_QUEUED_ADDRS    500 /* Maximum number of queued address for resolution */
 #define MAX_NUM_QUEUED_CONTACTS 25000
 #define NTOP_COPYRIGHT          "(C) 1998-22 ntop.org"
@@ -457,7 +463,10 @@
 #define CONST_NUM_OPEN_DB_CACHE        8
 #define CONST_NUM_CONTACT_DBS          8
 #define MAX_ZMQ_SUBSCRIBERS           32
-#define MAX_SYSLOG_SUBSCRIBERS         8
+#define MAX_SYSLOG_SUBSCRIBERS         32
+#define SYSLOG_STREAM_BUFFER_SIZE      65536 /* Per TCP connection read buffer */
+#define SYSLOG_NUM_READER_THREADS      4     /* TCP reader threads (epoll) */
+#define SYSLOG_MAX_EPOLL_EVENTS        64
 #define MAX_ZMQ_POLL_WAIT_MS        1000 /* 1 sec */
 #define MAX_ZMQ_POLLS_BEFORE_PURGE  1000
 #define MAX_SYSLOG_POLL_WAIT_MS        MAX_ZMQ_POLL_WAIT_MS
@@ -502,6 +511,7 @@
 #define CONST_DEFAULT_PACKETS_DROP_PERCENTAGE_ALERT       5
 #define CONST_DEFAULT_IS_ACTIVE_LOCAL_HOSTS_CACHE_ENABLED 0
 #define CONST_DEFAULT_ACTIVE_LOCAL_HOSTS_CACHE_INTERVAL   3600 /* Every hour by default */
+#define CONST_DEFAULT_IS_WARM_RESTART_CHECKPOINT_ENABLED  0
 #define HASHKEY_TOP_SITES_SERIALIZATION_KEY               ".serialized_current_top_sites."
 #define HASHKEY_TOP_OS_SERIALIZATION_KEY                  ".serialized_current_top_os."
 #define HASHKEY_LOCAL_HOSTS_TOP_SITES_KEYS                "ntopng.cache.top_sites"
@@ -634,6 +644,10 @@
 #define CONST_PREFS_CLIENT_X509_AUTH        NTOPNG_PREFS_PREFIX".is_client_x509_auth_enabled"
 #define CONST_PREFS_EMIT_FLOW_ALERTS        NTOPNG_PREFS_PREFIX".emit_flow_alerts"
 #define CONST_PREFS_EMIT_HOST_ALERTS        NTOPNG_PREFS_PREFIX".emit_host_alerts"
+#define CONST_PREFS_CHECKS_PROFILING        NTOPNG_PREFS_PREFIX".checks_profiling"
+#define CONST_PREFS_ES_GZIP_REQUESTS        NTOPNG_PREFS_PREFIX".es_gzip_requests"
+#define CONST_PREFS_SYSLOG_NATIVE_PRODUCERS NTOPNG_PREFS_PREFIX".syslog_native_producers"
+#define CONST_PREFS_VIEW_MERGE_THREADS      NTOPNG_PREFS_PREFIX".view_merge_threads"
 
 #define CONST_PREFS_BROADCAST_DOMAIN_TOO_LARGE         NTOPNG_PREFS_PREFIX".is_broadcast_domain_too_large_enabled"
 
@@ -672,6 +686,7 @@
 #define CONST_RUNTIME_IDLE_LOCAL_HOSTS_CACHE_ENABLED   NTOPNG_PREFS_PREFIX".is_local_host_cache_enabled"
 #define CONST_RUNTIME_ACTIVE_LOCAL_HOSTS_CACHE_ENABLED NTOPNG_PREFS_PREFIX".is_active_local_host_cache_enabled"
 #define CONST_RUNTIME_ACTIVE_LOCAL_HOSTS_CACHE_INTERVAL NTOPNG_PREFS_PREFIX".active_local_host_cache_interval"
+#define CONST_RUNTIME_WARM_RESTART_CHECKPOINT_ENABLED  NTOPNG_PREFS_PREFIX".is_warm_restart_checkpoint_enabled"
 #define CONST_RUNTIME_PREFS_LOG_TO_FILE                NTOPNG_PREFS_PREFIX".log_to_file"
 #define CONST_RUNTIME_PREFS_HOUSEKEEPING_FREQ          NTOPNG_PREFS_PREFIX".housekeeping_freq"
 #define CONST_RUNTIME_PREFS_OBSERVATION_POINTS_RRD_CREATION   NTOPNG_PREFS_PREFIX".observation_points_rrd_creation" /* 0 / 1 */
@@ -842,6 +857,10 @@
 #define MYSQL_MAX_NUM_FIELDS  255
 #define MYSQL_MAX_NUM_ROWS    1000
 #define MYSQL_MAX_QUEUE_LEN   2048
+#define MYSQL_BATCH_MAX_ROWS        256  /* Rows per multi-row INSERT transaction */
+#define MYSQL_BATCH_MAX_DELAY_MSEC  500  /* Flush partial batches after this delay */
+#define MYSQL_BATCH_MAX_QUERY_LEN   (512*1024) /* Well below the default max_allowed_packet */
+#define MYSQL_NUM_WRITERS           2    /* Writer threads, each with its own connection */
 
 #ifdef NTOPNG_PRO
 #define MYSQL_TOP_TALKERS_CONSOLIDATION_FREQ 20
@@ -951,6 +970,14 @@
 #define CHECKS_CONFIG                        "ntopng.prefs.checks.configset_v1"  /* Sync with checks.lua CONFIGSET_KEY  */
 #define SYSLOG_SCRIPT_PATH                   "callbacks/system/syslog.lua"
 #define SYSLOG_SCRIPT_CALLBACK_EVENT         "handleEvent"
+#define SYSLOG_SCRIPT_CALLBACK_EVENTS        "handleEvents"
+#define SYSLOG_SCRIPT_PRODUCER_ENABLED       "isProducerEnabled"
+#define SYSLOG_LUA_BATCH_SIZE                64           /* Events per handleEvents() call */
+#define SYSLOG_LUA_BATCH_BUFFER_SIZE         (256*1024)   /* Batched events content */
+#define SYSLOG_LUA_BATCH_MAX_DELAY           1            /* sec */
+#define SYSLOG_MAX_PRODUCERS_STATS           64           /* Producer names are taken from the events */
+#define CATEGORY_DB_FILE_NAME                "category_lists.db" /* Compiled category lists (working dir) */
+#define CATEGORY_LIST_MAX_WARNINGS           10           /* Per list file */
 
 /* GRE (Generic Route Encapsulation) */
 #ifndef IPPROTO_GRE
@@ -1011,7 +1038,11 @@
 #define NTOP_ES7_TEMPLATE             "ntopng_template_elk7.json"
 #define NTOP_ES8_TEMPLATE             "ntopng_template_elk8.json"
 #define ES_MAX_QUEUE_LEN              32768
-#define ES_BULK_BUFFER_SIZE           1*1024*1024
+#define ES_BULK_BUFFER_SIZE           1*1024*1024 /* Max bulk body size */
+#define ES_BULK_MIN_SIZE              64*1024     /* Adaptive bulk sizing lower bound */
+#define ES_BULK_TARGET_LATENCY_MSEC   500         /* Bulks are shrunk above this latency */
+#define ES_MAX_INFLIGHT_REQUESTS      4           /* Concurrent bulk requests */
+#define ES_REQUEST_TIMEOUT            30          /* sec */
 #define ES_BULK_MAX_DELAY             120 /* Dump frequency of ELK flows, in seconds */
 
 /* Logstash */
@@ -1119,6 +1150,41 @@ extern struct ntopngLuaContext* getUserdata(struct lua_State *vm);
 #define DEFAULT_ZMQ_TCP_KEEPALIVE_INTVL 3  /* Keepalive probes sent every 3 seconds */
 
 #define MAX_NUM_ASYNC_SNMP_ENGINES    64
+
+/* Continuous ping (ContinuousPing) */
+#define CONTINUOUS_PING_INTERVAL_MSEC   1000 /* Per target */
+#define CONTINUOUS_PING_TICK_MSEC       4
+#define CONTINUOUS_PING_BATCH_LEN       64   /* Packets per sendmmsg/recvmmsg */
+#define CONTINUOUS_PING_MAX_IDLE        90   /* Targets not refreshed are purged after (sec) */
+#define CONTINUOUS_PING_RTT_BUCKETS     16   /* Log2 msec buckets */
+
+/* Native SNMP poller (SNMPPoller) */
+#define SNMP_POLLER_MAX_INFLIGHT        256  /* Devices walked concurrently */
+#define SNMP_POLLER_MAX_REPETITIONS     10   /* GETBULK rows per column */
+#define SNMP_POLLER_TIMEOUT_MSEC        2000 /* Doubled at every retry */
+#define SNMP_POLLER_MAX_RETRIES         3
+#define SNMP_POLLER_MAX_BACKOFF         8    /* Max poll interval multiplier for unresponsive devices */
+#define SNMP_POLLER_TICK_MSEC           10
+#define SNMP_POLLER_DEFAULT_INTERVAL    300
+#define SNMP_POLLER_DEFAULT_MAX_RPS     20   /* Max requests/sec per device */
+#define SNMP_POLLER_MIN_DEVICE_IDLE     900  /* Devices not refreshed are purged after max(this, 3 poll intervals) sec */
+#define SNMP_POLLER_MAX_PDU_LEN         65536
+
+#define JSON_STREAM_WRITER_BUF_LEN      65536 /* Bytes buffered before writing to the HTTP connection */
+
+/* Field projection of Flow::lua and Host::lua (FlowLuaField, HostLuaField) */
+#define FLOW_LUA_ALL_FIELDS             ((u_int32_t)-1)
+#define HOST_LUA_ALL_FIELDS             ((u_int32_t)-1)
+#define LUA_FIELD(fields, f)            (((fields) & (1 << (f))) != 0)
+
+/* Asynchronous local hosts cache (HostSerializer) */
+#define HOST_SERIALIZER_QUEUE_LEN       8192 /* Per queue: serializations, restore requests, restored */
+#define HOST_SERIALIZER_MAX_RESTORES    1024 /* Restored hosts applied per purgeIdle */
+
+/* Warm restart (InterfaceCheckpoint) */
+#define INTERFACE_CHECKPOINT_FILE       "checkpoint.bin" /* In the interface data dir */
+#define INTERFACE_CHECKPOINT_BUF_LEN    (1024*1024)      /* Write buffer */
+
 #define MIN_NUM_HASH_WALK_ELEMS      512
 
 #define COMPANION_QUEUE_LEN          4096
@@ -1145,16 +1211,22 @@ extern struct ntopngLuaContext* getUserdata(struct lua_State *vm);
  */
 
 #define MAX_VIEW_INTERFACE_QUEUE_LEN      131072
+#define MAX_NUM_VIEW_MERGE_THREADS        8
+#define VIEW_MERGE_QUEUE_LEN              32768
 
 #define CONST_MAX_NUM_THREADED_ACTIVITIES 64
 
 #define DONT_NOT_EXPIRE_BEFORE_SEC        15 /* sec */
 #define MAX_NDPI_IDLE_TIME_BEFORE_GUESS   5 /* sec */
-#define MAX_NUM_PCAP_CAPTURES             4
+#define MAX_NUM_PCAP_CAPTURES             8
+#define LIVE_CAPTURE_RING_SIZE            (4*1024*1024) /* Per capture */
+#define LIVE_CAPTURE_POLL_USEC            1000
+#define LIVE_CAPTURE_DRAIN_TIMEOUT        5 /* sec */
 #define MAX_NUM_COMPANION_INTERFACES      4
 #define MAX_NUM_FINGERPRINT               25
 
 #define MAX_ENTROPY_BYTES                 4096
+#define FLOW_FAST_ACCOUNTING_SAMPLING     64 /* 1 packet out of N of fast accounted flows goes the full path */
 #define MAX_NUM_OBSERVATION_POINTS        256
 
 #define ALERT_ACTION_ENGAGE           "engage"
@@ -98,6 +98,7 @@
 #include <linux/ethtool.h> // ethtool
 #include <linux/sockios.h> // sockios
 #include <ifaddrs.h>
+#include <sys/epoll.h>
 #elif defined(__FreeBSD__) || defined(__APPLE__)
 #include <net/if_dl.h>
 #include <ifaddrs.h>
@@ -189,6 +190,7 @@ https://translate.google.co.uk/translate?sl=auto&tl=en&u=http%3A%2F%2Fbugsfixed.
 #include <string>
 #include <sstream>
 #include <queue>
+#include <memory>
 #include <typeinfo>
 
 using namespace std;
@@ -197,6 +199,7 @@ using namespace std;
 #include "ntop_defines.h"
 #include "Mutex.h"
 #include "RwLock.h"
+#include "EpochManager.h"
 #include "Bitmask.h"
 #include "Bloom.h"
 #include "MonitoredMetric.h"
@@ -204,11 +207,21 @@ using namespace std;
 #include "MonitoredGauge.h"
 #include "MDNS.h"
 #include "AddressTree.h"
+#include "CompiledAddressTree.h"
+#include "CategoryDB.h"
+#include "CategoryDBBuilder.h"
 #include "VLANAddressTree.h"
 #include "BroadcastDomains.h"
 #include "Cardinality.h"
 #include "PeerStats.h"
 #include "IpAddress.h"
+#include "TimerWheel.h"
+#include "JSONStreamWriter.h"
+#include "HostSnapshot.h"
+#include "InterfaceCheckpoint.h"
+#include "TimeseriesCodec.h"
+#include "TimeseriesStore.h"
+#include "TimeseriesTopK.h"
 #include "Ping.h"
 #include "ContinuousPingStats.h"
 #include "ContinuousPing.h"
@@ -229,6 +242,7 @@ using namespace std;
 #include "ProtoStats.h"
 #include "FlowRiskAlerts.h"
 #include "Utils.h"
+#include "PacketProfiler.h"
 #include "Bitmap128.h"
 #include "NtopGlobals.h"
 #include "Alert.h"
@@ -289,6 +303,7 @@ using namespace std;
 #include "SerializableElement.h"
 #include "DnsStats.h"
 #include "SNMP.h"
+#include "SNMPPoller.h"
 #include "NetworkDiscovery.h"
 #include "ICMPstats.h"
 #include "ICMPinfo.h"
@@ -297,6 +312,7 @@ using namespace std;
 #include "EthStats.h"
 #include "RoundTripStats.h"
 #include "SyslogStats.h"
+#include "SyslogStreamFramer.h"
 
 #include "LocalTrafficStats.h"
 #include "PacketDumperGeneric.h"
@@ -328,10 +344,16 @@ using namespace std;
 #include "LuaEngineFunctions.h"
 #include "LuaEngine.h"
 #include "SPSCQueue.h"
+#include "LiveCaptureRing.h"
+#include "SyslogProducer.h"
+#include "SuricataSyslogProducer.h"
+#include "KeyValueSyslogProducer.h"
+#include "CEFSyslogProducer.h"
 #include "SyslogLuaEngine.h"
 #include "FifoQueue.h"
 #include "StringFifoQueue.h"
 #include "AlertFifoQueue.h"
+#include "HostSerializer.h"
 #include "FifoSerializerQueue.h"
 #include "RRDTimeseriesExporter.h"
 #include "RecipientQueue.h"
@@ -53,6 +53,19 @@ typedef enum {
   mask_remote_hosts = 2
 } HostMask;
 
+/* Packet pipeline stages measured by PacketProfiler (keep in sync with PacketProfiler::stageName) */
+typedef enum {
+  profiler_stage_decode = 0,    /* L2/L3/L4 decoding up to the flow lookup */
+  profiler_stage_flow_lookup,   /* getFlow (including flow/host creation) */
+  profiler_stage_flow_update,   /* TCP state and Flow::incStats */
+  profiler_stage_detection,     /* nDPI (Flow::processPacket) */
+  profiler_stage_l7_dissection, /* Protocol metadata dissection after detection */
+  profiler_stage_host_update,   /* Interface counters and inline periodic host updates */
+  profiler_stage_flow_checks,   /* Flow checks (protocol detected, periodic, flow end) */
+  profiler_stage_host_checks,   /* Host checks */
+  profiler_num_stages
+} ProfilerStage;
+
 /* Struct used to pass parameters when walking hosts and flows periodically to update their stats */
 class AlertCheckLuaEngine;
 class ThreadedActivityStats;
@@ -599,6 +612,64 @@ typedef enum {
   details_max,
 } DetailsLevel;
 
+/*
+  Groups of fields pushed by Flow::lua, selected with the comma separated
+  list of names of the paginator "fields" option (see Utils::str2FlowLuaFields).
+  Keep in sync with flow_lua_field_names. Addresses and keys are always pushed.
+*/
+typedef enum {
+  flow_lua_field_hosts = 0,   /* hosts    */
+  flow_lua_field_ports,       /* ports    */
+  flow_lua_field_bytes,       /* bytes    */
+  flow_lua_field_packets,     /* packets  */
+  flow_lua_field_vlan,        /* vlan     */
+  flow_lua_field_as,          /* asn      */
+  flow_lua_field_dscp,        /* dscp     */
+  flow_lua_field_proto,       /* proto    */
+  flow_lua_field_time,        /* time     */
+  flow_lua_field_dir_traffic, /* dir_traffic */
+  flow_lua_field_score,       /* score    */
+  flow_lua_field_icmp,        /* icmp     */
+  flow_lua_field_tcp,         /* tcp      */
+  flow_lua_field_info,        /* info     */
+  flow_lua_field_app,         /* app      */
+  flow_lua_field_verdict,     /* verdict  */
+  flow_lua_field_snmp,        /* snmp     */
+  flow_lua_field_json,        /* json     */
+  flow_lua_field_thpt,        /* thpt     */
+  flow_lua_field_iat,         /* iat      */
+  flow_lua_field_geoloc,      /* geoloc   */
+  flow_lua_field_risk,        /* risk     */
+  flow_lua_field_status,      /* status   */
+  FLOW_LUA_NUM_FIELDS
+} FlowLuaField;
+
+/*
+  Same as FlowLuaField for Host::lua (see Utils::str2HostLuaFields). Keep
+  in sync with host_lua_field_names. Address, VLAN and keys are always pushed.
+*/
+typedef enum {
+  host_lua_field_name = 0,    /* name        */
+  host_lua_field_flags,       /* flags       */
+  host_lua_field_mac,         /* mac         */
+  host_lua_field_alerts,      /* alerts      */
+  host_lua_field_score,       /* score       */
+  host_lua_field_as,          /* asn         */
+  host_lua_field_os,          /* os          */
+  host_lua_field_pool,        /* pool        */
+  host_lua_field_traffic,     /* traffic     */
+  host_lua_field_flows,       /* flows       */
+  host_lua_field_contacts,    /* contacts    */
+  host_lua_field_protocols,   /* protocols   */
+  host_lua_field_time,        /* time        */
+  host_lua_field_fingerprints, /* fingerprints */
+  host_lua_field_geoloc,      /* geoloc      */
+  host_lua_field_info,        /* info        */
+  host_lua_field_services,    /* services    */
+  host_lua_field_network,     /* network     */
+  HOST_LUA_NUM_FIELDS
+} HostLuaField;
+
 typedef enum {
   /* Flows */
   column_client = 0,
@@ -840,6 +911,7 @@ class Host;
 class Flow;
 class ThreadedActivity;
 class ThreadedActivityStats;
+class LiveCaptureRing;
 
 struct ntopngLuaContext {
   char *allowed_ifname, *user, *group, *csrf;
@@ -880,13 +952,8 @@ struct ntopngLuaContext {
     bool pcaphdr_sent;
     bool stopped;
 
-    /* Partial sends */
-    char send_buffer[1600];
-    u_int data_not_yet_sent_len; /* 
-				    Amount of data that was 
-				    not sent mostly due to 
-				    socket buffering 
-				 */
+    /* Filled by the packet thread, sent by the HTTP thread */
+    LiveCaptureRing *ring;
   } live_capture;
 
   /* 
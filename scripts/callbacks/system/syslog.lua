@@ -37,7 +37,37 @@ function handleEvent(name, message, host, priority)
    if(event_handler ~= nil) then
       event_handler(syslog_conf, message, host, priority)
    end
-end 
+end
+
+-- #################################################################
+
+-- Returns true when the events of the producer are handled by an enabled
+-- module: only in this case ntopng is allowed to parse them natively
+function isProducerEnabled(name)
+   local syslog_module = syslog_modules.modules[name]
+
+   if((syslog_module == nil) or (syslog_modules.hooks["handleEvent"][name] == nil)) then
+      return false
+   end
+
+   return(checks.getTargetHookConfig(syslog_conf, syslog_module).enabled == true)
+end
+
+-- #################################################################
+
+-- The function below is called for each batch of received events, passed
+-- as a flat array: name, message, host, priority, name, message, ...
+function handleEvents(events)
+   local hooks = syslog_modules.hooks["handleEvent"]
+
+   for i = 1, #events, 4 do
+      local event_handler = hooks[events[i]]
+
+      if(event_handler ~= nil) then
+         event_handler(syslog_conf, events[i+1], events[i+2], events[i+3])
+      end
+   end
+end
 
 -- #################################################################
 
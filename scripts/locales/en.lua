@@ -708,6 +708,7 @@ local lang = {
     ["attack_mitigation_via_snmp_success"] = "Interface <a href=\"%{port_url}\">%{port}</a> admin status on SNMP device <a href=\"%{url}\">%{device}</a> set to %{admin_down}: %{granularity} <b>%{metric}</b> crossed by %{entity} [%{value} %{op} %{threshold}]",
     ["broadcast_domain_info"] = "It is unlikely to see ARP traffic between those IPs as they are seemingly belonging to different broadcast domains. Check for hosts and networks configurations.",
     ["broadcast_domain_too_large"] = "ARP traffic from <a href=\"%{src_mac_url}\">%{src_mac}</a>/<a href=\"%{spa_url}\">%{spa}</a> to <a href=\"%{dst_mac_url}\">%{dst_mac}</a>/<a href=\"%{tpa_url}\">%{tpa}</a> detected.",
+    ["check_cpu_budget_exceeded"] = "%{check_type} check \"%{check}\" exceeded its CPU budget [%{usage} usec/sec &gt; %{budget} usec/sec]. The check is now executed on 1 out of %{throttle_rate} entities.",
     ["contacted_peers"] = "Too many Peers contacted by %{host} %{host_category}. As a client: [%{value_cli} > %{dyn_threshold_cli}]. As a server: [%{value_srv} > %{dyn_threshold_srv}].",
     ["contacted_peers_as_cli"] = "Too many Peers contacted as a client by %{host} %{host_category} [%{value_cli} > %{dyn_threshold_cli}].",
     ["contacted_peers_as_srv"] = "Too many Peers contacted as a server by %{host} %{host_category} [%{value_srv} > %{dyn_threshold_srv}].",
@@ -842,6 +843,8 @@ local lang = {
     ["blacklisted_flow"] = "Blacklisted Flow",
     ["blocked_flow"] = "Flow Risk",
     ["broadcast_domain_too_large"] = "Broadcast domain",
+    ["check_cpu_budget_exceeded"] = "Check CPU Budget Exceeded",
+    ["check_cpu_budget_exceeded_descr"] = "Trigger an alert when a flow or host check exceeds its configured CPU budget and gets throttled.",
     ["checks_calls_drops"] = "Checks Calls Dropped",
     ["clickhouse_monitor"] = "ClickHouse monitor",
     ["clickhouse_monitor_description"] = "Monitor the ClickHouse health",
@@ -4068,6 +4071,8 @@ local lang = {
     ["periodic_activity_issues"] = "Issues",
     ["periodicity"] = "Periodicity",
     ["queue"] = "Queue",
+    ["queue_fill"] = "Fill",
+    ["queue_merge_latency"] = "Merge Latency (avg / max)",
     ["queued"] = "Queued",
     ["queues"] = "Queues",
     ["rrd_drops"] = "TS Drops",
@@ -5318,6 +5323,8 @@ local lang = {
     ["toggle_emit_host_alerts_title"] = "Emit Host Alerts",
     ["toggle_enable_runtime_flows_dump_description"] = "Toggle the dump of flows towards the configured database.",
     ["toggle_enable_runtime_flows_dump_title"] = "Flows Dump",
+    ["toggle_es_gzip_requests_description"] = "Compress with gzip the bulk requests sent to Elasticsearch. This reduces the exported traffic at the cost of some CPU. Changes take effect after a restart.",
+    ["toggle_es_gzip_requests_title"] = "Elasticsearch Gzip Requests",
     ["toggle_flow_rrds_description"] = "Toggle the creation of bytes timeseries for each port of the remote device as received through ZMQ (e.g. sFlow/NetFlow/SNMP).<br>For non sFlow probes, %%INPUT_SNMP and %%OUTPUT_SNMP must appear into the nprobe template.",
     ["toggle_flow_rrds_title"] = "Flow Probes",
     ["toggle_host_mask_description"] = "For privacy reasons it might be necessary to mask hosts IP addresses. For instance if you are an ISP you are not supposed to know which local addresses are accessing remote hosts.",
@@ -5409,10 +5416,14 @@ local lang = {
     ["toggle_top_sites_title"] = "Top Visited Sites",
     ["toggle_traffic_rrd_creation_description"] = "Toggle the creation of bytes and packets timeseries.",
     ["toggle_traffic_rrd_creation_title"] = "Traffic",
+    ["toggle_ts_topk_summaries_description"] = "Keep in memory a summary of the top series of the large groups (e.g. the top local hosts of an interface), so that the top items charts do not need to read all the timeseries. Summaries are not saved across restarts and add some work to every timeseries update. When the top items can only be estimated, they are still read from the timeseries database.",
+    ["toggle_ts_topk_summaries_title"] = "Top Items Summaries",
     ["toggle_users_rrds_description"] = "Toggle the creation of bytes and applications timeseries for defined users.",
     ["toggle_users_rrds_title"] = "Users",
     ["toggle_vlan_rrds_description"] = "Toggle the creation of bytes and applications timeseries for VLANs.",
     ["toggle_vlan_rrds_title"] = "VLANs",
+    ["toggle_warm_restart_checkpoint_enabled_description"] = "Toggle the checkpoint of hosts, MACs, ASes, networks and interface counters written on shutdown and loaded on the next startup, so that a restart (e.g. for an upgrade) does not reset them. Checkpoints older than the local hosts cache duration are ignored.",
+    ["toggle_warm_restart_checkpoint_enabled_title"] = "Warm Restart",
     ["toggle_webhook_notification_description"] = "Toggle alerts notifications via webhook (HTTP).",
     ["toggle_webhook_notification_title"] = "Toggle Webhook Notification",
     ["topk_heuristic_precision_description"] = "Use an heuristic when aggregating historical top hosts, countries, etc, to build traffic reports. Useful when building reports over long-periods.",
@@ -5613,6 +5624,9 @@ local lang = {
     ["back_scripts_page"] = "Back to Scripts",
     ["blacklisted_country"] = "Please write country code values separated by comma. (i.e.: IT,FR,DE,UK)",
     ["config"] = "Config",
+    ["cpu_budget"] = "CPU Budget",
+    ["cpu_budget_descr"] = "CPU time per second the check can use across all the interfaces. When exceeded, the check is executed on a fraction of the entities only. Leave empty for no limit.",
+    ["cpu_budget_unit"] = "usec/sec",
     ["exclusion_list"] = "Comma separated list of IP addresses. This alert won't be triggered for hosts inside this list.",
     ["exclusion_list_title"] = "Excluded Hosts",
     ["filter_dropdown"] = "Filter Categories",
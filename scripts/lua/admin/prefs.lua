@@ -940,6 +940,12 @@ function printInMemory()
   prefsInputFieldPrefs(subpage_active.entries["active_local_host_cache_interval"].title, subpage_active.entries["active_local_host_cache_interval"].description,
     "ntopng.prefs.", "active_local_host_cache_interval", prefs.active_local_host_cache_interval or 3600, "number", showActiveLocalHostCacheInterval, nil, nil, {min=60, tformat="mhd"})
 
+  prefsToggleButton(subpage_active, {
+    field = "toggle_warm_restart_checkpoint_enabled",
+    default = "0",
+    pref = "is_warm_restart_checkpoint_enabled",
+  })
+
   print('</table>')
 
   print('<table class="table">')
@@ -1027,9 +1033,17 @@ function printStatsTimeseries()
       {input="influx_password", parent="input-toggle_influx_auth", parent_enabled_value="1", pref_enabled_value="influxdb"},
     }
 
+    local driver_labels, driver_values = {"RRD", "InfluxDB 1.x"}, {"rrd", "influxdb" }
+
+    if ntop.ts_append ~= nil then
+      -- The native store is not available on all the platforms
+      driver_labels[#driver_labels + 1] = "Native"
+      driver_values[#driver_values + 1] = "native"
+    end
+
     multipleTableButtonPrefs(subpage_active.entries["multiple_timeseries_database"].title,
 				    subpage_active.entries["multiple_timeseries_database"].description,
-				    {"RRD", "InfluxDB 1.x"}, {"rrd", "influxdb" },
+				    driver_labels, driver_values,
 				    "rrd",
 				    "primary",
 				    "timeseries_driver",
@@ -1094,6 +1108,14 @@ function printStatsTimeseries()
   prefsInputFieldPrefs(subpage_active.entries["influxdb_query_timeout"].title, subpage_active.entries["influxdb_query_timeout"].description,
             "ntopng.prefs.", "influx_query_timeout", "10", "number", influx_active, nil, nil, {min=1})
 
+  if ntop.ts_topk_update ~= nil then
+    prefsToggleButton(subpage_active, {
+      field = "toggle_ts_topk_summaries",
+      default = "0",
+      pref = "ts_topk_summaries",
+    })
+  end
+
   print('<thead class="table-primary"><tr><th colspan=2 class="info">'..i18n('prefs.interfaces_timeseries')..'</th></tr></thead>')
 
   -- TODO: make also per-category interface RRDs
@@ -1414,6 +1436,13 @@ function printDumpSettings()
 			showAllElements and prefs.is_dump_flows_to_es_enabled,
 			false, nil, {min=1, max=2^32-1, tformat="sm"})
 
+   prefsToggleButton(subpage_active, {
+			field = "toggle_es_gzip_requests",
+			default = "0",
+			pref = "es_gzip_requests",
+			hidden = not prefs.is_dump_flows_to_es_enabled,
+   })
+
    prefsToggleButton(subpage_active, {
 			field = "toggle_tiny_flows_dump",
 			default = "1",
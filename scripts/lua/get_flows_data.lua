@@ -34,6 +34,9 @@ local flows_to_update = _GET["custom_hosts"]
 -- Get from redis the throughput type bps or pps
 local throughput_type = getThroughputType()
 local flows_filter = getFlowsFilter()
+
+-- Only the fields rendered by the flows table (see FlowLuaField)
+flows_filter["fields"] = flows_filter["fields"] or "hosts,ports,bytes,vlan,proto,time,dir_traffic,score,icmp,tcp,info,app,verdict,snmp,json,thpt,status"
 local flows_stats
 local total = 0
 
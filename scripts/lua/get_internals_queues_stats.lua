@@ -92,6 +92,8 @@ for k, queuestats in pairs(ifaces_queues_stats) do
 
    if(sortColumn == "column_num_failed_enqueues") then
       sort_to_key[k] = stats.num_failed_enqueues
+   elseif(sortColumn == "column_fill") then
+      sort_to_key[k] = ternary((stats.size or 0) > 0, (stats.num_pending or 0) / (stats.size or 1), 0)
    elseif(sortColumn == "column_name") then
       sort_to_key[k] = getHumanReadableInterfaceName(getInterfaceName(queuestats.ifid))
    elseif(sortColumn == "column_queue_name") then
@@ -131,6 +133,17 @@ for key, _ in pairsByValues(sort_to_key, sOrder) do
       record["column_key"] = key
       record["column_ifid"] = string.format("%i", queuestats.ifid)
       record["column_num_failed_enqueues"] = ternary(queuestats.stats.num_failed_enqueues > 0, format_utils.formatValue(queuestats.stats.num_failed_enqueues), '')
+
+      if (queuestats.stats.size or 0) > 0 then
+	 record["column_fill"] = format_utils.round(queuestats.stats.num_pending * 100 / queuestats.stats.size, 1) .. " %"
+      end
+
+      -- View interfaces only
+      if queuestats.stats.avg_merge_latency_usec then
+	 record["column_merge_latency"] = string.format("%s / %s",
+							format_utils.msToTime(queuestats.stats.avg_merge_latency_usec / 1000),
+							format_utils.msToTime(queuestats.stats.max_merge_latency_usec / 1000))
+      end
       record["column_name"] = getHumanReadableInterfaceName(getInterfaceName(queuestats.ifid))
 
       local queue_name = string.format("<span id='%s' title='%s'>%s</span>", key, queuedescr, queuelabel)
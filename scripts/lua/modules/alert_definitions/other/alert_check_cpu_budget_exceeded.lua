@@ -0,0 +1,71 @@
+--
+-- (C) 2019-22 - ntop.org
+--
+
+-- ##############################################
+
+local other_alert_keys = require "other_alert_keys"
+
+-- Import the classes library.
+local classes = require "classes"
+-- Make sure to import the Superclass!
+local alert = require "alert"
+local alert_entities = require "alert_entities"
+
+-- ##############################################
+
+local alert_check_cpu_budget_exceeded = classes.class(alert)
+
+-- ##############################################
+
+alert_check_cpu_budget_exceeded.meta = {
+  alert_key = other_alert_keys.alert_check_cpu_budget_exceeded,
+  i18n_title = "alerts_dashboard.check_cpu_budget_exceeded",
+  icon = "fas fa-fw fa-tachometer-alt",
+  entities = {
+    alert_entities.system
+  },
+}
+
+-- ##############################################
+
+-- @brief Prepare an alert table used to generate the alert
+-- @param check_type Either "flow" or "host"
+-- @param check The name of the check
+-- @param usage The CPU used by the check during the last second, in usec
+-- @param budget The configured CPU budget, in usec per second
+-- @param throttle_rate The check runs on 1 out of throttle_rate entities
+-- @return A table with the alert built
+function alert_check_cpu_budget_exceeded:init(check_type, check, usage, budget, throttle_rate)
+   -- Call the parent constructor
+   self.super:init()
+
+   self.alert_type_params = {
+      check_type = check_type,
+      check = check,
+      usage = usage,
+      budget = budget,
+      throttle_rate = throttle_rate,
+   }
+end
+
+-- #######################################################
+
+-- @brief Format an alert into a human-readable string
+-- @param ifid The integer interface id of the generated alert
+-- @param alert The alert description table, including alert data such as the generating entity, timestamp, granularity, type
+-- @param alert_type_params Table `alert_type_params` as built in the `:init` method
+-- @return A human-readable string
+function alert_check_cpu_budget_exceeded.format(ifid, alert, alert_type_params)
+  return(i18n("alert_messages.check_cpu_budget_exceeded", {
+    check_type = ternary(alert_type_params.check_type == "host", i18n("alert_entities.host"), i18n("flow")),
+    check = alert_type_params.check,
+    usage = alert_type_params.usage,
+    budget = alert_type_params.budget,
+    throttle_rate = alert_type_params.throttle_rate,
+  }))
+end
+
+-- #######################################################
+
+return alert_check_cpu_budget_exceeded
@@ -92,6 +92,7 @@ local other_alert_keys = {
    alert_dhcp_storm                     =  OTHER_BASE_KEY + 79,
    alert_snmp_interface_errors          =  OTHER_BASE_KEY + 80,
    alert_snmp_device_traffic_change    =  OTHER_BASE_KEY + 81,
+   alert_check_cpu_budget_exceeded      =  OTHER_BASE_KEY + 82,
 }
 
 -- ##############################################
@@ -0,0 +1,66 @@
+--
+-- (C) 2019-22 - ntop.org
+--
+
+local alert_consts = require("alert_consts")
+local alerts_api = require("alerts_api")
+local checks = require("checks")
+
+local script
+
+-- #################################################################
+
+local function check_budget(params, check_type, checks_stats)
+   for check_name, check in pairs(checks_stats or {}) do
+      local stats = check.stats
+
+      if stats and stats.cpu_budget_usec then
+         local delta = alerts_api.interface_delta_val(script.key..check_type..check_name --[[ metric name --]], params.granularity, stats.num_budget_exceeded or 0)
+
+         local alert = alert_consts.alert_types.alert_check_cpu_budget_exceeded.new(
+            check_type,
+            check_name,
+            stats.cpu_usage_usec,
+            stats.cpu_budget_usec,
+            stats.throttle_rate
+         )
+
+         alert:set_score_warning()
+         alert:set_granularity(params.granularity)
+         alert:set_subtype(check_type.."_"..check_name)
+
+         if delta > 0 or (stats.throttle_rate or 1) > 1 then
+            alert:trigger(params.alert_entity, nil, params.cur_alerts)
+         else
+            alert:release(params.alert_entity, nil, params.cur_alerts)
+         end
+      end
+   end
+end
+
+-- #################################################################
+
+local function check_cpu_budget(params)
+   check_budget(params, "flow", ntop.getFlowChecksStats())
+   check_budget(params, "host", ntop.getHostChecksStats())
+end
+
+-- #################################################################
+
+script = {
+   -- Script category
+   category = checks.check_categories.internals,
+
+   hooks = {
+      min = check_cpu_budget,
+   },
+
+   gui = {
+      i18n_title = "alerts_dashboard.check_cpu_budget_exceeded",
+      i18n_description = "alerts_dashboard.check_cpu_budget_exceeded_descr",
+   }
+}
+
+-- #################################################################
+
+return script
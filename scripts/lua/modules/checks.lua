@@ -1130,6 +1130,18 @@ function checks.updateScriptConfig(script_key, subdir, new_config)
 	    return false, "Missing 'script_conf' item"
 	 end
 
+	 -- Optional CPU usec per second of the flow and host checks (see ChecksLoader::getCpuBudget)
+	 if(conf.cpu_budget_usec ~= nil) then
+	    local cpu_budget = tonumber(conf.cpu_budget_usec)
+
+	    if((cpu_budget == nil) or (cpu_budget < 0) or (cpu_budget > 1000000) or (cpu_budget ~= math.floor(cpu_budget))) then
+	       return false, "Bad 'cpu_budget_usec' item: expected an integer between 0 and 1000000"
+	    end
+
+	    -- 0 = no budget
+	    conf.cpu_budget_usec = ternary(cpu_budget > 0, cpu_budget, nil)
+	 end
+
 	 if conf.enabled then
 	    valid, rv_or_err = script.template:parseConfig(conf.script_conf)
 	 else
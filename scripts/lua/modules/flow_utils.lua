@@ -147,6 +147,7 @@ function getFlowsFilter()
    local asn          = _GET["asn"]
    local tcp_state    = _GET["tcp_flow_state"]
    local talking_with = _GET["talking_with"]
+   local fields       = _GET["fields"] -- e.g. bytes,proto,thpt (see FlowLuaField)
 
    if sortColumn == nil or sortColumn == "column_" or sortColumn == "" then
       sortColumn = getDefaultTableSort("flows")
@@ -214,6 +215,10 @@ function getFlowsFilter()
       pageinfo["trafficProfileFilter"] = traffic_profile
    end
 
+   if not isEmptyString(fields) then
+      pageinfo["fields"] = fields
+   end
+
    if not isEmptyString(flowhosts_type) then
       if flowhosts_type == "local_origin_remote_target" then
 	 pageinfo["clientMode"] = "local"
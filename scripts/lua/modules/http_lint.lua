@@ -1822,6 +1822,7 @@ local known_parameters = {
    ["toggle_data_exfiltration"]                    = validateBool,
    ["toggle_enable_runtime_flows_dump"]            = validateBool,
    ["toggle_tiny_flows_dump"]                      = validateBool,
+   ["toggle_es_gzip_requests"]                     = validateBool,
    ["toggle_alert_syslog"]                         = validateBool,
    ["toggle_slack_notification"]                   = validateBool,
    ["toggle_email_notification"]                   = validateBool,
@@ -1835,6 +1836,7 @@ local known_parameters = {
    ["toggle_local"]                                = validateBool,
    ["toggle_local_host_cache_enabled"]             = validateBool,
    ["toggle_active_local_host_cache_enabled"]      = validateBool,
+   ["toggle_warm_restart_checkpoint_enabled"]      = validateBool,
    ["toggle_network_discovery"]                    = validateBool,
    ["toggle_interface_traffic_rrd_creation"]       = validateBool,
    ["toggle_local_hosts_traffic_rrd_creation"]     = validateBool,
@@ -1870,6 +1872,7 @@ local known_parameters = {
    ["toggle_quota_exceeded_alert"]                 = validateBool,
    ["toggle_external_alerts"]                      = validateBool,
    ["toggle_influx_auth"]                          = validateBool,
+   ["toggle_ts_topk_summaries"]                    = validateBool,
    ["toggle_ldap_auth"]                            = validateBool,
    ["toggle_local_auth"]                           = validateBool,
    ["toggle_radius_auth"]                          = validateBool,
@@ -1959,7 +1962,7 @@ local known_parameters = {
    ["toggle_theme"]                                = validateChoiceInline({"default", "light", "dark"}),
    ["toggle_host_mask"]                            = validateChoiceInline({"0", "1", "2"}),
    ["topk_heuristic_precision"]                    = validateChoiceInline({"disabled", "more_accurate", "accurate", "aggressive"}),
-   ["timeseries_driver"]                           = validateChoiceInline({"rrd", "influxdb", "prometheus"}),
+   ["timeseries_driver"]                           = validateChoiceInline({"rrd", "influxdb", "prometheus", "native"}),
    ["edition"]                                     = validateEmptyOr(validateChoiceInline({"community", "pro", "enterprise", "enterprise_m", "enterprise_l"})),
    ["hosts_ts_creation"]                           = validateChoiceInline({"off", "light", "full"}),
    ["ts_high_resolution"]                          = validateNumber,
@@ -2051,6 +2054,8 @@ local known_parameters = {
    ["edit_pools"]              = validateEmpty,                 -- host_pools.lua, set if pools are being edited
    ["member_to_delete"]        = validateMemberRelaxed,         -- host_pools.lua, member to delete from pool
    ["sampling_rate"]           = validateEmptyOr(validateNumber),            -- if_stats.lua
+   ["enabled"]                 = validateBool,                  -- rest/v2/set/interface/profiler.lua
+   ["reset"]                   = validateBool,                  -- rest/v2/set/interface/profiler.lua
    ["resetstats_mode"]         = validateResetStatsMode,        -- reset_stats.lua
    ["snmp_action"]             = validateSnmpAction,            -- snmp specific
    ["snmp_status"]             = validateSNMPstatus,            -- snmp specific status (up: 1, down: 2, testing: 3)
@@ -2153,6 +2158,7 @@ local known_parameters = {
    ["action"]                  = validateSingleWord, -- generic
    ["table"]                   = validateSingleWord,
    ["columns"]                 = validateListOfTypeInline(validateNumber),
+   ["fields"]                  = validateListOfTypeInline(validateSingleWord), -- Flow/host Lua fields projection, e.g. bytes,proto,thpt
    ["ts_schema"]               = validateSingleWord,
    ["ts_query"]                = validateListOfTypeInline(validateUnquoted),
    ["ts_compare"]              = validateZoom,
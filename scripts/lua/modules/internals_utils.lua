@@ -175,6 +175,22 @@ $("#table-queues-stats").datatable({
 	 textAlign: 'left',
 	 width: '10%',
        }
+     }, {
+       title: "]] print(i18n("internals.queue_fill")) print[[",
+       field: "column_fill",
+       sortable: true,
+       css: {
+	 textAlign: 'right',
+	 width: '5%',
+       }
+     }, {
+       title: "]] print(i18n("internals.queue_merge_latency")) print[[",
+       field: "column_merge_latency",
+       sortable: false,
+       css: {
+	 textAlign: 'right',
+	 width: '5%',
+       }
      }, {
        title: "]] print(i18n("internals.num_failed_enqueues")) print[[",
        field: "column_num_failed_enqueues",
@@ -518,26 +518,6 @@ end
 
 -- ##############################################
 
-local function parse_hosts_line(line)
-   local words = string.split(line, "%s+")
-   local host = nil
-
-   if(words and (#words == 2)) then
-      host = words[2]
-
-      if((host == "localhost") or (host == "127.0.0.1") or (host == "::1")) then
-         host = nil
-      end
-   else
-      -- invalid host
-      host = nil
-   end
-
-   return(host)
-end
-
--- ##############################################
-
 local function handle_ja3_suricata_csv_line(line)
    local parts = string.split(line, ",")
 
@@ -581,11 +561,12 @@ local function loadFromListFile(list_name, list, user_custom_categories, stats)
       end
 
    else
+      -- The file is parsed natively, once for all the interfaces. Whitelisted
+      -- hosts were passed with ntop.excludeCustomCategoryHost()
+      local res = ntop.loadCategoryListFile(list_fname, tonumber(list.category), list_name, list.format,
+                                            MAX_TOTAL_IP_RULES - stats.num_ips, MAX_TOTAL_DOMAIN_RULES - stats.num_hosts)
 
-      local f = io.open(list_fname, "r")
-      local num_line = 0
-
-      if f == nil then
+      if res == nil then
          if list.status.num_hosts > 0 then
             -- Avoid generating warnings during first startup
             traceError(TRACE_WARNING, TRACE_CONSOLE, string.format("Could not find '%s'...", list_fname))
@@ -594,42 +575,10 @@ local function loadFromListFile(list_name, list, user_custom_categories, stats)
          return(false)
       end
 
-      for line in f:lines() do
-                num_line = num_line + 1
-         if ntop.isShutdown() then
-            break
-         end
-         local trimmed = line:match("^%s*(.-)%s*$")
-
-         if((string.len(trimmed) > 0) and not(string.starts(trimmed, "#"))) then
-            local host = trimmed
-
-            if list.format == "hosts" then
-               host = parse_hosts_line(trimmed)
-            end
-
-            if host then
-               local rv = loadListItem(host, list.category, user_custom_categories, list, num_line)
-
-               if(rv == "domain") then
-                  stats.num_hosts = stats.num_hosts + 1
-                  num_rules = num_rules + 1
-               elseif(rv == "ip") then
-                  stats.num_ips = stats.num_ips + 1
-                  num_rules = num_rules + 1
-               end
-            end
-
-            if((stats.num_ips >= MAX_TOTAL_IP_RULES) or
-                  (stats.num_hosts >= MAX_TOTAL_DOMAIN_RULES) or
-                  (stats.num_ja3 >= MAX_TOTAL_JA3_RULES)) then
-               limit_exceeded = true
-               break
-            end
-         end
-      end
-
-      f:close()
+      stats.num_hosts = stats.num_hosts + res.num_hosts
+      stats.num_ips = stats.num_ips + res.num_ips
+      num_rules = num_rules + res.num_hosts + res.num_ips
+      limit_exceeded = res.limit_reached
    end
 
    list.status.num_hosts = num_rules
@@ -660,6 +609,15 @@ local function reloadListsNow()
 
    traceError(trace_level, TRACE_CONSOLE, string.format("custom categories: reloading now"))
 
+   -- Whitelisted hosts (Format: !<host>) must be known before loading the lists
+   for category_id, hosts in pairs(user_custom_categories) do
+      for _, host in ipairs(hosts) do
+         if string.sub(host, 1, 1) == "!" then
+            ntop.excludeCustomCategoryHost(string.sub(host, 2), tonumber(category_id))
+         end
+      end
+   end
+
    -- Load hosts from cached URL lists
    for list_name, list in pairsByKeys(lists) do
       if list.enabled then
@@ -711,6 +669,14 @@ local function reloadListsNow()
    -- Calculate stats
    stats.duration = (os.time() - stats.begin)
 
+   local db_stats = ntop.getCategoryDBStats()
+
+   if db_stats then
+      -- Single copy shared by all the interfaces
+      stats.memory = db_stats.memory
+      stats.build_msec = db_stats.build_msec
+   end
+
    traceError(TRACE_NORMAL, TRACE_CONSOLE,
               string.format("Category Lists (%u hosts, %u IPs, %u JA3) loaded in %d sec",
                             stats.num_hosts, stats.num_ips, stats.num_ja3, stats.duration))
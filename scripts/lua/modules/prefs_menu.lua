@@ -132,6 +132,9 @@ local menu_subpages = {
     }, toggle_active_local_host_cache_enabled = {
       title       = i18n("prefs.toggle_active_local_host_cache_enabled_title"),
       description = i18n("prefs.toggle_active_local_host_cache_enabled_description"),
+    }, toggle_warm_restart_checkpoint_enabled = {
+      title       = i18n("prefs.toggle_warm_restart_checkpoint_enabled_title"),
+      description = i18n("prefs.toggle_warm_restart_checkpoint_enabled_description"),
     }, active_local_host_cache_interval = {
       title       = i18n("prefs.active_local_host_cache_interval_title"),
       description = i18n("prefs.active_local_host_cache_interval_description"),
@@ -146,6 +149,9 @@ local menu_subpages = {
     }, dump_frequency = {
       title       = i18n("prefs.dump_frequency_title"),
       description = i18n("prefs.dump_frequency_description"),
+    }, toggle_es_gzip_requests = {
+      title       = i18n("prefs.toggle_es_gzip_requests_title"),
+      description = i18n("prefs.toggle_es_gzip_requests_description"),
     }, toggle_tiny_flows_dump = {
       title       = i18n("prefs.toggle_tiny_flows_dump_title"),
       description = i18n("prefs.toggle_tiny_flows_dump_description"),
@@ -230,6 +236,9 @@ local menu_subpages = {
     }, influxdb_query_timeout = {
       title       = i18n("prefs.influxdb_query_timeout_title"),
       description = i18n("prefs.influxdb_query_timeout_description"),
+    }, toggle_ts_topk_summaries = {
+      title       = i18n("prefs.toggle_ts_topk_summaries_title"),
+      description = i18n("prefs.toggle_ts_topk_summaries_description"),
     }
   }}, {id="alerts",        label=i18n("show_alerts.alerts"),               advanced=false, pro_only=false,  hidden=(prefs.has_cmdl_disable_alerts == true), entries={
     disable_alerts_generation = {
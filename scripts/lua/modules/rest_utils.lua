@@ -128,6 +128,28 @@ function rest_utils.answer(ret_const, payload, extra_headers)
    print(rest_utils.rc(ret_const, payload))
 end
 
+-- Same as answer() but the payload is written by streamer() straight to the
+-- connection (e.g. interface.streamFlowsInfo) instead of being encoded here.
+-- streamer() returns nil when nothing has been written.
+function rest_utils.stream_answer(ret_const, streamer, extra_headers)
+   local envelope = json.encode({
+      rc = ret_const.rc,
+      rc_str = ret_const.str,
+      rc_str_hr = i18n("rest_consts."..ret_const.str) or "Unknown",
+   })
+
+   sendHTTPHeader('application/json', nil, extra_headers, ret_const.http_code)
+
+   -- Open the envelope, rsp is the last member
+   print(string.sub(envelope, 1, -2)..',"rsp":')
+
+   if(streamer() == nil) then
+      print('null')
+   end
+
+   print('}')
+end
+
 function rest_utils.extended_answer(ret_const, payload, additional_response_param, extra_headers, format)
    local rsp_format = 'application/json'
 
@@ -0,0 +1,283 @@
+--
+-- (C) 2022 - ntop.org
+--
+-- Driver for the timeseries store embedded in ntopng (TimeseriesStore).
+-- Series are identified by a key made of the schema tags, in the schema
+-- order: "ifid=0,host=192.168.1.1". Points are stored in compressed chunks
+-- and rolled up to hourly and daily resolutions in background.
+--
+
+local driver = {}
+
+local ts_common = require("ts_common")
+local data_retention_utils = require "data_retention_utils"
+
+-- ##############################################
+
+function driver:new(options)
+   local obj = {}
+
+   setmetatable(obj, self)
+   self.__index = self
+
+   return obj
+end
+
+-- ##############################################
+
+function driver:getLatestTimestamp(ifid)
+   return os.time()
+end
+
+-- ##############################################
+
+local function isCounter(schema)
+   return(schema.options.metrics_type == ts_common.metrics.counter)
+end
+
+-- ##############################################
+
+-- Builds the key (or the filter, when tags only has some of the schema tags)
+local function tagsToKey(schema, tags)
+   local parts = {}
+
+   for _, tag in ipairs(schema._tags) do
+      if tags[tag] ~= nil then
+	 parts[#parts + 1] = tag .. "=" .. tags[tag]
+      end
+   end
+
+   return table.concat(parts, ",")
+end
+
+-- ##############################################
+
+local function keyToTags(key)
+   local tags = {}
+
+   for pair in string.gmatch(key, "[^,]+") do
+      local k, v = string.match(pair, "^([^=]+)=(.*)$")
+
+      if k then
+	 tags[k] = v
+      end
+   end
+
+   return tags
+end
+
+-- ##############################################
+
+-- Tag filter for the schemas without a fixed tags order (delete)
+local function tagsToFilter(tags)
+   local parts = {}
+
+   for k, v in pairsByKeys(tags, asc) do
+      parts[#parts + 1] = k .. "=" .. v
+   end
+
+   return table.concat(parts, ",")
+end
+
+-- ##############################################
+
+function driver:append(schema, timestamp, tags, metrics)
+   local values = {}
+
+   for i, name in ipairs(schema._metrics) do
+      values[i] = tonumber(metrics[name]) or 0
+   end
+
+   return ntop.ts_append(schema.name, schema.options.step, isCounter(schema),
+			 tagsToKey(schema, tags), timestamp, values)
+end
+
+-- ##############################################
+
+local function makeTotalSerie(series, count)
+   local total = {}
+
+   for i = 1, count do
+      total[i] = 0
+   end
+
+   for _, serie in pairs(series) do
+      for i, val in pairs(serie.data) do
+	 if val == val then
+	    total[i] = total[i] + val
+	 end
+      end
+   end
+
+   return total
+end
+
+-- ##############################################
+
+function driver:query(schema, tstart, tend, tags, options)
+   local query_start = tstart
+
+   if options.initial_point then
+      query_start = tstart - schema.options.step
+   end
+
+   local res = ntop.ts_query(schema.name, tagsToKey(schema, tags), query_start, tend, options.max_num_points)
+
+   if (res == nil) or (res.num_series == 0) then
+      return nil
+   end
+
+   local series = {}
+
+   for i, name in ipairs(schema._metrics) do
+      local max_val = ts_common.getMaxPointValue(schema, name, tags)
+      local data = res.series[i] or {}
+
+      for j = 1, res.count do
+	 data[j] = ts_common.normalizeVal(data[j], max_val, options)
+      end
+
+      series[i] = {label = name, data = data}
+   end
+
+   local total_serie = nil
+   local stats = nil
+
+   if options.calculate_stats then
+      total_serie = makeTotalSerie(series, res.count)
+      stats = ts_common.calculateStatistics(total_serie, res.step, tend - tstart, schema.options.metrics_type) or {}
+      stats.by_serie = {}
+
+      for k, v in pairs(series) do
+	 local s = ts_common.calculateStatistics(v.data, res.step, tend - tstart, schema.options.metrics_type)
+	 stats.by_serie[k] = table.merge(s, ts_common.calculateMinMax(v.data))
+      end
+
+      stats = table.merge(stats, ts_common.calculateMinMax(total_serie))
+   end
+
+   return {
+      start = res.start,
+      step = res.step,
+      count = res.count,
+      series = series,
+      statistics = stats,
+      additional_series = {
+	 total = total_serie,
+      },
+   }
+end
+
+-- ##############################################
+
+function driver:listSeries(schema, tags_filter, wildcard_tags, start_time)
+   local keys = ntop.ts_list_series(schema.name, tagsToKey(schema, tags_filter), start_time)
+
+   if (keys == nil) or (#keys == 0) then
+      return nil
+   end
+
+   local res = {}
+
+   for _, key in ipairs(keys) do
+      res[#res + 1] = keyToTags(key)
+   end
+
+   return res
+end
+
+-- ##############################################
+
+function driver:topk(schema, tags, tstart, tend, options, top_tags)
+   local res = ntop.ts_topk(schema.name, tagsToKey(schema, tags), tstart, tend, options.max_num_points, options.top)
+
+   if res == nil then
+      return nil
+   end
+
+   local topk = {}
+
+   for _, item in ipairs(res.topk) do
+      local partials = {}
+
+      for i, name in ipairs(schema._metrics) do
+	 partials[name] = item.partials[i] or 0
+      end
+
+      topk[#topk + 1] = {
+	 tags = keyToTags(item.key),
+	 value = item.value,
+	 partials = partials,
+      }
+   end
+
+   local stats = nil
+
+   if options.calculate_stats then
+      stats = ts_common.calculateStatistics(res.total, res.step, tend - tstart, schema.options.metrics_type)
+      stats = table.merge(stats, ts_common.calculateMinMax(res.total))
+   end
+
+   return {
+      topk = topk,
+      additional_series = {
+	 total = res.total,
+      },
+      statistics = stats,
+   }
+end
+
+-- ##############################################
+
+function driver:queryTotal(schema, tstart, tend, tags, options)
+   -- The per-series totals of topk are exact, unlike the sum of the (possibly sampled) rates
+   local res = ntop.ts_topk(schema.name, tagsToKey(schema, tags), tstart, tend, options.max_num_points, 1)
+
+   if (res == nil) or (res.num_series == 0) then
+      return nil
+   end
+
+   local totals = {}
+   local item = res.topk[1]
+
+   for i, name in ipairs(schema._metrics) do
+      totals[name] = (item and item.partials[i]) or 0
+   end
+
+   return totals
+end
+
+-- ##############################################
+
+function driver:delete(schema_prefix, tags)
+   ntop.ts_delete(schema_prefix, tagsToFilter(tags))
+
+   return true
+end
+
+-- ##############################################
+
+function driver:deleteOldData(ifid)
+   -- The retention is global: the store is shared by all the interfaces
+   local retention_days = data_retention_utils.getTSAndStatsDataRetentionDays()
+
+   ntop.ts_delete_old_data(retention_days * 86400)
+
+   return true
+end
+
+-- ##############################################
+
+function driver:export()
+   -- Nothing to do: points are written synchronously by append
+end
+
+-- ##############################################
+
+function driver:setup(ts_utils)
+   return(ntop.ts_append ~= nil)
+end
+
+-- ##############################################
+
+return driver
@@ -0,0 +1,313 @@
+--
+-- (C) 2022 - ntop.org
+--
+
+local ts_utils = require("ts_utils")
+local native = require("native")
+
+-- ##############################################
+
+local driver = native:new()
+local step = 60
+local now = os.time()
+
+-- Each test has its own schema: points older than the chunk being filled are discarded,
+-- so the times only move forward, also across runs
+local base = now - (now % 3600) - 3 * 3600
+
+-- Missing points are returned as fill_value
+local options = ts_utils.getQueryOptions({max_num_points = 1000, fill_value = -1, calculate_stats = false})
+
+-- ##############################################
+
+local function newSchema(name, metrics_type, metrics)
+  local schema = ts_utils.schema:new("test:" .. name, {step = step, metrics_type = metrics_type})
+
+  schema:addTag("ifid")
+  schema:addTag("host")
+
+  for _, metric in ipairs(metrics) do
+    schema:addMetric(metric)
+  end
+
+  -- Series left by a previous run
+  driver:delete("test:" .. name, {})
+
+  return schema
+end
+
+local function append(schema, host, i, metrics)
+  return driver:append(schema, base + i * step, {ifid = "0", host = host}, metrics)
+end
+
+local function query(schema, tags, num_points)
+  return driver:query(schema, base, base + (num_points - 1) * step, tags, options)
+end
+
+-- ##############################################
+
+local function append_query_test(test)
+  local schema = newSchema("native_counter", ts_utils.metrics.counter, {"sent", "rcvd"})
+
+  for i = 0, 29 do
+    if not append(schema, "a", i, {sent = i * 600, rcvd = i * 60}) then
+      return test:fail("append failed")
+    end
+  end
+
+  local res = query(schema, {ifid = "0", host = "a"}, 30)
+
+  if (res == nil) or (res.step ~= step) or (res.count ~= 30) or (res.start ~= base) then
+    return test:assertion_failed("30 points of step " .. step .. " from " .. base)
+  end
+
+  -- The first point has no rate
+  for j = 2, res.count do
+    if (res.series[1].data[j] ~= 10) or (res.series[2].data[j] ~= 1) then
+      return test:assertion_failed("rate[" .. j .. "] == {10, 1}")
+    end
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+local function aggregation_test(test)
+  local schema = newSchema("native_gauge", ts_utils.metrics.gauge, {"value"})
+
+  for i = 0, 9 do
+    append(schema, "a", i, {value = 5})
+    append(schema, "b", i, {value = 7})
+  end
+
+  local res = query(schema, {ifid = "0"}, 10)
+
+  if res == nil then
+    return test:assertion_failed("res ~= nil")
+  end
+
+  for j = 1, res.count do
+    if res.series[1].data[j] ~= 12 then
+      return test:assertion_failed("sum[" .. j .. "] == 12")
+    end
+  end
+
+  if query(schema, {ifid = "1"}, 10) ~= nil then
+    return test:assertion_failed("no series for ifid 1")
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+local function topk_test(test)
+  local schema = newSchema("native_topk", ts_utils.metrics.counter, {"bytes"})
+  local rates = {a = 1, b = 2, c = 3}
+
+  for i = 0, 19 do
+    for host, rate in pairs(rates) do
+      append(schema, host, i, {bytes = i * step * rate})
+    end
+  end
+
+  local res = driver:topk(schema, {ifid = "0"}, base, base + 19 * step, table.merge(options, {top = 2}))
+
+  if (res == nil) or (#res.topk ~= 2) then
+    return test:assertion_failed("#topk == 2")
+  end
+
+  -- Totals of the range: 19 increments
+  if (res.topk[1].tags.host ~= "c") or (res.topk[1].value ~= 3 * step * 19) or (res.topk[1].partials.bytes ~= 3 * step * 19) then
+    return test:assertion_failed("topk[1] == c")
+  end
+
+  if (res.topk[2].tags.host ~= "b") or (res.topk[2].value ~= 2 * step * 19) then
+    return test:assertion_failed("topk[2] == b")
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+local function delete_test(test)
+  local schema = newSchema("native_delete", ts_utils.metrics.gauge, {"value"})
+
+  for i = 0, 4 do
+    append(schema, "a", i, {value = 1})
+    append(schema, "b", i, {value = 2})
+  end
+
+  driver:delete("test", {host = "b"})
+
+  local series = driver:listSeries(schema, {ifid = "0"}, {}, 0)
+
+  if (series == nil) or (#series ~= 1) or (series[1].host ~= "a") then
+    return test:assertion_failed("listSeries == {a}")
+  end
+
+  if query(schema, {ifid = "0", host = "b"}, 5) ~= nil then
+    return test:assertion_failed("b deleted")
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+local function delete_old_data_test(test)
+  local schema = newSchema("native_old", ts_utils.metrics.gauge, {"value"})
+  local retention_days = require("data_retention_utils").getTSAndStatsDataRetentionDays()
+
+  driver:append(schema, now - (retention_days + 2) * 86400, {ifid = "0", host = "a"}, {value = 1})
+
+  if driver:listSeries(schema, {ifid = "0"}, {}, 0) == nil then
+    return test:assertion_failed("old series appended")
+  end
+
+  driver:deleteOldData(0)
+
+  if driver:listSeries(schema, {ifid = "0"}, {}, 0) ~= nil then
+    return test:assertion_failed("old series expired")
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+-- Points with some (or all) the metrics missing
+local function codec_nan_test(test)
+  local schema = newSchema("native_nan", ts_utils.metrics.gauge, {"a", "b"})
+
+  for i = 0, 9 do
+    if i == 5 then
+      append(schema, "a", i, {a = 0/0, b = 0/0})
+    elseif (i % 2) == 0 then
+      append(schema, "a", i, {a = 3, b = 0/0})
+    else
+      append(schema, "a", i, {a = 3, b = 4})
+    end
+  end
+
+  local res = query(schema, {ifid = "0", host = "a"}, 10)
+
+  if res == nil then
+    return test:assertion_failed("res ~= nil")
+  end
+
+  for j = 1, res.count do
+    local i = j - 1
+    local a, b = res.series[1].data[j], res.series[2].data[j]
+
+    if i == 5 then
+      if (a ~= -1) or (b ~= -1) then return test:assertion_failed("point " .. i .. " missing") end
+    elseif (i % 2) == 0 then
+      if (a ~= 3) or (b ~= -1) then return test:assertion_failed("point " .. i .. " == {3, NaN}") end
+    elseif (a ~= 3) or (b ~= 4) then
+      return test:assertion_failed("point " .. i .. " == {3, 4}")
+    end
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+-- A 32 bit counter wrapping: no negative or huge rate
+local function codec_counter_wrap_test(test)
+  local schema = newSchema("native_wrap", ts_utils.metrics.counter, {"bytes"})
+  local v = 4294967296 - 5 * step * 100
+
+  for i = 0, 9 do
+    append(schema, "a", i, {bytes = v})
+    v = (v + step * 100) % 4294967296
+  end
+
+  local res = query(schema, {ifid = "0", host = "a"}, 10)
+
+  if res == nil then
+    return test:assertion_failed("res ~= nil")
+  end
+
+  for j = 2, res.count do
+    local rate = res.series[1].data[j]
+
+    if j == 6 then
+      -- The counter wrapped
+      if (rate < 0) or (rate > 100) then
+	return test:assertion_failed("0 <= rate[" .. j .. "] <= 100")
+      end
+    elseif rate ~= 100 then
+      return test:assertion_failed("rate[" .. j .. "] == 100")
+    end
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+local function codec_single_point_test(test)
+  local gauge = newSchema("native_single_gauge", ts_utils.metrics.gauge, {"value"})
+  local counter = newSchema("native_single_counter", ts_utils.metrics.counter, {"value"})
+
+  append(gauge, "a", 3, {value = 42})
+  append(counter, "a", 3, {value = 42})
+
+  local res = query(gauge, {ifid = "0", host = "a"}, 10)
+
+  if res == nil then
+    return test:assertion_failed("gauge res ~= nil")
+  end
+
+  for j = 1, res.count do
+    if res.series[1].data[j] ~= ((j == 4) and 42 or -1) then
+      return test:assertion_failed("gauge[" .. j .. "]")
+    end
+  end
+
+  -- No rate without a previous point
+  res = query(counter, {ifid = "0", host = "a"}, 10)
+
+  if res == nil then
+    return test:assertion_failed("counter res ~= nil")
+  end
+
+  for j = 1, res.count do
+    if res.series[1].data[j] ~= -1 then
+      return test:assertion_failed("counter[" .. j .. "] missing")
+    end
+  end
+
+  return test:success()
+end
+
+-- ##############################################
+
+function run(tester)
+  if ntop.ts_append == nil then
+    print("Skipping native driver tests: the native timeseries store is not available.<br/>")
+    return(true)
+  end
+
+  local rv = tester.run_test("native:append_query", append_query_test)
+  rv = tester.run_test("native:aggregation", aggregation_test) and rv
+  rv = tester.run_test("native:topk", topk_test) and rv
+  rv = tester.run_test("native:delete", delete_test) and rv
+  rv = tester.run_test("native:delete_old_data", delete_old_data_test) and rv
+  rv = tester.run_test("native:codec_nan", codec_nan_test) and rv
+  rv = tester.run_test("native:codec_counter_wrap", codec_counter_wrap_test) and rv
+  rv = tester.run_test("native:codec_single_point", codec_single_point_test) and rv
+
+  -- Leaves no test series behind
+  driver:delete("test", {})
+
+  return rv
+end
+
+return {
+  run = run
+}
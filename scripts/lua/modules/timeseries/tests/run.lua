@@ -15,6 +15,7 @@ local tests = {
   require("influxdb2series"),
   require("influxdb_queries"),
   require("rrd_paths_test"),
+  require("native_test"),
 }
 
 -- ##############################################
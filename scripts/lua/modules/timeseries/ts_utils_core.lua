@@ -138,6 +138,14 @@ function ts_utils.listActiveDrivers()
       local dirs = ntop.getDirs()
       local rrd_driver = require("rrd"):new({base_path = (dirs.workingdir .. "/rrd_new")})
       active_drivers[#active_drivers + 1] = rrd_driver
+   elseif driver == "native" then
+      -- Not available on all the platforms, RRD as fallback
+      if ntop.ts_append ~= nil then
+	 active_drivers[#active_drivers + 1] = require("native"):new({})
+      else
+	 local dirs = ntop.getDirs()
+	 active_drivers[#active_drivers + 1] = require("rrd"):new({base_path = (dirs.workingdir .. "/rrd_new")})
+      end
    elseif driver == "prometheus" then
       local prometheus_driver = require("prometheus"):new({})
       active_drivers[#active_drivers + 1] = prometheus_driver
@@ -208,6 +216,42 @@ end
 
 -- ##############################################
 
+local cached_topk_summaries_enabled = nil
+
+-- The native topk summaries cost some work on every appended point:
+-- they are only kept when enabled in the preferences
+local function isTopkSummaryEnabled()
+   if cached_topk_summaries_enabled == nil then
+      cached_topk_summaries_enabled = (ntop.ts_topk_update ~= nil) and (ntop.getPref("ntopng.prefs.ts_topk_summaries") == "1")
+   end
+
+   return cached_topk_summaries_enabled
+end
+
+-- ##############################################
+
+-- Feeds the native topk summaries of the series sharing all the tags
+-- but the last one (see getSummaryTops)
+local function updateTopkSummary(schema, timestamp, tags, data)
+   local num_tags = #schema._tags
+   local group = {}
+   local values = {}
+
+   for i = 1, num_tags - 1 do
+      local tag = schema._tags[i]
+      group[i] = tag .. "=" .. tags[tag]
+   end
+
+   for i, metric in ipairs(schema._metrics) do
+      values[i] = tonumber(data[metric]) or 0
+   end
+
+   ntop.ts_topk_update(schema.name, table.concat(group, ","), tostring(tags[schema._tags[num_tags]]), timestamp,
+		       schema.options.step, (schema.options.metrics_type == ts_common.metrics.counter), values)
+end
+
+-- ##############################################
+
 --! @brief Append a new data point to the specified timeseries.
 --! @param schema_name the schema identifier.
 --! @param tags_and_metrics a table with tag->value and metric->value mappings.
@@ -247,6 +291,10 @@ function ts_utils.append(schema_name, tags_and_metrics, timestamp)
       rv = driver:append(schema, timestamp, tags, data) and rv
    end
 
+   if (#schema._tags > 1) and isTopkSummaryEnabled() then
+      updateTopkSummary(schema, timestamp, tags, data)
+   end
+
    return rv
 end
 
@@ -263,6 +311,7 @@ function ts_utils.getQueryOptions(overrides)
 	 calculate_stats = true, -- calculate stats if possible
 	 initial_point = false,   -- add an extra initial point, not accounted in statistics but useful for drawing graphs
 	 with_series = false,    -- in topk query, if true, also get top items series data
+	 allow_approximate = false, -- in topk query, if true, also accept the estimated top items of the native summaries
 	 no_timeout = true,      -- do not abort queries automatically by default
 	 fill_series = false,    -- if true, filling missing points is required
 		      }, overrides or {})
@@ -397,6 +446,66 @@ local function getPrecomputedTops(schema_id, tags, tstart, tend, options)
   return nil
 end
 
+-- Top items from the native summaries, without reading the series of the
+-- driver. Only available on the last schema tag, for the large groups and
+-- the time ranges covered by the summaries: nil otherwise. The summaries
+-- can only estimate some results (e.g. when the top items change over the
+-- window): those are returned, flagged as approximate, only when
+-- options.allow_approximate is set, otherwise the driver is queried.
+-- Must return in the same format as driver:topk
+local function getSummaryTops(schema, tags, tstart, tend, options, top_tags)
+   local top_tag = schema._tags[#schema._tags]
+
+   if (not isTopkSummaryEnabled()) or (not ntop.ts_topk_query) or (#top_tags ~= 1) or (top_tags[1] ~= top_tag) then
+      return nil
+   end
+
+   local group = {}
+
+   for i = 1, #schema._tags - 1 do
+      local tag = schema._tags[i]
+      group[i] = tag .. "=" .. tags[tag]
+   end
+
+   local res = ntop.ts_topk_query(schema.name, table.concat(group, ","), tstart, tend, options.top)
+
+   if (not res) or (res.approximate and not options.allow_approximate) then
+      return nil
+   end
+
+   local topk = {}
+
+   for _, item in ipairs(res.topk) do
+      local partials = {}
+
+      for i, metric in ipairs(schema._metrics) do
+	 partials[metric] = item.partials[i] or 0
+      end
+
+      topk[#topk + 1] = {
+	 tags = table.merge(tags, {[top_tag] = item.item}),
+	 value = item.value,
+	 partials = partials,
+      }
+   end
+
+   local stats = nil
+
+   if options.calculate_stats then
+      stats = ts_common.calculateStatistics(res.total, res.step, tend - tstart, schema.options.metrics_type)
+      stats = table.merge(stats, ts_common.calculateMinMax(res.total))
+   end
+
+   return {
+      topk = topk,
+      approximate = res.approximate,
+      additional_series = {
+	 total = res.total,
+      },
+      statistics = stats,
+   }
+end
+
 -- ##############################################
 
 --! @brief Perform a topk query.
@@ -450,8 +559,9 @@ function ts_utils.queryTopk(schema_name, tags, tstart, tend, options)
 	 return ts_utils.query(schema_name, tags, tstart, tend, query_options)
       end
 
-      -- Find the top items
-      top_items = driver:topk(schema, tags, tstart, tend, query_options, top_tags)
+      -- Find the top items, from the native summaries when possible
+      top_items = getSummaryTops(schema, tags, tstart, tend, query_options, top_tags)
+	 or driver:topk(schema, tags, tstart, tend, query_options, top_tags)
    end
 
    if table.empty(top_items) then
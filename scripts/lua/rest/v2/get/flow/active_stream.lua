@@ -0,0 +1,39 @@
+--
+-- (C) 2013-22 - ntop.org
+--
+
+local dirs = ntop.getDirs()
+package.path = dirs.installdir .. "/scripts/lua/modules/?.lua;" .. package.path
+
+require "lua_utils"
+require "flow_utils"
+local rest_utils = require("rest_utils")
+
+--
+-- Read list of active flows, as returned by interface.getFlowsInfo (numFlows, nextSlot, flows),
+-- encoded while walking the flows: use it for large exports instead of active.lua
+-- Example: curl -u admin:admin "http://localhost:3000/lua/rest/v2/get/flow/active_stream.lua?ifid=0&perPage=10000"
+--
+-- NOTE: in case of invalid login, no error is returned but redirected to login
+--
+
+local ifid = _GET["ifid"]
+
+if isEmptyString(ifid) then
+   rest_utils.answer(rest_utils.consts.err.invalid_interface)
+   return
+end
+
+interface.select(ifid)
+
+if not isEmptyString(_GET["sortColumn"]) then
+   -- Backward compatibility
+   _GET["sortColumn"] = "column_" .. _GET["sortColumn"]
+end
+
+-- Same pagination and filters as active.lua
+local flows_filter = getFlowsFilter()
+
+rest_utils.stream_answer(rest_utils.consts.success.ok, function()
+   return interface.streamFlowsInfo(flows_filter["hostFilter"], flows_filter)
+end)
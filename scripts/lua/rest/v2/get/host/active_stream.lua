@@ -0,0 +1,93 @@
+--
+-- (C) 2013-22 - ntop.org
+--
+
+local dirs = ntop.getDirs()
+package.path = dirs.installdir .. "/scripts/lua/modules/?.lua;" .. package.path
+
+require "lua_utils"
+local rest_utils = require("rest_utils")
+
+--
+-- Read list of active hosts, as returned by interface.getHostsInfo (numHosts, nextSlot, hosts),
+-- encoded while walking the hosts: use it for large exports instead of active.lua
+-- Example: curl -u admin:admin "http://localhost:3000/lua/rest/v2/get/host/active_stream.lua?ifid=0&perPage=10000"
+--
+-- NOTE: in case of invalid login, no error is returned but redirected to login
+--
+
+local ifid = _GET["ifid"]
+
+-- Pagination:
+local currentPage = tonumber(_GET["currentPage"]) or 1
+local perPage     = tonumber(_GET["perPage"]) or getDefaultTableSize()
+local sortColumn  = _GET["sortColumn"] -- ip, name, since, last, alerts, country, vlan, num_flows, traffic, thpt
+local sortOrder   = _GET["sortOrder"]
+
+-- Filters
+local mode        = _GET["mode"] -- all local remote broadcast_domain filtered blacklisted dhcp
+local ipversion   = _GET["version"]
+local protocol    = _GET["protocol"]
+local traffic_type = _GET["traffic_type"]
+local asn          = _GET["asn"]
+local vlan         = _GET["vlan"]
+local network      = _GET["network"]
+local cidr         = _GET["network_cidr"]
+local pool         = _GET["pool"]
+local country      = _GET["country"]
+local os_          = tonumber(_GET["os"])
+local mac          = _GET["mac"]
+local top_hidden   = ternary(_GET["top_hidden"] == "1", true, nil)
+local fields       = _GET["fields"] -- e.g. name,traffic,flows (see HostLuaField)
+
+if isEmptyString(ifid) then
+   rest_utils.answer(rest_utils.consts.err.invalid_interface)
+   return
+end
+
+interface.select(ifid)
+
+if not isEmptyString(sortColumn) then
+   -- Backward compatibility
+   sortColumn = "column_" .. sortColumn
+end
+
+local traffic_type_filter
+
+if traffic_type == "one_way" then
+   traffic_type_filter = 1 -- ntop_typedefs.h TrafficType traffic_type_one_way
+elseif traffic_type == "bidirectional" then
+   traffic_type_filter = 2 -- ntop_typedefs.h TrafficType traffic_type_bidirectional
+end
+
+local filtered_hosts = false
+local blacklisted_hosts = false
+local anomalous = false
+local dhcp_hosts = false
+
+local hosts_stream_function = interface.streamHostsInfo
+if mode == "local" then
+   hosts_stream_function = interface.streamLocalHostsInfo
+elseif mode == "remote" then
+   hosts_stream_function = interface.streamRemoteHostsInfo
+elseif mode == "broadcast_domain" then
+   hosts_stream_function = interface.streamBroadcastDomainHostsInfo
+elseif mode == "filtered" then
+   filtered_hosts = true
+elseif mode == "blacklisted" then
+   blacklisted_hosts = true
+elseif mode == "dhcp" then
+   dhcp_hosts = true
+end
+
+local to_skip = (currentPage - 1) * perPage
+
+rest_utils.stream_answer(rest_utils.consts.success.ok, function()
+   return hosts_stream_function(false, sortColumn, perPage, to_skip, (sortOrder ~= "desc"),
+                                country, os_, tonumber(vlan), tonumber(asn),
+                                tonumber(network), mac,
+                                tonumber(pool), tonumber(ipversion),
+                                tonumber(protocol), traffic_type_filter,
+                                filtered_hosts, blacklisted_hosts, top_hidden, anomalous, dhcp_hosts, cidr,
+                                nil --[[ device_ip ]], fields)
+end)
@@ -241,6 +241,7 @@ function dumpInterfaceStats(ifid)
         res["syslog"]["alerts"] = ifstats.syslog.alerts
         res["syslog"]["host_correlations"] = ifstats.syslog.host_correlations
         res["syslog"]["flows"] = ifstats.syslog.flows
+        res["syslog"]["producers"] = ifstats.syslogProducerStats
       end
 
       if(ifstats["profiles"] ~= nil) then
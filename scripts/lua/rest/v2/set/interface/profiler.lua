@@ -0,0 +1,54 @@
+--
+-- (C) 2013-22 - ntop.org
+--
+
+local dirs = ntop.getDirs()
+
+package.path = dirs.installdir .. "/scripts/lua/modules/?.lua;" .. package.path
+
+require "lua_utils"
+local rest_utils = require("rest_utils")
+
+--
+-- Enable, disable or reset the packet pipeline profiler of an interface
+-- Example: curl -u admin:admin -H "Content-Type: application/json" -d '{"ifid": "1", "enabled": "true", "sampling_rate": "64"}' http://localhost:3000/lua/rest/v2/set/interface/profiler.lua
+--
+-- Parameters:
+--   enabled: "true" or "false"
+--   sampling_rate: (optional) profile one packet out of N
+--   reset: (optional) "true" to clear the collected samples
+--
+-- NOTE: in case of invalid login, no error is returned but redirected to login
+--
+
+if not isAdministrator() then
+   rest_utils.answer(rest_utils.consts.err.not_granted)
+   return
+end
+
+local ifid = _POST["ifid"]
+local enabled = _POST["enabled"]
+local sampling_rate = tonumber(_POST["sampling_rate"])
+
+if isEmptyString(ifid) then
+   rest_utils.answer(rest_utils.consts.err.invalid_interface)
+   return
+end
+
+if (enabled ~= "true" and enabled ~= "false")
+   or (sampling_rate ~= nil and sampling_rate < 1) then
+   rest_utils.answer(rest_utils.consts.err.invalid_args)
+   return
+end
+
+interface.select(ifid)
+
+interface.setPacketProfiler(enabled == "true", sampling_rate)
+
+if _POST["reset"] == "true" then
+   interface.resetPacketProfiler()
+end
+
+local res = interface.getPacketProfiler()
+
+rest_utils.answer(rest_utils.consts.success.ok, res and res.profiler or {})
@@ -49,7 +49,7 @@ AutonomousSystem::AutonomousSystem(NetworkInterface *_iface, IpAddress *ipa) : G
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Created Autonomous System %u", asn);
 #endif
 
-  if(ntop->getPrefs()->is_idle_local_host_cache_enabled())
+  if(ntop->getPrefs()->is_idle_local_host_cache_enabled() && (!iface->isLoadingCheckpoint()))
     deserializeFromRedis();
 }
 
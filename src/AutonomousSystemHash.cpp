@@ -32,20 +32,26 @@ AutonomousSystemHash::AutonomousSystemHash(NetworkInterface *_iface, u_int _num_
 /* ************************************ */
 
 AutonomousSystem* AutonomousSystemHash::get(IpAddress *ipa, bool is_inline_call) {
-  u_int32_t asn, hash;
+  u_int32_t asn;
 
   ntop->getGeolocation()->getAS(ipa, &asn, NULL /* Don't care about AS name here */);
-  hash = asn;
-  
-  hash %= num_hashes;
+
+  return(get(asn, is_inline_call));
+}
+
+/* ************************************ */
+
+AutonomousSystem* AutonomousSystemHash::get(u_int32_t asn, bool is_inline_call) {
+  u_int32_t hash = asn % num_hashes;
 
   if(table[hash] == NULL) {
     return(NULL);
   } else {
     AutonomousSystem *head;
+    int epoch_slot = -1;
 
     if(!is_inline_call)
-      locks[hash]->rdlock(__FILE__, __LINE__);
+      epoch_slot = enterReadSection(hash);
 
     head = (AutonomousSystem*)table[hash];
 
@@ -57,7 +63,7 @@ AutonomousSystem* AutonomousSystemHash::get(IpAddress *ipa, bool is_inline_call)
     }
 
     if(!is_inline_call)
-      locks[hash]->unlock(__FILE__, __LINE__);
+      exitReadSection(hash, epoch_slot);
 
     return(head);
   }
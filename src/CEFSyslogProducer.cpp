@@ -0,0 +1,222 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#ifndef HAVE_NEDGE
+
+enum { cef_version = 0, cef_vendor, cef_product, cef_device_version,
+       cef_signature_id, cef_name, cef_severity };
+
+/* **************************************************** */
+
+CEFSyslogProducer::CEFSyslogProducer(SyslogParserInterface *_iface) : SyslogProducer(_iface, "cef") {
+  memset(header, 0, sizeof(header));
+  num_extensions = 0;
+}
+
+/* **************************************************** */
+
+/* Removes the backslash of \| \\ \= escapes, and turns \n \r into spaces */
+void CEFSyslogProducer::unescape(char *s) {
+  char *w = s;
+
+  if(strchr(s, '\\') == NULL)
+    return;
+
+  while(*s) {
+    if((*s == '\\') && (s[1] != '\0')) {
+      s++;
+      *w++ = ((*s == 'n') || (*s == 'r')) ? ' ' : *s;
+      s++;
+    } else
+      *w++ = *s++;
+  }
+
+  *w = '\0';
+}
+
+/* **************************************************** */
+
+bool CEFSyslogProducer::parse(char *message) {
+  char *p = message;
+  int i = 0;
+
+  if(strncmp(p, "CEF:", 4))
+    return(false);
+
+  header[i++] = p + 4;
+
+  while(*p && (i < CEF_NUM_HEADER_FIELDS)) {
+    if((*p == '\\') && (p[1] != '\0'))
+      p++;
+    else if(*p == '|')
+      *p = '\0', header[i++] = p + 1;
+
+    p++;
+  }
+
+  if(i < CEF_NUM_HEADER_FIELDS)
+    return(false);
+
+  /* The severity field is terminated by the extension separator */
+  while(*p && (*p != '|')) p++;
+  if(*p) *p++ = '\0';
+
+  for(i = 0; i < CEF_NUM_HEADER_FIELDS; i++)
+    unescape(header[i]);
+
+  parseExtensions(p);
+
+  return(true);
+}
+
+/* **************************************************** */
+
+/*
+  Extensions are key=value pairs separated by spaces, where values can
+  contain (unescaped) spaces: a value ends where the next key begins.
+*/
+void CEFSyslogProducer::parseExtensions(char *ext) {
+  char *p = ext;
+
+  num_extensions = 0;
+
+  while(*p && (num_extensions < CEF_MAX_EXTENSIONS)) {
+    if((*p == '\\') && (p[1] != '\0')) {
+      p += 2;
+      continue;
+    }
+
+    if((*p == '=') && (p > ext)) {
+      char *key = p;
+
+      while((key > ext) && (isalnum(key[-1]) || (key[-1] == '_'))) key--;
+
+      /* Keys are identifiers after a space: other '=' belong to the value (e.g. URLs) */
+      if((key < p) && ((key == ext) || (key[-1] == ' '))) {
+	if(key > ext)
+	  key[-1] = '\0'; /* Terminates the value of the previous key */
+
+	*p = '\0';
+	extensions[num_extensions].key = key, extensions[num_extensions].value = p + 1;
+	num_extensions++;
+      }
+    }
+
+    p++;
+  }
+
+  for(u_int i = 0; i < num_extensions; i++)
+    unescape((char*)extensions[i].value);
+}
+
+/* **************************************************** */
+
+const char* CEFSyslogProducer::get(const char *key) const {
+  for(u_int i = 0; i < num_extensions; i++)
+    if(!strcmp(extensions[i].key, key))
+      return((extensions[i].value[0] != '\0') ? extensions[i].value : NULL);
+
+  return(NULL);
+}
+
+/* **************************************************** */
+
+/* 0..10, or Unknown/Low/Medium/High/Very-High */
+int CEFSyslogProducer::getSeverity() const {
+  const char *s = header[cef_severity];
+
+  if(isdigit(s[0]))                   return(atoi(s));
+  else if(!strcasecmp(s, "Low"))       return(3);
+  else if(!strcasecmp(s, "Medium"))    return(6);
+  else if(!strcasecmp(s, "High"))      return(8);
+  else if(!strcasecmp(s, "Very-High")) return(10);
+  else                                 return(0);
+}
+
+/* **************************************************** */
+
+/* start/end are milliseconds since the epoch (other date formats are not handled) */
+time_t CEFSyslogProducer::str2time(const char *t) {
+  return(t && isdigit(t[0]) ? (time_t)(strtoull(t, NULL, 10) / 1000) : 0);
+}
+
+/* **************************************************** */
+
+u_int8_t CEFSyslogProducer::handleEvent(char *message, const char *host, int priority) {
+  const char *src, *dst, *category;
+  int severity;
+  bool alert;
+  time_t now = time(NULL);
+
+  if(!parse(message)) {
+    incStats(1, 0, 0);
+    return(0);
+  }
+
+  if((src = get("src")) == NULL) src = get("c6a2");
+  if((dst = get("dst")) == NULL) dst = get("c6a3");
+
+  if((src == NULL) || (dst == NULL)) {
+    incStats(1, 0, 0);
+    return(0);
+  }
+
+  ParsedFlow flow;
+
+  flow.src_ip.set(src), flow.dst_ip.set(dst);
+  flow.src_port = htons((u_int16_t)atoi(get("spt") ? get("spt") : "0"));
+  flow.dst_port = htons((u_int16_t)atoi(get("dpt") ? get("dpt") : "0"));
+  flow.l4_proto = str2proto(get("proto"));
+  /* CEF "in" is the traffic flowing from the source to the destination */
+  flow.in_bytes = get("in") ? strtoul(get("in"), NULL, 10) : 0;
+  flow.out_bytes = get("out") ? strtoul(get("out"), NULL, 10) : 0;
+
+  flow.first_switched = str2time(get("start")), flow.last_switched = str2time(get("end"));
+  if(flow.first_switched == 0) flow.first_switched = flow.last_switched ? flow.last_switched : now;
+  if(flow.last_switched == 0)  flow.last_switched = flow.first_switched;
+
+  severity = getSeverity();
+
+  if((alert = (severity >= CEF_MIN_ALERT_SEVERITY))) {
+    if((category = get("cat")) == NULL)
+      category = header[cef_product];
+
+    /* Mapped to the 1 (highest) .. 4 scale of Suricata */
+    flow.external_alert = buildExternalAlert(name, header[cef_name], category,
+					     (severity >= 9) ? 1 : ((severity >= 7) ? 2 : 3));
+  }
+
+  flow.addAdditionalField("CEF_VENDOR", json_object_new_string(header[cef_vendor]));
+  flow.addAdditionalField("CEF_PRODUCT", json_object_new_string(header[cef_product]));
+  flow.addAdditionalField("CEF_SIGNATURE_ID", json_object_new_string(header[cef_signature_id]));
+
+  processFlow(&flow);
+
+  incStats(0, alert ? 1 : 0, alert ? 0 : 1);
+
+  return(1);
+}
+
+/* **************************************************** */
+
+#endif
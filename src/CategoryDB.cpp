@@ -0,0 +1,333 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+/* *************************************** */
+
+CategoryDB::CategoryDB(u_char *_image, u_int32_t _build_msec) {
+  image = _image, mapped = false, build_msec = _build_msec;
+  lists = NULL;
+
+  if(!init()) {
+    /* The image is left to the caller */
+    if(lists) free(lists);
+    throw "Invalid category image";
+  }
+}
+
+/* *************************************** */
+
+CategoryDB::~CategoryDB() {
+  if(lists) free(lists);
+
+#ifndef WIN32
+  if(mapped)
+    munmap(image, hdr->size);
+  else
+#endif
+    free(image);
+}
+
+/* *************************************** */
+
+/* Validates the image and resolves the list names */
+bool CategoryDB::init() {
+  const u_int32_t *list_names;
+
+  hdr = (const category_db_header*)image;
+
+  if((hdr->magic != CATEGORY_DB_MAGIC) || (hdr->version != CATEGORY_DB_VERSION)
+     || (hdr->ipv4_offset + (u_int64_t)hdr->num_ipv4 * sizeof(category_db_ipv4_range) > hdr->size)
+     || (hdr->host_slots_offset + (u_int64_t)hdr->num_host_slots * sizeof(category_db_host_slot) > hdr->size)
+     || (hdr->lists_offset + (u_int64_t)hdr->num_lists * sizeof(u_int32_t) > hdr->size)
+     || (hdr->strings_offset + (u_int64_t)hdr->strings_len > hdr->size)
+     || (hdr->strings_len == 0) || (image[hdr->strings_offset + hdr->strings_len - 1] != '\0')
+     || (hdr->num_host_slots & (hdr->num_host_slots - 1)))
+    return(false);
+
+  ipv4 = (const category_db_ipv4_range*)&image[hdr->ipv4_offset];
+  hosts = (const category_db_host_slot*)&image[hdr->host_slots_offset];
+  strings = (const char*)&image[hdr->strings_offset];
+  list_names = (const u_int32_t*)&image[hdr->lists_offset];
+
+  if((lists = (char**)calloc(hdr->num_lists + 1, sizeof(char*))) == NULL)
+    return(false);
+
+  for(u_int32_t i = 0; i < hdr->num_lists; i++) {
+    if(list_names[i] >= hdr->strings_len)
+      return(false);
+
+    lists[i] = ntop->getPersistentCustomListName((char*)&strings[list_names[i]]);
+  }
+
+  /*
+    The lookups index the strings and the lists with the values of the
+    entries: check them once here, as the image can come from a (corrupted
+    or truncated) file
+  */
+  for(u_int32_t i = 0; i < hdr->num_ipv4; i++) {
+    if(ipv4[i].list_id >= hdr->num_lists)
+      return(false);
+  }
+
+  for(u_int32_t i = 0; i < hdr->num_host_slots; i++) {
+    if((hosts[i].name != 0)
+       && ((hosts[i].name >= hdr->strings_len) || (hosts[i].list_id >= hdr->num_lists)))
+      return(false);
+  }
+
+  return(true);
+}
+
+/* *************************************** */
+
+/* FNV-1a */
+u_int32_t CategoryDB::hashName(const char *name, u_int len) {
+  u_int32_t h = 2166136261U;
+
+  for(u_int i = 0; i < len; i++)
+    h = (h ^ (u_char)tolower(name[i])) * 16777619U;
+
+  return(h);
+}
+
+/* *************************************** */
+
+CategoryDB* CategoryDB::open(const char *path) {
+#ifndef WIN32
+  CategoryDB *db = NULL;
+  struct stat st;
+  void *m;
+  int fd;
+
+  if((fd = ::open(path, O_RDONLY)) < 0)
+    return(NULL);
+
+  if((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(category_db_header))) {
+    close(fd);
+    return(NULL);
+  }
+
+  m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if(m == MAP_FAILED)
+    return(NULL);
+
+  if(((category_db_header*)m)->size != (u_int64_t)st.st_size) {
+    munmap(m, st.st_size);
+    return(NULL);
+  }
+
+  try {
+    db = new CategoryDB((u_char*)m, 0);
+    db->mapped = true;
+  } catch(...) {
+    munmap(m, st.st_size);
+    db = NULL;
+  }
+
+  return(db);
+#else
+  return(NULL);
+#endif
+}
+
+/* *************************************** */
+
+bool CategoryDB::save(const char *path) const {
+  char tmp_path[MAX_PATH];
+  FILE *fd;
+  bool rc;
+
+  /* Write aside and rename, as the file may be mmap-ed */
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  if((fd = fopen(tmp_path, "wb")) == NULL)
+    return(false);
+
+  rc = (fwrite(image, 1, hdr->size, fd) == hdr->size);
+  rc &= (fclose(fd) == 0);
+
+  if(rc)
+    rc = (rename(tmp_path, path) == 0);
+  else
+    unlink(tmp_path);
+
+  return(rc);
+}
+
+/* *************************************** */
+
+bool CategoryDB::matchIPv4(u_int32_t ip, ndpi_protocol_category_t *category, char **list_name) const {
+  int32_t low = 0, high = (int32_t)hdr->num_ipv4 - 1;
+
+  while(low <= high) {
+    int32_t mid = low + (high - low) / 2;
+    const category_db_ipv4_range *r = &ipv4[mid];
+
+    if(ip < r->first)
+      high = mid - 1;
+    else if(ip > r->last)
+      low = mid + 1;
+    else {
+      *category = (ndpi_protocol_category_t)r->category;
+      if(list_name) *list_name = lists[r->list_id];
+      return(true);
+    }
+  }
+
+  return(false);
+}
+
+/* *************************************** */
+
+/* Looks up the name and then its parent domains, i.e. a list entry matches its subdomains too */
+bool CategoryDB::matchDomain(const char *name, u_int len, ndpi_protocol_category_t *category, char **list_name) const {
+  u_int32_t mask = hdr->num_host_slots - 1;
+
+  if(hdr->num_host_slots == 0)
+    return(false);
+
+  while(len > 0) {
+    u_int32_t h = hashName(name, len), i = h & mask;
+
+    for(u_int32_t n = 0; n <= mask; n++, i = (i + 1) & mask) {
+      const category_db_host_slot *s = &hosts[i];
+
+      if(s->name == 0)
+	break;
+
+      if((s->hash == h) && (strncasecmp(&strings[s->name], name, len) == 0)
+	 && (strings[s->name + len] == '\0')) {
+	*category = (ndpi_protocol_category_t)s->category;
+	if(list_name) *list_name = lists[s->list_id];
+	return(true);
+      }
+    }
+
+    /* Parent domain */
+    const char *dot = (const char*)memchr(name, '.', len);
+
+    if(dot == NULL)
+      break;
+
+    len -= (dot - name) + 1, name = dot + 1;
+  }
+
+  return(false);
+}
+
+/* *************************************** */
+
+bool CategoryDB::matchIP(u_int32_t ip, ndpi_protocol_category_t *category, char **list_name) const {
+  return(matchIPv4(ntohl(ip), category, list_name));
+}
+
+/* *************************************** */
+
+bool CategoryDB::matchHost(const char *name, ndpi_protocol_category_t *category, char **list_name) const {
+  u_int len;
+
+  if((name == NULL) || (name[0] == '\0'))
+    return(false);
+
+  len = strlen(name);
+
+  /* Ignore the trailing dot of FQDNs */
+  if(name[len - 1] == '.') len--;
+
+  return(matchDomain(name, len, category, list_name));
+}
+
+/* *************************************** */
+
+/* Matches an IPv4 address or a host name, possibly part of a URL */
+bool CategoryDB::match(const char *host_or_ip, ndpi_protocol_category_t *category, char **list_name) const {
+  const char *begin = host_or_ip, *end;
+  struct in_addr a;
+  char buf[256];
+  u_int len;
+
+  if(begin == NULL)
+    return(false);
+
+  if((end = strstr(begin, "://")) != NULL)
+    begin = end + 3;
+
+  for(end = begin; *end && (*end != '/') && (*end != ':') && (*end != '?'); end++)
+    ;
+
+  len = min_val((u_int)(end - begin), sizeof(buf) - 1);
+  memcpy(buf, begin, len);
+  buf[len] = '\0';
+
+  if(inet_pton(AF_INET, buf, &a) == 1)
+    return(matchIP(a.s_addr, category, list_name));
+
+  return(matchHost(buf, category, list_name));
+}
+
+/* *************************************** */
+
+bool CategoryDB::fillIPCategory(u_int32_t saddr, u_int32_t daddr, ndpi_protocol *ret) const {
+  ndpi_protocol_category_t category;
+  char *list_name;
+
+  if(matchIP(saddr, &category, &list_name) || matchIP(daddr, &category, &list_name)) {
+    ret->category = category, ret->custom_category_userdata = list_name;
+    return(true);
+  }
+
+  return(false);
+}
+
+/* *************************************** */
+
+bool CategoryDB::fillHostCategory(const char *name, ndpi_protocol *ret) const {
+  ndpi_protocol_category_t category;
+  char *list_name;
+
+  if(matchHost(name, &category, &list_name)) {
+    ret->category = category, ret->custom_category_userdata = list_name;
+    return(true);
+  }
+
+  return(false);
+}
+
+/* *************************************** */
+
+void CategoryDB::lua(lua_State *vm) const {
+  lua_newtable(vm);
+
+  lua_push_uint64_table_entry(vm, "num_ips", hdr->num_ipv4);
+  lua_push_uint64_table_entry(vm, "num_hosts", hdr->num_hosts);
+  lua_push_uint64_table_entry(vm, "num_lists", hdr->num_lists);
+  lua_push_uint64_table_entry(vm, "memory", hdr->size);
+  lua_push_uint64_table_entry(vm, "build_msec", build_msec);
+  lua_push_bool_table_entry(vm, "mapped", mapped);
+}
@@ -0,0 +1,420 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#define CATEGORY_DB_ALIGN(x)  (((x) + 7) & ~((u_int64_t)7))
+
+/* *************************************** */
+
+CategoryDBBuilder::CategoryDBBuilder() {
+  pool.push_back('\0'); /* Offset 0 is reserved for the empty slots */
+}
+
+/* *************************************** */
+
+u_int16_t CategoryDBBuilder::getListId(const char *list_name) {
+  std::map<std::string, u_int16_t>::iterator it = list_ids.find(list_name ? list_name : "");
+  u_int16_t id;
+
+  if(it != list_ids.end())
+    return(it->second);
+
+  id = (u_int16_t)list_names.size();
+  list_names.push_back(list_name ? list_name : "");
+  list_ids[list_names.back()] = id;
+
+  return(id);
+}
+
+/* *************************************** */
+
+/* a.b.c.d or a.b.c.d/len: returns the range in host byte order */
+bool CategoryDBBuilder::parseIPv4Network(const char *net, u_int32_t *first, u_int32_t *last) {
+  char buf[32], *slash;
+  struct in_addr a;
+  int len = 32;
+  u_int32_t ip, mask;
+
+  if(strlen(net) >= sizeof(buf))
+    return(false);
+
+  strcpy(buf, net);
+
+  if((slash = strchr(buf, '/')) != NULL) {
+    char *end;
+
+    *slash = '\0';
+    len = strtol(slash + 1, &end, 10);
+
+    if((end == slash + 1) || (*end != '\0') || (len < 0) || (len > 32))
+      return(false);
+  }
+
+  if(inet_pton(AF_INET, buf, &a) != 1)
+    return(false);
+
+  ip = ntohl(a.s_addr);
+
+  /* Same as in lists_utils.lua */
+  if(((ip == 0) && ((len == 32) || (len == 0))) || (ip == 0xFFFFFFFF))
+    return(false);
+
+  mask = (len == 0) ? 0 : (0xFFFFFFFF << (32 - len));
+  *first = ip & mask, *last = (ip & mask) | ~mask;
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool CategoryDBBuilder::isValidHostName(const char *name) {
+  if((name[0] == '\0') || (strlen(name) > 255))
+    return(false);
+
+  for(const char *c = name; *c; c++) {
+    /* Whitespaces, URLs, IPv6 addresses and ports are not host names */
+    if(isspace(*c) || (*c == '/') || (*c == ':'))
+      return(false);
+  }
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool CategoryDBBuilder::isExcluded(const char *name, ndpi_protocol_category_t category) const {
+  std::string host(name);
+
+  if(exclusions.empty())
+    return(false);
+
+  std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+
+  return(exclusions.find(std::make_pair((u_int8_t)category, host)) != exclusions.end());
+}
+
+/* *************************************** */
+
+void CategoryDBBuilder::addExclusion(const char *name, ndpi_protocol_category_t category) {
+  std::string host(name[0] == '!' ? &name[1] : name);
+
+  std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+  exclusions.insert(std::make_pair((u_int8_t)category, host));
+}
+
+/* *************************************** */
+
+bool CategoryDBBuilder::addIP(const char *net, ndpi_protocol_category_t category, const char *list_name) {
+  ipv4_prefix p;
+
+  if(!parseIPv4Network(net, &p.first, &p.last))
+    return(false);
+
+  p.seq = prefixes.size(), p.category = (u_int8_t)category, p.list_id = getListId(list_name);
+  prefixes.push_back(p);
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool CategoryDBBuilder::addHost(const char *name, ndpi_protocol_category_t category, const char *list_name) {
+  host_entry h;
+
+  /* Wildcards and leading dots are redundant, as parent domains always match */
+  if(!strncmp(name, "*.", 2))  name += 2;
+  else if(name[0] == '.')      name++;
+
+  if(!isValidHostName(name))
+    return(false);
+
+  h.name = pool.size(), h.len = strlen(name);
+  h.category = (u_int8_t)category, h.list_id = getListId(list_name);
+
+  for(const char *c = name; *c; c++)
+    pool.push_back(tolower(*c));
+
+  /* Trailing dot of FQDNs */
+  if(pool.back() == '.')
+    pool.erase(pool.size() - 1), h.len--;
+
+  pool.push_back('\0');
+  hosts.push_back(h);
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool CategoryDBBuilder::loadFile(const char *path, const char *format, ndpi_protocol_category_t category,
+				 const char *list_name, u_int32_t max_ips, u_int32_t max_hosts,
+				 category_list_load_stats *stats) {
+  bool ip_only = !strcmp(format, "ip"), domain_only = !strcmp(format, "domain");
+  bool hosts_format = !strcmp(format, "hosts");
+  u_int num_warnings = 0, num_line = 0;
+  char line[512];
+  FILE *fd;
+
+  memset(stats, 0, sizeof(*stats));
+
+  if((fd = fopen(path, "r")) == NULL)
+    return(false);
+
+  while(fgets(line, sizeof(line), fd) != NULL) {
+    char *host = line, *end;
+    u_int32_t first, last;
+
+    if(((++num_line % 4096) == 0) && ntop->getGlobals()->isShutdown())
+      break;
+
+    /* Trim */
+    while(isspace(*host)) host++;
+    for(end = &host[strlen(host)]; (end > host) && isspace(end[-1]); end--) ;
+    *end = '\0';
+
+    if((host[0] == '\0') || (host[0] == '#'))
+      continue;
+
+    if(hosts_format) {
+      /* <ip> <host> */
+      char *sep = host;
+
+      while(*sep && !isspace(*sep)) sep++;
+      while(isspace(*sep)) sep++;
+
+      if((*sep == '\0') || strpbrk(sep, " \t")) {
+	stats->num_invalid++;
+	continue;
+      }
+
+      host = sep;
+
+      if(!strcmp(host, "localhost") || !strcmp(host, "127.0.0.1") || !strcmp(host, "::1"))
+	continue;
+    }
+
+    if(host[0] == '!')
+      continue; /* Whitelisted host: only meaningful in the custom categories */
+
+    if(isExcluded(host, category)) {
+      stats->num_excluded++;
+      continue;
+    }
+
+    if(parseIPv4Network(host, &first, &last)) {
+      if(domain_only || !addIP(host, category, list_name)) {
+	stats->num_invalid++;
+
+	if(num_warnings++ < CATEGORY_LIST_MAX_WARNINGS)
+	  ntop->getTrace()->traceEvent(TRACE_WARNING, "Invalid IPv4 address '%s' in list '%s'", host, list_name);
+      } else
+	stats->num_ips++;
+    } else if(strspn(host, "0123456789./") == strlen(host)) {
+      /* Malformed network, or one of the reserved addresses */
+      stats->num_invalid++;
+
+      if(num_warnings++ < CATEGORY_LIST_MAX_WARNINGS)
+	ntop->getTrace()->traceEvent(TRACE_WARNING, "Bad IPv4 address '%s' in list '%s'", host, list_name);
+    } else {
+      if(ip_only || !addHost(host, category, list_name)) {
+	stats->num_invalid++;
+
+	if(num_warnings++ < CATEGORY_LIST_MAX_WARNINGS)
+	  ntop->getTrace()->traceEvent(TRACE_WARNING, "Invalid domain '%s' in list '%s'", host, list_name);
+      } else
+	stats->num_hosts++;
+    }
+
+    if((stats->num_ips >= max_ips) || (stats->num_hosts >= max_hosts)) {
+      stats->limit_reached = true;
+      break;
+    }
+  }
+
+  fclose(fd);
+
+  if(num_warnings > CATEGORY_LIST_MAX_WARNINGS)
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "%u invalid entries in list '%s'", stats->num_invalid, list_name);
+
+  return(true);
+}
+
+/* *************************************** */
+
+/*
+  Turns the (nested or disjoint) prefixes into non overlapping ranges where
+  the innermost prefix wins, i.e. the longest prefix match of the lookup
+  becomes a binary search.
+*/
+void CategoryDBBuilder::flattenPrefixes(std::vector<category_db_ipv4_range> *out) {
+  std::vector<const ipv4_prefix*> stack;
+  u_int64_t cursor = 0; /* Next address to be emitted */
+
+  std::sort(prefixes.begin(), prefixes.end(), [](const ipv4_prefix &a, const ipv4_prefix &b) {
+    if(a.first != b.first) return(a.first < b.first);
+    if(a.last != b.last)   return(a.last > b.last);   /* Outer prefixes first */
+    return(a.seq < b.seq);                            /* Later duplicates win */
+  });
+
+  auto emit = [&](u_int64_t first, u_int64_t last, const ipv4_prefix *p) {
+    if(first > last) return;
+
+    if(!out->empty()) {
+      category_db_ipv4_range *prev = &out->back();
+
+      if(((u_int64_t)prev->last + 1 == first) && (prev->category == p->category) && (prev->list_id == p->list_id)) {
+	prev->last = (u_int32_t)last;
+	return;
+      }
+    }
+
+    category_db_ipv4_range r;
+
+    r.first = (u_int32_t)first, r.last = (u_int32_t)last;
+    r.category = p->category, r.list_id = p->list_id, r.pad = 0;
+    out->push_back(r);
+  };
+
+  for(std::vector<ipv4_prefix>::const_iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+    const ipv4_prefix *p = &(*it);
+
+    /* Close the prefixes ending before this one */
+    while(!stack.empty() && (stack.back()->last < p->first)) {
+      if(cursor <= stack.back()->last) {
+	emit(cursor, stack.back()->last, stack.back());
+	cursor = (u_int64_t)stack.back()->last + 1;
+      }
+
+      stack.pop_back();
+    }
+
+    /* The part of the enclosing prefix before this one */
+    if(!stack.empty())
+      emit(cursor, (u_int64_t)p->first - 1, stack.back());
+
+    cursor = p->first;
+    stack.push_back(p);
+  }
+
+  while(!stack.empty()) {
+    if(cursor <= stack.back()->last) {
+      emit(cursor, stack.back()->last, stack.back());
+      cursor = (u_int64_t)stack.back()->last + 1;
+    }
+
+    stack.pop_back();
+  }
+}
+
+/* *************************************** */
+
+CategoryDB* CategoryDBBuilder::compile() {
+  std::vector<category_db_ipv4_range> ranges;
+  category_db_host_slot *slots;
+  category_db_header *hdr;
+  u_int32_t num_slots = 0, *lists;
+  u_int64_t size;
+  u_int32_t strings_len;
+  struct timeval begin, end;
+  CategoryDB *db = NULL;
+  u_char *image;
+
+  gettimeofday(&begin, NULL);
+
+  flattenPrefixes(&ranges);
+
+  if(!hosts.empty())
+    for(num_slots = 16; num_slots < 2 * hosts.size(); num_slots <<= 1) ;
+
+  strings_len = pool.size();
+  for(u_int i = 0; i < list_names.size(); i++)
+    strings_len += list_names[i].size() + 1;
+
+  size = CATEGORY_DB_ALIGN(sizeof(category_db_header));
+  size += CATEGORY_DB_ALIGN(ranges.size() * sizeof(category_db_ipv4_range));
+  size += CATEGORY_DB_ALIGN(num_slots * sizeof(category_db_host_slot));
+  size += CATEGORY_DB_ALIGN(list_names.size() * sizeof(u_int32_t));
+  size += CATEGORY_DB_ALIGN(strings_len);
+
+  if((size > 0xFFFFFFFF) || ((image = (u_char*)calloc(1, size)) == NULL)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory for the category lists");
+    return(NULL);
+  }
+
+  hdr = (category_db_header*)image;
+  hdr->magic = CATEGORY_DB_MAGIC, hdr->version = CATEGORY_DB_VERSION, hdr->size = size;
+
+  hdr->num_ipv4 = ranges.size();
+  hdr->ipv4_offset = CATEGORY_DB_ALIGN(sizeof(category_db_header));
+  if(!ranges.empty())
+    memcpy(&image[hdr->ipv4_offset], ranges.data(), ranges.size() * sizeof(category_db_ipv4_range));
+
+  /* Hosts: a later entry with the same name replaces the previous one */
+  hdr->num_host_slots = num_slots, hdr->num_hosts = 0;
+  hdr->host_slots_offset = hdr->ipv4_offset + CATEGORY_DB_ALIGN(ranges.size() * sizeof(category_db_ipv4_range));
+  slots = (category_db_host_slot*)&image[hdr->host_slots_offset];
+
+  for(std::vector<host_entry>::const_iterator it = hosts.begin(); it != hosts.end(); ++it) {
+    const char *name = &pool[it->name];
+    u_int32_t h = CategoryDB::hashName(name, it->len), i = h & (num_slots - 1);
+
+    while(slots[i].name != 0) {
+      if((slots[i].hash == h) && !strcmp(&pool[slots[i].name], name))
+	break;
+
+      i = (i + 1) & (num_slots - 1);
+    }
+
+    if(slots[i].name == 0) hdr->num_hosts++;
+
+    slots[i].name = it->name, slots[i].hash = h;
+    slots[i].category = it->category, slots[i].list_id = it->list_id;
+  }
+
+  hdr->num_lists = list_names.size();
+  hdr->lists_offset = hdr->host_slots_offset + CATEGORY_DB_ALIGN(num_slots * sizeof(category_db_host_slot));
+  lists = (u_int32_t*)&image[hdr->lists_offset];
+
+  hdr->strings_offset = hdr->lists_offset + CATEGORY_DB_ALIGN(list_names.size() * sizeof(u_int32_t));
+  hdr->strings_len = strings_len;
+  memcpy(&image[hdr->strings_offset], pool.data(), pool.size());
+
+  for(u_int i = 0, offset = pool.size(); i < list_names.size(); i++) {
+    lists[i] = offset;
+    memcpy(&image[hdr->strings_offset + offset], list_names[i].c_str(), list_names[i].size() + 1);
+    offset += list_names[i].size() + 1;
+  }
+
+  gettimeofday(&end, NULL);
+
+  try {
+    db = new CategoryDB(image, (u_int32_t)Utils::msTimevalDiff(&end, &begin));
+  } catch(...) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Internal error: invalid category lists image");
+    free(image);
+    db = NULL;
+  }
+
+  return(db);
+}
+
+/* *************************************** */
@@ -21,6 +21,14 @@
 
 #include "ntop_includes.h"
 
+/* Not a static member initializer: Utils::gettickspersec() sleeps, and the
+   static initialization order across translation units is not guaranteed */
+static ticks getTicksPerSec() {
+  static ticks tps = Utils::gettickspersec();
+
+  return(tps);
+}
+
 /* **************************************************** */
 
 Check::Check(NtopngEdition _edition, bool _packet_interface_only, bool _nedge_exclude, bool _nedge_only) {
@@ -29,6 +37,13 @@ Check::Check(NtopngEdition _edition, bool _packet_interface_only, bool _nedge_ex
   nedge_exclude = _nedge_exclude;
   nedge_only = _nedge_only;
   enabled = false;
+
+  stats.num_calls = stats.num_throttled = stats.tot_ticks = stats.max_ticks = 0;
+  for(int i = 0; i < CHECK_STATS_NUM_BUCKETS; i++) stats.hist[i] = 0;
+
+  budget.cpu_usec_per_sec = 0;
+  budget.throttle_rate = 1, budget.skip = 0, budget.last_usage_usec = 0;
+  budget.window_begin = 0, budget.window_ticks = 0, budget.num_exceeded = 0;
 };
 
 /* **************************************************** */
@@ -76,3 +91,120 @@ bool Check::isCheckCompatibleWithInterface(NetworkInterface *iface) {
 
   return(true);
 }
+
+/* **************************************************** */
+
+void Check::setCpuBudget(u_int32_t cpu_usec_per_sec) {
+  budget.cpu_usec_per_sec = cpu_usec_per_sec;
+
+  if(cpu_usec_per_sec == 0)
+    budget.throttle_rate = 1;
+  else
+    getTicksPerSec(); /* Computed while loading, not on the first packet */
+}
+
+/* **************************************************** */
+
+void Check::incStats(ticks t) {
+  int bucket = (t > 1) ? (63 - __builtin_clzll(t)) : 0;
+  u_int64_t max_ticks = stats.max_ticks;
+
+  stats.num_calls++, stats.tot_ticks += t;
+  stats.hist[min_val(bucket, CHECK_STATS_NUM_BUCKETS - 1)]++;
+
+  while((t > max_ticks) && !stats.max_ticks.compare_exchange_weak(max_ticks, t))
+    ;
+
+  if(budget.cpu_usec_per_sec > 0)
+    checkBudget(t);
+}
+
+/* **************************************************** */
+
+/*
+  The CPU used by the check is measured over 1 sec windows. When it exceeds the
+  budget, the throttle rate is doubled (up to CHECK_MAX_THROTTLE_RATE); when it
+  drops below half the budget, the rate is halved for every elapsed window until
+  the check runs on every entity again. Also called with t = 0 when the stats are
+  read, so that checks no longer called are not left throttled.
+*/
+void Check::checkBudget(ticks t) {
+  ticks now = Utils::getticks(), tickspersec = getTicksPerSec();
+  u_int64_t begin = budget.window_begin, elapsed = now - begin, used_usec, num_windows;
+  u_int32_t rate;
+
+  budget.window_ticks += t;
+
+  if(elapsed < tickspersec)
+    return;
+
+  /* Only one thread closes the window */
+  if(!budget.window_begin.compare_exchange_strong(begin, now))
+    return;
+
+  if(begin == 0) {
+    /* First call */
+    budget.window_ticks = 0;
+    return;
+  }
+
+  used_usec = (budget.window_ticks.exchange(0) * 1000000) / elapsed;
+  budget.last_usage_usec = (u_int32_t)min_val(used_usec, (u_int64_t)0xFFFFFFFF);
+  rate = budget.throttle_rate;
+
+  if(used_usec > budget.cpu_usec_per_sec) {
+    if(rate < CHECK_MAX_THROTTLE_RATE) {
+      budget.throttle_rate = rate * 2;
+
+      if(rate == 1) {
+	budget.num_exceeded++;
+	ntop->getTrace()->traceEvent(TRACE_WARNING, "Check %s exceeded its CPU budget [%llu/%u usec/sec]: throttling it",
+				     getName().c_str(), (unsigned long long)used_usec, budget.cpu_usec_per_sec);
+      }
+    }
+  } else if((rate > 1) && (used_usec < (budget.cpu_usec_per_sec / 2))) {
+    num_windows = min_val(elapsed / tickspersec, (u_int64_t)31);
+    budget.throttle_rate = max_val(rate >> num_windows, 1u);
+  }
+}
+
+/* **************************************************** */
+
+void Check::luaStats(lua_State *vm) {
+  u_int64_t num_calls = stats.num_calls, tot_ticks = stats.tot_ticks;
+  ticks tickspersec = getTicksPerSec();
+
+  lua_newtable(vm);
+
+  /* Kept in nsec for compatibility with CHECKS_PROFILING */
+  lua_push_uint64_table_entry(vm, "execution_time", (u_int64_t)((tot_ticks * 1000000000.) / tickspersec));
+  lua_push_uint64_table_entry(vm, "num_calls", num_calls);
+  lua_push_uint64_table_entry(vm, "num_throttled", stats.num_throttled);
+  lua_push_uint64_table_entry(vm, "avg_cycles", num_calls ? (tot_ticks / num_calls) : 0);
+  lua_push_uint64_table_entry(vm, "max_cycles", stats.max_ticks);
+
+  lua_newtable(vm);
+
+  for(int i = 0; i < CHECK_STATS_NUM_BUCKETS; i++) {
+    lua_pushinteger(vm, i + 1);
+    lua_pushinteger(vm, stats.hist[i]);
+    lua_settable(vm, -3);
+  }
+
+  lua_pushstring(vm, "histogram");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+
+  if(budget.cpu_usec_per_sec > 0) {
+    checkBudget(0);
+
+    lua_push_uint32_table_entry(vm, "cpu_budget_usec", budget.cpu_usec_per_sec);
+    lua_push_uint32_table_entry(vm, "cpu_usage_usec", budget.last_usage_usec);
+    lua_push_uint32_table_entry(vm, "throttle_rate", budget.throttle_rate);
+    lua_push_uint64_table_entry(vm, "num_budget_exceeded", budget.num_exceeded);
+  }
+
+  lua_pushstring(vm, "stats");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
@@ -40,3 +40,17 @@ ChecksLoader::ChecksLoader(){
 
 ChecksLoader::~ChecksLoader() {
 }
+
+/* **************************************************** */
+
+u_int32_t ChecksLoader::getCpuBudget(json_object *hook_config) {
+  json_object *json_budget;
+  int64_t budget;
+
+  if(!json_object_object_get_ex(hook_config, "cpu_budget_usec", &json_budget))
+    return(0);
+
+  budget = json_object_get_int64(json_budget);
+
+  return((budget > 0) ? (u_int32_t)min_val(budget, (int64_t)1000000) : 0);
+}
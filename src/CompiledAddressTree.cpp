@@ -0,0 +1,213 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* *************************************** */
+
+CompiledAddressTree::CompiledAddressTree() {
+  v4.max_bits = 32, v4.stride = COMPILED_TREE_IPV4_STRIDE, v4.root = NULL;
+  v6.max_bits = 128, v6.stride = COMPILED_TREE_IPV6_STRIDE, v6.root = NULL;
+  num_prefixes = 0, build_msec = 0;
+}
+
+/* *************************************** */
+
+CompiledAddressTree::~CompiledAddressTree() {
+  if(v4.root) free(v4.root);
+  if(v6.root) free(v6.root);
+}
+
+/* *************************************** */
+
+/* Sets the entry, or all the entries of its subtree, to the (longer) prefix leaf */
+void CompiledAddressTree::fill(compiled_lpm *lpm, u_int32_t *entry, u_int32_t leaf) {
+  if(*entry & COMPILED_TREE_CHILD) {
+    u_int32_t first = (*entry & ~COMPILED_TREE_CHILD) << lpm->stride;
+
+    for(u_int32_t i = 0; i < (1U << lpm->stride); i++)
+      fill(lpm, &lpm->nodes[first + i], leaf);
+  } else
+    *entry = leaf;
+}
+
+/* *************************************** */
+
+/* Prefixes must be inserted by increasing length */
+bool CompiledAddressTree::insert(compiled_lpm *lpm, const u_int8_t *prefix, u_int8_t bits, u_int32_t leaf) {
+  u_int32_t span, first, node_id, *entry;
+  u_int8_t offset = COMPILED_TREE_ROOT_BITS;
+
+  if(bits > lpm->max_bits)
+    return(false);
+
+  first = (prefix[0] << 8) | prefix[1];
+
+  if(bits <= COMPILED_TREE_ROOT_BITS) {
+    span = COMPILED_TREE_ROOT_BITS - bits;
+    first = (first >> span) << span;
+
+    for(u_int32_t i = 0; i < (1U << span); i++)
+      fill(lpm, &lpm->root[first + i], leaf);
+
+    return(true);
+  }
+
+  entry = &lpm->root[first];
+
+  while(true) {
+    if(!(*entry & COMPILED_TREE_CHILD)) {
+      /* New node: inherits the (shorter) prefix of the entry it replaces */
+      u_int32_t pushed = *entry;
+
+      node_id = lpm->nodes.size() >> lpm->stride;
+
+      if(node_id >= COMPILED_TREE_LEAF)
+	return(false);
+
+      /* Indexes are used from now on as the resize can move the nodes */
+      if(offset == COMPILED_TREE_ROOT_BITS)
+	lpm->root[first] = COMPILED_TREE_CHILD | node_id;
+      else
+	lpm->nodes[first] = COMPILED_TREE_CHILD | node_id;
+
+      lpm->nodes.resize(lpm->nodes.size() + (1U << lpm->stride), pushed);
+    } else
+      node_id = *entry & ~COMPILED_TREE_CHILD;
+
+    if(bits <= (offset + lpm->stride)) {
+      span = offset + lpm->stride - bits;
+      first = (node_id << lpm->stride) + ((getStride(prefix, offset, lpm->stride) >> span) << span);
+
+      for(u_int32_t i = 0; i < (1U << span); i++)
+	fill(lpm, &lpm->nodes[first + i], leaf);
+
+      return(true);
+    }
+
+    first = (node_id << lpm->stride) + getStride(prefix, offset, lpm->stride);
+    entry = &lpm->nodes[first];
+    offset += lpm->stride;
+  }
+}
+
+/* *************************************** */
+
+typedef struct {
+  u_int8_t addr[16];
+  u_int8_t bits;
+  u_int16_t value;
+} compiled_tree_prefix;
+
+typedef struct {
+  std::vector<compiled_tree_prefix> v4, v6;
+} compiled_tree_prefixes;
+
+static bool compiled_tree_prefix_cmp(const compiled_tree_prefix &a, const compiled_tree_prefix &b) {
+  return(a.bits < b.bits);
+}
+
+/* *************************************** */
+
+void CompiledAddressTree::compile_walker(ndpi_patricia_node_t *node, void *data, void *user_data) {
+  compiled_tree_prefixes *prefixes = (compiled_tree_prefixes*)user_data;
+  compiled_tree_prefix p;
+  ndpi_prefix_t *prefix;
+
+  if(!node || !(prefix = ndpi_patricia_get_node_prefix(node)))
+    return;
+
+  memset(&p, 0, sizeof(p));
+  p.bits = prefix->bitlen, p.value = (u_int16_t)ndpi_patricia_get_node_u64(node);
+
+  if(prefix->family == AF_INET) {
+    memcpy(p.addr, &prefix->add.sin, 4);
+    prefixes->v4.push_back(p);
+  } else if(prefix->family == AF_INET6) {
+    memcpy(p.addr, &prefix->add.sin6, 16);
+    prefixes->v6.push_back(p);
+  }
+}
+
+/* *************************************** */
+
+CompiledAddressTree* CompiledAddressTree::compile(const AddressTree *tree) {
+  CompiledAddressTree *c;
+  compiled_tree_prefixes prefixes;
+  struct {
+    compiled_lpm *lpm;
+    std::vector<compiled_tree_prefix> *prefixes;
+  } families[2];
+  struct timeval begin, end;
+
+  if(!tree || ((c = new (std::nothrow) CompiledAddressTree()) == NULL))
+    return(NULL);
+
+  gettimeofday(&begin, NULL);
+
+  tree->walk(compile_walker, &prefixes);
+
+  families[0].lpm = &c->v4, families[0].prefixes = &prefixes.v4;
+  families[1].lpm = &c->v6, families[1].prefixes = &prefixes.v6;
+
+  try {
+    for(int f = 0; f < 2; f++) {
+      compiled_lpm *lpm = families[f].lpm;
+      std::vector<compiled_tree_prefix> *p = families[f].prefixes;
+
+      if(p->empty())
+	continue;
+
+      if((lpm->root = (u_int32_t*)calloc(1 << COMPILED_TREE_ROOT_BITS, sizeof(u_int32_t))) == NULL)
+	throw std::bad_alloc();
+
+      /* Longer prefixes overwrite the shorter ones they are nested into */
+      std::stable_sort(p->begin(), p->end(), compiled_tree_prefix_cmp);
+
+      for(std::vector<compiled_tree_prefix>::const_iterator it = p->begin(); it != p->end(); ++it) {
+	if(insert(lpm, it->addr, it->bits, COMPILED_TREE_LEAF | (it->bits << 16) | it->value))
+	  c->num_prefixes++;
+      }
+    }
+  } catch(std::bad_alloc& ba) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory to compile the address tree");
+    delete c;
+    return(NULL);
+  }
+
+  gettimeofday(&end, NULL);
+  c->build_msec = (u_int32_t)Utils::msTimevalDiff(&end, &begin);
+
+  return(c);
+}
+
+/* *************************************** */
+
+u_int64_t CompiledAddressTree::getMemory() const {
+  u_int64_t mem = sizeof(*this);
+
+  if(v4.root) mem += (1 << COMPILED_TREE_ROOT_BITS) * sizeof(u_int32_t);
+  if(v6.root) mem += (1 << COMPILED_TREE_ROOT_BITS) * sizeof(u_int32_t);
+
+  mem += (v4.nodes.capacity() + v6.nodes.capacity()) * sizeof(u_int32_t);
+
+  return(mem);
+}
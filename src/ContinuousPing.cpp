@@ -19,6 +19,7 @@
  *
  */
 
+
 #ifndef WIN32
 
 #include "ntop_includes.h"
@@ -27,6 +28,8 @@
 
 // #define TRACE_PING
 
+#define CPING_PACKET_SIZE  64
+
 /*
   Usage example (minute.lua):
 
@@ -37,16 +40,42 @@
   tprint(ntop.collectPingResults(true))
 */
 
+/* The echo payload identifies the target: replies are matched without lookups */
+struct cping_packet {
+  struct ndpi_icmphdr hdr;
+  u_int32_t target_id;
+  u_int16_t generation, pad;
+  struct timeval sent;
+  char msg[CPING_PACKET_SIZE - sizeof(struct ndpi_icmphdr) - 8 - sizeof(struct timeval)];
+};
+
+/* Echo requests to be sent on a socket */
+struct cping_batch {
+  u_int num;
+  struct cping_packet pkts[CONTINUOUS_PING_BATCH_LEN];
+  cping_sockaddr addrs[CONTINUOUS_PING_BATCH_LEN];
+#ifdef __linux__
+  struct iovec iov[CONTINUOUS_PING_BATCH_LEN];
+  struct mmsghdr msgs[CONTINUOUS_PING_BATCH_LEN];
+#endif
+};
+
+/* Replies read at once */
+struct cping_rx {
+  u_char bufs[CONTINUOUS_PING_BATCH_LEN][256];
+  cping_sockaddr addrs[CONTINUOUS_PING_BATCH_LEN];
+#ifdef __linux__
+  struct iovec iov[CONTINUOUS_PING_BATCH_LEN];
+  struct mmsghdr msgs[CONTINUOUS_PING_BATCH_LEN];
+#endif
+};
+
 /* ****************************************** */
 
 static void* pollerFctn(void* ptr) {
-  ContinuousPing *cp = (ContinuousPing*)ptr;
-
   Utils::setThreadName("cping");
 
-  while((!ntop->getGlobals()->isShutdownRequested())
-	&& (!ntop->getGlobals()->isShutdown()))
-    cp->runPingCampaign();
+  ((ContinuousPing*)ptr)->run();
 
 #ifdef TRACE_PING
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Leaving %s()", __FUNCTION__);
@@ -61,7 +90,10 @@ ContinuousPing::ContinuousPing() {
   ntop_if_t *devpointer, *cur;
 
   started = false;
-  
+  rx = NULL;
+  interval_ticks = max_val(CONTINUOUS_PING_INTERVAL_MSEC / CONTINUOUS_PING_TICK_MSEC, 1);
+  wheel = new TimerWheel(getTick());
+
   /* Create default pinger */
   try {
     default_pinger = new Ping(NULL);
@@ -105,20 +137,38 @@ ContinuousPing::ContinuousPing() {
     Utils::ntop_freealldevs(devpointer);
   }
 
+  if(default_pinger) {
+    pingers.push_back(default_pinger);
+
+    for(std::map<std::string,Ping*>::iterator it=if_pinger.begin(); it!=if_pinger.end(); ++it) {
+      if(pingers.size() > 0xFF) break; /* Index is a u_int8_t */
+      pingers.push_back(it->second);
+    }
+
+    for(u_int i = 0; i < 2 * pingers.size(); i++)
+      batches.push_back(new cping_batch);
+
+    rx = new cping_rx;
+  }
 }
 
 /* ***************************************** */
 
 ContinuousPing::~ContinuousPing() {
-  for(std::map<std::string,ContinuousPingStats*>::iterator it=v4_results.begin(); it!=v4_results.end(); ++it)
-    delete it->second;
-
-  for(std::map<std::string,ContinuousPingStats*>::iterator it=v6_results.begin(); it!=v6_results.end(); ++it)
-    delete it->second;
-
   if(started)
     pthread_join(poller, NULL);
 
+  for(std::vector<cping_target*>::iterator it = targets.begin(); it != targets.end(); ++it) {
+    if((*it)->stats) delete (*it)->stats;
+    delete *it;
+  }
+
+  for(std::vector<cping_batch*>::iterator it = batches.begin(); it != batches.end(); ++it)
+    delete *it;
+
+  if(rx) delete rx;
+  delete wheel;
+
   for(std::map<std::string,Ping*>::iterator it=if_pinger.begin(); it!=if_pinger.end(); ++it)
     delete it->second;
 
@@ -130,64 +180,80 @@ ContinuousPing::~ContinuousPing() {
 void ContinuousPing::start() {
   if(!started) {
     if(default_pinger)
-      pthread_create(&poller, NULL, pollerFctn, (void*)this);    
-    
+      pthread_create(&poller, NULL, pollerFctn, (void*)this);
+
     started = true;
   }
 }
 
 /* ***************************************** */
 
+u_int64_t ContinuousPing::getTick() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return(((u_int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000) / CONTINUOUS_PING_TICK_MSEC);
+}
+
+/* ***************************************** */
+
 /* Add a new host or refresh the existing one */
 void ContinuousPing::ping(char *_addr, bool use_v6, char *ifname) {
+  std::unordered_map<std::string, u_int32_t> *known = use_v6 ? &v6_targets : &v4_targets;
+  std::unordered_map<std::string, u_int32_t>::iterator it;
   std::string key = std::string(_addr);
-  std::map<std::string,ContinuousPingStats*>::iterator it;
-  Ping *pinger = default_pinger;
+  u_int8_t pinger_idx = 0;
+  u_char addr[sizeof(struct in6_addr)];
+
+  if(!default_pinger)
+    return;
 
   /* Get the pinger for the interface, if exists */
-  if (ifname) {
-    std::string key = std::string(ifname);
-    std::map<std::string, Ping*>::iterator it;
-    
-    it = if_pinger.find(key); 
-    if(it != if_pinger.end()) {
-      //ntop->getTrace()->traceEvent(TRACE_NORMAL, "Using pinger for %s", ifname);
-      pinger = it->second;
+  if(ifname) {
+    std::map<std::string, Ping*>::iterator p = if_pinger.find(std::string(ifname));
+
+    if(p != if_pinger.end()) {
+      for(u_int i = 1; i < pingers.size(); i++) {
+	if(pingers[i] == p->second) {
+	  pinger_idx = i;
+	  break;
+	}
+      }
     }
   }
 
   m.lock(__FILE__, __LINE__);
 
-  if(!use_v6) {
-    it = v4_results.find(key);
-
-    if(it != v4_results.end()) {
-      /* Already present */
-#ifdef TRACE_PING
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Refreshing %s", _addr);
-#endif
-      it->second->heartbeat();
-    } else {
-      v4_results[key] = new (std::nothrow) ContinuousPingStats(pinger);
+  if((it = known->find(key)) != known->end()) {
+    /* Already present */
 #ifdef TRACE_PING
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Adding host to ping %s", _addr);
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Refreshing %s", _addr);
 #endif
-    }
-  } else {
-    it = v6_results.find(key);
+    targets[it->second]->stats->heartbeat();
+    m.unlock(__FILE__, __LINE__);
+    return;
+  }
 
-    if(it != v6_results.end()) {
-      /* Already present */
-#ifdef TRACE_PING
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Refreshing %s", _addr);
-#endif
-      it->second->heartbeat();
-    } else {
-      v6_results[key] = new (std::nothrow) ContinuousPingStats(pinger);
+  m.unlock(__FILE__, __LINE__);
+
+  /* Resolved out of the lock */
+  if(inet_pton(use_v6 ? AF_INET6 : AF_INET, _addr, addr) != 1) {
+    struct hostent *hname = gethostbyname2(_addr, use_v6 ? AF_INET6 : AF_INET);
+
+    if(hname == NULL)
+      return;
+
+    memcpy(addr, hname->h_addr_list[0], use_v6 ? sizeof(struct in6_addr) : sizeof(struct in_addr));
+  }
+
+  m.lock(__FILE__, __LINE__);
+
+  if(known->find(key) == known->end()) {
 #ifdef TRACE_PING
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Adding host to ping %s", _addr);
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Adding host to ping %s", _addr);
 #endif
-    }
+    addTarget(_addr, use_v6, addr, pinger_idx);
   }
 
   m.unlock(__FILE__, __LINE__);
@@ -195,227 +261,414 @@ void ContinuousPing::ping(char *_addr, bool use_v6, char *ifname) {
 
 /* ***************************************** */
 
-void ContinuousPing::pingAll() {
-  time_t last_beat, topurge = time(NULL) - 90 /* sec */;
-  bool todiscard = false;
+/* Locked */
+void ContinuousPing::addTarget(const char *name, bool v6, const void *addr, u_int8_t pinger_idx) {
+  ContinuousPingStats *stats = new (std::nothrow) ContinuousPingStats(pingers[pinger_idx]);
+  cping_target *t;
+  u_int32_t id;
 
-#ifdef TRACE_PING
-  ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s()", __FUNCTION__);
-#endif
-  
-  m.lock(__FILE__, __LINE__);
+  if(stats == NULL)
+    return;
 
-  default_pinger->cleanup();
-  for(std::map<std::string, Ping*>::iterator it=if_pinger.begin(); it!=if_pinger.end(); ++it)
-    it->second->cleanup();
+  if(!free_ids.empty()) {
+    id = free_ids.back(), free_ids.pop_back();
+    t = targets[id];
+    t->generation++; /* dirty is kept: the id may still be queued */
+  } else {
+    if((t = new (std::nothrow) cping_target) == NULL) {
+      delete stats;
+      return;
+    }
 
-  v4_pinged.clear();
-  v6_pinged.clear();
-  
-  for(std::map<std::string,ContinuousPingStats*>::iterator it=v4_results.begin(); it!=v4_results.end(); ++it) {
-    it->second->getPinger()->ping((char*)it->first.c_str(), false);
-    v4_pinged[it->first] = true;
-    
-    last_beat = it->second->getLastHeartbeat();
+    id = targets.size();
+    t->generation = 0, t->dirty = false;
+    targets.push_back(t);
+  }
 
-    if((last_beat > 0) && (last_beat < topurge))
-      inactiveHostsV4.push_back(it->first), todiscard = true;
+  t->name = name, t->v6 = v6, t->active = true;
+  t->pinger_idx = pinger_idx, t->seq = 0, t->awaiting_reply = false;
+  t->stats = stats;
 
-#ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Pinging host %s [last: %d][diff: %d]",
-				 (char*)it->first.c_str(), last_beat, last_beat-topurge);
-#endif
+  memset(&t->addr, 0, sizeof(t->addr));
+
+  if(v6) {
+    t->addr.sin6.sin6_family = AF_INET6;
+    memcpy(&t->addr.sin6.sin6_addr, addr, sizeof(struct in6_addr));
+    v6_targets[t->name] = id;
+  } else {
+    t->addr.sin.sin_family = AF_INET;
+    memcpy(&t->addr.sin.sin_addr, addr, sizeof(struct in_addr));
+    v4_targets[t->name] = id;
   }
 
-  for(std::map<std::string,ContinuousPingStats*>::iterator it=v6_results.begin(); it!=v6_results.end(); ++it) {
-    it->second->getPinger()->ping((char*)it->first.c_str(), true);
-    v6_pinged[it->first] = true;
-    last_beat = it->second->getLastHeartbeat();
+  /* Spread the targets over the interval */
+  t->next_tick = wheel->getCurrentTick() + 1 + (rand() % interval_ticks);
+  wheel->schedule(id, t->next_tick);
+}
+
+/* ***************************************** */
 
-    if((last_beat > 0) && (last_beat < topurge))
-      inactiveHostsV6.push_back(it->first), todiscard = true;;
+/* Locked */
+void ContinuousPing::removeTarget(u_int32_t target_id) {
+  cping_target *t = targets[target_id];
 
 #ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Pinging host %s [last: %d][diff: %d]",
-				 (char*)it->first.c_str(), last_beat, last_beat-topurge);
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "[%s] Discarding host %s", t->v6 ? "v6" : "v4", t->name.c_str());
 #endif
+
+  if(t->v6)
+    v6_targets.erase(t->name);
+  else
+    v4_targets.erase(t->name);
+
+  delete t->stats;
+  t->stats = NULL, t->active = false;
+
+  /* Its timer is discarded when it expires */
+  free_ids.push_back(target_id);
+}
+
+/* ***************************************** */
+
+/*
+  Discard hosts for which there is not recent hearthbeat
+  as they have not been refreshed by the GUI and thus tha
+  have been deleted
+ */
+void ContinuousPing::purgeInactiveTargets(time_t now) {
+  for(u_int32_t id = 0; id < targets.size(); id++) {
+    cping_target *t = targets[id];
+
+    if(t->active && (t->stats->getLastHeartbeat() < now - CONTINUOUS_PING_MAX_IDLE))
+      removeTarget(id);
   }
+}
 
-  if(todiscard)
-    cleanupInactiveHosts();
-  
-  m.unlock(__FILE__, __LINE__);
+/* ***************************************** */
+
+void ContinuousPing::markDirty(u_int32_t target_id, cping_target *t) {
+  if(!t->dirty) {
+    t->dirty = true;
+    dirty.push_back(target_id);
+  }
 }
 
 /* ***************************************** */
 
-void ContinuousPing::readPingResults() {
-  m.lock(__FILE__, __LINE__);
+/* Locked: sends the echo requests of the targets due up to now_tick */
+void ContinuousPing::sendDue(u_int64_t now_tick) {
+  struct timeval now;
 
-#ifdef TRACE_PING
-  ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s()", __FUNCTION__);
-#endif
-  
-  for(std::map<std::string,ContinuousPingStats*>::iterator it=v4_results.begin(); it!=v4_results.end(); ++it) {
-    float f = it->second->getPinger()->getRTT(it->first.c_str(), false /* v6 */);
+  expired.clear();
+  wheel->advance(now_tick, &expired);
 
-#ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s() [IPv4] %s=%f", __FUNCTION__, it->first.c_str(), f);
-#endif
+  if(expired.empty())
+    return;
 
-    if(f != -1)
-      it->second->update(f), v4_pinged.erase(it->first);
-    else {
-      it->second->incSent();
+  gettimeofday(&now, NULL);
+
+  for(std::vector<u_int32_t>::iterator it = expired.begin(); it != expired.end(); ++it) {
+    cping_target *t = targets[*it];
+    Ping *pinger;
+    cping_batch *b;
+    cping_packet *p;
+
+    if((!t->active) || (t->next_tick > now_tick))
+      continue; /* Stale timer of a removed (or recycled) target */
+
+    t->next_tick += interval_ticks;
+    if(t->next_tick <= now_tick) t->next_tick = now_tick + interval_ticks; /* Late */
+    wheel->schedule(*it, t->next_tick);
+
+    pinger = pingers[t->pinger_idx];
+
+    if(pinger->getSocket(t->v6) < 0)
+      continue;
+
+    if(t->awaiting_reply) {
+      /* The previous request got no reply */
+      t->stats->incSent();
 #ifdef TRACE_PING_DROPS
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "[IPv4] Missing ping response for %s", it->first.c_str());
+      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Missing ping response for %s", t->name.c_str());
 #endif
     }
+
+    t->seq++, t->awaiting_reply = true;
+    markDirty(*it, t);
+
+    b = batches[t->pinger_idx * 2 + (t->v6 ? 1 : 0)];
+    p = &b->pkts[b->num];
+
+    memset(p, 0, sizeof(*p));
+    p->hdr.type = t->v6 ? ICMP6_ECHO_REQUEST : ICMP_ECHO;
+    p->hdr.un.echo.id = htons(pinger->getPingId());
+    p->hdr.un.echo.sequence = htons(t->seq);
+    p->target_id = *it, p->generation = t->generation, p->sent = now;
+    p->hdr.checksum = Ping::checksum(p, sizeof(*p));
+    b->addrs[b->num] = t->addr;
+
+    if(++b->num == CONTINUOUS_PING_BATCH_LEN)
+      flushBatch(b, pinger->getSocket(t->v6), t->v6);
   }
 
-  for(std::map<std::string,ContinuousPingStats*>::iterator it=v6_results.begin(); it!=v6_results.end(); ++it) {
-    float f = it->second->getPinger()->getRTT(it->first.c_str(), true /* v6 */);
+  for(u_int i = 0; i < batches.size(); i++) {
+    if(batches[i]->num > 0)
+      flushBatch(batches[i], pingers[i / 2]->getSocket(i & 1), i & 1);
+  }
+}
 
-#ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s() [IPv6] %s=%f", __FUNCTION__, it->first.c_str(), f);
-#endif
+/* ***************************************** */
+
+void ContinuousPing::flushBatch(cping_batch *b, int sock, bool v6) {
+  socklen_t addr_len = v6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+
+#ifdef __linux__
+  u_int sent = 0;
 
-    if(f != -1)
-      it->second->update(f), v6_pinged.erase(it->first);
+  for(u_int i = 0; i < b->num; i++) {
+    b->iov[i].iov_base = &b->pkts[i], b->iov[i].iov_len = sizeof(cping_packet);
+    memset(&b->msgs[i], 0, sizeof(b->msgs[i]));
+    b->msgs[i].msg_hdr.msg_name = &b->addrs[i], b->msgs[i].msg_hdr.msg_namelen = addr_len;
+    b->msgs[i].msg_hdr.msg_iov = &b->iov[i], b->msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  while(sent < b->num) {
+    int rc = sendmmsg(sock, &b->msgs[sent], b->num - sent, 0);
+
+    if(rc > 0)
+      sent += rc;
     else {
-      it->second->incSent();
-#ifdef TRACE_PING_DROPS
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "[IPv6] Missing ping response for %s", it->first.c_str());
+      /* e.g. unreachable network: skip the failing request, it will be accounted as lost */
+#ifdef TRACE_PING
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to send ping [%s]", strerror(errno));
 #endif
+      sent++;
     }
   }
+#else
+  for(u_int i = 0; i < b->num; i++)
+    sendto(sock, &b->pkts[i], sizeof(cping_packet), 0, (struct sockaddr*)&b->addrs[i], addr_len);
+#endif
 
-  m.unlock(__FILE__, __LINE__);
+  b->num = 0;
 }
 
 /* ***************************************** */
 
-void ContinuousPing::collectProtoResponse(lua_State* vm, std::map<std::string,ContinuousPingStats*> *w) {
-  for(std::map<std::string,ContinuousPingStats*>::iterator it=w->begin(); it!=w->end(); ++it) {
-    if(it->first.c_str()[0]) {
-      float min_rtt, max_rtt, jitter, mean;
-	
-      lua_newtable(vm);
-
-      lua_push_float_table_entry(vm, "response_rate",
-				 it->second->getSuccessRate(&min_rtt, &max_rtt, &jitter, &mean));
-      lua_push_float_table_entry(vm, "min_rtt",  min_rtt);
-      lua_push_float_table_entry(vm, "max_rtt",  max_rtt);
-      lua_push_float_table_entry(vm, "jitter",   jitter);
-      lua_push_float_table_entry(vm, "mean",     mean);
-
-      lua_pushstring(vm, it->first.c_str());
-      lua_insert(vm, -2);
-      lua_settable(vm, -3);
+void ContinuousPing::readReplies(int sock, bool v6, Ping *pinger) {
+  struct timeval now;
+  int num;
 
-      it->second->reset();
-    }
+#ifdef __linux__
+  for(u_int i = 0; i < CONTINUOUS_PING_BATCH_LEN; i++) {
+    rx->iov[i].iov_base = rx->bufs[i], rx->iov[i].iov_len = sizeof(rx->bufs[i]);
+    memset(&rx->msgs[i], 0, sizeof(rx->msgs[i]));
+    rx->msgs[i].msg_hdr.msg_name = &rx->addrs[i], rx->msgs[i].msg_hdr.msg_namelen = sizeof(rx->addrs[i]);
+    rx->msgs[i].msg_hdr.msg_iov = &rx->iov[i], rx->msgs[i].msg_hdr.msg_iovlen = 1;
   }
+
+  if((num = recvmmsg(sock, rx->msgs, CONTINUOUS_PING_BATCH_LEN, MSG_DONTWAIT, NULL)) <= 0)
+    return;
+
+  gettimeofday(&now, NULL);
+
+  m.lock(__FILE__, __LINE__);
+
+  for(int i = 0; i < num; i++)
+    handleReply(rx->bufs[i], rx->msgs[i].msg_len, v6, &rx->addrs[i], pinger, &now);
+
+  m.unlock(__FILE__, __LINE__);
+#else
+  socklen_t len = sizeof(rx->addrs[0]);
+
+  if((num = recvfrom(sock, rx->bufs[0], sizeof(rx->bufs[0]), MSG_DONTWAIT, (struct sockaddr*)&rx->addrs[0], &len)) <= 0)
+    return;
+
+  gettimeofday(&now, NULL);
+
+  m.lock(__FILE__, __LINE__);
+  handleReply(rx->bufs[0], num, v6, &rx->addrs[0], pinger, &now);
+  m.unlock(__FILE__, __LINE__);
+#endif
 }
 
 /* ***************************************** */
 
-void ContinuousPing::collectResponses(lua_State* vm, bool v6) {
-  std::map<std::string /* IP */, bool> * pinged = v6 ? &v6_pinged : &v4_pinged;
+/* Locked */
+void ContinuousPing::handleReply(u_char *buf, u_int len, bool v6, const void *from,
+				 Ping *pinger, const struct timeval *now) {
+  const cping_sockaddr *src = (const cping_sockaddr*)from;
+  struct cping_packet pkt;
+  cping_target *t;
 
-  /* The lua_newtable() below is added by  Ntop::collectContinuousResponses() */
-  /* lua_newtable(vm); */
+  if(!v6) {
+    /* Raw IPv4 sockets also return the IP header */
+    u_int hlen;
 
-  m.lock(__FILE__, __LINE__);
+    if(len < sizeof(struct ndpi_iphdr))
+      return;
 
-  collectProtoResponse(vm, v6 ? &v6_results : &v4_results);
+    hlen = ((struct ndpi_iphdr*)buf)->ihl * 4;
 
-  lua_newtable(vm);
+    if(len < hlen) return;
+    buf += hlen, len -= hlen;
+  }
+
+  if(len < sizeof(pkt))
+    return;
+
+  memcpy(&pkt, buf, sizeof(pkt)); /* Aligned */
 
-  for(std::map<std::string,bool>::const_iterator it = pinged->begin(); it != pinged->end(); ++it) {
+  /* Raw sockets get all the ICMP traffic: only consider the replies to this pinger */
+  if((pkt.hdr.type != (v6 ? ICMP6_ECHO_REPLY : ICMP_ECHOREPLY))
+     || (ntohs(pkt.hdr.un.echo.id) != pinger->getPingId()))
+    return;
+
+  if((pkt.target_id >= targets.size())
+     || (!(t = targets[pkt.target_id])->active)
+     || (t->generation != pkt.generation)
+     || (t->v6 != v6)
+     || (!t->awaiting_reply)
+     || (ntohs(pkt.hdr.un.echo.sequence) != t->seq)
+     || (v6 ? memcmp(&src->sin6.sin6_addr, &t->addr.sin6.sin6_addr, sizeof(struct in6_addr))
+	 : (src->sin.sin_addr.s_addr != t->addr.sin.sin_addr.s_addr))) {
 #ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_WARNING, "Missing ping response for %s", it->first.c_str());
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Received unexpected ICMP [target: %u]", pkt.target_id);
 #endif
-    
-    lua_push_bool_table_entry(vm, (const char*)it->first.c_str(), true); 
+    return; /* Late, duplicated or spoofed reply */
   }
-  
-  lua_pushstring(vm, "no_response");
-  lua_insert(vm, -2);
-  lua_settable(vm, -3);
-
-  pinged->clear();
 
-  m.unlock(__FILE__, __LINE__);
+  t->awaiting_reply = false;
+  t->stats->update(((float)Utils::usecTimevalDiff(now, &pkt.sent)) / 1000.0);
+  markDirty(pkt.target_id, t);
 }
 
 /* ***************************************** */
 
-/*
-  Discard hosts for which there is not recent hearthbeat
-  as they have not been refreshed by the GUI and thus tha
-  have been deleted
- */
-void ContinuousPing::cleanupInactiveHosts() {
-  std::vector<std::string>::iterator it;
-  std::map<std::string /* IP */, ContinuousPingStats* /* stats */>::iterator it1;
+void ContinuousPing::run() {
+  std::vector<struct pollfd> pfds;
+  std::vector<std::pair<Ping*, bool /* v6 */> > pfd_pingers;
+  time_t last_purge = time(NULL);
 
-  /* No Lock needed as this is called from a locked method */
-  
-  for(it = inactiveHostsV4.begin(); it != inactiveHostsV4.end(); ++it) {
-#ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "[v4] Discarding host %s", it->c_str());
-#endif
-    
-    if((it1 = v4_results.find(*it)) != v4_results.end()) {
-      ContinuousPingStats *s = it1->second;
+  for(std::vector<Ping*>::iterator it = pingers.begin(); it != pingers.end(); ++it) {
+    for(int v6 = 0; v6 < 2; v6++) {
+      struct pollfd pfd;
+
+      if((pfd.fd = (*it)->getSocket(v6)) < 0)
+	continue;
 
-      delete s;
+      pfd.events = POLLIN, pfd.revents = 0;
+      pfds.push_back(pfd);
+      pfd_pingers.push_back(std::make_pair(*it, v6 ? true : false));
     }
-    
-    v4_results.erase(*it);
   }
 
-  inactiveHostsV4.clear();
+  while((!ntop->getGlobals()->isShutdownRequested())
+	&& (!ntop->getGlobals()->isShutdown())) {
+    time_t now = time(NULL);
+    bool idle;
 
-  for(it = inactiveHostsV6.begin(); it != inactiveHostsV6.end(); ++it) {
-#ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "[v6] Discarding host %s", it->c_str());
-#endif
-    
-    if((it1 = v6_results.find(*it)) != v6_results.end()) {
-      ContinuousPingStats *s = it1->second;
-      
-      delete s;
+    m.lock(__FILE__, __LINE__);
+
+    if(now - last_purge >= 10)
+      purgeInactiveTargets(now), last_purge = now;
+
+    sendDue(getTick());
+    idle = v4_targets.empty() && v6_targets.empty();
+
+    m.unlock(__FILE__, __LINE__);
+
+    if(poll(pfds.data(), pfds.size(), idle ? 1000 : CONTINUOUS_PING_TICK_MSEC) <= 0)
+      continue;
+
+    for(u_int i = 0; i < pfds.size(); i++) {
+      if(pfds[i].revents & POLLIN)
+	readReplies(pfds[i].fd, pfd_pingers[i].second, pfd_pingers[i].first);
     }
-    
-    v6_results.erase(*it);
   }
-
-  inactiveHostsV6.clear();
 }
 
 /* ***************************************** */
 
-void ContinuousPing::runPingCampaign() {
-  if(v4_results.size() || v6_results.size()) {
+void ContinuousPing::collectResponses(lua_State* vm, bool v6) {
+  std::vector<std::pair<std::string, ContinuousPingStats> > results;
+  std::vector<std::string> no_response;
+  std::vector<u_int32_t> other_family;
+
+  /* The lua_newtable() below is added by  Ntop::collectContinuousResponses() */
+  /* lua_newtable(vm); */
+
+  /* Only the targets probed since the last call are copied, out of the Lua calls */
+  m.lock(__FILE__, __LINE__);
+
+  for(std::vector<u_int32_t>::iterator it = dirty.begin(); it != dirty.end(); ++it) {
+    cping_target *t = targets[*it];
+
+    if(t->active && (t->v6 != v6)) {
+      other_family.push_back(*it);
+      continue;
+    }
+
+    t->dirty = false;
+
+    if(!t->active)
+      continue;
+
+    if(t->stats->getNumRcvd() == 0)
+      no_response.push_back(t->name);
+
+    results.push_back(std::make_pair(t->name, *t->stats));
+    t->stats->reset();
+  }
+
+  dirty.swap(other_family);
+
+  m.unlock(__FILE__, __LINE__);
+
+  for(std::vector<std::pair<std::string, ContinuousPingStats> >::iterator it = results.begin(); it != results.end(); ++it) {
+    const u_int16_t *histo = it->second.getRTTHistogram();
+    float min_rtt, max_rtt, jitter, mean;
+
+    lua_newtable(vm);
+
+    lua_push_float_table_entry(vm, "response_rate",
+			       it->second.getSuccessRate(&min_rtt, &max_rtt, &jitter, &mean));
+    lua_push_float_table_entry(vm, "min_rtt",  min_rtt);
+    lua_push_float_table_entry(vm, "max_rtt",  max_rtt);
+    lua_push_float_table_entry(vm, "jitter",   jitter);
+    lua_push_float_table_entry(vm, "mean",     mean);
+
+    /* rtt_histogram[1]: < 1 msec, rtt_histogram[n]: [2^(n-2), 2^(n-1)) msec */
+    lua_newtable(vm);
+
+    for(u_int i = 0; i < CONTINUOUS_PING_RTT_BUCKETS; i++) {
+      lua_pushinteger(vm, i + 1);
+      lua_pushinteger(vm, histo[i]);
+      lua_settable(vm, -3);
+    }
+
+    lua_pushstring(vm, "rtt_histogram");
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+
+    lua_pushstring(vm, it->first.c_str());
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
+
+  lua_newtable(vm);
+
+  for(std::vector<std::string>::iterator it = no_response.begin(); it != no_response.end(); ++it) {
 #ifdef TRACE_PING
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Starting ping campaign");
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Missing ping response for %s", it->c_str());
 #endif
 
-    /* Send out pings... */
-    pingAll();
-    /* Allow a couple of seconds for results to come back... */
-    sleep(2);
-    /* Make sure there was no shutdown request signal during the sleep */
-    if(ntop->getGlobals()->isShutdownRequested()) return;
-    /* Collect ping results */
-    readPingResults();
-    sleep(1);
-  } else {
-    /* Nothing to do */
-    sleep(5);
+    lua_push_bool_table_entry(vm, it->c_str(), true);
   }
+
+  lua_pushstring(vm, "no_response");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
 }
 
 #endif /* WIN32 */
@@ -28,7 +28,15 @@
 /* ***************************************** */
 
 void ContinuousPingStats::update(float rtt) {
+  u_int bucket = 0;
+
   stats.num_ping_sent++, stats.num_ping_rcvd++;
+
+  for(float r = rtt; (r >= 1) && (bucket < CONTINUOUS_PING_RTT_BUCKETS - 1); r /= 2)
+    bucket++;
+
+  if(stats.rtt_histogram[bucket] < 0xFFFF)
+    stats.rtt_histogram[bucket]++;
   
   if(rtt > 0) {
     stats.diff_sum += fabs(stats.last_rtt - rtt);
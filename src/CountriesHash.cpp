@@ -40,9 +40,10 @@ Country* CountriesHash::get(const char *country_name, bool is_inline_call) {
     return(NULL);
   } else {
     Country *head;
+    int epoch_slot = -1;
 
     if(!is_inline_call)
-      locks[hash]->rdlock(__FILE__, __LINE__);
+      epoch_slot = enterReadSection(hash);
 
     head = (Country*)table[hash];
 
@@ -54,7 +55,7 @@ Country* CountriesHash::get(const char *country_name, bool is_inline_call) {
     }
 
     if(!is_inline_call)
-      locks[hash]->unlock(__FILE__, __LINE__);
+      exitReadSection(hash, epoch_slot);
 
     return(head);
   }
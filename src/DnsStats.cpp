@@ -178,6 +178,41 @@ void DnsStats::deserialize(json_object *o) {
 
 /* ******************************************* */
 
+/* The queries breakdown is stored as HOST_SNAPSHOT_DNS_COUNTERS - 3 consecutive u_int32_t */
+void DnsStats::getSnapshotStats(struct dns_stats *stats, u_int32_t *s) {
+  s[0] = stats->num_queries.get(), s[1] = stats->num_replies_ok.get(), s[2] = stats->num_replies_error.get();
+  memcpy(&s[3], &stats->breakdown, sizeof(stats->breakdown));
+}
+
+/* ******************************************* */
+
+void DnsStats::restoreSnapshotStats(struct dns_stats *stats, const u_int32_t *s) {
+  u_int32_t *breakdown = (u_int32_t*)&stats->breakdown;
+
+  stats->num_queries.setInitialValue(stats->num_queries.get() + s[0]);
+  stats->num_replies_ok.setInitialValue(stats->num_replies_ok.get() + s[1]);
+  stats->num_replies_error.setInitialValue(stats->num_replies_error.get() + s[2]);
+
+  for(u_int i = 3; i < HOST_SNAPSHOT_DNS_COUNTERS; i++)
+    breakdown[i - 3] += s[i];
+}
+
+/* ******************************************* */
+
+void DnsStats::getSnapshot(struct host_snapshot_hdr *s) {
+  getSnapshotStats(&sent_stats, s->dns[0]);
+  getSnapshotStats(&rcvd_stats, s->dns[1]);
+}
+
+/* ******************************************* */
+
+void DnsStats::restoreSnapshot(const struct host_snapshot_hdr *s) {
+  restoreSnapshotStats(&sent_stats, s->dns[0]);
+  restoreSnapshotStats(&rcvd_stats, s->dns[1]);
+}
+
+/* ******************************************* */
+
 json_object* DnsStats::getStatsJSONObject(struct dns_stats *stats) {
   json_object *my_object = json_object_new_object();
   json_object *my_stats = json_object_new_object();
@@ -25,6 +25,23 @@
 
 /* **************************************************** */
 
+static size_t es_discard_response(void *ptr, size_t size, size_t nmemb, void *stream) {
+  return(size * nmemb);
+}
+
+/* **************************************************** */
+
+#ifdef HAVE_ZLIB
+static int es_deflate_init(z_stream *zs) {
+  memset(zs, 0, sizeof(*zs));
+
+  /* windowBits 15+16: gzip header and trailer, as expected by Content-Encoding: gzip */
+  return(deflateInit2(zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY));
+}
+#endif
+
+/* **************************************************** */
+
 static void* esLoop(void* ptr) {
   Utils::setThreadName("ESLoop");
   
@@ -40,10 +57,17 @@ static void* esLoop(void* ptr) {
 ElasticSearch::ElasticSearch(NetworkInterface *_iface) : DB(_iface) {
   snprintf(es_version, sizeof(es_version), "%c", '0');
   es_version_inited = false;
-  num_queued_elems = 0;
-  head = NULL;
-  tail = NULL;
+  num_queued_elems = 0, num_queued_bytes = 0;
+  ring_head = ring_tail = 0;
   reportDrops = false;
+  multi = NULL, headers = NULL;
+  gzip_requests = false, gz_body_size = 0;
+  bulk_size = ES_BULK_BUFFER_SIZE / 4, num_inflight = 0;
+  num_bulks = num_failed_bulks = tot_latency_msec = 0, last_latency_msec = 0;
+  memset(requests, 0, sizeof(requests));
+
+  if(!(ring = (ESFlowRecord*)calloc(ES_MAX_QUEUE_LEN, sizeof(ESFlowRecord))))
+    throw "Not enough memory";
 
   if(!(es_template_push_url = (char*)malloc(MAX_PATH))
      || !(es_version_query_url = (char*)malloc(MAX_PATH)))
@@ -60,6 +84,13 @@ ElasticSearch::~ElasticSearch() {
   shutdown();
   if(es_template_push_url) free(es_template_push_url);
   if(es_version_query_url) free(es_version_query_url);
+
+  if(ring) {
+    for(u_int32_t i = 0; i < ES_MAX_QUEUE_LEN; i++)
+      if(ring[i].str) free(ring[i].str);
+
+    free(ring);
+  }
 }
 
 /* **************************************** */
@@ -77,8 +108,9 @@ void ElasticSearch::shutdown() {
 /* **************************************** */
 
 bool ElasticSearch::dumpFlow(time_t when, Flow *f, char *msg) {
-  struct string_list *e;
-  bool rc = true;
+  u_int32_t len = strlen(msg);
+  ESFlowRecord *r;
+  bool rc = false;
 
   if(num_queued_elems >= ES_MAX_QUEUE_LEN) {
     if(!reportDrops) {
@@ -96,25 +128,25 @@ bool ElasticSearch::dumpFlow(time_t when, Flow *f, char *msg) {
 
   listMutex.lock(__FILE__, __LINE__);
 
-  e = (struct string_list*)calloc(1, sizeof(struct string_list));
-  if(e != NULL) {
-    e->str = strdup(msg), e->next = head;
+  if(num_queued_elems < ES_MAX_QUEUE_LEN) {
+    r = &ring[ring_head];
 
-    if(e->str) {
-      if(head)
-        head->prev = e;
-      head = e;
-      if(tail == NULL)
-	tail = e;
-      num_queued_elems++;
+    if(r->size <= len) {
+      /* Grow the slot buffer: it will be reused by the next flows */
+      u_int32_t new_size = (len + 512) & ~511;
+      char *s = (char*)realloc(r->str, new_size);
 
+      if(s) r->str = s, r->size = new_size;
+    }
+
+    if(r->size > len) {
+      memcpy(r->str, msg, len + 1), r->len = len;
+      ring_head = (ring_head + 1) % ES_MAX_QUEUE_LEN;
+      num_queued_elems++, num_queued_bytes += len;
       rc = true;
-    } else {
-      /* Out of memory */
-      free(e);
-      rc = false;
     }
-  }
+  } else
+    incNumQueueDroppedFlows(); /* Filled by another thread meanwhile */
 
   listMutex.unlock(__FILE__, __LINE__);
 
@@ -133,86 +165,322 @@ bool ElasticSearch::startQueryLoop() {
   return(false);
 }
 
+/* **************************************** */
+
+bool ElasticSearch::initRequests() {
+  char *user = ntop->getPrefs()->get_es_user(), *pwd = ntop->getPrefs()->get_es_pwd();
+  char *url = ntop->getPrefs()->get_es_url();
+
+#ifdef HAVE_ZLIB
+  gzip_requests = ntop->getPrefs()->useESGzipRequests();
+
+  if(gzip_requests) {
+    z_stream zs;
+
+    /* The bound depends on the stream parameters, gzip wrapper included */
+    if(es_deflate_init(&zs) != Z_OK)
+      return(false);
+
+    gz_body_size = deflateBound(&zs, ES_BULK_BUFFER_SIZE);
+    deflateEnd(&zs);
+  }
+#endif
+
+  if((multi = curl_multi_init()) == NULL)
+    return(false);
+
+  headers = curl_slist_append(headers, "Content-Type: application/json");
+  headers = curl_slist_append(headers, "Expect:"); /* Disable 100-continue */
+  if(gzip_requests)
+    headers = curl_slist_append(headers, "Content-Encoding: gzip");
+
+  for(int i = 0; i < ES_MAX_INFLIGHT_REQUESTS; i++) {
+    ESBulkRequest *req = &requests[i];
+    CURL *curl;
+
+    if(((req->body = (char*)malloc(ES_BULK_BUFFER_SIZE)) == NULL)
+       || (gzip_requests
+	   && ((req->gz_body = (char*)malloc(gz_body_size)) == NULL))
+       || ((req->curl = curl = curl_easy_init()) == NULL))
+      return(false);
+
+    /* Handles are reused across bulks so that connections are kept alive */
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+
+    if((user && (user[0] != '\0')) || (pwd && (pwd[0] != '\0'))) {
+      size_t auth_len = (user ? strlen(user) : 0) + (pwd ? strlen(pwd) : 0) + 2 /* ':' and '\0' */;
+      char *auth = (char*)malloc(auth_len);
+
+      if(auth == NULL)
+	return(false);
+
+      snprintf(auth, auth_len, "%s:%s", user ? user : "", pwd ? pwd : "");
+      curl_easy_setopt(curl, CURLOPT_USERPWD, auth); /* Copied by curl */
+      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, (long)CURLAUTH_BASIC);
+      free(auth);
+    }
+
+    if(!strncmp(url, "https", 5) && ntop->getPrefs()->do_insecure_tls()) {
+      curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+      curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, es_discard_response);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, ES_REQUEST_TIMEOUT);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)req);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  }
+
+  return(true);
+}
+
+/* **************************************** */
+
+void ElasticSearch::termRequests() {
+  for(int i = 0; i < ES_MAX_INFLIGHT_REQUESTS; i++) {
+    ESBulkRequest *req = &requests[i];
+
+    if(req->curl) {
+      if(req->busy) curl_multi_remove_handle(multi, req->curl);
+      curl_easy_cleanup(req->curl);
+    }
+
+    if(req->body)    free(req->body);
+    if(req->gz_body) free(req->gz_body);
+  }
+
+  memset(requests, 0, sizeof(requests));
+
+  if(headers) { curl_slist_free_all(headers); headers = NULL; }
+  if(multi)   { curl_multi_cleanup(multi);    multi = NULL;   }
+}
+
+/* **************************************** */
+
+/* Moves queued flows into the bulk body, up to the current bulk size */
+u_int32_t ElasticSearch::fillBulk(ESBulkRequest *req) {
+  char index_name[64], header[256];
+  u_int32_t len = 0, header_len;
+  struct tm tm_info;
+  time_t t = time(NULL);
+
+  strftime(index_name, sizeof(index_name), ntop->getPrefs()->get_es_index(), gmtime_r(&t, &tm_info));
+
+  /* type is no longer supported in version 8, so no type is needed */
+  if(atleast_version_8()) {
+    header_len = snprintf(header, sizeof(header), "{\"index\": {\"_index\": \"%s\"}}\n", index_name);
+  } else {
+    header_len = snprintf(header, sizeof(header),
+			  "{\"index\": {\"_type\": \"%s\", \"_index\": \"%s\"}}\n",
+			  atleast_version_6() ? (char*)"_doc" /* types no longer supported in 6 */ : ntop->getPrefs()->get_es_type(),
+			  index_name);
+  }
+
+  req->num_flows = 0;
+
+  listMutex.lock(__FILE__, __LINE__);
+
+  while(num_queued_elems > 0) {
+    ESFlowRecord *r = &ring[ring_tail];
+    u_int32_t needed = header_len + r->len + 2;
+
+    if(len + needed >= ES_BULK_BUFFER_SIZE) {
+      if(len > 0) break;
+
+      /* A single flow does not fit in a bulk */
+      incNumDroppedFlows();
+    } else if((len > 0) && (len + needed >= bulk_size))
+      break;
+    else {
+      memcpy(&req->body[len], header, header_len), len += header_len;
+      memcpy(&req->body[len], r->str, r->len), len += r->len;
+      req->body[len++] = '\n';
+      req->num_flows++;
+    }
+
+    ring_tail = (ring_tail + 1) % ES_MAX_QUEUE_LEN;
+    num_queued_elems--, num_queued_bytes -= r->len;
+  }
+
+  listMutex.unlock(__FILE__, __LINE__);
+
+  req->body[len] = '\0';
+
+  return(len);
+}
+
+/* **************************************** */
+
+bool ElasticSearch::sendBulk(ESBulkRequest *req, u_int32_t len) {
+  char *body = req->body;
+  u_int32_t body_len = len;
+
+#ifdef HAVE_ZLIB
+  if(gzip_requests) {
+    z_stream zs;
+
+    if(es_deflate_init(&zs) != Z_OK)
+      return(false);
+
+    zs.next_in = (Bytef*)req->body, zs.avail_in = len;
+    zs.next_out = (Bytef*)req->gz_body, zs.avail_out = gz_body_size;
+
+    if(deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+      deflateEnd(&zs);
+      return(false);
+    }
+
+    body = req->gz_body, body_len = zs.total_out;
+    deflateEnd(&zs);
+  }
+#endif
+
+  curl_easy_setopt(req->curl, CURLOPT_POSTFIELDS, body);
+  curl_easy_setopt(req->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
+
+  if(curl_multi_add_handle(multi, req->curl) != CURLM_OK)
+    return(false);
+
+  req->body_len = len, req->busy = true;
+  gettimeofday(&req->sent, NULL);
+  num_inflight++;
+
+  ntop->getTrace()->traceEvent(TRACE_INFO, "ES: Sending %u flows (%u bytes, %u on the wire) [%u in flight]",
+			       req->num_flows, len, body_len, num_inflight);
+
+  return(true);
+}
+
+/* **************************************** */
+
+void ElasticSearch::completeBulk(ESBulkRequest *req, CURLcode res) {
+  struct timeval now;
+  long http_code = 0;
+  u_int32_t latency;
+  bool ok;
+
+  gettimeofday(&now, NULL);
+  latency = (u_int32_t)Utils::msTimevalDiff(&now, &req->sent);
+
+  if(res == CURLE_OK)
+    curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+  ok = (http_code >= 200) && (http_code <= 299);
+
+  if(ok) {
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Sent %u flow(s) to ES [%u ms]", req->num_flows, latency);
+    incNumExportedFlows(req->num_flows);
+  } else {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "ES: POST request for %u flows (%u bytes) failed [%s][HTTP %ld]",
+				 req->num_flows, req->body_len,
+				 (res == CURLE_OK) ? "OK" : curl_easy_strerror(res), http_code);
+    incNumDroppedFlows(req->num_flows);
+    num_failed_bulks++;
+  }
+
+  num_bulks++, tot_latency_msec += latency, last_latency_msec = latency;
+
+  /*
+    Adaptive bulk sizing: shrink quickly when ES is slow (or failing),
+    grow slowly while full bulks are served well within the target latency.
+  */
+  if(!ok || (latency > ES_BULK_TARGET_LATENCY_MSEC))
+    bulk_size = max_val(bulk_size / 2, ES_BULK_MIN_SIZE);
+  else if((latency < ES_BULK_TARGET_LATENCY_MSEC / 2) && (req->body_len >= (bulk_size * 3) / 4))
+    bulk_size = min_val(bulk_size + ES_BULK_MIN_SIZE, ES_BULK_BUFFER_SIZE);
+
+  curl_multi_remove_handle(multi, req->curl);
+  req->busy = false;
+  num_inflight--;
+}
 
 /* **************************************** */
 
 void ElasticSearch::indexESdata() {
   const u_int min_buffered_flows = 8;
   time_t last_dump = time(0);
-  char *postbuf = (char*) malloc(ES_BULK_BUFFER_SIZE);
 
-  if(!postbuf) {
-    ntop->getTrace()->traceEvent(TRACE_ERROR, "Cannot allocate ES bulk buffer");
+  if(!initRequests()) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Cannot allocate ES bulk requests");
+    termRequests();
     return;
   }
 
-  while(!ntop->getGlobals()->isShutdown() && isRunning()) {
+  while(true) {
+    bool shutting_down = ntop->getGlobals()->isShutdown() || !isRunning();
     time_t now = time(0);
+    CURLMsg *msg;
+    int still_running, msgs_left;
 
-    if((num_queued_elems >= min_buffered_flows) &&
-       (now >= last_dump + ntop->getPrefs()->get_dump_frequency())) {
-      u_int len, num_flows;
-      char index_name[64], header[256];
-      struct tm* tm_info;
-      struct timeval tv;
-      time_t t;
-      HTTPTranferStats stats;
+    if(shutting_down && (num_inflight == 0))
+      break;
 
-      gettimeofday(&tv, NULL);
-      t = tv.tv_sec;
-      tm_info = gmtime(&t);
+    /*
+      Start a bulk on every free slot as soon as a full bulk is queued, or
+      when the dump frequency expires with at least a few flows queued
+    */
+    for(int i = 0; (i < ES_MAX_INFLIGHT_REQUESTS) && !shutting_down; i++) {
+      ESBulkRequest *req = &requests[i];
+      u_int32_t len;
 
-      strftime(index_name, sizeof(index_name), ntop->getPrefs()->get_es_index(), tm_info);
+      if(req->busy) continue;
 
-      /* type is no longer supported in version 8, so no type is needed */
-      if(atleast_version_8()) {
-        snprintf(header, sizeof(header), "{\"index\": {\"_index\": \"%s\"}}", index_name);
-      } else {
-        snprintf(header, sizeof(header),
-	        "{\"index\": {\"_type\": \"%s\", \"_index\": \"%s\"}}",
-	        atleast_version_6() ? (char*)"_doc" /* types no longer supported in 6 */ : ntop->getPrefs()->get_es_type(),
-	        index_name);
-      }
-      
-      len = 0, num_flows = 0;
-
-      listMutex.lock(__FILE__, __LINE__);
-      for(u_int i=0; (i < num_queued_elems) && (len <= ES_BULK_BUFFER_SIZE - strlen(header) - strlen(tail->str) -5 ); i++) {
-        struct string_list *prev;
-        prev = tail->prev;
-        len += snprintf(&postbuf[len], ES_BULK_BUFFER_SIZE-len, "%s\n%s\n", header, tail->str), num_flows++;
-        free(tail->str);
-        free(tail);
-        tail = prev, num_queued_elems--;
-
-        if(num_queued_elems == 0)
-	  head = NULL;
-      } /* for */
-
-      listMutex.unlock(__FILE__, __LINE__);
-      postbuf[len] = '\0';
-
-      ntop->getTrace()->traceEvent(TRACE_INFO, "ES: Buffered request with %d flows (%d bytes)", num_flows, len);
-
-      if(!Utils::postHTTPJsonData(ntop->getPrefs()->get_es_user(),
-				  ntop->getPrefs()->get_es_pwd(),
-				  ntop->getPrefs()->get_es_url(),
-				  postbuf, 0, &stats)) {
-	/* Post failure */
-	ntop->getTrace()->traceEvent(TRACE_ERROR, "ES: POST request for %d flows (%d bytes) failed", num_flows, len);
-	incNumDroppedFlows(num_flows);
-	sleep(1);
-      } else {
-	ntop->getTrace()->traceEvent(TRACE_INFO, "Sent %u flow(s) to ES", num_flows);
-	incNumExportedFlows(num_flows);
+      if(!((num_queued_bytes >= bulk_size)
+	   || ((num_queued_elems >= min_buffered_flows)
+	       && (now >= last_dump + ntop->getPrefs()->get_dump_frequency()))))
+	break;
+
+      if((len = fillBulk(req)) == 0)
+	break;
+
+      if(!sendBulk(req, len)) {
+	ntop->getTrace()->traceEvent(TRACE_ERROR, "ES: unable to send bulk of %u flows", req->num_flows);
+	incNumDroppedFlows(req->num_flows);
       }
 
       last_dump = now;
-    } else
-      sleep(1);
+    }
+
+    if(num_inflight == 0) {
+      _usleep(100000);
+      continue;
+    }
+
+    curl_multi_perform(multi, &still_running);
+
+    while((msg = curl_multi_info_read(multi, &msgs_left)) != NULL) {
+      if(msg->msg == CURLMSG_DONE) {
+	ESBulkRequest *req = NULL;
+
+	curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&req);
+	if(req) completeBulk(req, msg->data.result);
+      }
+    }
+
+    if(num_inflight > 0)
+      curl_multi_wait(multi, NULL, 0, 100 /* msec */, NULL);
   } /* while */
 
-  free(postbuf);
+  termRequests();
+}
+
+/* **************************************** */
+
+void ElasticSearch::lua(lua_State *vm, bool since_last_checkpoint) const {
+  DB::lua(vm, since_last_checkpoint);
+
+  if(since_last_checkpoint) return;
+
+  lua_push_uint64_table_entry(vm, "flow_export_queue_len", num_queued_elems);
+  lua_push_uint64_table_entry(vm, "flow_export_batches", num_bulks);
+  lua_push_uint64_table_entry(vm, "flow_export_failed_batches", num_failed_bulks);
+  lua_push_uint64_table_entry(vm, "flow_export_inflight_batches", num_inflight);
+  lua_push_uint64_table_entry(vm, "flow_export_batch_size_bytes", bulk_size);
+  lua_push_uint64_table_entry(vm, "flow_export_avg_latency_ms", num_bulks ? (tot_latency_msec / num_bulks) : 0);
+  lua_push_uint64_table_entry(vm, "flow_export_last_latency_ms", last_latency_msec);
+  lua_push_bool_table_entry(vm, "flow_export_gzip", gzip_requests);
 }
 
 /* **************************************** */
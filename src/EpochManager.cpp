@@ -0,0 +1,82 @@
+/*
+ *
+ * (C) 2014-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+
+/* ******************************* */
+
+EpochManager::EpochManager() {
+  global_epoch = 1, num_slot_exhausted = 0;
+
+  for(u_int i = 0; i < MAX_NUM_EPOCH_READERS; i++)
+    reader_epochs[i] = 0;
+}
+
+/* ******************************* */
+
+int EpochManager::enter() {
+  for(u_int i = 0; i < MAX_NUM_EPOCH_READERS; i++) {
+    u_int64_t expected = 0;
+
+    /*
+      Publish the epoch seen at entry. All memory operations are sequentially
+      consistent, so a writer that advances the epoch after this store is guaranteed
+      to see the slot busy when checking for reclaimable entries.
+    */
+    if(reader_epochs[i].compare_exchange_strong(expected, global_epoch.load()))
+      return(i);
+  }
+
+  num_slot_exhausted++;
+  return(-1);
+}
+
+/* ******************************* */
+
+void EpochManager::exit(int slot) {
+  if((slot >= 0) && (slot < MAX_NUM_EPOCH_READERS))
+    reader_epochs[slot] = 0;
+}
+
+/* ******************************* */
+
+u_int64_t EpochManager::advance() {
+  return(++global_epoch);
+}
+
+/* ******************************* */
+
+/*
+  Entries retired with retire_epoch have been unlinked before the epoch
+  was advanced to retire_epoch: only readers which entered an older epoch
+  can still reference them.
+*/
+bool EpochManager::canReclaim(u_int64_t retire_epoch) const {
+  for(u_int i = 0; i < MAX_NUM_EPOCH_READERS; i++) {
+    u_int64_t e = reader_epochs[i];
+
+    if(e && (e < retire_epoch))
+      return(false);
+  }
+
+  return(true);
+}
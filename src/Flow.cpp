@@ -25,6 +25,7 @@
 
 const ndpi_protocol Flow::ndpiUnknownProtocol = { NDPI_PROTOCOL_UNKNOWN,
   NDPI_PROTOCOL_UNKNOWN, NDPI_PROTOCOL_CATEGORY_UNSPECIFIED, NULL };
+const FlowProtocolInfo Flow::emptyProtocolInfo = { };
 // #define DEBUG_DISCOVERY
 // #define DEBUG_UA
 // #define DEBUG_SCORE
@@ -45,6 +46,7 @@ Flow::Flow(NetworkInterface *_iface,
   flow_device.observation_point_id = _observation_point_id;
   cli_host = srv_host = NULL;
   cli_ip_addr = srv_ip_addr = NULL;
+  peer_pools = 0;
   flow_dropped_counts_increased = 0, vrfId = 0;
   srcAS = dstAS  = prevAdjacentAS = nextAdjacentAS = 0;
   predominant_alert.id = flow_alert_normal, predominant_alert.category = alert_category_other;
@@ -76,6 +78,7 @@ Flow::Flow(NetworkInterface *_iface,
   ebpf = NULL;
   json_info = NULL, tlv_info = NULL, twh_over = twh_ok = 0,
     dissect_next_http_packet = 0, host_server_name = NULL;
+  fast_accounting = 0, fast_accounting_skipped = 0;
   bt_hash = NULL;
 
   flow_verdict = 0;
@@ -94,7 +97,7 @@ Flow::Flow(NetworkInterface *_iface,
   last_db_dump.partial = NULL;
   last_db_dump.first_seen = last_db_dump.last_seen = 0;
   last_db_dump.in_progress = false;
-  memset(&protos, 0, sizeof(protos));
+  protos = &emptyProtocolInfo, tcp_state = NULL;
   memset(&flow_device, 0, sizeof(flow_device));
 
   flow_score = 0;
@@ -133,7 +136,7 @@ Flow::Flow(NetworkInterface *_iface,
     }
   } else { /* Client host has not been allocated, let's keep the info in an IpAddress */
     if((cli_ip_addr = new (std::nothrow) IpAddress(*_cli_ip)))
-      cli_ip_addr->reloadBlacklist(iface->get_ndpi_struct());
+      cli_ip_addr->reloadBlacklist();
   }
 
   if(srv_host) {
@@ -152,7 +155,15 @@ Flow::Flow(NetworkInterface *_iface,
     }
   } else { /* Server host has not been allocated, let's keep the info in an IpAddress */
     if((srv_ip_addr = new (std::nothrow) IpAddress(*_srv_ip)))
-      srv_ip_addr->reloadBlacklist(iface->get_ndpi_struct());
+      srv_ip_addr->reloadBlacklist();
+  }
+
+  if(!cli_host || !srv_host) {
+    /* Resolved once here: the stats walkers only read them back, until the pools are reloaded */
+    HostPools *pools = iface->getHostPools();
+
+    if(pools)
+      peer_pools = lookupPeerPools(pools, pools->getTreesGeneration());
   }
 
   /* Update broadcast domain, if destination MAC address is broadcast */
@@ -186,14 +197,10 @@ Flow::Flow(NetworkInterface *_iface,
   bytes_thpt_trend = trend_unknown, pkts_thpt_trend = trend_unknown;
   //bytes_rate = new TimeSeries<float>(4096);
 
-  synTime.tv_sec = synTime.tv_usec = 0,
-    ackTime.tv_sec = ackTime.tv_usec = 0,
-    synAckTime.tv_sec = synAckTime.tv_usec = 0,
-    rttSec = 0, cli2srv_window = srv2cli_window = 0,
+  rttSec = 0, cli2srv_window = srv2cli_window = 0,
     c2sFirstGoodputTime.tv_sec = c2sFirstGoodputTime.tv_usec = 0;
 
   memset(&ip_stats_s2d, 0, sizeof(ip_stats_s2d)), memset(&ip_stats_d2s, 0, sizeof(ip_stats_d2s));
-  memset(&tcp_seq_s2d, 0, sizeof(tcp_seq_s2d)), memset(&tcp_seq_d2s, 0, sizeof(tcp_seq_d2s));
   memset(&clientNwLatency, 0, sizeof(clientNwLatency)), memset(&serverNwLatency, 0, sizeof(serverNwLatency));
 
   if(iface->isPacketInterface() && !iface->isSampledTraffic()) {
@@ -275,6 +282,35 @@ void Flow::allocDPIMemory() {
 
 /* *************************************** */
 
+/*
+  Returns a writable protocol info block, allocating it on first use. Until then
+  protos points to the shared (all-zero) emptyProtocolInfo so readers never need
+  to check for NULL.
+*/
+FlowProtocolInfo* Flow::protosRW() {
+  if(protos == &emptyProtocolInfo) {
+    FlowProtocolInfo *p = (FlowProtocolInfo*)calloc(1, sizeof(FlowProtocolInfo));
+
+    if(p == NULL)
+      throw "Not enough memory";
+
+    protos = p;
+  }
+
+  return((FlowProtocolInfo*)protos);
+}
+
+/* *************************************** */
+
+FlowTCPState* Flow::getTCPState() {
+  if(tcp_state == NULL)
+    tcp_state = (FlowTCPState*)calloc(1, sizeof(FlowTCPState));
+
+  return(tcp_state);
+}
+
+/* *************************************** */
+
 void Flow::freeDPIMemory() {
   if(ndpiFlow)  {
     ndpi_free_flow(ndpiFlow);
@@ -353,36 +389,39 @@ Flow::~Flow() {
   if(entropy.s2c) ndpi_free_data_analysis(entropy.s2c, 1);
 
   if(isHTTP()) {
-    if(protos.http.last_url)         free(protos.http.last_url);
-    if(protos.http.last_user_agent)  free(protos.http.last_user_agent);
+    if(protos->http.last_url)         free(protos->http.last_url);
+    if(protos->http.last_user_agent)  free(protos->http.last_user_agent);
   } else if(isDNS()) {
-    if(protos.dns.last_query)        free(protos.dns.last_query);
-    if(protos.dns.last_query_shadow) free(protos.dns.last_query_shadow);
+    if(protos->dns.last_query)        free(protos->dns.last_query);
+    if(protos->dns.last_query_shadow) free(protos->dns.last_query_shadow);
   } else if(isMDNS()) {
-    if(protos.mdns.answer)           free(protos.mdns.answer);
-    if(protos.mdns.name)             free(protos.mdns.name);
-    if(protos.mdns.name_txt)         free(protos.mdns.name_txt);
-    if(protos.mdns.ssid)             free(protos.mdns.ssid);
+    if(protos->mdns.answer)           free(protos->mdns.answer);
+    if(protos->mdns.name)             free(protos->mdns.name);
+    if(protos->mdns.name_txt)         free(protos->mdns.name_txt);
+    if(protos->mdns.ssid)             free(protos->mdns.ssid);
   } else if(isSSDP()) {
-    if(protos.ssdp.location)         free(protos.ssdp.location);
+    if(protos->ssdp.location)         free(protos->ssdp.location);
   } else if(isNetBIOS()) {
-    if(protos.netbios.name)          free(protos.netbios.name);
+    if(protos->netbios.name)          free(protos->netbios.name);
   } else if(isSSH()) {
-    if(protos.ssh.client_signature)  free(protos.ssh.client_signature);
-    if(protos.ssh.server_signature)  free(protos.ssh.server_signature);
-    if(protos.ssh.hassh.client_hash) free(protos.ssh.hassh.client_hash);
-    if(protos.ssh.hassh.server_hash) free(protos.ssh.hassh.server_hash);
+    if(protos->ssh.client_signature)  free(protos->ssh.client_signature);
+    if(protos->ssh.server_signature)  free(protos->ssh.server_signature);
+    if(protos->ssh.hassh.client_hash) free(protos->ssh.hassh.client_hash);
+    if(protos->ssh.hassh.server_hash) free(protos->ssh.hassh.server_hash);
   } else if(isTLS()) {
-    if(protos.tls.client_requested_server_name)  free(protos.tls.client_requested_server_name);
-    if(protos.tls.server_names)                  free(protos.tls.server_names);
-    if(protos.tls.ja3.client_hash)               free(protos.tls.ja3.client_hash);
-    if(protos.tls.ja3.server_hash)               free(protos.tls.ja3.server_hash);
-    if(protos.tls.client_alpn)                   free(protos.tls.client_alpn);
-    if(protos.tls.client_tls_supported_versions) free(protos.tls.client_tls_supported_versions);
-    if(protos.tls.issuerDN)                      free(protos.tls.issuerDN);
-    if(protos.tls.subjectDN)                     free(protos.tls.subjectDN);
+    if(protos->tls.client_requested_server_name)  free(protos->tls.client_requested_server_name);
+    if(protos->tls.server_names)                  free(protos->tls.server_names);
+    if(protos->tls.ja3.client_hash)               free(protos->tls.ja3.client_hash);
+    if(protos->tls.ja3.server_hash)               free(protos->tls.ja3.server_hash);
+    if(protos->tls.client_alpn)                   free(protos->tls.client_alpn);
+    if(protos->tls.client_tls_supported_versions) free(protos->tls.client_tls_supported_versions);
+    if(protos->tls.issuerDN)                      free(protos->tls.issuerDN);
+    if(protos->tls.subjectDN)                     free(protos->tls.subjectDN);
   }
 
+  if(protos != &emptyProtocolInfo) free((FlowProtocolInfo*)protos);
+  if(tcp_state)                     free(tcp_state);
+
   if(bt_hash)
     free(bt_hash);
 
@@ -409,6 +448,53 @@ u_int16_t Flow::getStatsProtocol() const {
 
 /* *************************************** */
 
+u_int64_t Flow::lookupPeerPools(HostPools *hp, u_int32_t generation) {
+  u_int64_t pools = ((u_int64_t)generation) << 32;
+  u_int16_t pool_id;
+
+  if(cli_ip_addr && hp->findIpPool(cli_ip_addr, vlanId, &pool_id))
+    pools |= 0x80000000 | (((u_int64_t)pool_id & 0x7FFF) << 16);
+
+  if(srv_ip_addr && hp->findIpPool(srv_ip_addr, vlanId, &pool_id))
+    pools |= 0x8000 | ((u_int64_t)pool_id & 0x7FFF);
+
+  return(pools);
+}
+
+/* *************************************** */
+
+void Flow::getPeerPools(u_int16_t *cli_pool, bool *cli_pool_found, u_int16_t *srv_pool, bool *srv_pool_found) {
+  u_int64_t pools = 0;
+
+  if(!cli_host || !srv_host) {
+    HostPools *hp = iface->getHostPools();
+
+    if(hp) {
+      u_int32_t generation = hp->getTreesGeneration();
+
+      pools = peer_pools.load(std::memory_order_relaxed);
+
+      if((u_int32_t)(pools >> 32) != generation) {
+	/* The pools have been reloaded */
+	pools = lookupPeerPools(hp, generation);
+	peer_pools.store(pools, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  if(cli_host)
+    *cli_pool = cli_host->get_host_pool(), *cli_pool_found = true;
+  else
+    *cli_pool = (pools >> 16) & 0x7FFF, *cli_pool_found = (pools & 0x80000000) ? true : false;
+
+  if(srv_host)
+    *srv_pool = srv_host->get_host_pool(), *srv_pool_found = true;
+  else
+    *srv_pool = pools & 0x7FFF, *srv_pool_found = (pools & 0x8000) ? true : false;
+}
+
+/* *************************************** */
+
 /* This function is called as soon as the protocol detection is
  * completed. See processExtraDissectedInformation for a later check.
  * NOTE: does NOT need ndpiFlow
@@ -557,7 +643,7 @@ void Flow::processDetectedProtocolData() {
     break;
 
   case NDPI_PROTOCOL_MDNS:
-    /* protos.mdns.{answer,name} already propagated to hosts in Flow::hosts_periodic_stats_update  */
+    /* protos->mdns.{answer,name} already propagated to hosts in Flow::hosts_periodic_stats_update  */
     break;
 
   case NDPI_PROTOCOL_TOR:
@@ -577,10 +663,10 @@ void Flow::processDetectedProtocolData() {
     if(srv_h && ndpiFlow->host_server_name[0] != '\0') srv_h->setServerName(host_server_name);
   case NDPI_PROTOCOL_HTTP_PROXY:
     if(ndpiFlow->http.url) {
-      if(!protos.http.last_url) protos.http.last_url = strdup(ndpiFlow->http.url);
+      if(!protos->http.last_url) protosRW()->http.last_url = strdup(ndpiFlow->http.url);
 
-      if((!protos.http.last_user_agent) && ndpiFlow->http.user_agent)
-	protos.http.last_user_agent = strdup(ndpiFlow->http.user_agent);
+      if((!protos->http.last_user_agent) && ndpiFlow->http.user_agent)
+	protosRW()->http.last_user_agent = strdup(ndpiFlow->http.user_agent);
 
       setHTTPMethod(ndpiFlow->http.method);
     }
@@ -624,20 +710,20 @@ void Flow::processExtraDissectedInformation() {
 
     switch(l7proto) {
     case NDPI_PROTOCOL_SSH:
-      if(protos.ssh.client_signature == NULL)
-	protos.ssh.client_signature = strdup(ndpiFlow->protos.ssh.client_signature);
-      if(protos.ssh.server_signature == NULL)
-	protos.ssh.server_signature = strdup(ndpiFlow->protos.ssh.server_signature);
+      if(protos->ssh.client_signature == NULL)
+	protosRW()->ssh.client_signature = strdup(ndpiFlow->protos.ssh.client_signature);
+      if(protos->ssh.server_signature == NULL)
+	protosRW()->ssh.server_signature = strdup(ndpiFlow->protos.ssh.server_signature);
 
-      if(protos.ssh.hassh.client_hash == NULL
+      if(protos->ssh.hassh.client_hash == NULL
 	 && ndpiFlow->protos.ssh.hassh_client[0] != '\0') {
-	protos.ssh.hassh.client_hash = strdup(ndpiFlow->protos.ssh.hassh_client);
+	protosRW()->ssh.hassh.client_hash = strdup(ndpiFlow->protos.ssh.hassh_client);
 	updateHASSH(true /* As client */);
       }
 
-      if(protos.ssh.hassh.server_hash == NULL
+      if(protos->ssh.hassh.server_hash == NULL
 	 && ndpiFlow->protos.ssh.hassh_server[0] != '\0') {
-	protos.ssh.hassh.server_hash = strdup(ndpiFlow->protos.ssh.hassh_server);
+	protosRW()->ssh.hassh.server_hash = strdup(ndpiFlow->protos.ssh.hassh_server);
 	updateHASSH(false /* As server */);
       }
       break;
@@ -648,51 +734,51 @@ void Flow::processExtraDissectedInformation() {
     case NDPI_PROTOCOL_MAIL_SMTPS:
     case NDPI_PROTOCOL_MAIL_POPS:
     case NDPI_PROTOCOL_QUIC:
-      protos.tls.tls_version = ndpiFlow->protos.tls_quic.ssl_version;
+      protosRW()->tls.tls_version = ndpiFlow->protos.tls_quic.ssl_version;
 
-      protos.tls.notBefore = ndpiFlow->protos.tls_quic.notBefore,
-	protos.tls.notAfter = ndpiFlow->protos.tls_quic.notAfter;
+      protosRW()->tls.notBefore = ndpiFlow->protos.tls_quic.notBefore,
+	protosRW()->tls.notAfter = ndpiFlow->protos.tls_quic.notAfter;
 
-      if((protos.tls.client_requested_server_name == NULL)
+      if((protos->tls.client_requested_server_name == NULL)
 	 && (ndpiFlow->host_server_name[0] != '\0')) {
-	protos.tls.client_requested_server_name = strdup(ndpiFlow->host_server_name);
+	protosRW()->tls.client_requested_server_name = strdup(ndpiFlow->host_server_name);
 
 	/* Now some minor cleanup */
 	char *c;
 	
-	if((c = strchr(protos.tls.client_requested_server_name, ',')) != NULL)
+	if((c = strchr(protos->tls.client_requested_server_name, ',')) != NULL)
 	  c[0] = '\0';
-	else if((c = strchr(protos.tls.client_requested_server_name, ' ')) != NULL)
+	else if((c = strchr(protos->tls.client_requested_server_name, ' ')) != NULL)
 	  c[0] = '\0';	
       }
 
-      if((protos.tls.server_names == NULL)
+      if((protos->tls.server_names == NULL)
 	 && (ndpiFlow->protos.tls_quic.server_names != NULL))
-	protos.tls.server_names = strdup(ndpiFlow->protos.tls_quic.server_names);
+	protosRW()->tls.server_names = strdup(ndpiFlow->protos.tls_quic.server_names);
 
-      if((protos.tls.client_alpn == NULL)
+      if((protos->tls.client_alpn == NULL)
 	 && (ndpiFlow->protos.tls_quic.alpn != NULL))
-	protos.tls.client_alpn = strdup(ndpiFlow->protos.tls_quic.alpn);
+	protosRW()->tls.client_alpn = strdup(ndpiFlow->protos.tls_quic.alpn);
 
-      if((protos.tls.client_tls_supported_versions == NULL)
+      if((protos->tls.client_tls_supported_versions == NULL)
 	 && (ndpiFlow->protos.tls_quic.tls_supported_versions != NULL))
-	protos.tls.client_tls_supported_versions = strdup(ndpiFlow->protos.tls_quic.tls_supported_versions);
+	protosRW()->tls.client_tls_supported_versions = strdup(ndpiFlow->protos.tls_quic.tls_supported_versions);
 
-      if((protos.tls.issuerDN == NULL) && (ndpiFlow->protos.tls_quic.issuerDN != NULL))
-	protos.tls.issuerDN= strdup(ndpiFlow->protos.tls_quic.issuerDN);
+      if((protos->tls.issuerDN == NULL) && (ndpiFlow->protos.tls_quic.issuerDN != NULL))
+	protosRW()->tls.issuerDN= strdup(ndpiFlow->protos.tls_quic.issuerDN);
 
-      if((protos.tls.subjectDN == NULL) && (ndpiFlow->protos.tls_quic.subjectDN != NULL))
-	protos.tls.subjectDN= strdup(ndpiFlow->protos.tls_quic.subjectDN);
+      if((protos->tls.subjectDN == NULL) && (ndpiFlow->protos.tls_quic.subjectDN != NULL))
+	protosRW()->tls.subjectDN= strdup(ndpiFlow->protos.tls_quic.subjectDN);
 
-      if((protos.tls.ja3.client_hash == NULL) && (ndpiFlow->protos.tls_quic.ja3_client[0] != '\0')) {
-	protos.tls.ja3.client_hash = strdup(ndpiFlow->protos.tls_quic.ja3_client);
+      if((protos->tls.ja3.client_hash == NULL) && (ndpiFlow->protos.tls_quic.ja3_client[0] != '\0')) {
+	protosRW()->tls.ja3.client_hash = strdup(ndpiFlow->protos.tls_quic.ja3_client);
 	updateCliJA3();
       }
 
-      if((protos.tls.ja3.server_hash == NULL) && (ndpiFlow->protos.tls_quic.ja3_server[0] != '\0')) {
-	protos.tls.ja3.server_hash = strdup(ndpiFlow->protos.tls_quic.ja3_server);
-	protos.tls.ja3.server_unsafe_cipher = ndpiFlow->protos.tls_quic.server_unsafe_cipher;
-	protos.tls.ja3.server_cipher = ndpiFlow->protos.tls_quic.server_cipher;
+      if((protos->tls.ja3.server_hash == NULL) && (ndpiFlow->protos.tls_quic.ja3_server[0] != '\0')) {
+	protosRW()->tls.ja3.server_hash = strdup(ndpiFlow->protos.tls_quic.ja3_server);
+	protosRW()->tls.ja3.server_unsafe_cipher = ndpiFlow->protos.tls_quic.server_unsafe_cipher;
+	protosRW()->tls.ja3.server_cipher = ndpiFlow->protos.tls_quic.server_cipher;
 	updateSrvJA3();
       }
       break;
@@ -708,8 +794,8 @@ void Flow::processExtraDissectedInformation() {
       break;
 
     case NDPI_PROTOCOL_HTTP:
-      if(protos.http.last_url) {
-	ndpi_risk_enum risk = ndpi_validate_url(protos.http.last_url);
+      if(protos->http.last_url) {
+	ndpi_risk_enum risk = ndpi_validate_url(protos->http.last_url);
 
 	if((risk != NDPI_NO_RISK) && (risk < NDPI_MAX_RISK))
 	  addRisk(2 << (risk-1));
@@ -888,13 +974,13 @@ void Flow::processDNSPacket(const u_char *ip_packet, u_int16_t ip_len, u_int64_t
       }
 
       if(ndpiFlow->protos.dns.is_query)
-	protos.dns.last_query_type = ndpiFlow->protos.dns.query_type;
+	protosRW()->dns.last_query_type = ndpiFlow->protos.dns.query_type;
       else { /* this is a response... */
 	if(ntop->getPrefs()->decode_dns_responses()) {
 	  char delimiter = '@', *name = NULL;
 	  char *at = (char*)strchr((const char*)ndpiFlow->host_server_name, delimiter);
 
-	  protos.dns.last_return_code = ndpiFlow->protos.dns.reply_code;
+	  protosRW()->dns.last_return_code = ndpiFlow->protos.dns.reply_code;
 	  
 	  /* Consider only positive DNS replies */
 	  if(at != NULL)
@@ -1008,12 +1094,13 @@ void Flow::setExtraDissectionCompleted() {
      || (protocol == IPPROTO_ICMPV6)
      ) {
     /* nDPI is not allocated for non-TCP non-UDP flows so, in order to
-       make sure custom cateories are properly populated, function ndpi_fill_ip_protocol_category
-       must be called explicitly. */
-    if(get_cli_ip_addr()->get_ipv4() && get_srv_ip_addr()->get_ipv4() /* Only IPv4 is supported */) {
-      ndpi_fill_ip_protocol_category(iface->get_ndpi_struct(),
-				     get_cli_ip_addr()->get_ipv4(), get_srv_ip_addr()->get_ipv4(),
-				     &ndpiDetectedProtocol);
+       make sure custom cateories are properly populated, the category
+       lists must be matched explicitly. */
+    CategoryDB *db = ntop->getCategoryDB();
+
+    if(db && get_cli_ip_addr()->get_ipv4() && get_srv_ip_addr()->get_ipv4() /* Only IPv4 is supported */) {
+      db->fillIPCategory(get_cli_ip_addr()->get_ipv4(), get_srv_ip_addr()->get_ipv4(),
+			 &ndpiDetectedProtocol);
       stats.setDetectedProtocol(&ndpiDetectedProtocol);
     }
   }
@@ -1054,12 +1141,34 @@ void Flow::updateProtocol(ndpi_protocol proto_id) {
 
 /* *************************************** */
 
+/* Category lists live in the CategoryDB shared by all the interfaces, not
+ * in nDPI. As nDPI does, IPs are matched before the server name. */
+void Flow::fillCustomCategory() {
+  CategoryDB *db = ntop->getCategoryDB();
+  const char *name;
+
+  if(!db)
+    return;
+
+  if(get_cli_ip_addr()->get_ipv4() && get_srv_ip_addr()->get_ipv4()
+     && db->fillIPCategory(get_cli_ip_addr()->get_ipv4(), get_srv_ip_addr()->get_ipv4(), &ndpiDetectedProtocol))
+    return;
+
+  name = (ndpiFlow && ndpiFlow->host_server_name[0]) ? (const char*)ndpiFlow->host_server_name : getFlowServerInfo();
+
+  if(name)
+    db->fillHostCategory(name, &ndpiDetectedProtocol);
+}
+
+/* *************************************** */
+
 /* Called to update the flow protocol and possibly advance the flow to
  * the protocol_detected state. */
 void Flow::setProtocolDetectionCompleted(u_int8_t *payload, u_int16_t payload_len) {
   if(detection_completed)
     return;
 
+  fillCustomCategory();
   stats.setDetectedProtocol(&ndpiDetectedProtocol);
 
   /* Process detected protocol and doesn't need ndpiFlow not allocated for non-packet interfaces */
@@ -1334,9 +1443,9 @@ char* Flow::print(char *buf, u_int buf_len) const {
 	   printTCPflags(src2dst_tcp_flags, buf3, sizeof(buf3)),
 	   printTCPflags(dst2src_tcp_flags, buf4, sizeof(buf4)),
 	   printTCPState(buf5, sizeof(buf5)),
-	   (isTLS() && protos.tls.server_names) ? "[" : "",
-	   (isTLS() && protos.tls.server_names) ? protos.tls.server_names : "",
-	   (isTLS() && protos.tls.server_names) ? "]" : ""
+	   (isTLS() && protos->tls.server_names) ? "[" : "",
+	   (isTLS() && protos->tls.server_names) ? protos->tls.server_names : "",
+	   (isTLS() && protos->tls.server_names) ? "]" : ""
 #if defined(NTOPNG_PRO) && defined(SHAPER_DEBUG)
 	   , shapers
 #endif
@@ -1448,6 +1557,17 @@ void Flow::incFlowDroppedCounters() {
 void Flow::hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host, Host *srv_host,
 				       PartializableFlowTrafficStats *partial,
 				       bool first_partial, const struct timeval *tv) const {
+  shared_periodic_stats_update(iface, cli_host, srv_host, partial, tv);
+  host_periodic_stats_update(cli_host, srv_host, true  /* as client */, partial, first_partial, tv);
+  host_periodic_stats_update(srv_host, cli_host, false /* as server */, partial, first_partial, tv);
+}
+
+/* *************************************** */
+
+/* Stats shared by several hosts (interface, pools, VLANs, networks, ASes, countries, ...) */
+void Flow::shared_periodic_stats_update(NetworkInterface *iface, Host *cli_host, Host *srv_host,
+					PartializableFlowTrafficStats *partial,
+					const struct timeval *tv) const {
   update_pools_stats(iface, cli_host, srv_host, tv, partial->get_cli2srv_packets(), partial->get_cli2srv_bytes(),
 		     partial->get_srv2cli_packets(), partial->get_srv2cli_bytes());
   
@@ -1463,9 +1583,6 @@ void Flow::hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host,
     if(cli_network_id >= 0 && (cli_network_id == srv_network_id))
       cli_and_srv_in_same_subnet = true;
 
-    cli_host->incCliContactedHosts(srv_host->get_ip());
-    srv_host->incSrvHostContacts(cli_host->get_ip());
-
     if(iface && (vl = iface->getVLAN(vlanId, false, false /* NOT an inline call */))) {
       /* Note: source and destination hosts have, by definition, the same VLAN so the increase is done only one time. */
       /* Note: vl will never be null as we're in a flow with that vlan. Hence, it is guaranteed that at least
@@ -1480,11 +1597,6 @@ void Flow::hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host,
 
     // Update network stats
     cli_network_stats = cli_host->getNetworkStats(cli_network_id);
-    cli_host->incStats(tv->tv_sec, get_protocol(),
-		       stats_protocol, get_protocol_category(), custom_app,
-		       partial->get_cli2srv_packets(), partial->get_cli2srv_bytes(), partial->get_cli2srv_goodput_bytes(),
-		       partial->get_srv2cli_packets(), partial->get_srv2cli_bytes(), partial->get_srv2cli_goodput_bytes(),
-		       srv_host->get_ip()->isNonEmptyUnicastAddress());
 
     // update per-subnet byte counters
     if(cli_network_stats) { // only if the network is known and local
@@ -1502,11 +1614,6 @@ void Flow::hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host,
     }
 
     srv_network_stats = srv_host->getNetworkStats(srv_network_id);
-    srv_host->incStats(tv->tv_sec, get_protocol(),
-		       stats_protocol, get_protocol_category(), custom_app,
-		       partial->get_srv2cli_packets(), partial->get_srv2cli_bytes(), partial->get_srv2cli_goodput_bytes(),
-		       partial->get_cli2srv_packets(), partial->get_cli2srv_bytes(), partial->get_cli2srv_goodput_bytes(),
-		       cli_host->get_ip()->isNonEmptyUnicastAddress());
 
     if(srv_network_stats) {
       // local and known server network
@@ -1554,16 +1661,6 @@ void Flow::hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host,
 			 partial->get_srv2cli_bytes(), partial->get_cli2srv_packets(),
 			 partial->get_cli2srv_bytes());
     }
-    // Update client DSCP stats
-    cli_host->incDSCPStats(getCli2SrvDSCP(),
-      partial->get_cli2srv_packets(), partial->get_cli2srv_bytes(),
-      partial->get_srv2cli_packets(), partial->get_srv2cli_bytes());
-
-    // Update server DSCP stats
-    srv_host->incDSCPStats(getSrv2CliDSCP(),
-      partial->get_srv2cli_packets(), partial->get_srv2cli_bytes(),
-      partial->get_cli2srv_packets(), partial->get_cli2srv_bytes());
-
     // Update Country stats
     Country *cli_country_stats = cli_host->getCountryStats();
     Country *srv_country_stats = srv_host->getCountryStats();
@@ -1615,20 +1712,20 @@ void Flow::hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host,
   case IPPROTO_ICMP:
     if(iface) {
       if(partial->get_cli2srv_packets())
-	iface->incICMPStats(false /* icmp v4 */ , partial->get_cli2srv_packets(), protos.icmp.cli2srv.icmp_type, protos.icmp.cli2srv.icmp_code, true);
+	iface->incICMPStats(false /* icmp v4 */ , partial->get_cli2srv_packets(), protos->icmp.cli2srv.icmp_type, protos->icmp.cli2srv.icmp_code, true);
 
       if(partial->get_srv2cli_packets())
-	iface->incICMPStats(false /* icmp v4 */ , partial->get_srv2cli_packets(), protos.icmp.srv2cli.icmp_type, protos.icmp.srv2cli.icmp_code, true);
+	iface->incICMPStats(false /* icmp v4 */ , partial->get_srv2cli_packets(), protos->icmp.srv2cli.icmp_type, protos->icmp.srv2cli.icmp_code, true);
     }
     break;
 
   case IPPROTO_ICMPV6:
     if(iface) {
       if(partial->get_cli2srv_packets())
-	iface->incICMPStats(true /* icmp v6 */ , partial->get_cli2srv_packets(), protos.icmp.cli2srv.icmp_type, protos.icmp.cli2srv.icmp_code, true);
+	iface->incICMPStats(true /* icmp v6 */ , partial->get_cli2srv_packets(), protos->icmp.cli2srv.icmp_type, protos->icmp.cli2srv.icmp_code, true);
 
       if(partial->get_srv2cli_packets())
-	iface->incICMPStats(true /* icmp v6 */ , partial->get_srv2cli_packets(), protos.icmp.srv2cli.icmp_type, protos.icmp.srv2cli.icmp_code, true);
+	iface->incICMPStats(true /* icmp v6 */ , partial->get_srv2cli_packets(), protos->icmp.srv2cli.icmp_type, protos->icmp.srv2cli.icmp_code, true);
     }
 
     break;
@@ -1636,108 +1733,148 @@ void Flow::hosts_periodic_stats_update(NetworkInterface *iface, Host *cli_host,
     break;
   }
 
+  /*
+    The OS is set here and not by host_periodic_stats_update(), which can run
+    on a view merge thread: getOS() is read above for the OS stats
+  */
+  if(cli_host && (operating_system != os_unknown)
+     && (ndpi_get_lower_proto(ndpiDetectedProtocol) == NDPI_PROTOCOL_HTTP)
+     && !(get_cli_ip_addr()->isBroadcastAddress()
+	  || get_cli_ip_addr()->isMulticastAddress()))
+    cli_host->setOS(operating_system);
+}
+
+/* *************************************** */
+
+/* Stats of a single host, as client or server of the flow: the peer is only read */
+void Flow::host_periodic_stats_update(Host *host, Host *peer, bool as_client,
+				      PartializableFlowTrafficStats *partial,
+				      bool first_partial, const struct timeval *tv) const {
+  u_int64_t sent_packets, sent_bytes, sent_goodput_bytes, rcvd_packets, rcvd_bytes, rcvd_goodput_bytes;
+
+  if(!host)
+    return;
+
+  if(as_client) {
+    sent_packets = partial->get_cli2srv_packets(), sent_bytes = partial->get_cli2srv_bytes();
+    sent_goodput_bytes = partial->get_cli2srv_goodput_bytes();
+    rcvd_packets = partial->get_srv2cli_packets(), rcvd_bytes = partial->get_srv2cli_bytes();
+    rcvd_goodput_bytes = partial->get_srv2cli_goodput_bytes();
+  } else {
+    sent_packets = partial->get_srv2cli_packets(), sent_bytes = partial->get_srv2cli_bytes();
+    sent_goodput_bytes = partial->get_srv2cli_goodput_bytes();
+    rcvd_packets = partial->get_cli2srv_packets(), rcvd_bytes = partial->get_cli2srv_bytes();
+    rcvd_goodput_bytes = partial->get_cli2srv_goodput_bytes();
+  }
+
+  if(peer) {
+    if(as_client)
+      host->incCliContactedHosts(peer->get_ip());
+    else
+      host->incSrvHostContacts(peer->get_ip());
+
+    host->incStats(tv->tv_sec, get_protocol(),
+		   getStatsProtocol(), get_protocol_category(), custom_app,
+		   sent_packets, sent_bytes, sent_goodput_bytes,
+		   rcvd_packets, rcvd_bytes, rcvd_goodput_bytes,
+		   peer->get_ip()->isNonEmptyUnicastAddress());
+
+    // Update DSCP stats
+    host->incDSCPStats(as_client ? getCli2SrvDSCP() : getSrv2CliDSCP(),
+		       sent_packets, sent_bytes, rcvd_packets, rcvd_bytes);
+  }
+
+  if(get_protocol() == IPPROTO_TCP) {
+    Flow::incHostTcpBadStats(as_client, host,
+			     partial->get_cli2srv_tcp_ooo(), partial->get_cli2srv_tcp_retr(),
+			     partial->get_cli2srv_tcp_lost(), partial->get_cli2srv_tcp_keepalive());
+    Flow::incHostTcpBadStats(!as_client, host,
+			     partial->get_srv2cli_tcp_ooo(), partial->get_srv2cli_tcp_retr(),
+			     partial->get_srv2cli_tcp_lost(), partial->get_srv2cli_tcp_keepalive());
+  }
+
   switch(ndpi_get_lower_proto(ndpiDetectedProtocol)) {
   case NDPI_PROTOCOL_HTTP:
-    if(cli_host && cli_host->getHTTPstats()) cli_host->getHTTPstats()->incStats(true  /* Client */, partial->get_flow_http_stats());
-    if(srv_host && srv_host->getHTTPstats()) srv_host->getHTTPstats()->incStats(false /* Server */, partial->get_flow_http_stats());
-
-    if(operating_system != os_unknown) {
-      if(cli_host
-	 && !(get_cli_ip_addr()->isBroadcastAddress()
-	      || get_cli_ip_addr()->isMulticastAddress()))
-	cli_host->setOS(operating_system);
-    }
+    if(host->getHTTPstats()) host->getHTTPstats()->incStats(as_client, partial->get_flow_http_stats());
     /* Don't break, let's process also HTTP_PROXY */
   case NDPI_PROTOCOL_HTTP_PROXY:
-    if(srv_host) {
+    if(!as_client) {
       if(!Utils::isIPAddress(host_server_name) && hasRisk(NDPI_HTTP_NUMERIC_IP_HOST)) {
-        srv_host->offlineSetHTTPName(host_server_name);
+        host->offlineSetHTTPName(host_server_name);
       }
 
-      if(srv_host->getHTTPstats()
+      if(host->getHTTPstats()
          && host_server_name
          && isThreeWayHandshakeOK()) {
-        srv_host->getHTTPstats()->updateHTTPHostRequest(tv->tv_sec, host_server_name,
-                  partial->get_num_http_requests(),
-                  partial->get_cli2srv_bytes(),
-                  partial->get_srv2cli_bytes());
+        host->getHTTPstats()->updateHTTPHostRequest(tv->tv_sec, host_server_name,
+						    partial->get_num_http_requests(),
+						    partial->get_cli2srv_bytes(),
+						    partial->get_srv2cli_bytes());
       }
     }
     break;
   case NDPI_PROTOCOL_DNS:
-    if(cli_host && cli_host->getDNSstats())
-      cli_host->getDNSstats()->incStats(true  /* Client */, partial->get_flow_dns_stats());
-    if(srv_host && srv_host->getDNSstats())
-      srv_host->getDNSstats()->incStats(false /* Server */, partial->get_flow_dns_stats());
-    if(cli_host && srv_host)
-      cli_host->incDNSContactCardinality(srv_host);
+    if(host->getDNSstats())
+      host->getDNSstats()->incStats(as_client, partial->get_flow_dns_stats());
+    if(as_client && peer)
+      host->incDNSContactCardinality(peer);
     break;
 
   case NDPI_PROTOCOL_MDNS:
-    if(cli_host) {
-      if(protos.mdns.answer)   cli_host->offlineSetMDNSInfo(protos.mdns.answer);
-      if(protos.mdns.name)     cli_host->offlineSetMDNSName(protos.mdns.name);
-      if(protos.mdns.name_txt) cli_host->offlineSetMDNSTXTName(protos.mdns.name_txt);
+    if(as_client) {
+      if(protos->mdns.answer)   host->offlineSetMDNSInfo(protos->mdns.answer);
+      if(protos->mdns.name)     host->offlineSetMDNSName(protos->mdns.name);
+      if(protos->mdns.name_txt) host->offlineSetMDNSTXTName(protos->mdns.name_txt);
     }
     break;
   case NDPI_PROTOCOL_SSDP:
-    if(cli_host) {
-      if(protos.ssdp.location) cli_host->offlineSetSSDPLocation(protos.ssdp.location);
+    if(as_client) {
+      if(protos->ssdp.location) host->offlineSetSSDPLocation(protos->ssdp.location);
     }
     break;
   case NDPI_PROTOCOL_NETBIOS:
-    if(cli_host) {
-      if(protos.netbios.name) cli_host->offlineSetNetbiosName(protos.netbios.name);
+    if(as_client) {
+      if(protos->netbios.name) host->offlineSetNetbiosName(protos->netbios.name);
     }
     break;
   case NDPI_PROTOCOL_NTP:
-	  if(cli_host && srv_host) {
-      cli_host->incNTPContactCardinality(srv_host);
-    }
+    if(as_client && peer)
+      host->incNTPContactCardinality(peer);
     break;
   case NDPI_PROTOCOL_IP_ICMP:
   case NDPI_PROTOCOL_IP_ICMPV6:
-    if(cli_host && cli_host->getICMPstats()) {
-      if(partial->get_cli2srv_packets())
-	cli_host->getICMPstats()->incStats(partial->get_cli2srv_packets(), protos.icmp.cli2srv.icmp_type, protos.icmp.cli2srv.icmp_code, true  /* Sent */, srv_host);
-
-      if(partial->get_srv2cli_packets())
-	cli_host->getICMPstats()->incStats(partial->get_srv2cli_packets(), protos.icmp.srv2cli.icmp_type, protos.icmp.srv2cli.icmp_code, false /* Rcvd */, srv_host);
-    }
-    if(srv_host && srv_host->getICMPstats()) {
+    if(host->getICMPstats()) {
       if(partial->get_cli2srv_packets())
-	srv_host->getICMPstats()->incStats(partial->get_cli2srv_packets(), protos.icmp.cli2srv.icmp_type, protos.icmp.cli2srv.icmp_code, false /* Rcvd */, cli_host);
+	host->getICMPstats()->incStats(partial->get_cli2srv_packets(), protos->icmp.cli2srv.icmp_type, protos->icmp.cli2srv.icmp_code,
+				       as_client /* Sent */, peer);
 
       if(partial->get_srv2cli_packets())
-	srv_host->getICMPstats()->incStats(partial->get_srv2cli_packets(), protos.icmp.srv2cli.icmp_type, protos.icmp.srv2cli.icmp_code, true  /* Sent */, cli_host);
+	host->getICMPstats()->incStats(partial->get_srv2cli_packets(), protos->icmp.srv2cli.icmp_type, protos->icmp.srv2cli.icmp_code,
+				       !as_client /* Sent */, peer);
     }
 
     if(first_partial && icmp_info) {
-      if(icmp_info->isPortUnreachable()) { // Port unreachable icmpv6/icmpv4
-
-	if(srv_host) srv_host->incNumUnreachableFlows(true  /* as server */);
-	if(cli_host) cli_host->incNumUnreachableFlows(false /* as client */);
-      } else if(icmp_info->isHostUnreachable(protocol)) {
-	if(srv_host) srv_host->incNumHostUnreachableFlows(true  /* as server */);
-	if(cli_host) cli_host->incNumHostUnreachableFlows(false /* as client */);
-      }
+      if(icmp_info->isPortUnreachable()) // Port unreachable icmpv6/icmpv4
+	host->incNumUnreachableFlows(!as_client /* as server */);
+      else if(icmp_info->isHostUnreachable(protocol))
+	host->incNumHostUnreachableFlows(!as_client /* as server */);
     }
 
     break;
   case NDPI_PROTOCOL_MAIL_SMTPS:
   case NDPI_PROTOCOL_MAIL_SMTP:
-    if(cli_host && srv_host)
-      cli_host->incSMTPContactCardinality(srv_host);
+    if(as_client && peer)
+      host->incSMTPContactCardinality(peer);
     break;
   default:
     break;
   }
 
-  if(srv_host
+  if(!as_client
      && isTLS()
      && !hasRisk(NDPI_TLS_CERTIFICATE_MISMATCH)
-     && !Utils::isIPAddress(protos.tls.client_requested_server_name))
-    srv_host->offlineSetTLSName(protos.tls.client_requested_server_name);
+     && !Utils::isIPAddress(protos->tls.client_requested_server_name))
+    host->offlineSetTLSName(protos->tls.client_requested_server_name);
 }
 
 /* *************************************** */
@@ -2139,7 +2276,8 @@ void Flow::luaScore(lua_State* vm) {
 /* *************************************** */
 
 void Flow::lua(lua_State* vm, AddressTree * ptree,
-	       DetailsLevel details_level, bool skipNewTable) {
+	       DetailsLevel details_level, bool skipNewTable,
+	       u_int32_t fields) {
   const IpAddress *src_ip = get_cli_ip_addr(), *dst_ip = get_srv_ip_addr();
   bool src_match = true, dst_match = true;
   bool mask_flow;
@@ -2158,81 +2296,106 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
   lua_get_ip(vm, true  /* Client */);
   lua_get_ip(vm, false /* Server */);
 
-  lua_get_port(vm, true  /* Client */);
-  lua_get_port(vm, false /* Server */);
+  if(LUA_FIELD(fields, flow_lua_field_ports)) {
+    lua_get_port(vm, true  /* Client */);
+    lua_get_port(vm, false /* Server */);
+  }
 
   mask_flow = isMaskedFlow(); // mask_cli_host || mask_dst_host;
 
-  lua_get_bytes(vm);
+  if(LUA_FIELD(fields, flow_lua_field_bytes))
+    lua_get_bytes(vm);
 
   if(details_level >= details_high) {
-    lua_push_bool_table_entry(vm, "cli.allowed_host", src_match);
-    lua_push_bool_table_entry(vm, "srv.allowed_host", dst_match);
+    if(LUA_FIELD(fields, flow_lua_field_hosts)) {
+      lua_push_bool_table_entry(vm, "cli.allowed_host", src_match);
+      lua_push_bool_table_entry(vm, "srv.allowed_host", dst_match);
 
-    lua_get_info(vm, true /* Client */);
-    lua_get_info(vm, false /* Server */);
+      lua_get_info(vm, true /* Client */);
+      lua_get_info(vm, false /* Server */);
 
-    if(vrfId) lua_push_uint64_table_entry(vm, "vrfId", vrfId);
+      lua_push_int32_table_entry(vm, "cli.devtype", (cli_host && cli_host->getMac()) ? cli_host->getMac()->getDeviceType() : device_unknown);
+      lua_push_int32_table_entry(vm, "srv.devtype", (srv_host && srv_host->getMac()) ? srv_host->getMac()->getDeviceType() : device_unknown);
+    }
 
-    /* See VLANAddressTree.h for details */
-    lua_push_uint32_table_entry(vm, "vlan", get_vlan_id());
-    lua_push_uint32_table_entry(vm, "observation_point_id", get_observation_point_id());
+    if(LUA_FIELD(fields, flow_lua_field_vlan)) {
+      if(vrfId) lua_push_uint64_table_entry(vm, "vrfId", vrfId);
 
-    if(srcAS)
-      lua_push_int32_table_entry(vm, "src_as", srcAS);
-    else {
-      Host *h = get_cli_host();
+      /* See VLANAddressTree.h for details */
+      lua_push_uint32_table_entry(vm, "vlan", get_vlan_id());
+      lua_push_uint32_table_entry(vm, "observation_point_id", get_observation_point_id());
+    }
+
+    if(LUA_FIELD(fields, flow_lua_field_as)) {
+      if(srcAS)
+	lua_push_int32_table_entry(vm, "src_as", srcAS);
+      else {
+	Host *h = get_cli_host();
 
-      if(h) {
-	lua_push_int32_table_entry(vm, "src_as", h->get_asn());
-	lua_push_str_table_entry(vm, "src_as_name", h->get_asname());
+	if(h) {
+	  lua_push_int32_table_entry(vm, "src_as", h->get_asn());
+	  lua_push_str_table_entry(vm, "src_as_name", h->get_asname());
+	}
       }
-    }
 
-    if(dstAS)
-      lua_push_int32_table_entry(vm, "dst_as", dstAS);
-    else {
-      Host *h = get_srv_host();
+      if(dstAS)
+	lua_push_int32_table_entry(vm, "dst_as", dstAS);
+      else {
+	Host *h = get_srv_host();
 
-      if(h) {
-	lua_push_int32_table_entry(vm, "dst_as", h->get_asn());
-	lua_push_str_table_entry(vm, "dst_as_name", h->get_asname());
+	if(h) {
+	  lua_push_int32_table_entry(vm, "dst_as", h->get_asn());
+	  lua_push_str_table_entry(vm, "dst_as_name", h->get_asname());
+	}
       }
+
+      if(prevAdjacentAS) lua_push_int32_table_entry(vm, "prev_adjacent_as", prevAdjacentAS);
+      if(nextAdjacentAS)lua_push_int32_table_entry(vm, "next_adjacent_as", nextAdjacentAS);
     }
 
-    if(prevAdjacentAS) lua_push_int32_table_entry(vm, "prev_adjacent_as", prevAdjacentAS);
-    if(nextAdjacentAS)lua_push_int32_table_entry(vm, "next_adjacent_as", nextAdjacentAS);
+    if(LUA_FIELD(fields, flow_lua_field_dscp))
+      lua_tos(vm);
 
-    lua_tos(vm);
-    lua_get_protocols(vm);
-    lua_push_str_table_entry(vm, "community_id",
-			     (char*)getCommunityId(community_id, sizeof(community_id)));
+    if(LUA_FIELD(fields, flow_lua_field_proto)) {
+      lua_get_protocols(vm);
+      lua_confidence(vm);
+    }
+
+    if(LUA_FIELD(fields, flow_lua_field_info)) {
+      lua_push_str_table_entry(vm, "community_id",
+			       (char*)getCommunityId(community_id, sizeof(community_id)));
 
 #ifdef NTOPNG_PRO
 #ifndef HAVE_NEDGE
-    if((!mask_flow) && trafficProfile && ntop->getPro()->has_valid_license())
-      lua_push_str_table_entry(vm, "profile", trafficProfile->getName());
+      if((!mask_flow) && trafficProfile && ntop->getPro()->has_valid_license())
+	lua_push_str_table_entry(vm, "profile", trafficProfile->getName());
 #endif
 #endif
+    }
 
-    lua_get_packets(vm);
+    if(LUA_FIELD(fields, flow_lua_field_packets))
+      lua_get_packets(vm);
 
-    lua_get_time(vm);
+    if(LUA_FIELD(fields, flow_lua_field_time))
+      lua_get_time(vm);
 
-    lua_get_dir_traffic(vm, true /* Client to Server */);
-    lua_get_dir_traffic(vm, false /* Server to Client */);
+    if(LUA_FIELD(fields, flow_lua_field_dir_traffic)) {
+      lua_get_dir_traffic(vm, true /* Client to Server */);
+      lua_get_dir_traffic(vm, false /* Server to Client */);
+    }
 
-    luaScore(vm);
+    if(LUA_FIELD(fields, flow_lua_field_score))
+      luaScore(vm);
 
-    if(isICMP()) {
+    if(isICMP() && LUA_FIELD(fields, flow_lua_field_icmp)) {
       lua_newtable(vm);
 
       if(isBidirectional()) {
-	lua_push_uint64_table_entry(vm, "type", protos.icmp.srv2cli.icmp_type);
-	lua_push_uint64_table_entry(vm, "code", protos.icmp.srv2cli.icmp_code);
+	lua_push_uint64_table_entry(vm, "type", protos->icmp.srv2cli.icmp_type);
+	lua_push_uint64_table_entry(vm, "code", protos->icmp.srv2cli.icmp_code);
       } else {
-	lua_push_uint64_table_entry(vm, "type", protos.icmp.cli2srv.icmp_type);
-	lua_push_uint64_table_entry(vm, "code", protos.icmp.cli2srv.icmp_code);
+	lua_push_uint64_table_entry(vm, "type", protos->icmp.cli2srv.icmp_type);
+	lua_push_uint64_table_entry(vm, "code", protos->icmp.cli2srv.icmp_code);
       }
 
       if(icmp_info)
@@ -2243,21 +2406,23 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
       lua_settable(vm, -3);
     }
 
-    lua_push_int32_table_entry(vm, "cli.devtype", (cli_host && cli_host->getMac()) ? cli_host->getMac()->getDeviceType() : device_unknown);
-    lua_push_int32_table_entry(vm, "srv.devtype", (srv_host && srv_host->getMac()) ? srv_host->getMac()->getDeviceType() : device_unknown);
-
+    if(LUA_FIELD(fields, flow_lua_field_verdict)) {
 #ifdef HAVE_NEDGE
-    if(iface->is_bridge_interface())
-      lua_push_bool_table_entry(vm, "verdict.pass", isPassVerdict() ? 1 : 0);
+      if(iface->is_bridge_interface())
+	lua_push_bool_table_entry(vm, "verdict.pass", isPassVerdict() ? 1 : 0);
 #else
-    if(!passVerdict)
-      lua_push_bool_table_entry(vm, "verdict.pass", 0);
+      if(!passVerdict)
+	lua_push_bool_table_entry(vm, "verdict.pass", 0);
 #endif
 
-    if(get_protocol() == IPPROTO_TCP)
+      lua_push_int32_table_entry(vm, "l7_error_code", getErrorCode());
+      lua_push_int32_table_entry(vm, "flow_verdict", flow_verdict);
+    }
+
+    if((get_protocol() == IPPROTO_TCP) && LUA_FIELD(fields, flow_lua_field_tcp))
       lua_get_tcp_info(vm);
 
-    if(!mask_flow) {
+    if((!mask_flow) && LUA_FIELD(fields, flow_lua_field_info)) {
       char buf[64];
       char *info = getFlowInfo(buf, sizeof(buf), true);
 
@@ -2267,15 +2432,16 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
       lua_push_str_table_entry(vm, "info", info ? info : (char*)"");
     }
 
-    if(isDNS() && protos.dns.last_query) {
-      lua_push_uint64_table_entry(vm, "protos.dns.last_query_type", protos.dns.last_query_type);
-      lua_push_uint64_table_entry(vm, "protos.dns.last_return_code", protos.dns.last_return_code);
+    if(isDNS() && protos->dns.last_query && LUA_FIELD(fields, flow_lua_field_info)) {
+      lua_push_uint64_table_entry(vm, "protos.dns.last_query_type", protos->dns.last_query_type);
+      lua_push_uint64_table_entry(vm, "protos.dns.last_return_code", protos->dns.last_return_code);
     }
 
 #ifdef HAVE_NEDGE
-    lua_push_uint64_table_entry(vm, "marker", marker);
+    if(LUA_FIELD(fields, flow_lua_field_verdict))
+      lua_push_uint64_table_entry(vm, "marker", marker);
 
-    if(cli_host && srv_host) {
+    if(cli_host && srv_host && LUA_FIELD(fields, flow_lua_field_verdict)) {
       /* Shapers */
       lua_push_uint64_table_entry(vm,
 				  "shaper.cli2srv_ingress",
@@ -2296,7 +2462,7 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
     }
 #endif
 
-    if(!mask_flow) {
+    if((!mask_flow) && LUA_FIELD(fields, flow_lua_field_app)) {
       if(isHTTP())
 	lua_get_http_info(vm);
 
@@ -2310,52 +2476,54 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
 	lua_get_tls_info(vm);
     }
 
-    if(!getInterface()->isPacketInterface())
+    if((!getInterface()->isPacketInterface()) && LUA_FIELD(fields, flow_lua_field_snmp))
       lua_snmp_info(vm);
 
-    lua_push_int32_table_entry(vm, "l7_error_code", getErrorCode());
-    lua_push_int32_table_entry(vm, "flow_verdict", flow_verdict);
-
-    if(get_json_info()) {
-      lua_push_str_table_entry(vm, "moreinfo.json", json_object_to_json_string(get_json_info()));
-      has_json_info = true;
-    } else if(get_tlv_info()) {
-      ndpi_deserializer deserializer;
+    if(LUA_FIELD(fields, flow_lua_field_json)) {
+      if(get_json_info()) {
+	lua_push_str_table_entry(vm, "moreinfo.json", json_object_to_json_string(get_json_info()));
+	has_json_info = true;
+      } else if(get_tlv_info()) {
+	ndpi_deserializer deserializer;
 
-      if(ndpi_init_deserializer(&deserializer, get_tlv_info()) == 0) {
-        ndpi_serializer serializer;
+	if(ndpi_init_deserializer(&deserializer, get_tlv_info()) == 0) {
+	  ndpi_serializer serializer;
 
-        if(ndpi_init_serializer(&serializer, ndpi_serialization_format_json) >= 0) {
-          char *buffer;
-          u_int32_t buffer_len;
+	  if(ndpi_init_serializer(&serializer, ndpi_serialization_format_json) >= 0) {
+	    char *buffer;
+	    u_int32_t buffer_len;
 
-          ndpi_deserialize_clone_all(&deserializer, &serializer);
-          buffer = ndpi_serializer_get_buffer(&serializer, &buffer_len);
+	    ndpi_deserialize_clone_all(&deserializer, &serializer);
+	    buffer = ndpi_serializer_get_buffer(&serializer, &buffer_len);
 
-          if(buffer) {
-            lua_push_str_table_entry(vm, "moreinfo.json", buffer);
-            has_json_info = true;
-          }
+	    if(buffer) {
+	      lua_push_str_table_entry(vm, "moreinfo.json", buffer);
+	      has_json_info = true;
+	    }
 
-          ndpi_term_serializer(&serializer);
-        }
+	    ndpi_term_serializer(&serializer);
+	  }
+	}
       }
-    }
 
-    if(iec104) iec104->lua(vm);
+      if(iec104) iec104->lua(vm);
 
-    if(!has_json_info)
-      lua_push_str_table_entry(vm, "moreinfo.json", "{}");
+      if(!has_json_info)
+	lua_push_str_table_entry(vm, "moreinfo.json", "{}");
 
-    if(ebpf) ebpf->lua(vm);
+      if(ebpf) ebpf->lua(vm);
+    }
 
-    lua_get_throughput(vm);
+    if(LUA_FIELD(fields, flow_lua_field_thpt))
+      lua_get_throughput(vm);
 
     /* Interarrival Times */
-    lua_get_dir_iat(vm, true /* Client to Server */);
-    lua_get_dir_iat(vm, false /* Server to Client */);
+    if(LUA_FIELD(fields, flow_lua_field_iat)) {
+      lua_get_dir_iat(vm, true /* Client to Server */);
+      lua_get_dir_iat(vm, false /* Server to Client */);
+    }
 
-    if((!mask_flow) && (details_level >= details_higher)) {
+    if((!mask_flow) && (details_level >= details_higher) && LUA_FIELD(fields, flow_lua_field_geoloc)) {
       lua_get_geoloc(vm, true /* Client */, true /* Coordinates */, false /* Country and City */);
       lua_get_geoloc(vm, false /* Server */, true /* Coordinates */, false /* Country and City */);
 
@@ -2364,15 +2532,18 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
 	lua_get_geoloc(vm, false /* Server */, false /* Coordinates */, true /* Country and City */);
       }
     }
-    lua_confidence(vm);
-    lua_get_risk_info(vm);
-    lua_entropy(vm);
 
-    if(getJSONRiskInfo())
-      lua_push_str_table_entry(vm, "riskInfo", getJSONRiskInfo());
+    if(LUA_FIELD(fields, flow_lua_field_risk)) {
+      lua_get_risk_info(vm);
+      lua_entropy(vm);
+
+      if(getJSONRiskInfo())
+	lua_push_str_table_entry(vm, "riskInfo", getJSONRiskInfo());
+    }
   }
 
-  lua_get_status(vm);
+  if(LUA_FIELD(fields, flow_lua_field_status))
+    lua_get_status(vm);
 
   // this is used to dynamicall update entries in the GUI
   lua_push_uint64_table_entry(vm, "ntopng.key", key()); // Key
@@ -2710,25 +2881,25 @@ void Flow::formatECSExtraInfo(json_object *my_object) {
 void Flow::formatECSAppProto(json_object *my_object) {
   json_object *application_object;
   if((application_object = json_object_new_object()) != NULL) {
-    if(isDNS() && protos.dns.last_query) {
-      json_object_object_add(application_object, "question.name", json_object_new_string(protos.dns.last_query));
+    if(isDNS() && protos->dns.last_query) {
+      json_object_object_add(application_object, "question.name", json_object_new_string(protos->dns.last_query));
       json_object_object_add(my_object, "dns", application_object);
     }
 
-    if(isTLS() && protos.tls.client_requested_server_name) {
-      json_object_object_add(application_object, "server_name", json_object_new_string(protos.tls.client_requested_server_name));
+    if(isTLS() && protos->tls.client_requested_server_name) {
+      json_object_object_add(application_object, "server_name", json_object_new_string(protos->tls.client_requested_server_name));
       json_object_object_add(my_object, "tls", application_object);
     }
 
     if(isHTTP()) {
-      if(protos.http.last_url && protos.http.last_url[0] != '0')
-        json_object_object_add(application_object, "request.url", json_object_new_string(protos.http.last_url));
-      if(protos.http.last_user_agent && protos.http.last_user_agent[0] != '0')
-        json_object_object_add(application_object, "user_agent", json_object_new_string(protos.http.last_user_agent));
-      if(protos.http.last_method != NDPI_HTTP_METHOD_UNKNOWN)
-        json_object_object_add(application_object, "request.method", json_object_new_string(ndpi_http_method2str(protos.http.last_method)));
-      if(protos.http.last_return_code > 0)
-        json_object_object_add(application_object, "response.status_code", json_object_new_int((u_int32_t)protos.http.last_return_code));
+      if(protos->http.last_url && protos->http.last_url[0] != '0')
+        json_object_object_add(application_object, "request.url", json_object_new_string(protos->http.last_url));
+      if(protos->http.last_user_agent && protos->http.last_user_agent[0] != '0')
+        json_object_object_add(application_object, "user_agent", json_object_new_string(protos->http.last_user_agent));
+      if(protos->http.last_method != NDPI_HTTP_METHOD_UNKNOWN)
+        json_object_object_add(application_object, "request.method", json_object_new_string(ndpi_http_method2str(protos->http.last_method)));
+      if(protos->http.last_return_code > 0)
+        json_object_object_add(application_object, "response.status_code", json_object_new_int((u_int32_t)protos->http.last_return_code));
 
       json_object_object_add(my_object, "http", application_object);
     }
@@ -2923,13 +3094,13 @@ void Flow::formatSyslogFlow(json_object *my_object) {
     json_object_object_add(my_object, Utils::jsonLabel(OUT_DST_MAC, "OUT_DST_MAC", jsonbuf, sizeof(jsonbuf)),
           json_object_new_string(Utils::formatMac(srv_host ? srv_host->get_mac() : NULL, buf, sizeof(buf))));
 
-  if(isTLS() && protos.tls.ja3.client_hash)
+  if(isTLS() && protos->tls.ja3.client_hash)
     json_object_object_add(my_object, Utils::jsonLabel(JA3C_HASH, "JA3C_HASH", jsonbuf, sizeof(jsonbuf)),
-          json_object_new_string(protos.tls.ja3.client_hash));
+          json_object_new_string(protos->tls.ja3.client_hash));
 
-  if(isSSH() && protos.ssh.hassh.client_hash)
+  if(isSSH() && protos->ssh.hassh.client_hash)
     json_object_object_add(my_object, Utils::jsonLabel(HASSHC_HASH, "HASSHC_HASH", jsonbuf, sizeof(jsonbuf)),
-          json_object_new_string(protos.ssh.hassh.client_hash));
+          json_object_new_string(protos->ssh.hassh.client_hash));
 
   formatGenericFlow(my_object);
 }
@@ -3098,22 +3269,22 @@ void Flow::formatGenericFlow(json_object *my_object) {
   if(iface && iface->get_name())
     json_object_object_add(my_object, "INTERFACE", json_object_new_string(iface->get_name()));
 
-  if(isDNS() && protos.dns.last_query)
-    json_object_object_add(my_object, "DNS_QUERY", json_object_new_string(protos.dns.last_query));
+  if(isDNS() && protos->dns.last_query)
+    json_object_object_add(my_object, "DNS_QUERY", json_object_new_string(protos->dns.last_query));
 
   json_object_object_add(my_object, "COMMUNITY_ID", json_object_new_string((char *)getCommunityId(community_id, sizeof(community_id))));
   
   if(isHTTP()) {
     if(host_server_name && host_server_name[0] != '\0')
       json_object_object_add(my_object, "HTTP_HOST", json_object_new_string(host_server_name));
-    if(protos.http.last_url && protos.http.last_url[0] != '0')
-      json_object_object_add(my_object, "HTTP_URL", json_object_new_string(protos.http.last_url));
-    if(protos.http.last_user_agent && protos.http.last_user_agent[0] != '0')
-      json_object_object_add(my_object, "HTTP_USER_AGENT", json_object_new_string(protos.http.last_user_agent));
-    if(protos.http.last_method != NDPI_HTTP_METHOD_UNKNOWN)
-      json_object_object_add(my_object, "HTTP_METHOD", json_object_new_string(ndpi_http_method2str(protos.http.last_method)));
-    if(protos.http.last_return_code > 0)
-      json_object_object_add(my_object, "HTTP_RET_CODE", json_object_new_int((u_int32_t)protos.http.last_return_code));
+    if(protos->http.last_url && protos->http.last_url[0] != '0')
+      json_object_object_add(my_object, "HTTP_URL", json_object_new_string(protos->http.last_url));
+    if(protos->http.last_user_agent && protos->http.last_user_agent[0] != '0')
+      json_object_object_add(my_object, "HTTP_USER_AGENT", json_object_new_string(protos->http.last_user_agent));
+    if(protos->http.last_method != NDPI_HTTP_METHOD_UNKNOWN)
+      json_object_object_add(my_object, "HTTP_METHOD", json_object_new_string(ndpi_http_method2str(protos->http.last_method)));
+    if(protos->http.last_return_code > 0)
+      json_object_object_add(my_object, "HTTP_RET_CODE", json_object_new_int((u_int32_t)protos->http.last_return_code));
   }
 
   if(flow_device.device_ip)
@@ -3123,9 +3294,9 @@ void Flow::formatGenericFlow(json_object *my_object) {
   if(bt_hash)
     json_object_object_add(my_object, "BITTORRENT_HASH", json_object_new_string(bt_hash));
 
-  if(isTLS() && protos.tls.client_requested_server_name)
+  if(isTLS() && protos->tls.client_requested_server_name)
     json_object_object_add(my_object, "TLS_SERVER_NAME",
-			   json_object_new_string(protos.tls.client_requested_server_name));
+			   json_object_new_string(protos->tls.client_requested_server_name));
 
 #ifdef HAVE_NEDGE
   if(iface && iface->is_bridge_interface())
@@ -3199,7 +3370,7 @@ u_char* Flow::getCommunityId(u_char *community_id, u_int community_id_len) {
 
     if(c->isIPv4()) {
       if(get_protocol() == IPPROTO_ICMP)
-	icmp_type = protos.icmp.cli2srv.icmp_type, icmp_code = protos.icmp.cli2srv.icmp_code;
+	icmp_type = protos->icmp.cli2srv.icmp_type, icmp_code = protos->icmp.cli2srv.icmp_code;
 
       if(ndpi_flowv4_flow_hash(protocol, ntohl(c->get_ipv4()), ntohl(s->get_ipv4()),
 			       get_cli_port(), get_srv_port(),
@@ -3208,7 +3379,7 @@ u_char* Flow::getCommunityId(u_char *community_id, u_int community_id_len) {
 	return(community_id);
     } else {
       if(get_protocol() == IPPROTO_ICMPV6)
-	icmp_type = protos.icmp.cli2srv.icmp_type, icmp_code = protos.icmp.cli2srv.icmp_code;
+	icmp_type = protos->icmp.cli2srv.icmp_type, icmp_code = protos->icmp.cli2srv.icmp_code;
 
       if(c->isIPv6()) {
 	if(ndpi_flowv6_flow_hash(protocol, (struct ndpi_in6_addr*)c->get_ipv6(),
@@ -3326,13 +3497,13 @@ void Flow::alert2JSON(FlowAlert *alert, ndpi_serializer *s) {
   ndpi_serialize_string_string(s, "community_id",
 			       (char*)getCommunityId(community_id, sizeof(community_id)));
 
-  if(protos.tls.ja3.client_hash)
+  if(protos->tls.ja3.client_hash)
     ndpi_serialize_string_string(s, "ja3_client_hash",
-				 protos.tls.ja3.client_hash);
+				 protos->tls.ja3.client_hash);
 
-  if(protos.tls.ja3.server_hash)
+  if(protos->tls.ja3.server_hash)
     ndpi_serialize_string_string(s, "ja3_server_hash",
-				 protos.tls.ja3.server_hash);
+				 protos->tls.ja3.server_hash);
 
   if(getErrorCode() != 0)
     ndpi_serialize_string_uint32(s, "l7_error_code", getErrorCode());
@@ -3826,6 +3997,102 @@ void Flow::incStats(bool cli2srv_direction, u_int pkt_len,
 
 /* *************************************** */
 
+/* Called on the packets of detected flows: enables the fast accounting when nothing more has to be dissected */
+void Flow::updateFastAccounting() {
+  if((!isDetectionCompleted()) || needsExtraDissection())
+    return;
+
+  switch(protocol) {
+  case IPPROTO_TCP:
+    if(!twh_over) return; /* Wait for the RTT computed on the 3WH */
+    break;
+  case IPPROTO_UDP:
+    break;
+  default:
+    return;
+  }
+
+  /* Protocols dissected by NetworkInterface::processPacket after detection */
+  switch(ndpi_get_lower_proto(get_detected_protocol())) {
+  case NDPI_PROTOCOL_DHCP:
+  case NDPI_PROTOCOL_DHCPV6:
+  case NDPI_PROTOCOL_NETBIOS:
+  case NDPI_PROTOCOL_BITTORRENT:
+  case NDPI_PROTOCOL_HTTP:
+  case NDPI_PROTOCOL_SSDP:
+  case NDPI_PROTOCOL_DNS:
+  case NDPI_PROTOCOL_IEC60870:
+  case NDPI_PROTOCOL_MDNS:
+    return;
+  }
+
+  fast_accounting = 1, fast_accounting_skipped = 0;
+}
+
+/* *************************************** */
+
+/*
+  Returns true when the packet has been accounted, false when it has to go
+  through the full path. This is the case of packets carrying TCP flags other
+  than ACK/PSH, zero windows or payload still needed by the entropy and the
+  application latency, and of one packet out of FLOW_FAST_ACCOUNTING_SAMPLING
+  which keeps the IAT, TCP window and flags up to date.
+ */
+bool Flow::fastAccountingPacket(bool cli2srv_direction, u_int pkt_len, u_int payload_len,
+				u_int8_t tcp_flags, bool tcp_zero_window, const struct bpf_timeval *when) {
+  FlowTCPState *tcp;
+  struct timeval tv;
+
+  if((tcp_flags & ~(TH_ACK | TH_PUSH)) || tcp_zero_window
+     || (!iface->isFlowFastAccountingAllowed()))
+    goto full_path;
+
+  payload_len *= iface->getScalingFactor();
+
+  if((payload_len > 0)
+     && ((applLatencyMsec == 0)
+	 || ((cli2srv_direction ? get_bytes_cli2srv() : get_bytes_srv2cli()) < MAX_ENTROPY_BYTES)))
+    goto full_path;
+
+  if(++fast_accounting_skipped == FLOW_FAST_ACCOUNTING_SAMPLING)
+    goto full_path;
+
+  updateSeen();
+  callFlowUpdate(when->tv_sec);
+
+  /* Only the last packet time: the IAT is computed on the sampled packets */
+  tv.tv_sec = when->tv_sec, tv.tv_usec = when->tv_usec;
+  updatePacketStats(cli2srv_direction ? getCli2SrvIATStats() : getSrv2CliIATStats(), &tv, false);
+
+  stats.incStats(cli2srv_direction, 1, pkt_len, payload_len);
+
+  if(cli2srv_direction) {
+    if(cli_host) cli_host->incSentStats(1, pkt_len);
+    if(srv_host) srv_host->incRecvStats(1, pkt_len);
+  } else {
+    if(cli_host) cli_host->incRecvStats(1, pkt_len);
+    if(srv_host) srv_host->incSentStats(1, pkt_len);
+  }
+
+  return(true);
+
+ full_path:
+  if(fast_accounting_skipped) {
+    /*
+      Sequence numbers are not tracked on the fast path: re-seed them
+      so that no retransmission or loss is made up after skipped packets
+    */
+    if((tcp = getTCPState()) != NULL)
+      tcp->seq_s2d.next = tcp->seq_d2s.next = 0;
+
+    fast_accounting_skipped = 0;
+  }
+
+  return(false);
+}
+
+/* *************************************** */
+
 void Flow::updateInterfaceLocalStats(bool src2dst_direction, u_int num_pkts, u_int pkt_len) {
   const IpAddress *from = src2dst_direction ? get_cli_ip_addr() : get_srv_ip_addr();
   const IpAddress *to   = src2dst_direction ? get_srv_ip_addr() : get_cli_ip_addr();
@@ -4018,13 +4285,15 @@ void Flow::updateTcpFlags(const struct bpf_timeval *when,
 	  iface->getTcpFlowStats()->incEstablished();
     }
   } else {
-    if(!twh_over) {
+    FlowTCPState *tcp;
+
+    if(!twh_over && ((tcp = getTCPState()) != NULL)) {
       if(flags_3wh == TH_SYN) {
-	if(synTime.tv_sec == 0) memcpy(&synTime, when, sizeof(struct timeval));
+	if(tcp->synTime.tv_sec == 0) memcpy(&tcp->synTime, when, sizeof(struct timeval));
       } else if(flags_3wh == (TH_SYN|TH_ACK)) {
-	if((synAckTime.tv_sec == 0) && (synTime.tv_sec > 0)) {
-	  memcpy(&synAckTime, when, sizeof(struct timeval));
-	  timeval_diff(&synTime, (struct timeval*)when, &serverNwLatency, 1);
+	if((tcp->synAckTime.tv_sec == 0) && (tcp->synTime.tv_sec > 0)) {
+	  memcpy(&tcp->synAckTime, when, sizeof(struct timeval));
+	  timeval_diff(&tcp->synTime, (struct timeval*)when, &serverNwLatency, 1);
 	  /* Sanity check */
 	  if(serverNwLatency.tv_sec > 5)
 	    memset(&serverNwLatency, 0, sizeof(serverNwLatency));
@@ -4034,9 +4303,9 @@ void Flow::updateTcpFlags(const struct bpf_timeval *when,
       } else if((flags_3wh == TH_ACK)
 		|| (flags_3wh == (TH_ACK|TH_PUSH)) /* TCP Fast Open may contain data and PSH in the final TWH ACK */
 		) {
-	if((ackTime.tv_sec == 0) && (synAckTime.tv_sec > 0)) {
-	  memcpy(&ackTime, when, sizeof(struct timeval));
-	  timeval_diff(&synAckTime, (struct timeval*)when, &clientNwLatency, 1);
+	if((tcp->ackTime.tv_sec == 0) && (tcp->synAckTime.tv_sec > 0)) {
+	  memcpy(&tcp->ackTime, when, sizeof(struct timeval));
+	  timeval_diff(&tcp->synAckTime, (struct timeval*)when, &clientNwLatency, 1);
 
 	  /* Sanity check */
 	  if(clientNwLatency.tv_sec > 5)
@@ -4107,14 +4376,14 @@ char* Flow::getFlowInfo(char *buf, u_int buf_len, bool isLuaRequest) {
     if(iec104)
       return(iec104->getFlowInfo(buf, buf_len));
 
-    if(isDNS() && protos.dns.last_query)
-      return protos.dns.last_query;
+    if(isDNS() && protos->dns.last_query)
+      return protos->dns.last_query;
 
-    else if(isHTTP() && protos.http.last_url)
-      return protos.http.last_url;
+    else if(isHTTP() && protos->http.last_url)
+      return protos->http.last_url;
 
-    else if(isTLS() && protos.tls.client_requested_server_name)
-      return protos.tls.client_requested_server_name;
+    else if(isTLS() && protos->tls.client_requested_server_name)
+      return protos->tls.client_requested_server_name;
 
     else if(isBittorrent() && bt_hash)
       return bt_hash;
@@ -4123,10 +4392,10 @@ char* Flow::getFlowInfo(char *buf, u_int buf_len, bool isLuaRequest) {
       return host_server_name;
 
     else if(isSSH()) {
-      if(protos.ssh.server_signature)
-	return protos.ssh.server_signature;
-      else if(protos.ssh.client_signature)
-	return protos.ssh.client_signature;
+      if(protos->ssh.server_signature)
+	return protos->ssh.server_signature;
+      else if(protos->ssh.client_signature)
+	return protos->ssh.client_signature;
     }
 
     else if(isLuaRequest && hasRisk(NDPI_DESKTOP_OR_FILE_SHARING_SESSION))
@@ -4152,6 +4421,26 @@ u_int32_t Flow::getNextTcpSeq ( u_int8_t tcpFlags,
 
 /* *************************************** */
 
+void Flow::incHostTcpBadStats(bool sent, Host *host,
+			      u_int32_t ooo_pkts,
+			      u_int32_t retr_pkts,
+			      u_int32_t lost_pkts,
+			      u_int32_t keep_alive_pkts) {
+#ifdef HAVE_NEDGE
+  return;
+#endif
+
+  if(!ooo_pkts && !retr_pkts && !lost_pkts && !keep_alive_pkts)
+    return;
+
+  if(sent)
+    host->incSentTcp(ooo_pkts, retr_pkts, lost_pkts, keep_alive_pkts);
+  else
+    host->incRcvdTcp(ooo_pkts, retr_pkts, lost_pkts, keep_alive_pkts);
+}
+
+/* *************************************** */
+
 void Flow::incTcpBadStats(bool src2dst_direction,
 			  Host *cli, Host *srv,
 			  NetworkInterface *iface,
@@ -4179,16 +4468,12 @@ void Flow::incTcpBadStats(bool src2dst_direction,
     if(keep_alive_pkts) iface->incKeepAlivePkts(keep_alive_pkts);
   }
 
+  /* Hosts are updated by incHostTcpBadStats() */
   if(cli) {
     cli_network_id = cli->get_local_network_id();
     cli_network_stats = cli->getNetworkStats(cli_network_id);
     cli_asn = cli->get_asn();
     cli_as = cli->get_as();
-
-    if(src2dst_direction)
-      cli->incSentTcp(ooo_pkts, retr_pkts, lost_pkts, keep_alive_pkts);
-    else
-      cli->incRcvdTcp(ooo_pkts, retr_pkts, lost_pkts, keep_alive_pkts);
   }
 
   if(srv) {
@@ -4196,11 +4481,6 @@ void Flow::incTcpBadStats(bool src2dst_direction,
     srv_network_stats = srv->getNetworkStats(srv_network_id);
     srv_asn = srv->get_asn();
     srv_as = srv->get_as();
-
-    if(src2dst_direction)
-      srv->incRcvdTcp(ooo_pkts, retr_pkts, lost_pkts, keep_alive_pkts);
-    else
-      srv->incSentTcp(ooo_pkts, retr_pkts, lost_pkts, keep_alive_pkts);
   }
 
   if(cli_network_id >= 0 && (cli_network_id == srv_network_id))
@@ -4252,6 +4532,7 @@ void Flow::updateTcpSeqNum(const struct bpf_timeval *when,
 			   u_int16_t window, u_int8_t flags,
 			   u_int16_t payload_Len, bool src2dst_direction) {
   u_int32_t next_seq_num;
+  FlowTCPState *tcp;
   bool update_last_seqnum = true;
   bool debug = false;
   u_int32_t cnt_keep_alive = 0, cnt_lost = 0, cnt_ooo = 0, cnt_retx = 0;
@@ -4260,6 +4541,17 @@ void Flow::updateTcpSeqNum(const struct bpf_timeval *when,
   return;
 #endif
 
+  /* The windows are updated also when the TCP state can't be allocated */
+  if(window > 0) {
+    if(src2dst_direction)
+      srv2cli_window = window; /* Note the window is reverted */
+    else
+      cli2srv_window = window;
+  }
+
+  if((tcp = getTCPState()) == NULL)
+    return;
+
   next_seq_num = getNextTcpSeq(flags, seq_num, payload_Len);
 
   if(debug)
@@ -4270,69 +4562,67 @@ void Flow::updateTcpSeqNum(const struct bpf_timeval *when,
 				 payload_Len);
 
   if(src2dst_direction) {
-    if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst][last: %u][next: %u]", tcp_seq_s2d.last, tcp_seq_s2d.next);
+    if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst][last: %u][next: %u]", tcp->seq_s2d.last, tcp->seq_s2d.next);
 
-    if(window > 0) srv2cli_window = window; /* Note the window is reverted */
-    if(tcp_seq_s2d.next > 0) {
-      if((tcp_seq_s2d.next != seq_num) /* If equal, seq_num is the expected seq_num as determined with prev. segment */
-	 && (tcp_seq_s2d.next != (seq_num - 1))) {
-	if((seq_num == tcp_seq_s2d.next - 1)
+    if(tcp->seq_s2d.next > 0) {
+      if((tcp->seq_s2d.next != seq_num) /* If equal, seq_num is the expected seq_num as determined with prev. segment */
+	 && (tcp->seq_s2d.next != (seq_num - 1))) {
+	if((seq_num == tcp->seq_s2d.next - 1)
 	   && (payload_Len == 0 || payload_Len == 1)
 	   && ((flags & (TH_SYN|TH_FIN|TH_RST)) == 0)) {
 	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst] Packet KeepAlive");
 	  cnt_keep_alive++;
-	} else if(tcp_seq_s2d.last == seq_num) {
-          if(tcp_seq_s2d.next != tcp_seq_s2d.last) {
+	} else if(tcp->seq_s2d.last == seq_num) {
+          if(tcp->seq_s2d.next != tcp->seq_s2d.last) {
 	    cnt_retx++;
 	    if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst] Packet retransmission");
           }
-	} else if((tcp_seq_s2d.last > seq_num)
-		  && (seq_num < tcp_seq_s2d.next)) {
+	} else if((tcp->seq_s2d.last > seq_num)
+		  && (seq_num < tcp->seq_s2d.next)) {
 	  cnt_lost++;
-	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst] Packet lost [last: %u][act: %u]", tcp_seq_s2d.last, seq_num);
+	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst] Packet lost [last: %u][act: %u]", tcp->seq_s2d.last, seq_num);
 	} else {
 	  cnt_ooo++;
-	  update_last_seqnum = ((seq_num - 1) > tcp_seq_s2d.last) ? true : false;
-	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst] Packet OOO [last: %u][act: %u]", tcp_seq_s2d.last, seq_num);
+	  update_last_seqnum = ((seq_num - 1) > tcp->seq_s2d.last) ? true : false;
+	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[src2dst] Packet OOO [last: %u][act: %u]", tcp->seq_s2d.last, seq_num);
 	}
       }
     }
 
-    tcp_seq_s2d.next = next_seq_num;
-    if(update_last_seqnum) tcp_seq_s2d.last = seq_num;
+    tcp->seq_s2d.next = next_seq_num;
+    if(update_last_seqnum) tcp->seq_s2d.last = seq_num;
   } else {
-    if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src][last: %u][next: %u]", tcp_seq_d2s.last, tcp_seq_d2s.next);
+    if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src][last: %u][next: %u]", tcp->seq_d2s.last, tcp->seq_d2s.next);
 
-    if(window > 0) cli2srv_window = window; /* Note the window is reverted */
-    if(tcp_seq_d2s.next > 0) {
-      if((tcp_seq_d2s.next != seq_num)
-	 && (tcp_seq_d2s.next != (seq_num-1))) {
-	if((seq_num == tcp_seq_d2s.next - 1)
+    if(tcp->seq_d2s.next > 0) {
+      if((tcp->seq_d2s.next != seq_num)
+	 && (tcp->seq_d2s.next != (seq_num-1))) {
+	if((seq_num == tcp->seq_d2s.next - 1)
 	   && (payload_Len == 0 || payload_Len == 1)
 	   && ((flags & (TH_SYN|TH_FIN|TH_RST)) == 0)) {
 	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] Packet KeepAlive");
 	  cnt_keep_alive++;
-	} else if(tcp_seq_d2s.last == seq_num) {
-          if(tcp_seq_d2s.next != tcp_seq_d2s.last) {
+	} else if(tcp->seq_d2s.last == seq_num) {
+          if(tcp->seq_d2s.next != tcp->seq_d2s.last) {
 	    cnt_retx++;
 	    if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] Packet retransmission");
           }
 	  // bytes
-	} else if((tcp_seq_d2s.last > seq_num)
-		  && (seq_num < tcp_seq_d2s.next)) {
+	} else if((tcp->seq_d2s.last > seq_num)
+		  && (seq_num < tcp->seq_d2s.next)) {
 	  cnt_lost++;
-	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] Packet lost [last: %u][act: %u]", tcp_seq_d2s.last, seq_num);
+	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] Packet lost [last: %u][act: %u]", tcp->seq_d2s.last, seq_num);
 	} else {
 	  cnt_ooo++;
-	  update_last_seqnum = ((seq_num - 1) > tcp_seq_d2s.last) ? true : false;
-	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] [last: %u][next: %u]", tcp_seq_d2s.last, tcp_seq_d2s.next);
-	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] Packet OOO [last: %u][act: %u]", tcp_seq_d2s.last, seq_num);
+	  update_last_seqnum = ((seq_num - 1) > tcp->seq_d2s.last) ? true : false;
+	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] [last: %u][next: %u]", tcp->seq_d2s.last, tcp->seq_d2s.next);
+	  if(debug) ntop->getTrace()->traceEvent(TRACE_WARNING, "[dst2src] Packet OOO [last: %u][act: %u]", tcp->seq_d2s.last, seq_num);
 	}
       }
     }
 
-    tcp_seq_d2s.next = next_seq_num;
-    if(update_last_seqnum) tcp_seq_d2s.last = seq_num;
+    tcp->seq_d2s.next = next_seq_num;
+    if(update_last_seqnum) tcp->seq_d2s.last = seq_num;
   }
 
   if(cnt_keep_alive || cnt_lost || cnt_ooo || cnt_retx)
@@ -4452,12 +4742,12 @@ bool Flow::setDNSQuery(char *v) {
   if(isDNS()) {
     time_t last_pkt_rcvd = getInterface()->getTimeLastPktRcvd();
 
-    if(!protos.dns.last_query_shadow /* The first time the swap is done */
-       || protos.dns.last_query_update_time + 1 < last_pkt_rcvd /* Latest swap occurred at least one second ago */) {
-      if(protos.dns.last_query_shadow) free(protos.dns.last_query_shadow);
-      protos.dns.last_query_shadow = protos.dns.last_query;
-      protos.dns.last_query = v;
-      protos.dns.last_query_update_time = last_pkt_rcvd;
+    if(!protos->dns.last_query_shadow /* The first time the swap is done */
+       || protos->dns.last_query_update_time + 1 < last_pkt_rcvd /* Latest swap occurred at least one second ago */) {
+      if(protos->dns.last_query_shadow) free(protos->dns.last_query_shadow);
+      protosRW()->dns.last_query_shadow = protos->dns.last_query;
+      protosRW()->dns.last_query = v;
+      protosRW()->dns.last_query_update_time = last_pkt_rcvd;
 
       return true; /* Swap successful */
     }
@@ -4499,8 +4789,8 @@ void Flow::updateDNS(ParsedFlow *zflow) {
 void Flow::updateTLS(ParsedFlow *zflow) {
   if(zflow->tls_server_name) {
     if(isTLS()) {
-      if(!protos.tls.client_requested_server_name)
-	protos.tls.client_requested_server_name = zflow->tls_server_name;
+      if(!protos->tls.client_requested_server_name)
+	protosRW()->tls.client_requested_server_name = zflow->tls_server_name;
       else
       	/* Already set, can be freed */
       	free(zflow->tls_server_name);
@@ -4596,8 +4886,8 @@ void Flow::updateSuspiciousDGADomain() {
 /* *************************************** */
 
 void Flow::setHTTPMethod(ndpi_http_method m) {
-  if(protos.http.last_method == NDPI_HTTP_METHOD_UNKNOWN)
-    protos.http.last_method = m;
+  if(protos->http.last_method == NDPI_HTTP_METHOD_UNKNOWN)
+    protosRW()->http.last_method = m;
 }
 
 /* *************************************** */
@@ -4663,15 +4953,15 @@ void Flow::dissectHTTP(bool src2dst_direction, char *payload, u_int16_t payload_
 	      }
 	    }
 
-	    if(!protos.http.last_url
-	       && (protos.http.last_url = (char*)malloc(host_server_name_len + l + 1)) != NULL) {
-	      protos.http.last_url[0] = '\0';
+	    if(!protos->http.last_url
+	       && (protosRW()->http.last_url = (char*)malloc(host_server_name_len + l + 1)) != NULL) {
+	      protosRW()->http.last_url[0] = '\0';
 
 	      if(host_server_name_len > 0) {
-		strncat(protos.http.last_url, host_server_name, host_server_name_len);
+		strncat(protosRW()->http.last_url, host_server_name, host_server_name_len);
 	      }
 
-	      strncat(protos.http.last_url, payload, l);
+	      strncat(protosRW()->http.last_url, payload, l);
 	    }
 	  }
 
@@ -4750,7 +5040,7 @@ void Flow::dissectHTTP(bool src2dst_direction, char *payload, u_int16_t payload_
 
 	    strncpy(tmp, payload, l);
 	    tmp[l] = 0;
-	    protos.http.last_return_code = atoi(tmp);
+	    protosRW()->http.last_return_code = atoi(tmp);
 	  }
 	}
       }
@@ -4898,7 +5188,7 @@ void Flow::dissectMDNS(u_int8_t *payload, u_int16_t payload_len) {
 	  c[0] = '\0';
       }
 
-      if(!protos.mdns.name) protos.mdns.name = strdup(name);
+      if(!protos->mdns.name) protosRW()->mdns.name = strdup(name);
 
       if((rsp_type == 0x10 /* TXT */) && (data_len > 0)) {
 	char *txt = (char*)&payload[i+sizeof(rsp)], txt_buf[256];
@@ -4936,10 +5226,10 @@ void Flow::dissectMDNS(u_int8_t *payload, u_int16_t payload_len) {
 	      }
 
 	      if(strncmp(txt_buf, "nm=", 3) == 0)
-		if(!protos.mdns.name_txt) protos.mdns.name_txt = strdup(&txt_buf[3]);
+		if(!protos->mdns.name_txt) protosRW()->mdns.name_txt = strdup(&txt_buf[3]);
 
 	      if(strncmp(txt_buf, "ssid=", 5) == 0) {
-		if(!protos.mdns.ssid) protos.mdns.ssid = strdup(&txt_buf[5]);
+		if(!protos->mdns.ssid) protosRW()->mdns.ssid = strdup(&txt_buf[5]);
 
 		if(cli_host && cli_host->getMac())
 		  cli_host->getMac()->inlineSetSSID(&txt_buf[5]);
@@ -4987,7 +5277,7 @@ void Flow::dissectSSDP(bool src2dst_direction, char *payload, u_int16_t payload_
 
 	url[i] = '\0';
 	// ntop->getTrace()->traceEvent(TRACE_NORMAL, "[SSDP URL:] %s", url);
-	if(!protos.ssdp.location) protos.ssdp.location = strdup(url);
+	if(!protos->ssdp.location) protosRW()->ssdp.location = strdup(url);
 	break;
       }
     }
@@ -5000,7 +5290,7 @@ void Flow::dissectNetBIOS(u_int8_t *payload, u_int16_t payload_len) {
   char name[64];
 
   /* Already dissected ? */
-  if(protos.netbios.name)
+  if(protos->netbios.name)
     return;
 
   if(((payload[2] & 0x80) /* NetBIOS Response */ || ((payload[2] & 0x78) == 0x28 /* NetBIOS Registration */))
@@ -5033,7 +5323,7 @@ void Flow::dissectNetBIOS(u_int8_t *payload, u_int16_t payload_len) {
 #endif
 
     if(name[0])
-      protos.netbios.name = strdup(name);
+      protosRW()->netbios.name = strdup(name);
   }
 }
 
@@ -5289,8 +5579,8 @@ void Flow::setParsedeBPFInfo(const ParsedeBPF * const _ebpf, bool swap_direction
 /* ***************************************************** */
 
 void Flow::updateCliJA3() {
-  if(cli_host && isTLS() && protos.tls.ja3.client_hash) {
-    cli_host->getJA3Fingerprint()->update(protos.tls.ja3.client_hash,
+  if(cli_host && isTLS() && protos->tls.ja3.client_hash) {
+    cli_host->getJA3Fingerprint()->update(protos->tls.ja3.client_hash,
 					  ebpf ? ebpf->src_process_info.process_name : NULL,
 					  has_malicious_cli_signature);
   }
@@ -5299,8 +5589,8 @@ void Flow::updateCliJA3() {
 /* ***************************************************** */
 
 void Flow::updateSrvJA3() {
-  if(srv_host && isTLS() && protos.tls.ja3.server_hash) {
-    srv_host->getJA3Fingerprint()->update(protos.tls.ja3.server_hash,
+  if(srv_host && isTLS() && protos->tls.ja3.server_hash) {
+    srv_host->getJA3Fingerprint()->update(protos->tls.ja3.server_hash,
 					  ebpf ? ebpf->dst_process_info.process_name : NULL, false);
   }
 }
@@ -5312,7 +5602,7 @@ void Flow::updateHASSH(bool as_client) {
     return;
 
   Host *h = as_client ? get_cli_host() : get_srv_host();
-  const char *hassh = as_client ? protos.ssh.hassh.client_hash : protos.ssh.hassh.server_hash;
+  const char *hassh = as_client ? protos->ssh.hassh.client_hash : protos->ssh.hassh.server_hash;
   ProcessInfo *pinfo = NULL;
   Fingerprint *fp;
 
@@ -5327,11 +5617,12 @@ void Flow::updateHASSH(bool as_client) {
 
 void Flow::fillZmqFlowCategory(const ParsedFlow *zflow, ndpi_protocol *res) const {
   struct ndpi_detection_module_struct *ndpi_struct = iface->get_ndpi_struct();
+  CategoryDB *db = ntop->getCategoryDB();
   const char *dst_name = NULL;
   const IpAddress *cli_ip = get_cli_ip_addr(), *srv_ip = get_srv_ip_addr();
 
-  if(cli_ip && srv_ip && cli_ip->isIPv4()) {
-    if(ndpi_fill_ip_protocol_category(ndpi_struct, cli_ip->get_ipv4(), srv_ip->get_ipv4(), res))
+  if(db && cli_ip && srv_ip && cli_ip->isIPv4()) {
+    if(db->fillIPCategory(cli_ip->get_ipv4(), srv_ip->get_ipv4(), res))
       return;
   }
 
@@ -5353,7 +5644,6 @@ void Flow::fillZmqFlowCategory(const ParsedFlow *zflow, ndpi_protocol *res) cons
   if(dst_name) {
     int rc;
     ndpi_protocol_match_result tmp;
-    ndpi_protocol_category_t c;
 
     /* Match for custom protocols (protos.txt) */
     if((rc = ndpi_match_string_subprotocol(ndpi_struct, (char*)dst_name, strlen(dst_name), &tmp)) != 0) {
@@ -5369,8 +5659,8 @@ void Flow::fillZmqFlowCategory(const ParsedFlow *zflow, ndpi_protocol *res) cons
     }
 
     /* Match for custom categories */
-    if(ndpi_match_custom_category(ndpi_struct, (char*)dst_name, strlen(dst_name), &c) == 0)
-      res->category = c;
+    if(db)
+      db->fillHostCategory(dst_name, res);
   }
 }
 
@@ -5769,45 +6059,45 @@ void Flow::lua_get_unicast_info(lua_State* vm) const {
 
 void Flow::lua_get_tls_info(lua_State *vm) const {
   if(isTLS()) {
-    lua_push_int32_table_entry(vm, "protos.tls_version", protos.tls.tls_version);
+    lua_push_int32_table_entry(vm, "protos.tls_version", protos->tls.tls_version);
 
-    if(protos.tls.server_names)
-      lua_push_str_table_entry(vm, "protos.tls.server_names", protos.tls.server_names);
+    if(protos->tls.server_names)
+      lua_push_str_table_entry(vm, "protos.tls.server_names", protos->tls.server_names);
 
-    if(protos.tls.client_alpn)
-      lua_push_str_table_entry(vm, "protos.tls.client_alpn", protos.tls.client_alpn);
+    if(protos->tls.client_alpn)
+      lua_push_str_table_entry(vm, "protos.tls.client_alpn", protos->tls.client_alpn);
 
-    if(protos.tls.client_tls_supported_versions)
-      lua_push_str_table_entry(vm, "protos.tls.client_tls_supported_versions", protos.tls.client_tls_supported_versions);
+    if(protos->tls.client_tls_supported_versions)
+      lua_push_str_table_entry(vm, "protos.tls.client_tls_supported_versions", protos->tls.client_tls_supported_versions);
 
-    if(protos.tls.issuerDN)
-      lua_push_str_table_entry(vm, "protos.tls.issuerDN", protos.tls.issuerDN);
+    if(protos->tls.issuerDN)
+      lua_push_str_table_entry(vm, "protos.tls.issuerDN", protos->tls.issuerDN);
 
-    if(protos.tls.subjectDN)
-      lua_push_str_table_entry(vm, "protos.tls.subjectDN", protos.tls.subjectDN);
+    if(protos->tls.subjectDN)
+      lua_push_str_table_entry(vm, "protos.tls.subjectDN", protos->tls.subjectDN);
 
-    if(protos.tls.client_requested_server_name)
+    if(protos->tls.client_requested_server_name)
       lua_push_str_table_entry(vm, "protos.tls.client_requested_server_name",
-			       protos.tls.client_requested_server_name);
+			       protos->tls.client_requested_server_name);
 
-    if(protos.tls.notBefore && protos.tls.notAfter) {
-      lua_push_uint32_table_entry(vm, "protos.tls.notBefore", protos.tls.notBefore);
-      lua_push_uint32_table_entry(vm, "protos.tls.notAfter", protos.tls.notAfter);
+    if(protos->tls.notBefore && protos->tls.notAfter) {
+      lua_push_uint32_table_entry(vm, "protos.tls.notBefore", protos->tls.notBefore);
+      lua_push_uint32_table_entry(vm, "protos.tls.notAfter", protos->tls.notAfter);
     }
 
-    if(protos.tls.ja3.client_hash) {
-      lua_push_str_table_entry(vm, "protos.tls.ja3.client_hash", protos.tls.ja3.client_hash);
+    if(protos->tls.ja3.client_hash) {
+      lua_push_str_table_entry(vm, "protos.tls.ja3.client_hash", protos->tls.ja3.client_hash);
 
       if(has_malicious_cli_signature)
 	lua_push_bool_table_entry(vm, "protos.tls.ja3.client_malicious", true);
     }
 
-    if(protos.tls.ja3.server_hash) {
-      lua_push_str_table_entry(vm, "protos.tls.ja3.server_hash", protos.tls.ja3.server_hash);
+    if(protos->tls.ja3.server_hash) {
+      lua_push_str_table_entry(vm, "protos.tls.ja3.server_hash", protos->tls.ja3.server_hash);
       lua_push_str_table_entry(vm, "protos.tls.ja3.server_unsafe_cipher",
-			       cipher_weakness2str(protos.tls.ja3.server_unsafe_cipher));
+			       cipher_weakness2str(protos->tls.ja3.server_unsafe_cipher));
       lua_push_int32_table_entry(vm, "protos.tls.ja3.server_cipher",
-				 protos.tls.ja3.server_cipher);
+				 protos->tls.ja3.server_cipher);
 
       if(has_malicious_srv_signature)
 	lua_push_bool_table_entry(vm, "protos.tls.ja3.server_malicious", true);
@@ -5819,45 +6109,45 @@ void Flow::lua_get_tls_info(lua_State *vm) const {
 
 void Flow::getTLSInfo(ndpi_serializer *serializer) const {
   if(isTLS()) {
-    ndpi_serialize_string_int32(serializer, "tls_version", protos.tls.tls_version);
+    ndpi_serialize_string_int32(serializer, "tls_version", protos->tls.tls_version);
 
-    if(protos.tls.server_names)
-      ndpi_serialize_string_string(serializer, "server_names", protos.tls.server_names);
+    if(protos->tls.server_names)
+      ndpi_serialize_string_string(serializer, "server_names", protos->tls.server_names);
 
-    if(protos.tls.client_alpn)
-      ndpi_serialize_string_string(serializer, "client_alpn", protos.tls.client_alpn);
+    if(protos->tls.client_alpn)
+      ndpi_serialize_string_string(serializer, "client_alpn", protos->tls.client_alpn);
 
-    if(protos.tls.client_tls_supported_versions)
-      ndpi_serialize_string_string(serializer, "client_tls_supported_versions", protos.tls.client_tls_supported_versions);
+    if(protos->tls.client_tls_supported_versions)
+      ndpi_serialize_string_string(serializer, "client_tls_supported_versions", protos->tls.client_tls_supported_versions);
 
-    if(protos.tls.issuerDN)
-      ndpi_serialize_string_string(serializer, "issuerDN", protos.tls.issuerDN);
+    if(protos->tls.issuerDN)
+      ndpi_serialize_string_string(serializer, "issuerDN", protos->tls.issuerDN);
 
-    if(protos.tls.subjectDN)
-      ndpi_serialize_string_string(serializer, "subjectDN", protos.tls.subjectDN);
+    if(protos->tls.subjectDN)
+      ndpi_serialize_string_string(serializer, "subjectDN", protos->tls.subjectDN);
 
-    if(protos.tls.client_requested_server_name)
+    if(protos->tls.client_requested_server_name)
       ndpi_serialize_string_string(serializer, "client_requested_server_name",
-			           protos.tls.client_requested_server_name);
+			           protos->tls.client_requested_server_name);
 
-    if(protos.tls.notBefore && protos.tls.notAfter) {
-      ndpi_serialize_string_int32(serializer, "notBefore", protos.tls.notBefore);
-      ndpi_serialize_string_int32(serializer, "notAfter", protos.tls.notAfter);
+    if(protos->tls.notBefore && protos->tls.notAfter) {
+      ndpi_serialize_string_int32(serializer, "notBefore", protos->tls.notBefore);
+      ndpi_serialize_string_int32(serializer, "notAfter", protos->tls.notAfter);
     }
 
-    if(protos.tls.ja3.client_hash) {
-      ndpi_serialize_string_string(serializer, "ja3.client_hash", protos.tls.ja3.client_hash);
+    if(protos->tls.ja3.client_hash) {
+      ndpi_serialize_string_string(serializer, "ja3.client_hash", protos->tls.ja3.client_hash);
 
       if(has_malicious_cli_signature)
 	ndpi_serialize_string_boolean(serializer, "ja3.client_malicious", true);
     }
 
-    if(protos.tls.ja3.server_hash) {
-      ndpi_serialize_string_string(serializer, "ja3.server_hash", protos.tls.ja3.server_hash);
+    if(protos->tls.ja3.server_hash) {
+      ndpi_serialize_string_string(serializer, "ja3.server_hash", protos->tls.ja3.server_hash);
       ndpi_serialize_string_string(serializer, "ja3.server_unsafe_cipher",
-			           cipher_weakness2str(protos.tls.ja3.server_unsafe_cipher));
+			           cipher_weakness2str(protos->tls.ja3.server_unsafe_cipher));
       ndpi_serialize_string_int32(serializer, "ja3.server_cipher",
-				  protos.tls.ja3.server_cipher);
+				  protos->tls.ja3.server_cipher);
 
       if(has_malicious_srv_signature)
 	ndpi_serialize_string_boolean(serializer, "ja3.server_malicious", true);
@@ -5869,11 +6159,11 @@ void Flow::getTLSInfo(ndpi_serializer *serializer) const {
 
 void Flow::lua_get_ssh_info(lua_State *vm) const {
   if(isSSH()) {
-    if(protos.ssh.client_signature) lua_push_str_table_entry(vm, "protos.ssh.client_signature", protos.ssh.client_signature);
-    if(protos.ssh.server_signature) lua_push_str_table_entry(vm, "protos.ssh.server_signature", protos.ssh.server_signature);
+    if(protos->ssh.client_signature) lua_push_str_table_entry(vm, "protos.ssh.client_signature", protos->ssh.client_signature);
+    if(protos->ssh.server_signature) lua_push_str_table_entry(vm, "protos.ssh.server_signature", protos->ssh.server_signature);
 
-    if(protos.ssh.hassh.client_hash) lua_push_str_table_entry(vm, "protos.ssh.hassh.client_hash", protos.ssh.hassh.client_hash);
-    if(protos.ssh.hassh.server_hash) lua_push_str_table_entry(vm, "protos.ssh.hassh.server_hash", protos.ssh.hassh.server_hash);
+    if(protos->ssh.hassh.client_hash) lua_push_str_table_entry(vm, "protos.ssh.hassh.client_hash", protos->ssh.hassh.client_hash);
+    if(protos->ssh.hassh.server_hash) lua_push_str_table_entry(vm, "protos.ssh.hassh.server_hash", protos->ssh.hassh.server_hash);
   }
 }
 
@@ -5881,11 +6171,11 @@ void Flow::lua_get_ssh_info(lua_State *vm) const {
 
 void Flow::getSSHInfo(ndpi_serializer *serializer) const {
   if(isSSH()) {
-    if(protos.ssh.client_signature) ndpi_serialize_string_string(serializer, "client_signature", protos.ssh.client_signature);
-    if(protos.ssh.server_signature) ndpi_serialize_string_string(serializer, "server_signature", protos.ssh.server_signature);
+    if(protos->ssh.client_signature) ndpi_serialize_string_string(serializer, "client_signature", protos->ssh.client_signature);
+    if(protos->ssh.server_signature) ndpi_serialize_string_string(serializer, "server_signature", protos->ssh.server_signature);
 
-    if(protos.ssh.hassh.client_hash) ndpi_serialize_string_string(serializer, "hassh.client_hash", protos.ssh.hassh.client_hash);
-    if(protos.ssh.hassh.server_hash) ndpi_serialize_string_string(serializer, "hassh.server_hash", protos.ssh.hassh.server_hash);
+    if(protos->ssh.hassh.client_hash) ndpi_serialize_string_string(serializer, "hassh.client_hash", protos->ssh.hassh.client_hash);
+    if(protos->ssh.hassh.server_hash) ndpi_serialize_string_string(serializer, "hassh.server_hash", protos->ssh.hassh.server_hash);
   }
 }
 
@@ -5893,12 +6183,12 @@ void Flow::getSSHInfo(ndpi_serializer *serializer) const {
 
 void Flow::lua_get_http_info(lua_State *vm) const {
   if(isHTTP()) {
-    if(protos.http.last_url) {
-      lua_push_str_table_entry(vm, "protos.http.last_method", ndpi_http_method2str(protos.http.last_method));
-      lua_push_uint64_table_entry(vm, "protos.http.last_return_code", protos.http.last_return_code);
-      lua_push_str_table_entry(vm, "protos.http.last_url", protos.http.last_url);
-      if(protos.http.last_user_agent)
-	lua_push_str_table_entry(vm, "protos.http.last_user_agent", protos.http.last_user_agent);
+    if(protos->http.last_url) {
+      lua_push_str_table_entry(vm, "protos.http.last_method", ndpi_http_method2str(protos->http.last_method));
+      lua_push_uint64_table_entry(vm, "protos.http.last_return_code", protos->http.last_return_code);
+      lua_push_str_table_entry(vm, "protos.http.last_url", protos->http.last_url);
+      if(protos->http.last_user_agent)
+	lua_push_str_table_entry(vm, "protos.http.last_user_agent", protos->http.last_user_agent);
     }
 
     if(host_server_name)
@@ -5910,11 +6200,11 @@ void Flow::lua_get_http_info(lua_State *vm) const {
 
 void Flow::getHTTPInfo(ndpi_serializer *serializer) const {
   if(isHTTP()) {
-    if(protos.http.last_url) {
-      ndpi_serialize_string_string(serializer, "last_method", ndpi_http_method2str(protos.http.last_method));
-      ndpi_serialize_string_uint64(serializer, "last_return_code", protos.http.last_return_code);
-      ndpi_serialize_string_string(serializer, "last_url", protos.http.last_url);
-      ndpi_serialize_string_string(serializer, "last_user_agent", protos.http.last_user_agent);
+    if(protos->http.last_url) {
+      ndpi_serialize_string_string(serializer, "last_method", ndpi_http_method2str(protos->http.last_method));
+      ndpi_serialize_string_uint64(serializer, "last_return_code", protos->http.last_return_code);
+      ndpi_serialize_string_string(serializer, "last_url", protos->http.last_url);
+      ndpi_serialize_string_string(serializer, "last_user_agent", protos->http.last_user_agent);
     }
 
     if(host_server_name)
@@ -5926,10 +6216,10 @@ void Flow::getHTTPInfo(ndpi_serializer *serializer) const {
 
 void Flow::lua_get_dns_info(lua_State *vm) const {
   if(isDNS()) {
-    if(protos.dns.last_query) {
-      lua_push_uint64_table_entry(vm, "protos.dns.last_query_type", protos.dns.last_query_type);
-      lua_push_uint64_table_entry(vm, "protos.dns.last_return_code", protos.dns.last_return_code);
-      lua_push_str_table_entry(vm, "protos.dns.last_query", protos.dns.last_query);
+    if(protos->dns.last_query) {
+      lua_push_uint64_table_entry(vm, "protos.dns.last_query_type", protos->dns.last_query_type);
+      lua_push_uint64_table_entry(vm, "protos.dns.last_return_code", protos->dns.last_return_code);
+      lua_push_str_table_entry(vm, "protos.dns.last_query", protos->dns.last_query);
 
       if(hasInvalidDNSQueryChars())
         lua_push_bool_table_entry(vm, "protos.dns.invalid_chars_in_query", true);
@@ -5941,10 +6231,10 @@ void Flow::lua_get_dns_info(lua_State *vm) const {
 
 void Flow::getDNSInfo(ndpi_serializer *serializer) const {
   if(isDNS()) {
-    if(protos.dns.last_query) {
-      ndpi_serialize_string_int64(serializer, "last_query_type", protos.dns.last_query_type);
-      ndpi_serialize_string_int64(serializer, "last_return_code", protos.dns.last_return_code);
-      ndpi_serialize_string_string(serializer, "last_query", protos.dns.last_query);
+    if(protos->dns.last_query) {
+      ndpi_serialize_string_int64(serializer, "last_query_type", protos->dns.last_query_type);
+      ndpi_serialize_string_int64(serializer, "last_return_code", protos->dns.last_return_code);
+      ndpi_serialize_string_string(serializer, "last_query", protos->dns.last_query);
 
       if(hasInvalidDNSQueryChars())
         ndpi_serialize_string_boolean(serializer, "invalid_chars_in_query", true);
@@ -5956,8 +6246,8 @@ void Flow::getDNSInfo(ndpi_serializer *serializer) const {
 
 void Flow::getICMPInfo(ndpi_serializer *serializer) const {
   if(isICMP()) {
-    ndpi_serialize_string_int32(serializer, "type", isBidirectional() ? protos.icmp.srv2cli.icmp_type : protos.icmp.cli2srv.icmp_type);
-    ndpi_serialize_string_int32(serializer, "code", isBidirectional() ? protos.icmp.srv2cli.icmp_code : protos.icmp.cli2srv.icmp_code);
+    ndpi_serialize_string_int32(serializer, "type", isBidirectional() ? protos->icmp.srv2cli.icmp_type : protos->icmp.cli2srv.icmp_type);
+    ndpi_serialize_string_int32(serializer, "code", isBidirectional() ? protos->icmp.srv2cli.icmp_code : protos->icmp.cli2srv.icmp_code);
   }
 }
 
@@ -5965,10 +6255,10 @@ void Flow::getICMPInfo(ndpi_serializer *serializer) const {
 
 void Flow::getMDNSInfo(ndpi_serializer *serializer) const {
   if(isMDNS()) {
-    ndpi_serialize_string_string(serializer, "answer", protos.mdns.answer);
-    ndpi_serialize_string_string(serializer, "name", protos.mdns.name);
-    ndpi_serialize_string_string(serializer, "name_txt", protos.mdns.name_txt);
-    ndpi_serialize_string_string(serializer, "ssid", protos.mdns.ssid);
+    ndpi_serialize_string_string(serializer, "answer", protos->mdns.answer);
+    ndpi_serialize_string_string(serializer, "name", protos->mdns.name);
+    ndpi_serialize_string_string(serializer, "name_txt", protos->mdns.name_txt);
+    ndpi_serialize_string_string(serializer, "ssid", protos->mdns.ssid);
   }
 }
 
@@ -5976,7 +6266,7 @@ void Flow::getMDNSInfo(ndpi_serializer *serializer) const {
 
 void Flow::getNetBiosInfo(ndpi_serializer *serializer) const {
   if(isNetBIOS()) {
-    ndpi_serialize_string_string(serializer, "name", protos.netbios.name);
+    ndpi_serialize_string_string(serializer, "name", protos->netbios.name);
   }
 }
 
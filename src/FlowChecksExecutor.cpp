@@ -44,6 +44,7 @@ void FlowChecksExecutor::loadFlowChecks(FlowChecksLoader *fcl) {
   periodic_update   = fcl->getPeriodicUpdateChecks(iface);
   flow_end          = fcl->getFlowEndChecks(iface);
   flow_begin        = fcl->getFlowBeginChecks(iface);
+  needs_packet_data = fcl->checksNeedPacketData();
 }
 
 /* **************************************************** */
@@ -53,9 +54,7 @@ FlowAlert *FlowChecksExecutor::execChecks(Flow *f, FlowChecks c) {
   FlowCheck *predominant_check = NULL;
   std::list<FlowCheck*> *checks = NULL;
   FlowAlert *alert = NULL;
-#ifdef CHECKS_PROFILING
-  u_int64_t t1, t2;
-#endif
+  bool profiling = ntop->getPrefs()->areChecksProfilingEnabled();
 
   switch (c) {
     case flow_check_protocol_detected:
@@ -76,10 +75,12 @@ FlowAlert *FlowChecksExecutor::execChecks(Flow *f, FlowChecks c) {
 
   for(list<FlowCheck*>::iterator it = checks->begin(); it != checks->end(); ++it) {
     FlowCheck *fc = (*it);
+    bool timed = profiling || fc->hasCpuBudget();
+    ticks t1 = 0;
 
-#ifdef CHECKS_PROFILING
-    t1 = Utils::getTimeNsec();
-#endif
+    if(!fc->shouldRun()) continue; /* Over its CPU budget */
+
+    if(timed) t1 = Utils::getticks();
 
     switch (c) {
       case flow_check_protocol_detected:
@@ -98,12 +99,8 @@ FlowAlert *FlowChecksExecutor::execChecks(Flow *f, FlowChecks c) {
 	break;
     }
 
-#ifdef CHECKS_PROFILING
-    t2 = Utils::getTimeNsec();
+    if(timed) fc->incStats(Utils::getticks() - t1);
 
-    fc->incStats(t2 - t1);
-#endif
-    
     /* Check if the check triggered a predominant alert */
     if (f->getPredominantAlert().id != predominant_alert.id) {
       predominant_alert = f->getPredominantAlert();
@@ -240,6 +240,7 @@ void FlowChecksLoader::loadConfiguration() {
 	  }
 
 	  cb->enable();
+	  cb->setCpuBudget(getCpuBudget(json_hook_all));
 	  cb->scriptEnable(); 
 	} else {
 	  /* Script disabled */
@@ -294,6 +295,17 @@ std::list<FlowCheck*>* FlowChecksLoader::getChecks(NetworkInterface *iface, Flow
 
 /* **************************************************** */
 
+bool FlowChecksLoader::checksNeedPacketData() const {
+  for(std::map<std::string, FlowCheck*>::const_iterator it = cb_all.begin(); it != cb_all.end(); ++it) {
+    if(it->second->isEnabled() && it->second->needsPacketData())
+      return(true);
+  }
+
+  return(false);
+}
+
+/* **************************************************** */
+
 bool FlowChecksLoader::luaCheckInfo(lua_State* vm, std::string check_name) const {
   std::map<std::string, FlowCheck*>::const_iterator it = cb_all.find(check_name);
 
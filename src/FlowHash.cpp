@@ -44,14 +44,17 @@ Flow* FlowHash::find(IpAddress *src_ip, IpAddress *dst_ip,
 		     + src_port + dst_port + vlanId + protocol) % num_hashes);
   Flow *head = (Flow*)table[hash];
   u_int16_t num_loops = 0;
+  int epoch_slot = -1;
 
   // ntop->getTrace()->traceEvent(TRACE_NORMAL, "%u:%u / %u:%u [icmp: %u][key: %u][icmp info key: %u][head: 0x%x]", src_ip->key(), src_port, dst_ip->key(), dst_port, icmp_info ? 1 : 0, hash, icmp_info ? icmp_info->key() : 0, head);
 
   if(!head)
     return(NULL);
 
-  if(!is_inline_call)
-    locks[hash]->rdlock(__FILE__, __LINE__);
+  if(!is_inline_call) {
+    epoch_slot = enterReadSection(hash);
+    head = (Flow*)table[hash]; /* Read again now that the bucket is protected */
+  }
 
   while(head) {
     if(!head->idle()
@@ -74,7 +77,7 @@ Flow* FlowHash::find(IpAddress *src_ip, IpAddress *dst_ip,
   }
 
   if(!is_inline_call)
-    locks[hash]->unlock(__FILE__, __LINE__);
+    exitReadSection(hash, epoch_slot);
 
   return(head);
 }
@@ -83,11 +86,13 @@ Flow* FlowHash::find(IpAddress *src_ip, IpAddress *dst_ip,
 
 Flow* FlowHash::findByKeyAndHashId(u_int32_t key, u_int hash_id) {
   u_int32_t hash = key % num_hashes;
-  Flow *head = (Flow*)table[hash];
+  Flow *head;
+  int epoch_slot;
 
-  if(head == NULL) return(NULL);
+  if(table[hash] == NULL) return(NULL);
 
-  locks[hash]->rdlock(__FILE__, __LINE__);
+  epoch_slot = enterReadSection(hash);
+  head = (Flow*)table[hash];
 
   while(head) {
     if(!head->idle() && head->get_hash_entry_id() == hash_id)
@@ -96,7 +101,7 @@ Flow* FlowHash::findByKeyAndHashId(u_int32_t key, u_int hash_id) {
       head = (Flow*)head->next();
   }
 
-  locks[hash]->unlock(__FILE__, __LINE__);
+  exitReadSection(hash, epoch_slot);
 
   return((Flow*)head);
 }
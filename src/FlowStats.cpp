@@ -53,31 +53,10 @@ void FlowStats::incStats(Bitmap128 alert_bitmap, u_int8_t l4_protocol, AlertLeve
 
   if(flow) {
     u_int16_t cli_pool, srv_pool;
-    bool cli_pool_found = false, srv_pool_found = false;
-
-    if(flow->get_cli_host()) {
-      cli_pool = flow->get_cli_host()->get_host_pool();
-      cli_pool_found = true;
-    } else {
-      /* Host null, let's try using IpAddress */
-      IpAddress *ip = (IpAddress *) flow->get_cli_ip_addr();
-      ndpi_patricia_node_t *cli_target_node = NULL;
-
-      if(flow->get_cli_ip_addr())
-	cli_pool_found = flow->getInterface()->getHostPools()->findIpPool(ip, flow->get_vlan_id(), &cli_pool, &cli_target_node);
-    }
+    bool cli_pool_found, srv_pool_found;
 
-    if(flow->get_srv_host()) {
-      srv_pool = flow->get_srv_host()->get_host_pool();
-      srv_pool_found = true;
-    } else {      
-      /* Host null, let's try using IpAddress */
-      ndpi_patricia_node_t *srv_target_node = NULL;
-      IpAddress *ip = (IpAddress *) flow->get_srv_ip_addr();
-      
-      if(flow->get_srv_ip_addr())
-	srv_pool_found = flow->getInterface()->getHostPools()->findIpPool(ip, flow->get_vlan_id(), &srv_pool, &srv_target_node);
-    }
+    /* Hosts are null on flow-only and view interfaces: the pools of their IpAddress are cached on the flow */
+    flow->getPeerPools(&cli_pool, &cli_pool_found, &srv_pool, &srv_pool_found);
 
     if(srv_pool_found && cli_pool_found) {
       /* Both pools found */
@@ -39,7 +39,7 @@ GenericHash::GenericHash(NetworkInterface *_iface, u_int _num_hashes,
   memset(&entry_state_transition_counters, 0, sizeof(entry_state_transition_counters));
 
   iface = _iface;
-  idle_entries = idle_entries_shadow = NULL;
+  idle_entries_shadow = NULL;
 
   table = new (std::nothrow) GenericHashEntry*[num_hashes];
   for(u_int i = 0; i < num_hashes; i++)
@@ -68,7 +68,17 @@ GenericHash::~GenericHash() {
 /* ************************************ */
 
 void GenericHash::cleanup() {
-  vector<GenericHashEntry*> **ghvs[] = { &idle_entries, &idle_entries_shadow, &idle_entries_in_use };
+  vector<GenericHashEntry*> **ghvs[] = { &idle_entries_shadow, &idle_entries_in_use };
+
+  while(!idle_entries.empty()) {
+    vector<GenericHashEntry*> *v = idle_entries.front().second;
+
+    for(vector<GenericHashEntry*>::const_iterator it = v->begin(); it != v->end(); ++it)
+      delete *it;
+
+    delete v;
+    idle_entries.pop();
+  }
 
   for(u_int i = 0; i < sizeof(ghvs) / sizeof(ghvs[0]); i++) {
     if(*ghvs[i]) {
@@ -127,15 +137,30 @@ bool GenericHash::add(GenericHashEntry *h, bool do_lock) {
 /* ************************************ */
 
 u_int64_t GenericHash::purgeQueuedIdleEntries() {
-  vector<GenericHashEntry*> *cur_idle = NULL;
+  vector<GenericHashEntry*> *cur_idle;
   u_int64_t num_purged = entry_state_transition_counters.num_purged;
 
-  if(idle_entries) {
-    cur_idle = idle_entries;
-    idle_entries = NULL;
-  }
+  /*
+    Entries are taken only when readers that could have seen them in the
+    hash table (i.e., readers in an epoch older than the retire epoch) are gone.
+    Otherwise they're left there and retried at the next run. Epochs grow
+    with the queue, so the first vector not reclaimable stops the loop.
+  */
+  while(true) {
+    cur_idle = NULL;
+
+    idle_entries_lock.lock(__FILE__, __LINE__);
+
+    if((!idle_entries.empty()) && epochs.canReclaim(idle_entries.front().first)) {
+      cur_idle = idle_entries.front().second;
+      idle_entries.pop();
+    }
+
+    idle_entries_lock.unlock(__FILE__, __LINE__);
+
+    if(!cur_idle)
+      break;
 
-  if(cur_idle) {
     if(!cur_idle->empty()) {      
       for(vector<GenericHashEntry*>::const_iterator it = cur_idle->begin(); it != cur_idle->end(); ++it) {
 	/* In case of flow dump the uses number might be increased (0 -> 1) */
@@ -196,23 +221,43 @@ bool GenericHash::walk(u_int32_t *begin_slot,
 		       bool walk_all,
 		       bool (*walker)(GenericHashEntry *h, void *user_data, bool *entryMatched),
 		       void *user_data) {
-  bool found = false;
+  bool found = false, done = false;
   u_int16_t tot_matched = 0;
+  u_int32_t num_epoch_entries = 0;
+  int epoch_slot = epochs.enter();
 
   for(u_int hash_id = *begin_slot; hash_id < num_hashes; hash_id++) {
     if(table[hash_id] != NULL) {
       GenericHashEntry *head;
 
+      /*
+	A slow walker (e.g., pushing every flow to Lua) would keep all the entries
+	retired meanwhile from being freed, and they count against hasEmptyRoom().
+	Between buckets no entry is referenced, so the epoch can be left and
+	entered again, as the bucket read locks were released before.
+      */
+      if(num_epoch_entries >= MAX_NUM_EPOCH_ENTRIES) {
+	epochs.exit(epoch_slot);
+	epoch_slot = epochs.enter();
+	num_epoch_entries = 0;
+      }
+
 #ifdef WALK_DEBUG
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "[walk] Locking %d [%p]", hash_id, locks[hash_id]);
+      ntop->getTrace()->traceEvent(TRACE_NORMAL, "[walk] Reading %d [epoch slot: %d]", hash_id, epoch_slot);
 #endif
 
-      locks[hash_id]->rdlock(__FILE__, __LINE__);
+      /*
+	No lock is needed when inside an epoch: entries unlinked by purgeIdle() keep
+	their next pointer and are not freed until this walk has left the epoch.
+      */
+      if(epoch_slot < 0) locks[hash_id]->rdlock(__FILE__, __LINE__);
       head = table[hash_id];
 
       while(head) {
 	GenericHashEntry *next = head->next();
 
+	num_epoch_entries++;
+
         /* FIXX get_state() does not always match idle() as the latter can be
          * overriden (e.g. Flow), leading to walking entries that are actually
          * idle even with walk_idle = false, what about using idle() here? */
@@ -232,20 +277,19 @@ bool GenericHash::walk(u_int32_t *begin_slot,
 	head = next;
       } /* while */
 
-      locks[hash_id]->unlock(__FILE__, __LINE__);
-      // ntop->getTrace()->traceEvent(TRACE_NORMAL, "[walk] Unlocked %d", hash_id);
+      if(epoch_slot < 0) locks[hash_id]->unlock(__FILE__, __LINE__);
 
       if((tot_matched >= MIN_NUM_HASH_WALK_ELEMS) /* At least a few entries have been returned */
 	 && (!walk_all)) {
 	u_int32_t next_slot  = (hash_id == (num_hashes-1)) ? 0 /* start over */ : (hash_id+1);
 
-	*begin_slot = next_slot;
+	*begin_slot = next_slot, done = true;
 #ifdef WALK_DEBUG
 	ntop->getTrace()->traceEvent(TRACE_NORMAL, "[walk] Over [nextSlot: %u][hash_id: %u][tot_matched: %u]",
 				     next_slot, hash_id, tot_matched);
 #endif
 
-	return(found);
+	break;
       }
 
       if(found)
@@ -253,6 +297,11 @@ bool GenericHash::walk(u_int32_t *begin_slot,
     }
   }
 
+  epochs.exit(epoch_slot);
+
+  if(done)
+    return(found);
+
   if(!found)
     *begin_slot = 0 /* start over */;
 
@@ -265,6 +314,26 @@ bool GenericHash::walk(u_int32_t *begin_slot,
 
 /* ************************************ */
 
+int GenericHash::enterReadSection(u_int32_t hash) {
+  int epoch_slot = epochs.enter();
+
+  if(epoch_slot < 0)
+    locks[hash]->rdlock(__FILE__, __LINE__);
+
+  return(epoch_slot);
+}
+
+/* ************************************ */
+
+void GenericHash::exitReadSection(u_int32_t hash, int epoch_slot) {
+  if(epoch_slot < 0)
+    locks[hash]->unlock(__FILE__, __LINE__);
+  else
+    epochs.exit(epoch_slot);
+}
+
+/* ************************************ */
+
 /*
   Bucket Lifecycle
 
@@ -279,8 +348,19 @@ u_int GenericHash::purgeIdle(const struct timeval * tv, bool force_idle, bool fu
   size_t idle_entries_shadow_old_size;
   vector<GenericHashEntry*>::const_iterator it;
 
-  if(!idle_entries) {
-    idle_entries = idle_entries_shadow;
+  if((!idle_entries_shadow) || (!idle_entries_shadow->empty())) {
+    if(idle_entries_shadow) {
+      /*
+	Entries in idle_entries_shadow have all been unlinked from the table:
+	advance the epoch so that readers entering from now on cannot reach them.
+	The epoch is set before publishing the vector to the purging thread.
+      */
+      u_int64_t retire_epoch = epochs.advance();
+
+      idle_entries_lock.lock(__FILE__, __LINE__);
+      idle_entries.push(std::make_pair(retire_epoch, idle_entries_shadow));
+      idle_entries_lock.unlock(__FILE__, __LINE__);
+    }
 
     try {
       idle_entries_shadow = new vector<GenericHashEntry*>;
@@ -445,6 +525,8 @@ void GenericHash::lua(lua_State *vm) {
   lua_newtable(vm);
 
   lua_push_uint64_table_entry(vm, "max_hash_size", (u_int64_t)max_hash_size);
+  lua_push_uint64_table_entry(vm, "epoch", epochs.getEpoch());
+  lua_push_uint64_table_entry(vm, "epoch_slots_exhausted", epochs.getNumSlotsExhausted());
 
   /* Hash Entry states */
   lua_newtable(vm);
@@ -455,7 +537,7 @@ void GenericHash::lua(lua_State *vm) {
 			       entry_state_transition_counters.num_idle_transitions,
 			       entry_state_transition_counters.num_purged,
 			       idle_entries_shadow ? idle_entries_shadow->size() : 0,
-			       idle_entries ? idle_entries->size() : 0,
+			       idle_entries.size(),
 			       idle_entries_in_use ? idle_entries_in_use->size() : 0);
 #endif
 
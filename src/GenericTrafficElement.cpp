@@ -39,6 +39,47 @@ GenericTrafficElement::GenericTrafficElement() {
 
 /* *************************************** */
 
+void GenericTrafficElement::getTrafficSnapshot(HostSnapshot *s) const {
+  struct host_snapshot_hdr *h = s->get();
+
+  h->pkts[0]  = sent.getNumPkts(),  h->pkts[1]  = rcvd.getNumPkts();
+  h->bytes[0] = sent.getNumBytes(), h->bytes[1] = rcvd.getNumBytes();
+
+  h->tcp_retr[0] = tcp_packet_stats_sent.get_retr(), h->tcp_retr[1] = tcp_packet_stats_rcvd.get_retr();
+  h->tcp_ooo[0]  = tcp_packet_stats_sent.get_ooo(),  h->tcp_ooo[1]  = tcp_packet_stats_rcvd.get_ooo();
+  h->tcp_lost[0] = tcp_packet_stats_sent.get_lost(), h->tcp_lost[1] = tcp_packet_stats_rcvd.get_lost();
+  h->tcp_keepalive[0] = tcp_packet_stats_sent.get_keepalive(), h->tcp_keepalive[1] = tcp_packet_stats_rcvd.get_keepalive();
+
+  h->dropped_flows = total_num_dropped_flows;
+
+  if(ndpiStats) ndpiStats->getSnapshot(s);
+}
+
+/* *************************************** */
+
+void GenericTrafficElement::restoreTrafficSnapshot(const HostSnapshot *s) {
+  const struct host_snapshot_hdr *h = s->get();
+
+  sent.restoreStats(h->pkts[0], h->bytes[0]), rcvd.restoreStats(h->pkts[1], h->bytes[1]);
+
+  tcp_packet_stats_sent.incRetr(h->tcp_retr[0]), tcp_packet_stats_rcvd.incRetr(h->tcp_retr[1]);
+  tcp_packet_stats_sent.incOOO(h->tcp_ooo[0]), tcp_packet_stats_rcvd.incOOO(h->tcp_ooo[1]);
+  tcp_packet_stats_sent.incLost(h->tcp_lost[0]), tcp_packet_stats_rcvd.incLost(h->tcp_lost[1]);
+  tcp_packet_stats_sent.incKeepAlive(h->tcp_keepalive[0]), tcp_packet_stats_rcvd.incKeepAlive(h->tcp_keepalive[1]);
+
+  total_num_dropped_flows += h->dropped_flows;
+
+  if(!s->getProtos()->empty()) {
+    if(!ndpiStats) ndpiStats = new (std::nothrow) nDPIStats();
+    if(ndpiStats)  ndpiStats->restoreSnapshot(s);
+  }
+
+  /* The restored counters are not traffic of the last period */
+  bytes_thpt.resetStats(), pkts_thpt.resetStats();
+}
+
+/* *************************************** */
+
 void GenericTrafficElement::resetStats() {
   /* NOTE NOTE NOTE: keep in sync with copy constructor below */
   total_num_dropped_flows = 0;
@@ -499,6 +499,37 @@ json_object* HTTPstats::getJSONObject() {
 
 /* ******************************************* */
 
+/* Rates are not saved: they are recomputed by updateStats */
+void HTTPstats::getSnapshot(struct host_snapshot_hdr *s) {
+  for(u_int8_t d = 0; d < 2; d++) {
+    s->http_query[d][0] = query[d].num_get, s->http_query[d][1] = query[d].num_post,
+      s->http_query[d][2] = query[d].num_head, s->http_query[d][3] = query[d].num_put,
+      s->http_query[d][4] = query[d].num_other;
+    s->http_response[d][0] = response[d].num_1xx, s->http_response[d][1] = response[d].num_2xx,
+      s->http_response[d][2] = response[d].num_3xx, s->http_response[d][3] = response[d].num_4xx,
+      s->http_response[d][4] = response[d].num_5xx;
+  }
+}
+
+/* ******************************************* */
+
+void HTTPstats::restoreSnapshot(const struct host_snapshot_hdr *s) {
+  for(u_int8_t d = 0; d < 2; d++) {
+    query[d].num_get += s->http_query[d][0], query[d].num_post += s->http_query[d][1],
+      query[d].num_head += s->http_query[d][2], query[d].num_put += s->http_query[d][3],
+      query[d].num_other += s->http_query[d][4];
+    response[d].num_1xx += s->http_response[d][0], response[d].num_2xx += s->http_response[d][1],
+      response[d].num_3xx += s->http_response[d][2], response[d].num_4xx += s->http_response[d][3],
+      response[d].num_5xx += s->http_response[d][4];
+  }
+
+  /* Avoid a bogus rate on the first update */
+  memcpy(&last_query_sample,    &query,    sizeof(query));
+  memcpy(&last_response_sample, &response, sizeof(response));
+}
+
+/* ******************************************* */
+
 void HTTPstats::incStats(bool as_client, const FlowHTTPStats *fts) {
   struct http_query_stats *q = as_client ? &query[AS_SENDER] : &query[AS_RECEIVER];
   struct http_response_stats *r = as_client ? &response[AS_RECEIVER] : &response[AS_SENDER];
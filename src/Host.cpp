@@ -765,7 +765,8 @@ void Host::lua_get_listening_ports(lua_State *vm) {
 
 void Host::lua(lua_State* vm, AddressTree *ptree,
 	       bool host_details, bool verbose,
-	       bool returnHost, bool asListElement) {
+	       bool returnHost, bool asListElement,
+	       u_int32_t fields) {
   char buf[64], buf_id[64], *host_id = buf_id;
   char ip_buf[64], *ipaddr = NULL;
   bool mask_host = Utils::maskHost(isLocalHost());
@@ -784,84 +785,118 @@ void Host::lua(lua_State* vm, AddressTree *ptree,
   lua_push_uint64_table_entry(vm, "ipkey", ip.key());
   lua_push_str_table_entry(vm, "tskey", get_tskey(buf_id, sizeof(buf_id)));
 
-  lua_push_str_table_entry(vm, "name", get_visual_name(buf, sizeof(buf)));
+  if(LUA_FIELD(fields, host_lua_field_name))
+    lua_push_str_table_entry(vm, "name", get_visual_name(buf, sizeof(buf)));
 
-  lua_get_min_info(vm);
-  lua_get_mac(vm);
+  if(LUA_FIELD(fields, host_lua_field_flags))
+    lua_get_min_info(vm);
 
-  lua_get_num_alerts(vm);
-  lua_get_score(vm);
+  if(LUA_FIELD(fields, host_lua_field_mac))
+    lua_get_mac(vm);
 
-  lua_get_as(vm);
-  lua_get_os(vm);
-  lua_get_host_pool(vm);
+  if(LUA_FIELD(fields, host_lua_field_alerts))
+    lua_get_num_alerts(vm);
 
-  if(stats)
-    stats->lua(vm, mask_host, Utils::bool2DetailsLevel(verbose, host_details)),
-      stats->luaHostBehaviour(vm);
+  if(LUA_FIELD(fields, host_lua_field_score))
+    lua_get_score(vm);
 
-  lua_get_num_flows(vm);
-  lua_get_num_contacts(vm);
-  lua_get_num_http_hosts(vm);
+  if(LUA_FIELD(fields, host_lua_field_as))
+    lua_get_as(vm);
 
-  lua_push_float_table_entry(vm, "bytes_ratio", ndpi_data_ratio(getNumBytesSent(), getNumBytesRcvd()));
-  lua_push_float_table_entry(vm, "pkts_ratio", ndpi_data_ratio(getNumPktsSent(), getNumPktsRcvd()));
+  if(LUA_FIELD(fields, host_lua_field_os))
+    lua_get_os(vm);
 
-  if(device_ip != 0)
-    lua_push_str_table_entry(vm, "device_ip", Utils::intoaV4(device_ip, buf, sizeof(buf)));
+  if(LUA_FIELD(fields, host_lua_field_pool))
+    lua_get_host_pool(vm);
 
-  if(more_then_one_device)
-    lua_push_bool_table_entry(vm, "more_then_one_device", more_then_one_device);
+  if(LUA_FIELD(fields, host_lua_field_traffic)) {
+    if(stats)
+      stats->lua(vm, mask_host, Utils::bool2DetailsLevel(verbose, host_details)),
+	stats->luaHostBehaviour(vm);
 
-  luaDNS(vm, verbose);
-  luaTCP(vm);
-  luaICMP(vm, get_ip()->isIPv4(), false);
+    lua_push_float_table_entry(vm, "bytes_ratio", ndpi_data_ratio(getNumBytesSent(), getNumBytesRcvd()));
+    lua_push_float_table_entry(vm, "pkts_ratio", ndpi_data_ratio(getNumPktsSent(), getNumPktsRcvd()));
+  }
 
-  if(host_details) {
-    lua_get_score_breakdown(vm);
-    lua_blacklisted_flows(vm);
+  if(LUA_FIELD(fields, host_lua_field_flows))
+    lua_get_num_flows(vm);
 
-    /*
-      This has been disabled as in case of an attack, most hosts do not have a name and we will waste
-      a lot of time doing activities that are not necessary
-    */
-    get_name(buf, sizeof(buf), false);
-    if(strlen(buf) == 0 || strcmp(buf, ipaddr) == 0) {
-      if(isBroadcastHost() || isMulticastHost()
-	 || (isIPv6()
-	     && ((strncmp(ipaddr, "ff0", 3) == 0)
-		 || (strncmp(ipaddr, "fe80", 4) == 0)))
-	 )
-	; /* Nothing to do */
-      else {
-	/* We resolve immediately the IP address by queueing on the top of address queue */
-	ntop->getRedis()->pushHostToResolve(ipaddr, false, true /* Fake to resolve it ASAP */);
+  if(LUA_FIELD(fields, host_lua_field_contacts)) {
+    lua_get_num_contacts(vm);
+    lua_get_num_http_hosts(vm);
+  }
+
+  if(LUA_FIELD(fields, host_lua_field_info)) {
+    if(device_ip != 0)
+      lua_push_str_table_entry(vm, "device_ip", Utils::intoaV4(device_ip, buf, sizeof(buf)));
+
+    if(more_then_one_device)
+      lua_push_bool_table_entry(vm, "more_then_one_device", more_then_one_device);
+  }
+
+  if(LUA_FIELD(fields, host_lua_field_protocols)) {
+    luaDNS(vm, verbose);
+    luaTCP(vm);
+    luaICMP(vm, get_ip()->isIPv4(), false);
+  }
+
+  if(host_details) {
+    if(LUA_FIELD(fields, host_lua_field_score))
+      lua_get_score_breakdown(vm);
+
+    if(LUA_FIELD(fields, host_lua_field_flows))
+      lua_blacklisted_flows(vm);
+
+    if(LUA_FIELD(fields, host_lua_field_name)) {
+      /*
+	This has been disabled as in case of an attack, most hosts do not have a name and we will waste
+	a lot of time doing activities that are not necessary
+      */
+      get_name(buf, sizeof(buf), false);
+      if(strlen(buf) == 0 || strcmp(buf, ipaddr) == 0) {
+	if(isBroadcastHost() || isMulticastHost()
+	   || (isIPv6()
+	       && ((strncmp(ipaddr, "ff0", 3) == 0)
+		   || (strncmp(ipaddr, "fe80", 4) == 0)))
+	   )
+	  ; /* Nothing to do */
+	else {
+	  /* We resolve immediately the IP address by queueing on the top of address queue */
+	  ntop->getRedis()->pushHostToResolve(ipaddr, false, true /* Fake to resolve it ASAP */);
+	}
       }
-    }
 
-    luaStrTableEntryLocked(vm, "ssdp", ssdpLocation); /* locked to protect against data-reset changes */
+      lua_get_names(vm, buf, sizeof(buf));
+    }
 
-    /* ifid is useful for example for view interfaces to detemine
-       the actual, original interface the host is associated to. */
-    lua_push_uint64_table_entry(vm, "ifid", iface->get_id());
-    if(!mask_host)
-      luaStrTableEntryLocked(vm, "info", names.mdns_info); /* locked to protect against data-reset changes */
+    if(LUA_FIELD(fields, host_lua_field_info)) {
+      luaStrTableEntryLocked(vm, "ssdp", ssdpLocation); /* locked to protect against data-reset changes */
 
-    lua_get_names(vm, buf, sizeof(buf));
+      /* ifid is useful for example for view interfaces to detemine
+	 the actual, original interface the host is associated to. */
+      lua_push_uint64_table_entry(vm, "ifid", iface->get_id());
+      if(!mask_host)
+	luaStrTableEntryLocked(vm, "info", names.mdns_info); /* locked to protect against data-reset changes */
+    }
 
-    lua_get_geoloc(vm);
+    if(LUA_FIELD(fields, host_lua_field_geoloc))
+      lua_get_geoloc(vm);
 
-    lua_get_flow_flood(vm);
-    lua_get_services(vm);
+    if(LUA_FIELD(fields, host_lua_field_services)) {
+      lua_get_flow_flood(vm);
+      lua_get_services(vm);
 
 #ifndef HAVE_NEDGE
-    lua_get_listening_ports(vm);
+      lua_get_listening_ports(vm);
 #endif
+    }
   }
 
-  lua_get_time(vm);
+  if(LUA_FIELD(fields, host_lua_field_time))
+    lua_get_time(vm);
 
-  lua_get_fingerprints(vm);
+  if(LUA_FIELD(fields, host_lua_field_fingerprints))
+    lua_get_fingerprints(vm);
 
   if(verbose) {
     if(hasAnomalies()) lua_get_anomalies(vm);
@@ -1222,6 +1257,45 @@ void Host::serialize(json_object *my_object, DetailsLevel details_level) {
 
 /* *************************************** */
 
+void Host::getSnapshot(HostSnapshot *s) {
+  struct host_snapshot_hdr *h = s->get();
+  Mac *cur_mac = mac;
+
+  h->first_seen = first_seen, h->last_stats_reset = last_stats_reset;
+  h->os_id = (u_int8_t)getOS();
+  if(cur_mac) memcpy(h->mac, cur_mac->get_mac(), sizeof(h->mac));
+
+  if(stats) stats->getSnapshot(s);
+}
+
+/* *************************************** */
+
+/* NOTE: same as LocalHost::deserialize for the JSON records */
+void Host::restoreSnapshot(const HostSnapshot *s) {
+  const struct host_snapshot_hdr *h = s->get();
+
+  if(stats && !isBroadcastHost()) stats->restoreSnapshot(s);
+
+  if((!mac) && (!Utils::isEmptyMac(h->mac))) {
+    u_int8_t mac_buf[6];
+
+    memcpy(mac_buf, h->mac, sizeof(mac_buf));
+
+    if((mac = iface->getMac(mac_buf, true /* create if not exists */, true /* Inline call */)) != NULL)
+      mac->incUses();
+  }
+
+  if(h->first_seen && ((time_t)h->first_seen < first_seen)) first_seen = h->first_seen;
+  last_stats_reset = h->last_stats_reset;
+
+  if((getOS() == os_unknown) && (h->os_id != os_unknown))
+    setOS((OSType)h->os_id);
+
+  checkStatsReset();
+}
+
+/* *************************************** */
+
 char* Host::get_visual_name(char *buf, u_int buf_len) {
   bool mask_host = Utils::maskHost(isLocalHost());
   char buf2[64];
@@ -1437,7 +1511,7 @@ void Host::splitHostVLAN(const char *at_sign_str, char*buf, int bufsize, VLANid
 /* *************************************** */
 
 void Host::reloadHostBlacklist() {
-  ip.reloadBlacklist(iface->get_ndpi_struct());
+  ip.reloadBlacklist();
 }
 
 /* *************************************** */
@@ -68,6 +68,7 @@ void HostChecksExecutor::releaseAllDisabledAlerts(Host *h) {
 
 void HostChecksExecutor::execChecks(Host *h) {
   bool run_min_cbs, run_5min_cbs; /* Checks to be executed during this run */
+  bool profiling = ntop->getPrefs()->areChecksProfilingEnabled();
   time_t now = time(NULL);
 
   /* Release (auto-release) alerts for disabled checks */
@@ -85,6 +86,11 @@ void HostChecksExecutor::execChecks(Host *h) {
     if ((run_min_cbs && cb->isMinCheck())
 	|| (run_5min_cbs && cb->is5MinCheck())) {
       HostAlert *alert;
+      bool timed = profiling || cb->hasCpuBudget();
+      ticks t1 = 0;
+
+      /* Over its CPU budget: leave engaged alerts untouched until the next run */
+      if(!cb->shouldRun()) continue;
 
       /* Initializing (auto-release) alert to expiring, to check if
        * it needs to be released when not engaged again */
@@ -93,9 +99,13 @@ void HostChecksExecutor::execChecks(Host *h) {
       if(alert && alert->hasAutoRelease())
         alert->setExpiring();
 
+      if(timed) t1 = Utils::getticks();
+
       /* Call Handler */
       cb->periodicUpdate(h, alert);
 
+      if(timed) cb->incStats(Utils::getticks() - t1);
+
       /* Check if alert is expired and should be released
        * NOTE: call getCheckEngagedAlert again in case the
        * alert ahs been explicitly released by the check.
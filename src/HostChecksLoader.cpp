@@ -163,6 +163,7 @@ void HostChecksLoader::loadConfiguration() {
 	    }
 
 	    cb->enable(it->second /* This is the periodicity in seconds */);
+	    cb->setCpuBudget(getCpuBudget(json_hook_all));
 	    cb->scriptEnable(); 
 	  } else {
 	    ntop->getTrace()->traceEvent(TRACE_ERROR, "Error while loading check configuration for %s", check_key);
@@ -223,3 +224,19 @@ bool HostChecksLoader::luaCheckInfo(lua_State* vm, std::string check_name) const
 
   return true;
 }
+
+/* **************************************************** */
+
+void HostChecksLoader::lua(lua_State *vm) {
+  lua_newtable(vm);
+
+  for(std::map<std::string, HostCheck*>::const_iterator it = cb_all.begin(); it != cb_all.end(); ++it) {
+    lua_newtable(vm);
+
+    it->second->luaStats(vm);
+
+    lua_pushstring(vm, it->first.c_str());
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
+}
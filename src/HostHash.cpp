@@ -37,9 +37,10 @@ Host* HostHash::get(VLANid vlanId, IpAddress *key, bool is_inline_call, u_int16_
     return(NULL);
   } else {
     Host *head;
+    int epoch_slot = -1;
 
     if(!is_inline_call)
-      locks[hash]->rdlock(__FILE__, __LINE__);
+      epoch_slot = enterReadSection(hash);
 
     head = (Host*)table[hash];
     
@@ -55,7 +56,7 @@ Host* HostHash::get(VLANid vlanId, IpAddress *key, bool is_inline_call, u_int16_
     }
 
     if(!is_inline_call)
-      locks[hash]->unlock(__FILE__, __LINE__);
+      exitReadSection(hash, epoch_slot);
 
     return(head);
   }
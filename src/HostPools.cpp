@@ -27,6 +27,7 @@
 
 HostPools::HostPools(NetworkInterface *_iface) {
   tree = tree_shadow = NULL;
+  trees_generation = 1; /* 0 is never valid for the caches */
 #ifdef NTOPNG_PRO
   children_safe = forge_global_dns = NULL;
   routing_policy_id = NULL;
@@ -139,6 +140,7 @@ void HostPools::swap(VLANAddressTree *new_trees, HostPoolStats **new_stats) {
     }
 
     tree = new_trees;
+    trees_generation++; /* After the swap: a cached lookup is never newer than its generation */
   }
 }
 
@@ -502,6 +504,7 @@ void HostPools::reloadPools() {
 
   if(pools) free(pools);
 
+  new_tree->compile();
   swap(new_tree, new_stats);
 
   iface->refreshHostPools();
@@ -547,6 +550,27 @@ bool HostPools::findIpPool(IpAddress *ip, VLANid vlan_id,
   if(!tree || !(cur_tree = tree))
     return(false);
 
+  if(found_node == NULL) {
+    /* Fast path on the compiled tree, when available */
+    int16_t ret;
+
+    if(ip->isIPv4())
+      ret = cur_tree->findAddress(vlan_id, AF_INET, (void*)&ip->getIP()->ipType.ipv4);
+    else
+      ret = cur_tree->findAddress(vlan_id, AF_INET6, (void*)&ip->getIP()->ipType.ipv6);
+
+    if(ret == -1)
+      return(false);
+
+#ifdef HOST_POOLS_DEBUG
+    ntop->getTrace()->traceEvent(TRACE_NORMAL,
+				 "Found pool for %s [pool id: %i]",
+				 ip->print(buf, sizeof(buf)), ret);
+#endif
+    *found_pool = (u_int16_t)ret;
+    return(true);
+  }
+
   *found_node = (ndpi_patricia_node_t*)ip->findAddress(cur_tree->getAddressTree(vlan_id));
 
   if(*found_node) {
@@ -566,7 +590,6 @@ bool HostPools::findIpPool(IpAddress *ip, VLANid vlan_id,
 
 u_int16_t HostPools::getPool(Host *h) {
   u_int16_t pool_id;
-  ndpi_patricia_node_t *node;
   bool found = false;
 
   if(h) {
@@ -574,7 +597,7 @@ u_int16_t HostPools::getPool(Host *h) {
       found = findMacPool(h->getMac(), &pool_id);
 
     if(!found && h->get_ip()) {
-      found = findIpPool(h->get_ip(), h->get_vlan_id(), &pool_id, &node);
+      found = findIpPool(h->get_ip(), h->get_vlan_id(), &pool_id);
     }
   }
 
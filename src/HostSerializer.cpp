@@ -0,0 +1,363 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* *************************************** */
+
+static void* hostSerializerFctn(void* ptr) {
+  Utils::setThreadName("host-serializer");
+
+  ((HostSerializer*)ptr)->run();
+
+  return(NULL);
+}
+
+/* *************************************** */
+
+HostSerializer::HostSerializer(NetworkInterface *_iface) {
+  iface = _iface;
+  started = terminated = false;
+  next_restore_id = 1;
+  num_written = num_inline_writes = num_restore_requests = num_inline_restores = 0;
+  num_restored = num_legacy = num_not_found = num_invalid = 0;
+  num_applied = num_stale = 0;
+  num_serialize_samples = serialize_nsec = serialize_max_nsec = 0;
+  restore_nsec = restore_max_nsec = 0;
+
+  to_write   = new (std::nothrow) FifoQueue<host_serialization*>(HOST_SERIALIZER_QUEUE_LEN);
+  to_restore = new (std::nothrow) FifoQueue<host_restore*>(HOST_SERIALIZER_QUEUE_LEN);
+  restored   = new (std::nothrow) FifoQueue<host_restore*>(HOST_SERIALIZER_QUEUE_LEN);
+
+  if((to_write == NULL) || (to_restore == NULL) || (restored == NULL))
+    throw "Not enough memory";
+}
+
+/* *************************************** */
+
+HostSerializer::~HostSerializer() {
+  host_serialization *w;
+  host_restore *r;
+
+  shutdown();
+
+  while((w = to_write->dequeue()) != NULL) delete w;
+  while((r = to_restore->dequeue()) != NULL) freeRestore(r);
+  while((r = restored->dequeue()) != NULL) freeRestore(r);
+
+  delete to_write;
+  delete to_restore;
+  delete restored;
+}
+
+/* *************************************** */
+
+/* Started on first use: most interfaces never need it */
+void HostSerializer::start() {
+  m.lock(__FILE__, __LINE__);
+
+  if((!started) && (!terminated)) {
+    if(pthread_create(&thread, NULL, hostSerializerFctn, (void*)this) == 0)
+      started = true;
+    else
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to start the host serializer of %s", iface->get_name());
+  }
+
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* *************************************** */
+
+void HostSerializer::stop() {
+  m.lock(__FILE__, __LINE__);
+  terminated = true;
+  m.unlock(__FILE__, __LINE__);
+
+  if(started) {
+    wakeup.signal();
+    pthread_join(thread, NULL);
+    started = false;
+  }
+}
+
+/* *************************************** */
+
+void HostSerializer::shutdown() {
+  stop();
+
+  /* Hosts purged during the shutdown */
+  flushWrites();
+}
+
+/* *************************************** */
+
+host_restore* HostSerializer::readPendingRestore() {
+  host_restore *r = to_restore->dequeue();
+
+  if(r) {
+    flushWrites();
+    loadRestore(r);
+  }
+
+  return(r);
+}
+
+/* *************************************** */
+
+void HostSerializer::run() {
+  while(!terminated
+	&& (!ntop->getGlobals()->isShutdown())) {
+    if(drain() == 0) {
+      struct timespec expire;
+
+      expire.tv_sec = time(NULL) + 1, expire.tv_nsec = 0;
+      wakeup.timedWait(&expire);
+    }
+  }
+}
+
+/* *************************************** */
+
+/*
+  The lock is held during the writes: a reader flushing the writes before a
+  load also waits for the record being written by the other thread.
+*/
+u_int32_t HostSerializer::flushWrites() {
+  u_int32_t n = 0;
+  host_serialization *w;
+
+  writes_lock.lock(__FILE__, __LINE__);
+
+  while((w = to_write->dequeue()) != NULL) {
+    if(write(w)) num_written++;
+    delete w, n++;
+  }
+
+  writes_lock.unlock(__FILE__, __LINE__);
+
+  return(n);
+}
+
+/* *************************************** */
+
+u_int32_t HostSerializer::drain() {
+  u_int32_t n;
+  host_restore *r;
+
+  n = flushWrites();
+
+  /* This thread is the only producer of restored */
+  while(restored->canEnqueue() && ((r = to_restore->dequeue()) != NULL)) {
+    /*
+      The record of a host going idle and coming back is enqueued before its
+      restore request, possibly after the flush above: a host coming back
+      must find its latest record
+    */
+    n += flushWrites();
+
+    loadRestore(r);
+
+    /* Also when missing: the host is waiting for it */
+    restored->enqueue(r), n++;
+  }
+
+  return(n);
+}
+
+/* *************************************** */
+
+void HostSerializer::loadRestore(host_restore *r) {
+  switch(load(r)) {
+  case 1:
+    if(r->snapshot) num_restored++; else num_legacy++;
+    break;
+  case 0:
+    num_not_found++;
+    break;
+  default:
+    num_invalid++;
+    break;
+  }
+}
+
+/* *************************************** */
+
+bool HostSerializer::write(const host_serialization *w) {
+  u_int32_t duration = ntop->getPrefs()->get_local_host_cache_duration();
+  bool rv;
+
+  rv = (ntop->getRedis()->setBinary(w->key.c_str(), w->record.data(), w->record.size(), duration) == 0);
+
+  if(!w->ip_mac_key.empty())
+    ntop->getRedis()->set(w->ip_mac_key.c_str(), w->mac.c_str(), duration);
+
+  return(rv);
+}
+
+/* *************************************** */
+
+int HostSerializer::load(host_restore *r) {
+  std::string record;
+  HostSnapshot *s;
+
+  r->snapshot = NULL, r->legacy = NULL;
+
+  if(ntop->getRedis()->getBinary(r->key.c_str(), &record) != 0)
+    return(0);
+
+  if((s = new (std::nothrow) HostSnapshot()) == NULL)
+    return(0);
+
+  if(s->decode(record.data(), record.size())) {
+    r->snapshot = s;
+    return(1);
+  }
+
+  delete s;
+
+  if((record.size() > 0) && (record[0] == '{')) {
+    enum json_tokener_error jerr = json_tokener_success;
+
+    if((r->legacy = json_tokener_parse_verbose(record.c_str(), &jerr)) != NULL)
+      return(1);
+  }
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "Discarding invalid host record %s", r->key.c_str());
+  ntop->getRedis()->del((char*)r->key.c_str());
+
+  return(-1);
+}
+
+/* *************************************** */
+
+void HostSerializer::freeRestore(host_restore *r) {
+  if(r->snapshot) delete r->snapshot;
+  if(r->legacy)   json_object_put(r->legacy);
+  delete r;
+}
+
+/* *************************************** */
+
+bool HostSerializer::enqueueSerialization(host_serialization *w) {
+  if(!started) start();
+
+  if(terminated || (!to_write->enqueue(w))) {
+    num_inline_writes++;
+    return(false);
+  }
+
+  wakeup.signal();
+
+  return(true);
+}
+
+/* *************************************** */
+
+/* Returns the id of the request to be kept by the host, 0 when not enqueued */
+u_int32_t HostSerializer::enqueueRestore(const char *key, LocalHost *h) {
+  host_restore *r;
+
+  if(!started) start();
+
+  num_restore_requests++;
+
+  if(terminated || ((r = new (std::nothrow) host_restore) == NULL)) {
+    num_inline_restores++;
+    return(0);
+  }
+
+  r->id = next_restore_id++;
+  if(r->id == 0) r->id = next_restore_id++; /* Wrap */
+  r->key = key;
+  r->ip.set(h->get_ip());
+  r->vlan_id = h->get_vlan_id(), r->observation_point_id = h->get_observation_point_id();
+  r->snapshot = NULL, r->legacy = NULL;
+
+  if(!to_restore->enqueue(r)) {
+    delete r;
+    num_inline_restores++;
+    return(0);
+  }
+
+  wakeup.signal();
+
+  return(r->id);
+}
+
+/* *************************************** */
+
+host_restore* HostSerializer::dequeueRestored() {
+  return(restored->empty() ? NULL : restored->dequeue());
+}
+
+/* *************************************** */
+
+void HostSerializer::updateMax(std::atomic<u_int64_t> *max_val, u_int64_t v) {
+  u_int64_t cur = max_val->load();
+
+  while((v > cur) && (!max_val->compare_exchange_weak(cur, v)))
+    ;
+}
+
+/* *************************************** */
+
+void HostSerializer::incSerializeTime(u_int64_t nsec) {
+  num_serialize_samples++, serialize_nsec += nsec;
+  updateMax(&serialize_max_nsec, nsec);
+}
+
+/* *************************************** */
+
+void HostSerializer::incRestoreTime(u_int64_t nsec) {
+  restore_nsec += nsec;
+  updateMax(&restore_max_nsec, nsec);
+}
+
+/* *************************************** */
+
+void HostSerializer::lua(lua_State *vm) {
+  u_int64_t serialize_samples = num_serialize_samples, restore_samples = num_restore_requests;
+
+  lua_newtable(vm);
+
+  lua_push_uint64_table_entry(vm, "num_written", num_written);
+  lua_push_uint64_table_entry(vm, "num_inline_writes", num_inline_writes);
+  lua_push_uint64_table_entry(vm, "num_restore_requests", num_restore_requests);
+  lua_push_uint64_table_entry(vm, "num_inline_restores", num_inline_restores);
+  lua_push_uint64_table_entry(vm, "num_restored", num_restored);
+  lua_push_uint64_table_entry(vm, "num_legacy", num_legacy);
+  lua_push_uint64_table_entry(vm, "num_not_found", num_not_found);
+  lua_push_uint64_table_entry(vm, "num_invalid", num_invalid);
+  lua_push_uint64_table_entry(vm, "num_applied", num_applied);
+  lua_push_uint64_table_entry(vm, "num_stale", num_stale);
+  lua_push_uint64_table_entry(vm, "write_queue_len", to_write->getLength());
+  lua_push_uint64_table_entry(vm, "restore_queue_len", to_restore->getLength());
+
+  /* Packet thread cost, including the inline fallbacks */
+  lua_push_uint64_table_entry(vm, "serialize_avg_nsec", serialize_samples ? serialize_nsec / serialize_samples : 0);
+  lua_push_uint64_table_entry(vm, "serialize_max_nsec", serialize_max_nsec);
+  lua_push_uint64_table_entry(vm, "restore_avg_nsec", restore_samples ? restore_nsec / restore_samples : 0);
+  lua_push_uint64_table_entry(vm, "restore_max_nsec", restore_max_nsec);
+
+  lua_pushstring(vm, "host_serializer");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
@@ -0,0 +1,82 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* *************************************** */
+
+HostSnapshot::HostSnapshot() {
+  reset();
+}
+
+/* *************************************** */
+
+void HostSnapshot::reset() {
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = HOST_SNAPSHOT_MAGIC, hdr.version = HOST_SNAPSHOT_VERSION;
+  hdr.ndpi_max_protos = NDPI_MAX_SUPPORTED_PROTOCOLS;
+  protos.clear();
+}
+
+/* *************************************** */
+
+void HostSnapshot::encode(std::string *out) {
+  hdr.num_protos = (u_int16_t)protos.size();
+
+  out->reserve(sizeof(hdr) + protos.size() * sizeof(struct host_snapshot_proto));
+  out->assign((const char*)&hdr, sizeof(hdr));
+
+  if(protos.size() > 0)
+    out->append((const char*)&protos[0], protos.size() * sizeof(struct host_snapshot_proto));
+}
+
+/* *************************************** */
+
+bool HostSnapshot::decode(const char *buf, u_int32_t len) {
+  u_int32_t expected_len;
+
+  if(len < sizeof(hdr))
+    return(false);
+
+  memcpy(&hdr, buf, sizeof(hdr));
+
+  if((hdr.magic != HOST_SNAPSHOT_MAGIC) || (hdr.version != HOST_SNAPSHOT_VERSION))
+    return(false);
+
+  expected_len = sizeof(hdr) + hdr.num_protos * sizeof(struct host_snapshot_proto);
+
+  if(len != expected_len)
+    return(false);
+
+  protos.clear();
+
+  /* Protocol ids are only meaningful for the same nDPI */
+  if(hdr.ndpi_max_protos == NDPI_MAX_SUPPORTED_PROTOCOLS) {
+    protos.resize(hdr.num_protos);
+
+    if(hdr.num_protos > 0)
+      memcpy(&protos[0], &buf[sizeof(hdr)], hdr.num_protos * sizeof(struct host_snapshot_proto));
+  }
+
+  hdr.num_protos = (u_int16_t)protos.size();
+
+  return(true);
+}
@@ -279,6 +279,44 @@ void HostStats::getJSONObject(json_object *my_object, DetailsLevel details_level
 
 /* *************************************** */
 
+/* NOTE: check out LocalHostStats for the DNS/HTTP counters */
+void HostStats::getSnapshot(HostSnapshot *s) {
+  struct host_snapshot_hdr *h = s->get();
+
+  getTrafficSnapshot(s);
+
+  h->udp_sent_unicast = udp_sent_unicast, h->udp_sent_non_unicast = udp_sent_non_unicast;
+  h->flows[0] = total_num_flows_as_client, h->flows[1] = total_num_flows_as_server;
+  h->alerted_flows[0] = alerted_flows_as_client, h->alerted_flows[1] = alerted_flows_as_server;
+  h->unreachable_flows[0] = unreachable_flows_as_client, h->unreachable_flows[1] = unreachable_flows_as_server;
+  h->host_unreachable_flows[0] = host_unreachable_flows_as_client, h->host_unreachable_flows[1] = host_unreachable_flows_as_server;
+  h->total_activity_time = total_activity_time;
+}
+
+/* *************************************** */
+
+/*
+  Snapshots are restored after the host has been created, so the
+  counters are added to the traffic seen in the meantime
+*/
+void HostStats::restoreSnapshot(const HostSnapshot *s) {
+  const struct host_snapshot_hdr *h = s->get();
+
+  restoreTrafficSnapshot(s);
+
+  udp_sent_unicast += h->udp_sent_unicast, udp_sent_non_unicast += h->udp_sent_non_unicast;
+  total_num_flows_as_client += h->flows[0], total_num_flows_as_server += h->flows[1];
+  alerted_flows_as_client += h->alerted_flows[0], alerted_flows_as_server += h->alerted_flows[1];
+  unreachable_flows_as_client += h->unreachable_flows[0], unreachable_flows_as_server += h->unreachable_flows[1];
+  host_unreachable_flows_as_client += h->host_unreachable_flows[0], host_unreachable_flows_as_server += h->host_unreachable_flows[1];
+  total_activity_time += h->total_activity_time;
+
+  checkpoints.sent_bytes = getNumBytesSent();
+  checkpoints.rcvd_bytes = getNumBytesRcvd();
+}
+
+/* *************************************** */
+
 /* NOTE: this method is also called by Host::lua
  * Return only the minimal information needed by the timeseries
  * to avoid slowing down the periodic scripts too much! */
@@ -0,0 +1,236 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#ifndef WIN32
+
+#include <sys/mman.h>
+
+/* *************************************** */
+
+InterfaceCheckpoint::InterfaceCheckpoint(u_int16_t interface_id) {
+  snprintf(path, sizeof(path), "%s/%u/%s", ntop->get_working_dir(), interface_id, INTERFACE_CHECKPOINT_FILE);
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = INTERFACE_CHECKPOINT_MAGIC, hdr.version = INTERFACE_CHECKPOINT_VERSION;
+  hdr.interface_id = interface_id;
+
+  fd = NULL, fd_buf = NULL;
+  map = NULL, map_len = offset = 0;
+  num_bytes = 0;
+}
+
+/* *************************************** */
+
+InterfaceCheckpoint::~InterfaceCheckpoint() {
+  close();
+}
+
+/* *************************************** */
+
+void InterfaceCheckpoint::close() {
+  if(fd) {
+    char tmp_path[MAX_PATH + 8];
+
+    /* Not committed */
+    fclose(fd), fd = NULL;
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    unlink(tmp_path);
+  }
+
+  if(fd_buf) free(fd_buf), fd_buf = NULL;
+  if(map)    munmap(map, map_len), map = NULL;
+}
+
+/* *************************************** */
+
+bool InterfaceCheckpoint::create() {
+  char tmp_path[MAX_PATH + 8], dir[MAX_PATH], *slash;
+
+  snprintf(dir, sizeof(dir), "%s", path);
+  if((slash = strrchr(dir, '/')) != NULL) {
+    *slash = '\0';
+    Utils::mkdir_tree(dir);
+  }
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  if((fd = fopen(tmp_path, "wb")) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to create checkpoint %s: %s", tmp_path, strerror(errno));
+    return(false);
+  }
+
+  if((fd_buf = (char*)malloc(INTERFACE_CHECKPOINT_BUF_LEN)) != NULL)
+    setvbuf(fd, fd_buf, _IOFBF, INTERFACE_CHECKPOINT_BUF_LEN);
+
+  hdr.when = time(NULL);
+
+  /* Rewritten with the final counters on commit */
+  if(fwrite(&hdr, sizeof(hdr), 1, fd) != 1) {
+    close();
+    return(false);
+  }
+
+  num_bytes = sizeof(hdr);
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool InterfaceCheckpoint::write(CheckpointRecordType type, const void *key, u_int8_t key_len,
+				VLANid vlan_id, u_int16_t observation_point_id, HostSnapshot *s) {
+  struct checkpoint_record r;
+
+  if(!fd) return(false);
+
+  s->encode(&record);
+
+  r.type = (u_int8_t)type, r.key_len = key_len;
+  r.vlan_id = vlan_id, r.observation_point_id = observation_point_id;
+  r.len = (u_int32_t)record.size();
+
+  if((fwrite(&r, sizeof(r), 1, fd) != 1)
+     || (key_len && (fwrite(key, key_len, 1, fd) != 1))
+     || (fwrite(record.data(), record.size(), 1, fd) != 1))
+    return(false);
+
+  hdr.num_records[type]++;
+  num_bytes += sizeof(r) + key_len + record.size();
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool InterfaceCheckpoint::commit() {
+  char tmp_path[MAX_PATH + 8];
+  bool rc;
+
+  if(!fd) return(false);
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  rc = (fseek(fd, 0, SEEK_SET) == 0)
+    && (fwrite(&hdr, sizeof(hdr), 1, fd) == 1)
+    && (fflush(fd) == 0)
+    && (fsync(fileno(fd)) == 0);
+
+  rc = (fclose(fd) == 0) && rc, fd = NULL;
+
+  if(rc && (rename(tmp_path, path) != 0))
+    rc = false;
+
+  if(!rc) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write checkpoint %s: %s", path, strerror(errno));
+    unlink(tmp_path);
+  }
+
+  return(rc);
+}
+
+/* *************************************** */
+
+bool InterfaceCheckpoint::open(u_int32_t max_age) {
+  struct stat s;
+  struct checkpoint_hdr h;
+  int map_fd;
+
+  if((map_fd = ::open(path, O_RDONLY)) == -1)
+    return(false); /* No checkpoint */
+
+  if((fstat(map_fd, &s) != 0) || ((size_t)s.st_size < sizeof(h))) {
+    ::close(map_fd);
+    return(false);
+  }
+
+  map_len = (size_t)s.st_size;
+  map = (u_char*)mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, map_fd, 0);
+  ::close(map_fd);
+
+  if(map == MAP_FAILED) {
+    map = NULL;
+    return(false);
+  }
+
+#ifdef __linux__
+  madvise(map, map_len, MADV_SEQUENTIAL | MADV_WILLNEED);
+#endif
+
+  memcpy(&h, map, sizeof(h));
+
+  if((h.magic != INTERFACE_CHECKPOINT_MAGIC)
+     || (h.version != INTERFACE_CHECKPOINT_VERSION)
+     || (h.interface_id != hdr.interface_id)) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Ignoring invalid checkpoint %s", path);
+    return(false);
+  }
+
+  if((time_t)(h.when + max_age) < time(NULL)) {
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Ignoring checkpoint %s older than %u sec", path, max_age);
+    return(false);
+  }
+
+  memcpy(&hdr, &h, sizeof(hdr));
+  offset = sizeof(hdr), num_bytes = map_len;
+
+  return(true);
+}
+
+/* *************************************** */
+
+int InterfaceCheckpoint::next(struct checkpoint_record *r, const u_int8_t **key, HostSnapshot *s) {
+  if((map == NULL) || ((offset + sizeof(*r)) > map_len))
+    return(-1);
+
+  /* Records are not aligned */
+  memcpy(r, &map[offset], sizeof(*r));
+
+  if((offset + sizeof(*r) + r->key_len + r->len) > map_len) {
+    offset = map_len; /* Truncated */
+    return(-1);
+  }
+
+  *key = &map[offset + sizeof(*r)];
+  offset += sizeof(*r) + r->key_len;
+
+  if(!s->decode((const char*)&map[offset], r->len)) {
+    offset += r->len;
+    return(0);
+  }
+
+  offset += r->len;
+
+  return((r->type < CHECKPOINT_NUM_RECORD_TYPES) ? 1 : 0);
+}
+
+/* *************************************** */
+
+/* A checkpoint is loaded once: the local hosts cache is more recent afterwards */
+void InterfaceCheckpoint::remove() {
+  close();
+  unlink(path);
+}
+
+/* *************************************** */
+
+#endif /* WIN32 */
@@ -71,12 +71,12 @@ void IpAddress::set(union usa *ip) {
 
 /* ******************************************* */
 
-void IpAddress::reloadBlacklist(ndpi_detection_module_struct* ndpi_struct) {
-  char ipbuf[64];
-  char *ip_str = print(ipbuf, sizeof(ipbuf));
+void IpAddress::reloadBlacklist() {
+  CategoryDB *db = ntop->getCategoryDB();
   ndpi_protocol_category_t category;
 
-  if((ndpi_get_custom_category_match(ndpi_struct, ip_str, strlen(ip_str), &category) == 0)
+  /* Only IPv4 is supported by the category lists */
+  if(db && isIPv4() && db->matchIP(addr.ipType.ipv4, &category)
      && category == CUSTOM_CATEGORY_MALWARE)
     addr.blacklistedIP = true;
 }
@@ -0,0 +1,360 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* Deeper tables (e.g. cycles) are encoded as null */
+#define JSON_STREAM_WRITER_MAX_DEPTH  32
+
+/* ***************************************** */
+
+JSONStreamWriter::JSONStreamWriter(struct mg_connection *_conn, u_int32_t _buf_size) {
+  conn = _conn, buf_len = 0, num_bytes = 0;
+  after_key = false, write_error = false;
+
+  buf_size = max_val(_buf_size, 64);
+
+  if((buf = (char*)malloc(buf_size)) == NULL)
+    throw "Not enough memory";
+}
+
+/* ***************************************** */
+
+JSONStreamWriter::~JSONStreamWriter() {
+  flush();
+  free(buf);
+}
+
+/* ***************************************** */
+
+bool JSONStreamWriter::flush() {
+  if(buf_len > 0) {
+    /* Once the client has gone, data is silently discarded */
+    if((!write_error) && (mg_write(conn, buf, buf_len) != (int)buf_len))
+      write_error = true;
+
+    num_bytes += buf_len, buf_len = 0;
+  }
+
+  return(!write_error);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::append(const char *s, u_int32_t len) {
+  while(len > 0) {
+    u_int32_t l;
+
+    if(buf_len == buf_size) flush();
+
+    l = min_val(len, buf_size - buf_len);
+    memcpy(&buf[buf_len], s, l);
+    buf_len += l, s += l, len -= l;
+  }
+}
+
+/* ***************************************** */
+
+/* Same escapes as dkjson */
+void JSONStreamWriter::appendEscaped(const char *s, size_t len) {
+  size_t begin = 0;
+
+  append('"');
+
+  for(size_t i = 0; i < len; i++) {
+    u_char c = (u_char)s[i];
+    const char *esc;
+    char hex[8];
+
+    if((c >= 0x20) && (c != '"') && (c != '\\') && (c != 0x7F))
+      continue;
+
+    append(&s[begin], i - begin);
+    begin = i + 1;
+
+    switch(c) {
+    case '"':  esc = "\\\""; break;
+    case '\\': esc = "\\\\"; break;
+    case '\b': esc = "\\b";  break;
+    case '\f': esc = "\\f";  break;
+    case '\n': esc = "\\n";  break;
+    case '\r': esc = "\\r";  break;
+    case '\t': esc = "\\t";  break;
+    default:
+      snprintf(hex, sizeof(hex), "\\u%04x", c);
+      esc = hex;
+    }
+
+    append(esc, strlen(esc));
+  }
+
+  append(&s[begin], len - begin);
+  append('"');
+}
+
+/* ***************************************** */
+
+/* Called before every value and key */
+void JSONStreamWriter::separator() {
+  if(after_key)
+    after_key = false;
+  else if(!nonempty.empty()) {
+    if(nonempty.back())
+      append(',');
+    else
+      nonempty.back() = true;
+  }
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::beginObject() {
+  separator();
+  append('{');
+  nonempty.push_back(false);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::endObject() {
+  append('}');
+  if(!nonempty.empty()) nonempty.pop_back();
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::beginArray() {
+  separator();
+  append('[');
+  nonempty.push_back(false);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::endArray() {
+  append(']');
+  if(!nonempty.empty()) nonempty.pop_back();
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::key(const char *k) {
+  separator();
+  appendEscaped(k, strlen(k));
+  append(':');
+  after_key = true;
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::string(const char *v) {
+  separator();
+
+  if(v)
+    appendEscaped(v, strlen(v));
+  else
+    append("null", 4);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::uint64(u_int64_t v) {
+  char tmp[32];
+  int l = snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)v);
+
+  separator();
+  append(tmp, l);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::int64(int64_t v) {
+  char tmp[32];
+  int l = snprintf(tmp, sizeof(tmp), "%lld", (long long)v);
+
+  separator();
+  append(tmp, l);
+}
+
+/* ***************************************** */
+
+/* Formatted as Lua's tostring() as dkjson does: NaN and infinity are null */
+void JSONStreamWriter::number(double v) {
+  char tmp[48];
+  int l;
+
+  separator();
+
+  if(std::isnan(v) || std::isinf(v)) {
+    append("null", 4);
+    return;
+  }
+
+  l = snprintf(tmp, sizeof(tmp), "%.14g", v);
+
+  if(strspn(tmp, "-0123456789") == (size_t)l)
+    tmp[l++] = '.', tmp[l++] = '0'; /* Integral float */
+
+  append(tmp, l);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::boolean(bool v) {
+  separator();
+
+  if(v) append("true", 4); else append("false", 5);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::null() {
+  separator();
+  append("null", 4);
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::luaNumber(lua_State *vm, int idx) {
+  if(lua_isinteger(vm, idx))
+    int64((int64_t)lua_tointeger(vm, idx));
+  else
+    number((double)lua_tonumber(vm, idx));
+}
+
+/* ***************************************** */
+
+/*
+  As dkjson: tables with positive integer keys only are arrays (holes are
+  null) unless too sparse, the others are objects with keys converted to
+  strings. Empty tables are empty arrays.
+*/
+void JSONStreamWriter::luaTable(lua_State *vm, int idx, u_int8_t depth) {
+  lua_Integer max = 0, n = 0;
+  bool is_array = true;
+
+  idx = lua_absindex(vm, idx);
+
+  lua_pushnil(vm);
+  while(lua_next(vm, idx) != 0) {
+    lua_pop(vm, 1); /* Value */
+
+    if(lua_isinteger(vm, -1) && (lua_tointeger(vm, -1) >= 1)) {
+      if(lua_tointeger(vm, -1) > max) max = lua_tointeger(vm, -1);
+      n++;
+    } else {
+      is_array = false;
+      lua_pop(vm, 1); /* Key */
+      break;
+    }
+  }
+
+  if(is_array && (max > 10) && (max > n * 2))
+    is_array = false; /* Too many holes */
+
+  if(is_array) {
+    beginArray();
+
+    for(lua_Integer i = 1; i <= max; i++) {
+      lua_rawgeti(vm, idx, i);
+      luaEncode(vm, -1, depth + 1);
+      lua_pop(vm, 1);
+    }
+
+    endArray();
+  } else {
+    beginObject();
+
+    lua_pushnil(vm);
+    while(lua_next(vm, idx) != 0) {
+      switch(lua_type(vm, -2)) {
+      case LUA_TSTRING:
+	{
+	  size_t len;
+	  const char *k = lua_tolstring(vm, -2, &len);
+
+	  separator();
+	  appendEscaped(k, len);
+	  append(':');
+	  after_key = true;
+	}
+	break;
+
+      case LUA_TNUMBER:
+	{
+	  char k[48];
+
+	  /* Converted on a copy: lua_tostring on the key would confuse lua_next */
+	  lua_pushvalue(vm, -2);
+	  snprintf(k, sizeof(k), "%s", lua_tostring(vm, -1));
+	  lua_pop(vm, 1);
+	  key(k);
+	}
+	break;
+
+      default:
+	/* Keys not representable in JSON (dkjson raises an error) */
+	lua_pop(vm, 1);
+	continue;
+      }
+
+      luaEncode(vm, -1, depth + 1);
+      lua_pop(vm, 1);
+    }
+
+    endObject();
+  }
+}
+
+/* ***************************************** */
+
+void JSONStreamWriter::luaEncode(lua_State *vm, int idx, u_int8_t depth) {
+  switch(lua_type(vm, idx)) {
+  case LUA_TSTRING:
+    {
+      size_t len;
+      const char *s = lua_tolstring(vm, idx, &len);
+
+      separator();
+      appendEscaped(s, len);
+    }
+    break;
+
+  case LUA_TNUMBER:
+    luaNumber(vm, idx);
+    break;
+
+  case LUA_TBOOLEAN:
+    boolean(lua_toboolean(vm, idx) ? true : false);
+    break;
+
+  case LUA_TTABLE:
+    if(depth < JSON_STREAM_WRITER_MAX_DEPTH) {
+      luaTable(vm, idx, depth);
+      break;
+    }
+    /* Otherwise null */
+
+  default:
+    null();
+    break;
+  }
+}
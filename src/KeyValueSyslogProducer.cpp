@@ -0,0 +1,203 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#ifndef HAVE_NEDGE
+
+/* Field names: Fortinet, Sophos XG, Sophos UTM */
+static const char * const src_ip_keys[]    = { "srcip", "src_ip", NULL };
+static const char * const dst_ip_keys[]    = { "dstip", "dst_ip", NULL };
+static const char * const src_port_keys[]  = { "srcport", "src_port", NULL };
+static const char * const dst_port_keys[]  = { "dstport", "dst_port", NULL };
+static const char * const proto_keys[]     = { "proto", "protocol", NULL };
+static const char * const in_bytes_keys[]  = { "sentbyte", "sent_bytes", NULL };
+static const char * const out_bytes_keys[] = { "rcvdbyte", "recv_bytes", "rcvd_bytes", NULL };
+static const char * const in_pkts_keys[]   = { "sentpkt", "sent_pkts", NULL };
+static const char * const out_pkts_keys[]  = { "rcvdpkt", "recv_pkts", "rcvd_pkts", NULL };
+static const char * const duration_keys[]  = { "duration", NULL };
+
+/* **************************************************** */
+
+KeyValueSyslogProducer::KeyValueSyslogProducer(SyslogParserInterface *_iface, const char *_name) : SyslogProducer(_iface, _name) {
+  num_fields = 0;
+}
+
+/* **************************************************** */
+
+/* Splits key=value pairs in place. Values can be "quoted" (with \" escapes) */
+void KeyValueSyslogProducer::parse(char *message) {
+  char *p = message;
+
+  num_fields = 0;
+
+  while(*p && (num_fields < SYSLOG_KV_MAX_FIELDS)) {
+    char *key, *value, *eq;
+
+    while(*p == ' ') p++;
+    if(*p == '\0') break;
+
+    key = p;
+    while(*p && (*p != '=') && (*p != ' ')) p++;
+
+    if(*p != '=') {
+      /* Token without value (e.g. a "device_name" prefix): skip it */
+      continue;
+    }
+
+    eq = p, *eq = '\0', p++;
+
+    if(*p == '"') {
+      char *w;
+
+      value = w = ++p;
+
+      while(*p && (*p != '"')) {
+	if((*p == '\\') && (p[1] != '\0')) p++;
+	*w++ = *p++;
+      }
+
+      if(*p == '"') p++;
+      *w = '\0';
+    } else {
+      value = p;
+      while(*p && (*p != ' ')) p++;
+      if(*p) *p++ = '\0';
+    }
+
+    fields[num_fields].key = key, fields[num_fields].value = value;
+    num_fields++;
+  }
+}
+
+/* **************************************************** */
+
+const char* KeyValueSyslogProducer::get(const char *key) const {
+  for(u_int i = 0; i < num_fields; i++)
+    if(!strcmp(fields[i].key, key))
+      return(fields[i].value);
+
+  return(NULL);
+}
+
+/* **************************************************** */
+
+const char* KeyValueSyslogProducer::get(const char * const keys[]) const {
+  const char *v;
+
+  for(int i = 0; keys[i]; i++)
+    if((v = get(keys[i])) && (v[0] != '\0'))
+      return(v);
+
+  return(NULL);
+}
+
+/* **************************************************** */
+
+u_int32_t KeyValueSyslogProducer::getNumber(const char * const keys[]) const {
+  const char *v = get(keys);
+
+  return(v ? strtoul(v, NULL, 10) : 0);
+}
+
+/* **************************************************** */
+
+/* Security logs: Fortinet UTM (ips, virus, webfilter, ...), Sophos IDP and Anti-Virus, Sophos UTM IPS */
+bool KeyValueSyslogProducer::isAlert(const char **signature, const char **category, int *severity) const {
+  const char *type = get("type"), *log_type = get("log_type"), *level;
+
+  *signature = get("attack");
+  if(*signature == NULL) *signature = get("virus");
+  if(*signature == NULL) *signature = get("signature_msg");
+
+  if(type && !strcmp(type, "utm"))
+    *category = get("subtype"); /* Fortinet */
+  else if(log_type && strcmp(log_type, "Firewall"))
+    *category = log_type;       /* Sophos XG */
+  else if(*signature)
+    *category = get("classification");
+  else
+    return(false);
+
+  if(*signature == NULL) *signature = get("msg");
+  if(*signature == NULL) *signature = get("name");
+
+  if(((level = get("crlevel")) == NULL) && ((level = get("severity")) == NULL))
+    level = get("level");
+
+  /* Same scale as Suricata: 1 (highest) .. 4 */
+  if(level == NULL)
+    *severity = 3;
+  else if(!strcasecmp(level, "critical") || !strcasecmp(level, "emergency") || !strcasecmp(level, "alert"))
+    *severity = 1;
+  else if(!strcasecmp(level, "high") || !strcasecmp(level, "error"))
+    *severity = 2;
+  else if(!strcasecmp(level, "medium") || !strcasecmp(level, "warning") || !strcasecmp(level, "major"))
+    *severity = 3;
+  else
+    *severity = 4;
+
+  return(true);
+}
+
+/* **************************************************** */
+
+u_int8_t KeyValueSyslogProducer::handleEvent(char *message, const char *host, int priority) {
+  const char *src_ip, *dst_ip, *signature = NULL, *category = NULL;
+  u_int32_t duration, now = (u_int32_t)time(NULL);
+  bool alert;
+  int severity = 0;
+
+  parse(message);
+
+  src_ip = get(src_ip_keys), dst_ip = get(dst_ip_keys);
+
+  if((src_ip == NULL) || (dst_ip == NULL)) {
+    /* System and admin events */
+    incStats(1, 0, 0);
+    return(0);
+  }
+
+  ParsedFlow flow;
+
+  flow.src_ip.set(src_ip), flow.dst_ip.set(dst_ip);
+  flow.src_port = htons((u_int16_t)getNumber(src_port_keys));
+  flow.dst_port = htons((u_int16_t)getNumber(dst_port_keys));
+  flow.l4_proto = str2proto(get(proto_keys));
+  flow.in_bytes = getNumber(in_bytes_keys), flow.out_bytes = getNumber(out_bytes_keys);
+  flow.in_pkts  = getNumber(in_pkts_keys),  flow.out_pkts  = getNumber(out_pkts_keys);
+
+  duration = getNumber(duration_keys);
+  flow.last_switched = now, flow.first_switched = (duration < now) ? (now - duration) : now;
+
+  if((alert = isAlert(&signature, &category, &severity)))
+    flow.external_alert = buildExternalAlert(name, signature, category, severity);
+
+  processFlow(&flow);
+
+  incStats(0, alert ? 1 : 0, alert ? 0 : 1);
+
+  return(1);
+}
+
+/* **************************************************** */
+
+#endif
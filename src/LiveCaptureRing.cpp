@@ -0,0 +1,100 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* *************************************** */
+
+LiveCaptureRing::LiveCaptureRing(u_int32_t _size, u_int32_t _snaplen) {
+  size = Utils::pow2(_size), snaplen = _snaplen;
+  head = 0, tail = 0;
+  num_enqueued_pkts = num_dropped_pkts = 0;
+
+  if((buffer = (u_char*)malloc(size)) == NULL)
+    throw "Not enough memory";
+}
+
+/* *************************************** */
+
+LiveCaptureRing::~LiveCaptureRing() {
+  free(buffer);
+}
+
+/* *************************************** */
+
+void LiveCaptureRing::copy(u_int64_t pos, const void *data, u_int32_t len) {
+  u_int32_t offset = pos & (size - 1), first = ndpi_min(len, size - offset);
+
+  memcpy(&buffer[offset], data, first);
+
+  if(first < len) /* Wrap */
+    memcpy(buffer, &((const u_char*)data)[first], len - first);
+}
+
+/* *************************************** */
+
+bool LiveCaptureRing::write(const void *data, u_int32_t len) {
+  u_int64_t cur_head = head.load(std::memory_order_relaxed);
+
+  if(len > (size - (cur_head - tail.load(std::memory_order_acquire))))
+    return(false);
+
+  copy(cur_head, data, len);
+  head.store(cur_head + len, std::memory_order_release);
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool LiveCaptureRing::enqueue(const struct pcap_pkthdr * const h, const u_char * const packet) {
+  struct pcap_disk_pkthdr pkthdr; /* Cannot use h as the format on disk differs */
+  u_int64_t cur_head = head.load(std::memory_order_relaxed);
+
+  pkthdr.ts.tv_sec = h->ts.tv_sec, pkthdr.ts.tv_usec = h->ts.tv_usec,
+    pkthdr.caplen = ndpi_min(h->caplen, snaplen), pkthdr.len = h->len;
+
+  if((sizeof(pkthdr) + pkthdr.caplen) > (size - (cur_head - tail.load(std::memory_order_acquire)))) {
+    num_dropped_pkts++;
+    return(false);
+  }
+
+  copy(cur_head, &pkthdr, sizeof(pkthdr));
+  copy(cur_head + sizeof(pkthdr), packet, pkthdr.caplen);
+
+  /* Publish the whole record at once */
+  head.store(cur_head + sizeof(pkthdr) + pkthdr.caplen, std::memory_order_release);
+  num_enqueued_pkts++;
+
+  return(true);
+}
+
+/* *************************************** */
+
+u_int32_t LiveCaptureRing::peek(const u_char **data) {
+  u_int64_t cur_tail = tail.load(std::memory_order_relaxed);
+  u_int32_t offset = cur_tail & (size - 1);
+  u_int32_t avail = (u_int32_t)(head.load(std::memory_order_acquire) - cur_tail);
+
+  *data = &buffer[offset];
+
+  return(ndpi_min(avail, size - offset));
+}
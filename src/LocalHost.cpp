@@ -53,31 +53,17 @@ LocalHost::~LocalHost() {
 /* *************************************** */
 
 void LocalHost::set_hash_entry_state_idle() {
-  /* Serialization is performed, inline, as soon as the LocalHost becomes idle, and
+  /* Serialization is performed as soon as the LocalHost becomes idle, and
      not when it is deleted. This guarantees that, if the same host becomes active again,
-     its counters will be consistent even if its other instance has still to be deleted. */
+     its counters will be consistent even if its other instance has still to be deleted.
+     The snapshot is taken inline, the HostSerializer writes it before restoring any host. */
   if(data_delete_requested)
     deleteRedisSerialization();
   else if((ntop->getPrefs()->is_idle_local_host_cache_enabled()
       || ntop->getPrefs()->is_active_local_host_cache_enabled())
      && (!ip.isEmpty())) {
-    Mac *mac = getMac();
     checkStatsReset();
-    serializeToRedis();
-
-    /* For LBD hosts in the DHCP range, also save the IP -> MAC
-     * association. This allows us to both search the host by IP and to
-     * bring up the host in memory with the correct stats. */
-    if(mac && serializeByMac()) {
-      char key[CONST_MAX_LEN_REDIS_KEY];
-      char buf[64], mac_buf[32];
-
-      snprintf(key, sizeof(key), IP_MAC_ASSOCIATION, iface->get_id(), ip.print(buf, sizeof(buf)), vlan_id);
-      mac->print(mac_buf, sizeof(mac_buf));
-
-      /* IP@VLAN -> MAC */
-      ntop->getRedis()->set(key, mac_buf, ntop->getPrefs()->get_local_host_cache_duration());
-    }
+    serializeSnapshot(true /* idle */);
   }
 
   iface->decNumHosts(true /* A local host */);
@@ -94,6 +80,7 @@ void LocalHost::initialize() {
   char buf[64], host[96], rsp[256];
   
   stats = allocateStats();
+  restore_id = 0, initial_ts_point = NULL;
   updateHostPool(true /* inline with packet processing */, true /* first inc */);
 
   local_network_id = -1;
@@ -105,10 +92,8 @@ void LocalHost::initialize() {
   systemHost = ip.isLocalInterfaceAddress();
 
   INTERFACE_PROFILING_SUB_SECTION_ENTER(iface, "LocalHost::initialize: local_host_cache", 16);
-  if(ntop->getPrefs()->is_idle_local_host_cache_enabled()) {
-    if(!deserializeFromRedis())
-      deleteRedisSerialization();
-  }
+  if(ntop->getPrefs()->is_idle_local_host_cache_enabled() && (!iface->isLoadingCheckpoint()))
+    requestRestore();
   INTERFACE_PROFILING_SUB_SECTION_EXIT(iface, 16);
 
   /* Clone the initial point. It will be written to the timeseries DB to
@@ -119,7 +104,8 @@ void LocalHost::initialize() {
   char *strIP = ip.print(buf, sizeof(buf));
   snprintf(host, sizeof(host), "%s@%u", strIP, vlan_id);
 
-  if(ntop->getPrefs()->is_dns_resolution_enabled()) {
+  /* Skipped for the checkpoint hosts: names are resolved when needed */
+  if(ntop->getPrefs()->is_dns_resolution_enabled() && (!iface->isLoadingCheckpoint())) {
     if(isBroadcastHost() || isMulticastHost()
        || (isIPv6()
 	   && ((strncmp(strIP, "ff0", 3) == 0)
@@ -163,6 +149,161 @@ char* LocalHost::getSerializationKey(char *redis_key, uint bufsize) {
 
 /* *************************************** */
 
+/*
+  The record is read by the HostSerializer thread and added to this host
+  by restore() on the next purgeIdle: the packet thread doesn't wait for redis.
+*/
+void LocalHost::requestRestore() {
+  HostSerializer *s = iface->getHostSerializer();
+  char key[CONST_MAX_LEN_REDIS_KEY];
+  u_int64_t begin = Utils::getTimeNsec();
+
+  getSerializationKey(key, sizeof(key));
+
+  if(!(s && ((restore_id = s->enqueueRestore(key, this)) != 0))) {
+    /* Queue full: restore inline */
+    host_restore *r = new (std::nothrow) host_restore;
+
+    if(r) {
+      r->id = 0, r->key = key;
+
+      /* The record of this host might still be queued */
+      if(s) s->flushWrites();
+
+      if(HostSerializer::load(r) == 1)
+	restore(r);
+
+      HostSerializer::freeRestore(r);
+    }
+  }
+
+  if(s) s->incRestoreTime(Utils::getTimeNsec() - begin);
+}
+
+/* *************************************** */
+
+/* Returns false if the record was requested by another instance of this host */
+bool LocalHost::restore(host_restore *r) {
+  HostSerializer *s = iface->getHostSerializer();
+  u_int64_t begin;
+
+  if(r->id != restore_id)
+    return(false);
+
+  begin = Utils::getTimeNsec();
+
+  if(r->snapshot)
+    restoreSnapshot(r->snapshot);
+  else if(r->legacy)
+    restoreLegacy(r->legacy);
+
+  restore_id = 0;
+
+  if(s) {
+    s->incApplied(false /* not stale */);
+
+    if(r->id != 0) /* Inline restores are accounted by requestRestore */
+      s->incRestoreTime(Utils::getTimeNsec() - begin);
+  }
+
+  return(true);
+}
+
+/* *************************************** */
+
+/*
+  idle: the host is being purged, the record (and the IP@VLAN -> MAC
+  association of LBD hosts) is written by the HostSerializer thread.
+  Otherwise (periodic dump of the active hosts) it is written inline.
+*/
+void LocalHost::serializeSnapshot(bool idle) {
+  HostSerializer *s = iface->getHostSerializer();
+  host_serialization *w;
+  HostSnapshot snapshot;
+  char key[CONST_MAX_LEN_REDIS_KEY];
+  Mac *cur_mac = getMac();
+  u_int64_t begin = Utils::getTimeNsec();
+
+  /* Don't overwrite a record not restored yet */
+  if(isRestorePending() || ((w = new (std::nothrow) host_serialization) == NULL))
+    return;
+
+  getSnapshot(&snapshot);
+  snapshot.encode(&w->record);
+  w->key = getSerializationKey(key, sizeof(key));
+
+  /* For LBD hosts in the DHCP range, also save the IP -> MAC
+   * association. This allows us to both search the host by IP and to
+   * bring up the host in memory with the correct stats. */
+  if(idle && cur_mac && serializeByMac()) {
+    char buf[64], mac_buf[32];
+
+    snprintf(key, sizeof(key), IP_MAC_ASSOCIATION, iface->get_id(), ip.print(buf, sizeof(buf)), vlan_id);
+    cur_mac->print(mac_buf, sizeof(mac_buf));
+
+    /* IP@VLAN -> MAC */
+    w->ip_mac_key = key, w->mac = mac_buf;
+  }
+
+  if(!(idle && s && s->enqueueSerialization(w))) {
+    HostSerializer::write(w);
+    delete w;
+  }
+
+  if(idle && s) s->incSerializeTime(Utils::getTimeNsec() - begin);
+}
+
+/* *************************************** */
+
+/*
+  Legacy (JSON) records are deserialized into blank stats and converted to
+  a snapshot: like the binary ones, they are added to the traffic seen
+  since the host was created instead of overwriting it
+*/
+void LocalHost::restoreLegacy(json_object *o) {
+  LocalHostStats legacy_stats(this);
+  HostSnapshot snapshot;
+  struct host_snapshot_hdr *h = snapshot.get();
+  json_object *obj;
+
+  legacy_stats.deserialize(o);
+
+  /* Not LocalHostStats::getSnapshot, which also saves the top sites of the host */
+  legacy_stats.HostStats::getSnapshot(&snapshot);
+  if(legacy_stats.getDNSstats())  legacy_stats.getDNSstats()->getSnapshot(h);
+  if(legacy_stats.getHTTPstats()) legacy_stats.getHTTPstats()->getSnapshot(h);
+
+  h->last_stats_reset = last_stats_reset;
+
+  if(json_object_object_get_ex(o, "seen.first", &obj))       h->first_seen = json_object_get_int64(obj);
+  if(json_object_object_get_ex(o, "last_stats_reset", &obj)) h->last_stats_reset = json_object_get_int64(obj);
+  if(json_object_object_get_ex(o, "os_id", &obj))            h->os_id = (u_int8_t)json_object_get_int(obj);
+  if(json_object_object_get_ex(o, "mac_address", &obj))      Utils::parseMac(h->mac, json_object_get_string(obj));
+
+  restoreSnapshot(&snapshot);
+}
+
+/* *************************************** */
+
+/* The first timeseries point must include the restored counters */
+void LocalHost::restoreSnapshot(const HostSnapshot *s) {
+  Host::restoreSnapshot(s);
+  refreshInitialTsPoint();
+}
+
+/* *************************************** */
+
+/* Restored after LocalHost::initialize: re-clone the initial point */
+void LocalHost::refreshInitialTsPoint() {
+  if(initial_ts_point) {
+    delete(initial_ts_point);
+    initial_ts_point = new (std::nothrow) LocalHostStats(*(LocalHostStats *)stats);
+    initialization_time = time(NULL);
+  }
+}
+
+/* *************************************** */
+
 void LocalHost::deserialize(json_object *o) {
   json_object *obj;
 
@@ -253,7 +394,8 @@ void LocalHost::lua_contacts_stats(lua_State *vm) const {
 
 void LocalHost::lua(lua_State* vm, AddressTree *ptree,
 		    bool host_details, bool verbose,
-		    bool returnHost, bool asListElement) {
+		    bool returnHost, bool asListElement,
+		    u_int32_t fields) {
   char buf_id[64], *host_id = buf_id;
   const char *local_net;
   bool mask_host = Utils::maskHost(isLocalHost());
@@ -264,23 +406,29 @@ void LocalHost::lua(lua_State* vm, AddressTree *ptree,
   Host::lua(vm,
 	    NULL /* ptree already checked */,
 	    host_details, verbose, returnHost,
-	    false /* asListElement possibly handled later */);
+	    false /* asListElement possibly handled later */,
+	    fields);
 
   /* *** */
 
-  Host::lua_blacklisted_flows(vm);
-  lua_contacts_stats(vm);
+  if(LUA_FIELD(fields, host_lua_field_flows))
+    Host::lua_blacklisted_flows(vm);
+
+  if(LUA_FIELD(fields, host_lua_field_contacts))
+    lua_contacts_stats(vm);
 
   /* *** */
-  
-  lua_push_int32_table_entry(vm, "local_network_id", local_network_id);
 
-  local_net = ntop->getLocalNetworkName(local_network_id);
+  if(LUA_FIELD(fields, host_lua_field_network)) {
+    lua_push_int32_table_entry(vm, "local_network_id", local_network_id);
 
-  if(local_net == NULL)
-    lua_push_nil_table_entry(vm, "local_network_name");
-  else
-    lua_push_str_table_entry(vm, "local_network_name", local_net);
+    local_net = ntop->getLocalNetworkName(local_network_id);
+
+    if(local_net == NULL)
+      lua_push_nil_table_entry(vm, "local_network_name");
+    else
+      lua_push_str_table_entry(vm, "local_network_name", local_net);
+  }
 
   if(asListElement) {
     host_id = get_hostkey(buf_id, sizeof(buf_id));
@@ -335,6 +483,10 @@ void LocalHost::lua_peers_stats(lua_State* vm) const {
 void LocalHost::lua_get_timeseries(lua_State* vm) {
   char buf_id[64], *host_id;
 
+  /* The first point must include the restored counters */
+  if(isRestorePending())
+    return;
+
   lua_newtable(vm);
 
   /* The timeseries point */
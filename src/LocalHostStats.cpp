@@ -319,6 +319,32 @@ void LocalHostStats::deserialize(json_object *o) {
 
 /* *************************************** */
 
+void LocalHostStats::getSnapshot(HostSnapshot *s) {
+  struct host_snapshot_hdr *h = s->get();
+
+  HostStats::getSnapshot(s);
+
+  if(dns)  dns->getSnapshot(h);
+  if(http) http->getSnapshot(h);
+
+  addRedisSitesKey();
+}
+
+/* *************************************** */
+
+void LocalHostStats::restoreSnapshot(const HostSnapshot *s) {
+  const struct host_snapshot_hdr *h = s->get();
+
+  removeRedisSitesKey();
+
+  HostStats::restoreSnapshot(s);
+
+  if(dns)  dns->restoreSnapshot(h);
+  if(http) http->restoreSnapshot(h);
+}
+
+/* *************************************** */
+
 void LocalHostStats::lua_get_timeseries(lua_State* vm) {
   luaStats(vm, iface, true /* host details */, true /* verbose */, true /* tsLua */);
 
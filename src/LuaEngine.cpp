@@ -139,9 +139,16 @@ LuaEngine::~LuaEngine() {
 	pthread_join(ctx->pkt_capture.captureThreadLoop, NULL);
       }
 
+      /* Waits for the packet thread to leave the capture before freeing it */
       if((ctx->iface != NULL) && ctx->live_capture.pcaphdr_sent)
 	ctx->iface->deregisterLiveCapture(ctx);
 
+      if(ctx->live_capture.bpfFilterSet)
+	pcap_freecode(&ctx->live_capture.fcode);
+
+      if(ctx->live_capture.ring)
+	delete ctx->live_capture.ring;
+
       if(ctx->addr_tree != NULL)
         delete ctx->addr_tree;
 
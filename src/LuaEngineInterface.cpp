@@ -580,6 +580,7 @@ static int ntop_interface_live_capture(lua_State* vm) {
   char *host = NULL;
   char *bpf = NULL;
   NetworkInterface *iface = getCurrentInterface(vm);
+  struct pcap_file_header pcaphdr;
 
   ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
 
@@ -646,13 +647,29 @@ static int ntop_interface_live_capture(lua_State* vm) {
       c->live_capture.bpfFilterSet = true;
   }
 
+  if(c->live_capture.ring == NULL) {
+    try {
+      c->live_capture.ring = new LiveCaptureRing(LIVE_CAPTURE_RING_SIZE,
+						 ntop->getGlobals()->getSnaplen(ntop_interface->get_name()));
+    } catch(...) {
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory for the live capture");
+      free(bpf);
+      return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+    }
+  }
+
+  /* The header is always sent even when no packet matches, as otherwise
+     some browsers (e.g. Safari 12) may end up in hanging */
+  Utils::init_pcap_header(&pcaphdr, ntop_interface->get_datalink(),
+			  ntop->getGlobals()->getSnaplen(ntop_interface->get_name()));
+  c->live_capture.ring->write(&pcaphdr, sizeof(pcaphdr));
+  c->live_capture.pcaphdr_sent = true;
+
   if(ntop_interface->registerLiveCapture(c, &capture_id)) {
     ntop->getTrace()->traceEvent(TRACE_INFO, "Starting live capture id %d", capture_id);
 
-    while(!c->live_capture.stopped) {
-      ntop->getTrace()->traceEvent(TRACE_INFO, "Capturing....");
-      sleep(1);
-    }
+    /* This thread streams the packets queued by the packet thread */
+    ntop_interface->streamLiveCapture(c);
 
     ntop->getTrace()->traceEvent(TRACE_INFO, "Capture completed");
   }
@@ -732,6 +749,59 @@ static int ntop_interface_reset_counters(lua_State* vm) {
 
 /* ****************************************** */
 
+/* interface.setPacketProfiler(enabled [, sampling_rate]) */
+static int ntop_interface_set_packet_profiler(lua_State* vm) {
+  NetworkInterface *ntop_interface = getCurrentInterface(vm);
+  u_int32_t rate = 0;
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(!ntop_interface) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  if(!ntop->isUserAdministrator(vm)) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TBOOLEAN) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(lua_type(vm, 2) == LUA_TNUMBER)
+    rate = (u_int32_t)lua_tonumber(vm, 2);
+
+  ntop_interface->getPacketProfiler()->enable(lua_toboolean(vm, 1) ? true : false, rate);
+
+  lua_pushnil(vm);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+static int ntop_interface_reset_packet_profiler(lua_State* vm) {
+  NetworkInterface *ntop_interface = getCurrentInterface(vm);
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(!ntop_interface) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  if(!ntop->isUserAdministrator(vm)) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  ntop_interface->getPacketProfiler()->reset();
+
+  lua_pushnil(vm);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+static int ntop_interface_get_packet_profiler(lua_State* vm) {
+  NetworkInterface *ntop_interface = getCurrentInterface(vm);
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(!ntop_interface) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  lua_newtable(vm);
+  ntop_interface->getPacketProfiler()->lua(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
 static int ntop_interface_reset_host_stats(lua_State* vm, bool delete_data) {
   NetworkInterface *ntop_interface = getCurrentInterface(vm);
   char buf[64], *host_ip;
@@ -1489,8 +1559,9 @@ static int ntop_get_batched_interface_hosts(lua_State* vm, LocationPolicy locati
 
 /* ****************************************** */
 
-static int ntop_get_interface_hosts(lua_State* vm, LocationPolicy location) {
+static int ntop_get_interface_hosts(lua_State* vm, LocationPolicy location, bool stream = false) {
   NetworkInterface *ntop_interface = getCurrentInterface(vm);
+  struct mg_connection *conn = getLuaVMUserdata(vm, conn);
   bool show_details = true, filtered_hosts = false, blacklisted_hosts = false;
   char *sortColumn = (char*)"column_ip", *country = NULL, *mac_filter = NULL;
   bool a2zSortOrder = true;
@@ -1504,6 +1575,7 @@ static int ntop_get_interface_hosts(lua_State* vm, LocationPolicy location) {
   int proto_filter = -1;
   u_int32_t toSkip = 0, maxHits = CONST_MAX_NUM_HITS;
   u_int32_t device_ip = 0;
+  u_int32_t lua_fields = HOST_LUA_ALL_FIELDS;
   u_int32_t begin_slot = 0;
   bool walk_all = true;
   bool hide_top_hidden = false;
@@ -1535,6 +1607,45 @@ static int ntop_get_interface_hosts(lua_State* vm, LocationPolicy location) {
   if(lua_type(vm,20) == LUA_TBOOLEAN) dhcpOnly             = lua_toboolean(vm, 20);
   if(lua_type(vm,21) == LUA_TSTRING)  cidr_filter.addAddress(lua_tostring(vm, 21)), cidr_filter_enabled = true;
   if(lua_type(vm,22) == LUA_TSTRING)  device_ip            = ntohl(inet_addr(lua_tostring(vm, 22)));
+  if(lua_type(vm,23) == LUA_TSTRING)  lua_fields           = Utils::str2HostLuaFields(lua_tostring(vm, 23));
+
+  if(stream) {
+    /* The answer is written to the connection: only the outcome is returned */
+    bool rc = false;
+
+    if((!ntop_interface) || (!conn))
+      return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+    try {
+      JSONStreamWriter writer(conn);
+
+      if(ntop_interface->getActiveHostsList(vm,
+					    &begin_slot, walk_all,
+					    0, /* bridge InterfaceId */
+					    get_allowed_nets(vm),
+					    show_details, location,
+					    country, mac_filter,
+					    vlan_filter, os_filter, asn_filter,
+					    network_filter, pool_filter, filtered_hosts, blacklisted_hosts, hide_top_hidden,
+					    ipver_filter, proto_filter,
+					    traffic_type_filter,
+					    device_ip, false /* host->lua */,
+					    anomalousOnly, dhcpOnly,
+					    cidr_filter_enabled ? &cidr_filter : NULL,
+					    sortColumn, maxHits,
+					    toSkip, a2zSortOrder, lua_fields, &writer) >= 0)
+	rc = true;
+      else
+	writer.null();
+
+      rc = writer.flush() && rc;
+    } catch(...) {
+      mg_printf(conn, "null"); /* Out of memory: nothing has been written */
+    }
+
+    lua_pushboolean(vm, rc);
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+  }
 
   if((!ntop_interface)
      || ntop_interface->getActiveHostsList(vm,
@@ -1551,7 +1662,7 @@ static int ntop_get_interface_hosts(lua_State* vm, LocationPolicy location) {
 					   anomalousOnly, dhcpOnly,
 					   cidr_filter_enabled ? &cidr_filter : NULL,
 					   sortColumn, maxHits,
-					   toSkip, a2zSortOrder) < 0)
+					   toSkip, a2zSortOrder, lua_fields) < 0)
     return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
 
   return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
@@ -2152,8 +2263,9 @@ static int ntop_get_interface_macs_manufacturers(lua_State* vm) {
 
 /* ****************************************** */
 
-static int ntop_get_interface_flows_info(lua_State* vm) {
+static int ntop_get_interface_flows(lua_State* vm, bool stream) {
   NetworkInterface *ntop_interface = getCurrentInterface(vm);
+  struct mg_connection *conn = getLuaVMUserdata(vm, conn);
   char buf[64];
   char *host_ip = NULL, *talking_with_ip = NULL;
   VLANid vlan_id = 0;
@@ -2162,7 +2274,7 @@ static int ntop_get_interface_flows_info(lua_State* vm) {
   u_int32_t begin_slot = 0;
   bool walk_all = true;
 
-  if(!ntop_interface)
+  if((!ntop_interface) || (stream && (!conn)))
     return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
 
   if((p = new(std::nothrow) Paginator()) == NULL)
@@ -2187,7 +2299,26 @@ static int ntop_get_interface_flows_info(lua_State* vm) {
 				   false /* Not an inline call */);
   }
 
-  if(ntop_interface
+  if(stream) {
+    /* The answer is written to the connection: only the outcome is returned */
+    bool rc = false;
+
+    try {
+      JSONStreamWriter writer(conn);
+
+      if((!host_ip || host)
+	 && (ntop_interface->getFlows(vm, &begin_slot, walk_all, get_allowed_nets(vm), host, talking_with_host, p, &writer) >= 0))
+	rc = true;
+      else
+	writer.null();
+
+      rc = writer.flush() && rc;
+    } catch(...) {
+      mg_printf(conn, "null"); /* Out of memory: nothing has been written */
+    }
+
+    lua_pushboolean(vm, rc);
+  } else if(ntop_interface
      && (!host_ip || host))
     ntop_interface->getFlows(vm, &begin_slot, walk_all, get_allowed_nets(vm), host, talking_with_host, p);
   else
@@ -2199,6 +2330,16 @@ static int ntop_get_interface_flows_info(lua_State* vm) {
 
 /* ****************************************** */
 
+static int ntop_get_interface_flows_info(lua_State* vm) {
+  return(ntop_get_interface_flows(vm, false));
+}
+
+static int ntop_stream_interface_flows_info(lua_State* vm) {
+  return(ntop_get_interface_flows(vm, true));
+}
+
+/* ****************************************** */
+
 static int ntop_get_batched_interface_flows_info(lua_State* vm) {
   NetworkInterface *ntop_interface = getCurrentInterface(vm);
   Paginator *p = NULL;
@@ -2817,6 +2958,29 @@ static int ntop_dump_local_hosts_2_redis(lua_State* vm) {
 
 /* ****************************************** */
 
+#ifndef WIN32
+
+/* Returns the checkpoint stats, nil on error */
+static int ntop_interface_save_checkpoint(lua_State* vm) {
+  NetworkInterface *ntop_interface = getCurrentInterface(vm);
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(!ntop->isUserAdministrator(vm)) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(!ntop_interface || ntop_interface->isView())
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(!ntop_interface->saveCheckpoint(vm))
+    lua_pushnil(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+#endif
+
+/* ****************************************** */
+
 static int ntop_get_interface_find_pid_flows(lua_State* vm) {
   NetworkInterface *ntop_interface = getCurrentInterface(vm);
   u_int32_t pid;
@@ -3350,6 +3514,22 @@ static int ntop_get_public_hosts_info(lua_State* vm) {
   return(ntop_get_interface_hosts(vm, location_public_only));
 }
 
+static int ntop_stream_interface_hosts_info(lua_State* vm) {
+  return(ntop_get_interface_hosts(vm, location_all, true));
+}
+
+static int ntop_stream_interface_local_hosts_info(lua_State* vm) {
+  return(ntop_get_interface_hosts(vm, location_local_only, true));
+}
+
+static int ntop_stream_interface_remote_hosts_info(lua_State* vm) {
+  return(ntop_get_interface_hosts(vm, location_remote_only, true));
+}
+
+static int ntop_stream_interface_broadcast_domain_hosts_info(lua_State* vm) {
+  return(ntop_get_interface_hosts(vm, location_broadcast_domain_only, true));
+}
+
 /* ****************************************** */
 
 static int ntop_get_batched_interface_hosts_info(lua_State* vm) {
@@ -4512,6 +4692,9 @@ static luaL_Reg _ntop_interface_reg[] = {
   { "updateDirectionStats",     ntop_update_interface_direction_stats },
   { "updateTopSites",           ntop_update_interface_top_sites},
   { "resetCounters",            ntop_interface_reset_counters },
+  { "setPacketProfiler",        ntop_interface_set_packet_profiler },
+  { "resetPacketProfiler",      ntop_interface_reset_packet_profiler },
+  { "getPacketProfiler",        ntop_interface_get_packet_profiler },
   { "resetHostStats",           ntop_interface_reset_host_stats },
   { "deleteHostData",           ntop_interface_delete_host_data },
   { "resetMacStats",            ntop_interface_reset_mac_stats },
@@ -4551,6 +4734,10 @@ static luaL_Reg _ntop_interface_reg[] = {
   { "getRemoteHostsInfo",       ntop_get_interface_remote_hosts_info },
   { "getBroadcastDomainHostsInfo", ntop_get_interface_broadcast_domain_hosts_info },
   { "getPublicHostsInfo",          ntop_get_public_hosts_info },
+  { "streamHostsInfo",             ntop_stream_interface_hosts_info },
+  { "streamLocalHostsInfo",        ntop_stream_interface_local_hosts_info },
+  { "streamRemoteHostsInfo",       ntop_stream_interface_remote_hosts_info },
+  { "streamBroadcastDomainHostsInfo", ntop_stream_interface_broadcast_domain_hosts_info },
   { "getBatchedFlowsInfo",         ntop_get_batched_interface_flows_info },
   { "getBatchedHostsInfo",         ntop_get_batched_interface_hosts_info },
   { "getBatchedLocalHostsInfo",    ntop_get_batched_interface_local_hosts_info },
@@ -4566,6 +4753,7 @@ static luaL_Reg _ntop_interface_reg[] = {
   { "restoreHost",              ntop_restore_interface_host             },
   { "checkpointHostTalker",     ntop_checkpoint_host_talker             },
   { "getFlowsInfo",             ntop_get_interface_flows_info           },
+  { "streamFlowsInfo",          ntop_stream_interface_flows_info        },
   { "getGroupedFlows",          ntop_get_interface_get_grouped_flows    },
   { "getFlowsStats",            ntop_get_interface_flows_stats          },
   { "getFlowKey",               ntop_get_interface_flow_key             },
@@ -4574,6 +4762,9 @@ static luaL_Reg _ntop_interface_reg[] = {
   { "findFlowByTuple",          ntop_get_interface_find_flow_by_tuple   },
   { "dropFlowTraffic",          ntop_drop_flow_traffic                  },
   { "dumpLocalHosts2redis",     ntop_dump_local_hosts_2_redis           },
+#ifndef WIN32
+  { "saveCheckpoint",           ntop_interface_save_checkpoint          },
+#endif
   { "dropMultipleFlowsTraffic", ntop_drop_multiple_flows_traffic        },
   { "findPidFlows",             ntop_get_interface_find_pid_flows       },
   { "findNameFlows",            ntop_get_interface_find_proc_name_flows },
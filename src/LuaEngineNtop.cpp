@@ -680,6 +680,87 @@ static int ntop_loadCustomCategoryHost(lua_State* vm) {
 
 /* ****************************************** */
 
+/* Whitelisted hosts ("!host") of the custom categories, skipped by ntop.loadCategoryListFile() */
+static int ntop_excludeCustomCategoryHost(lua_State* vm) {
+  char *host;
+  ndpi_protocol_category_t catid;
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  host = (char*)lua_tostring(vm, 1);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TNUMBER) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  catid = (ndpi_protocol_category_t)lua_tointeger(vm, 2);
+
+  lua_pushboolean(vm, ntop->nDPIExcludeCategoryHost(host, catid));
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/* Loads a whole list file natively, in place of the per-entry ntop.loadCustomCategoryIp/Host() */
+static int ntop_loadCategoryListFile(lua_State* vm) {
+  char *path, *listname, *format;
+  ndpi_protocol_category_t catid;
+  u_int32_t max_ips, max_hosts;
+  category_list_load_stats stats;
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  path = (char*)lua_tostring(vm, 1);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TNUMBER) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  catid = (ndpi_protocol_category_t)lua_tointeger(vm, 2);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 3, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  listname = (char*)lua_tostring(vm, 3);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 4, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+  format = (char*)lua_tostring(vm, 4);
+
+  max_ips = (lua_type(vm, 5) == LUA_TNUMBER) ? (u_int32_t)lua_tointeger(vm, 5) : (u_int32_t)-1;
+  max_hosts = (lua_type(vm, 6) == LUA_TNUMBER) ? (u_int32_t)lua_tointeger(vm, 6) : (u_int32_t)-1;
+
+  if(!ntop->nDPILoadCategoryFile(path, format, catid, listname, max_ips, max_hosts, &stats)) {
+    lua_pushnil(vm);
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+  }
+
+  lua_newtable(vm);
+  lua_push_uint64_table_entry(vm, "num_ips", stats.num_ips);
+  lua_push_uint64_table_entry(vm, "num_hosts", stats.num_hosts);
+  lua_push_uint64_table_entry(vm, "num_excluded", stats.num_excluded);
+  lua_push_uint64_table_entry(vm, "num_invalid", stats.num_invalid);
+  lua_push_bool_table_entry(vm, "limit_reached", stats.limit_reached);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+static int ntop_getCategoryDBStats(lua_State* vm) {
+  CategoryDB *db = ntop->getCategoryDB();
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(db) {
+    u_int num_ifaces = 0;
+
+    for(int i = 0; i < ntop->get_num_interfaces(); i++)
+      if(ntop->getInterface(i)) num_ifaces++;
+
+    db->lua(vm);
+    lua_push_uint64_table_entry(vm, "num_interfaces", num_ifaces);
+  } else
+    lua_pushnil(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
 /* NOTE: ntop.initnDPIReload() must be called before this */
 static int ntop_finalizenDPIReload(lua_State* vm) {
 
@@ -698,16 +779,14 @@ static int ntop_finalizenDPIReload(lua_State* vm) {
 
 static int ntop_match_custom_category(lua_State* vm) {
   char *host_to_match;
-  NetworkInterface *iface;
+  CategoryDB *db = ntop->getCategoryDB();
   ndpi_protocol_category_t match;
   ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
 
-  iface = ntop->getFirstInterface();
-
   if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
   host_to_match = (char*)lua_tostring(vm, 1);
 
-  if((!iface) || (ndpi_get_custom_category_match(iface->get_ndpi_struct(), host_to_match, strlen(host_to_match), &match) != 0))
+  if((!db) || !db->match(host_to_match, &match))
     lua_pushnil(vm);
   else
     lua_pushinteger(vm, (int)match);
@@ -789,6 +868,21 @@ static int ntop_get_flow_checks_stats(lua_State* vm) {
 
 /* ****************************************** */
 
+static int ntop_get_host_checks_stats(lua_State* vm) {
+  HostChecksLoader *hcl = ntop->getHostChecksLoader();
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if (hcl)
+    hcl->lua(vm);
+  else
+    lua_pushnil(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
 static int ntop_reload_flow_checks(lua_State* vm) {
   ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
 
@@ -1546,6 +1640,12 @@ static int ntop_reload_preferences(lua_State* vm) {
 
   ntop->getPrefs()->reloadPrefsFromRedis();
 
+  for(int i = 0; i < ntop->get_num_interfaces(); i++) {
+    NetworkInterface *iface = ntop->getInterface(i);
+
+    if(iface) iface->updateDissectionPrefs();
+  }
+
   lua_pushnil(vm);
   return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
 }
@@ -3699,6 +3799,84 @@ static int ntop_snmp_read_responses(lua_State* vm) {
 
 /* ****************************************** */
 
+#ifndef WIN32
+
+/* Adds (or refreshes) a device polled by the native SNMP poller */
+static int ntop_snmp_poller_set_device(lua_State* vm) {
+  SNMPPoller *poller = ntop->getSNMPPoller();
+  u_int32_t poll_interval = SNMP_POLLER_DEFAULT_INTERVAL, max_rps = SNMP_POLLER_DEFAULT_MAX_RPS;
+  bool rc;
+
+  if(!poller)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 3, LUA_TNUMBER) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  if(lua_type(vm, 4) == LUA_TNUMBER) poll_interval = (u_int32_t)lua_tonumber(vm, 4);
+  if(lua_type(vm, 5) == LUA_TNUMBER) max_rps = (u_int32_t)lua_tonumber(vm, 5);
+
+  rc = poller->setDevice(lua_tostring(vm, 1) /* agent */, lua_tostring(vm, 2) /* community */,
+			 (u_int8_t)lua_tonumber(vm, 3) /* version */, poll_interval, max_rps);
+
+  /* The device is kept: the next call retries starting the poller */
+  if(rc && !poller->start()) rc = false;
+
+  lua_pushboolean(vm, rc);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+static int ntop_snmp_poller_remove_device(lua_State* vm) {
+  SNMPPoller *poller = ntop->getSNMPPoller();
+
+  if(!poller)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  poller->removeDevice(lua_tostring(vm, 1));
+
+  lua_pushnil(vm);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/* Interface counter deltas of the devices polled after 'since' */
+static int ntop_snmp_poller_get_deltas(lua_State* vm) {
+  SNMPPoller *poller = ntop->getSNMPPoller();
+  const char *agent = NULL;
+  time_t since = 0;
+
+  if(!poller)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(lua_type(vm, 1) == LUA_TNUMBER) since = (time_t)lua_tonumber(vm, 1);
+  if(lua_type(vm, 2) == LUA_TSTRING) agent = lua_tostring(vm, 2);
+
+  poller->luaDeltas(vm, agent, since);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+static int ntop_snmp_poller_get_stats(lua_State* vm) {
+  SNMPPoller *poller = ntop->getSNMPPoller();
+
+  if(!poller)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  poller->lua(vm);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+#endif
+
+/* ****************************************** */
+
 #ifndef WIN32
 static int ntop_syslog(lua_State* vm) {
   char *msg;
@@ -5872,6 +6050,275 @@ static int ntop_rrd_fetch_columns(lua_State* vm) {
 
 /* ****************************************** */
 
+#ifndef WIN32
+
+/*
+ * Native timeseries store (TimeseriesStore), used by the "native" driver.
+ * Series are identified by a "tag=value,..." key, filters are keys with a
+ * subset of the tags.
+ *
+ * Positional parameters:
+ *    schema: schema name
+ *      step: schema step
+ *   counter: true for counters, false for gauges
+ *       key: series key
+ *      when: point time
+ *    values: the metric values, in the schema order
+ */
+static int ntop_ts_append(lua_State* vm) {
+  TimeseriesStore *store = ntop->getTimeseriesStore();
+  double values[TS_MAX_METRICS];
+  u_int8_t num_values = 0;
+
+  if(!store)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK)  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TNUMBER) != CONST_LUA_OK)  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 3, LUA_TBOOLEAN) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 4, LUA_TSTRING) != CONST_LUA_OK)  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 5, LUA_TNUMBER) != CONST_LUA_OK)  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 6, LUA_TTABLE) != CONST_LUA_OK)   return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  for(int i = 1; i <= TS_MAX_METRICS; i++) {
+    lua_rawgeti(vm, 6, i);
+
+    if(lua_type(vm, -1) != LUA_TNUMBER) {
+      lua_pop(vm, 1);
+      break;
+    }
+
+    values[num_values++] = (double)lua_tonumber(vm, -1);
+    lua_pop(vm, 1);
+  }
+
+  lua_pushboolean(vm, (num_values > 0)
+		  && store->append(lua_tostring(vm, 1), (u_int32_t)lua_tonumber(vm, 2), lua_toboolean(vm, 3) ? true : false,
+				   lua_tostring(vm, 4), (u_int32_t)lua_tonumber(vm, 5), values, num_values));
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/*
+ * Positional parameters:
+ *        schema: schema name
+ *        filter: series key or a subset of its tags (aggregated)
+ *  tstart, tend: time range
+ *    max_points: maximum number of points returned
+ *
+ * Returns {start, step, count, num_series, series = {metric values...}}, nil
+ * when there are no matching series. Counters are returned as rates.
+ */
+static int ntop_ts_query(lua_State* vm) {
+  TimeseriesStore *store = ntop->getTimeseriesStore();
+
+  if(!store)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  for(int i = 1; i <= 5; i++)
+    if(ntop_lua_check(vm, __FUNCTION__, i, (i <= 2) ? LUA_TSTRING : LUA_TNUMBER) != CONST_LUA_OK)
+      return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  if(!store->query(lua_tostring(vm, 1), lua_tostring(vm, 2), (u_int32_t)lua_tonumber(vm, 3),
+		   (u_int32_t)lua_tonumber(vm, 4), (u_int32_t)lua_tonumber(vm, 5), vm))
+    lua_pushnil(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/*
+ * As ntop_ts_query, with k (the number of top series) as last parameter.
+ *
+ * Returns {start, step, count, num_series, topk = {{key, value, partials}...},
+ * total}: the value and partials (by metric) are the totals in the range.
+ */
+static int ntop_ts_topk(lua_State* vm) {
+  TimeseriesStore *store = ntop->getTimeseriesStore();
+
+  if(!store)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  for(int i = 1; i <= 6; i++)
+    if(ntop_lua_check(vm, __FUNCTION__, i, (i <= 2) ? LUA_TSTRING : LUA_TNUMBER) != CONST_LUA_OK)
+      return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  if(!store->topk(lua_tostring(vm, 1), lua_tostring(vm, 2), (u_int32_t)lua_tonumber(vm, 3),
+		  (u_int32_t)lua_tonumber(vm, 4), (u_int32_t)lua_tonumber(vm, 5), (u_int32_t)lua_tonumber(vm, 6), vm))
+    lua_pushnil(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/* Keys of the series matching the filter (schema, filter) updated since start_time */
+static int ntop_ts_list_series(lua_State* vm) {
+  TimeseriesStore *store = ntop->getTimeseriesStore();
+
+  if(!store)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 3, LUA_TNUMBER) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  if(!store->listSeries(lua_tostring(vm, 1), lua_tostring(vm, 2), (u_int32_t)lua_tonumber(vm, 3), vm))
+    lua_pushnil(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/* Deletes the series matching the filter in the schemas starting with the prefix, returns their number */
+static int ntop_ts_delete(lua_State* vm) {
+  TimeseriesStore *store = ntop->getTimeseriesStore();
+
+  if(!store)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TSTRING) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  lua_pushinteger(vm, store->deleteSeries(lua_tostring(vm, 1), lua_tostring(vm, 2)));
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/* Deletes the data older than the retention (seconds) */
+static int ntop_ts_delete_old_data(lua_State* vm) {
+  TimeseriesStore *store = ntop->getTimeseriesStore();
+
+  if(!store)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TNUMBER) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  store->deleteOldData((u_int32_t)lua_tonumber(vm, 1));
+
+  lua_pushboolean(vm, true);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+static int ntop_ts_stats(lua_State* vm) {
+  TimeseriesStore *store = ntop->getTimeseriesStore();
+
+  if(!store)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  store->lua(vm);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+#endif
+
+/* ****************************************** */
+
+/*
+ * Updates the timeseries topk summaries (TimeseriesTopK) with a point.
+ *
+ * Positional parameters:
+ *    schema: schema name
+ *     group: "tag=value,..." of all the schema tags but the last one
+ *      item: value of the last tag
+ *      when: point time
+ *      step: schema step
+ *   counter: true for counters, false for gauges
+ *    values: the metric values, in the schema order
+ */
+static int ntop_ts_topk_update(lua_State* vm) {
+  TimeseriesTopK *topk = ntop->getTimeseriesTopK();
+  double values[TS_TOPK_MAX_METRICS];
+  u_int8_t num_values = 0;
+
+  if(!topk)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  for(int i = 1; i <= 3; i++)
+    if(ntop_lua_check(vm, __FUNCTION__, i, LUA_TSTRING) != CONST_LUA_OK)
+      return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  if(ntop_lua_check(vm, __FUNCTION__, 4, LUA_TNUMBER) != CONST_LUA_OK)  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 5, LUA_TNUMBER) != CONST_LUA_OK)  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 6, LUA_TBOOLEAN) != CONST_LUA_OK) return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+  if(ntop_lua_check(vm, __FUNCTION__, 7, LUA_TTABLE) != CONST_LUA_OK)   return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  for(int i = 1; i <= TS_TOPK_MAX_METRICS + 1; i++) {
+    lua_rawgeti(vm, 7, i);
+
+    if(lua_type(vm, -1) != LUA_TNUMBER) {
+      lua_pop(vm, 1);
+      break;
+    }
+
+    if(num_values == TS_TOPK_MAX_METRICS) {
+      /* Too many metrics: not summarized */
+      lua_pop(vm, 1);
+      lua_pushnil(vm);
+      return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+    }
+
+    values[num_values++] = (double)lua_tonumber(vm, -1);
+    lua_pop(vm, 1);
+  }
+
+  topk->update(lua_tostring(vm, 1), lua_tostring(vm, 2), lua_tostring(vm, 3), (u_int32_t)lua_tonumber(vm, 4),
+	       (u_int32_t)lua_tonumber(vm, 5), lua_toboolean(vm, 6) ? true : false, values, num_values);
+
+  lua_pushnil(vm);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+/*
+ * Positional parameters:
+ *        schema: schema name
+ *         group: as in ntop_ts_topk_update
+ *  tstart, tend: time range
+ *             k: number of top items
+ *
+ * Returns {start, step, count, topk = {{item, value, partials}...}, total},
+ * nil when the group is not summarized or the range is not covered.
+ */
+static int ntop_ts_topk_query(lua_State* vm) {
+  TimeseriesTopK *topk = ntop->getTimeseriesTopK();
+
+  if(!topk)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  for(int i = 1; i <= 5; i++)
+    if(ntop_lua_check(vm, __FUNCTION__, i, (i <= 2) ? LUA_TSTRING : LUA_TNUMBER) != CONST_LUA_OK)
+      return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_PARAM_ERROR));
+
+  if(!topk->query(lua_tostring(vm, 1), lua_tostring(vm, 2), (u_int32_t)lua_tonumber(vm, 3),
+		  (u_int32_t)lua_tonumber(vm, 4), (u_int32_t)lua_tonumber(vm, 5), vm))
+    lua_pushnil(vm);
+
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
+static int ntop_ts_topk_stats(lua_State* vm) {
+  TimeseriesTopK *topk = ntop->getTimeseriesTopK();
+
+  if(!topk)
+    return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_ERROR));
+
+  topk->lua(vm);
+  return(ntop_lua_return_value(vm, __FUNCTION__, CONST_LUA_OK));
+}
+
+/* ****************************************** */
+
 static int ntop_network_name_by_id(lua_State* vm) {
   int id;
   const char *name;
@@ -6495,6 +6942,20 @@ static luaL_Reg _ntop_reg[] = {
   { "rrd_tune",          ntop_rrd_tune          },
   { "rrd_inc_num_drops", ntop_rrd_inc_num_drops },
 
+#ifndef WIN32
+  /* Native timeseries */
+  { "ts_append",          ntop_ts_append          },
+  { "ts_query",           ntop_ts_query           },
+  { "ts_topk",            ntop_ts_topk            },
+  { "ts_list_series",     ntop_ts_list_series     },
+  { "ts_delete",          ntop_ts_delete          },
+  { "ts_delete_old_data", ntop_ts_delete_old_data },
+  { "ts_stats",           ntop_ts_stats           },
+#endif
+  { "ts_topk_update",     ntop_ts_topk_update     },
+  { "ts_topk_query",      ntop_ts_topk_query      },
+  { "ts_topk_stats",      ntop_ts_topk_stats      },
+
   /* Prefs */
   { "getPrefs",          ntop_get_prefs },
 
@@ -6592,6 +7053,14 @@ static luaL_Reg _ntop_reg[] = {
   { "snmpGetBatch",          ntop_snmp_batch_get             }, /* v1/v2c/v3 */
   { "snmpReadResponses",     ntop_snmp_read_responses        },
 
+#ifndef WIN32
+  /* Native interface counters poller */
+  { "snmpPollerSetDevice",    ntop_snmp_poller_set_device     },
+  { "snmpPollerRemoveDevice", ntop_snmp_poller_remove_device  },
+  { "snmpPollerGetDeltas",    ntop_snmp_poller_get_deltas     },
+  { "snmpPollerGetStats",     ntop_snmp_poller_get_stats      },
+#endif
+
   /* Runtime */
   { "hasGeoIP",                ntop_has_geoip                },
   { "isWindows",               ntop_is_windows               },
@@ -6605,6 +7074,9 @@ static luaL_Reg _ntop_reg[] = {
   { "finalizenDPIReload",         ntop_finalizenDPIReload },
   { "loadCustomCategoryIp",       ntop_loadCustomCategoryIp },
   { "loadCustomCategoryHost",     ntop_loadCustomCategoryHost },
+  { "excludeCustomCategoryHost",  ntop_excludeCustomCategoryHost },
+  { "loadCategoryListFile",       ntop_loadCategoryListFile },
+  { "getCategoryDBStats",         ntop_getCategoryDBStats },
   { "loadMaliciousJA3Signatures", ntop_loadMaliciousJA3Signatures },
 
   /* Privileges */
@@ -6628,6 +7100,7 @@ static luaL_Reg _ntop_reg[] = {
   { "reloadHostChecks",      ntop_reload_host_checks      },
   { "reloadAlertExclusions", ntop_reload_alert_exclusions },
   { "getFlowChecksStats",    ntop_get_flow_checks_stats   },
+  { "getHostChecksStats",    ntop_get_host_checks_stats   },
   { "getFlowAlertScore",     ntop_get_flow_alert_score    },
   { "getFlowAlertRisk",      ntop_get_flow_alert_risk     },
   { "getFlowRiskAlerts",     ntop_get_flow_risk_alerts    },
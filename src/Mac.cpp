@@ -67,7 +67,8 @@ Mac::Mac(NetworkInterface *_iface, u_int8_t _mac[6]) : GenericHashEntry(_iface)
 #endif
 
   if(!special_mac && ntop->getPrefs()->is_idle_local_host_cache_enabled()) {
-    deserializeFromRedis();
+    if(!iface->isLoadingCheckpoint())
+      deserializeFromRedis();
 
     // Load the user defined device type, if available
     snprintf(redis_key, sizeof(redis_key), MAC_CUSTOM_DEVICE_TYPE, mac_ptr);
@@ -236,6 +237,28 @@ void Mac::deserialize(json_object *o) {
 
 /* *************************************** */
 
+void Mac::getSnapshot(HostSnapshot *s) {
+  struct host_snapshot_hdr *h = s->get();
+
+  h->first_seen = first_seen, h->last_stats_reset = last_stats_reset;
+  memcpy(h->mac, mac, sizeof(h->mac));
+  stats->getTrafficSnapshot(s);
+}
+
+/* *************************************** */
+
+void Mac::restoreSnapshot(const HostSnapshot *s) {
+  const struct host_snapshot_hdr *h = s->get();
+
+  if(h->first_seen && ((time_t)h->first_seen < first_seen)) first_seen = h->first_seen;
+  last_stats_reset = h->last_stats_reset;
+  stats->restoreTrafficSnapshot(s);
+
+  checkStatsReset();
+}
+
+/* *************************************** */
+
 bool Mac::statsResetRequested() {
   return(stats_reset_requested || (last_stats_reset < ntop->getLastStatsReset()));
 }
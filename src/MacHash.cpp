@@ -42,9 +42,10 @@ Mac* MacHash::get(const u_int8_t mac[6], bool is_inline_call) {
       return(NULL);
     } else {
       Mac *head;
+      int epoch_slot = -1;
 
       if(!is_inline_call)
-	locks[hash]->rdlock(__FILE__, __LINE__);
+	epoch_slot = enterReadSection(hash);
 
       head = (Mac*)table[hash];
 
@@ -56,7 +57,7 @@ Mac* MacHash::get(const u_int8_t mac[6], bool is_inline_call) {
       }
 
       if(!is_inline_call)
-	locks[hash]->unlock(__FILE__, __LINE__);
+	exitReadSection(hash, epoch_slot);
 
       return(head);
     }
@@ -41,10 +41,24 @@ static void* queryLoop(void* ptr) {
 
 /* **************************************************** */
 
+static void* writerLoop(void* ptr) {
+  MySQLWriter *w = (MySQLWriter*)ptr;
+
+  Utils::setThreadName("MySQLWriter");
+  return(w->db->writerLoop(w));
+}
+
+/* **************************************************** */
+
 void* MySQLDB::queryLoop() {
-  Redis *r = ntop->getRedis();
-  char sql[CONST_MAX_SQL_QUERY_LEN];
-  bool queue_not_empty = false;
+  return(writerLoop(&writers[0]));
+}
+
+/* **************************************************** */
+
+void* MySQLDB::writerLoop(MySQLWriter *w) {
+  char *sql;
+  struct timeval last_flush;
 
   while(!ntop->getGlobals()->isShutdown()
 	&& !isDbCreated() /* wait until the db has been created */) {
@@ -54,23 +68,167 @@ void* MySQLDB::queryLoop() {
   if(ntop->getGlobals()->isShutdown())
     return(NULL);
 
-  while(isRunning() || queue_not_empty) {
-    int rc = r->lpop(CONST_SQL_QUEUE, sql, sizeof(sql));
+  if((sql = (char*)malloc(MYSQL_BATCH_MAX_QUERY_LEN)) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
+    return(NULL);
+  }
 
-    if(rc == 0) {
-      queue_not_empty = true;
-      try_exec_sql_query(&mysql, sql);
-    } else {
-      queue_not_empty = false;
-      _usleep(10000);
+  w->connected = connectToDB(&w->conn, true);
+  gettimeofday(&last_flush, NULL);
+
+  while(true) {
+    u_int32_t queued = batch_queue[0]->getLength() + batch_queue[1]->getLength();
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+
+    if(queued == 0) {
+      if(!isRunning()) break; /* Queues drained: we can leave */
+    } else if((queued >= MYSQL_BATCH_MAX_ROWS)
+	      || !isRunning()
+	      || (Utils::msTimevalDiff(&now, &last_flush) >= MYSQL_BATCH_MAX_DELAY_MSEC)) {
+      flushBatch(w, 0, sql, MYSQL_BATCH_MAX_QUERY_LEN);
+      flushBatch(w, 1, sql, MYSQL_BATCH_MAX_QUERY_LEN);
+      last_flush = now;
+      continue;
+    }
+
+    /* Wait until a batch is full or the batch delay expires */
+    {
+      struct timespec expire;
+      u_int64_t usec = now.tv_usec + MYSQL_BATCH_MAX_DELAY_MSEC * 1000;
+
+      expire.tv_sec = now.tv_sec + usec / 1000000, expire.tv_nsec = (usec % 1000000) * 1000;
+      batch_cond->timedWait(&expire);
     }
   }
 
+  if(w->connected) {
+    disconnectFromDB(&w->conn);
+    w->connected = false;
+  }
+
+  free(sql);
   return(NULL);
 }
 
 /* ******************************************* */
 
+/*
+  Dequeues up to MYSQL_BATCH_MAX_ROWS tuples and writes them in a single
+  transaction, as few multi-row INSERTs as the statement size allows.
+  Returns the number of flows dequeued.
+*/
+u_int32_t MySQLDB::flushBatch(MySQLWriter *w, u_int8_t ip_version_idx, char *sql, u_int sql_len) {
+  StringFifoQueue *q = batch_queue[ip_version_idx];
+  u_int32_t num_dequeued = 0, num_rows = 0, num_written = 0, num_in_stmt = 0;
+  bool use_transaction = !ntop->getPrefs()->useClickHouse(), ok = true;
+  u_int hdr_len, len;
+  char *values;
+
+  if(q->empty()) return(0);
+
+  hdr_len = len = snprintf(sql, sql_len, "INSERT INTO `%sv%u` " MYSQL_INSERT_FIELDS " VALUES ",
+			   ntop->getPrefs()->get_mysql_tablename(), ip_version_idx == 0 ? 4 : 6);
+
+  if(use_transaction)
+    ok = execBatch(w, "START TRANSACTION");
+
+  while((num_dequeued < MYSQL_BATCH_MAX_ROWS) && ((values = q->dequeue()) != NULL)) {
+    u_int values_len = strlen(values);
+
+    num_dequeued++;
+
+    if(hdr_len + values_len + 2 >= sql_len) {
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Tried to execute a query longer than %u. Skipping.", sql_len);
+      incNumDroppedFlows();
+      free(values);
+      continue;
+    }
+
+    if(len + values_len + 2 >= sql_len) {
+      /* Statement full: send it and start a new one within the same transaction */
+      if(ok && (ok = execBatch(w, sql))) num_written += num_in_stmt;
+      len = hdr_len, num_in_stmt = 0;
+    }
+
+    if(num_in_stmt > 0) sql[len++] = ',';
+    memcpy(&sql[len], values, values_len + 1), len += values_len;
+    num_in_stmt++, num_rows++;
+
+    free(values);
+  }
+
+  if(ok && (num_in_stmt > 0) && (ok = execBatch(w, sql)))
+    num_written += num_in_stmt;
+
+  if(use_transaction) {
+    if(ok)
+      ok = execBatch(w, "COMMIT");
+    else
+      execBatch(w, "ROLLBACK");
+
+    if(!ok) num_written = 0; /* Rolled back: the whole batch is lost */
+  }
+
+  if(!ok) num_failed_batches++;
+
+  if(num_written > 0) {
+    incNumExportedFlows(num_written);
+
+    num_batches++, num_batched_flows += num_written, last_batch_len = num_written;
+    if(num_written > max_batch_len) max_batch_len = num_written;
+  }
+
+  if(num_rows > num_written)
+    incNumDroppedFlows(num_rows - num_written);
+
+  return(num_dequeued);
+}
+
+/* ******************************************* */
+
+/*
+  Executes a statement on a writer connection. Statements are not retried
+  as a lost connection also loses the current transaction: the connection
+  is re-established when the next statement is executed.
+*/
+bool MySQLDB::execBatch(MySQLWriter *w, const char *sql) {
+  MYSQL_RES *result;
+
+  if(enable_db_traces)
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "[writer %u] %s", w->id, sql);
+
+  if(!w->connected) {
+    if(!(w->connected = connectToDB(&w->conn, true))) {
+      _usleep(100);
+      return(false);
+    }
+  }
+
+  if(mysql_query(&w->conn, sql) != 0) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "MySQL error: %s [writer %u]",
+				 get_last_db_error(&w->conn), w->id);
+
+    switch(mysql_errno(&w->conn)) {
+    case CR_SERVER_GONE_ERROR:
+    case CR_SERVER_LOST:
+      disconnectFromDB(&w->conn);
+      w->connected = false;
+      break;
+    }
+
+    return(false);
+  }
+
+  if((result = mysql_store_result(&w->conn)) != NULL)
+    mysql_free_result(result);
+
+  return(true);
+}
+
+/* ******************************************* */
+
 bool MySQLDB::createDBSchema() {
   char sql[CONST_MAX_SQL_QUERY_LEN];
 
@@ -450,6 +608,19 @@ MySQLDB::MySQLDB(NetworkInterface *_iface) : DB(_iface) {
   open_log();
   db_created = false;
 
+  for(int i = 0; i < 2; i++)
+    if((batch_queue[i] = new (std::nothrow) StringFifoQueue(CONST_MAX_MYSQL_QUEUE_LEN)) == NULL)
+      throw "Not enough memory";
+
+  if((batch_cond = new (std::nothrow) Condvar()) == NULL)
+    throw "Not enough memory";
+
+  for(int i = 0; i < MYSQL_NUM_WRITERS; i++)
+    writers[i].db = this, writers[i].id = i, writers[i].connected = false;
+
+  num_batches = num_batched_flows = 0;
+  max_batch_len = last_batch_len = num_failed_batches = 0;
+
   connectToDB(&mysql, false);
 }
 
@@ -459,6 +630,11 @@ MySQLDB::~MySQLDB() {
   shutdown();
   disconnectFromDB(&mysql);
 
+  for(int i = 0; i < 2; i++)
+    delete batch_queue[i];
+
+  delete batch_cond;
+
   if(log_fd) fclose(log_fd);
 }
 
@@ -499,6 +675,9 @@ bool MySQLDB::startQueryLoop() {
 
   pthread_create(&queryThreadLoop, NULL, ::queryLoop, (void*)this);
 
+  for(int i = 1; i < MYSQL_NUM_WRITERS; i++)
+    pthread_create(&writers[i].thread, NULL, ::writerLoop, (void*)&writers[i]);
+
   return(true);
 }
 
@@ -509,13 +688,36 @@ void MySQLDB::shutdown() {
     void *res;
 
     DB::shutdown();
-    
+    batch_cond->signalAll(); /* Writers drain the queues before leaving */
+
     pthread_join(queryThreadLoop, &res);
+
+    for(int i = 1; i < MYSQL_NUM_WRITERS; i++)
+      pthread_join(writers[i].thread, &res);
   }
 }
 
 /* ******************************************* */
 
+void MySQLDB::lua(lua_State *vm, bool since_last_checkpoint) const {
+  u_int64_t batches = num_batches;
+
+  DB::lua(vm, since_last_checkpoint);
+
+  if(since_last_checkpoint) return;
+
+  lua_push_uint64_table_entry(vm, "flow_export_batches", batches);
+  lua_push_uint64_table_entry(vm, "flow_export_failed_batches", num_failed_batches);
+  lua_push_uint64_table_entry(vm, "flow_export_avg_batch_len", batches ? (num_batched_flows / batches) : 0);
+  lua_push_uint64_table_entry(vm, "flow_export_max_batch_len", max_batch_len);
+  lua_push_uint64_table_entry(vm, "flow_export_last_batch_len", last_batch_len);
+  lua_push_uint64_table_entry(vm, "flow_export_queue_len",
+			      batch_queue[0]->getLength() + batch_queue[1]->getLength());
+  lua_push_uint64_table_entry(vm, "flow_export_writers", MYSQL_NUM_WRITERS);
+}
+
+/* ******************************************* */
+
 char* MySQLDB::escapeAphostrophes(const char *unescaped) {
   char *buf;
   int l, i, j;
@@ -650,41 +852,33 @@ void MySQLDB::try_exec_sql_query(MYSQL *conn, char *sql) {
 
 bool MySQLDB::dumpFlow(time_t when, Flow *f, char *json) {
   char sql[CONST_MAX_SQL_QUERY_LEN];
+  u_int8_t idx;
 
   if((f->get_cli_ip_addr() == NULL) || (f->get_srv_ip_addr() == NULL) || !MySQLDB::db_created)
     return(false);
 
-  if(f->get_cli_ip_addr()->isIPv4())
-    snprintf(sql, sizeof(sql), "INSERT INTO `%sv4` " MYSQL_INSERT_FIELDS " VALUES ",
-	     ntop->getPrefs()->get_mysql_tablename());
-  else
-    snprintf(sql, sizeof(sql), "INSERT INTO `%sv6` " MYSQL_INSERT_FIELDS " VALUES ",
-	     ntop->getPrefs()->get_mysql_tablename());
-
-  /* do the actual flow insertion as a tuple */
-  flow2InsertValues(f, json, &sql[strlen(sql)], sizeof(sql) - strlen(sql) - 1);
+  idx = f->get_cli_ip_addr()->isIPv4() ? 0 : 1;
 
   if (iface->read_from_pcap_dump()) {
     /*
      Inserting inline in case of PCAP file as interrupting the datapath
-     is not an issue and also avoids flows drops due to the redis queue
+     is not an issue and also avoids flows drops due to the queue
      maximum length
     */
+    snprintf(sql, sizeof(sql), "INSERT INTO `%sv%u` " MYSQL_INSERT_FIELDS " VALUES ",
+	     ntop->getPrefs()->get_mysql_tablename(), idx == 0 ? 4 : 6);
+
+    /* do the actual flow insertion as a tuple */
+    flow2InsertValues(f, json, &sql[strlen(sql)], sizeof(sql) - strlen(sql) - 1);
     try_exec_sql_query(&mysql, sql);
   } else {
-    if (ntop->getRedis()->llen(CONST_SQL_QUEUE) < CONST_MAX_MYSQL_QUEUE_LEN) {
-      /*
-       We know that we should have locked before evaluating the condition
-       above as another thread, via the lpush below, can invalidate the condition.
-       However, we prefer to avoid an additional lock as the lpush guarantees
-       that no more than CONST_MAX_MYSQL_QUEUE_LEN will ever be in the queue.
-       The drawback is that the counter mysqlDroppedFlows
-       is not guaranteed to be 100% accurate but we can tolerate this.
-      */
-      ntop->getRedis()->lpush(CONST_SQL_QUEUE, sql, CONST_MAX_MYSQL_QUEUE_LEN);
-    } else {
+    /* Only the tuple is queued: writers batch tuples into multi-row INSERTs */
+    flow2InsertValues(f, json, sql, sizeof(sql));
+
+    if(!batch_queue[idx]->enqueue(sql))
       incNumDroppedFlows();
-    }
+    else if(batch_queue[idx]->getLength() == MYSQL_BATCH_MAX_ROWS)
+      batch_cond->signal(); /* A batch is ready: don't wait for the timeout */
   }
 
   return(true);
@@ -938,7 +1132,7 @@ int MySQLDB::exec_sql_query(MYSQL *conn, const char *sql,
     ntop->getTrace()->traceEvent(TRACE_INFO, "Successfully executed '%s'", sql);
     // we want to return the number of rows which is more informative
     // than a simple 0
-    if((result = mysql_store_result(&mysql)) == NULL)
+    if((result = mysql_store_result(conn)) == NULL)
       rc = 0;  // unable to retrieve the result but still the query succeeded
     else {
       rc = mysql_num_rows(result);
@@ -230,6 +230,7 @@ NetworkInterface::NetworkInterface(const char *name,
   updateLbdIdentifier();
   updateDiscardProbingTraffic();
   updateFlowsOnlyInterface();
+  updateDissectionPrefs();
 }
 
 /* **************************************************** */
@@ -248,6 +249,7 @@ void NetworkInterface::init(const char *interface_name) {
     is_loopback = is_traffic_mirrored = false, lbd_serialize_by_mac = false,
     discard_probing_traffic = false;
     flows_only_interface = false;
+    memset(&dissect_prefs, 0, sizeof(dissect_prefs)), fast_decode = true;
     numSubInterfaces = 0;
     ip_reassignment_alerts_enabled = false;
     pcap_datalink_type = 0, mtuWarningShown = false,
@@ -259,7 +261,8 @@ void NetworkInterface::init(const char *interface_name) {
     has_too_many_hosts = has_too_many_flows = false,
     flow_dump_disabled = false,
     numL2Devices = 0, numHosts = 0, numLocalHosts = 0,
-    arp_requests = arp_replies = 0,
+    arp_requests = arp_replies = 0, num_fast_accounting_pkts = 0,
+    flow_fast_accounting_allowed = false,
     has_mac_addresses = false,
     checkpointPktCount = checkpointBytesCount = checkpointPktDropCount = checkpointDroppedAlertsCount = 0,
     checkpointDiscardedProbingPktCount = checkpointDiscardedProbingBytesCount = 0,
@@ -287,12 +290,20 @@ void NetworkInterface::init(const char *interface_name) {
   hosts_bcast_domain_last_update = 0;
   hosts_to_restore = new (std::nothrow) StringFifoQueue(64);
 
+  /* The thread is started by the first idle or new local host */
+  try {
+    host_serializer = new HostSerializer(this);
+  } catch(...) {
+    host_serializer = NULL;
+  }
+  loading_checkpoint = false;
+
   ip_addresses = "", networkStats = NULL,
     pcap_datalink_type = 0, cpu_affinity = -1;
   hide_from_top = hide_from_top_shadow = NULL;
 
   gettimeofday(&last_periodic_stats_update, NULL);
-  num_live_captures = 0;
+  num_live_captures = 0, live_captures_delivery = 0;
   num_host_dropped_alerts = num_flow_dropped_alerts = num_other_dropped_alerts = 0;
   num_written_alerts = num_alerts_queries = 0;
   score_as_cli = score_as_srv = 0;
@@ -422,7 +433,8 @@ struct ndpi_detection_module_struct* NetworkInterface::initnDPIStruct() {
 /* Operations are performed in the followin order:
  *
  * 1. initnDPIReload()
- * 2. ... nDPILoadIPCategory/nDPILoadHostnameCategory() ...
+ * 2. ... Ntop::nDPILoadIPCategory/nDPILoadHostnameCategory() ...
+ *    (category lists go to the CategoryDB shared by all the interfaces)
  * 3. finalizenDPIReload()
  * 4. cleanShadownDPI()
  */
@@ -511,32 +523,6 @@ void NetworkInterface::loadProtocolsAssociations(struct ndpi_detection_module_st
 
 /* *************************************** */
 
-bool NetworkInterface::nDPILoadIPCategory(char *what, ndpi_protocol_category_t id, char *list_name) {
-  bool success = true;
-
-  // ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s(%p) [%s]", __FUNCTION__, ndpi_struct_shadow, what);
-
-  if(what && ndpi_struct_shadow)
-    success = (ndpi_load_ip_category(ndpi_struct_shadow, what, id, (void*)list_name) == 0);
-
-  return success;
-}
-
-/* *************************************** */
-
-bool NetworkInterface::nDPILoadHostnameCategory(char *what, ndpi_protocol_category_t id, char *list_name /* NOT used */) {
-  bool success = true;
-
-  // ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s(%p) [%s]", __FUNCTION__, ndpi_struct_shadow, what);
-
-  if(what && ndpi_struct_shadow)
-    success = (ndpi_load_hostname_category(ndpi_struct_shadow, what, id) == 0);
-
-  return success;
-}
-
-/* *************************************** */
-
 int NetworkInterface::nDPILoadMaliciousJA3Signatures(const char *file_path) {
   int n = 0;
 
@@ -720,6 +706,19 @@ void NetworkInterface::updateFlowsOnlyInterface() {
   flows_only_interface = getInterfaceBooleanPref(CONST_FLOWS_ONLY_INTERFACE, CONST_DEFAULT_FLOWS_ONLY_INTERFACE);
 }
 
+/* **************************************** */
+
+/* Called on init and on preferences reload: saves dissectPacket a few calls per packet */
+void NetworkInterface::updateDissectionPrefs() {
+  Prefs *prefs = ntop->getPrefs();
+
+  dissect_prefs.decode_tunnels = ntop->getGlobals()->decode_tunnels();
+  dissect_prefs.ignore_vlans   = prefs->do_ignore_vlans();
+  dissect_prefs.simulate_vlans = prefs->do_simulate_vlans();
+  dissect_prefs.ignore_macs    = prefs->do_ignore_macs();
+  dissect_prefs.simulate_macs  = prefs->do_simulate_macs();
+}
+
 /* **************************************************** */
 
 bool NetworkInterface::checkIdle() {
@@ -803,6 +802,7 @@ NetworkInterface::~NetworkInterface() {
   if(ndpiStats)      delete ndpiStats;
   if(dscpStats)      delete dscpStats;
   if(hosts_to_restore) delete hosts_to_restore;
+  if(host_serializer) delete host_serializer;
   if(networkStats) {
     u_int16_t numNetworks = ntop->getNumLocalNetworks();
 
@@ -995,7 +995,7 @@ static bool local_hosts_2_redis_walker(GenericHashEntry *h, void *user_data, boo
   Host *host = (Host*)h;
 
   if(host && (host->isLocalHost() || host->isSystemHost())) {
-    ((LocalHost*)host)->serializeToRedis();
+    ((LocalHost*)host)->serializeSnapshot(false /* Still active */);
     *matched = true;
   }
 
@@ -1021,6 +1021,332 @@ int NetworkInterface::dumpLocalHosts2redis(bool disable_purge) {
 
 /* **************************************************** */
 
+#ifndef WIN32
+
+struct checkpoint_walker_info {
+  InterfaceCheckpoint *checkpoint;
+  HostSnapshot snapshot;
+  bool failed;
+};
+
+static bool host_checkpoint_walker(GenericHashEntry *he, void *user_data, bool *matched) {
+  struct checkpoint_walker_info *info = (struct checkpoint_walker_info*)user_data;
+  Host *h = (Host*)he;
+  IpAddress *ip = h->get_ip();
+
+  if(ip->getVersion() == 0)
+    return(false); /* L2 only */
+
+  info->snapshot.reset();
+  h->getSnapshot(&info->snapshot);
+
+  if(ip->isIPv4()) {
+    u_int32_t ipv4 = ip->get_ipv4();
+
+    info->failed = !info->checkpoint->write(checkpoint_record_host, &ipv4, sizeof(ipv4),
+					    h->get_vlan_id(), h->get_observation_point_id(), &info->snapshot);
+  } else
+    info->failed = !info->checkpoint->write(checkpoint_record_host, ip->get_ipv6(), sizeof(struct ndpi_in6_addr),
+					    h->get_vlan_id(), h->get_observation_point_id(), &info->snapshot);
+
+  *matched = true;
+
+  return(info->failed); /* false = keep on walking */
+}
+
+/* **************************************************** */
+
+static bool mac_checkpoint_walker(GenericHashEntry *he, void *user_data, bool *matched) {
+  struct checkpoint_walker_info *info = (struct checkpoint_walker_info*)user_data;
+  Mac *m = (Mac*)he;
+
+  if(m->isSpecialMac())
+    return(false);
+
+  info->snapshot.reset();
+  m->getSnapshot(&info->snapshot);
+  info->failed = !info->checkpoint->write(checkpoint_record_mac, m->get_mac(), 6, 0, 0, &info->snapshot);
+  *matched = true;
+
+  return(info->failed);
+}
+
+/* **************************************************** */
+
+static bool as_checkpoint_walker(GenericHashEntry *he, void *user_data, bool *matched) {
+  struct checkpoint_walker_info *info = (struct checkpoint_walker_info*)user_data;
+  AutonomousSystem *as = (AutonomousSystem*)he;
+  u_int32_t asn = as->get_asn();
+
+  info->snapshot.reset();
+  as->getSnapshot(&info->snapshot);
+  info->failed = !info->checkpoint->write(checkpoint_record_as, &asn, sizeof(asn), 0, 0, &info->snapshot);
+  *matched = true;
+
+  return(info->failed);
+}
+
+/* **************************************************** */
+
+/*
+  Writes the interface state to the checkpoint loaded on the next startup.
+  Called on shutdown, or from Lua while packets are processed: counters
+  are read as for the Lua calls.
+*/
+bool NetworkInterface::saveCheckpoint(lua_State *vm) {
+  InterfaceCheckpoint checkpoint(get_id());
+  struct checkpoint_walker_info info;
+  u_int64_t begin = Utils::getTimeNsec();
+  u_int32_t msec, begin_slot;
+  struct host_snapshot_hdr *h;
+
+  info.checkpoint = &checkpoint, info.failed = false;
+
+  if(!checkpoint.create())
+    return(false);
+
+  /* Interface: ingress as sent, egress as rcvd */
+  h = info.snapshot.get();
+  h->pkts[0]  = ethStats.getNumIngressPackets(), h->pkts[1]  = ethStats.getNumEgressPackets();
+  h->bytes[0] = ethStats.getNumIngressBytes(),   h->bytes[1] = ethStats.getNumEgressBytes();
+  h->tcp_retr[0] = tcpPacketStats.get_retr(), h->tcp_ooo[0] = tcpPacketStats.get_ooo();
+  h->tcp_lost[0] = tcpPacketStats.get_lost(), h->tcp_keepalive[0] = tcpPacketStats.get_keepalive();
+  if(ndpiStats) ndpiStats->getSnapshot(&info.snapshot);
+
+  info.failed = !checkpoint.write(checkpoint_record_iface, NULL, 0, 0, 0, &info.snapshot);
+
+  for(u_int16_t network_id = 0; (!info.failed) && (network_id < ntop->getNumLocalNetworks()); network_id++) {
+    NetworkStats *ns = getNetworkStats(network_id);
+    const char *name = ntop->getLocalNetworkName(network_id);
+
+    if(ns && name) {
+      info.snapshot.reset();
+      ns->getTrafficSnapshot(&info.snapshot);
+      info.failed = !checkpoint.write(checkpoint_record_network, name, (u_int8_t)min_val(strlen(name), (size_t)255), 0, 0, &info.snapshot);
+    }
+  }
+
+  if(!info.failed) begin_slot = 0, walker(&begin_slot, true /* walk_all */, walker_macs,  mac_checkpoint_walker,  &info);
+  if(!info.failed) begin_slot = 0, walker(&begin_slot, true /* walk_all */, walker_hosts, host_checkpoint_walker, &info);
+  if(!info.failed) begin_slot = 0, walker(&begin_slot, true /* walk_all */, walker_ases,  as_checkpoint_walker,   &info);
+
+  if(info.failed || !checkpoint.commit()) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to save the checkpoint of interface %s", get_description());
+    return(false);
+  }
+
+  msec = (u_int32_t)((Utils::getTimeNsec() - begin) / 1000000);
+
+  ntop->getTrace()->traceEvent(TRACE_NORMAL,
+			       "Checkpoint of interface %s saved [%u hosts][%u MACs][%u ASes][%u networks][%.1f MB][%u msec]",
+			       get_description(),
+			       checkpoint.getNumRecords(checkpoint_record_host),
+			       checkpoint.getNumRecords(checkpoint_record_mac),
+			       checkpoint.getNumRecords(checkpoint_record_as),
+			       checkpoint.getNumRecords(checkpoint_record_network),
+			       checkpoint.getNumBytes() / (1024. * 1024.), msec);
+
+  if(vm) {
+    lua_newtable(vm);
+    lua_push_uint64_table_entry(vm, "num_hosts",    checkpoint.getNumRecords(checkpoint_record_host));
+    lua_push_uint64_table_entry(vm, "num_macs",     checkpoint.getNumRecords(checkpoint_record_mac));
+    lua_push_uint64_table_entry(vm, "num_ases",     checkpoint.getNumRecords(checkpoint_record_as));
+    lua_push_uint64_table_entry(vm, "num_networks", checkpoint.getNumRecords(checkpoint_record_network));
+    lua_push_uint64_table_entry(vm, "bytes",        checkpoint.getNumBytes());
+    lua_push_uint64_table_entry(vm, "duration_ms",  msec);
+  }
+
+  return(true);
+}
+
+/* **************************************************** */
+
+/*
+  Called at startup before packet processing starts: entries are added
+  inline, and the local hosts cache is skipped for them as the checkpoint
+  is more recent. The time spent creating the hosts, which dominates the
+  load, is reported apart.
+*/
+bool NetworkInterface::loadCheckpoint(lua_State *vm) {
+  InterfaceCheckpoint checkpoint(get_id());
+  struct checkpoint_record r;
+  const u_int8_t *key;
+  HostSnapshot s;
+  u_int64_t begin = Utils::getTimeNsec(), hosts_nsec = 0;
+  u_int32_t num_loaded = 0, num_skipped = 0, num_hosts_loaded = 0, msec;
+  int rc;
+
+  if(!checkpoint.open(ntop->getPrefs()->get_local_host_cache_duration())) {
+    checkpoint.remove();
+    return(false);
+  }
+
+  loading_checkpoint = true;
+
+  while((rc = checkpoint.next(&r, &key, &s)) != -1) {
+    bool loaded;
+
+    if((rc == 1) && (r.type == checkpoint_record_host)) {
+      u_int64_t host_begin = Utils::getTimeNsec();
+
+      if((loaded = restoreCheckpointRecord(&r, key, &s)))
+	num_hosts_loaded++;
+
+      hosts_nsec += Utils::getTimeNsec() - host_begin;
+    } else
+      loaded = (rc == 1) && restoreCheckpointRecord(&r, key, &s);
+
+    if(loaded)
+      num_loaded++;
+    else
+      num_skipped++;
+  }
+
+  loading_checkpoint = false;
+  checkpoint.remove();
+
+  msec = (u_int32_t)((Utils::getTimeNsec() - begin) / 1000000);
+
+  ntop->getTrace()->traceEvent(TRACE_NORMAL,
+			       "Checkpoint of interface %s loaded [%u hosts][%u MACs][%u ASes][%u entries loaded][%u skipped][%.1f MB][%u msec]"
+			       "[hosts: %u msec, %.2f usec/host]",
+			       get_description(),
+			       checkpoint.getNumRecords(checkpoint_record_host),
+			       checkpoint.getNumRecords(checkpoint_record_mac),
+			       checkpoint.getNumRecords(checkpoint_record_as),
+			       num_loaded, num_skipped,
+			       checkpoint.getNumBytes() / (1024. * 1024.), msec,
+			       (u_int32_t)(hosts_nsec / 1000000),
+			       num_hosts_loaded ? (hosts_nsec / 1000.) / num_hosts_loaded : 0.);
+
+  if(vm) {
+    lua_newtable(vm);
+    lua_push_uint64_table_entry(vm, "num_hosts",         num_hosts_loaded);
+    lua_push_uint64_table_entry(vm, "num_loaded",        num_loaded);
+    lua_push_uint64_table_entry(vm, "num_skipped",       num_skipped);
+    lua_push_uint64_table_entry(vm, "bytes",             checkpoint.getNumBytes());
+    lua_push_uint64_table_entry(vm, "duration_ms",       msec);
+    lua_push_uint64_table_entry(vm, "hosts_duration_us", hosts_nsec / 1000);
+  }
+
+  return(true);
+}
+
+/* **************************************************** */
+
+bool NetworkInterface::restoreCheckpointRecord(const struct checkpoint_record *r, const u_int8_t *key, const HostSnapshot *s) {
+  const struct host_snapshot_hdr *h = s->get();
+
+  switch(r->type) {
+  case checkpoint_record_iface:
+    ethStats.incNumPackets(true, h->pkts[0]),  ethStats.incNumPackets(false, h->pkts[1]);
+    ethStats.incNumBytes(true, h->bytes[0]),   ethStats.incNumBytes(false, h->bytes[1]);
+    tcpPacketStats.incRetr(h->tcp_retr[0]), tcpPacketStats.incOOO(h->tcp_ooo[0]);
+    tcpPacketStats.incLost(h->tcp_lost[0]), tcpPacketStats.incKeepAlive(h->tcp_keepalive[0]);
+    if(ndpiStats) ndpiStats->restoreSnapshot(s);
+    return(true);
+
+  case checkpoint_record_network:
+    {
+      char name[256];
+      NetworkStats *ns;
+
+      memcpy(name, key, r->key_len), name[r->key_len] = '\0';
+
+      /* Networks may have changed in the meantime */
+      if((ns = getNetworkStats(ntop->getLocalNetworkId(name))) == NULL)
+	return(false);
+
+      ns->restoreTrafficSnapshot(s);
+    }
+    return(true);
+
+  case checkpoint_record_mac:
+    {
+      u_int8_t mac_bytes[6];
+      Mac *m;
+
+      if(r->key_len != sizeof(mac_bytes)) return(false);
+      memcpy(mac_bytes, key, sizeof(mac_bytes));
+
+      if((m = getMac(mac_bytes, true /* Create if not present */, true /* Inline call */)) == NULL)
+	return(false);
+
+      m->restoreSnapshot(s);
+    }
+    return(true);
+
+  case checkpoint_record_host:
+    {
+      IpAddress ip;
+      Mac *m = NULL;
+      Host *host;
+
+      if(r->key_len == sizeof(u_int32_t)) {
+	u_int32_t ipv4;
+
+	memcpy(&ipv4, key, sizeof(ipv4));
+	ip.set(ipv4);
+      } else if(r->key_len == sizeof(struct ndpi_in6_addr)) {
+	struct ndpi_in6_addr ipv6;
+
+	memcpy(&ipv6, key, sizeof(ipv6));
+	ip.set(&ipv6);
+      } else
+	return(false);
+
+      if((!hosts_hash->hasEmptyRoom())
+	 || hosts_hash->get(r->vlan_id, &ip, true /* Inline call */, r->observation_point_id))
+	return(false);
+
+      if(!Utils::isEmptyMac(h->mac)) {
+	u_int8_t mac_bytes[6];
+
+	memcpy(mac_bytes, h->mac, sizeof(mac_bytes));
+	m = getMac(mac_bytes, true /* Create if not present */, true /* Inline call */);
+      }
+
+      if(ip.isLocalHost() || ip.isLocalInterfaceAddress())
+	host = new (std::nothrow) LocalHost(this, m, r->vlan_id, r->observation_point_id, &ip);
+      else
+	host = new (std::nothrow) RemoteHost(this, m, r->vlan_id, r->observation_point_id, &ip);
+
+      if(!host)
+	return(false);
+
+      if(!hosts_hash->add(host, false /* Don't lock, packet processing is not started yet */)) {
+	delete host;
+	return(false);
+      }
+
+      host->restoreSnapshot(s);
+    }
+    return(true);
+
+  case checkpoint_record_as:
+    {
+      u_int32_t asn;
+      AutonomousSystem *as;
+
+      if(r->key_len != sizeof(asn)) return(false);
+      memcpy(&asn, key, sizeof(asn));
+
+      /* Created by the hosts above */
+      if((as = ases_hash->get(asn, true /* Inline call */)) == NULL)
+	return(false);
+
+      as->restoreSnapshot(s);
+    }
+    return(true);
+  }
+
+  return(false);
+}
+
+#endif /* WIN32 */
+
+/* **************************************************** */
+
 u_int32_t NetworkInterface::getHostsHashSize() {
   return(hosts_hash ? hosts_hash->getNumEntries() : 0);
 }
@@ -1416,7 +1742,7 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
   u_int16_t trusted_l4_packet_len;
   u_int8_t *l4, tcp_flags = 0, *payload = NULL;
   u_int8_t *ip;
-  bool is_fragment = false, new_flow;
+  bool is_fragment = false, new_flow, fast_accounted = false;
   bool pass_verdict = true;
   u_int16_t l4_len = 0, fragment_offset = 0;
 #ifndef HAVE_NEDGE
@@ -1690,6 +2016,7 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 #endif
 
   INTERFACE_PROFILING_SECTION_ENTER("NetworkInterface::processPacket: getFlow", 0);
+  pkt_profiler.mark(profiler_stage_decode);
 
  pre_get_flow:
   /* Updating Flow */
@@ -1700,6 +2027,7 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 		 l4_proto, &src2dst_direction, last_pkt_rcvd,
 		 last_pkt_rcvd, len_on_wire, &new_flow, true, eth->h_source, eth->h_dest /* Eth lvl, used just in view interfaces to add MAC */);
   INTERFACE_PROFILING_SECTION_EXIT(0);
+  pkt_profiler.mark(profiler_stage_flow_lookup);
 
   if(flow == NULL) {
     incStats(ingressPacket, when->tv_sec, iph ? ETHERTYPE_IP : ETHERTYPE_IPV6,
@@ -1732,6 +2060,17 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 
     flow->setTOS(tos, src2dst_direction);
 
+#ifndef HAVE_NEDGE
+    if(flow->isFastAccounting()
+       && (!is_fragment)
+       && flow->fastAccountingPacket(src2dst_direction, len_on_wire - encapsulation_overhead,
+				     trusted_payload_len, tcp_flags,
+				     tcph && (tcph->window == 0), when)) {
+      fast_accounted = true, num_fast_accounting_pkts++;
+      goto flow_accounted;
+    }
+#endif
+
     switch(l4_proto) {
     case IPPROTO_TCP:
       flow->updateTcpFlags(when, tcp_flags, src2dst_direction);
@@ -1798,6 +2137,9 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 #endif
   }
 
+#ifndef HAVE_NEDGE
+ flow_accounted:
+#endif
   /*
     In case of a traffic mirror with no MAC gateway address configured
     the traffic direction is set based on the local (-m) host
@@ -1827,8 +2169,10 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 
   /* Protocol Detection */
   flow->updateInterfaceLocalStats(src2dst_direction, 1, len_on_wire);
+  pkt_profiler.mark(profiler_stage_flow_update);
 
-  if(!flow->isDetectionCompleted() || flow->needsExtraDissection()) {
+  if((!fast_accounted)
+     && (!flow->isDetectionCompleted() || flow->needsExtraDissection())) {
     if((!is_fragment)
 #ifdef IMPLEMENT_SMART_FRAGMENTS
        || (fragment_offset == 0)
@@ -1841,8 +2185,16 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
     }
   }
 
+  pkt_profiler.mark(profiler_stage_detection);
+
   if(flow->isDetectionCompleted()
+     && (!fast_accounted)
      && (!isSampledTraffic())) {
+#ifndef HAVE_NEDGE
+    if(!flow->isFastAccounting())
+      flow->updateFastAccounting();
+#endif
+
     switch(ndpi_get_lower_proto(flow->get_detected_protocol())) {
     case NDPI_PROTOCOL_DHCP:
       if(*srcHost) {
@@ -2018,6 +2370,8 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 
   // ntop->getTrace()->traceEvent(TRACE_NORMAL, "direction: %s / len: %u", ingressPacket ? "IN" : "OUT", len_on_wire);
 
+  pkt_profiler.mark(profiler_stage_l7_dissection);
+
   incStats(ingressPacket, when->tv_sec, iph ? ETHERTYPE_IP : ETHERTYPE_IPV6,
 	   flow->getStatsProtocol(), flow->get_protocol_category(),
 	   l4_proto, len_on_wire, 1);
@@ -2040,6 +2394,8 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
     flow->periodic_stats_update(when);
   }
 
+  pkt_profiler.mark(profiler_stage_host_update);
+
   return(pass_verdict);
 }
 
@@ -2116,6 +2472,172 @@ u_int16_t NetworkInterface::guessEthType(const u_char *p, u_int len, u_int8_t *i
 
 /* **************************************************** */
 
+/*
+  Decodes the dominant encapsulations ([802.1Q] IPv4/IPv6 over Ethernet or
+  raw IP) in a single pass, with no tunnels to follow. Returns false for
+  anything else, which is left to the generic decoder of dissectPacket.
+ */
+template <int datalink>
+bool NetworkInterface::fastDecodePacket(const struct pcap_pkthdr *h, const u_char *packet,
+					u_int16_t *eth_type, u_int16_t *ip_offset, VLANid *vlan_id) const {
+  u_int16_t offset, type;
+  VLANid vlan = 0;
+  u_int8_t l4_proto;
+  u_int l4_offset;
+
+  if(datalink == DLT_EN10MB) {
+    if(h->caplen < sizeof(struct ndpi_ethhdr) + 4 /* 802.1Q */)
+      return(false);
+
+    offset = sizeof(struct ndpi_ethhdr);
+    type = (packet[12] << 8) + packet[13];
+
+    if(type == 0x8100 /* VLAN */) {
+      vlan = ((packet[14] << 8) + packet[15]) & 0xFFF;
+      type = (packet[16] << 8) + packet[17], offset += 4;
+    }
+  } else /* Raw IP */ {
+    if(h->caplen == 0)
+      return(false);
+
+    offset = 0;
+
+    switch(packet[0] >> 4) {
+    case 4:  type = ETHERTYPE_IP;   break;
+    case 6:  type = ETHERTYPE_IPV6; break;
+    default: return(false);
+    }
+  }
+
+  if(type == ETHERTYPE_IP) {
+    const struct ndpi_iphdr *iph = (const struct ndpi_iphdr *)&packet[offset];
+
+    if((h->caplen < offset + sizeof(struct ndpi_iphdr)) || (iph->version != 4) || (iph->ihl < 5))
+      return(false);
+
+    l4_proto = iph->protocol, l4_offset = offset + iph->ihl * 4;
+
+    if(dissect_prefs.decode_tunnels) {
+      if((l4_proto == IPPROTO_GRE) || (l4_proto == IPPROTO_IPV6))
+	return(false);
+
+      /* Tunnels over UDP are only decoded in the first fragment */
+      if((l4_proto == IPPROTO_UDP) && ((ntohs(iph->frag_off) & 0x3FFF /* IP_MF | IP_OFFSET */) != 0))
+	l4_proto = 0;
+    }
+  } else if(type == ETHERTYPE_IPV6) {
+    const struct ndpi_ipv6hdr *ip6 = (const struct ndpi_ipv6hdr *)&packet[offset];
+
+    if((h->caplen < offset + sizeof(struct ndpi_ipv6hdr))
+       || ((ntohl(ip6->ip6_hdr.ip6_un1_flow) & 0xF0000000) != 0x60000000))
+      return(false);
+
+    l4_proto = ip6->ip6_hdr.ip6_un1_nxt, l4_offset = offset + sizeof(struct ndpi_ipv6hdr);
+
+    if(l4_proto == 0x3C /* IPv6 destination option */)
+      return(false);
+
+    if(dissect_prefs.decode_tunnels
+       && ((l4_proto == IPPROTO_GRE) || (l4_proto == IPPROTO_IP_IN_IP)))
+      return(false);
+  } else
+    return(false);
+
+  if(dissect_prefs.decode_tunnels && (l4_proto == IPPROTO_UDP)) {
+    u_int16_t sport, dport;
+
+    if(h->caplen < l4_offset + sizeof(struct ndpi_udphdr))
+      return(false);
+
+    sport = (packet[l4_offset] << 8) + packet[l4_offset + 1];
+    dport = (packet[l4_offset + 2] << 8) + packet[l4_offset + 3];
+
+    /* Both byte orders: the generic IPv6 decoder matches CAPWAP on the raw ports */
+    if((sport == GTP_U_V1_PORT)    || (dport == GTP_U_V1_PORT)
+       || (sport == TZSP_PORT)     || (dport == TZSP_PORT)
+       || (dport == VXLAN_PORT)
+       || (sport == CAPWAP_DATA_PORT) || (dport == CAPWAP_DATA_PORT)
+       || (sport == ntohs(CAPWAP_DATA_PORT)) || (dport == ntohs(CAPWAP_DATA_PORT)))
+      return(false);
+  }
+
+  *eth_type = type, *ip_offset = offset, *vlan_id = vlan;
+
+  return(true);
+}
+
+/* **************************************************** */
+
+/* Setting traffic direction based on MAC */
+bool NetworkInterface::isIngressPacket(struct ndpi_ethhdr *ethernet, bool ingressPacket) {
+  if(ethernet) {
+    if(isTrafficMirrored()) {
+      /* Mirror */
+      if(isGwMac(ethernet->h_dest))
+        ingressPacket = false;
+    } else if(!areTrafficDirectionsSupported()) {
+      /* Interface with no direction info */
+      if(isInterfaceMac(ethernet->h_source))
+        ingressPacket = false;
+    }
+  }
+
+  return(ingressPacket);
+}
+
+/* **************************************************** */
+
+/* Common tail of the IPv4/IPv6 decoding: applies the VLAN/MAC preferences and processes the packet */
+bool NetworkInterface::processDecodedPacket(u_int32_t bridge_iface_idx, bool ingressPacket,
+					    const u_int64_t time, struct ndpi_ethhdr *ethernet,
+					    struct ndpi_ethhdr *dummy_ethernet, VLANid vlan_id,
+					    struct ndpi_iphdr *iph, struct ndpi_ipv6hdr *ip6,
+					    u_int16_t ip_offset, u_int16_t encapsulation_overhead,
+					    u_int32_t len_on_wire, const struct pcap_pkthdr *h,
+					    const u_char *packet, u_int16_t *ndpiProtocol,
+					    Host **srcHost, Host **dstHost, Flow **flow) {
+  bool pass_verdict = true;
+
+  if(vlan_id && dissect_prefs.ignore_vlans)
+    vlan_id = 0;
+  if((vlan_id == 0) && dissect_prefs.simulate_vlans)
+    vlan_id = (ip6 ? ip6->ip6_src.u6_addr.u6_addr8[15] +
+	       ip6->ip6_dst.u6_addr.u6_addr8[15] : iph->saddr + iph->daddr) % 0xFF;
+
+  if(dissect_prefs.ignore_macs)
+    ethernet = dummy_ethernet;
+  else if(unlikely(dissect_prefs.simulate_macs)) {
+    dummy_ethernet->h_source[0] = 0xb8, dummy_ethernet->h_source[1] = 0x27, dummy_ethernet->h_source[2] = 0xeb,
+      dummy_ethernet->h_source[3] = 0xfd, dummy_ethernet->h_source[4] = 0x8e, dummy_ethernet->h_source[5] = rand() % 8;
+    dummy_ethernet->h_dest[0] = 0xb8, dummy_ethernet->h_dest[1] = 0x27, dummy_ethernet->h_dest[2] = 0xeb,
+      dummy_ethernet->h_dest[3] = 0xfd, dummy_ethernet->h_dest[4] = 0x8e, dummy_ethernet->h_dest[5] = rand() % 8;
+    ethernet = dummy_ethernet;
+  }
+
+  try {
+    pass_verdict = processPacket(bridge_iface_idx,
+				 ingressPacket, &h->ts, time,
+				 ethernet,
+				 vlan_id, iph,
+				 ip6,
+				 ip_offset,
+				 encapsulation_overhead,
+				 len_on_wire,
+				 h, packet, ndpiProtocol, srcHost, dstHost, flow);
+  } catch(std::bad_alloc& ba) {
+    static bool oom_warning_sent = false;
+
+    if(!oom_warning_sent) {
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory");
+      oom_warning_sent = true;
+    }
+  }
+
+  return(pass_verdict);
+}
+
+/* **************************************************** */
+
 bool NetworkInterface::dissectPacket(u_int32_t bridge_iface_idx,
 				     bool ingressPacket,
 				     u_int8_t *sender_mac,
@@ -2161,8 +2683,46 @@ bool NetworkInterface::dissectPacket(u_int32_t bridge_iface_idx,
   setTimeLastPktRcvd(h->ts.tv_sec);
   purgeIdle(h->ts.tv_sec);
 
+  pkt_profiler.startPacket();
+
   time = ((uint64_t) h->ts.tv_sec) * 1000 + h->ts.tv_usec / 1000;
 
+  /* Fast path for the dominant encapsulations, specialized per datalink */
+  if(fast_decode) {
+    switch(pcap_datalink_type) {
+    case DLT_EN10MB:
+      if(fastDecodePacket<DLT_EN10MB>(h, packet, &eth_type, &ip_offset, &vlan_id))
+	ethernet = (struct ndpi_ethhdr *)packet;
+      break;
+
+#ifdef DLT_RAW
+    case DLT_RAW:
+      if(fastDecodePacket<DLT_RAW>(h, packet, &eth_type, &ip_offset, &vlan_id)) {
+	if(sender_mac) memcpy(&dummy_ethernet.h_source, sender_mac, 6);
+	ethernet = (struct ndpi_ethhdr *)&dummy_ethernet;
+      }
+      break;
+#endif
+    }
+  }
+
+  if(ethernet) {
+    ingressPacket = isIngressPacket(ethernet, ingressPacket);
+
+    if(eth_type == ETHERTYPE_IP)
+      pass_verdict = processDecodedPacket(bridge_iface_idx, ingressPacket, time, ethernet, &dummy_ethernet,
+					  vlan_id, (struct ndpi_iphdr *)&packet[ip_offset], NULL,
+					  ip_offset, 0, len_on_wire, h, packet,
+					  ndpiProtocol, srcHost, dstHost, flow);
+    else
+      pass_verdict = processDecodedPacket(bridge_iface_idx, ingressPacket, time, ethernet, &dummy_ethernet,
+					  vlan_id, NULL, (struct ndpi_ipv6hdr *)&packet[ip_offset],
+					  ip_offset, 0, len_on_wire, h, packet,
+					  ndpiProtocol, srcHost, dstHost, flow);
+
+    goto dissect_packet_end;
+  }
+
 datalink_check:
   if(pcap_datalink_type == DLT_NULL) {
     memcpy(&null_type, &packet[eth_offset], sizeof(u_int32_t));
@@ -2266,18 +2826,7 @@ datalink_check:
       break;
   }
 
-  /* Setting traffic direction based on MAC */
-  if(ethernet) {
-    if(isTrafficMirrored()) {
-      /* Mirror */
-      if(isGwMac(ethernet->h_dest))
-        ingressPacket = false;
-    } else if(!areTrafficDirectionsSupported()) {
-      /* Interface with no direction info */
-      if(isInterfaceMac(ethernet->h_source))
-        ingressPacket = false;
-    }
-  }
+  ingressPacket = isIngressPacket(ethernet, ingressPacket);
 
   switch(eth_type) {
   case ETHERTYPE_PPPoE:
@@ -2322,7 +2871,7 @@ datalink_check:
       } else
 	frag_off = ntohs(iph->frag_off);
 
-      if(ntop->getGlobals()->decode_tunnels() && (iph->protocol == IPPROTO_GRE)
+      if(dissect_prefs.decode_tunnels && (iph->protocol == IPPROTO_GRE)
 	 && ((frag_off & 0x3FFF /* IP_MF | IP_OFFSET */ ) == 0)
 	 && h->caplen >= ip_offset + ip_len + sizeof(struct grev1_header)) {
 	struct grev1_header gre;
@@ -2373,7 +2922,7 @@ datalink_check:
 	    /* Unknown encapsulation */
 	  }
 	}
-      } else if(ntop->getGlobals()->decode_tunnels()
+      } else if(dissect_prefs.decode_tunnels
 		&& iph->protocol == IPPROTO_IPV6
 		&& h->caplen >= ip_offset + ip_len + sizeof(struct ndpi_ipv6hdr)) {
 	/* Detunnel 6in4 tunnel */
@@ -2381,7 +2930,7 @@ datalink_check:
 	eth_type = ETHERTYPE_IPV6;
 	encapsulation_overhead = ip_offset;
 	goto decode_packet_eth;
-      } else if(ntop->getGlobals()->decode_tunnels() && (iph->protocol == IPPROTO_UDP)
+      } else if(dissect_prefs.decode_tunnels && (iph->protocol == IPPROTO_UDP)
 		&& ((frag_off & 0x3FFF /* IP_MF | IP_OFFSET */ ) == 0)) {
 	struct ndpi_udphdr *udp = (struct ndpi_udphdr *)&packet[ip_offset+ip_len];
 	u_int16_t sport = ntohs(udp->source), dport = ntohs(udp->dest);
@@ -2497,40 +3046,9 @@ datalink_check:
 	}
       }
 
-      if(vlan_id && ntop->getPrefs()->do_ignore_vlans())
-	vlan_id = 0;
-      if((vlan_id == 0) && ntop->getPrefs()->do_simulate_vlans())
-	vlan_id = (ip6 ? ip6->ip6_src.u6_addr.u6_addr8[15] +
-		   ip6->ip6_dst.u6_addr.u6_addr8[15] : iph->saddr + iph->daddr) % 0xFF;
-
-      if(ntop->getPrefs()->do_ignore_macs())
-	ethernet = &dummy_ethernet;
-      else if(unlikely(ntop->getPrefs()->do_simulate_macs())) {
-	dummy_ethernet.h_source[0] = 0xb8, dummy_ethernet.h_source[1] = 0x27, dummy_ethernet.h_source[2] = 0xeb,
-	  dummy_ethernet.h_source[3] = 0xfd, dummy_ethernet.h_source[4] = 0x8e, dummy_ethernet.h_source[5] = rand() % 8;
-	dummy_ethernet.h_dest[0] = 0xb8, dummy_ethernet.h_dest[1] = 0x27, dummy_ethernet.h_dest[2] = 0xeb,
-	  dummy_ethernet.h_dest[3] = 0xfd, dummy_ethernet.h_dest[4] = 0x8e, dummy_ethernet.h_dest[5] = rand() % 8;
-	ethernet = &dummy_ethernet;
-      }
-
-      try {
-	pass_verdict = processPacket(bridge_iface_idx,
-				     ingressPacket, &h->ts, time,
-				     ethernet,
-				     vlan_id, iph,
-				     ip6,
-				     ip_offset,
-				     encapsulation_overhead,
-				     len_on_wire,
-				     h, packet, ndpiProtocol, srcHost, dstHost, flow);
-      } catch(std::bad_alloc& ba) {
-	static bool oom_warning_sent = false;
-
-	if(!oom_warning_sent) {
-	  ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory");
-	  oom_warning_sent = true;
-	}
-      }
+      pass_verdict = processDecodedPacket(bridge_iface_idx, ingressPacket, time, ethernet, &dummy_ethernet,
+					  vlan_id, iph, ip6, ip_offset, encapsulation_overhead,
+					  len_on_wire, h, packet, ndpiProtocol, srcHost, dstHost, flow);
     }
     break;
 
@@ -2555,7 +3073,7 @@ datalink_check:
 	  ipv6_shift = 8 * (options[1] + 1);
 	}
 
-	if(ntop->getGlobals()->decode_tunnels() && (l4_proto == IPPROTO_GRE)
+	if(dissect_prefs.decode_tunnels && (l4_proto == IPPROTO_GRE)
 	   && h->caplen >= ip_offset + ipv6_shift + sizeof(struct grev1_header)) {
 	  struct grev1_header gre;
 	  u_int offset = ip_offset + ipv6_shift + sizeof(struct grev1_header);
@@ -2593,7 +3111,7 @@ datalink_check:
 	      /* Unknown encapsulation */
 	    }
 	  }
-	} else if(ntop->getGlobals()->decode_tunnels() && (l4_proto == IPPROTO_UDP)) {
+	} else if(dissect_prefs.decode_tunnels && (l4_proto == IPPROTO_UDP)) {
 	  // ip_offset += ipv6_shift;
 	  if((ip_offset + ipv6_shift) >= h->len) {
 	    incStats(ingressPacket, h->ts.tv_sec, ETHERTYPE_IPV6,
@@ -2646,45 +3164,22 @@ datalink_check:
 	      goto dissect_packet_end;
 	    }
 	  }
-	} else if(ntop->getGlobals()->decode_tunnels() && (l4_proto == IPPROTO_IP_IN_IP)) {
+	} else if(dissect_prefs.decode_tunnels && (l4_proto == IPPROTO_IP_IN_IP)) {
 	  eth_type = ETHERTYPE_IP;
 	  ip_offset += sizeof(struct ndpi_ipv6hdr);
 	  encapsulation_overhead = ip_offset;
 	  goto decode_packet_eth;
 	}
 
-	if(vlan_id && ntop->getPrefs()->do_ignore_vlans())
-	  vlan_id = 0;
-	if((vlan_id == 0) && ntop->getPrefs()->do_simulate_vlans())
-	  vlan_id = (ip6 ? ip6->ip6_src.u6_addr.u6_addr8[15] + ip6->ip6_dst.u6_addr.u6_addr8[15] : iph->saddr + iph->daddr) % 0xFF;
-
-	if(ntop->getPrefs()->do_ignore_macs())
-	  ethernet = &dummy_ethernet;
-
-	try {
-	  pass_verdict = processPacket(bridge_iface_idx,
-				       ingressPacket, &h->ts, time,
-				       ethernet,
-				       vlan_id,
-				       iph, ip6,
-				       ip_offset,
-				       encapsulation_overhead,
-				       len_on_wire,
-				       h, packet, ndpiProtocol, srcHost, dstHost, flow);
-	} catch(std::bad_alloc& ba) {
-	  static bool oom_warning_sent = false;
-
-	  if(!oom_warning_sent) {
-	    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory");
-	    oom_warning_sent = true;
-	  }
-	}
+	pass_verdict = processDecodedPacket(bridge_iface_idx, ingressPacket, time, ethernet, &dummy_ethernet,
+					    vlan_id, iph, ip6, ip_offset, encapsulation_overhead,
+					    len_on_wire, h, packet, ndpiProtocol, srcHost, dstHost, flow);
       }
     }
     break;
 
   default: /* No IPv4 nor IPv6 */
-    if(ntop->getPrefs()->do_ignore_macs())
+    if(dissect_prefs.ignore_macs)
       ethernet = &dummy_ethernet;
 
     Mac *srcMac = getMac(ethernet->h_source, true /* Create if missing */, true /* Inline call */);
@@ -3266,9 +3761,33 @@ void NetworkInterface::shutdown() {
     if(flowAlertsDequeueLoopCreated) pthread_join(flowChecksLoop, &res);
     if(hostAlertsDequeueLoopCreated) pthread_join(hostChecksLoop, &res);
 
+    /*
+      Hosts still waiting for their cached record skip their write
+      (LocalHost::serializeSnapshot): add it before the final purge
+    */
+    if(host_serializer && hosts_hash) {
+      host_restore *r;
+
+      host_serializer->stop();
+
+      while(((r = host_serializer->dequeueRestored()) != NULL)
+	    || ((r = host_serializer->readPendingRestore()) != NULL))
+	restoreLocalHost(r);
+    }
+
+#ifndef WIN32
+    /* Before the purge below, which marks everything as idle */
+    if(ntop->getPrefs()->is_warm_restart_checkpoint_enabled()
+       && (!isView()) && (!isSubInterface()) && (id != SYSTEM_INTERFACE_ID))
+      saveCheckpoint();
+#endif
+
     /* purgeIdle one last time to make sure all entries will be marked as idle */
     purgeIdle(time(NULL), true, true);
 
+    /* Write the hosts serialized by the purge above */
+    if(host_serializer) host_serializer->shutdown();
+
     /* Make sure all alerts have been dequeued and processed */
     dequeueFlowAlertsFromChecks(0 /* unlimited budget */),
       dequeueHostAlertsFromChecks(0 /* unlimited budged */);
@@ -4205,9 +4724,6 @@ static bool flow_matches(Flow *f, struct flowHostRetriever *retriever) {
   VLANid vlan_id = 0;
   u_int16_t cli_pool, srv_pool, pool_filter;
   AlertLevelGroup flow_status_severity_filter = alert_level_group_none;
-  ndpi_patricia_node_t *srv_target_node = NULL, *cli_target_node = NULL;
-  IpAddress *cli_ip = (IpAddress *) f->get_srv_ip_addr();
-  IpAddress *srv_ip = (IpAddress *) f->get_cli_ip_addr();
   u_int16_t alert_type_filter;
   u_int8_t ip_version;
   u_int8_t l4_protocol;
@@ -4215,7 +4731,7 @@ static bool flow_matches(Flow *f, struct flowHostRetriever *retriever) {
   LocationPolicy client_policy;
   LocationPolicy server_policy;
   TcpFlowStateFilter tcp_flow_state_filter;
-  bool unicast, unidirectional, alerted_flows, cli_pool_found = false, srv_pool_found = false;
+  bool unicast, unidirectional, alerted_flows, cli_pool_found, srv_pool_found;
   u_int32_t asn_filter;
   char* username_filter;
   char* pidname_filter;
@@ -4477,20 +4993,15 @@ static bool flow_matches(Flow *f, struct flowHostRetriever *retriever) {
 			    && !f->get_srv_ip_addr()->isBroadcastAddress()))))
       return(false);
 
-    if(cli_ip && !f->get_cli_host())
-      cli_pool_found = f->getInterface()->getHostPools()->findIpPool(cli_ip, f->get_vlan_id(), &cli_pool, &cli_target_node);
-
-    if(srv_ip && !f->get_srv_host())
-      srv_pool_found = f->getInterface()->getHostPools()->findIpPool(srv_ip, f->get_vlan_id(), &srv_pool, &srv_target_node);
-
     /* Pool filter */
-    if(retriever->pag
-       && retriever->pag->poolFilter(&pool_filter)
-       && !((f->get_cli_host() && f->get_cli_host()->get_host_pool() == pool_filter)
-	    || (f->get_srv_host() && f->get_srv_host()->get_host_pool() == pool_filter))
-       && !((cli_pool_found && cli_pool == pool_filter)
-	    || (srv_pool_found && srv_pool == pool_filter)))
-      return(false);
+    if(retriever->pag && retriever->pag->poolFilter(&pool_filter)) {
+      /* Hosts are null on flow-only and view interfaces: the pools of their IpAddress are cached on the flow */
+      f->getPeerPools(&cli_pool, &cli_pool_found, &srv_pool, &srv_pool_found);
+
+      if(!((cli_pool_found && (cli_pool == pool_filter))
+	   || (srv_pool_found && (srv_pool == pool_filter))))
+	return(false);
+    }
 
     /* Mac filter - NOTE: must stay below the vlan_id filter */
     if(retriever->pag
@@ -5257,10 +5768,12 @@ int NetworkInterface::getFlows(lua_State* vm,
 			       AddressTree *allowed_hosts,
 			       Host *host,
 			       Host *talking_with_host,
-			       Paginator *p) {
+			       Paginator *p,
+			       JSONStreamWriter *writer) {
   struct flowHostRetriever retriever;
   char sortColumn[32];
   DetailsLevel highDetails;
+  int i, num, step;
 
   if(p == NULL) {
     ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to return results with a NULL paginator");
@@ -5284,41 +5797,50 @@ int NetworkInterface::getFlows(lua_State* vm,
     return(-1);
   }
 
-  lua_newtable(vm);
-  lua_push_uint64_table_entry(vm, "numFlows", retriever.actNumEntries);
-  lua_push_uint64_table_entry(vm, "nextSlot", *begin_slot);
-
-  lua_newtable(vm);
-
-  if(p->a2zSortOrder()) {
-    for(int i=p->toSkip(), num=0; i<(int)retriever.actNumEntries; i++) {
-      lua_newtable(vm);
+  if(writer) {
+    writer->beginObject();
+    writer->key("numFlows"), writer->uint64(retriever.actNumEntries);
+    writer->key("nextSlot"), writer->uint64(*begin_slot);
+    writer->key("flows"), writer->beginArray();
+  } else {
+    lua_newtable(vm);
+    lua_push_uint64_table_entry(vm, "numFlows", retriever.actNumEntries);
+    lua_push_uint64_table_entry(vm, "nextSlot", *begin_slot);
 
-      retriever.elems[i].flow->lua(vm, allowed_hosts, highDetails, true);
+    lua_newtable(vm);
+  }
 
-      lua_pushinteger(vm, num + 1);
-      lua_insert(vm, -2);
-      lua_settable(vm, -3);
+  if(p->a2zSortOrder())
+    i = p->toSkip(), step = 1;
+  else
+    i = retriever.actNumEntries-1-p->toSkip(), step = -1;
 
-      if(++num >= (int)p->maxHits()) break;
-    }
-  } else {
-    for(int i=(retriever.actNumEntries-1-p->toSkip()), num=0; i>=0; i--) {
-      lua_newtable(vm);
+  for(num=0; (i >= 0) && (i < (int)retriever.actNumEntries); i += step) {
+    lua_newtable(vm);
 
-      retriever.elems[i].flow->lua(vm, allowed_hosts, highDetails, true);
+    retriever.elems[i].flow->lua(vm, allowed_hosts, highDetails, true, p->luaFields());
 
+    if(writer) {
+      /* One row at a time: the table is garbage as soon as it's encoded */
+      writer->luaValue(vm, -1);
+      lua_pop(vm, 1);
+    } else {
       lua_pushinteger(vm, num + 1);
       lua_insert(vm, -2);
       lua_settable(vm, -3);
-
-      if(++num >= (int)p->maxHits()) break;
     }
+
+    if(++num >= (int)p->maxHits()) break;
   }
 
-  lua_pushstring(vm, "flows");
-  lua_insert(vm, -2);
-  lua_settable(vm, -3);
+  if(writer) {
+    writer->endArray();
+    writer->endObject();
+  } else {
+    lua_pushstring(vm, "flows");
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
 
   if(retriever.elems) free(retriever.elems);
 
@@ -5757,7 +6279,9 @@ int NetworkInterface::getActiveHostsList(lua_State* vm,
 					 bool tsLua, bool anomalousOnly, bool dhcpOnly,
 					 const AddressTree * const cidr_filter,
 					 char *sortColumn, u_int32_t maxHits,
-					 u_int32_t toSkip, bool a2zSortOrder) {
+					 u_int32_t toSkip, bool a2zSortOrder,
+					 u_int32_t lua_fields,
+					 JSONStreamWriter *writer) {
   struct flowHostRetriever retriever;
 
 #if DEBUG
@@ -5789,39 +6313,67 @@ int NetworkInterface::getActiveHostsList(lua_State* vm,
 				 __FUNCTION__, *begin_slot, retriever.actNumEntries);
 #endif
 
-  lua_newtable(vm);
-  lua_push_uint64_table_entry(vm, "numHosts", retriever.actNumEntries);
-  lua_push_uint64_table_entry(vm, "nextSlot", *begin_slot);
+  if(writer) {
+    writer->beginObject();
+    writer->key("numHosts"), writer->uint64(retriever.actNumEntries);
+    writer->key("nextSlot"), writer->uint64(*begin_slot);
+    writer->key("hosts"), writer->beginObject();
+  } else {
+    lua_newtable(vm);
+    lua_push_uint64_table_entry(vm, "numHosts", retriever.actNumEntries);
+    lua_push_uint64_table_entry(vm, "nextSlot", *begin_slot);
 
-  lua_newtable(vm);
+    lua_newtable(vm);
+  }
 
-  if(a2zSortOrder) {
-    for(int i = toSkip, num=0; i<(int)retriever.actNumEntries && num < (int)maxHits; i++, num++) {
-      Host *h = retriever.elems[i].hostValue;
+  for(int i = (a2zSortOrder ? (int)toSkip : (int)(retriever.actNumEntries-1-toSkip)), num=0;
+      i >= 0 && i < (int)retriever.actNumEntries && num < (int)maxHits;
+      i += (a2zSortOrder ? 1 : -1), num++) {
+    Host *h = retriever.elems[i].hostValue;
 
-      if(h != NULL) {
-	if(!tsLua)
-	  h->lua(vm, NULL /* Already checked */, host_details, false, false, true);
-	else
-	  h->lua_get_timeseries(vm);
-      }
-    }
-  } else {
-    for(int i = (retriever.actNumEntries-1-toSkip), num=0; i >= 0 && num < (int)maxHits; i--, num++) {
-      Host *h = retriever.elems[i].hostValue;
+    if(h == NULL)
+      continue;
+    else if(writer) {
+      /*
+	Same layout as the table below, one host at a time: the host is added
+	to a table of its own (hostkey -> host) that is then streamed
+      */
+      int top = lua_gettop(vm);
 
-      if(h != NULL) {
-	if(!tsLua)
-	  h->lua(vm, NULL /* Already checked */, host_details, false, false, true);
-	else
-	  h->lua_get_timeseries(vm);
+      lua_newtable(vm);
+
+      if(!tsLua)
+	h->lua(vm, NULL /* Already checked */, host_details, false, false, true, lua_fields);
+      else
+	h->lua_get_timeseries(vm);
+
+      lua_settop(vm, top + 1); /* Host::lua_get_timeseries pushes nil */
+
+      lua_pushnil(vm);
+      while(lua_next(vm, top + 1) != 0) {
+	if(lua_type(vm, -2) == LUA_TSTRING) {
+	  writer->key(lua_tostring(vm, -2));
+	  writer->luaValue(vm, -1);
+	}
+
+	lua_pop(vm, 1);
       }
-    }
+
+      lua_settop(vm, top);
+    } else if(!tsLua)
+      h->lua(vm, NULL /* Already checked */, host_details, false, false, true, lua_fields);
+    else
+      h->lua_get_timeseries(vm);
   }
 
-  lua_pushstring(vm, "hosts");
-  lua_insert(vm, -2);
-  lua_settable(vm, -3);
+  if(writer) {
+    writer->endObject();
+    writer->endObject();
+  } else {
+    lua_pushstring(vm, "hosts");
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
 
   for(u_int i=0; i<retriever.actNumEntries; i++) {
     if(retriever.elems[i].hostValue)
@@ -6005,6 +6557,7 @@ void NetworkInterface::reloadFlowChecks(FlowChecksLoader *fcbl) {
   if(prev_flow_checks_executor) delete prev_flow_checks_executor;
   prev_flow_checks_executor = flow_checks_executor;
   flow_checks_executor = fce;
+  flow_fast_accounting_allowed = !fce->needsPacketData();
 }
 
 /* **************************************************** */
@@ -6395,6 +6948,9 @@ void NetworkInterface::lua(lua_State *vm) {
   lua_push_uint64_table_entry(vm, "devices",      getNumL2Devices());
   lua_push_uint64_table_entry(vm, "current_macs", getNumMacs());
   lua_push_uint64_table_entry(vm, "num_live_captures", num_live_captures);
+  lua_push_uint64_table_entry(vm, "fast_accounting_packets", num_fast_accounting_pkts);
+  lua_push_float_table_entry(vm, "fast_accounting_pct",
+			     getNumPackets() ? ((float)(num_fast_accounting_pkts * 100) / getNumPackets()) : 0);
   lua_push_float_table_entry(vm, "throughput_bps", bytes_thpt.getThpt());
   lua_push_uint64_table_entry(vm, "throughput_trend_bps", bytes_thpt.getTrend());
   lua_push_float_table_entry(vm, "throughput_pps", pkts_thpt.getThpt());
@@ -6436,11 +6992,14 @@ void NetworkInterface::lua(lua_State *vm) {
 
   bcast_domains->lua(vm);
 
+  if(host_serializer) host_serializer->lua(vm);
+
   if(top_sites && ntop->getPrefs()->are_top_talkers_enabled())
     top_sites->lua(vm, (char *) "sites", (char *) "sites.old");
 
   luaAnomalies(vm);
   luaScore(vm);
+  pkt_profiler.lua(vm);
 
   sumStats(&_tcpFlowStats, &_ethStats, &_localStats,
 	   &_ndpiStats, &_pktStats, &_tcpPacketStats, &_discardedProbingStats,
@@ -8534,7 +9093,8 @@ bool NetworkInterface::registerLiveCapture(struct ntopngLuaContext * const luact
 
 /* *************************************** */
 
-bool NetworkInterface::deregisterLiveCapture(struct ntopngLuaContext * const luactx) {
+/* Called by the packet thread, that can no longer reach the capture once removed */
+bool NetworkInterface::removeLiveCapture(struct ntopngLuaContext * const luactx) {
   bool ret = false;
 
   active_captures_lock.lock(__FILE__, __LINE__);
@@ -8557,6 +9117,29 @@ bool NetworkInterface::deregisterLiveCapture(struct ntopngLuaContext * const lua
 
 /* *************************************** */
 
+/*
+  Called by the other threads before freeing the capture (e.g., its ring):
+  the packet thread reads live_captures[] without locking, so it may still
+  be delivering to the capture. Waits until the delivery in progress, if any,
+  is over, as the next ones won't find the capture anymore.
+*/
+bool NetworkInterface::deregisterLiveCapture(struct ntopngLuaContext * const luactx) {
+  bool ret = removeLiveCapture(luactx);
+  u_int64_t delivery;
+
+  /* The removal must be visible before the delivery counter is read */
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if((delivery = live_captures_delivery) & 1) {
+    while(live_captures_delivery == delivery)
+      _usleep(100);
+  }
+
+  return(ret);
+}
+
+/* *************************************** */
+
 bool NetworkInterface::matchLiveCapture(struct ntopngLuaContext * const luactx,
 					const struct pcap_pkthdr * const h,
 					const u_char * const packet,
@@ -8581,142 +9164,83 @@ bool NetworkInterface::matchLiveCapture(struct ntopngLuaContext * const luactx,
 
 void NetworkInterface::deliverLiveCapture(const struct pcap_pkthdr * const h,
 					  const u_char * const packet, Flow * const f) {
-  int res;
+  /* Packets are only copied into the capture rings: see streamLiveCapture() */
+  live_captures_delivery++; /* Odd: see deregisterLiveCapture() */
 
   for(u_int i=0, num_found = 0; (i<MAX_NUM_PCAP_CAPTURES)
 	&& (num_found < num_live_captures); i++) {
     if(live_captures[i] != NULL) {
       struct ntopngLuaContext *c = (struct ntopngLuaContext *)live_captures[i];
-      bool http_client_disconnected = false;
-      int disconnect_stage = 0;
 
       num_found++;
 
-      if((c->live_capture.capture_until < h->ts.tv_sec) || c->live_capture.stopped)
-	http_client_disconnected = true, disconnect_stage = 1;
-
-#ifdef TRACE_DOWNLOAD
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "%d seconds left", c->live_capture.capture_until - h->ts.tv_sec);
-#endif
-
-      /* The header is always sent even when there is never a match with matchLiveCapture,
-         as otherwise some browsers may end up in hanging. Hanging has been
-         verified with Safari Version 12.0 (13606.2.11)
-	 but not with Chrome Version 68.0.3440.106 (Official Build) (64-bit) */
-      if(!http_client_disconnected
-	 && c->conn
-	 && !c->live_capture.pcaphdr_sent) {
-	struct pcap_file_header pcaphdr;
-
-	Utils::init_pcap_header(&pcaphdr, get_datalink(), ntop->getGlobals()->getSnaplen(get_name()));
-
-	if((res = mg_write_async(c->conn, &pcaphdr, sizeof(pcaphdr))) < (int)sizeof(pcaphdr))
-	  http_client_disconnected = true, disconnect_stage = 2;
-
-	c->live_capture.pcaphdr_sent = true;
+      if((c->live_capture.capture_until < h->ts.tv_sec) || c->live_capture.stopped) {
+	ntop->getTrace()->traceEvent(TRACE_INFO, "Live capture completed or stopped");
+	removeLiveCapture(c);
+	continue;
       }
 
-      if(!http_client_disconnected
-	 && c->conn
-	 && matchLiveCapture(c, h, packet, f)) {
-	struct pcap_disk_pkthdr *pkthdr; /* Cannot use h as the format on disk differs */
-
-	if(c->live_capture.data_not_yet_sent_len > 0) {
-	  /* We have some leftover from the previous send,
-	     so let's try to send this data first
-	  */
-
-#ifdef TRACE_DOWNLOAD
-	  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Resending data [%u bytes left]", c->live_capture.data_not_yet_sent_len);
-#endif
-
-	  res = mg_write_async(c->conn, c->live_capture.send_buffer, c->live_capture.data_not_yet_sent_len);
+      if(matchLiveCapture(c, h, packet, f)
+	 && c->live_capture.ring->enqueue(h, packet) /* Counted as dropped when full */
+	 && (++c->live_capture.num_captured_packets == c->live_capture.capture_max_pkts))
+	removeLiveCapture(c);
+    }
+  }
 
-	  if(res > 0) {
-	    if(res == (int)c->live_capture.data_not_yet_sent_len) {
-	      c->live_capture.data_not_yet_sent_len = 0; /* We've sent everything that was in queue */
-	    } else {
-	      u_int leftover = c->live_capture.data_not_yet_sent_len - res;
+  live_captures_delivery++;
+}
 
-	      memmove(c->live_capture.send_buffer, &c->live_capture.send_buffer[res], leftover);
+/* *************************************** */
 
-	      c->live_capture.data_not_yet_sent_len = leftover;
+/* Sends the capture to the client until the capture is over: called by the HTTP thread of the capture */
+void NetworkInterface::streamLiveCapture(struct ntopngLuaContext * const luactx) {
+  LiveCaptureRing *ring = luactx->live_capture.ring;
+  time_t drain_until = 0;
 
-#ifdef TRACE_DOWNLOAD
-	      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Partial send [%u bytes left]", c->live_capture.data_not_yet_sent_len);
-#endif
-	      return; /* The current packet is dropped */
-	    }
-	  }
+  while(true) {
+    /* Read before draining to send all the captured packets */
+    bool done = luactx->live_capture.stopped || (time(NULL) > luactx->live_capture.capture_until);
+    bool progress = false;
+    const u_char *data;
+    u_int32_t len;
+    int res;
+
+    while((len = ring->peek(&data)) > 0) {
+      res = mg_write_async(luactx->conn, data, len);
+
+      if(res > 0)
+	ring->consume(res), progress = true;
+
+      if((res <= 0) || ((u_int32_t)res < len)) {
+	if((res <= 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+	  ntop->getTrace()->traceEvent(TRACE_INFO, "Client disconnected, stopping live capture");
+	  deregisterLiveCapture(luactx);
+	  return;
 	}
 
-	/* If we're here all the previous data has been sent out */
-	pkthdr = (struct pcap_disk_pkthdr*)c->live_capture.send_buffer;
-
-	pkthdr->ts.tv_sec = h->ts.tv_sec, pkthdr->ts.tv_usec = h->ts.tv_usec,
-	  pkthdr->caplen = ndpi_min(h->caplen, sizeof(c->live_capture.send_buffer)-sizeof(struct pcap_disk_pkthdr)),
-	  pkthdr->len = h->len;
-
-	memcpy(&c->live_capture.send_buffer[sizeof(struct pcap_disk_pkthdr)],
-	       packet, pkthdr->caplen);
-	c->live_capture.data_not_yet_sent_len = pkthdr->caplen + sizeof(struct pcap_disk_pkthdr);
-
-	/* Now send data */
-#ifdef TRACE_DOWNLOAD
-	ntop->getTrace()->traceEvent(TRACE_NORMAL, "About to send %u bytes [%d sec left]",
-				     c->live_capture.data_not_yet_sent_len,
-				     c->live_capture.capture_until - h->ts.tv_sec);
-#endif
-
-	res = mg_write_async(c->conn, &c->live_capture.send_buffer, c->live_capture.data_not_yet_sent_len);
-
-#ifdef TRACE_DOWNLOAD
-	ntop->getTrace()->traceEvent(TRACE_NORMAL, "Sent %d / %u bytes", res, c->live_capture.data_not_yet_sent_len);
-#endif
-
-	if(res == (int)c->live_capture.data_not_yet_sent_len) {
-	  c->live_capture.data_not_yet_sent_len = 0; /* All sent */
-
-	  c->live_capture.num_captured_packets++;
-
-	  if((c->live_capture.capture_max_pkts != 0)
-	     && (c->live_capture.num_captured_packets == c->live_capture.capture_max_pkts)) {
-	    http_client_disconnected = true, disconnect_stage = 4;
-	  }
-	} else if(res >= 0) {
-#ifdef TRACE_DOWNLOAD
-	  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Partial send: %u bytes sent", res);
-#endif
-
-	  if(res > 0) {
-	    /* Some data has been sent */
-	    u_int leftover = c->live_capture.data_not_yet_sent_len - res;
-
-	    memmove(c->live_capture.send_buffer, &c->live_capture.send_buffer[res], leftover);
-
-	    c->live_capture.data_not_yet_sent_len = leftover;
-
-#ifdef TRACE_DOWNLOAD
-	    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Partial send [%u bytes left]", c->live_capture.data_not_yet_sent_len);
-#endif
-	  }
-
-	  return; /* The current packet is dropped */
-	} else {
-	  /* An error occurred */
-	  http_client_disconnected = true, disconnect_stage = 3;
-	}
+	break; /* Socket busy: the ring keeps the data meanwhile */
       }
+    }
 
-      if(http_client_disconnected) {
-	ntop->getTrace()->traceEvent(TRACE_INFO,
-				     "Client disconnected or socket for live capture is busy, stopping capture (%d)",
-				     disconnect_stage);
-
-	deregisterLiveCapture(c); /* (*) */
-      }
+    if(done) {
+      if(ring->isEmpty())
+	break;
+      else if(drain_until == 0)
+	drain_until = time(NULL) + LIVE_CAPTURE_DRAIN_TIMEOUT;
+      else if(time(NULL) > drain_until)
+	break; /* Client too slow */
     }
+
+    if(!progress) /* Nothing to send or socket full */
+      _usleep(LIVE_CAPTURE_POLL_USEC);
   }
+
+  deregisterLiveCapture(luactx); /* In case the packet thread hasn't done it yet */
+
+  if(ring->getNumDroppedPackets() > 0)
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Live capture completed [%llu packets, %llu dropped]",
+				 (unsigned long long)ring->getNumEnqueuedPackets(),
+				 (unsigned long long)ring->getNumDroppedPackets());
 }
 
 /* *************************************** */
@@ -8740,6 +9264,10 @@ void NetworkInterface::dumpLiveCaptures(lua_State* vm) {
 			       live_captures[i]->live_capture.capture_max_pkts);
       lua_push_uint64_table_entry(vm, "num_captured_packets",
 			       live_captures[i]->live_capture.num_captured_packets);
+      lua_push_uint64_table_entry(vm, "num_dropped_packets",
+			       live_captures[i]->live_capture.ring->getNumDroppedPackets());
+      lua_push_uint64_table_entry(vm, "num_pending_bytes",
+			       live_captures[i]->live_capture.ring->getNumPendingBytes());
 
       if(live_captures[i]->live_capture.matching_host != NULL) {
 	Host *h = (Host*)live_captures[i]->live_capture.matching_host;
@@ -8772,9 +9300,8 @@ bool NetworkInterface::stopLiveCapture(int capture_id) {
     if(live_captures[capture_id] != NULL) {
       struct ntopngLuaContext *c = (struct ntopngLuaContext *)live_captures[capture_id];
 
+      /* The filter is freed with the capture, once the packet thread no longer uses it */
       c->live_capture.stopped = true, rc = true;
-      if(c->live_capture.bpfFilterSet)
-	pcap_freecode(&c->live_capture.fcode);
       /* live_captures[capture_id] = NULL; */ /* <-- not necessary as mongoose will clean it */
     }
 
@@ -9485,12 +10012,33 @@ void NetworkInterface::processExternalAlertable(AlertEntity entity,
 
 /* *************************************** */
 
+/* Adds a record read by the HostSerializer to its host, then frees it */
+void NetworkInterface::restoreLocalHost(host_restore *r) {
+  Host *h = hosts_hash->get(r->vlan_id, &r->ip, true /* inline call */, r->observation_point_id);
+
+  /* The host might have gone in the meantime */
+  if(!(h && h->isLocalHost() && ((LocalHost*)h)->restore(r)))
+    host_serializer->incApplied(true /* stale */);
+
+  HostSerializer::freeRestore(r);
+}
+
+/* *************************************** */
+
 void NetworkInterface::checkHostsToRestore() {
   int i = 0;
 
   if(!hosts_hash)
     return;
 
+  /* Local hosts whose cached record has been read by the HostSerializer */
+  if(host_serializer) {
+    host_restore *r;
+
+    for(i = 0; (i < HOST_SERIALIZER_MAX_RESTORES) && ((r = host_serializer->dequeueRestored()) != NULL); i++)
+      restoreLocalHost(r);
+  }
+
   /* Restore at maximum 5 hosts per run */
   for(i = 0; (i < 5) && hosts_hash->hasEmptyRoom(); i++) {
     char *ip, *d;
@@ -9679,7 +10227,12 @@ HostCheck *NetworkInterface::getCheck(HostCheckID t) {
 
 void NetworkInterface::execProtocolDetectedChecks(Flow *f) {
   if(flow_checks_executor) {
+    bool prof = pkt_profiler.sample(profiler_stage_flow_checks);
+    ticks begin = prof ? Utils::getticks() : 0;
     FlowAlert *alert = flow_checks_executor->execChecks(f, flow_check_protocol_detected);
+
+    if(prof) pkt_profiler.record(profiler_stage_flow_checks, Utils::getticks() - begin);
+
     if(alert)
       enqueueFlowAlert(alert);
   }
@@ -9689,7 +10242,12 @@ void NetworkInterface::execProtocolDetectedChecks(Flow *f) {
 
 void NetworkInterface::execPeriodicUpdateChecks(Flow *f) {
   if(flow_checks_executor) {
+    bool prof = pkt_profiler.sample(profiler_stage_flow_checks);
+    ticks begin = prof ? Utils::getticks() : 0;
     FlowAlert *alert = flow_checks_executor->execChecks(f, flow_check_periodic_update);
+
+    if(prof) pkt_profiler.record(profiler_stage_flow_checks, Utils::getticks() - begin);
+
     if(alert)
       enqueueFlowAlert(alert);
   }
@@ -9699,7 +10257,12 @@ void NetworkInterface::execPeriodicUpdateChecks(Flow *f) {
 
 void NetworkInterface::execFlowEndChecks(Flow *f) {
   if(flow_checks_executor) {
+    bool prof = pkt_profiler.sample(profiler_stage_flow_checks);
+    ticks begin = prof ? Utils::getticks() : 0;
     FlowAlert *alert = flow_checks_executor->execChecks(f, flow_check_flow_end);
+
+    if(prof) pkt_profiler.record(profiler_stage_flow_checks, Utils::getticks() - begin);
+
     if(alert)
       enqueueFlowAlert(alert);
   }
@@ -9754,8 +10317,14 @@ void NetworkInterface::luaAnomalies(lua_State *vm) {
 /* *************************************** */
 
 void NetworkInterface::execHostChecks(Host *h) {
-  if(host_checks_executor)
+  if(host_checks_executor) {
+    bool prof = pkt_profiler.sample(profiler_stage_host_checks);
+    ticks begin = prof ? Utils::getticks() : 0;
+
     host_checks_executor->execChecks(h);
+
+    if(prof) pkt_profiler.record(profiler_stage_host_checks, Utils::getticks() - begin);
+  }
 }
 
 /* *************************************** */
@@ -56,6 +56,7 @@ Ntop::Ntop(const char *appName) {
   ntop = this;
   globals = new (std::nothrow) NtopGlobals();
   extract = new (std::nothrow) TimelineExtract();
+  ts_topk = new (std::nothrow) TimeseriesTopK();
   address = new (std::nothrow) AddressResolution();
   offline = false;
   pa = NULL;
@@ -100,8 +101,11 @@ Ntop::Ntop(const char *appName) {
   cpu_load = 0;
   system_interface = NULL;
   purgeLoop_started = false;
+  category_db = NULL, category_db_old = NULL, category_db_builder = NULL;
+  local_network_lpm = NULL, local_network_lpm_old = NULL;
 #ifndef WIN32
-  cping = NULL, default_ping = NULL;
+  cping = NULL, default_ping = NULL, snmp_poller = NULL;
+  ts_store = NULL;
 #endif
   privileges_dropped = false;
   can_send_icmp = Utils::isPingSupported();
@@ -294,13 +298,23 @@ Ntop::~Ntop() {
 
   delete []iface;
 
+  if(category_db_builder) delete category_db_builder;
+  if(category_db_old)     delete category_db_old;
+  if(category_db.load())  delete category_db.load();
+
+  if(local_network_lpm_old)     delete local_network_lpm_old;
+  if(local_network_lpm.load())  delete local_network_lpm.load();
+
   if(system_interface)    delete system_interface;
 
   if(extract)             delete extract;
+  if(ts_topk)             delete ts_topk;
 
 #ifndef WIN32
   if(cping)               delete cping;
   if(default_ping)        delete default_ping;
+  if(snmp_poller)         delete snmp_poller;
+  if(ts_store.load())     delete ts_store.load();
 
   for(std::map<std::string /* ifname */, Ping*>::iterator it = ping.begin(); it != ping.end(); ++it)
     delete it->second;
@@ -510,6 +524,27 @@ void Ntop::start() {
   for(int i=0; i<num_defined_interfaces; i++)
     iface[i]->allocateStructures();
 
+#ifndef WIN32
+  /* Warm restart: hosts are added inline, before packet processing starts */
+  if(prefs->is_warm_restart_checkpoint_enabled()) {
+    for(int i=0; i<num_defined_interfaces; i++)
+      if(!iface[i]->isView()) iface[i]->loadCheckpoint();
+  }
+#endif
+
+  /* Lists of the previous run, until startup.lua reloads them */
+  loadCategoryDB();
+
+#ifndef WIN32
+  /* The poller thread is started with the first device (ntop.snmpPollerSetDevice) */
+  try {
+    snmp_poller = new SNMPPoller();
+  } catch(...) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to create the SNMP poller");
+    snmp_poller = NULL;
+  }
+#endif
+
 #ifdef __linux__
   inotify_fd = inotify_init();
 
@@ -3139,6 +3174,10 @@ bool Ntop::initnDPIReload() {
   for(u_int i = 0; i<get_num_interfaces(); i++)
     if(getInterface(i)) rc |= getInterface(i)->initnDPIReload();
 
+  /* The category lists are loaded once for all the interfaces */
+  if(category_db_builder) delete category_db_builder;
+  category_db_builder = new (std::nothrow) CategoryDBBuilder();
+
   return(rc);
 }
 
@@ -3156,40 +3195,94 @@ bool Ntop::isnDPIReloadInProgress()  {
 /* ******************************************* */
 
 void Ntop::finalizenDPIReload() {
+  u_int num_ifaces = 0;
+
+  if(category_db_builder) {
+    CategoryDB *db = category_db_builder->compile();
+
+    delete category_db_builder;
+    category_db_builder = NULL;
+
+    if(db) {
+      char path[MAX_PATH];
+
+      /* Lookups in progress can still use the previous database until the next reload */
+      if(category_db_old) delete category_db_old;
+      category_db_old = category_db.exchange(db);
+
+      for(u_int i = 0; i<get_num_interfaces(); i++)
+	if(getInterface(i)) num_ifaces++;
+
+      getTrace()->traceEvent(TRACE_NORMAL,
+			     "Category lists: %u IP ranges, %u hosts, %.1f MB, built in %u ms, shared by %u interfaces",
+			     db->getNumIPv4Ranges(), db->getNumHosts(), db->getMemory() / 1048576.,
+			     db->getBuildTime(), num_ifaces);
+
+      snprintf(path, sizeof(path), "%s/%s", get_working_dir(), CATEGORY_DB_FILE_NAME);
+
+      if(!db->save(path))
+	getTrace()->traceEvent(TRACE_WARNING, "Unable to save the category lists to %s", path);
+    }
+  }
+
+  /* Hosts blacklist reload happens here, so the new database must already be in place */
   for(u_int i = 0; i<get_num_interfaces(); i++)
     if(getInterface(i))  getInterface(i)->finalizenDPIReload();
 }
 
 /* ******************************************* */
 
-bool Ntop::nDPILoadIPCategory(char *what, ndpi_protocol_category_t id, char *list_name) {
-  char *persistent_name = getPersistentCustomListName(list_name);
-  bool success = true;
+void Ntop::loadCategoryDB() {
+  char path[MAX_PATH];
+  CategoryDB *db;
 
-  for(u_int i = 0; i<get_num_interfaces(); i++) {
-    if(getInterface(i)) {
-      if (!getInterface(i)->nDPILoadIPCategory(what, id, persistent_name))
-        success = false;
-    }
+  snprintf(path, sizeof(path), "%s/%s", get_working_dir(), CATEGORY_DB_FILE_NAME);
+
+  if((db = CategoryDB::open(path)) != NULL) {
+    getTrace()->traceEvent(TRACE_INFO, "Loaded category lists from %s [%u IP ranges, %u hosts]",
+			   path, db->getNumIPv4Ranges(), db->getNumHosts());
+
+    if((db = category_db.exchange(db)) != NULL)
+      delete db;
   }
+}
+
+/* ******************************************* */
+
+bool Ntop::nDPILoadIPCategory(char *what, ndpi_protocol_category_t id, char *list_name) {
+  if(!what || !category_db_builder)
+    return(false);
 
-  return success;
+  return(category_db_builder->addIP(what, id, list_name));
 }
 
 /* ******************************************* */
 
 bool Ntop::nDPILoadHostnameCategory(char *what, ndpi_protocol_category_t id, char *list_name) {
-  char *persistent_name = getPersistentCustomListName(list_name);
-  bool success = true;
+  if(!what || !category_db_builder)
+    return(false);
 
-  for(u_int i = 0; i<get_num_interfaces(); i++) {
-    if(getInterface(i)) {
-      if (!getInterface(i)->nDPILoadHostnameCategory(what, id, persistent_name))
-        success = false;
-    }
-  }
+  return(category_db_builder->addHost(what, id, list_name));
+}
 
-  return success;
+/* ******************************************* */
+
+bool Ntop::nDPIExcludeCategoryHost(char *what, ndpi_protocol_category_t id) {
+  if(!what || !category_db_builder)
+    return(false);
+
+  category_db_builder->addExclusion(what, id);
+  return(true);
+}
+
+/* ******************************************* */
+
+bool Ntop::nDPILoadCategoryFile(const char *path, const char *format, ndpi_protocol_category_t id, char *list_name,
+				u_int32_t max_ips, u_int32_t max_hosts, category_list_load_stats *stats) {
+  if(!category_db_builder)
+    return(false);
+
+  return(category_db_builder->loadFile(path, format, id, list_name, max_ips, max_hosts, stats));
 }
 
 /* ******************************************* */
@@ -3268,7 +3361,27 @@ void Ntop::setScriptsDir() {
 /* ******************************************* */
 
 inline int16_t Ntop::localNetworkLookup(int family, void *addr, u_int8_t *network_mask_bits) {
-  return(local_network_tree.findAddress(family, addr, network_mask_bits));
+  CompiledAddressTree *lpm = local_network_lpm.load();
+
+  if(lpm)
+    return(lpm->findAddress(family, addr, network_mask_bits));
+  else
+    return(local_network_tree.findAddress(family, addr, network_mask_bits));
+}
+
+/* **************************************** */
+
+void Ntop::compileLocalNetworks() {
+  CompiledAddressTree *lpm = CompiledAddressTree::compile(&local_network_tree);
+
+  if(lpm) {
+    /* Lookups in progress can still use the previous table until the next change */
+    if(local_network_lpm_old) delete local_network_lpm_old;
+    local_network_lpm_old = local_network_lpm.exchange(lpm);
+
+    getTrace()->traceEvent(TRACE_INFO, "Compiled %u local networks [%.1f MB, %u ms]",
+			   lpm->getNumPrefixes(), lpm->getMemory() / 1048576., lpm->getBuildTime());
+  }
 }
 
 /* **************************************** */
@@ -3364,9 +3477,11 @@ void Ntop::addLocalNetworkList(const char *rule) {
   char *tmp, *net = strtok_r((char *) rule, ",", &tmp);
 
   while(net != NULL) {
-    if(!addLocalNetwork(net)) return;
+    if(!addLocalNetwork(net)) break;
     net = strtok_r(NULL, ",", &tmp);
   }
+
+  compileLocalNetworks();
 }
 
 /* ******************************************* */
@@ -3474,6 +3589,30 @@ Ping* Ntop::getPing(char *ifname) {
 
 /* ******************************************* */
 
+TimeseriesStore* Ntop::getTimeseriesStore() {
+  TimeseriesStore *store = ts_store.load();
+
+  if(store == NULL) {
+    m.lock(__FILE__, __LINE__);
+
+    if((store = ts_store.load()) == NULL) {
+      try {
+	store = new TimeseriesStore(working_dir);
+	ts_store = store;
+      } catch(...) {
+	ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to create the native timeseries store");
+	store = NULL;
+      }
+    }
+
+    m.unlock(__FILE__, __LINE__);
+  }
+
+  return(store);
+}
+
+/* ******************************************* */
+
 void Ntop::initPing() {
   if(!can_send_icmp) return;
 
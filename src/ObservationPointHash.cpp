@@ -42,9 +42,10 @@ ObservationPoint* ObservationPointHash::get(u_int16_t obs_point, bool is_inline_
       return(NULL);
     } else {
       ObservationPoint *head;
+      int epoch_slot = -1;
 
       if(!is_inline_call)
-	locks[hash]->rdlock(__FILE__, __LINE__);
+	epoch_slot = enterReadSection(hash);
 
       head = (ObservationPoint*)table[hash];
 
@@ -56,7 +57,7 @@ ObservationPoint* ObservationPointHash::get(u_int16_t obs_point, bool is_inline_
       }
 
       if(!is_inline_call)
-	locks[hash]->unlock(__FILE__, __LINE__);
+	exitReadSection(hash, epoch_slot);
 
       return(head);
     }
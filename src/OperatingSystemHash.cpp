@@ -41,9 +41,10 @@ OperatingSystem* OperatingSystemHash::get(OSType os_type, bool is_inline_call) {
     return(NULL);
   } else {
     OperatingSystem *head;
+    int epoch_slot = -1;
 
     if(!is_inline_call)
-      locks[hash]->rdlock(__FILE__, __LINE__);
+      epoch_slot = enterReadSection(hash);
 
     head = (OperatingSystem*)table[hash];
 
@@ -55,7 +56,7 @@ OperatingSystem* OperatingSystemHash::get(OSType os_type, bool is_inline_call) {
     }
 
     if(!is_inline_call)
-      locks[hash]->unlock(__FILE__, __LINE__);
+      exitReadSection(hash, epoch_slot);
 
     return(head);
   }
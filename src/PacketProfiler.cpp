@@ -0,0 +1,137 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* *************************************** */
+
+PacketProfiler::PacketProfiler() {
+  enabled = false, sampling = false;
+  sampling_rate = PROFILER_DEFAULT_SAMPLING_RATE, pkt_skip = 0, last_tick = 0;
+  memset(stages, 0, sizeof(stages));
+}
+
+/* *************************************** */
+
+const char* PacketProfiler::stageName(ProfilerStage s) {
+  switch(s) {
+  case profiler_stage_decode:        return("decode");
+  case profiler_stage_flow_lookup:   return("flow_lookup");
+  case profiler_stage_flow_update:   return("flow_update");
+  case profiler_stage_detection:     return("detection");
+  case profiler_stage_l7_dissection: return("l7_dissection");
+  case profiler_stage_host_update:   return("host_update");
+  case profiler_stage_flow_checks:   return("flow_checks");
+  case profiler_stage_host_checks:   return("host_checks");
+  default:                           return("unknown");
+  }
+}
+
+/* *************************************** */
+
+void PacketProfiler::enable(bool enable, u_int32_t rate) {
+  if(rate > 0) sampling_rate = rate;
+
+  if(enable && !enabled)
+    reset(); /* Start from a clean state */
+
+  enabled = enable;
+}
+
+/* *************************************** */
+
+void PacketProfiler::reset() {
+  for(int i = 0; i < profiler_num_stages; i++) {
+    StageStats *st = &stages[i];
+
+    st->num_samples = st->tot_ticks = st->max_ticks = 0;
+    memset(st->hist, 0, sizeof(st->hist));
+  }
+}
+
+/* *************************************** */
+
+void PacketProfiler::luaStage(lua_State *vm, ticks tps, ProfilerStage s) {
+  StageStats *st = &stages[s];
+  u_int64_t n = st->num_samples, sum = 0, p50 = 0, p99 = 0;
+
+  lua_newtable(vm);
+
+  lua_push_uint64_table_entry(vm, "num_samples", n);
+  lua_push_uint64_table_entry(vm, "avg_cycles", n ? (st->tot_ticks / n) : 0);
+  lua_push_uint64_table_entry(vm, "max_cycles", st->max_ticks);
+  lua_push_float_table_entry(vm, "avg_usec", n ? ((st->tot_ticks * 1000000.) / n / tps) : 0);
+
+  /* Percentiles are reported as the upper bound of the matching bucket */
+  lua_newtable(vm);
+
+  for(int i = 0; i < PROFILER_NUM_BUCKETS; i++) {
+    u_int64_t upper = ((u_int64_t)2) << i;
+
+    sum += st->hist[i];
+    if(n && (p50 == 0) && (sum * 2 >= n))   p50 = upper;
+    if(n && (p99 == 0) && (sum * 100 >= n * 99)) p99 = upper;
+
+    lua_pushinteger(vm, i + 1);
+    lua_pushinteger(vm, st->hist[i]);
+    lua_settable(vm, -3);
+  }
+
+  lua_pushstring(vm, "histogram");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+
+  lua_push_uint64_table_entry(vm, "p50_cycles", p50);
+  lua_push_uint64_table_entry(vm, "p99_cycles", p99);
+
+  lua_pushstring(vm, stageName(s));
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
+
+/* *************************************** */
+
+void PacketProfiler::lua(lua_State *vm) {
+  static ticks tps = 0;
+
+  if(tps == 0) tps = Utils::gettickspersec(); /* Sleeps ~2 msec: compute it once */
+
+  lua_newtable(vm);
+
+  lua_push_bool_table_entry(vm, "enabled", enabled);
+  lua_push_uint64_table_entry(vm, "sampling_rate", sampling_rate);
+  lua_push_uint64_table_entry(vm, "ticks_per_sec", tps);
+
+  lua_newtable(vm);
+
+  for(int i = 0; i < profiler_num_stages; i++) {
+    if(stages[i].num_samples > 0)
+      luaStage(vm, tps, (ProfilerStage)i);
+  }
+
+  lua_pushstring(vm, "stages");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+
+  lua_pushstring(vm, "profiler");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
@@ -69,6 +69,7 @@ Paginator::Paginator() {
 
   details_level = details_normal;
   details_level_set = false;
+  lua_fields = FLOW_LUA_ALL_FIELDS;
 
   /*
     TODO MISSING
@@ -155,6 +156,8 @@ void Paginator::readOptions(lua_State *L, int index) {
 	} else if(!strcmp(key, "detailsLevel")) {
 	  const char* value = lua_tostring(L, -1);
 	  details_level_set = Utils::str2DetailsLevel(value, &details_level);
+	} else if(!strcmp(key, "fields")) {
+	  lua_fields = Utils::str2FlowLuaFields(lua_tostring(L, -1));
 	} else if(!strcmp(key, "macFilter")) {
 	  const char* value = lua_tostring(L, -1);
 	  if(mac_filter) free(mac_filter);
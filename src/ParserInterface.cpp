@@ -321,6 +321,20 @@ bool ParserInterface::processFlow(ParsedFlow *zflow) {
 			 this,
 			 zflow->tcp.ooo_out_pkts, zflow->tcp.retr_out_pkts,
 			 zflow->tcp.lost_out_pkts, 0 /* TODO: add keepalive */);
+
+    if(flow->get_cli_host()) {
+      Flow::incHostTcpBadStats(true /* sent */, flow->get_cli_host(),
+			       zflow->tcp.ooo_in_pkts, zflow->tcp.retr_in_pkts, zflow->tcp.lost_in_pkts, 0);
+      Flow::incHostTcpBadStats(false /* rcvd */, flow->get_cli_host(),
+			       zflow->tcp.ooo_out_pkts, zflow->tcp.retr_out_pkts, zflow->tcp.lost_out_pkts, 0);
+    }
+
+    if(flow->get_srv_host()) {
+      Flow::incHostTcpBadStats(false /* rcvd */, flow->get_srv_host(),
+			       zflow->tcp.ooo_in_pkts, zflow->tcp.retr_in_pkts, zflow->tcp.lost_in_pkts, 0);
+      Flow::incHostTcpBadStats(true /* sent */, flow->get_srv_host(),
+			       zflow->tcp.ooo_out_pkts, zflow->tcp.retr_out_pkts, zflow->tcp.lost_out_pkts, 0);
+    }
   }
 
   flow->addFlowStats(new_flow,
@@ -53,12 +53,16 @@ Prefs::Prefs(Ntop *_ntop) {
   ewma_alpha_percent = CONST_DEFAULT_EWMA_ALPHA_PERCENT;
   data_dir = strdup(CONST_DEFAULT_DATA_DIR);
   emit_flow_alerts = emit_host_alerts = true;
+  checks_profiling = false;
+  es_gzip_requests = false;
+  syslog_native_producers = false;
+  num_view_merge_threads = 0;
   zmq_publish_events_url = NULL;
   enable_access_log = false, enable_sql_log = false;
   enable_flow_device_port_rrd_creation = enable_observation_points_rrd_creation = enable_intranet_traffic_rrd_creation = false;
   reproduce_at_original_speed = false;
   enable_top_talkers = false, enable_idle_local_hosts_cache = false;
-  enable_active_local_hosts_cache = false,
+  enable_active_local_hosts_cache = false, enable_warm_restart_checkpoint = false,
     enable_tiny_flows_export = true,
     enable_captive_portal = false, mac_based_captive_portal = false,
     enable_arp_matrix_generation = false,
@@ -596,6 +600,7 @@ static TsDriver str2TsDriver(const char *driver) {
 
 void Prefs::reloadPrefsFromRedis() {
   char *aux = NULL;
+  int32_t num_merge_threads;
   // sets to the default value in redis if no key is found
 #ifdef PREFS_RELOAD_DEBUG
   ntop->getTrace()->traceEvent(TRACE_DEBUG, "A preference has changed, reloading...");
@@ -646,6 +651,8 @@ void Prefs::reloadPrefsFromRedis() {
 							       CONST_DEFAULT_IS_IDLE_LOCAL_HOSTS_CACHE_ENABLED),
     enable_active_local_hosts_cache = getDefaultBoolPrefsValue(CONST_RUNTIME_ACTIVE_LOCAL_HOSTS_CACHE_ENABLED,
 							       CONST_DEFAULT_IS_ACTIVE_LOCAL_HOSTS_CACHE_ENABLED),
+    enable_warm_restart_checkpoint  = getDefaultBoolPrefsValue(CONST_RUNTIME_WARM_RESTART_CHECKPOINT_ENABLED,
+							       CONST_DEFAULT_IS_WARM_RESTART_CHECKPOINT_ENABLED),
     enable_tiny_flows_export        = getDefaultBoolPrefsValue(CONST_IS_TINY_FLOW_EXPORT_ENABLED,
 							       CONST_DEFAULT_IS_TINY_FLOW_EXPORT_ENABLED),
 
@@ -722,6 +729,13 @@ void Prefs::reloadPrefsFromRedis() {
   enable_client_x509_auth    = getDefaultBoolPrefsValue(CONST_PREFS_CLIENT_X509_AUTH, false);
   emit_flow_alerts           = getDefaultBoolPrefsValue(CONST_PREFS_EMIT_FLOW_ALERTS, true);
   emit_host_alerts           = getDefaultBoolPrefsValue(CONST_PREFS_EMIT_HOST_ALERTS, true);
+  checks_profiling           = getDefaultBoolPrefsValue(CONST_PREFS_CHECKS_PROFILING, false);
+  es_gzip_requests           = getDefaultBoolPrefsValue(CONST_PREFS_ES_GZIP_REQUESTS, false);
+  syslog_native_producers    = getDefaultBoolPrefsValue(CONST_PREFS_SYSLOG_NATIVE_PRODUCERS, false);
+
+  /* Used by the view interfaces when they start */
+  num_merge_threads = getDefaultPrefsValue(CONST_PREFS_VIEW_MERGE_THREADS, 0);
+  num_view_merge_threads = (num_merge_threads < 0) ? 0 : min_val(num_merge_threads, MAX_NUM_VIEW_MERGE_THREADS);
 
   setTraceLevelFromRedis();
   refreshHostsAlertsPrefs();
@@ -2091,6 +2105,7 @@ void Prefs::lua(lua_State* vm) {
   lua_push_bool_table_entry(vm, "flow_table_time", flow_table_time);
   lua_push_bool_table_entry(vm, "flow_table_probe_order", flow_table_probe_order);
   lua_push_bool_table_entry(vm, "is_active_local_hosts_cache_enabled", enable_active_local_hosts_cache);
+  lua_push_bool_table_entry(vm, "is_warm_restart_checkpoint_enabled", enable_warm_restart_checkpoint);
 
   lua_push_bool_table_entry(vm,"is_tiny_flows_export_enabled",             enable_tiny_flows_export);
   lua_push_uint64_table_entry(vm, "max_entity_alerts", max_entity_alerts);
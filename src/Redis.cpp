@@ -483,6 +483,60 @@ int Redis::hashDel(const char * key, const char * field) {
 
 /* **************************************** */
 
+int Redis::setBinary(const char *key, const char *value, u_int value_len, u_int expire_secs) {
+  int rc;
+  redisReply *reply;
+
+  l->lock(__FILE__, __LINE__);
+
+  stats.num_set++;
+
+  if(expire_secs != 0)
+    reply = (redisReply*)redisCommand(redis, "SET %s %b EX %u", key, value, (size_t)value_len, expire_secs);
+  else
+    reply = (redisReply*)redisCommand(redis, "SET %s %b", key, value, (size_t)value_len);
+
+  if(!reply) reconnectRedis(true);
+  if(reply && (reply->type == REDIS_REPLY_ERROR)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "%s", reply->str ? reply->str : "???");
+    rc = -1;
+  } else
+    rc = reply ? 0 : -1;
+
+  if(reply) freeReplyObject(reply);
+  l->unlock(__FILE__, __LINE__);
+
+  return(rc);
+}
+
+/* **************************************** */
+
+/* Returns -1 when the key does not exist */
+int Redis::getBinary(const char *key, std::string *rsp) {
+  int rc;
+  redisReply *reply;
+
+  l->lock(__FILE__, __LINE__);
+
+  stats.num_get++;
+  reply = (redisReply*)redisCommand(redis, "GET %s", key);
+  if(!reply) reconnectRedis(true);
+  if(reply && (reply->type == REDIS_REPLY_ERROR))
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "%s", reply->str ? reply->str : "???");
+
+  if(reply && (reply->type == REDIS_REPLY_STRING) && reply->str)
+    rsp->assign(reply->str, reply->len), rc = 0;
+  else
+    rsp->clear(), rc = -1;
+
+  if(reply) freeReplyObject(reply);
+  l->unlock(__FILE__, __LINE__);
+
+  return(rc);
+}
+
+/* **************************************** */
+
 int Redis::_set(bool use_nx, const char * key, const char * value, u_int expire_secs) {
   int rc, ret_code = 0;
   redisReply *reply;
@@ -64,7 +64,7 @@ void RemoteHost::initialize() {
   stats = allocateStats();
   updateHostPool(true /* inline with packet processing */, true /* first inc */);
 
-  if(ntop->getPrefs()->is_dns_resolution_enabled_for_all_hosts()) {
+  if(ntop->getPrefs()->is_dns_resolution_enabled_for_all_hosts() && (!iface->isLoadingCheckpoint())) {
   /* Just ask ntopng to resolve the name. Actual name will be grabbed once needed
      using the getter.
    */    
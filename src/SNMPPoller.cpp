@@ -0,0 +1,699 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef WIN32
+
+#include "ntop_includes.h"
+
+#include <poll.h>
+
+/* Compiled with SNMP.cpp */
+extern "C" {
+#include "../third-party/snmp/_snmp.h"
+};
+
+// #define TRACE_SNMP_POLLER
+
+/*
+  Usage example (e.g. minute.lua), also against a local simulator
+  such as snmpsim listening on 127.0.0.1:1161:
+
+  ntop.snmpPollerSetDevice("192.168.1.1", "public", 1 --[[ v2c ]], 60)
+  ntop.snmpPollerSetDevice("127.0.0.1:1161", "public", 1, 60)
+  tprint(ntop.snmpPollerGetDeltas(os.time() - 60))
+*/
+
+/* IF-MIB ifXTable (64 bit counters) and ifTable columns */
+static const char *v2c_columns[SNMP_POLLER_NUM_COLUMNS] = {
+  "1.3.6.1.2.1.31.1.1.1.6",  /* ifHCInOctets     */
+  "1.3.6.1.2.1.31.1.1.1.10", /* ifHCOutOctets    */
+  "1.3.6.1.2.1.31.1.1.1.7",  /* ifHCInUcastPkts  */
+  "1.3.6.1.2.1.31.1.1.1.11", /* ifHCOutUcastPkts */
+  "1.3.6.1.2.1.2.2.1.13",    /* ifInDiscards     */
+  "1.3.6.1.2.1.2.2.1.19",    /* ifOutDiscards    */
+  "1.3.6.1.2.1.2.2.1.14",    /* ifInErrors       */
+  "1.3.6.1.2.1.2.2.1.20",    /* ifOutErrors      */
+  "1.3.6.1.2.1.2.2.1.8"      /* ifOperStatus     */
+};
+
+/* Counter64 is not available with v1 */
+static const char *v1_columns[SNMP_POLLER_NUM_COLUMNS] = {
+  "1.3.6.1.2.1.2.2.1.10",    /* ifInOctets       */
+  "1.3.6.1.2.1.2.2.1.16",    /* ifOutOctets      */
+  "1.3.6.1.2.1.2.2.1.11",    /* ifInUcastPkts    */
+  "1.3.6.1.2.1.2.2.1.17",    /* ifOutUcastPkts   */
+  "1.3.6.1.2.1.2.2.1.13",    /* ifInDiscards     */
+  "1.3.6.1.2.1.2.2.1.19",    /* ifOutDiscards    */
+  "1.3.6.1.2.1.2.2.1.14",    /* ifInErrors       */
+  "1.3.6.1.2.1.2.2.1.20",    /* ifOutErrors      */
+  "1.3.6.1.2.1.2.2.1.8"      /* ifOperStatus     */
+};
+
+/* ****************************************** */
+
+static void* snmpPollerFctn(void* ptr) {
+  Utils::setThreadName("snmp-poller");
+
+  ((SNMPPoller*)ptr)->run();
+
+  return(NULL);
+}
+
+/* ****************************************** */
+
+SNMPPoller::SNMPPoller() {
+  started = false;
+  next_request_id = 1, num_polling = 0;
+  max_repetitions = SNMP_POLLER_MAX_REPETITIONS;
+  num_requests = num_responses = num_timeouts = num_retries = 0;
+  num_unexpected_responses = num_polls = num_failed_polls = 0;
+
+  if((sock = Utils::openSocket(AF_INET, SOCK_DGRAM, 0, "SNMP poller")) < 0)
+    throw "Unable to create the SNMP poller socket";
+
+  /* Responses of hundreds of agents may arrive at once */
+  Utils::maximizeSocketBuffer(sock, true /* RX */, 8 /* MB */);
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+}
+
+/* ****************************************** */
+
+SNMPPoller::~SNMPPoller() {
+  if(started)
+    pthread_join(poller, NULL);
+
+  for(std::map<std::string, snmp_poller_device*>::iterator it = devices.begin(); it != devices.end(); ++it)
+    delete it->second;
+
+  Utils::closeSocket(sock);
+}
+
+/* ****************************************** */
+
+/* Can be called by several Lua VMs: returns false if the poller thread is not running */
+bool SNMPPoller::start() {
+  bool rc;
+  int err;
+
+  m.lock(__FILE__, __LINE__);
+
+  if(!started) {
+    if((err = pthread_create(&poller, NULL, snmpPollerFctn, (void*)this)) == 0)
+      started = true;
+    else
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to start the SNMP poller thread [%s]", strerror(err));
+  }
+
+  rc = started;
+  m.unlock(__FILE__, __LINE__);
+
+  return(rc);
+}
+
+/* ****************************************** */
+
+/* a.b.c.d[:port] */
+bool SNMPPoller::parseAgent(const char *agent, struct sockaddr_in *addr) {
+  char host[64], *port;
+  long p = 161;
+
+  snprintf(host, sizeof(host), "%s", agent);
+
+  if((port = strchr(host, ':')) != NULL) {
+    char *end;
+
+    *port = '\0';
+    p = strtol(port + 1, &end, 10);
+
+    if((*end != '\0') || (p <= 0) || (p > 65535))
+      return(false);
+  }
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET, addr->sin_port = htons((u_int16_t)p);
+
+  return(inet_pton(AF_INET, host, &addr->sin_addr) == 1);
+}
+
+/* ****************************************** */
+
+const char* SNMPPoller::getColumnOID(u_int8_t version, u_int col) {
+  return((version == 0) ? v1_columns[col] : v2c_columns[col]);
+}
+
+/* ****************************************** */
+
+u_int64_t SNMPPoller::counterDelta(u_int64_t prev, u_int64_t cur, bool is_64bit) {
+  if(cur >= prev)
+    return(cur - prev);
+
+  /* A 32 bit counter has wrapped, whereas a 64 bit one can only be reset (e.g. device reboot) */
+  return(is_64bit ? 0 : ((0x100000000ULL - prev) + cur));
+}
+
+/* ****************************************** */
+
+bool SNMPPoller::setDevice(const char *agent, const char *community, u_int8_t version,
+			   u_int32_t poll_interval, u_int32_t max_requests_per_sec) {
+  std::map<std::string, snmp_poller_device*>::iterator it;
+  struct sockaddr_in addr;
+  snmp_poller_device *d;
+
+  if((version > 1) || (poll_interval == 0) || (max_requests_per_sec == 0)
+     || !parseAgent(agent, &addr))
+    return(false);
+
+  m.lock(__FILE__, __LINE__);
+
+  if((it = devices.find(agent)) != devices.end()) {
+    d = it->second;
+
+    if((d->version != version) || (d->community.compare(community) != 0)) {
+      /* Restart from scratch: counters of different versions are not comparable */
+      if(d->polling) cancelRequest(d), d->polling = false, num_polling--;
+      d->last_counters.clear(), d->deltas.clear(), d->walk_counters.clear();
+      d->last_poll = d->prev_poll = d->next_poll = 0;
+    }
+  } else {
+    if((d = new (std::nothrow) snmp_poller_device) == NULL) {
+      m.unlock(__FILE__, __LINE__);
+      return(false);
+    }
+
+    d->agent = agent, d->addr = addr;
+    d->polling = false, d->request_inflight = false, d->request_id = 0, d->num_retries = 0;
+    d->next_poll = d->last_poll = d->prev_poll = 0;
+    d->last_poll_msec = d->num_consecutive_failures = 0;
+    d->num_polls = d->num_failed_polls = d->num_requests = d->num_timeouts = d->num_errors = 0;
+    gettimeofday(&d->tokens_refill, NULL);
+    d->tokens = 1;
+
+    devices[d->agent] = d;
+  }
+
+  d->community = community, d->version = version;
+  d->poll_interval = poll_interval, d->max_requests_per_sec = max_requests_per_sec;
+  d->last_heartbeat = time(NULL);
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(true);
+}
+
+/* ****************************************** */
+
+/* Locked */
+void SNMPPoller::removeDevice(std::map<std::string, snmp_poller_device*>::iterator it) {
+  snmp_poller_device *d = it->second;
+
+  if(d->polling) {
+    cancelRequest(d);
+    num_polling--;
+  }
+
+  devices.erase(it);
+  delete d;
+}
+
+/* ****************************************** */
+
+void SNMPPoller::removeDevice(const char *agent) {
+  std::map<std::string, snmp_poller_device*>::iterator it;
+
+  m.lock(__FILE__, __LINE__);
+
+  if((it = devices.find(agent)) != devices.end())
+    removeDevice(it);
+
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* ****************************************** */
+
+/* Devices are purged when the Lua scripts no longer refresh them */
+void SNMPPoller::purgeIdleDevices(time_t now) {
+  std::map<std::string, snmp_poller_device*>::iterator it = devices.begin();
+
+  while(it != devices.end()) {
+    snmp_poller_device *d = it->second;
+    time_t max_idle = max_val(SNMP_POLLER_MIN_DEVICE_IDLE, 3 * (time_t)d->poll_interval);
+
+    if(now > d->last_heartbeat + max_idle) {
+#ifdef TRACE_SNMP_POLLER
+      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Purging idle SNMP device %s", d->agent.c_str());
+#endif
+      removeDevice(it++);
+    } else
+      ++it;
+  }
+}
+
+/* ****************************************** */
+
+void SNMPPoller::cancelRequest(snmp_poller_device *d) {
+  if(d->request_inflight) {
+    inflight.erase(d->request_id);
+    d->request_inflight = false;
+  }
+}
+
+/* ****************************************** */
+
+void SNMPPoller::startWalk(snmp_poller_device *d, const struct timeval *now) {
+  d->polling = true, d->poll_begin = *now;
+  d->next_poll = now->tv_sec + d->poll_interval;
+  d->num_retries = 0;
+  d->walk_counters.clear();
+
+  for(u_int col = 0; col < SNMP_POLLER_NUM_COLUMNS; col++)
+    d->next_oid[col] = getColumnOID(d->version, col), d->column_done[col] = false;
+
+  num_polling++;
+}
+
+/* ****************************************** */
+
+/*
+  Requests the next rows of the columns not yet completed. Returns false
+  when the request can't be sent now (rate limit, or socket full) and must
+  be retried on the next tick.
+*/
+bool SNMPPoller::sendRequest(snmp_poller_device *d, const struct timeval *now) {
+  SNMPMessage *message;
+  u_char buf[1500];
+  float elapsed;
+  int len;
+
+  /* Token bucket: max_requests_per_sec with a burst of one second */
+  elapsed = Utils::msTimevalDiff(now, &d->tokens_refill) / 1000.;
+  d->tokens = min_val((float)d->max_requests_per_sec, d->tokens + elapsed * d->max_requests_per_sec);
+  d->tokens_refill = *now;
+
+  if(d->tokens < 1)
+    return(false);
+
+  if((message = snmp_create_message()) == NULL)
+    return(false);
+
+  d->request_id = next_request_id;
+  next_request_id = (next_request_id == 0x7FFFFFFF) ? 1 : next_request_id + 1;
+
+  snmp_set_version(message, d->version);
+  snmp_set_community(message, (char*)d->community.c_str());
+  snmp_set_request_id(message, d->request_id);
+
+  if(d->version == 0)
+    snmp_set_pdu_type(message, NTOP_SNMP_GETNEXT_REQUEST_TYPE);
+  else {
+    snmp_set_pdu_type(message, NTOP_SNMP_GETBULK_REQUEST_TYPE);
+    snmp_set_error(message, 0 /* non-repeaters */);
+    snmp_set_error_index(message, max_repetitions);
+  }
+
+  for(u_int col = 0; col < SNMP_POLLER_NUM_COLUMNS; col++) {
+    if(!d->column_done[col])
+      snmp_add_varbind_null(message, (char*)d->next_oid[col].c_str());
+  }
+
+  if((len = snmp_message_length(message)) <= (int)sizeof(buf))
+    snmp_render_message(message, buf);
+
+  snmp_destroy_message(message);
+  free(message); /* malloc'd by snmp_create_message */
+
+  if(len > (int)sizeof(buf))
+    return(false);
+
+  if((sendto(sock, buf, len, 0, (struct sockaddr*)&d->addr, sizeof(d->addr)) != len)
+     && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ENOBUFS)))
+    return(false);
+
+  /* Other errors (e.g. unreachable network) are handled as a timeout */
+
+  inflight[d->request_id] = d;
+  d->request_inflight = true, d->request_sent = *now;
+  d->tokens -= 1;
+  d->num_requests++, num_requests++;
+
+  return(true);
+}
+
+/* ****************************************** */
+
+void SNMPPoller::handleResponse(u_char *buf, int len, const struct sockaddr_in *from, const struct timeval *now) {
+  std::unordered_map<int32_t, snmp_poller_device*>::iterator it;
+  u_int8_t active[SNMP_POLLER_NUM_COLUMNS];
+  u_int num_active = 0, col;
+  SNMPMessage *message;
+  snmp_poller_device *d;
+  bool completed = true;
+  int error;
+
+  if((message = snmp_parse_message(buf, len)) == NULL)
+    return;
+
+  if((snmp_get_pdu_type(message) != NTOP_SNMP_GET_RESPONSE_TYPE)
+     || ((it = inflight.find(snmp_get_request_id(message))) == inflight.end())
+     || (it->second->addr.sin_addr.s_addr != from->sin_addr.s_addr)
+     || (it->second->addr.sin_port != from->sin_port)) {
+    /* e.g. a late response to a request already timed out */
+    num_unexpected_responses++;
+    goto out;
+  }
+
+  d = it->second;
+  inflight.erase(it);
+  d->request_inflight = false, d->num_retries = 0;
+  num_responses++;
+
+  /* Varbinds are ordered as in the request: the active columns, repeated */
+  for(col = 0; col < SNMP_POLLER_NUM_COLUMNS; col++)
+    if(!d->column_done[col]) active[num_active++] = col;
+
+  if((error = snmp_get_error(message)) != 0) {
+    int idx = snmp_get_error_index(message);
+
+    d->num_errors++;
+
+    /* v1 agents report the end of the MIB as noSuchName (2) of the offending varbind */
+    if((error == 2) && (d->version == 0) && (idx >= 1) && (idx <= (int)num_active))
+      d->column_done[active[idx - 1]] = true;
+    else {
+      walkFailed(d);
+      goto out;
+    }
+  } else {
+    char *oid;
+    int type;
+    int64_t value;
+
+    for(int i = 0; snmp_get_varbind_as_string(message, i, &oid, &type, NULL); i++) {
+      const char *prefix;
+      size_t prefix_len;
+      u_int32_t if_idx;
+      char *end;
+
+      col = active[i % num_active];
+
+      if(d->column_done[col])
+	continue;
+
+      prefix = getColumnOID(d->version, col), prefix_len = strlen(prefix);
+
+      /* Past the end of the column (or of the MIB) */
+      if((!snmp_get_varbind_integer64(message, i, &oid, &type, &value))
+	 || (strncmp(oid, prefix, prefix_len) != 0) || (oid[prefix_len] != '.')
+	 || (d->next_oid[col].compare(oid) == 0) /* Not increasing */) {
+	d->column_done[col] = true;
+	continue;
+      }
+
+      if_idx = strtoul(&oid[prefix_len + 1], &end, 10);
+
+      if(*end != '\0') {
+	d->column_done[col] = true;
+	continue;
+      }
+
+      d->walk_counters[if_idx].value[col] = (u_int64_t)value;
+      d->next_oid[col] = oid;
+    }
+  }
+
+  for(col = 0; col < SNMP_POLLER_NUM_COLUMNS; col++)
+    if(!d->column_done[col]) completed = false;
+
+  if(completed)
+    walkCompleted(d, now);
+  else
+    sendRequest(d, now); /* Otherwise sent by the next tick */
+
+ out:
+  snmp_destroy_message(message);
+  free(message); /* malloc'd by snmp_parse_message */
+}
+
+/* ****************************************** */
+
+void SNMPPoller::walkCompleted(snmp_poller_device *d, const struct timeval *now) {
+  if(!d->last_counters.empty()) {
+    d->deltas.clear();
+
+    for(std::map<u_int32_t, snmp_poller_if_counters>::iterator it = d->walk_counters.begin();
+	it != d->walk_counters.end(); ++it) {
+      std::map<u_int32_t, snmp_poller_if_counters>::iterator prev = d->last_counters.find(it->first);
+      snmp_poller_if_counters *delta;
+
+      if(prev == d->last_counters.end())
+	continue; /* New interface */
+
+      delta = &d->deltas[it->first];
+
+      for(u_int col = 0; col < SNMP_POLLER_NUM_COLUMNS; col++) {
+	if(col == snmp_poller_oper_status)
+	  delta->value[col] = it->second.value[col];
+	else
+	  delta->value[col] = counterDelta(prev->second.value[col], it->second.value[col],
+					   (d->version == 1) && (col <= snmp_poller_out_ucast_pkts));
+      }
+    }
+
+    d->prev_poll = d->last_poll;
+  }
+
+  d->last_counters.swap(d->walk_counters);
+  d->walk_counters.clear();
+
+  d->last_poll = now->tv_sec, d->last_poll_msec = Utils::msTimevalDiff(now, &d->poll_begin);
+  d->polling = false, d->num_consecutive_failures = 0;
+  d->num_polls++, num_polls++, num_polling--;
+
+#ifdef TRACE_SNMP_POLLER
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Polled %s: %u interfaces [%u msec]",
+			       d->agent.c_str(), (u_int)d->last_counters.size(), d->last_poll_msec);
+#endif
+}
+
+/* ****************************************** */
+
+void SNMPPoller::walkFailed(snmp_poller_device *d) {
+  u_int32_t backoff;
+
+  cancelRequest(d);
+  d->walk_counters.clear();
+  d->polling = false;
+  d->num_consecutive_failures++;
+  d->num_failed_polls++, num_failed_polls++, num_polling--;
+
+  /* Unresponsive devices are polled less frequently */
+  backoff = (d->num_consecutive_failures >= 4) ? SNMP_POLLER_MAX_BACKOFF
+    : min_val(1U << d->num_consecutive_failures, SNMP_POLLER_MAX_BACKOFF);
+  d->next_poll = d->poll_begin.tv_sec + (time_t)d->poll_interval * backoff;
+
+#ifdef TRACE_SNMP_POLLER
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Unable to poll %s [%u consecutive failures]",
+			       d->agent.c_str(), d->num_consecutive_failures);
+#endif
+}
+
+/* ****************************************** */
+
+/* Handles timeouts, rate limited requests and new walks */
+void SNMPPoller::tick(const struct timeval *now) {
+  for(std::map<std::string, snmp_poller_device*>::iterator it = devices.begin(); it != devices.end(); ++it) {
+    snmp_poller_device *d = it->second;
+
+    if(d->polling) {
+      if(d->request_inflight) {
+	u_int32_t timeout = SNMP_POLLER_TIMEOUT_MSEC << d->num_retries;
+
+	if(Utils::msTimevalDiff(now, &d->request_sent) < timeout)
+	  continue;
+
+	cancelRequest(d);
+	d->num_timeouts++, num_timeouts++;
+
+	if(++d->num_retries > SNMP_POLLER_MAX_RETRIES) {
+	  walkFailed(d);
+	  continue;
+	}
+
+	num_retries++;
+      }
+
+      sendRequest(d, now);
+    } else if((now->tv_sec >= d->next_poll) && (num_polling < SNMP_POLLER_MAX_INFLIGHT)) {
+      startWalk(d, now);
+      sendRequest(d, now);
+    }
+  }
+}
+
+/* ****************************************** */
+
+void SNMPPoller::run() {
+  u_char *buf = (u_char*)malloc(SNMP_POLLER_MAX_PDU_LEN);
+  time_t last_purge = time(NULL);
+  struct pollfd pfd;
+
+  if(buf == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
+    return;
+  }
+
+  pfd.fd = sock, pfd.events = POLLIN;
+
+  while((!ntop->getGlobals()->isShutdownRequested())
+	&& (!ntop->getGlobals()->isShutdown())) {
+    struct timeval now;
+    int rc;
+
+    gettimeofday(&now, NULL);
+
+    m.lock(__FILE__, __LINE__);
+
+    if(now.tv_sec - last_purge >= 60)
+      purgeIdleDevices(now.tv_sec), last_purge = now.tv_sec;
+
+    tick(&now);
+    rc = num_polling;
+
+    m.unlock(__FILE__, __LINE__);
+
+    /* Sleep longer when no walk is in progress */
+    if(poll(&pfd, 1, rc ? SNMP_POLLER_TICK_MSEC : 1000) <= 0)
+      continue;
+
+    gettimeofday(&now, NULL);
+
+    m.lock(__FILE__, __LINE__);
+
+    for(u_int i = 0; i < SNMP_POLLER_MAX_INFLIGHT; i++) {
+      struct sockaddr_in from;
+      socklen_t from_len = sizeof(from);
+
+      if((rc = recvfrom(sock, buf, SNMP_POLLER_MAX_PDU_LEN, 0, (struct sockaddr*)&from, &from_len)) <= 0)
+	break;
+
+      handleResponse(buf, rc, &from, &now);
+    }
+
+    m.unlock(__FILE__, __LINE__);
+  }
+
+  free(buf);
+
+#ifdef TRACE_SNMP_POLLER
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Leaving %s()", __FUNCTION__);
+#endif
+}
+
+/* ****************************************** */
+
+void SNMPPoller::luaDevice(lua_State *vm, snmp_poller_device *d) {
+  lua_newtable(vm);
+
+  lua_push_uint64_table_entry(vm, "last_poll", d->last_poll);
+  lua_push_uint64_table_entry(vm, "interval", d->prev_poll ? (d->last_poll - d->prev_poll) : 0);
+  lua_push_uint64_table_entry(vm, "poll_duration_ms", d->last_poll_msec);
+  lua_push_bool_table_entry(vm, "reachable", d->num_consecutive_failures == 0);
+  lua_push_uint64_table_entry(vm, "num_consecutive_failures", d->num_consecutive_failures);
+  lua_push_uint64_table_entry(vm, "num_polls", d->num_polls);
+  lua_push_uint64_table_entry(vm, "num_failed_polls", d->num_failed_polls);
+  lua_push_uint64_table_entry(vm, "num_requests", d->num_requests);
+  lua_push_uint64_table_entry(vm, "num_timeouts", d->num_timeouts);
+  lua_push_uint64_table_entry(vm, "num_errors", d->num_errors);
+
+  lua_newtable(vm);
+
+  for(std::map<u_int32_t, snmp_poller_if_counters>::iterator it = d->deltas.begin(); it != d->deltas.end(); ++it) {
+    const u_int64_t *v = it->second.value;
+
+    lua_newtable(vm);
+
+    lua_push_uint64_table_entry(vm, "in_bytes", v[snmp_poller_in_octets]);
+    lua_push_uint64_table_entry(vm, "out_bytes", v[snmp_poller_out_octets]);
+    lua_push_uint64_table_entry(vm, "in_pkts", v[snmp_poller_in_ucast_pkts]);
+    lua_push_uint64_table_entry(vm, "out_pkts", v[snmp_poller_out_ucast_pkts]);
+    lua_push_uint64_table_entry(vm, "in_discards", v[snmp_poller_in_discards]);
+    lua_push_uint64_table_entry(vm, "out_discards", v[snmp_poller_out_discards]);
+    lua_push_uint64_table_entry(vm, "in_errors", v[snmp_poller_in_errors]);
+    lua_push_uint64_table_entry(vm, "out_errors", v[snmp_poller_out_errors]);
+    lua_push_uint64_table_entry(vm, "oper_status", v[snmp_poller_oper_status]);
+
+    lua_pushinteger(vm, it->first);
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
+
+  lua_pushstring(vm, "interfaces");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
+
+/* ****************************************** */
+
+void SNMPPoller::luaDeltas(lua_State *vm, const char *agent, time_t since) {
+  lua_newtable(vm);
+
+  m.lock(__FILE__, __LINE__);
+
+  for(std::map<std::string, snmp_poller_device*>::iterator it = devices.begin(); it != devices.end(); ++it) {
+    snmp_poller_device *d = it->second;
+
+    if((agent && (d->agent.compare(agent) != 0))
+       || (d->last_poll <= since))
+      continue;
+
+    luaDevice(vm, d);
+
+    lua_pushstring(vm, d->agent.c_str());
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
+
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* ****************************************** */
+
+void SNMPPoller::lua(lua_State *vm) {
+  lua_newtable(vm);
+
+  m.lock(__FILE__, __LINE__);
+
+  lua_push_uint64_table_entry(vm, "num_devices", devices.size());
+  lua_push_uint64_table_entry(vm, "num_polling", num_polling);
+  lua_push_uint64_table_entry(vm, "num_inflight", inflight.size());
+  lua_push_uint64_table_entry(vm, "num_requests", num_requests);
+  lua_push_uint64_table_entry(vm, "num_responses", num_responses);
+  lua_push_uint64_table_entry(vm, "num_timeouts", num_timeouts);
+  lua_push_uint64_table_entry(vm, "num_retries", num_retries);
+  lua_push_uint64_table_entry(vm, "num_unexpected_responses", num_unexpected_responses);
+  lua_push_uint64_table_entry(vm, "num_polls", num_polls);
+  lua_push_uint64_table_entry(vm, "num_failed_polls", num_failed_polls);
+
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* ****************************************** */
+
+#endif /* WIN32 */
@@ -0,0 +1,382 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#ifndef HAVE_NEDGE
+
+/* **************************************************** */
+
+SuricataSyslogProducer::SuricataSyslogProducer(SyslogParserInterface *_iface) : SyslogProducer(_iface, "suricata") {
+  snprintf(external_stats_key, sizeof(external_stats_key),
+	   "ntopng.prefs.ifid_%d.external_stats", iface->get_id());
+
+  /* Cleanup old stats, if any */
+  ntop->getRedis()->del(external_stats_key);
+}
+
+/* **************************************************** */
+
+const char* SuricataSyslogProducer::getString(json_object *o, const char *key) {
+  json_object *val;
+
+  if(o && json_object_object_get_ex(o, key, &val) && json_object_is_type(val, json_type_string))
+    return(json_object_get_string(val));
+
+  return(NULL);
+}
+
+/* **************************************************** */
+
+json_object* SuricataSyslogProducer::getObject(json_object *o, const char *key) {
+  json_object *val;
+
+  if(o && json_object_object_get_ex(o, key, &val) && json_object_is_type(val, json_type_object))
+    return(val);
+
+  return(NULL);
+}
+
+/* **************************************************** */
+
+int64_t SuricataSyslogProducer::getInt(json_object *o, const char *key, int64_t default_value) {
+  json_object *val;
+
+  if(o && json_object_object_get_ex(o, key, &val)) {
+    switch(json_object_get_type(val)) {
+    case json_type_int:
+    case json_type_double:
+    case json_type_string:
+      return(json_object_get_int64(val));
+
+    case json_type_array:
+      /* e.g. "vlan": [ 10 ] */
+      if(json_object_array_length(val) > 0)
+	return(json_object_get_int64(json_object_array_get_idx(val, 0)));
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  return(default_value);
+}
+
+/* **************************************************** */
+
+/* Copies a value as is into the flow additional fields */
+void SuricataSyslogProducer::addField(ParsedFlow *flow, const char *name, json_object *o, const char *key) {
+  json_object *val;
+
+  if(o && json_object_object_get_ex(o, key, &val) && (val != NULL))
+    flow->addAdditionalField(name, json_object_get(val));
+}
+
+/* **************************************************** */
+
+/* Subset of the dns_types of flow_utils.lua */
+u_int16_t SuricataSyslogProducer::dnsType(const char *rrtype) {
+  static const struct { const char *name; u_int16_t type; } types[] = {
+    { "A", 1 }, { "NS", 2 }, { "CNAME", 5 }, { "SOA", 6 }, { "PTR", 12 },
+    { "HINFO", 13 }, { "MX", 15 }, { "TXT", 16 }, { "AAAA", 28 }, { "SRV", 33 },
+    { "NAPTR", 35 }, { "DS", 43 }, { "RRSIG", 46 }, { "DNSKEY", 48 },
+    { "HTTPS", 65 }, { "AXFR", 252 }, { "ANY", 255 }, { NULL, 0 }
+  };
+
+  if(rrtype) {
+    for(int i = 0; types[i].name; i++)
+      if(!strcmp(types[i].name, rrtype))
+	return(types[i].type);
+  }
+
+  return(0);
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseFiveTuple(json_object *event, ParsedFlow *flow) {
+  const char *s;
+
+  flow->vlan_id = getInt(event, "vlan");
+  if((s = getString(event, "src_ip")))  flow->src_ip.set(s);
+  if((s = getString(event, "dest_ip"))) flow->dst_ip.set(s);
+  flow->src_port = htons((u_int16_t)getInt(event, "src_port"));
+  flow->dst_port = htons((u_int16_t)getInt(event, "dest_port"));
+  if((s = getString(event, "proto")))   flow->l4_proto = Utils::l4name2proto(s);
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseFlowMetadata(json_object *event_flow, ParsedFlow *flow) {
+  const char *s;
+
+  if((s = getString(event_flow, "start"))) flow->first_switched = Utils::str2epoch(s);
+  if((s = getString(event_flow, "end")))   flow->last_switched = Utils::str2epoch(s);
+  flow->in_pkts   = getInt(event_flow, "pkts_toserver");
+  flow->out_pkts  = getInt(event_flow, "pkts_toclient");
+  flow->in_bytes  = getInt(event_flow, "bytes_toserver");
+  flow->out_bytes = getInt(event_flow, "bytes_toclient");
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseNetflowMetadata(json_object *event_flow, ParsedFlow *flow) {
+  const char *s;
+
+  if((s = getString(event_flow, "start"))) flow->first_switched = Utils::str2epoch(s);
+  if((s = getString(event_flow, "end")))   flow->last_switched = Utils::str2epoch(s);
+  flow->in_pkts  = getInt(event_flow, "pkts");
+  flow->in_bytes = getInt(event_flow, "bytes");
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseAlertMetadata(json_object *event_alert, ParsedFlow *flow) {
+  json_object *external_alert = json_object_new_object();
+
+  /* The whole Suricata alert is kept, severity (1..255, usually 1..4) included */
+  if(external_alert) {
+    json_object_object_add(external_alert, "source", json_object_new_string("suricata"));
+    json_object_object_add(external_alert, "alert", json_object_get(event_alert));
+
+    if(flow->external_alert) free(flow->external_alert);
+    flow->external_alert = strdup(json_object_to_json_string(external_alert));
+
+    json_object_put(external_alert);
+  }
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseHTTPMetadata(json_object *event_http, ParsedFlow *flow) {
+  const char *s, *hostname, *url;
+
+  if((s = getString(event_http, "http_method")))
+    flow->http_method = ndpi_http_str2method(s, strlen(s));
+
+  flow->http_ret_code = getInt(event_http, "status");
+
+  if((hostname = getString(event_http, "hostname"))) {
+    if(flow->http_site) free(flow->http_site);
+    flow->http_site = strdup(hostname);
+
+    if((url = getString(event_http, "url"))) {
+      if(flow->http_url) free(flow->http_url);
+      if((flow->http_url = (char*)malloc(strlen(hostname) + strlen(url) + 1)) != NULL)
+	sprintf(flow->http_url, "%s%s", hostname, url);
+    }
+  }
+
+  /* Additional fields */
+  addField(flow, "HTTP_PROTOCOL", event_http, "protocol");
+  addField(flow, "HTTP_REFERER",  event_http, "http_refer");
+  addField(flow, "HTTP_MIME",     event_http, "http_content_type");
+  addField(flow, "HTTP_LENGTH",   event_http, "length");
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseFileInfoMetadata(json_object *event_fileinfo, ParsedFlow *flow) {
+  /* Additional fields */
+  addField(flow, "FILE_NAME",   event_fileinfo, "filename");
+  addField(flow, "FILE_SIZE",   event_fileinfo, "size");
+  addField(flow, "FILE_STATE",  event_fileinfo, "state");
+  addField(flow, "FILE_GAPS",   event_fileinfo, "gaps");
+  addField(flow, "FILE_STORED", event_fileinfo, "stored");
+  addField(flow, "FILE_ID",     event_fileinfo, "file_id");
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseDNSMetadata(json_object *event_dns, ParsedFlow *flow) {
+  const char *type = getString(event_dns, "type"), *rrname;
+
+  if(type && !strcmp(type, "query")) {
+    if((rrname = getString(event_dns, "rrname"))) {
+      if(flow->dns_query) free(flow->dns_query);
+      flow->dns_query = strdup(rrname);
+    }
+
+    flow->dns_query_type = dnsType(getString(event_dns, "rrtype"));
+  }
+
+  /* Additional fields */
+  addField(flow, "DNS_QUERY_ID", event_dns, "id");
+  addField(flow, "DNS_TX_ID",    event_dns, "tx_id");
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseTLSMetadata(json_object *event_tls, ParsedFlow *flow) {
+  const char *s;
+
+  if((s = getString(event_tls, "sni"))) {
+    if(flow->tls_server_name) free(flow->tls_server_name);
+    flow->tls_server_name = strdup(s);
+  }
+
+  if((s = getString(getObject(event_tls, "ja3"), "hash"))) {
+    if(flow->ja3c_hash) free(flow->ja3c_hash);
+    flow->ja3c_hash = strdup(s);
+  }
+
+  if((s = getString(getObject(event_tls, "ja3s"), "hash"))) {
+    if(flow->ja3s_hash) free(flow->ja3s_hash);
+    flow->ja3s_hash = strdup(s);
+  }
+
+  /* Additional fields */
+  addField(flow, "TLS_VERSION",         event_tls, "version");
+  addField(flow, "TLS_CERT_NOT_BEFORE", event_tls, "notbefore");
+  addField(flow, "TLS_CERT_AFTER",      event_tls, "notafter");
+  addField(flow, "TLS_CERT_SHA1",       event_tls, "fingerprint");
+  addField(flow, "TLS_CERT_SUBJECT",    event_tls, "subject");
+  addField(flow, "TLS_CERT_DN",         event_tls, "issuerdn");
+  addField(flow, "TLS_CERT_SN",         event_tls, "serial");
+}
+
+/* **************************************************** */
+
+void SuricataSyslogProducer::parseStats(json_object *event_stats) {
+  json_object *capture = getObject(event_stats, "capture"), *detect = getObject(event_stats, "detect");
+  json_object *engines, *external_stats;
+  int64_t kernel_packets = getInt(capture, "kernel_packets"), kernel_drops = getInt(capture, "kernel_drops");
+  int64_t signatures_loaded = 0, signatures_failed = 0;
+
+  if(detect && json_object_object_get_ex(detect, "engines", &engines)
+     && json_object_is_type(engines, json_type_array)) {
+    for(size_t i = 0; i < json_object_array_length(engines); i++) {
+      json_object *engine = json_object_array_get_idx(engines, i);
+
+      signatures_loaded += getInt(engine, "rules_loaded");
+      signatures_failed += getInt(engine, "rules_failed");
+    }
+  }
+
+  if((external_stats = json_object_new_object()) == NULL)
+    return;
+
+  json_object_object_add(external_stats, "capture_packets", json_object_new_int64(kernel_packets - kernel_drops));
+  json_object_object_add(external_stats, "capture_drops", json_object_new_int64(kernel_drops));
+  json_object_object_add(external_stats, "signatures_loaded", json_object_new_int64(signatures_loaded));
+  json_object_object_add(external_stats, "signatures_failed", json_object_new_int64(signatures_failed));
+  json_object_object_add(external_stats, "i18n_title", json_object_new_string("suricata_collector.statistics"));
+
+  ntop->getRedis()->set(external_stats_key, json_object_to_json_string(external_stats));
+  json_object_put(external_stats);
+}
+
+/* **************************************************** */
+
+u_int8_t SuricataSyslogProducer::handleEvent(char *message, const char *host, int priority) {
+  u_int32_t num_unhandled = 0, num_alerts = 0, num_collected_flows = 0;
+  json_object *event, *o;
+  const char *event_type, *timestamp;
+  ParsedFlow *flow = NULL;
+  u_int8_t num_flows = 0;
+
+  if(((event = json_tokener_parse(message)) == NULL)
+     || !json_object_is_type(event, json_type_object)) {
+    if(event) json_object_put(event);
+    incStats(1, 0, 0);
+    return(0);
+  }
+
+  event_type = getString(event, "event_type");
+
+  if(event_type && !strcmp(event_type, "stats")) {
+    if((o = getObject(event, "stats")))
+      parseStats(o);
+    else
+      num_unhandled++;
+
+    goto out;
+  }
+
+  if((flow = new (std::nothrow) ParsedFlow()) == NULL)
+    goto out;
+
+  parseFiveTuple(event, flow);
+
+  /* Additional (common) fields */
+  addField(flow, "SURICATA_FLOW_ID",  event, "flow_id");
+  addField(flow, "SURICATA_APP_PROTO", event, "app_proto");
+  addField(flow, "COMMUNITY_ID",      event, "community_id");
+
+  if(event_type == NULL)
+    num_unhandled++;
+  else if(!strcmp(event_type, "alert")) {
+    json_object *event_flow = getObject(event, "flow"), *event_alert = getObject(event, "alert");
+
+    if(event_flow && event_alert) {
+      parseFlowMetadata(event_flow, flow);
+      parseAlertMetadata(event_alert, flow);
+      num_alerts++;
+    } else
+      num_unhandled++;
+  } else if(!strcmp(event_type, "netflow") && (o = getObject(event, "netflow"))) {
+    parseNetflowMetadata(o, flow);
+    num_collected_flows++;
+  } else if(!strcmp(event_type, "http") && (o = getObject(event, "http"))) {
+    parseHTTPMetadata(o, flow);
+    num_collected_flows++;
+  } else if(!strcmp(event_type, "fileinfo")) {
+    const char *app_proto = getString(event, "app_proto");
+
+    if(app_proto && !strcmp(app_proto, "http") && (o = getObject(event, "http")))
+      parseHTTPMetadata(o, flow);
+
+    parseFileInfoMetadata(getObject(event, "fileinfo"), flow);
+    num_collected_flows++;
+  } else if(!strcmp(event_type, "dns") && (o = getObject(event, "dns"))) {
+    parseDNSMetadata(o, flow);
+    num_collected_flows++;
+  } else if(!strcmp(event_type, "tls") && (o = getObject(event, "tls"))) {
+    parseTLSMetadata(o, flow);
+    num_collected_flows++;
+  } else
+    num_unhandled++;
+
+  if((num_alerts > 0) || (num_collected_flows > 0)) {
+    /* If first/last ts is not available, use the event timestamp as last resort */
+    if((timestamp = getString(event, "timestamp"))) {
+      if(flow->first_switched == 0) flow->first_switched = Utils::str2epoch(timestamp);
+      if(flow->last_switched == 0)  flow->last_switched = Utils::str2epoch(timestamp);
+    }
+
+    /* Processing flow or alert */
+    processFlow(flow);
+    num_flows++;
+  }
+
+ out:
+  if(flow) delete flow;
+  json_object_put(event);
+
+  incStats(num_unhandled, num_alerts, num_collected_flows);
+
+  return(num_flows);
+}
+
+/* **************************************************** */
+
+#endif
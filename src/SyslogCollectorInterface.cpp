@@ -81,9 +81,15 @@ void SyslogCollectorInterface::closeSocket(syslog_socket *ss, int protocol) {
   close(ss->sock);
 
   if (protocol == SOCK_STREAM) { 
-    for(int i = 0; i < MAX_SYSLOG_SUBSCRIBERS; ++i)
+    for(int i = 0; i < MAX_SYSLOG_SUBSCRIBERS; ++i) {
       if(tcp_connections[i].socket != 0)
         Utils::closeSocket(tcp_connections[i].socket);
+
+      if(tcp_connections[i].framer) {
+        delete tcp_connections[i].framer;
+        tcp_connections[i].framer = NULL;
+      }
+    }
   }
 }
 
@@ -97,6 +103,16 @@ SyslogCollectorInterface::SyslogCollectorInterface(const char *_endpoint) : Sysl
   udp_socket.enable = true;
   tcp_socket.enable = true;
 
+  memset(tcp_connections, 0, sizeof(tcp_connections));
+  ctx = NULL;
+  recvStats.num_flows = 0;
+  recvStats.num_events = recvStats.num_bytes = 0;
+  recvStats.num_truncated = recvStats.num_connections = 0;
+#ifdef SYSLOG_USE_EPOLL
+  accept_epoll_fd = -1, next_reader = 0, readers_running = false;
+  memset(readers, 0, sizeof(readers));
+#endif
+
   endpoint = strdup(_endpoint);
 
   if(endpoint == NULL) 
@@ -173,6 +189,8 @@ SyslogCollectorInterface::~SyslogCollectorInterface() {
 
 /* **************************************************** */
 
+#ifndef SYSLOG_USE_EPOLL
+
 /* set FDs and returns the max sock */
 int SyslogCollectorInterface::initFDSetsSocket(syslog_socket *ss, 
     fd_set *read_fds, fd_set *write_fds, fd_set *except_fds, int protocol) {
@@ -216,7 +234,9 @@ int SyslogCollectorInterface::initFDSets(fd_set *read_fds, fd_set *write_fds, fd
   }
 
   return high_sock;
-}  
+}
+
+#endif
 
 /* **************************************************** */
 
@@ -240,14 +260,45 @@ int SyslogCollectorInterface::handleNewConnection() {
   
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Incoming connection from %s:%d", client_ipv4_str, client_addr.sin_port);
   
+  connections_lock.lock(__FILE__, __LINE__);
+
   for(i = 0; i < MAX_SYSLOG_SUBSCRIBERS; ++i) {
     if(tcp_connections[i].socket == 0) {
-      tcp_connections[i].socket = new_client_sock;
-      tcp_connections[i].address = client_addr;
-      snprintf(tcp_connections[i].ip_str, sizeof(tcp_connections[i].ip_str), "%s", client_ipv4_str);
+      syslog_client *client = &tcp_connections[i];
+
+      if(client->framer == NULL
+         && (client->framer = new (std::nothrow) SyslogStreamFramer()) == NULL)
+        break;
+
+      client->socket = new_client_sock;
+      client->address = client_addr;
+      snprintf(client->ip_str, sizeof(client->ip_str), "%s", client_ipv4_str);
+
+#ifdef SYSLOG_USE_EPOLL
+      {
+        struct epoll_event ev;
+
+        /* Spread connections across the readers */
+        client->reader_id = next_reader, next_reader = (next_reader + 1) % SYSLOG_NUM_READER_THREADS;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP, ev.data.ptr = client;
+
+        if(epoll_ctl(readers[client->reader_id].epoll_fd, EPOLL_CTL_ADD, new_client_sock, &ev) != 0) {
+          ntop->getTrace()->traceEvent(TRACE_ERROR, "epoll_ctl() failure: %s", strerror(errno));
+          client->socket = 0;
+          break;
+        }
+      }
+#endif
+
+      recvStats.num_connections++;
+      connections_lock.unlock(__FILE__, __LINE__);
       return 0;
     }
   }
+
+  connections_lock.unlock(__FILE__, __LINE__);
   
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Too many connections. Closing connection from %s:%d", 
     client_ipv4_str, client_addr.sin_port);
@@ -263,170 +314,319 @@ void SyslogCollectorInterface::closeConnection(syslog_client *client) {
 
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Closing client socket for %s:%d\n", 
     client->ip_str, client->address.sin_port);
+
+  connections_lock.lock(__FILE__, __LINE__);
+
+#ifdef SYSLOG_USE_EPOLL
+  epoll_ctl(readers[client->reader_id].epoll_fd, EPOLL_CTL_DEL, client->socket, NULL);
+#endif
   
   close(client->socket);
   client->socket = 0;
-}
 
-/* **************************************************** */
+  /* Drop the partial data of the old connection */
+  delete client->framer;
+  client->framer = NULL;
 
-#ifdef USE_RECVLINE
-int SyslogCollectorInterface::recvLine(int socket, char *buffer, size_t n) {
-  ssize_t num_read;
-  size_t tot_read = 0;
-  char c;
-
-  while (tot_read < n - 1) {
-
-    num_read = read(socket, &c, 1);
-
-    if (num_read == -1) {
-      if (errno == EINTR) continue;
-      else return -1;
-    } else if (num_read == 0) { /* EOF */
-      if (tot_read == 0) return 0;
-      else break;
-    } else {
-      if (tot_read < n - 1) {
-	tot_read++;
-	*buffer++ = c;
-      }
-      if (c == '\n') break;
-    }
-  }
-
-  *buffer = '\0';
+  if(recvStats.num_connections > 0) recvStats.num_connections--;
 
-  return tot_read;
+  connections_lock.unlock(__FILE__, __LINE__);
 }
-#endif
 
 /* **************************************************** */
 
-int SyslogCollectorInterface::receive(int socket, char *client_ip, bool use_recvfrom) {
+/* Reads a batch of UDP datagrams, each one possibly carrying several lines */
+int SyslogCollectorInterface::receive(int socket) {
   char buffer[8192];
   int len, received_total = 0;
   int buffer_size = sizeof(buffer) - 1;
   char *line, *pos;
   struct sockaddr_in client_addr;
-  socklen_t client_addr_len = sizeof(client_addr);
+  socklen_t client_addr_len;
   char ip_str[INET_ADDRSTRLEN];
 
-  // Note: do not loop to handle other clients in round robin
-  // and also handle purgeIdle
-  //do {
+  for(int i = 0; i < SYSLOG_MAX_EPOLL_EVENTS; i++) {
+    client_addr_len = sizeof(client_addr);
 
-    if (use_recvfrom)
-      len = recvfrom(socket,
+    len = recvfrom(socket,
 #ifndef WIN32
       (void *)
 #endif
-          buffer, buffer_size,
+      buffer, buffer_size,
 #ifndef WIN32
-        MSG_DONTWAIT
+      MSG_DONTWAIT
 #else
-        0
-#endif
-        , (struct sockaddr *) &client_addr, &client_addr_len);
-    else
-#ifdef USE_RECVLINE
-      /* Read single line to avoid splitting lines across chunks */
-      len = recvLine(socket, (char *) buffer, buffer_size);
-#else
-      len = recv(socket, (char *) buffer, buffer_size, 
-#ifndef WIN32
-        MSG_DONTWAIT
-#else
-	0
-#endif
-      );
+      0
 #endif
+      , (struct sockaddr *) &client_addr, &client_addr_len);
 
     if(len < 0) {
-      if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
         ntop->getTrace()->traceEvent(TRACE_INFO, "Client is not ready (%d)", errno);
-        goto done;
+        break;
       } else {
         ntop->getTrace()->traceEvent(TRACE_ERROR, "Client error");
         return -1;
       }
+    } else if(len == 0)
+      continue;
+
+    inet_ntop(AF_INET, &client_addr.sin_addr, ip_str, sizeof(ip_str));
+    received_total += len;
+    buffer[len] = '\0';
+
+    line = strtok_r(buffer, "\n", &pos);
+    while (line) {
+      recvStats.num_events++;
+      recvStats.num_flows += parseLog(ctx, line, ip_str);
+      line = strtok_r(NULL, "\n", &pos);
+    }
+  }
+
+  recvStats.num_bytes += received_total;
+  ntop->getTrace()->traceEvent(TRACE_INFO, "Total received bytes: %u", received_total);
+
+  return 0;
+}
+
+/* **************************************************** */
+
+/* Reads a chunk of the TCP stream and parses all the complete messages it contains */
+int SyslogCollectorInterface::receiveFromClient(SyslogParserContext *parser_ctx, syslog_client *client) {
+  SyslogStreamFramer *framer = client->framer;
+  u_int32_t truncated;
+  ssize_t len;
+  char *msg;
+
+  ntop->getTrace()->traceEvent(TRACE_INFO, "Trying to receive from %s:%d", 
+    client->ip_str, client->address.sin_port);
+
+  len = framer->fill(client->socket);
+
+  if(len < 0) {
+    if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      ntop->getTrace()->traceEvent(TRACE_INFO, "Client is not ready (%d)", errno);
+      return 0;
+    }
+
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Client error");
+    return -1;
+  } else if(len == 0) {
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Client shutdown");
+    return -1;
+  }
+
+  recvStats.num_bytes += len;
+  truncated = framer->getNumTruncated();
+
+  while((msg = framer->next()) != NULL) {
+    recvStats.num_events++;
+    recvStats.num_flows += parseLog(parser_ctx, msg, client->ip_str);
+  }
+
+  recvStats.num_truncated += framer->getNumTruncated() - truncated;
+
+  return 0;
+}
+
+/* **************************************************** */
+
+void SyslogCollectorInterface::purgeIdleEntries(time_t now) {
+  flushPendingEvents();
+
+  /* Flows are updated by the readers: purge in turn with them */
+  flow_lock.lock(__FILE__, __LINE__);
+  purgeIdle(now);
+  flow_lock.unlock(__FILE__, __LINE__);
+}
+
+/* **************************************************** */
+
+#ifdef SYSLOG_USE_EPOLL
+
+static void* syslogReaderLoop(void* ptr) {
+  syslog_reader *r = (syslog_reader*)ptr;
+
+  Utils::setThreadName("SyslogReader");
+  r->iface->readerLoop(r);
+
+  return(NULL);
+}
 
-    } else if(len == 0) {
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "Client shutdown");
-      return -1;
+/* **************************************************** */
+
+void SyslogCollectorInterface::readerLoop(syslog_reader *r) {
+  struct epoll_event events[SYSLOG_MAX_EPOLL_EVENTS];
+
+  while(readers_running && !ntop->getGlobals()->isShutdown()) {
+    int rc = epoll_wait(r->epoll_fd, events, SYSLOG_MAX_EPOLL_EVENTS, MAX_SYSLOG_POLL_WAIT_MS);
 
-    } else if(len > 0) {
-      if (client_ip == NULL && use_recvfrom) {
-        inet_ntop(AF_INET, &client_addr.sin_addr, ip_str, sizeof(ip_str));
-        client_ip = ip_str;      
+    for(int i = 0; i < rc; i++) {
+      syslog_client *client = (syslog_client*)events[i].data.ptr;
+
+      /* Read pending data first, then close on hang up */
+      if(events[i].events & EPOLLIN) {
+        if(receiveFromClient(r->ctx, client) != 0) {
+          closeConnection(client);
+          continue;
+        }
       }
-      received_total += len;
-      buffer[len] = '\0';
-      line = strtok_r(buffer, "\n", &pos);
-      while (line) {
-        recvStats.num_flows += parseLog(line, client_ip);
-        line = strtok_r(NULL, "\n", &pos);
+
+      if(events[i].events & (EPOLLERR | EPOLLHUP)) {
+        ntop->getTrace()->traceEvent(TRACE_ERROR, "Exception on TCP client fd");
+        closeConnection(client);
       }
     }
+  }
+}
 
-  //} while (len > 0);
-  
- done:
+/* **************************************************** */
 
-  ntop->getTrace()->traceEvent(TRACE_INFO, "Total received bytes: %u", received_total);
+bool SyslogCollectorInterface::startReaders() {
+  struct epoll_event ev;
 
-  return 0;
+  if((accept_epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    return(false);
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+
+  if(udp_socket.enable) {
+    ev.data.fd = udp_socket.sock;
+    epoll_ctl(accept_epoll_fd, EPOLL_CTL_ADD, udp_socket.sock, &ev);
+  }
+
+  if(tcp_socket.enable) {
+    ev.data.fd = tcp_socket.sock;
+    epoll_ctl(accept_epoll_fd, EPOLL_CTL_ADD, tcp_socket.sock, &ev);
+
+    readers_running = true;
+
+    for(int i = 0; i < SYSLOG_NUM_READER_THREADS; i++) {
+      readers[i].iface = this, readers[i].id = i;
+
+      if((readers[i].ctx = newParserContext()) == NULL)
+        return(false);
+
+      if((readers[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        return(false);
+
+      pthread_create(&readers[i].thread, NULL, syslogReaderLoop, (void*)&readers[i]);
+    }
+  }
+
+  return(true);
 }
 
 /* **************************************************** */
 
-int SyslogCollectorInterface::receiveFromClient(syslog_client *client) {
+void SyslogCollectorInterface::stopReaders() {
+  readers_running = false;
 
-  ntop->getTrace()->traceEvent(TRACE_INFO, "Trying to receive from %s:%d", 
-    client->ip_str, client->address.sin_port);
+  if(tcp_socket.enable) {
+    for(int i = 0; i < SYSLOG_NUM_READER_THREADS; i++) {
+      if(readers[i].epoll_fd > 0) {
+        void *res;
 
-  return receive(client->socket, client->ip_str, false);
+        pthread_join(readers[i].thread, &res);
+        close(readers[i].epoll_fd);
+        readers[i].epoll_fd = -1;
+      }
+
+      if(readers[i].ctx) {
+        delete readers[i].ctx;
+        readers[i].ctx = NULL;
+      }
+    }
+  }
+
+  if(accept_epoll_fd >= 0) {
+    close(accept_epoll_fd);
+    accept_epoll_fd = -1;
+  }
 }
 
+#endif
+
 /* **************************************************** */
 
 void SyslogCollectorInterface::collect_events() {
   u_int32_t max_num_polls_before_purge = MAX_SYSLOG_POLLS_BEFORE_PURGE;
+#ifdef SYSLOG_USE_EPOLL
+  struct epoll_event events[2];
+#else
   fd_set read_fds, write_fds, except_fds;
   struct timeval timeout;
-  time_t now, next_purge_idle = time(NULL) + FLOW_PURGE_FREQUENCY;;
   int high_sock;
+#endif
+  time_t now, next_purge_idle = time(NULL) + FLOW_PURGE_FREQUENCY;;
   int i, rc;
 
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Collecting events on %s", ifname);
 
+  if((ctx = newParserContext()) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to allocate the syslog parser context");
+    return;
+  }
+
+#ifdef SYSLOG_USE_EPOLL
+  if(!startReaders()) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to start the syslog readers: %s", strerror(errno));
+    goto out;
+  }
+#endif
+
   while (isRunning()) {
     while(idle()) {
-      purgeIdle(time(NULL));
+      purgeIdleEntries(time(NULL));
       sleep(1);
-      if(ntop->getGlobals()->isShutdown()) return;
+      if(ntop->getGlobals()->isShutdown()) goto out;
     }
 
+#ifdef SYSLOG_USE_EPOLL
+    /* TCP connections are read by the reader threads: only UDP and accept() here */
+    rc = epoll_wait(accept_epoll_fd, events, 2, MAX_SYSLOG_POLL_WAIT_MS);
+#else
     high_sock = initFDSets(&read_fds, &write_fds, &except_fds);
 
     timeout.tv_sec = MAX_SYSLOG_POLL_WAIT_MS/1000;
     timeout.tv_usec = (MAX_SYSLOG_POLL_WAIT_MS%1000)*1000;
 
     rc = select(high_sock + 1, &read_fds, &write_fds, &except_fds, &timeout);
+#endif
  
     now = time(NULL);
     max_num_polls_before_purge--;
     if(rc == 0 || now >= next_purge_idle || max_num_polls_before_purge == 0) {
-      purgeIdle(now);
+      purgeIdleEntries(now);
       next_purge_idle = now + FLOW_PURGE_FREQUENCY;
       max_num_polls_before_purge = MAX_SYSLOG_POLLS_BEFORE_PURGE;
     }
 
+#ifdef SYSLOG_USE_EPOLL
+    for(i = 0; i < rc; i++) {
+      if(udp_socket.enable && (events[i].data.fd == udp_socket.sock)) {
+        if(events[i].events & EPOLLIN) {
+          if(receive(udp_socket.sock) != 0)
+            ntop->getTrace()->traceEvent(TRACE_ERROR, "Error receiving from UDP socket fd");
+        }
+
+        if(events[i].events & EPOLLERR)
+          ntop->getTrace()->traceEvent(TRACE_ERROR, "Exception on listen UDP socket fd");
+      } else if(tcp_socket.enable && (events[i].data.fd == tcp_socket.sock)) {
+        if(events[i].events & EPOLLIN)
+          handleNewConnection();
+
+        if(events[i].events & EPOLLERR)
+          ntop->getTrace()->traceEvent(TRACE_ERROR, "Exception on listen TCP socket fd");
+      }
+    }
+#else
     if(rc > 0) {
           
       if (udp_socket.enable){
         if (FD_ISSET(udp_socket.sock, &read_fds)) {
-          if(receive(udp_socket.sock, NULL, true) != 0)
+          if(receive(udp_socket.sock) != 0)
             ntop->getTrace()->traceEvent(TRACE_ERROR, "Error receiving from UDP socket fd");
         }
 
@@ -444,7 +644,7 @@ void SyslogCollectorInterface::collect_events() {
       
         for(i = 0; i < MAX_SYSLOG_SUBSCRIBERS; ++i) {
           if(tcp_connections[i].socket != 0 && FD_ISSET(tcp_connections[i].socket, &read_fds)) {
-            if(receiveFromClient(&tcp_connections[i]) != 0) {
+            if(receiveFromClient(ctx, &tcp_connections[i]) != 0) {
               closeConnection(&tcp_connections[i]);
               continue;
             }
@@ -457,8 +657,17 @@ void SyslogCollectorInterface::collect_events() {
         }
       }
     }
+#endif
   }
 
+ out:
+#ifdef SYSLOG_USE_EPOLL
+  stopReaders();
+#endif
+
+  delete ctx;
+  ctx = NULL;
+
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Flow collection is over.");
 }
 
@@ -512,6 +721,10 @@ void SyslogCollectorInterface::lua(lua_State* vm) {
 
   lua_newtable(vm);
   lua_push_uint64_table_entry(vm, "flows", recvStats.num_flows);
+  lua_push_uint64_table_entry(vm, "events", recvStats.num_events);
+  lua_push_uint64_table_entry(vm, "bytes", recvStats.num_bytes);
+  lua_push_uint64_table_entry(vm, "truncated", recvStats.num_truncated);
+  lua_push_uint64_table_entry(vm, "connections", recvStats.num_connections);
   lua_pushstring(vm, "syslogRecvStats");
   lua_insert(vm, -2);
   lua_settable(vm, -3);
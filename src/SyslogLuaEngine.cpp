@@ -24,7 +24,10 @@
 /* ****************************************** */
 
 SyslogLuaEngine::SyslogLuaEngine(NetworkInterface *iface) : LuaEngine(NULL) {
-  initialized = false;
+  initialized = batch_supported = false;
+  num_batched = batch_buf_len = 0, batch_first_time = 0;
+  batch = (syslog_lua_event*)calloc(SYSLOG_LUA_BATCH_SIZE, sizeof(syslog_lua_event));
+  batch_buf = (char*)malloc(SYSLOG_LUA_BATCH_BUFFER_SIZE);
 
   snprintf(script_path, sizeof(script_path), "%s/%s",
 	   ntop->getPrefs()->get_scripts_dir(), 
@@ -49,11 +52,21 @@ SyslogLuaEngine::SyslogLuaEngine(NetworkInterface *iface) : LuaEngine(NULL) {
   lua_getglobal(L, "setup");
   if (lua_isfunction(L, -1))
     pcall(0 /* no argument */, 0);
+
+  /* Scripts without handleEvents() get the events one by one */
+  lua_getglobal(L, SYSLOG_SCRIPT_CALLBACK_EVENTS);
+  batch_supported = lua_isfunction(L, -1) && batch && batch_buf;
+  lua_pop(L, 1);
 }
 
 /* ****************************************** */
 
 SyslogLuaEngine::~SyslogLuaEngine() {
+  flushEvents();
+
+  if (batch)     free(batch);
+  if (batch_buf) free(batch_buf);
+
   if (!initialized)
     return;
 
@@ -93,3 +106,122 @@ void SyslogLuaEngine::handleEvent(const char *producer, const char *message,
   pcall(4 /* num args */, 0);
 }
 
+/* **************************************************** */
+
+bool SyslogLuaEngine::isProducerEnabled(const char *producer) {
+  lua_State *L = getState();
+  bool rv = false;
+
+  lua_getglobal(L, SYSLOG_SCRIPT_PRODUCER_ENABLED);
+
+  if (!lua_isfunction(L, -1)) {
+    lua_pop(L, 1);
+    return false;
+  }
+
+  lua_pushstring(L, producer);
+
+  if (pcall(1 /* num args */, 1 /* num results */))
+    rv = lua_toboolean(L, -1) ? true : false;
+
+  lua_settop(L, 0);
+
+  return rv;
+}
+
+/* **************************************************** */
+
+u_int32_t SyslogLuaEngine::copyString(const char *s) {
+  u_int32_t offset = batch_buf_len, len = strlen(s) + 1;
+
+  memcpy(&batch_buf[offset], s, len);
+  batch_buf_len += len;
+
+  return(offset);
+}
+
+/* **************************************************** */
+
+void SyslogLuaEngine::queueEvent(const char *producer, const char *message,
+    const char *host, int priority, SyslogProducerStats *stats) {
+  syslog_lua_event *ev;
+  u_int32_t len;
+  ticks begin;
+
+  if (!producer) producer = "";
+  if (!message)  message = "";
+  if (!host)     host = "";
+
+  len = strlen(producer) + strlen(message) + strlen(host) + 3;
+
+  if (batch_supported && (batch_buf_len + len > SYSLOG_LUA_BATCH_BUFFER_SIZE))
+    flushEvents(); /* Make room */
+
+  if (!batch_supported || (len > SYSLOG_LUA_BATCH_BUFFER_SIZE)) {
+    begin = Utils::getticks();
+    handleEvent(producer, message, host, priority);
+
+    if (stats)
+      stats->num_events++, stats->tot_ticks += Utils::getticks() - begin;
+
+    return;
+  }
+
+  if (num_batched == 0)
+    batch_first_time = time(NULL);
+
+  ev = &batch[num_batched++];
+  ev->producer = copyString(producer);
+  ev->message = copyString(message);
+  ev->host = copyString(host);
+  ev->priority = priority;
+  ev->stats = stats;
+
+  if (num_batched == SYSLOG_LUA_BATCH_SIZE)
+    flushEvents();
+}
+
+/* **************************************************** */
+
+/*
+  Delivers the batched events with a single handleEvents() call. Events
+  are passed as a flat array: producer, message, host, priority, producer, ...
+*/
+void SyslogLuaEngine::flushEvents() {
+  lua_State *L;
+  ticks begin, per_event;
+
+  if (num_batched == 0)
+    return;
+
+  L = getState();
+  begin = Utils::getticks();
+
+  lua_getglobal(L, SYSLOG_SCRIPT_CALLBACK_EVENTS);
+  lua_createtable(L, num_batched * 4, 0);
+
+  for (u_int32_t i = 0; i < num_batched; i++) {
+    syslog_lua_event *ev = &batch[i];
+
+    lua_pushstring(L, &batch_buf[ev->producer]);
+    lua_rawseti(L, -2, i * 4 + 1);
+    lua_pushstring(L, &batch_buf[ev->message]);
+    lua_rawseti(L, -2, i * 4 + 2);
+    lua_pushstring(L, &batch_buf[ev->host]);
+    lua_rawseti(L, -2, i * 4 + 3);
+    lua_pushinteger(L, ev->priority);
+    lua_rawseti(L, -2, i * 4 + 4);
+  }
+
+  pcall(1 /* num args */, 0);
+
+  /* The cost of the call is split evenly among the events of the batch */
+  per_event = (Utils::getticks() - begin) / num_batched;
+
+  for (u_int32_t i = 0; i < num_batched; i++) {
+    if (batch[i].stats)
+      batch[i].stats->num_events++, batch[i].stats->tot_ticks += per_event;
+  }
+
+  num_batched = batch_buf_len = 0;
+}
@@ -43,23 +43,121 @@ void SyslogParserInterface::startPacketPolling() {
 
 /* **************************************************** */
 
+SyslogParserContext::~SyslogParserContext() {
+  for (native_producers_map_t::iterator it = native_producers.begin(); it != native_producers.end(); ++it)
+    delete it->second;
+}
+
+/* **************************************************** */
+
+/* Called by each reader thread, after startPacketPolling() */
+SyslogParserContext* SyslogParserInterface::newParserContext() {
+  SyslogParserContext *ctx = new (std::nothrow) SyslogParserContext();
+
+  if (ctx == NULL)
+    return NULL;
+
+  /* Common formats parsed natively (see CONST_PREFS_SYSLOG_NATIVE_PRODUCERS),
+     in place of the Lua module of the producer when that is enabled */
+  addNativeProducer(ctx, new (std::nothrow) SuricataSyslogProducer(this));
+  addNativeProducer(ctx, new (std::nothrow) KeyValueSyslogProducer(this, "fortinet"));
+  addNativeProducer(ctx, new (std::nothrow) KeyValueSyslogProducer(this, "sophos"));
+  addNativeProducer(ctx, new (std::nothrow) CEFSyslogProducer(this));
+
+  return ctx;
+}
+
+/* **************************************************** */
+
 SyslogParserInterface::~SyslogParserInterface() {
   if (le)
     delete le;
+
+  for (producers_stats_map_t::iterator it = producers_stats.begin(); it != producers_stats.end(); ++it)
+    delete it->second;
+}
+
+/* **************************************************** */
+
+void SyslogParserInterface::addNativeProducer(SyslogParserContext *ctx, SyslogProducer *p) {
+  bool enabled;
+
+  if (p == NULL)
+    return;
+
+  le_lock.lock(__FILE__, __LINE__);
+  enabled = le && le->isProducerEnabled(p->getName());
+  le_lock.unlock(__FILE__, __LINE__);
+
+  if (enabled)
+    ctx->native_producers[string(p->getName())] = p;
+  else
+    delete p;
+}
+
+/* **************************************************** */
+
+SyslogProducer* SyslogParserInterface::getNativeProducer(SyslogParserContext *ctx, const char *name) {
+  SyslogParserContext::native_producers_map_t::const_iterator it;
+
+  if (!ntop->getPrefs()->useSyslogNativeProducers())
+    return NULL;
+
+  if ((it = ctx->native_producers.find(string(name))) != ctx->native_producers.end())
+    return it->second;
+
+  return NULL;
+}
+
+/* **************************************************** */
+
+SyslogProducerStats* SyslogParserInterface::getProducerStats(SyslogParserContext *ctx, const char *name, bool native) {
+  string producer(name);
+  producers_stats_map_t::iterator it;
+  SyslogProducerStats *stats;
+
+  if ((it = ctx->producers_stats.find(producer)) != ctx->producers_stats.end()) {
+    stats = it->second;
+  } else {
+    /* First event of the producer on this context: shared with the other readers and lua() */
+    producers_stats_lock.lock(__FILE__, __LINE__);
+
+    if ((it = producers_stats.find(producer)) != producers_stats.end())
+      stats = it->second;
+    else if ((producers_stats.size() >= SYSLOG_MAX_PRODUCERS_STATS)
+	     || ((stats = new (std::nothrow) SyslogProducerStats()) == NULL))
+      stats = NULL;
+    else
+      producers_stats[producer] = stats;
+
+    producers_stats_lock.unlock(__FILE__, __LINE__);
+
+    if (stats == NULL)
+      return NULL;
+
+    ctx->producers_stats[producer] = stats;
+  }
+
+  stats->native = native; /* The native producers can be toggled at runtime */
+
+  return stats;
 }
 
 /* **************************************************** */
 
-u_int8_t SyslogParserInterface::parseLog(char *log_line, char *client_ip) {
+/* Can be called concurrently by the reader threads, each one with its own context */
+u_int8_t SyslogParserInterface::parseLog(SyslogParserContext *ctx, char *log_line, char *client_ip) {
   const char *producer_name = NULL;
+  char mapped_name[64];
   char *prio = NULL, *parsed_client_ip = NULL, *device = NULL, *application = NULL, *content = NULL;
   char *tmp;
+  bool is_cef = false;
   u_int32_t num_total_events = 0, num_malformed = 0;
+  SyslogProducer *native_producer;
+  u_int8_t num_flows = 0;
 
-  if (producers_reload_requested) {
+  if (producers_reload_requested.exchange(false))
     doProducersMappingUpdate();
-    producers_reload_requested = false;
-  }
 
   /* Event parsing */
 
@@ -107,6 +205,17 @@ u_int8_t SyslogParserInterface::parseLog(char *log_line, char *client_ip) {
   if (strncmp(log_line, "date=", 5) == 0) { /* Parse custom Fortinet format */
     producer_name = "fortinet"; /* fortinet detected */
     content = log_line;
+  } else if ((tmp = strstr(log_line, "CEF:")) != NULL
+	     && (tmp == log_line || tmp[-1] == ' ')) { /* Common Event Format */
+    is_cef = true; /* Only used when the host has no producer mapping */
+    content = tmp;
+
+    if (tmp != log_line) { /* Parse {TIMESTAMP} DEVICE */
+      tmp[-1] = '\0';
+      device = strrchr(log_line, ' ');
+      device = (device != NULL) ? &device[1] : log_line;
+      if (device[0] == '\0') device = NULL;
+    }
   } else if ((tmp = strstr(log_line, "]: ")) != NULL) { /* Parse APPLICATION[PID]: */
     content = &tmp[3];
     tmp[1] = '\0';
@@ -149,16 +258,16 @@ u_int8_t SyslogParserInterface::parseLog(char *log_line, char *client_ip) {
 
   if (producer_name == NULL && parsed_client_ip != NULL) {
     Utils::stringtolower(parsed_client_ip); /* normalize */
-    producer_name = getProducerName(parsed_client_ip);
+    producer_name = getProducerName(parsed_client_ip, mapped_name, sizeof(mapped_name));
   }
 
   if (producer_name == NULL && device != NULL) {
     Utils::stringtolower(device); /* normalize */
-    producer_name = getProducerName(device);
+    producer_name = getProducerName(device, mapped_name, sizeof(mapped_name));
   }
 
   if (producer_name == NULL && client_ip != NULL) {
-    producer_name = getProducerName(client_ip);
+    producer_name = getProducerName(client_ip, mapped_name, sizeof(mapped_name));
   }
 
   if (producer_name == NULL && application != NULL) {
@@ -167,9 +276,12 @@ u_int8_t SyslogParserInterface::parseLog(char *log_line, char *client_ip) {
   }
 
   if (producer_name == NULL) {
-    producer_name = getProducerName("*");
+    producer_name = getProducerName("*", mapped_name, sizeof(mapped_name));
   }
 
+  if (producer_name == NULL && is_cef)
+    producer_name = "cef";
+
   if (producer_name == NULL)
     goto exit;
 
@@ -180,33 +292,115 @@ u_int8_t SyslogParserInterface::parseLog(char *log_line, char *client_ip) {
 
   /* Dispatching */
 
-  if (le) 
-    le->handleEvent(producer_name, content, 
-      parsed_client_ip ? parsed_client_ip : client_ip, 
+  if ((native_producer = getNativeProducer(ctx, producer_name)) != NULL) {
+    SyslogProducerStats *stats = getProducerStats(ctx, producer_name, true);
+    ticks begin = Utils::getticks();
+
+    num_flows = native_producer->handleEvent(content,
+      parsed_client_ip ? parsed_client_ip : client_ip,
       prio ? atoi(prio) : 0);
 
+    if (stats)
+      stats->num_events++, stats->tot_ticks += Utils::getticks() - begin;
+  } else if (le) {
+    SyslogProducerStats *stats = getProducerStats(ctx, producer_name, false);
+
+    le_lock.lock(__FILE__, __LINE__);
+
+    le->queueEvent(producer_name, content,
+      parsed_client_ip ? parsed_client_ip : client_ip,
+      prio ? atoi(prio) : 0,
+      stats);
+
+    /* Do not hold events of slow producers for too long */
+    if (le->hasExpiredEvents(time(NULL)))
+      le->flushEvents();
+
+    le_lock.unlock(__FILE__, __LINE__);
+  }
+
  exit:
   incSyslogStats(num_total_events, num_malformed, 0, 0, 0, 0, 0);
-  return 0;
+  return num_flows;
+}
+
+/* **************************************************** */
+
+/* Delivers the events batched for Lua */
+void SyslogParserInterface::flushPendingEvents(bool force) {
+  if (le == NULL)
+    return;
+
+  le_lock.lock(__FILE__, __LINE__);
+
+  if (force || le->hasExpiredEvents(time(NULL)))
+    le->flushEvents();
+
+  le_lock.unlock(__FILE__, __LINE__);
+}
+
+/* **************************************************** */
+
+/* Flows are created and updated concurrently by the producers of the readers */
+bool SyslogParserInterface::processFlow(ParsedFlow *zflow) {
+  bool rc;
+
+  flow_lock.lock(__FILE__, __LINE__);
+  rc = ParserInterface::processFlow(zflow);
+  flow_lock.unlock(__FILE__, __LINE__);
+
+  return rc;
+}
+
+/* **************************************************** */
+
+void SyslogParserInterface::luaProducerStats(lua_State* vm) {
+  static ticks tps = 0;
+
+  if (tps == 0) tps = Utils::gettickspersec(); /* Sleeps ~2 msec: compute it once */
+
+  lua_newtable(vm);
+
+  producers_stats_lock.lock(__FILE__, __LINE__);
+
+  for (producers_stats_map_t::const_iterator it = producers_stats.begin(); it != producers_stats.end(); ++it) {
+    SyslogProducerStats *stats = it->second;
+    u_int64_t n = stats->num_events, t = stats->tot_ticks;
+
+    lua_newtable(vm);
+
+    lua_push_bool_table_entry(vm, "native", stats->native);
+    lua_push_uint64_table_entry(vm, "events", n);
+    lua_push_float_table_entry(vm, "avg_usec", n ? ((t * 1000000.) / n / tps) : 0);
+    /* Events that can be handled per second of processing */
+    lua_push_float_table_entry(vm, "events_per_sec", t ? ((n * (float)tps) / t) : 0);
+
+    lua_pushstring(vm, it->first.c_str());
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
+
+  producers_stats_lock.unlock(__FILE__, __LINE__);
+
+  lua_pushstring(vm, "syslogProducerStats");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
 }
 
 /* **************************************************** */
 
 void SyslogParserInterface::lua(lua_State* vm) {
   NetworkInterface::lua(vm);
+
+  luaProducerStats(vm);
 }
 
 /* **************************************************** */
 
 void SyslogParserInterface::addProducerMapping(const char *host, const char *producer) {
-  string host_ip(host);
-  string producer_name(producer);
-  producers_map_t::iterator it;
-
-  if((it = producers_map.find(host_ip)) == producers_map.end())
-    producers_map.insert(make_pair(host_ip, producer_name));
-  else
-    it->second = producer_name;
+  producers_map_lock.wrlock(__FILE__, __LINE__);
+  producers_map[string(host)] = string(producer);
+  producers_map_lock.unlock(__FILE__, __LINE__);
 }
 
 /* **************************************************** */
@@ -214,10 +408,9 @@ void SyslogParserInterface::addProducerMapping(const char *host, const char *pro
 void SyslogParserInterface::doProducersMappingUpdate() {
   char key[64];
   char **keys, **values;
+  producers_map_t new_map;
   int rc;
 
-  producers_map.clear();
-
   snprintf(key, sizeof(key), SYSLOG_PRODUCERS_MAP_KEY, get_id()); 
 
   rc = ntop->getRedis()->hashGetAll(key, &keys, &values);
@@ -227,7 +420,7 @@ void SyslogParserInterface::doProducersMappingUpdate() {
       if (keys[i] && values[i]) {
         ntop->getTrace()->traceEvent(TRACE_INFO, "Adding syslog producer %s (%s)", keys[i], values[i]);
         Utils::stringtolower(keys[i]); /* normalize */
-        addProducerMapping(keys[i], values[i]);
+        new_map[string(keys[i])] = string(values[i]);
       }
 
       if(values[i]) free(values[i]);
@@ -237,18 +430,31 @@ void SyslogParserInterface::doProducersMappingUpdate() {
     free(keys);
     free(values);
   }
+
+  /* The readers keep parsing with the old mapping meanwhile */
+  producers_map_lock.wrlock(__FILE__, __LINE__);
+  producers_map.swap(new_map);
+  producers_map_lock.unlock(__FILE__, __LINE__);
 }
 
 /* **************************************************** */
 
-const char *SyslogParserInterface::getProducerName(const char *host) {
+/* Copies the name to buf: the mapping can be reloaded while it is in use */
+const char *SyslogParserInterface::getProducerName(const char *host, char *buf, u_int buf_len) {
   string host_ip(host);
   producers_map_t::const_iterator it;
+  const char *name = NULL;
 
-  if((it = producers_map.find(host_ip)) != producers_map.end())
-    return it->second.c_str();
+  producers_map_lock.rdlock(__FILE__, __LINE__);
 
-  return NULL;
+  if((it = producers_map.find(host_ip)) != producers_map.end()) {
+    snprintf(buf, buf_len, "%s", it->second.c_str());
+    name = buf;
+  }
+
+  producers_map_lock.unlock(__FILE__, __LINE__);
+
+  return name;
 }
 
 /* **************************************************** */
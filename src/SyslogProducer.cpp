@@ -0,0 +1,92 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#ifndef HAVE_NEDGE
+
+/* **************************************************** */
+
+void SyslogProducer::processFlow(ParsedFlow *flow) {
+  iface->processFlow(flow);
+}
+
+/* **************************************************** */
+
+/* Same accounting as interface.incSyslogStats() called by the Lua modules */
+void SyslogProducer::incStats(u_int32_t num_unhandled, u_int32_t num_alerts, u_int32_t num_collected_flows) {
+  iface->incSyslogStats(0, 0, 1 /* dispatched */, num_unhandled, num_alerts, 0, num_collected_flows);
+}
+
+/* **************************************************** */
+
+/* Builds the { source, alert: { signature, category, severity } } JSON read by the ExternalAlertCheck */
+char* SyslogProducer::buildExternalAlert(const char *source, const char *signature,
+					 const char *category, int severity) {
+  json_object *o, *alert;
+  char *rsp;
+
+  if((o = json_object_new_object()) == NULL)
+    return(NULL);
+
+  if((alert = json_object_new_object()) == NULL) {
+    json_object_put(o);
+    return(NULL);
+  }
+
+  json_object_object_add(o, "source", json_object_new_string(source));
+  if(signature) json_object_object_add(alert, "signature", json_object_new_string(signature));
+  if(category)  json_object_object_add(alert, "category", json_object_new_string(category));
+  json_object_object_add(alert, "severity", json_object_new_int(severity));
+  json_object_object_add(o, "alert", alert);
+
+  rsp = strdup(json_object_to_json_string(o));
+  json_object_put(o);
+
+  return(rsp);
+}
+
+/* **************************************************** */
+
+/* Protocols are reported either as numbers or as names, in any case */
+u_int8_t SyslogProducer::str2proto(const char *proto) {
+  char name[16];
+  u_int i;
+
+  if(proto == NULL)
+    return(0);
+
+  if(isdigit(proto[0]))
+    return((u_int8_t)atoi(proto));
+
+  for(i = 0; proto[i] && (i < sizeof(name) - 1); i++)
+    name[i] = toupper(proto[i]);
+  name[i] = '\0';
+
+  if(!strcmp(name, "IPV6-ICMP") || !strcmp(name, "ICMPV6"))
+    return(58);
+
+  return(Utils::l4name2proto(name));
+}
+
+/* **************************************************** */
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* **************************************************** */
+
+SyslogStreamFramer::SyslogStreamFramer(u_int32_t _size) {
+  size = _size - 1;
+  begin = end = skip = 0, skip_line = false;
+  saved_pos = NULL, saved_char = '\0';
+  num_truncated = 0;
+
+  if((buf = (char*)malloc(_size)) == NULL)
+    throw("memory allocation error");
+}
+
+/* **************************************************** */
+
+SyslogStreamFramer::~SyslogStreamFramer() {
+  free(buf);
+}
+
+/* **************************************************** */
+
+ssize_t SyslogStreamFramer::fill(int sock) {
+  ssize_t len;
+
+  restore();
+
+  if(begin == end)
+    begin = end = 0;
+  else if((begin > 0) && (end == size)) {
+    /* Make room for the rest of the partial message */
+    memmove(buf, &buf[begin], end - begin);
+    end -= begin, begin = 0;
+  }
+
+  do {
+    len = recv(sock, &buf[end], size - end,
+#ifndef WIN32
+	       MSG_DONTWAIT
+#else
+	       0
+#endif
+	       );
+  } while((len < 0) && (errno == EINTR));
+
+  if(len > 0)
+    end += len;
+
+  return(len);
+}
+
+/* **************************************************** */
+
+char* SyslogStreamFramer::terminate(u_int32_t msg_begin, u_int32_t msg_end) {
+  char *msg = &buf[msg_begin];
+  u_int32_t msg_len = msg_end - msg_begin;
+
+  if(msg_end < end)
+    saved_pos = &buf[msg_end], saved_char = buf[msg_end];
+
+  buf[msg_end] = '\0'; /* size + 1 bytes are allocated */
+
+  /* Strip the trailer of non-transparent framing */
+  while((msg_len > 0) && ((msg[msg_len - 1] == '\r') || (msg[msg_len - 1] == '\0')))
+    msg[--msg_len] = '\0';
+
+  return(msg);
+}
+
+/* **************************************************** */
+
+char* SyslogStreamFramer::next() {
+  restore();
+
+  if(skip > 0) {
+    u_int32_t n = min_val(skip, end - begin);
+
+    begin += n, skip -= n;
+  }
+
+  if(skip_line) {
+    char *lf = (char*)memchr(&buf[begin], '\n', end - begin);
+
+    if(lf == NULL) {
+      begin = end;
+      return(NULL);
+    }
+
+    begin = (lf - buf) + 1, skip_line = false;
+  }
+
+  /* Skip empty lines and separators between frames */
+  while((begin < end) && ((buf[begin] == '\n') || (buf[begin] == '\r') || (buf[begin] == '\0')))
+    begin++;
+
+  if(begin == end)
+    return(NULL);
+
+  if(isdigit(buf[begin])) {
+    /* Octet counting: MSG-LEN SP SYSLOG-MSG */
+    u_int32_t i = begin, msg_len = 0;
+
+    while((i < end) && isdigit(buf[i]) && (i - begin < 9))
+      msg_len = msg_len * 10 + (buf[i++] - '0');
+
+    if(i + 1 >= end)
+      return(NULL); /* Header not complete yet */
+
+    /* A framed message starts with its <PRI>: this tells "123 <PRI>..." from "2022-..." lines */
+    if((buf[i] == ' ') && (buf[i + 1] == '<') && (msg_len > 0)) {
+      u_int32_t msg_begin = i + 1;
+
+      if(msg_begin + msg_len <= end) {
+	begin = msg_begin + msg_len;
+	return(terminate(msg_begin, begin));
+      }
+
+      if((begin == 0) && (end == size)) {
+	/* Longer than the whole buffer: deliver what we have */
+	num_truncated++;
+	skip = msg_begin + msg_len - end, begin = end;
+	return(terminate(msg_begin, end));
+      }
+
+      return(NULL);
+    }
+
+    /* Not an octet count: the line starts with digits (e.g. a timestamp) */
+  }
+
+  /* Non-transparent framing: MSG LF */
+  {
+    char *lf = (char*)memchr(&buf[begin], '\n', end - begin);
+    u_int32_t msg_begin = begin;
+
+    if(lf != NULL) {
+      u_int32_t msg_end = lf - buf;
+
+      begin = msg_end + 1;
+      return(terminate(msg_begin, msg_end));
+    }
+
+    if((begin == 0) && (end == size)) {
+      num_truncated++;
+      begin = end, skip_line = true;
+      return(terminate(msg_begin, end));
+    }
+  }
+
+  return(NULL);
+}
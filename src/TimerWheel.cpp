@@ -0,0 +1,87 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+/* ***************************************** */
+
+TimerWheel::TimerWheel(u_int64_t now_tick) {
+  current = now_tick, num_timers = 0;
+}
+
+/* ***************************************** */
+
+/* expire > current */
+void TimerWheel::insert(u_int32_t id, u_int64_t expire) {
+  timer_wheel_entry e;
+  u_int64_t delta = expire - current;
+
+  e.id = id, e.expire = expire;
+
+  if(delta < TIMER_WHEEL_NUM_SLOTS)
+    inner[expire & TIMER_WHEEL_SLOT_MASK].push_back(e);
+  else {
+    /* Too far: parked in the farthest outer slot, rescheduled when moved */
+    if(delta >= ((u_int64_t)TIMER_WHEEL_NUM_SLOTS << TIMER_WHEEL_SLOT_BITS))
+      expire = current + ((u_int64_t)TIMER_WHEEL_NUM_SLOTS << TIMER_WHEEL_SLOT_BITS) - 1;
+
+    outer[(expire >> TIMER_WHEEL_SLOT_BITS) & TIMER_WHEEL_SLOT_MASK].push_back(e);
+  }
+}
+
+/* ***************************************** */
+
+void TimerWheel::schedule(u_int32_t id, u_int64_t expire_tick) {
+  insert(id, max_val(expire_tick, current + 1));
+  num_timers++;
+}
+
+/* ***************************************** */
+
+void TimerWheel::advance(u_int64_t now_tick, std::vector<u_int32_t> *expired) {
+  while(current < now_tick) {
+    std::vector<timer_wheel_entry> *slot;
+
+    current++;
+
+    if((current & TIMER_WHEEL_SLOT_MASK) == 0) {
+      /* Cascade the outer slot of this round into the inner wheel */
+      std::vector<timer_wheel_entry> moved;
+
+      moved.swap(outer[(current >> TIMER_WHEEL_SLOT_BITS) & TIMER_WHEEL_SLOT_MASK]);
+
+      for(std::vector<timer_wheel_entry>::iterator it = moved.begin(); it != moved.end(); ++it) {
+	if(it->expire <= current)
+	  expired->push_back(it->id), num_timers--;
+	else
+	  insert(it->id, it->expire);
+      }
+    }
+
+    slot = &inner[current & TIMER_WHEEL_SLOT_MASK];
+
+    for(std::vector<timer_wheel_entry>::iterator it = slot->begin(); it != slot->end(); ++it)
+      expired->push_back(it->id);
+
+    num_timers -= slot->size();
+    slot->clear(); /* Keeps the capacity: no allocations at steady state */
+  }
+}
@@ -0,0 +1,364 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#define TS_MAX_INTEGRAL 9007199254740992.0 /* 2^53: doubles are exact up to here */
+
+/* *************************************** */
+
+class TsBitWriter {
+ private:
+  std::string *out;
+  u_int64_t acc;
+  u_int8_t num_bits;
+
+ public:
+  TsBitWriter(std::string *_out) { out = _out, acc = 0, num_bits = 0; };
+
+  /* n <= 32 */
+  inline void write(u_int64_t v, u_int8_t n) {
+    acc = (acc << n) | (v & ((1ULL << n) - 1)), num_bits += n;
+
+    while(num_bits >= 8) {
+      num_bits -= 8;
+      out->push_back((char)((acc >> num_bits) & 0xFF));
+    }
+  };
+
+  inline void write64(u_int64_t v, u_int8_t n) {
+    if(n > 32) write(v >> 32, n - 32), n = 32;
+    write(v, n);
+  };
+
+  inline void flush() {
+    if(num_bits > 0)
+      out->push_back((char)((acc << (8 - num_bits)) & 0xFF)), num_bits = 0;
+  };
+};
+
+/* *************************************** */
+
+class TsBitReader {
+ private:
+  const u_int8_t *buf;
+  u_int32_t len, pos; /* pos in bits */
+
+ public:
+  TsBitReader(const u_int8_t *_buf, u_int32_t _len) { buf = _buf, len = _len, pos = 0; };
+
+  inline bool read(u_int8_t n, u_int64_t *v) {
+    u_int64_t r = 0;
+
+    if(pos + n > (u_int64_t)len * 8)
+      return(false);
+
+    while(n > 0) {
+      u_int8_t avail = 8 - (pos & 7), take = min_val(avail, n);
+      u_int8_t bits = (buf[pos >> 3] >> (avail - take)) & ((1 << take) - 1);
+
+      r = (r << take) | bits, pos += take, n -= take;
+    }
+
+    *v = r;
+    return(true);
+  };
+};
+
+/* *************************************** */
+
+void TimeseriesCodec::putVarint(u_int64_t v, std::string *out) {
+  while(v >= 0x80) {
+    out->push_back((char)((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+
+  out->push_back((char)v);
+}
+
+/* *************************************** */
+
+u_int32_t TimeseriesCodec::getVarint(const u_int8_t *buf, u_int32_t len, u_int64_t *v) {
+  u_int64_t r = 0;
+
+  for(u_int32_t i = 0; (i < len) && (i < 10); i++) {
+    r |= ((u_int64_t)(buf[i] & 0x7F)) << (7 * i);
+
+    if((buf[i] & 0x80) == 0) {
+      *v = r;
+      return(i + 1);
+    }
+  }
+
+  return(0);
+}
+
+/* *************************************** */
+
+bool TimeseriesCodec::isIntegral(const double *values, u_int32_t n) {
+  for(u_int32_t i = 0; i < n; i++) {
+    double v = values[i];
+
+    /* Also false for NaN */
+    if(!((v > -TS_MAX_INTEGRAL) && (v < TS_MAX_INTEGRAL) && (v == floor(v))))
+      return(false);
+  }
+
+  return(true);
+}
+
+/* *************************************** */
+
+void TimeseriesCodec::encodeDelta(const double *values, u_int32_t n, std::string *out) {
+  int64_t prev = 0, prev_delta = 0;
+
+  for(u_int32_t i = 0; i < n; i++) {
+    int64_t v = (int64_t)values[i];
+    int64_t delta = (i == 0) ? v : (v - prev);
+    int64_t dd = delta - prev_delta;
+
+    putVarint(((u_int64_t)dd << 1) ^ (u_int64_t)(dd >> 63), out); /* zigzag */
+    prev = v, prev_delta = (i == 0) ? 0 : delta;
+  }
+}
+
+/* *************************************** */
+
+bool TimeseriesCodec::decodeDelta(const u_int8_t *buf, u_int32_t len, u_int32_t n, double *values) {
+  int64_t prev = 0, prev_delta = 0;
+  u_int32_t offset = 0;
+
+  for(u_int32_t i = 0; i < n; i++) {
+    u_int64_t z;
+    u_int32_t l = getVarint(&buf[offset], len - offset, &z);
+    int64_t dd, delta;
+
+    if(l == 0) return(false);
+
+    offset += l;
+    dd = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+    delta = dd + prev_delta;
+
+    prev = (i == 0) ? delta : (prev + delta);
+    prev_delta = (i == 0) ? 0 : delta;
+    values[i] = (double)prev;
+  }
+
+  return(offset == len);
+}
+
+/* *************************************** */
+
+void TimeseriesCodec::encodeXOR(const double *values, u_int32_t n, std::string *out) {
+  TsBitWriter w(out);
+  u_int64_t prev = 0;
+  u_int8_t prev_lz = 0xFF, prev_tz = 0;
+
+  for(u_int32_t i = 0; i < n; i++) {
+    u_int64_t v, x;
+
+    memcpy(&v, &values[i], sizeof(v));
+
+    if(i == 0) {
+      w.write64(v, 64);
+      prev = v;
+      continue;
+    }
+
+    x = v ^ prev, prev = v;
+
+    if(x == 0)
+      w.write(0, 1);
+    else {
+      u_int8_t lz = min_val(__builtin_clzll(x), 31), tz = __builtin_ctzll(x);
+
+      if((prev_lz != 0xFF) && (lz >= prev_lz) && (tz >= prev_tz)) {
+	/* Fits the meaningful bits of the previous value */
+	w.write(2, 2);
+	w.write64(x >> prev_tz, 64 - prev_lz - prev_tz);
+      } else {
+	u_int8_t sig = 64 - lz - tz;
+
+	w.write(3, 2);
+	w.write(lz, 5);
+	w.write(sig - 1, 6);
+	w.write64(x >> tz, sig);
+	prev_lz = lz, prev_tz = tz;
+      }
+    }
+  }
+
+  w.flush();
+}
+
+/* *************************************** */
+
+bool TimeseriesCodec::decodeXOR(const u_int8_t *buf, u_int32_t len, u_int32_t n, double *values) {
+  TsBitReader r(buf, len);
+  u_int64_t prev = 0, bit, x;
+  u_int8_t prev_lz = 0xFF, prev_tz = 0;
+
+  for(u_int32_t i = 0; i < n; i++) {
+    if(i == 0) {
+      u_int64_t hi, lo;
+
+      if(!r.read(32, &hi) || !r.read(32, &lo)) return(false);
+      prev = (hi << 32) | lo;
+    } else {
+      if(!r.read(1, &bit)) return(false);
+
+      if(bit) {
+	u_int64_t hi = 0, lo;
+	u_int8_t sig;
+
+	if(!r.read(1, &bit)) return(false);
+
+	if(bit) {
+	  u_int64_t lz, s;
+
+	  if(!r.read(5, &lz) || !r.read(6, &s)) return(false);
+	  prev_lz = (u_int8_t)lz, sig = (u_int8_t)s + 1;
+	  if(prev_lz + sig > 64) return(false);
+	  prev_tz = 64 - prev_lz - sig;
+	} else if(prev_lz == 0xFF)
+	  return(false);
+	else
+	  sig = 64 - prev_lz - prev_tz;
+
+	if(sig > 32) {
+	  if(!r.read(sig - 32, &hi)) return(false);
+	  sig = 32;
+	}
+
+	if(!r.read(sig, &lo)) return(false);
+
+	x = ((hi << 32) | lo) << prev_tz;
+	prev ^= x;
+      }
+    }
+
+    memcpy(&values[i], &prev, sizeof(prev));
+  }
+
+  return(true);
+}
+
+/* *************************************** */
+
+void TimeseriesCodec::encodeColumn(const double *values, u_int32_t n, std::string *out) {
+  std::string payload;
+  u_int8_t codec = isIntegral(values, n) ? TS_CODEC_DELTA : TS_CODEC_XOR;
+
+  if(codec == TS_CODEC_DELTA)
+    encodeDelta(values, n, &payload);
+  else
+    encodeXOR(values, n, &payload);
+
+  out->push_back((char)codec);
+  putVarint(payload.size(), out);
+  out->append(payload);
+}
+
+/* *************************************** */
+
+u_int32_t TimeseriesCodec::decodeColumn(const u_int8_t *buf, u_int32_t len, u_int32_t n, double *values) {
+  u_int64_t payload_len;
+  u_int32_t l;
+  bool rc;
+
+  if((len < 2) || ((l = getVarint(&buf[1], len - 1, &payload_len)) == 0)
+     || (1 + l + payload_len > len))
+    return(0);
+
+  switch(buf[0]) {
+  case TS_CODEC_DELTA:
+    rc = decodeDelta(&buf[1 + l], (u_int32_t)payload_len, n, values);
+    break;
+
+  case TS_CODEC_XOR:
+    rc = decodeXOR(&buf[1 + l], (u_int32_t)payload_len, n, values);
+    break;
+
+  default:
+    rc = false;
+  }
+
+  return(rc ? (1 + l + (u_int32_t)payload_len) : 0);
+}
+
+/* *************************************** */
+
+void TimeseriesCodec::encodeBlock(const double *values, u_int16_t num_points, u_int8_t num_metrics, std::string *out) {
+  u_int32_t bitmap_len = (num_points + 7) / 8, n = 0;
+  size_t bitmap_offset = out->size();
+  double column[num_points];
+
+  out->append(bitmap_len, '\0');
+
+  for(u_int16_t p = 0; p < num_points; p++) {
+    for(u_int8_t m = 0; m < num_metrics; m++) {
+      if(!std::isnan(values[m * num_points + p])) {
+	(*out)[bitmap_offset + (p >> 3)] |= (char)(1 << (p & 7));
+	n++;
+	break;
+      }
+    }
+  }
+
+  for(u_int8_t m = 0; m < num_metrics; m++) {
+    u_int32_t i = 0;
+
+    for(u_int16_t p = 0; p < num_points; p++) {
+      if((*out)[bitmap_offset + (p >> 3)] & (1 << (p & 7)))
+	column[i++] = values[m * num_points + p];
+    }
+
+    encodeColumn(column, n, out);
+  }
+}
+
+/* *************************************** */
+
+bool TimeseriesCodec::decodeBlock(const u_int8_t *buf, u_int32_t len, u_int16_t num_points, u_int8_t num_metrics, double *values) {
+  u_int32_t bitmap_len = (num_points + 7) / 8, offset = bitmap_len, n = 0;
+  double column[num_points];
+
+  if(len < bitmap_len)
+    return(false);
+
+  for(u_int32_t i = 0; i < bitmap_len; i++)
+    n += __builtin_popcount(buf[i]);
+
+  if(n > num_points)
+    return(false);
+
+  for(u_int8_t m = 0; m < num_metrics; m++) {
+    u_int32_t l = decodeColumn(&buf[offset], len - offset, n, column), i = 0;
+
+    if(l == 0) return(false);
+    offset += l;
+
+    for(u_int16_t p = 0; p < num_points; p++)
+      values[m * num_points + p] = (buf[p >> 3] & (1 << (p & 7))) ? column[i++] : NAN;
+  }
+
+  return(true);
+}
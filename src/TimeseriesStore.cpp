@@ -0,0 +1,1600 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#ifndef WIN32
+
+#include <sys/mman.h>
+
+/* *************************************** */
+
+/* Read-only mapping of a segment file */
+class TsSegment {
+ private:
+  u_int8_t *map;
+  size_t len;
+
+ public:
+  TsSegment() { map = NULL, len = 0; };
+  ~TsSegment() { if(map) munmap(map, len); };
+
+  bool open(const char *path) {
+    struct stat st;
+    int fd;
+
+    if((fd = ::open(path, O_RDONLY)) == -1)
+      return(false);
+
+    if((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(struct ts_chunk_hdr))) {
+      ::close(fd);
+      return(false);
+    }
+
+    len = (size_t)st.st_size;
+    map = (u_int8_t*)mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(map == MAP_FAILED) {
+      map = NULL;
+      return(false);
+    }
+
+    return(true);
+  };
+
+  /* Returns the record at *offset moving it to the next one, NULL at the end (or at a torn write) */
+  const u_int8_t* next(size_t *offset, struct ts_chunk_hdr *h) {
+    const u_int8_t *rec;
+
+    if(*offset + sizeof(*h) > len)
+      return(NULL);
+
+    rec = &map[*offset];
+    memcpy(h, rec, sizeof(*h));
+
+    if((h->magic != TS_CHUNK_MAGIC)
+       || (h->len < sizeof(*h) + (u_int64_t)h->num_series * sizeof(struct ts_chunk_entry))
+       || (*offset + h->len > len)
+       || (h->num_metrics == 0) || (h->num_metrics > TS_MAX_METRICS)
+       || (h->num_points == 0) || (h->step == 0))
+      return(NULL);
+
+    *offset += h->len;
+    return(rec);
+  };
+};
+
+/* *************************************** */
+
+/*
+  What a query reads, taken with the schema locked. The segments mapped
+  at that time and the chunks still in memory hold each point once: a
+  sealed chunk is written and dropped from memory with the schema locked.
+*/
+class TsSnapshot {
+ public:
+  struct range {
+    u_int32_t from, to;
+    std::vector<TsSegment*> segments;
+  };
+
+  std::vector<range> ranges; /* Coarsest level first, raw points last */
+  bool raw;                  /* The last range includes the chunks in memory */
+  std::vector<std::shared_ptr<ts_chunk> > sealed;
+  std::shared_ptr<ts_chunk> open; /* Read with the schema locked */
+
+  TsSnapshot() { raw = false; };
+  ~TsSnapshot() {
+    for(u_int i = 0; i < ranges.size(); i++)
+      for(u_int j = 0; j < ranges[i].segments.size(); j++)
+	delete ranges[i].segments[j];
+  };
+};
+
+/* *************************************** */
+
+/* Receives the points of the selected series, in time order. values[m * stride] is metric m */
+class TsConsumer {
+ public:
+  virtual ~TsConsumer() {};
+  virtual void point(u_int32_t idx, u_int32_t t, u_int32_t step, const double *values, u_int32_t stride) = 0;
+};
+
+/* *************************************** */
+
+/*
+  Buckets of out_step seconds from grid_start. Counters sum the increments
+  between consecutive points and their time gap: the bucket rate is their
+  ratio (scaled by the number of series when aggregating). Gauges average
+  the points of each series in the bucket, summed among the series.
+  A rolled up counter point holds the value of the last raw point of its
+  interval: the gaps are measured from there.
+*/
+class TsQueryConsumer : public TsConsumer {
+ private:
+  bool is_counter;
+  u_int8_t num_metrics;
+  u_int32_t base_step, grid_start, out_step, count;
+
+  /* Per series */
+  std::vector<double> prev, sums;
+  std::vector<u_int32_t> prev_t;
+  std::vector<int32_t> last_bucket;
+
+  /* Per bucket */
+  std::vector<double> acc, cnt;
+  std::vector<u_int64_t> gap;
+  std::vector<u_int32_t> num_series;
+
+ public:
+  TsQueryConsumer(bool _is_counter, u_int8_t _num_metrics, u_int32_t _base_step, u_int32_t num_idx,
+		  u_int32_t _grid_start, u_int32_t _out_step, u_int32_t _count) {
+    is_counter = _is_counter, num_metrics = _num_metrics, base_step = _base_step;
+    grid_start = _grid_start, out_step = _out_step, count = _count;
+
+    prev.assign((size_t)num_idx * num_metrics, NAN), sums.assign((size_t)num_idx * num_metrics, 0);
+    prev_t.assign(num_idx, 0), last_bucket.assign(num_idx, -1);
+    acc.assign((size_t)count * num_metrics, 0), cnt.assign((size_t)count * num_metrics, 0);
+    gap.assign(count, 0), num_series.assign(count, 0);
+  };
+
+  void point(u_int32_t idx, u_int32_t t, u_int32_t step, const double *values, u_int32_t stride) {
+    int32_t b = -1;
+    double *p = &prev[(size_t)idx * num_metrics], *s = &sums[(size_t)idx * num_metrics];
+
+    if((t >= grid_start) && ((t - grid_start) / out_step < count))
+      b = (t - grid_start) / out_step;
+
+    if(is_counter) {
+      u_int32_t value_t = t + step - base_step;
+
+      if((b >= 0) && (prev_t[idx] != 0) && (value_t > prev_t[idx])) {
+	double *a = &acc[(size_t)b * num_metrics];
+
+	if(last_bucket[idx] != b) num_series[b]++, last_bucket[idx] = b;
+	gap[b] += value_t - prev_t[idx];
+
+	for(u_int8_t m = 0; m < num_metrics; m++) {
+	  double v = values[m * stride];
+
+	  /* Decreasing values are counter resets */
+	  if((v >= p[m]) && (!std::isnan(p[m])))
+	    a[m] += v - p[m], s[m] += v - p[m];
+	}
+      }
+
+      for(u_int8_t m = 0; m < num_metrics; m++)
+	if(!std::isnan(values[m * stride])) p[m] = values[m * stride];
+
+      prev_t[idx] = value_t;
+    } else if(b >= 0) {
+      double *a = &acc[(size_t)b * num_metrics], *c = &cnt[(size_t)b * num_metrics];
+
+      if(last_bucket[idx] != b) num_series[b]++, last_bucket[idx] = b;
+
+      for(u_int8_t m = 0; m < num_metrics; m++) {
+	double v = values[m * stride];
+
+	if(!std::isnan(v))
+	  a[m] += v, c[m]++, s[m] += v * step;
+      }
+    }
+  };
+
+  inline double value(u_int32_t b, u_int8_t m) const {
+    size_t i = (size_t)b * num_metrics + m;
+
+    if(is_counter)
+      return(gap[b] ? (acc[i] * num_series[b] / gap[b]) : NAN);
+    else
+      return(cnt[i] ? (acc[i] / cnt[i] * num_series[b]) : NAN);
+  };
+
+  inline double sum(u_int32_t idx, u_int8_t m) const { return(sums[(size_t)idx * num_metrics + m]); };
+};
+
+/* *************************************** */
+
+/* Rolls the points of a batch of series up into TS_ROLLUP_CHUNK_POINTS buckets */
+class TsRollupConsumer : public TsConsumer {
+ private:
+  bool is_counter;
+  u_int8_t num_metrics;
+  u_int32_t window, step;
+  std::vector<double> values, cnt; /* [idx][metric][bucket] */
+
+ public:
+  TsRollupConsumer(bool _is_counter, u_int8_t _num_metrics, u_int32_t _window, u_int32_t _step) {
+    is_counter = _is_counter, num_metrics = _num_metrics, window = _window, step = _step;
+  };
+
+  void reset(u_int32_t num_idx) {
+    values.assign((size_t)num_idx * num_metrics * TS_ROLLUP_CHUNK_POINTS, NAN);
+    if(!is_counter) cnt.assign(values.size(), 0);
+  };
+
+  void point(u_int32_t idx, u_int32_t t, u_int32_t src_step, const double *v, u_int32_t stride) {
+    u_int32_t b = (t - window) / step;
+    double *dst = &values[(size_t)idx * num_metrics * TS_ROLLUP_CHUNK_POINTS + b];
+
+    for(u_int8_t m = 0; m < num_metrics; m++, dst += TS_ROLLUP_CHUNK_POINTS) {
+      double val = v[m * stride];
+
+      if(std::isnan(val)) continue;
+
+      if(is_counter)
+	*dst = val; /* Points come in time order: last value */
+      else {
+	double *c = &cnt[dst - &values[0]];
+
+	*dst = ((*c == 0) ? 0 : *dst) + val, (*c)++;
+      }
+    }
+  };
+
+  /* Returns false when the series has no points */
+  bool encode(u_int32_t idx, std::string *out) {
+    size_t base = (size_t)idx * num_metrics * TS_ROLLUP_CHUNK_POINTS, n = (size_t)num_metrics * TS_ROLLUP_CHUNK_POINTS;
+    bool found = false;
+
+    for(size_t i = base; i < base + n; i++) {
+      if(!std::isnan(values[i])) {
+	if(!is_counter) values[i] /= cnt[i];
+	found = true;
+      }
+    }
+
+    if(found)
+      TimeseriesCodec::encodeBlock(&values[base], TS_ROLLUP_CHUNK_POINTS, num_metrics, out);
+
+    return(found);
+  };
+};
+
+/* *************************************** */
+
+static void* timeseriesStoreRollupFctn(void *ptr) {
+  Utils::setThreadName("ntopng-ts-rollup");
+
+  ((TimeseriesStore*)ptr)->runRollups();
+  return(NULL);
+}
+
+/* *************************************** */
+
+TimeseriesStore::TimeseriesStore(const char *working_dir) {
+  DIR *d;
+  struct dirent *e;
+
+  snprintf(base_path, sizeof(base_path), "%s/%s", working_dir, TS_STORE_DIR);
+
+  if(!Utils::mkdir_tree(base_path))
+    throw "Unable to create the timeseries directory";
+
+  num_points = num_late_points = num_chunks = num_chunk_bytes = num_raw_bytes = 0;
+  num_rollups = rollup_usec = num_queries = query_usec = 0;
+  started = terminated = false;
+
+  if((d = opendir(base_path)) != NULL) {
+    while((e = readdir(d)) != NULL) {
+      char path[MAX_PATH];
+      ts_schema *s;
+
+      if(e->d_name[0] == '.') continue;
+
+      snprintf(path, sizeof(path), "%s/%s", base_path, e->d_name);
+
+      if((s = loadSchema(path)) != NULL)
+	schemas[s->name] = s;
+    }
+
+    closedir(d);
+  }
+
+  if(pthread_create(&thread, NULL, timeseriesStoreRollupFctn, (void*)this) == 0)
+    started = true;
+  else
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to start the timeseries rollup thread");
+
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Native timeseries store at %s [%u schemas]",
+			       base_path, (unsigned int)schemas.size());
+}
+
+/* *************************************** */
+
+TimeseriesStore::~TimeseriesStore() {
+  rollups_m.lock(__FILE__, __LINE__);
+  terminated = true;
+  rollups_m.unlock(__FILE__, __LINE__);
+
+  if(started) {
+    wakeup.signal();
+    pthread_join(thread, NULL);
+  }
+
+  /* Open chunks are written as they are: the next points of the same window go to a new record */
+  for(std::map<std::string, ts_schema*>::iterator it = schemas.begin(); it != schemas.end(); ++it) {
+    ts_schema *s = it->second;
+
+    s->m.lock(__FILE__, __LINE__);
+    sealChunk(s);
+    s->m.unlock(__FILE__, __LINE__);
+
+    writeSealed(s);
+
+    s->m.lock(__FILE__, __LINE__);
+    rewriteSeries(s);
+    s->m.unlock(__FILE__, __LINE__);
+
+    freeSchema(s);
+  }
+}
+
+/* *************************************** */
+
+void TimeseriesStore::freeSchema(ts_schema *s) {
+  if(s->series_fd) fclose(s->series_fd);
+  delete s;
+}
+
+/* *************************************** */
+
+void TimeseriesStore::initLevels(ts_schema *s) {
+  u_int32_t rollup_steps[] = { 3600, 86400 };
+  ts_level *l = &s->levels[0];
+
+  memset(s->levels, 0, sizeof(s->levels));
+
+  s->chunk_points = (u_int16_t)max_val(TS_CHUNK_DURATION / s->step, TS_MIN_CHUNK_POINTS);
+  l->step = s->step, l->chunk_duration = s->step * s->chunk_points;
+  l->segment_duration = l->chunk_duration * TS_SEGMENT_NUM_CHUNKS;
+  s->num_levels = 1;
+
+  for(u_int i = 0; i < sizeof(rollup_steps) / sizeof(rollup_steps[0]); i++) {
+    if((s->step < rollup_steps[i]) && ((rollup_steps[i] % s->step) == 0)) {
+      l = &s->levels[s->num_levels++];
+      l->step = rollup_steps[i], l->chunk_duration = rollup_steps[i] * TS_ROLLUP_CHUNK_POINTS;
+      l->segment_duration = l->chunk_duration * TS_SEGMENT_NUM_CHUNKS;
+    }
+  }
+}
+
+/* *************************************** */
+
+void TimeseriesStore::listSegments(ts_schema *s, std::vector<std::pair<u_int8_t, u_int32_t> > *out) {
+  DIR *d;
+  struct dirent *e;
+
+  if((d = opendir(s->path.c_str())) == NULL)
+    return;
+
+  while((e = readdir(d)) != NULL) {
+    unsigned int level, start;
+    char ext[8];
+
+    if((sscanf(e->d_name, "%u_%u.%7s", &level, &start, ext) == 3)
+       && (!strcmp(ext, "seg")) && (level < s->num_levels))
+      out->push_back(std::make_pair((u_int8_t)level, (u_int32_t)start));
+  }
+
+  closedir(d);
+  std::sort(out->begin(), out->end());
+}
+
+/* *************************************** */
+
+void TimeseriesStore::getSegmentPath(ts_schema *s, u_int8_t level, u_int32_t segment_start, char *buf, u_int buf_len) {
+  snprintf(buf, buf_len, "%s/%u_%u.seg", s->path.c_str(), level, segment_start);
+}
+
+/* *************************************** */
+
+ts_schema* TimeseriesStore::loadSchema(const char *path) {
+  char fname[MAX_PATH], name[256];
+  struct ts_series_hdr h;
+  struct ts_series_record r;
+  std::vector<std::pair<u_int8_t, u_int32_t> > segments;
+  u_int32_t last_segment[TS_MAX_LEVELS] = { 0 };
+  ts_schema *s;
+  FILE *fd;
+
+  snprintf(fname, sizeof(fname), "%s/series.idx", path);
+
+  if((fd = fopen(fname, "rb")) == NULL)
+    return(NULL);
+
+  if((fread(&h, sizeof(h), 1, fd) != 1)
+     || (h.magic != TS_SERIES_MAGIC) || (h.version != TS_STORE_VERSION)
+     || (h.num_metrics == 0) || (h.num_metrics > TS_MAX_METRICS) || (h.step == 0)
+     || (h.name_len == 0) || (h.name_len >= sizeof(name))
+     || (fread(name, h.name_len, 1, fd) != 1)) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Ignoring invalid timeseries %s", path);
+    fclose(fd);
+    return(NULL);
+  }
+
+  if((s = new (std::nothrow) ts_schema) == NULL) {
+    fclose(fd);
+    return(NULL);
+  }
+
+  name[h.name_len] = '\0';
+  s->name = name, s->path = path;
+  s->step = h.step, s->num_metrics = h.num_metrics, s->is_counter = (h.is_counter != 0);
+  s->num_active = 0, s->series_fd = NULL;
+  initLevels(s);
+
+  s->series.resize(h.next_id);
+  for(u_int32_t i = 0; i < h.next_id; i++) s->series[i].key = NULL, s->series[i].last_ts = 0;
+
+  /* The last record of an id wins: deletions are appended */
+  while(fread(&r, sizeof(r), 1, fd) == 1) {
+    char key[65536];
+
+    if((r.key_len > 0) && (fread(key, r.key_len, 1, fd) != 1))
+      break;
+
+    if(r.id >= s->series.size())
+      s->series.resize(r.id + 1, ts_series{ NULL, 0 });
+
+    if(s->series[r.id].key)
+      s->ids.erase(*s->series[r.id].key), s->series[r.id].key = NULL, s->num_active--;
+
+    if(r.key_len > 0) {
+      std::pair<std::unordered_map<std::string, u_int32_t>::iterator, bool> res =
+	s->ids.insert(std::make_pair(std::string(key, r.key_len), (u_int32_t)r.id));
+
+      if(res.second) {
+	s->series[r.id].key = &res.first->first, s->num_active++;
+	s->series[r.id].last_ts = max_val(s->series[r.id].last_ts, r.last_ts);
+      }
+    }
+  }
+
+  fclose(fd);
+
+  /* Levels progress from their last segment */
+  listSegments(s, &segments);
+
+  for(u_int i = 0; i < segments.size(); i++)
+    last_segment[segments[i].first] = segments[i].second;
+
+  for(u_int8_t level = 0; level < s->num_levels; level++) {
+    if(last_segment[level] != 0) {
+      TsSegment seg;
+      char seg_path[MAX_PATH];
+      struct ts_chunk_hdr ch;
+      const u_int8_t *rec;
+      size_t offset = 0;
+
+      getSegmentPath(s, level, last_segment[level], seg_path, sizeof(seg_path));
+
+      if(!seg.open(seg_path))
+	continue;
+
+      while((rec = seg.next(&offset, &ch)) != NULL) {
+	if(level > 0)
+	  s->levels[level].rolled_until = max_val(s->levels[level].rolled_until, ch.start + ch.num_points * ch.step);
+	else {
+	  /* Updates not saved before a crash */
+	  for(u_int32_t i = 0; i < ch.num_series; i++) {
+	    struct ts_chunk_entry e;
+
+	    memcpy(&e, &rec[sizeof(ch) + i * sizeof(e)], sizeof(e));
+
+	    if(e.series_id < s->series.size())
+	      s->series[e.series_id].last_ts = max_val(s->series[e.series_id].last_ts, ch.start);
+	  }
+	}
+      }
+
+      s->levels[level].scheduled_until = s->levels[level].rolled_until;
+    }
+  }
+
+  if(!openSeries(s)) {
+    freeSchema(s);
+    return(NULL);
+  }
+
+  return(s);
+}
+
+/* *************************************** */
+
+/* Opens series.idx to append the new series, creating it if missing */
+bool TimeseriesStore::openSeries(ts_schema *s) {
+  char fname[MAX_PATH];
+  struct stat st;
+
+  snprintf(fname, sizeof(fname), "%s/series.idx", s->path.c_str());
+
+  if(stat(fname, &st) != 0)
+    return(rewriteSeries(s));
+
+  if((s->series_fd = fopen(fname, "ab")) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to open %s: %s", fname, strerror(errno));
+    return(false);
+  }
+
+  return(true);
+}
+
+/* *************************************** */
+
+/* Writes the dictionary without the deleted series, with their last update */
+bool TimeseriesStore::rewriteSeries(ts_schema *s) {
+  char fname[MAX_PATH], tmp_fname[MAX_PATH];
+  struct ts_series_hdr h;
+  FILE *fd;
+  bool rc;
+
+  snprintf(fname, sizeof(fname), "%s/series.idx", s->path.c_str());
+  snprintf(tmp_fname, sizeof(tmp_fname), "%s.tmp", fname);
+
+  if(s->series_fd) fclose(s->series_fd), s->series_fd = NULL;
+
+  if((fd = fopen(tmp_fname, "wb")) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write %s: %s", tmp_fname, strerror(errno));
+    return(false);
+  }
+
+  memset(&h, 0, sizeof(h));
+  h.magic = TS_SERIES_MAGIC, h.version = TS_STORE_VERSION;
+  h.num_metrics = s->num_metrics, h.is_counter = s->is_counter ? 1 : 0;
+  h.step = s->step, h.next_id = (u_int32_t)s->series.size(), h.name_len = (u_int16_t)s->name.size();
+
+  rc = (fwrite(&h, sizeof(h), 1, fd) == 1) && (fwrite(s->name.c_str(), h.name_len, 1, fd) == 1);
+
+  for(u_int32_t id = 0; rc && (id < s->series.size()); id++) {
+    struct ts_series_record r;
+
+    if(s->series[id].key == NULL) continue;
+
+    r.id = id, r.last_ts = s->series[id].last_ts, r.key_len = (u_int16_t)s->series[id].key->size();
+    rc = (fwrite(&r, sizeof(r), 1, fd) == 1) && (fwrite(s->series[id].key->c_str(), r.key_len, 1, fd) == 1);
+  }
+
+  if(fclose(fd) != 0) rc = false;
+
+  if(rc && (rename(tmp_fname, fname) != 0))
+    rc = false;
+
+  if(!rc) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write %s: %s", fname, strerror(errno));
+    unlink(tmp_fname);
+    return(false);
+  }
+
+  return((s->series_fd = fopen(fname, "ab")) != NULL);
+}
+
+/* *************************************** */
+
+ts_schema* TimeseriesStore::getSchema(const char *name, bool create, u_int32_t step, u_int8_t num_metrics, bool is_counter) {
+  std::map<std::string, ts_schema*>::iterator it;
+  ts_schema *s = NULL;
+
+  m.lock(__FILE__, __LINE__);
+
+  if((it = schemas.find(name)) != schemas.end())
+    s = it->second;
+  else if(create && (step > 0) && (num_metrics > 0) && (num_metrics <= TS_MAX_METRICS)) {
+    char path[MAX_PATH], dir_name[256];
+
+    snprintf(dir_name, sizeof(dir_name), "%s", name);
+
+    for(char *c = dir_name; *c; c++)
+      if((*c == ':') || (*c == '/') || (*c == '\\')) *c = '_';
+
+    snprintf(path, sizeof(path), "%s/%s", base_path, dir_name);
+
+    if(Utils::dir_exists(path)) {
+      /* Same directory as another schema name or an incompatible version */
+      char old_path[MAX_PATH];
+
+      snprintf(old_path, sizeof(old_path), "%s.%u", path, (unsigned int)time(NULL));
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Moving the unusable timeseries %s to %s", path, old_path);
+      rename(path, old_path);
+    }
+
+    if(Utils::mkdir_tree(path) && ((s = new (std::nothrow) ts_schema) != NULL)) {
+      s->name = name, s->path = path;
+      s->step = step, s->num_metrics = num_metrics, s->is_counter = is_counter;
+      s->num_active = 0, s->series_fd = NULL;
+      initLevels(s);
+
+      if(openSeries(s))
+	schemas[s->name] = s;
+      else
+	freeSchema(s), s = NULL;
+    }
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(s);
+}
+
+/* *************************************** */
+
+/* s->m locked */
+u_int32_t TimeseriesStore::addSeries(ts_schema *s, const char *key, u_int32_t when) {
+  std::unordered_map<std::string, u_int32_t>::iterator it = s->ids.find(key);
+  struct ts_series_record r;
+  u_int32_t id;
+
+  if(it != s->ids.end())
+    return(it->second);
+
+  id = (u_int32_t)s->series.size();
+  it = s->ids.insert(std::make_pair(std::string(key), id)).first;
+  s->series.push_back(ts_series{ &it->first, when });
+  s->num_active++;
+
+  if(s->series_fd) {
+    r.id = id, r.last_ts = when, r.key_len = (u_int16_t)it->first.size();
+
+    if((fwrite(&r, sizeof(r), 1, s->series_fd) != 1)
+       || (fwrite(it->first.c_str(), r.key_len, 1, s->series_fd) != 1))
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to save the timeseries %s [%s]", key, s->name.c_str());
+  }
+
+  return(id);
+}
+
+/* *************************************** */
+
+bool TimeseriesStore::append(const char *schema_name, u_int32_t step, bool is_counter, const char *key,
+			     u_int32_t when, const double *values, u_int8_t num_values) {
+  ts_schema *s = getSchema(schema_name, true, step, num_values, is_counter);
+  ts_chunk *c;
+  u_int32_t id, slot, p, chunk_len;
+  double *dst;
+  bool sealed = false;
+
+  if((s == NULL) || (strlen(key) >= 65536))
+    return(false);
+
+  if((s->step != step) || (s->num_metrics != num_values)) {
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Timeseries %s definition mismatch: step %u/%u, metrics %u/%u",
+				 schema_name, step, s->step, num_values, s->num_metrics);
+    return(false);
+  }
+
+  s->m.lock(__FILE__, __LINE__);
+
+  if(s->open && (when < s->open->start)) {
+    /* The chunk has already been sealed */
+    s->m.unlock(__FILE__, __LINE__);
+    num_late_points++;
+    return(false);
+  }
+
+  if(s->open && (when >= s->open->start + s->levels[0].chunk_duration))
+    sealChunk(s), sealed = true;
+
+  if(!s->open) {
+    s->open.reset(new (std::nothrow) ts_chunk);
+
+    if(!s->open) {
+      s->m.unlock(__FILE__, __LINE__);
+      return(false);
+    }
+
+    s->open->start = when - (when % s->levels[0].chunk_duration);
+  }
+
+  c = s->open.get();
+  id = addSeries(s, key, when);
+
+  if(c->slot_of.size() <= id)
+    c->slot_of.resize(s->series.size(), 0);
+
+  chunk_len = (u_int32_t)s->num_metrics * s->chunk_points;
+
+  if(c->slot_of[id] == 0) {
+    slot = (u_int32_t)c->slot_series.size();
+    c->slot_series.push_back(id);
+    c->slot_of[id] = slot + 1;
+    c->values.resize((size_t)(slot + 1) * chunk_len, NAN);
+  } else
+    slot = c->slot_of[id] - 1;
+
+  p = (when - c->start) / s->step;
+  dst = &c->values[(size_t)slot * chunk_len + p];
+
+  for(u_int8_t m = 0; m < num_values; m++)
+    dst[m * s->chunk_points] = values[m];
+
+  s->series[id].last_ts = max_val(s->series[id].last_ts, when);
+
+  s->m.unlock(__FILE__, __LINE__);
+
+  /* Without the rollup thread the chunk is written here */
+  if(sealed && (!started))
+    writeSealed(s);
+
+  num_points++, num_raw_bytes += sizeof(u_int32_t) + num_values * sizeof(double);
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool TimeseriesStore::writeChunk(ts_schema *s, u_int8_t level, u_int32_t start, u_int32_t step, u_int16_t num_points,
+				 const std::vector<u_int32_t> &ids, const std::string &blocks,
+				 const std::vector<u_int32_t> &offsets) {
+  char path[MAX_PATH];
+  struct ts_chunk_hdr h;
+  u_int32_t index_len = (u_int32_t)ids.size() * sizeof(struct ts_chunk_entry);
+  u_int32_t segment_duration = s->levels[level].segment_duration;
+  std::string record;
+  FILE *fd;
+  bool rc;
+
+  if(ids.empty())
+    return(true);
+
+  h.magic = TS_CHUNK_MAGIC, h.len = sizeof(h) + index_len + (u_int32_t)blocks.size();
+  h.start = start, h.step = step, h.num_points = num_points;
+  h.num_metrics = s->num_metrics, h.level = level, h.num_series = (u_int32_t)ids.size();
+
+  record.reserve(h.len);
+  record.assign((const char*)&h, sizeof(h));
+
+  for(u_int32_t i = 0; i < ids.size(); i++) {
+    struct ts_chunk_entry e;
+
+    e.series_id = ids[i], e.offset = sizeof(h) + index_len + offsets[i];
+    record.append((const char*)&e, sizeof(e));
+  }
+
+  record.append(blocks);
+
+  getSegmentPath(s, level, start - (start % segment_duration), path, sizeof(path));
+
+  if((fd = fopen(path, "ab")) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write %s: %s", path, strerror(errno));
+    return(false);
+  }
+
+  rc = (fwrite(record.data(), record.size(), 1, fd) == 1);
+  if(fclose(fd) != 0) rc = false;
+
+  if(!rc)
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write %s: %s", path, strerror(errno));
+  else
+    num_chunks++, num_chunk_bytes += record.size();
+
+  return(rc);
+}
+
+/* *************************************** */
+
+/* Queues the open chunk to be written by the rollup thread. s->m locked */
+void TimeseriesStore::sealChunk(ts_schema *s) {
+  ts_rollup_task t;
+
+  if(!s->open)
+    return;
+
+  s->sealed.push_back(s->open);
+  s->open.reset();
+
+  if(!started)
+    return;
+
+  t.schema = s, t.level = 0, t.window = s->sealed.back()->start;
+
+  rollups_m.lock(__FILE__, __LINE__);
+  rollups.push_back(t);
+  rollups_m.unlock(__FILE__, __LINE__);
+
+  wakeup.signal();
+}
+
+/* *************************************** */
+
+/*
+  Encodes the sealed chunks, oldest first, without locking the schema.
+  Each one is then written and dropped with the schema locked so that
+  queries find its points either in memory or in the segment.
+*/
+void TimeseriesStore::writeSealed(ts_schema *s) {
+  u_int32_t chunk_len = (u_int32_t)s->num_metrics * s->chunk_points;
+
+  while(true) {
+    std::shared_ptr<ts_chunk> c;
+    std::vector<std::pair<u_int32_t, u_int32_t> > order; /* series id, slot */
+    std::vector<u_int32_t> ids, offsets;
+    std::string blocks;
+
+    s->m.lock(__FILE__, __LINE__);
+    if(!s->sealed.empty()) c = s->sealed.front();
+    s->m.unlock(__FILE__, __LINE__);
+
+    if(!c)
+      break;
+
+    order.reserve(c->slot_series.size()), ids.reserve(c->slot_series.size()), offsets.reserve(c->slot_series.size());
+
+    for(u_int32_t slot = 0; slot < c->slot_series.size(); slot++)
+      order.push_back(std::make_pair(c->slot_series[slot], slot));
+
+    std::sort(order.begin(), order.end());
+
+    for(u_int32_t i = 0; i < order.size(); i++) {
+      ids.push_back(order[i].first), offsets.push_back((u_int32_t)blocks.size());
+      TimeseriesCodec::encodeBlock(&c->values[(size_t)order[i].second * chunk_len], s->chunk_points, s->num_metrics, &blocks);
+    }
+
+    s->m.lock(__FILE__, __LINE__);
+
+    /* Another thread may have written it meanwhile */
+    if((!s->sealed.empty()) && (s->sealed.front() == c)) {
+      /* The new series must be known before their points */
+      if(s->series_fd) fflush(s->series_fd);
+
+      if(writeChunk(s, 0, c->start, s->step, s->chunk_points, ids, blocks, offsets))
+	scheduleRollups(s, 1, c->start + s->levels[0].chunk_duration);
+
+      s->sealed.pop_front();
+    }
+
+    s->m.unlock(__FILE__, __LINE__);
+  }
+}
+
+/* *************************************** */
+
+/* Schedules the windows of level that are complete in the level below, written up to written_until. s->m locked */
+void TimeseriesStore::scheduleRollups(ts_schema *s, u_int8_t level, u_int32_t written_until) {
+  ts_level *l;
+  u_int32_t ready;
+
+  if(level >= s->num_levels)
+    return;
+
+  l = &s->levels[level];
+  ready = written_until - (written_until % l->chunk_duration);
+
+  if(l->scheduled_until == 0) {
+    /* First rollup: starts from the window of the first points */
+    l->scheduled_until = (written_until - 1) - ((written_until - 1) % l->chunk_duration);
+  }
+
+  if(ready > l->scheduled_until + TS_MAX_ROLLUP_BACKLOG * l->chunk_duration)
+    l->scheduled_until = ready - TS_MAX_ROLLUP_BACKLOG * l->chunk_duration;
+
+  rollups_m.lock(__FILE__, __LINE__);
+
+  for(; l->scheduled_until < ready; l->scheduled_until += l->chunk_duration) {
+    ts_rollup_task t;
+
+    t.schema = s, t.level = level, t.window = l->scheduled_until;
+    rollups.push_back(t);
+  }
+
+  rollups_m.unlock(__FILE__, __LINE__);
+
+  wakeup.signal();
+}
+
+/* *************************************** */
+
+void TimeseriesStore::runRollups() {
+  while(!terminated) {
+    ts_rollup_task t;
+    bool found = false;
+
+    rollups_m.lock(__FILE__, __LINE__);
+
+    if(!rollups.empty())
+      t = rollups.front(), rollups.pop_front(), found = true;
+
+    rollups_m.unlock(__FILE__, __LINE__);
+
+    if(found) {
+      if(t.level == 0)
+	writeSealed(t.schema);
+      else
+	rollup(t.schema, t.level, t.window);
+    } else {
+      struct timespec expire;
+
+      expire.tv_sec = time(NULL) + 1, expire.tv_nsec = 0;
+      wakeup.timedWait(&expire);
+    }
+  }
+}
+
+/* *************************************** */
+
+/* Rollup thread: the level below is only read, this level is only written here */
+void TimeseriesStore::rollup(ts_schema *s, u_int8_t level, u_int32_t window) {
+  ts_level *l = &s->levels[level];
+  TsRollupConsumer c(s->is_counter, s->num_metrics, window, l->step);
+  std::vector<TsSegment*> segments;
+  std::vector<u_int32_t> ids, idx_of, batch, offsets;
+  std::string blocks;
+  u_int32_t num_ids;
+  ticks begin = Utils::getticks();
+
+  s->m.lock(__FILE__, __LINE__);
+  num_ids = (u_int32_t)s->series.size();
+  s->m.unlock(__FILE__, __LINE__);
+
+  mapSegments(s, level - 1, window, window + l->chunk_duration, &segments);
+  idx_of.assign(num_ids, 0);
+
+  for(u_int32_t lo = 0; lo < num_ids; lo += TS_ROLLUP_BATCH) {
+    u_int32_t hi = min_val(lo + TS_ROLLUP_BATCH, num_ids);
+
+    batch.clear();
+
+    for(u_int32_t id = lo; id < hi; id++)
+      batch.push_back(id), idx_of[id] = id - lo + 1;
+
+    c.reset(hi - lo);
+    scan(s, segments, window, window + l->chunk_duration, batch, idx_of, &c);
+
+    for(u_int32_t id = lo; id < hi; id++) {
+      u_int32_t offset = (u_int32_t)blocks.size();
+
+      if(c.encode(id - lo, &blocks))
+	ids.push_back(id), offsets.push_back(offset);
+
+      idx_of[id] = 0;
+    }
+  }
+
+  for(u_int i = 0; i < segments.size(); i++)
+    delete segments[i];
+
+  if(writeChunk(s, level, window, l->step, TS_ROLLUP_CHUNK_POINTS, ids, blocks, offsets)) {
+    s->m.lock(__FILE__, __LINE__);
+    l->rolled_until = max_val(l->rolled_until, window + l->chunk_duration);
+    scheduleRollups(s, level + 1, window + l->chunk_duration);
+    s->m.unlock(__FILE__, __LINE__);
+  }
+
+  num_rollups++;
+  rollup_usec += (u_int64_t)((Utils::getticks() - begin) * 1000000 / Utils::gettickspersec());
+}
+
+/* *************************************** */
+
+void TimeseriesStore::mapSegments(ts_schema *s, u_int8_t level, u_int32_t from, u_int32_t to, std::vector<TsSegment*> *out) {
+  u_int32_t segment_duration = s->levels[level].segment_duration;
+
+  if(to <= from)
+    return;
+
+  for(u_int64_t start = from - (from % segment_duration); start < to; start += segment_duration) {
+    char path[MAX_PATH];
+    TsSegment *seg;
+
+    getSegmentPath(s, level, (u_int32_t)start, path, sizeof(path));
+
+    if((seg = new (std::nothrow) TsSegment()) == NULL)
+      break;
+
+    if(seg->open(path))
+      out->push_back(seg);
+    else
+      delete seg;
+  }
+}
+
+/* *************************************** */
+
+/*
+  Feeds c with the points in [from, to) of the series ids (sorted),
+  idx_of maps a series id to its index in ids + 1 (empty for a few ids).
+  Few series are looked up in the chunk index, many are matched walking it.
+*/
+void TimeseriesStore::scan(ts_schema *s, const std::vector<TsSegment*> &segments, u_int32_t from, u_int32_t to,
+			   const std::vector<u_int32_t> &ids, const std::vector<u_int32_t> &idx_of, TsConsumer *c) {
+  std::vector<double> values;
+
+  if(ids.empty())
+    return;
+
+  for(u_int i = 0; i < segments.size(); i++) {
+    struct ts_chunk_hdr h;
+    const u_int8_t *rec;
+    size_t offset = 0;
+
+    while((rec = segments[i]->next(&offset, &h)) != NULL) {
+      const u_int8_t *index = &rec[sizeof(h)];
+      u_int32_t lo, hi, first, last;
+
+      if((h.start >= to) || ((u_int64_t)h.start + (u_int64_t)h.num_points * h.step <= from)
+	 || (h.num_metrics != s->num_metrics) || (h.num_series == 0))
+	continue;
+
+      values.resize((size_t)h.num_metrics * h.num_points);
+
+      /* Index entries of the first and last id */
+      for(lo = 0, hi = h.num_series; lo < hi; ) {
+	u_int32_t mid = (lo + hi) / 2, id;
+
+	memcpy(&id, &index[mid * sizeof(struct ts_chunk_entry)], sizeof(id));
+	if(id < ids.front()) lo = mid + 1; else hi = mid;
+      }
+
+      first = lo;
+
+      for(hi = h.num_series; lo < hi; ) {
+	u_int32_t mid = (lo + hi) / 2, id;
+
+	memcpy(&id, &index[mid * sizeof(struct ts_chunk_entry)], sizeof(id));
+	if(id <= ids.back()) lo = mid + 1; else hi = mid;
+      }
+
+      last = lo;
+
+      for(u_int32_t e_idx = first, i_idx = 0; (e_idx < last) && (i_idx < ids.size()); ) {
+	struct ts_chunk_entry e;
+	u_int32_t block_end, idx;
+
+	memcpy(&e, &index[e_idx * sizeof(e)], sizeof(e));
+
+	if(idx_of.empty() || (ids.size() * 16 < last - first)) {
+	  /* Sparse: binary search of the next id */
+	  u_int32_t l = e_idx, r = last;
+
+	  while(l < r) {
+	    u_int32_t mid = (l + r) / 2, id;
+
+	    memcpy(&id, &index[mid * sizeof(e)], sizeof(id));
+	    if(id < ids[i_idx]) l = mid + 1; else r = mid;
+	  }
+
+	  if(l == last) break;
+
+	  e_idx = l;
+	  memcpy(&e, &index[e_idx * sizeof(e)], sizeof(e));
+
+	  if(e.series_id != ids[i_idx]) {
+	    /* Not in this chunk */
+	    while((i_idx < ids.size()) && (ids[i_idx] < e.series_id)) i_idx++;
+	    continue;
+	  }
+
+	  idx = i_idx++;
+	} else if((e.series_id >= idx_of.size()) || (idx_of[e.series_id] == 0)) {
+	  e_idx++;
+	  continue;
+	} else
+	  idx = idx_of[e.series_id] - 1;
+
+	if(e_idx + 1 < h.num_series)
+	  memcpy(&block_end, &index[(e_idx + 1) * sizeof(e) + sizeof(u_int32_t)], sizeof(block_end));
+	else
+	  block_end = h.len;
+
+	e_idx++;
+
+	if((e.offset > block_end) || (block_end > h.len)
+	   || (!TimeseriesCodec::decodeBlock(&rec[e.offset], block_end - e.offset, h.num_points, h.num_metrics, &values[0])))
+	  continue;
+
+	for(u_int16_t p = 0; p < h.num_points; p++) {
+	  u_int32_t t = h.start + p * h.step;
+
+	  if((t >= from) && (t < to) && (rec[e.offset + (p >> 3)] & (1 << (p & 7))))
+	    c->point(idx, t, h.step, &values[p], h.num_points);
+	}
+      }
+    }
+  }
+}
+
+/* *************************************** */
+
+/* Raw points of a chunk in memory. s->m locked for the open chunk */
+void TimeseriesStore::scanChunk(ts_schema *s, const ts_chunk *chunk, u_int32_t from, u_int32_t to,
+				const std::vector<u_int32_t> &ids, TsConsumer *c) {
+  u_int32_t chunk_len = (u_int32_t)s->num_metrics * s->chunk_points;
+
+  for(u_int32_t idx = 0; idx < ids.size(); idx++) {
+    const double *values;
+
+    if((ids[idx] >= chunk->slot_of.size()) || (chunk->slot_of[ids[idx]] == 0))
+      continue;
+
+    values = &chunk->values[(size_t)(chunk->slot_of[ids[idx]] - 1) * chunk_len];
+
+    for(u_int16_t p = 0; p < s->chunk_points; p++) {
+      u_int32_t t = chunk->start + p * s->step;
+
+      if((t < from) || (t >= to)) continue;
+
+      for(u_int8_t m = 0; m < s->num_metrics; m++) {
+	if(!std::isnan(values[m * s->chunk_points + p])) {
+	  c->point(idx, t, s->step, &values[p], s->chunk_points);
+	  break;
+	}
+      }
+    }
+  }
+}
+
+/* *************************************** */
+
+/* True when every "tag=value" of filter is in the key */
+bool TimeseriesStore::keyMatches(const std::string &key, const std::vector<std::string> &filter) {
+  for(u_int i = 0; i < filter.size(); i++) {
+    size_t pos = 0;
+    bool found = false;
+
+    while((pos = key.find(filter[i], pos)) != std::string::npos) {
+      size_t end = pos + filter[i].size();
+
+      if(((pos == 0) || (key[pos - 1] == ',')) && ((end == key.size()) || (key[end] == ','))) {
+	found = true;
+	break;
+      }
+
+      pos++;
+    }
+
+    if(!found)
+      return(false);
+  }
+
+  return(true);
+}
+
+/* *************************************** */
+
+/* s->m locked */
+void TimeseriesStore::selectSeries(ts_schema *s, const char *filter, std::vector<u_int32_t> *ids, std::vector<u_int32_t> *idx_of) {
+  std::unordered_map<std::string, u_int32_t>::iterator it = s->ids.find(filter);
+  std::vector<std::string> pairs;
+
+  if(it != s->ids.end()) {
+    /* All the tags: looked up in the chunks without idx_of */
+    ids->push_back(it->second);
+    return;
+  }
+
+  idx_of->assign(s->series.size(), 0);
+
+  if(filter[0] != '\0') {
+    char *tmp = strdup(filter), *tok, *saveptr = NULL;
+
+    if(tmp == NULL) return;
+
+    for(tok = strtok_r(tmp, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr))
+      pairs.push_back(tok);
+
+    free(tmp);
+  }
+
+  for(u_int32_t id = 0; id < s->series.size(); id++) {
+    if(s->series[id].key && keyMatches(*s->series[id].key, pairs))
+      ids->push_back(id), (*idx_of)[id] = (u_int32_t)ids->size();
+  }
+}
+
+/* *************************************** */
+
+/* The coarsest level whose step fits max_points in the range */
+u_int8_t TimeseriesStore::getQueryLevel(ts_schema *s, u_int32_t tstart, u_int32_t tend, u_int32_t max_points, u_int32_t *out_step) {
+  u_int32_t needed = (tend - tstart + max_points - 1) / max_points;
+  u_int8_t level = 0;
+
+  needed = max_val(needed, s->step);
+
+  while((level + 1 < s->num_levels) && (s->levels[level + 1].step <= needed))
+    level++;
+
+  /* Multiple of the level step */
+  *out_step = ((needed + s->levels[level].step - 1) / s->levels[level].step) * s->levels[level].step;
+
+  return(level);
+}
+
+/* *************************************** */
+
+/*
+  Each level answers up to where it has been rolled up, the finer ones
+  (and the chunks in memory) the most recent part. s->m locked
+*/
+void TimeseriesStore::takeSnapshot(ts_schema *s, u_int8_t level, u_int32_t from, u_int32_t tend, TsSnapshot *snap) {
+  u_int32_t lo = from;
+
+  for(int lv = level; lv >= 0; lv--) {
+    u_int32_t hi = (lv == 0) ? (tend + 1) : min_val(tend + 1, s->levels[lv].rolled_until);
+
+    if(hi > lo) {
+      snap->ranges.push_back(TsSnapshot::range());
+      snap->ranges.back().from = lo, snap->ranges.back().to = hi;
+      mapSegments(s, lv, lo, hi, &snap->ranges.back().segments);
+
+      if(lv == 0) {
+	snap->raw = true;
+	snap->sealed.assign(s->sealed.begin(), s->sealed.end());
+	snap->open = s->open;
+      }
+
+      lo = hi;
+    }
+  }
+}
+
+/* *************************************** */
+
+/* s->m not locked: only taken to read the open chunk */
+void TimeseriesStore::scanSnapshot(ts_schema *s, TsSnapshot *snap, const std::vector<u_int32_t> &ids,
+				   const std::vector<u_int32_t> &idx_of, TsConsumer *c) {
+  for(u_int i = 0; i < snap->ranges.size(); i++)
+    scan(s, snap->ranges[i].segments, snap->ranges[i].from, snap->ranges[i].to, ids, idx_of, c);
+
+  if(snap->raw) {
+    u_int32_t from = snap->ranges.back().from, to = snap->ranges.back().to;
+
+    for(u_int i = 0; i < snap->sealed.size(); i++)
+      scanChunk(s, snap->sealed[i].get(), from, to, ids, c);
+
+    if(snap->open) {
+      /* Possibly sealed meanwhile: it is then no longer modified */
+      s->m.lock(__FILE__, __LINE__);
+      scanChunk(s, snap->open.get(), from, to, ids, c);
+      s->m.unlock(__FILE__, __LINE__);
+    }
+  }
+}
+
+/* *************************************** */
+
+bool TimeseriesStore::query(const char *schema_name, const char *filter, u_int32_t tstart, u_int32_t tend,
+			    u_int32_t max_points, lua_State *vm) {
+  ts_schema *s = getSchema(schema_name, false);
+  std::vector<u_int32_t> ids, idx_of;
+  TsSnapshot snap;
+  u_int32_t out_step, grid_start, count;
+  u_int8_t level;
+  ticks begin = Utils::getticks();
+
+  if((s == NULL) || (tend < tstart) || (max_points == 0))
+    return(false);
+
+  level = getQueryLevel(s, tstart, tend, max_points, &out_step);
+  grid_start = tstart - (tstart % out_step);
+  count = (tend - grid_start) / out_step + 1;
+
+  s->m.lock(__FILE__, __LINE__);
+
+  selectSeries(s, filter, &ids, &idx_of);
+
+  if(ids.empty()) {
+    s->m.unlock(__FILE__, __LINE__);
+    return(false);
+  }
+
+  /* Counters need the point before the first bucket */
+  takeSnapshot(s, level, grid_start - s->levels[level].step, tend, &snap);
+
+  s->m.unlock(__FILE__, __LINE__);
+
+  TsQueryConsumer c(s->is_counter, s->num_metrics, s->step, (u_int32_t)ids.size(), grid_start, out_step, count);
+
+  scanSnapshot(s, &snap, ids, idx_of, &c);
+
+  lua_newtable(vm);
+  lua_push_uint32_table_entry(vm, "start", grid_start);
+  lua_push_uint32_table_entry(vm, "step", out_step);
+  lua_push_uint32_table_entry(vm, "count", count);
+  lua_push_uint32_table_entry(vm, "num_series", (u_int32_t)ids.size());
+
+  lua_createtable(vm, s->num_metrics, 0);
+
+  for(u_int8_t m = 0; m < s->num_metrics; m++) {
+    lua_createtable(vm, count, 0);
+
+    for(u_int32_t b = 0; b < count; b++) {
+      lua_pushnumber(vm, (lua_Number)c.value(b, m));
+      lua_rawseti(vm, -2, b + 1);
+    }
+
+    lua_rawseti(vm, -2, m + 1);
+  }
+
+  lua_setfield(vm, -2, "series");
+
+  num_queries++;
+  query_usec += (u_int64_t)((Utils::getticks() - begin) * 1000000 / Utils::gettickspersec());
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool TimeseriesStore::topk(const char *schema_name, const char *filter, u_int32_t tstart, u_int32_t tend,
+			   u_int32_t max_points, u_int32_t k, lua_State *vm) {
+  ts_schema *s = getSchema(schema_name, false);
+  std::vector<u_int32_t> ids, idx_of;
+  std::vector<std::pair<double, u_int32_t> > top; /* value, idx */
+  std::vector<std::pair<std::string, u_int32_t> > keys; /* key, position in top */
+  TsSnapshot snap;
+  u_int32_t out_step, grid_start, count;
+  u_int8_t level;
+  ticks begin = Utils::getticks();
+
+  if((s == NULL) || (tend < tstart) || (max_points == 0))
+    return(false);
+
+  level = getQueryLevel(s, tstart, tend, max_points, &out_step);
+  grid_start = tstart - (tstart % out_step);
+  count = (tend - grid_start) / out_step + 1;
+
+  s->m.lock(__FILE__, __LINE__);
+
+  selectSeries(s, filter, &ids, &idx_of);
+  takeSnapshot(s, level, grid_start - s->levels[level].step, tend, &snap);
+
+  s->m.unlock(__FILE__, __LINE__);
+
+  TsQueryConsumer c(s->is_counter, s->num_metrics, s->step, (u_int32_t)ids.size(), grid_start, out_step, count);
+
+  scanSnapshot(s, &snap, ids, idx_of, &c);
+
+  for(u_int32_t idx = 0; idx < ids.size(); idx++) {
+    double v = 0;
+
+    for(u_int8_t m = 0; m < s->num_metrics; m++)
+      v += c.sum(idx, m);
+
+    if(v > 0)
+      top.push_back(std::make_pair(v, idx));
+  }
+
+  k = min_val(k, (u_int32_t)top.size());
+  std::partial_sort(top.begin(), top.begin() + k, top.end(),
+		    [](const std::pair<double, u_int32_t> &a, const std::pair<double, u_int32_t> &b) { return(a.first > b.first); });
+
+  /* Series deleted during the scan are left out, ids are never reused */
+  s->m.lock(__FILE__, __LINE__);
+
+  for(u_int32_t i = 0; i < k; i++) {
+    const std::string *key = s->series[ids[top[i].second]].key;
+
+    if(key) keys.push_back(std::make_pair(*key, i));
+  }
+
+  s->m.unlock(__FILE__, __LINE__);
+
+  lua_newtable(vm);
+  lua_push_uint32_table_entry(vm, "start", grid_start);
+  lua_push_uint32_table_entry(vm, "step", out_step);
+  lua_push_uint32_table_entry(vm, "count", count);
+  lua_push_uint32_table_entry(vm, "num_series", (u_int32_t)ids.size());
+
+  lua_createtable(vm, keys.size(), 0);
+
+  for(u_int32_t i = 0; i < keys.size(); i++) {
+    const std::pair<double, u_int32_t> &t = top[keys[i].second];
+
+    lua_newtable(vm);
+    lua_push_str_table_entry(vm, "key", keys[i].first.c_str());
+    lua_pushnumber(vm, (lua_Number)t.first);
+    lua_setfield(vm, -2, "value");
+
+    lua_createtable(vm, s->num_metrics, 0);
+
+    for(u_int8_t m = 0; m < s->num_metrics; m++) {
+      lua_pushnumber(vm, (lua_Number)c.sum(t.second, m));
+      lua_rawseti(vm, -2, m + 1);
+    }
+
+    lua_setfield(vm, -2, "partials");
+    lua_rawseti(vm, -2, i + 1);
+  }
+
+  lua_setfield(vm, -2, "topk");
+
+  /* Sum of all the metrics of all the series */
+  lua_createtable(vm, count, 0);
+
+  for(u_int32_t b = 0; b < count; b++) {
+    double v = 0;
+
+    for(u_int8_t m = 0; m < s->num_metrics; m++) {
+      double mv = c.value(b, m);
+
+      if(!std::isnan(mv)) v += mv;
+    }
+
+    lua_pushnumber(vm, (lua_Number)v);
+    lua_rawseti(vm, -2, b + 1);
+  }
+
+  lua_setfield(vm, -2, "total");
+
+  num_queries++;
+  query_usec += (u_int64_t)((Utils::getticks() - begin) * 1000000 / Utils::gettickspersec());
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool TimeseriesStore::listSeries(const char *schema_name, const char *filter, u_int32_t start_time, lua_State *vm) {
+  ts_schema *s = getSchema(schema_name, false);
+  std::vector<u_int32_t> ids, idx_of;
+  u_int32_t n = 0;
+
+  if(s == NULL)
+    return(false);
+
+  s->m.lock(__FILE__, __LINE__);
+
+  selectSeries(s, filter, &ids, &idx_of);
+
+  lua_newtable(vm);
+
+  for(u_int32_t i = 0; i < ids.size(); i++) {
+    if(s->series[ids[i]].last_ts >= start_time) {
+      lua_pushstring(vm, s->series[ids[i]].key->c_str());
+      lua_rawseti(vm, -2, ++n);
+    }
+  }
+
+  s->m.unlock(__FILE__, __LINE__);
+
+  return(true);
+}
+
+/* *************************************** */
+
+/* Series are removed from the dictionary, their points become unreachable and expire with the segments */
+u_int32_t TimeseriesStore::deleteSeries(const char *schema_prefix, const char *filter) {
+  std::vector<ts_schema*> matching;
+  size_t prefix_len = strlen(schema_prefix);
+  u_int32_t num_deleted = 0;
+
+  m.lock(__FILE__, __LINE__);
+
+  for(std::map<std::string, ts_schema*>::iterator it = schemas.begin(); it != schemas.end(); ++it) {
+    if(!strncmp(it->first.c_str(), schema_prefix, prefix_len))
+      matching.push_back(it->second);
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  for(u_int i = 0; i < matching.size(); i++) {
+    ts_schema *s = matching[i];
+    std::vector<u_int32_t> ids, idx_of;
+
+    s->m.lock(__FILE__, __LINE__);
+
+    selectSeries(s, filter, &ids, &idx_of);
+
+    for(u_int32_t j = 0; j < ids.size(); j++) {
+      struct ts_series_record r;
+
+      r.id = ids[j], r.last_ts = 0, r.key_len = 0;
+
+      if(s->series_fd)
+	fwrite(&r, sizeof(r), 1, s->series_fd);
+
+      s->ids.erase(*s->series[ids[j]].key);
+      s->series[ids[j]].key = NULL, s->num_active--;
+    }
+
+    if(s->series_fd) fflush(s->series_fd);
+    num_deleted += (u_int32_t)ids.size();
+
+    s->m.unlock(__FILE__, __LINE__);
+  }
+
+  return(num_deleted);
+}
+
+/* *************************************** */
+
+void TimeseriesStore::deleteOldData(u_int32_t retention_sec) {
+  std::vector<ts_schema*> all;
+  u_int32_t now = (u_int32_t)time(NULL), deadline = (now > retention_sec) ? (now - retention_sec) : 0;
+
+  m.lock(__FILE__, __LINE__);
+
+  for(std::map<std::string, ts_schema*>::iterator it = schemas.begin(); it != schemas.end(); ++it)
+    all.push_back(it->second);
+
+  m.unlock(__FILE__, __LINE__);
+
+  for(u_int i = 0; i < all.size(); i++) {
+    ts_schema *s = all[i];
+    std::vector<std::pair<u_int8_t, u_int32_t> > segments;
+    u_int32_t num_expired = 0;
+
+    listSegments(s, &segments);
+
+    for(u_int j = 0; j < segments.size(); j++) {
+      if(segments[j].second + s->levels[segments[j].first].segment_duration <= deadline) {
+	char path[MAX_PATH];
+
+	getSegmentPath(s, segments[j].first, segments[j].second, path, sizeof(path));
+	unlink(path);
+      }
+    }
+
+    s->m.lock(__FILE__, __LINE__);
+
+    for(u_int32_t id = 0; id < s->series.size(); id++) {
+      if(s->series[id].key && (s->series[id].last_ts < deadline)) {
+	s->ids.erase(*s->series[id].key);
+	s->series[id].key = NULL, s->num_active--, num_expired++;
+      }
+    }
+
+    /* Compacts the deletions too */
+    if(num_expired > 0)
+      rewriteSeries(s);
+
+    s->m.unlock(__FILE__, __LINE__);
+  }
+}
+
+/* *************************************** */
+
+void TimeseriesStore::lua(lua_State *vm) {
+  u_int64_t num_series = 0, num_open_series = 0;
+  u_int32_t num_schemas;
+
+  m.lock(__FILE__, __LINE__);
+
+  num_schemas = (u_int32_t)schemas.size();
+
+  for(std::map<std::string, ts_schema*>::iterator it = schemas.begin(); it != schemas.end(); ++it) {
+    ts_schema *s = it->second;
+
+    s->m.lock(__FILE__, __LINE__);
+    num_series += s->num_active;
+    if(s->open) num_open_series += s->open->slot_series.size();
+    s->m.unlock(__FILE__, __LINE__);
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  lua_newtable(vm);
+  lua_push_str_table_entry(vm, "path", base_path);
+  lua_push_uint32_table_entry(vm, "num_schemas", num_schemas);
+  lua_push_uint64_table_entry(vm, "num_series", num_series);
+  lua_push_uint64_table_entry(vm, "num_open_series", num_open_series);
+  lua_push_uint64_table_entry(vm, "num_points", num_points.load());
+  lua_push_uint64_table_entry(vm, "num_late_points", num_late_points.load());
+  lua_push_uint64_table_entry(vm, "num_chunks", num_chunks.load());
+  lua_push_uint64_table_entry(vm, "num_chunk_bytes", num_chunk_bytes.load());
+  lua_push_uint64_table_entry(vm, "num_raw_bytes", num_raw_bytes.load());
+  lua_push_uint64_table_entry(vm, "num_rollups", num_rollups.load());
+  lua_push_float_table_entry(vm, "avg_rollup_ms", num_rollups ? (rollup_usec / 1000.0 / num_rollups) : 0);
+  lua_push_uint64_table_entry(vm, "num_queries", num_queries.load());
+  lua_push_float_table_entry(vm, "avg_query_ms", num_queries ? (query_usec / 1000.0 / num_queries) : 0);
+}
+
+#endif /* WIN32 */
@@ -0,0 +1,550 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "ntop_includes.h"
+
+#define TS_TOPK_GROUP_IDLE  86400 /* Groups not updated for longer are freed */
+#define TS_TOPK_PURGE_EVERY 3600
+
+/* ******************************************* */
+
+TimeseriesTopK::TimeseriesTopK() {
+  last_purge = 0;
+  num_updates = num_queries = num_misses = num_approximate = query_usec = 0;
+}
+
+/* ******************************************* */
+
+TimeseriesTopK::~TimeseriesTopK() {
+  for(std::unordered_map<std::string, ts_topk_group*>::iterator it = groups.begin(); it != groups.end(); ++it)
+    freeGroup(it->second);
+}
+
+/* ******************************************* */
+
+void TimeseriesTopK::freeGroup(ts_topk_group *g) {
+  for(u_int8_t l = 0; l < TS_TOPK_NUM_LEVELS; l++)
+    for(std::vector<ts_topk_slot>::iterator it = g->slots[l].begin(); it != g->slots[l].end(); ++it)
+      if(it->cms) delete[] it->cms;
+
+  delete g;
+}
+
+/* ******************************************* */
+
+/* Called with m locked */
+void TimeseriesTopK::purgeIdle(u_int32_t now) {
+  for(std::unordered_map<std::string, ts_topk_pending>::iterator it = pending.begin(); it != pending.end(); ) {
+    if(it->second.last_update + TS_TOPK_PURGE_EVERY < now)
+      it = pending.erase(it);
+    else
+      ++it;
+  }
+
+  for(std::unordered_map<std::string, ts_topk_group*>::iterator it = groups.begin(); it != groups.end(); ) {
+    ts_topk_group *g = it->second;
+
+    if(g->last_update + TS_TOPK_GROUP_IDLE < now) {
+      /* Groups are only locked with m held: wait for the current user, if any */
+      g->m.lock(__FILE__, __LINE__);
+      g->m.unlock(__FILE__, __LINE__);
+
+      freeGroup(g);
+      it = groups.erase(it);
+    } else
+      ++it;
+  }
+
+  last_purge = now;
+}
+
+/* ******************************************* */
+
+ts_topk_group* TimeseriesTopK::getGroup(const std::string &group_key, u_int32_t when, u_int32_t step,
+					u_int8_t num_metrics, bool is_counter) {
+  std::unordered_map<std::string, ts_topk_group*>::iterator it;
+  ts_topk_group *g = NULL;
+
+  m.lock(__FILE__, __LINE__);
+
+  if(when >= last_purge + TS_TOPK_PURGE_EVERY)
+    purgeIdle(when);
+
+  if((it = groups.find(group_key)) != groups.end())
+    g = it->second;
+  else {
+    ts_topk_pending *p = &pending[group_key];
+
+    /* Every item of a group is written once per step: count them */
+    if(p->slot != when / step)
+      p->slot = when / step, p->count = 0;
+
+    p->count++, p->last_update = when;
+
+    if((p->count >= TS_TOPK_MIN_GROUP_ITEMS)
+       && (groups.size() < TS_TOPK_MAX_GROUPS)
+       && ((g = new (std::nothrow) ts_topk_group) != NULL)) {
+      u_int32_t durations[TS_TOPK_NUM_LEVELS] = { step, 3600, 86400 };
+      u_int32_t num_slots[TS_TOPK_NUM_LEVELS] = { min_val(3600 / step, 60) + 2, TS_TOPK_HOURLY_SLOTS, TS_TOPK_DAILY_SLOTS };
+
+      g->step = step, g->num_metrics = num_metrics, g->is_counter = is_counter, g->last_update = when;
+
+      /* Items seen before the promotion miss this slot, counters also need a previous value */
+      g->covered_from = (p->slot + (is_counter ? 2 : 1)) * step;
+
+      for(u_int8_t l = 0; l < TS_TOPK_NUM_LEVELS; l++) {
+	ts_topk_slot empty;
+
+	/* Levels not coarser than the step are useless */
+	if((l > 0) && (durations[l] <= step)) {
+	  g->slot_duration[l] = 0;
+	  continue;
+	}
+
+	memset(&empty, 0, sizeof(empty));
+	g->slot_duration[l] = durations[l];
+	g->slots[l].assign(num_slots[l], empty);
+      }
+
+      groups[group_key] = g;
+      pending.erase(group_key);
+
+      ntop->getTrace()->traceEvent(TRACE_INFO, "Timeseries topk summary enabled on %s", group_key.c_str());
+    }
+  }
+
+  if(g) {
+    if((g->num_metrics == num_metrics) && (g->is_counter == is_counter) && (g->step == step))
+      g->m.lock(__FILE__, __LINE__), g->last_update = max_val(g->last_update, when);
+    else
+      g = NULL; /* The schema has changed */
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(g);
+}
+
+/* ******************************************* */
+
+void TimeseriesTopK::resetSlot(ts_topk_group *g, ts_topk_slot *slot, u_int32_t start) {
+  slot->start = start, slot->num_candidates = 0, slot->threshold = 0;
+  memset(slot->totals, 0, sizeof(slot->totals));
+
+  if(slot->cms)
+    memset(slot->cms, 0, sizeof(float) * TS_TOPK_CMS_DEPTH * TS_TOPK_CMS_WIDTH * g->num_metrics);
+}
+
+/* ******************************************* */
+
+u_int32_t TimeseriesTopK::cell(u_int32_t item_id, u_int8_t row) {
+  u_int64_t h = ((u_int64_t)item_id + 1) * 0x9E3779B97F4A7C15ULL ^ ((u_int64_t)row + 1) * 0xC2B2AE3D27D4EB4FULL;
+
+  h ^= h >> 29, h *= 0xBF58476D1CE4E5B9ULL, h ^= h >> 32;
+
+  return((u_int32_t)(h & (TS_TOPK_CMS_WIDTH - 1)));
+}
+
+/* ******************************************* */
+
+void TimeseriesTopK::estimate(ts_topk_group *g, const ts_topk_slot *slot, u_int32_t item_id, double *values) {
+  for(u_int8_t i = 0; i < g->num_metrics; i++)
+    values[i] = 0;
+
+  if(!slot->cms)
+    return;
+
+  for(u_int8_t r = 0; r < TS_TOPK_CMS_DEPTH; r++) {
+    const float *c = &slot->cms[((size_t)r * TS_TOPK_CMS_WIDTH + cell(item_id, r)) * g->num_metrics];
+
+    for(u_int8_t i = 0; i < g->num_metrics; i++)
+      values[i] = (r == 0) ? c[i] : min_val(values[i], (double)c[i]);
+  }
+}
+
+/* ******************************************* */
+
+/* single_point: the item has no other point in the slot */
+void TimeseriesTopK::updateSlot(ts_topk_group *g, ts_topk_slot *slot, u_int32_t item_id, const double *values, bool single_point) {
+  double prior[TS_TOPK_MAX_METRICS];
+  float total = 0;
+  bool exact = true;
+  u_int8_t i, j, min_idx = 0;
+
+  if((!slot->cms)
+     && ((slot->cms = new (std::nothrow) float[(size_t)TS_TOPK_CMS_DEPTH * TS_TOPK_CMS_WIDTH * g->num_metrics]()) == NULL))
+    return;
+
+  for(i = 0; i < g->num_metrics; i++)
+    slot->totals[i] += values[i];
+
+  for(i = 0; i < slot->num_candidates; i++)
+    if(slot->candidates[i] == item_id) break;
+
+  if(i < slot->num_candidates) {
+    /* Already a candidate: its value is exact from now on */
+    for(j = 0; j < g->num_metrics; j++)
+      slot->values[i][j] += values[j], total += slot->values[i][j];
+
+    slot->totals_by_candidate[i] = total;
+  } else {
+    /*
+      New candidate: the previous points of the slot, if any, are estimated.
+      It has none when no item has been dropped so far
+    */
+    if(single_point || (slot->threshold == 0))
+      memset(prior, 0, sizeof(prior));
+    else
+      estimate(g, slot, item_id, prior);
+
+    for(j = 0; j < g->num_metrics; j++) {
+      /* The sketch never underestimates: a zero is exact */
+      if(prior[j] > 0) exact = false;
+      prior[j] += values[j], total += prior[j];
+    }
+
+    for(i = 0; i < slot->num_candidates; i++)
+      if(slot->totals_by_candidate[i] < slot->totals_by_candidate[min_idx])
+	min_idx = i;
+
+    if(slot->num_candidates < TS_TOPK_CANDIDATES)
+      min_idx = slot->num_candidates++;
+    else if(total <= slot->totals_by_candidate[min_idx]) {
+      /* Not among the top ones */
+      slot->threshold = max_val(slot->threshold, total);
+      min_idx = TS_TOPK_CANDIDATES;
+    } else
+      slot->threshold = max_val(slot->threshold, slot->totals_by_candidate[min_idx]);
+
+    if(min_idx < TS_TOPK_CANDIDATES) {
+      slot->candidates[min_idx] = item_id, slot->totals_by_candidate[min_idx] = total;
+      slot->exact[min_idx] = exact;
+
+      for(j = 0; j < g->num_metrics; j++)
+	slot->values[min_idx][j] = prior[j];
+    }
+  }
+
+  for(u_int8_t r = 0; r < TS_TOPK_CMS_DEPTH; r++) {
+    float *c = &slot->cms[((size_t)r * TS_TOPK_CMS_WIDTH + cell(item_id, r)) * g->num_metrics];
+
+    for(j = 0; j < g->num_metrics; j++)
+      c[j] += values[j];
+  }
+}
+
+/* ******************************************* */
+
+/* Returns true when the values are exact */
+bool TimeseriesTopK::getValues(ts_topk_group *g, const ts_topk_slot *slot, u_int32_t item_id, double *values) {
+  for(u_int8_t i = 0; i < slot->num_candidates; i++) {
+    if(slot->candidates[i] == item_id) {
+      for(u_int8_t j = 0; j < g->num_metrics; j++)
+	values[j] = slot->values[i][j];
+
+      return(slot->exact[i]);
+    }
+  }
+
+  /* Not a candidate: no value exceeds the threshold, which is zero when no item has been dropped */
+  estimate(g, slot, item_id, values);
+
+  for(u_int8_t j = 0; j < g->num_metrics; j++)
+    values[j] = min_val(values[j], (double)slot->threshold);
+
+  return(slot->threshold == 0);
+}
+
+/* ******************************************* */
+
+void TimeseriesTopK::update(const char *schema_name, const char *group, const char *item, u_int32_t when,
+			    u_int32_t step, bool is_counter, const double *values, u_int8_t num_values) {
+  std::string group_key(schema_name);
+  std::unordered_map<std::string, u_int32_t>::iterator it;
+  double deltas[TS_TOPK_MAX_METRICS];
+  ts_topk_group *g;
+  u_int32_t item_id;
+
+  if((step == 0) || (num_values == 0) || (num_values > TS_TOPK_MAX_METRICS))
+    return;
+
+  group_key.append("|").append(group);
+
+  if((g = getGroup(group_key, when, step, num_values, is_counter)) == NULL)
+    return;
+
+  if((it = g->ids.find(item)) != g->ids.end())
+    item_id = it->second;
+  else {
+    item_id = (u_int32_t)g->items.size();
+    g->ids[item] = item_id, g->items.push_back(item);
+
+    if(is_counter)
+      g->prev.resize(g->prev.size() + num_values), g->prev_when.push_back(0);
+  }
+
+  if(is_counter) {
+    double *prev = &g->prev[(size_t)item_id * num_values];
+    /* The first value, or the first after a gap, only sets the counters base */
+    bool is_base = (g->prev_when[item_id] == 0) || (when > g->prev_when[item_id] + 2 * step);
+
+    for(u_int8_t i = 0; i < num_values; i++) {
+      /* Decreasing values are counter resets */
+      deltas[i] = (values[i] >= prev[i]) ? (values[i] - prev[i]) : 0;
+      prev[i] = values[i];
+    }
+
+    g->prev_when[item_id] = when;
+
+    if(is_base) {
+      g->m.unlock(__FILE__, __LINE__);
+      return;
+    }
+  } else {
+    for(u_int8_t i = 0; i < num_values; i++)
+      deltas[i] = values[i] * step;
+  }
+
+  for(u_int8_t l = 0; l < TS_TOPK_NUM_LEVELS; l++) {
+    u_int32_t duration = g->slot_duration[l], start;
+    ts_topk_slot *slot;
+
+    if(duration == 0) continue;
+
+    start = when - (when % duration);
+    slot = &g->slots[l][(when / duration) % g->slots[l].size()];
+
+    if(slot->start != start) {
+      if(slot->start > start)
+	continue; /* Too old, the slot has been reused */
+
+      resetSlot(g, slot, start);
+    }
+
+    updateSlot(g, slot, item_id, deltas, (duration == step));
+  }
+
+  g->m.unlock(__FILE__, __LINE__);
+  num_updates++;
+}
+
+/* ******************************************* */
+
+bool TimeseriesTopK::query(const char *schema_name, const char *group, u_int32_t tstart, u_int32_t tend,
+			   u_int32_t k, lua_State *vm) {
+  std::string group_key(schema_name);
+  std::unordered_map<std::string, ts_topk_group*>::iterator it;
+  std::vector<std::pair<double, u_int32_t> > top; /* value, candidate index */
+  std::vector<u_int32_t> candidates;
+  std::vector<double> partials, totals;
+  std::vector<bool> exact;
+  double outside = 0; /* Bound of the total of an item not among the candidates of any slot */
+  bool approximate = false;
+  std::vector<std::string> names;
+  u_int32_t duration = 0, first = 0, count = 0;
+  ts_topk_group *g = NULL;
+  u_int8_t level, num_metrics = 0;
+  ticks begin = Utils::getticks();
+
+  if(tend < tstart)
+    return(false);
+
+  group_key.append("|").append(group);
+
+  m.lock(__FILE__, __LINE__);
+
+  if((it = groups.find(group_key)) != groups.end())
+    g = it->second, g->m.lock(__FILE__, __LINE__);
+
+  m.unlock(__FILE__, __LINE__);
+
+  if(g) {
+    /* The finest level whose ring holds the window */
+    for(level = 0; level < TS_TOPK_NUM_LEVELS; level++) {
+      u_int32_t d = g->slot_duration[level];
+
+      if((d == 0) || ((tend / d - tstart / d + 1) >= g->slots[level].size()))
+	continue;
+
+      if((tstart - (tstart % d)) >= g->covered_from)
+	duration = d, first = tstart / d, count = tend / d - first + 1;
+
+      break;
+    }
+  }
+
+  if(duration == 0) {
+    if(g) g->m.unlock(__FILE__, __LINE__);
+    num_misses++;
+    return(false);
+  }
+
+  num_metrics = g->num_metrics;
+  totals.assign(count, 0);
+
+  for(u_int32_t i = 0; i < count; i++) {
+    ts_topk_slot *slot = &g->slots[level][(first + i) % g->slots[level].size()];
+
+    if(slot->start != (first + i) * duration)
+      continue;
+
+    for(u_int8_t c = 0; c < slot->num_candidates; c++)
+      candidates.push_back(slot->candidates[c]);
+
+    for(u_int8_t j = 0; j < num_metrics; j++)
+      totals[i] += slot->totals[j];
+
+    outside += slot->threshold;
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  partials.assign(candidates.size() * num_metrics, 0);
+  exact.assign(candidates.size(), true);
+
+  for(u_int32_t i = 0; i < count; i++) {
+    ts_topk_slot *slot = &g->slots[level][(first + i) % g->slots[level].size()];
+    double est[TS_TOPK_MAX_METRICS];
+
+    if(slot->start != (first + i) * duration)
+      continue;
+
+    for(u_int32_t c = 0; c < candidates.size(); c++) {
+      if(!getValues(g, slot, candidates[c], est))
+	exact[c] = false;
+
+      for(u_int8_t j = 0; j < num_metrics; j++)
+	partials[(size_t)c * num_metrics + j] += est[j];
+    }
+  }
+
+  for(u_int32_t c = 0; c < candidates.size(); c++) {
+    double v = 0;
+
+    for(u_int8_t j = 0; j < num_metrics; j++)
+      v += partials[(size_t)c * num_metrics + j];
+
+    if(v > 0)
+      top.push_back(std::make_pair(v, c));
+  }
+
+  /* Fewer items than requested: any item outside of the candidates could rank */
+  if((outside > 0) && (top.size() < k))
+    approximate = true;
+
+  k = min_val(k, (u_int32_t)top.size());
+  std::partial_sort(top.begin(), top.begin() + k, top.end(),
+		    [](const std::pair<double, u_int32_t> &a, const std::pair<double, u_int32_t> &b) { return(a.first > b.first); });
+
+  for(u_int32_t i = 0; i < k; i++) {
+    names.push_back(g->items[candidates[top[i].second]]);
+
+    if(!exact[top[i].second])
+      approximate = true;
+  }
+
+  /* An item outside of the candidates could exceed the last top one */
+  if((k > 0) && (top[k - 1].first < outside))
+    approximate = true;
+
+  g->m.unlock(__FILE__, __LINE__);
+
+  lua_newtable(vm);
+  lua_push_uint32_table_entry(vm, "start", first * duration);
+  lua_push_uint32_table_entry(vm, "step", duration);
+  lua_push_uint32_table_entry(vm, "count", count);
+  lua_push_bool_table_entry(vm, "approximate", approximate);
+
+  lua_createtable(vm, k, 0);
+
+  for(u_int32_t i = 0; i < k; i++) {
+    lua_newtable(vm);
+    lua_push_str_table_entry(vm, "item", names[i].c_str());
+    lua_pushnumber(vm, (lua_Number)top[i].first);
+    lua_setfield(vm, -2, "value");
+
+    lua_createtable(vm, num_metrics, 0);
+
+    for(u_int8_t j = 0; j < num_metrics; j++) {
+      lua_pushnumber(vm, (lua_Number)partials[(size_t)top[i].second * num_metrics + j]);
+      lua_rawseti(vm, -2, j + 1);
+    }
+
+    lua_setfield(vm, -2, "partials");
+    lua_rawseti(vm, -2, i + 1);
+  }
+
+  lua_setfield(vm, -2, "topk");
+
+  /* Sum of all the metrics of all the items, per second as the driver series */
+  lua_createtable(vm, count, 0);
+
+  for(u_int32_t i = 0; i < count; i++) {
+    lua_pushnumber(vm, (lua_Number)(totals[i] / duration));
+    lua_rawseti(vm, -2, i + 1);
+  }
+
+  lua_setfield(vm, -2, "total");
+
+  num_queries++;
+  if(approximate) num_approximate++;
+  query_usec += (u_int64_t)((Utils::getticks() - begin) * 1000000 / Utils::gettickspersec());
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void TimeseriesTopK::lua(lua_State *vm) {
+  u_int64_t num_items = 0, memory = 0;
+  u_int32_t num_groups, num_pending;
+
+  m.lock(__FILE__, __LINE__);
+
+  num_groups = (u_int32_t)groups.size(), num_pending = (u_int32_t)pending.size();
+
+  for(std::unordered_map<std::string, ts_topk_group*>::iterator it = groups.begin(); it != groups.end(); ++it) {
+    ts_topk_group *g = it->second;
+
+    g->m.lock(__FILE__, __LINE__);
+
+    num_items += g->items.size();
+
+    for(u_int8_t l = 0; l < TS_TOPK_NUM_LEVELS; l++)
+      for(std::vector<ts_topk_slot>::iterator s = g->slots[l].begin(); s != g->slots[l].end(); ++s)
+	memory += sizeof(ts_topk_slot) + (s->cms ? (sizeof(float) * TS_TOPK_CMS_DEPTH * TS_TOPK_CMS_WIDTH * g->num_metrics) : 0);
+
+    g->m.unlock(__FILE__, __LINE__);
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  lua_newtable(vm);
+  lua_push_uint32_table_entry(vm, "num_groups", num_groups);
+  lua_push_uint32_table_entry(vm, "num_pending_groups", num_pending);
+  lua_push_uint64_table_entry(vm, "num_items", num_items);
+  lua_push_uint64_table_entry(vm, "slots_memory", memory);
+  lua_push_uint64_table_entry(vm, "num_updates", num_updates.load());
+  lua_push_uint64_table_entry(vm, "num_queries", num_queries.load());
+  lua_push_uint64_table_entry(vm, "num_misses", num_misses.load());
+  lua_push_uint64_table_entry(vm, "num_approximate", num_approximate.load());
+  lua_push_float_table_entry(vm, "avg_query_ms", num_queries ? (query_usec / 1000.0 / num_queries) : 0);
+}
@@ -3944,6 +3944,66 @@ bool Utils::str2DetailsLevel(const char *details, DetailsLevel *out) {
 
 /* ****************************************************** */
 
+/* Same order as FlowLuaField and HostLuaField */
+static const char* flow_lua_field_names[FLOW_LUA_NUM_FIELDS] = {
+  "hosts", "ports", "bytes", "packets", "vlan", "asn", "dscp", "proto", "time",
+  "dir_traffic", "score", "icmp", "tcp", "info", "app", "verdict", "snmp", "json",
+  "thpt", "iat", "geoloc", "risk", "status"
+};
+
+static const char* host_lua_field_names[HOST_LUA_NUM_FIELDS] = {
+  "name", "flags", "mac", "alerts", "score", "asn", "os", "pool", "traffic", "flows",
+  "contacts", "protocols", "time", "fingerprints", "geoloc", "info", "services", "network"
+};
+
+/*
+  Converts a comma separated list of field names (e.g. "bytes,proto,thpt")
+  into a bitmap of fields: unknown names are ignored, an empty list means all fields.
+*/
+static u_int32_t str2LuaFields(const char *fields, const char **names, u_int num_names) {
+  u_int32_t rv = 0;
+  char *tmp, *name, *where;
+
+  if((fields == NULL) || (fields[0] == '\0') || ((tmp = strdup(fields)) == NULL))
+    return((u_int32_t)-1);
+
+  name = strtok_r(tmp, ", ", &where);
+
+  while(name) {
+    u_int i;
+
+    for(i = 0; i < num_names; i++) {
+      if(!strcmp(name, names[i])) {
+	rv |= (1 << i);
+	break;
+      }
+    }
+
+    if(i == num_names)
+      ntop->getTrace()->traceEvent(TRACE_INFO, "Unknown field %s", name);
+
+    name = strtok_r(NULL, ", ", &where);
+  }
+
+  free(tmp);
+
+  return(rv);
+}
+
+/* ****************************************************** */
+
+u_int32_t Utils::str2FlowLuaFields(const char *fields) {
+  return(str2LuaFields(fields, flow_lua_field_names, FLOW_LUA_NUM_FIELDS));
+}
+
+/* ****************************************************** */
+
+u_int32_t Utils::str2HostLuaFields(const char *fields) {
+  return(str2LuaFields(fields, host_lua_field_names, HOST_LUA_NUM_FIELDS));
+}
+
+/* ****************************************************** */
+
 bool Utils::isCriticalNetworkProtocol(u_int16_t protocol_id) {
   return (protocol_id == NDPI_PROTOCOL_DNS) || (protocol_id == NDPI_PROTOCOL_DHCP);
 }
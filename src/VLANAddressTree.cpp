@@ -26,6 +26,7 @@
 VLANAddressTree::VLANAddressTree() {
   tree = new (std::nothrow) AddressTree*[MAX_NUM_VLAN];
   memset(tree, 0, sizeof(AddressTree*) * MAX_NUM_VLAN);
+  compiled = NULL;
 }
 
 /* **************************************** */
@@ -36,6 +37,32 @@ VLANAddressTree::~VLANAddressTree() {
       delete tree[i];
 
   delete [] tree;
+
+  if(compiled) {
+    for(int i = 0; i < MAX_NUM_VLAN; i++)
+      if(compiled[i])
+	delete compiled[i];
+
+    delete [] compiled;
+  }
+}
+
+/* **************************************** */
+
+void VLANAddressTree::compile() {
+  if(compiled || ((compiled = new (std::nothrow) CompiledAddressTree*[MAX_NUM_VLAN]) == NULL))
+    return;
+
+  memset(compiled, 0, sizeof(CompiledAddressTree*) * MAX_NUM_VLAN);
+
+  /*
+    VLANs without a compiled tree fall back to the AddressTree: small trees
+    are not compiled as the root tables would dominate the memory with
+    many VLANs, while the patricia is only a few nodes deep.
+  */
+  for(int i = 0; i < MAX_NUM_VLAN; i++)
+    if(tree[i] && (tree[i]->getNumAddresses() >= COMPILED_TREE_MIN_VLAN_ADDRESSES))
+      compiled[i] = CompiledAddressTree::compile(tree[i]);
 }
 
 /* **************************************** */
@@ -69,6 +96,7 @@ bool VLANAddressTree::addAddresses(VLANid vlan_id, char *net, const int16_t user
 
 int16_t VLANAddressTree::findAddress(VLANid vlan_id, int family, void *addr, u_int8_t *network_mask_bits) {
   if(! tree[vlan_id]) return -1;
+  if(compiled && compiled[vlan_id]) return compiled[vlan_id]->findAddress(family, addr, network_mask_bits);
   return tree[vlan_id]->findAddress(family, addr, network_mask_bits);
 }
 
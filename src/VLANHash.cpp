@@ -39,9 +39,10 @@ VLAN* VLANHash::get(VLANid _vlan_id, bool is_inline_call) {
     return(NULL);
   } else {
     VLAN *head;
+    int epoch_slot = -1;
 
     if(!is_inline_call)
-      locks[hash]->rdlock(__FILE__, __LINE__);
+      epoch_slot = enterReadSection(hash);
 
     head = (VLAN*)table[hash];
 
@@ -53,7 +54,7 @@ VLAN* VLANHash::get(VLANid _vlan_id, bool is_inline_call) {
     }
 
     if(!is_inline_call)
-      locks[hash]->unlock(__FILE__, __LINE__);
+      exitReadSection(hash, epoch_slot);
     
     return(head);
   }
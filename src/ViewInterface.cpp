@@ -21,6 +21,24 @@
 
 #include "ntop_includes.h"
 
+/* A flow partial whose hosts are updated by the merge threads */
+struct ViewMergeJob {
+  Flow *flow;
+  Host *cli_host, *srv_host;
+  PartializableFlowTrafficStats partials;
+  struct timeval tv;
+  bool first_partial;
+  std::atomic<u_int8_t> num_refs; /* One per host: the last update releases the job and the flow */
+
+  ViewMergeJob(Flow *_flow, Host *_cli_host, Host *_srv_host,
+	       const PartializableFlowTrafficStats *_partials, bool _first_partial,
+	       const struct timeval *_tv) : partials(*_partials) {
+    flow = _flow, cli_host = _cli_host, srv_host = _srv_host;
+    first_partial = _first_partial, tv = *_tv;
+    num_refs = 0;
+  }
+};
+
 /* **************************************************** */
 
 ViewInterface::ViewInterface(const char *_endpoint) : NetworkInterface(_endpoint) {
@@ -29,7 +47,10 @@ ViewInterface::ViewInterface(const char *_endpoint) : NetworkInterface(_endpoint
 
   memset(viewed_interfaces, 0, sizeof(viewed_interfaces));
   memset(viewed_interfaces_queues, 0, sizeof(viewed_interfaces_queues));
+  memset(merge_stats, 0, sizeof(merge_stats));
   num_viewed_interfaces = 0;
+  poller_waiting = false;
+  num_merge_threads = 0, ticks_per_usec = 1;
 
   if(!strcmp(_endpoint, "view:all")) {
     /* Create a view on all the active interfaces */
@@ -97,6 +118,12 @@ ViewInterface::~ViewInterface() {
     if(viewed_interfaces_queues[i])
       delete viewed_interfaces_queues[i];
   }
+
+  /* Threads are stopped at the end of the flowPollLoop */
+  for(int i = 0; i < num_merge_threads; i++) {
+    if(merge_threads[i].queue)
+      delete merge_threads[i].queue;
+  }
 }
 
 /* **************************************************** */
@@ -111,6 +138,12 @@ bool ViewInterface::viewEnqueue(time_t t, Flow *f, u_int8_t viewed_interface_id)
       Enqueue was successful - enough room in the queue.
      */
     f->incUses(); /* Increase the reference counter. Decrease will be done when dequeuing this flow */
+
+    /* Pairs with the fence of waitForFlows(): either the poller sees the flow or we see it waiting */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(poller_waiting.load(std::memory_order_relaxed))
+      flows_available.signal();
+
     return true;
   }
 
@@ -120,7 +153,8 @@ bool ViewInterface::viewEnqueue(time_t t, Flow *f, u_int8_t viewed_interface_id)
 /* **************************************************** */
 
 u_int64_t ViewInterface::viewDequeue(u_int budget) {
-  u_int64_t num = 0;
+  u_int64_t num = 0, num_flows[MAX_NUM_VIEW_INTERFACES];
+  ticks begin[MAX_NUM_VIEW_INTERFACES];
   struct timeval tv;
 
   gettimeofday(&tv, NULL);
@@ -128,6 +162,8 @@ u_int64_t ViewInterface::viewDequeue(u_int budget) {
   for(int i = 0; i < num_viewed_interfaces; i++) {
     u_int64_t flows_done = 0;
 
+    begin[i] = Utils::getticks();
+
     while(viewed_interfaces_queues[i]->isNotEmpty()) {
       Flow *f = viewed_interfaces_queues[i]->dequeue();
 
@@ -145,7 +181,24 @@ u_int64_t ViewInterface::viewDequeue(u_int budget) {
 	break;
     }
 
+    num_flows[i] = flows_done;
     num += flows_done;
+
+    if(flows_done && (num_merge_threads == 0))
+      updateMergeStats(i, flows_done, Utils::getticks() - begin[i]);
+  }
+
+  if(num && num_merge_threads) {
+    ticks now;
+
+    /* Flows are merged when their hosts are updated too */
+    waitMergeThreads();
+    now = Utils::getticks();
+
+    for(int i = 0; i < num_viewed_interfaces; i++) {
+      if(num_flows[i])
+	updateMergeStats(i, num_flows[i], now - begin[i]);
+    }
   }
 
   return num;
@@ -153,6 +206,17 @@ u_int64_t ViewInterface::viewDequeue(u_int budget) {
 
 /* **************************************************** */
 
+void ViewInterface::updateMergeStats(u_int8_t viewed_interface_id, u_int64_t num_flows, ticks latency) {
+  ViewMergeStats *s = &merge_stats[viewed_interface_id];
+  u_int32_t latency_usec = (u_int32_t)(latency / ticks_per_usec);
+
+  s->num_merged_flows += num_flows, s->num_batches++;
+  s->tot_latency_usec += latency_usec, s->last_latency_usec = latency_usec;
+  if(latency_usec > s->max_latency_usec) s->max_latency_usec = latency_usec;
+}
+
+/* **************************************************** */
+
 bool ViewInterface::addSubinterface(NetworkInterface *what) {
   if(num_viewed_interfaces < MAX_NUM_VIEW_INTERFACES) {
     if(what->isViewed()) {
@@ -485,9 +549,6 @@ void ViewInterface::viewed_flows_walker(Flow *f, const struct timeval *tv) {
 	findFlowHosts(f->get_vlan_id(), f->get_observation_point_id(),
 		      NULL /* Mac Address */, (IpAddress*)cli_ip, &cli_host,
 		      NULL /* Mac Address */, (IpAddress*)srv_ip, &srv_host);
-
-          if(cli_host) cli_host->setViewInterfaceMac(f->getViewCliMac());
-          if(srv_host) srv_host->setViewInterfaceMac(f->getViewSrvMac());
       } else {
 	/* The unsafe pointers can be used here as ViewInterface::viewed_flows_walker is
 	 * called synchronously with the ViewInterface purgeIdle. This also saves some
@@ -496,21 +557,19 @@ void ViewInterface::viewed_flows_walker(Flow *f, const struct timeval *tv) {
 	srv_host = f->getViewSharedServer();
       }
 
-      f->hosts_periodic_stats_update(this, cli_host, srv_host, &partials, first_partial, tv);
-      
-      /* Setting up dhcp/ntp/dns/smtp server bits */
-      if(cli_host) {
-        if(cli_ip->isDhcpServer()) cli_host->setDhcpServer();
-        if(cli_ip->isNtpServer())  cli_host->setNtpServer();
-        if(cli_ip->isDnsServer())  cli_host->setDnsServer();
-        if(cli_ip->isSmtpServer()) cli_host->setSmtpServer(); 
-      }
-      
-      if(srv_host) {
-        if(srv_ip->isDhcpServer()) srv_host->setDhcpServer();
-        if(srv_ip->isNtpServer())  srv_host->setNtpServer();
-        if(srv_ip->isDnsServer())  srv_host->setDnsServer();
-        if(srv_ip->isSmtpServer()) srv_host->setSmtpServer(); 
+      /* Shared aggregates (interface, pools, VLANs, networks, ...) are only updated by this thread */
+      f->shared_periodic_stats_update(this, cli_host, srv_host, &partials, tv);
+
+      if(num_merge_threads == 0) {
+	viewed_host_update(f, cli_host, srv_host, true  /* as client */, &partials, first_partial, tv);
+	viewed_host_update(f, srv_host, cli_host, false /* as server */, &partials, first_partial, tv);
+      } else if(cli_host || srv_host) {
+	ViewMergeJob *job = new (std::nothrow) ViewMergeJob(f, cli_host, srv_host, &partials, first_partial, tv);
+
+	if(job)
+	  dispatchMergeJob(job);
+	else
+	  ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
       }
 
     #ifdef NTOPNG_PRO
@@ -535,42 +594,20 @@ void ViewInterface::viewed_flows_walker(Flow *f, const struct timeval *tv) {
 
       if(cli_host) {
 	if(first_partial) {
-	  cli_host->incNumFlows(f->get_last_seen(), true), cli_host->incUses();
 	  network_stats = cli_host->getNetworkStats(cli_host->get_local_network_id());
 	  if(network_stats) network_stats->incNumFlows(f->get_last_seen(), true);
 	  if(f->getViewInterfaceFlowStats()) f->getViewInterfaceFlowStats()->setClientHost(cli_host);
-    cli_host->setLastDeviceIp(f->getFlowDeviceIP());
 	}
       }
 
       if(srv_host) {
 	if(first_partial) {
-	  srv_host->incUses(), srv_host->incNumFlows(f->get_last_seen(), false);
 	  network_stats = srv_host->getNetworkStats(srv_host->get_local_network_id());
 	  if(network_stats) network_stats->incNumFlows(f->get_last_seen(), false);
 	  if(f->getViewInterfaceFlowStats()) f->getViewInterfaceFlowStats()->setServerHost(srv_host);
-    srv_host->setLastDeviceIp(f->getFlowDeviceIP());
 	}
       }
 
-      /* Score increments are performed here periodically for view interfaces */
-      for(int i = 0; i < MAX_NUM_SCORE_CATEGORIES; i++) {
-	ScoreCategory score_category = (ScoreCategory)i;
-	u_int16_t cli_score_val = partials.get_cli_score(score_category),
-	  srv_score_val = partials.get_srv_score(score_category);
-
-	if(cli_score_val && cli_host)
-	  cli_host->incScoreValue(cli_score_val, score_category, true /* as client */);
-
-	if(srv_score_val && srv_host)
-	  srv_host->incScoreValue(srv_score_val, score_category, false /* as server */);
-      }
-
-      if(partials.get_is_flow_alerted()) {
-	if(cli_host) cli_host->incNumAlertedFlows(true /* As client */),  cli_host->incTotalAlerts();
-	if(srv_host) srv_host->incNumAlertedFlows(false /* As server */), srv_host->incTotalAlerts();
-      }
-
       incStats(true /* ingressPacket */,
 	       tv->tv_sec, cli_ip && cli_ip->isIPv4() ? ETHERTYPE_IP : ETHERTYPE_IPV6,
 	       f->getStatsProtocol(), f->get_protocol_category(),
@@ -583,6 +620,178 @@ void ViewInterface::viewed_flows_walker(Flow *f, const struct timeval *tv) {
 
 /* **************************************************** */
 
+/*
+  Updates a host of a viewed flow. When merge threads are enabled, this
+  runs on the thread owning the host: the peer must only be read.
+*/
+void ViewInterface::viewed_host_update(Flow *f, Host *host, Host *peer, bool as_client,
+				       PartializableFlowTrafficStats *partials, bool first_partial,
+				       const struct timeval *tv) {
+  const IpAddress *ip = as_client ? f->get_cli_ip_addr() : f->get_srv_ip_addr();
+
+  if(!host)
+    return;
+
+  if(first_partial)
+    host->setViewInterfaceMac(as_client ? f->getViewCliMac() : f->getViewSrvMac());
+
+  f->host_periodic_stats_update(host, peer, as_client, partials, first_partial, tv);
+
+  /* Setting up dhcp/ntp/dns/smtp server bits */
+  if(ip->isDhcpServer()) host->setDhcpServer();
+  if(ip->isNtpServer())  host->setNtpServer();
+  if(ip->isDnsServer())  host->setDnsServer();
+  if(ip->isSmtpServer()) host->setSmtpServer();
+
+  if(first_partial) {
+    host->incNumFlows(f->get_last_seen(), as_client), host->incUses();
+    host->setLastDeviceIp(f->getFlowDeviceIP());
+  }
+
+  /* Score increments are performed here periodically for view interfaces */
+  for(int i = 0; i < MAX_NUM_SCORE_CATEGORIES; i++) {
+    ScoreCategory score_category = (ScoreCategory)i;
+    u_int16_t score_val = as_client ? partials->get_cli_score(score_category) : partials->get_srv_score(score_category);
+
+    if(score_val)
+      host->incScoreValue(score_val, score_category, as_client);
+  }
+
+  if(partials->get_is_flow_alerted())
+    host->incNumAlertedFlows(as_client), host->incTotalAlerts();
+}
+
+/* **************************************************** */
+
+/* Hands the hosts of the job to the threads owning them */
+void ViewInterface::dispatchMergeJob(ViewMergeJob *job) {
+  Host *hosts[2] = { job->cli_host, job->srv_host };
+
+  job->num_refs = (hosts[0] ? 1 : 0) + (hosts[1] ? 1 : 0);
+  job->flow->incUses(); /* Released by the last host update */
+
+  for(int i = 0; i < 2; i++) {
+    ViewMergeThread *t;
+    ViewMergeTask task;
+
+    if(!hosts[i])
+      continue;
+
+    t = &merge_threads[hosts[i]->key() % num_merge_threads];
+    task.job = job, task.as_client = (i == 0);
+
+    if(!t->queue->enqueue(task, true)) {
+      /* Queue full: once drained the enqueue cannot fail */
+      waitMergeThreads();
+      t->queue->enqueue(task, true);
+    }
+
+    t->num_enqueued++;
+  }
+}
+
+/* **************************************************** */
+
+/* Waits until the merge threads have updated all the dispatched hosts */
+void ViewInterface::waitMergeThreads() {
+  for(int i = 0; i < num_merge_threads; i++) {
+    while(merge_threads[i].num_done.load() != merge_threads[i].num_enqueued) {
+      struct timespec expire;
+
+      expire.tv_sec = time(NULL) + 1, expire.tv_nsec = 0;
+      merge_done.timedWait(&expire);
+    }
+  }
+}
+
+/* **************************************************** */
+
+void ViewInterface::mergeLoop(ViewMergeThread *t) {
+  while(true) {
+    while(t->queue->isNotEmpty()) {
+      ViewMergeTask task = t->queue->dequeue();
+      ViewMergeJob *job = task.job;
+
+      if(job == NULL)
+	return; /* Shutdown */
+
+      if(task.as_client)
+	viewed_host_update(job->flow, job->cli_host, job->srv_host, true  /* as client */,
+			   &job->partials, job->first_partial, &job->tv);
+      else
+	viewed_host_update(job->flow, job->srv_host, job->cli_host, false /* as server */,
+			   &job->partials, job->first_partial, &job->tv);
+
+      if(--job->num_refs == 0) {
+	job->flow->decUses();
+	delete job;
+      }
+
+      t->num_done++;
+    }
+
+    merge_done.signal();
+    t->queue->wait(); /* Signaled on enqueue */
+  }
+}
+
+/* **************************************************** */
+
+static void* mergeLoop(void* ptr) {
+  ViewMergeThread *t = (ViewMergeThread*)ptr;
+
+  t->iface->mergeLoop(t);
+
+  return NULL;
+}
+
+/* **************************************************** */
+
+void ViewInterface::startMergeThreads() {
+  u_int8_t n = ntop->getPrefs()->getNumViewMergeThreads();
+
+  for(u_int8_t i = 0; i < n; i++) {
+    ViewMergeThread *t = &merge_threads[i];
+    char name[32];
+
+    snprintf(name, sizeof(name), "view_merge_%u", i);
+    t->iface = this, t->num_enqueued = 0, t->num_done = 0;
+
+    if((t->queue = new (std::nothrow) SPSCQueue<ViewMergeTask>(VIEW_MERGE_QUEUE_LEN, name)) == NULL)
+      break;
+
+    if(pthread_create(&t->thread, NULL, ::mergeLoop, t) != 0) {
+      delete t->queue;
+      t->queue = NULL;
+      break;
+    }
+
+    num_merge_threads++;
+  }
+
+  if(n > 0)
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Started %u merge threads on view interface %s",
+				 num_merge_threads, get_name());
+}
+
+/* **************************************************** */
+
+void ViewInterface::stopMergeThreads() {
+  for(int i = 0; i < num_merge_threads; i++) {
+    ViewMergeTask task;
+
+    task.job = NULL, task.as_client = false;
+
+    /* The thread processes what is still queued before the termination task */
+    while(!merge_threads[i].queue->enqueue(task, true))
+      _usleep(1000);
+
+    pthread_join(merge_threads[i].thread, NULL);
+  }
+}
+
+/* **************************************************** */
+
 bool ViewInterface::isSampledTraffic() const {
   for(u_int8_t s = 0; s < num_viewed_interfaces; s++)
     if(viewed_interfaces[s]->isSampledTraffic()) return true;
@@ -606,7 +815,37 @@ u_int32_t ViewInterface::periodicStatsUpdateFrequency() const {
 
 /* **************************************************** */
 
+/*
+  Sleeps until a viewed interface enqueues a flow. The wait is bounded
+  as purgeIdle() must run periodically also when no flow is received.
+*/
+void ViewInterface::waitForFlows() {
+  struct timespec expire;
+
+  poller_waiting.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  /* A flow enqueued before poller_waiting was visible has not signaled */
+  for(int i = 0; i < num_viewed_interfaces; i++) {
+    if(viewed_interfaces_queues[i]->isNotEmpty()) {
+      poller_waiting.store(false);
+      return;
+    }
+  }
+
+  expire.tv_sec = time(NULL) + 1, expire.tv_nsec = 0;
+  flows_available.timedWait(&expire);
+
+  poller_waiting.store(false);
+}
+
+/* **************************************************** */
+
 void ViewInterface::flowPollLoop() {
+  ticks_per_usec = max_val(Utils::gettickspersec() / 1000000, 1);
+
+  startMergeThreads();
+
   while(!ntop->getGlobals()->isShutdownRequested()) {
     while(idle()) sleep(1);
 
@@ -615,8 +854,10 @@ void ViewInterface::flowPollLoop() {
     purgeIdle(time(NULL));
 
     if(num == 0)
-      _usleep(100);
+      waitForFlows();
   }
+
+  stopMergeThreads();
 }
 
 /* **************************************************** */
@@ -673,8 +914,28 @@ void ViewInterface::startPacketPolling() {
 /* **************************************************** */
 
 void ViewInterface::lua_queues_stats(lua_State* vm) {
-  for(int i = 0; i < num_viewed_interfaces; i++)
+  for(int i = 0; i < num_viewed_interfaces; i++) {
+    ViewMergeStats *s = &merge_stats[i];
+
     viewed_interfaces_queues[i]->lua(vm);
+
+    /* Add the merge stats to the table of the queue */
+    lua_getfield(vm, -1, viewed_interfaces_queues[i]->get_name());
+
+    if(lua_istable(vm, -1)) {
+      lua_push_uint64_table_entry(vm, "num_merged_flows", s->num_merged_flows);
+      lua_push_uint64_table_entry(vm, "last_merge_latency_usec", s->last_latency_usec);
+      lua_push_uint64_table_entry(vm, "max_merge_latency_usec", s->max_latency_usec);
+      lua_push_uint64_table_entry(vm, "avg_merge_latency_usec",
+				  s->num_batches ? (s->tot_latency_usec / s->num_batches) : 0);
+      lua_push_uint64_table_entry(vm, "num_merge_threads", num_merge_threads);
+    }
+
+    lua_pop(vm, 1);
+  }
+
+  for(int i = 0; i < num_merge_threads; i++)
+    merge_threads[i].queue->lua(vm);
 }
 
 /* **************************************************** */
@@ -362,6 +362,44 @@ char* nDPIStats::serialize(NetworkInterface *iface) {
 
 /* *************************************** */
 
+void nDPIStats::getSnapshot(HostSnapshot *s) const {
+  for(int i = 0; i < MAX_NDPI_PROTOS; i++) {
+    if(counters[i] != NULL) {
+      struct host_snapshot_proto p;
+
+      p.proto_id = i, p.duration = counters[i]->duration, p.total_flows = counters[i]->total_flows;
+      p.pkts[0]  = counters[i]->packets.sent, p.pkts[1] = counters[i]->packets.rcvd;
+      p.bytes[0] = counters[i]->bytes.sent, p.bytes[1] = counters[i]->bytes.rcvd;
+
+      s->addProto(&p);
+    }
+  }
+}
+
+/* *************************************** */
+
+void nDPIStats::restoreSnapshot(const HostSnapshot *s) {
+  const std::vector<struct host_snapshot_proto> *protos = s->getProtos();
+
+  for(std::vector<struct host_snapshot_proto>::const_iterator it = protos->begin(); it != protos->end(); ++it) {
+    u_int16_t proto_id = it->proto_id;
+
+    if(proto_id >= MAX_NDPI_PROTOS)
+      continue;
+
+    if((counters[proto_id] == NULL)
+       && ((counters[proto_id] = (ProtoCounter*)calloc(1, sizeof(ProtoCounter))) == NULL))
+      return;
+
+    counters[proto_id]->packets.sent += it->pkts[0], counters[proto_id]->packets.rcvd += it->pkts[1];
+    counters[proto_id]->bytes.sent   += it->bytes[0], counters[proto_id]->bytes.rcvd += it->bytes[1];
+    counters[proto_id]->duration     += it->duration;
+    counters[proto_id]->total_flows  += it->total_flows;
+  }
+}
+
+/* *************************************** */
+
 void nDPIStats::deserialize(NetworkInterface *iface, json_object *o) {
   json_object *obj;
 
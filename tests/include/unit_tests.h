@@ -0,0 +1,43 @@
+/*
+ *
+ * (C) 2022 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _UNIT_TESTS_H_
+#define _UNIT_TESTS_H_
+
+#include "ntop_includes.h"
+
+#include <gtest/gtest.h>
+
+/*
+  Environment shared by the unit tests (tests/src/main.cpp): ntop and its
+  preferences are set up once, with an in-memory redis and a temporary
+  working directory. The local hosts cache is disabled, so that the hosts
+  created by the tests don't wait for a restore from redis.
+*/
+
+/* Empty pcap file with the given datalink, to create interfaces reading nothing */
+const char* testPcapPath(const char *name, int datalink);
+
+/* Registers and initializes an interface created by a test, without polling threads */
+void initTestInterface(NetworkInterface *iface, int datalink);
+
+#endif /* _UNIT_TESTS_H_ */
@@ -0,0 +1,219 @@
+/*
+ *
+ * (C) 2022 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "../include/unit_tests.h"
+
+/*
+  dissectPacket decodes the common encapsulations with fastDecodePacket and
+  everything else with its generic decoder. Both must hand the same decoded
+  packet to processPacket: every packet is dissected with and without the
+  fast path and the processPacket arguments are compared.
+*/
+
+typedef struct {
+  bool ingress;
+  u_int8_t eth[sizeof(struct ndpi_ethhdr)];
+  VLANid vlan_id;
+  int iph_offset, ip6_offset; /* -1 = NULL */
+  u_int16_t ip_offset, encapsulation_overhead;
+  u_int32_t len_on_wire;
+} DecodedPacket;
+
+/* Records the arguments of processPacket instead of processing the packet */
+class DecodeRecorder : public PcapInterface {
+ public:
+  std::vector<DecodedPacket> decoded;
+
+  DecodeRecorder(const char *name) : PcapInterface(name, 0) { };
+
+  bool processPacket(u_int32_t bridge_iface_idx, bool ingressPacket,
+		     const struct bpf_timeval *when, const u_int64_t time,
+		     struct ndpi_ethhdr *eth, VLANid vlan_id,
+		     struct ndpi_iphdr *iph, struct ndpi_ipv6hdr *ip6,
+		     u_int16_t ip_offset, u_int16_t encapsulation_overhead,
+		     u_int32_t len_on_wire, const struct pcap_pkthdr *h,
+		     const u_char *packet, u_int16_t *ndpiProtocol,
+		     Host **srcHost, Host **dstHost, Flow **flow) {
+    DecodedPacket d;
+
+    memset(&d, 0, sizeof(d));
+    d.ingress = ingressPacket;
+    if(eth) memcpy(d.eth, eth, sizeof(d.eth));
+    d.vlan_id = vlan_id;
+    d.iph_offset = iph ? (int)((const u_char*)iph - packet) : -1;
+    d.ip6_offset = ip6 ? (int)((const u_char*)ip6 - packet) : -1;
+    d.ip_offset = ip_offset, d.encapsulation_overhead = encapsulation_overhead;
+    d.len_on_wire = len_on_wire;
+
+    decoded.push_back(d);
+
+    return(true);
+  }
+};
+
+/* ******************************************* */
+
+static void put16(std::vector<u_char> *p, u_int16_t v) { p->push_back(v >> 8), p->push_back(v & 0xFF); }
+
+static void putEthernet(std::vector<u_char> *p, u_int16_t vlan_id, u_int16_t eth_type) {
+  const u_char dst[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 }, src[6] = { 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb };
+
+  p->insert(p->end(), dst, dst + 6), p->insert(p->end(), src, src + 6);
+  if(vlan_id) put16(p, 0x8100), put16(p, vlan_id);
+  put16(p, eth_type);
+}
+
+static void putIPv4(std::vector<u_char> *p, u_int8_t l4_proto, u_int16_t l4_len, bool options, u_int16_t frag_off) {
+  u_int8_t hlen = options ? 24 : 20;
+
+  p->push_back(0x40 | (hlen / 4)), p->push_back(0);
+  put16(p, hlen + l4_len), put16(p, 0x1234 /* id */), put16(p, frag_off);
+  p->push_back(64 /* TTL */), p->push_back(l4_proto), put16(p, 0 /* checksum */);
+  put16(p, 0x0a00), put16(p, 0x0001); /* 10.0.0.1 */
+  put16(p, 0x0a00), put16(p, 0x0002); /* 10.0.0.2 */
+  if(options) put16(p, 0x0101), put16(p, 0x0101); /* NOPs */
+}
+
+static void putIPv6(std::vector<u_char> *p, u_int8_t l4_proto, u_int16_t l4_len) {
+  put16(p, 0x6000), put16(p, 0);
+  put16(p, l4_len), p->push_back(l4_proto), p->push_back(64 /* Hop limit */);
+  put16(p, 0xfd00), p->insert(p->end(), 13, 0), p->push_back(1); /* fd00::1 */
+  put16(p, 0xfd00), p->insert(p->end(), 13, 0), p->push_back(2); /* fd00::2 */
+}
+
+static void putTCP(std::vector<u_char> *p) {
+  put16(p, 40000), put16(p, 80);
+  put16(p, 0), put16(p, 1) /* seq */, put16(p, 0), put16(p, 0) /* ack */;
+  p->push_back(0x50), p->push_back(0x02 /* SYN */), put16(p, 65535), put16(p, 0), put16(p, 0);
+}
+
+static void putUDP(std::vector<u_char> *p, u_int16_t dport) {
+  put16(p, 40000), put16(p, dport), put16(p, 8 + 4), put16(p, 0);
+  put16(p, 0xdead), put16(p, 0xbeef);
+}
+
+#define TCP_LEN 20
+#define UDP_LEN 12
+
+/* ******************************************* */
+
+static std::vector<std::vector<u_char> > ethernetPackets() {
+  std::vector<std::vector<u_char> > pkts;
+  std::vector<u_char> p;
+
+  putEthernet(&p, 0, ETHERTYPE_IP), putIPv4(&p, IPPROTO_TCP, TCP_LEN, false, 0), putTCP(&p);
+  pkts.push_back(p), p.clear();
+
+  putEthernet(&p, 0, ETHERTYPE_IP), putIPv4(&p, IPPROTO_UDP, UDP_LEN, false, 0), putUDP(&p, 53);
+  pkts.push_back(p), p.clear();
+
+  putEthernet(&p, 10, ETHERTYPE_IP), putIPv4(&p, IPPROTO_TCP, TCP_LEN, false, 0), putTCP(&p);
+  pkts.push_back(p), p.clear();
+
+  /* IP options */
+  putEthernet(&p, 0, ETHERTYPE_IP), putIPv4(&p, IPPROTO_TCP, TCP_LEN, true, 0), putTCP(&p);
+  pkts.push_back(p), p.clear();
+
+  /* Non-first fragment: no tunnel decoding */
+  putEthernet(&p, 0, ETHERTYPE_IP), putIPv4(&p, IPPROTO_UDP, UDP_LEN, false, 0x0010), putUDP(&p, 4789 /* VXLAN */);
+  pkts.push_back(p), p.clear();
+
+  putEthernet(&p, 0, ETHERTYPE_IPV6), putIPv6(&p, IPPROTO_TCP, TCP_LEN), putTCP(&p);
+  pkts.push_back(p), p.clear();
+
+  putEthernet(&p, 20, ETHERTYPE_IPV6), putIPv6(&p, IPPROTO_UDP, UDP_LEN), putUDP(&p, 53);
+  pkts.push_back(p), p.clear();
+
+  return(pkts);
+}
+
+static std::vector<std::vector<u_char> > rawPackets() {
+  std::vector<std::vector<u_char> > pkts;
+  std::vector<u_char> p;
+
+  putIPv4(&p, IPPROTO_TCP, TCP_LEN, false, 0), putTCP(&p);
+  pkts.push_back(p), p.clear();
+
+  putIPv6(&p, IPPROTO_UDP, UDP_LEN), putUDP(&p, 53);
+  pkts.push_back(p), p.clear();
+
+  return(pkts);
+}
+
+/* ******************************************* */
+
+static std::vector<DecodedPacket> dissect(DecodeRecorder *iface, bool fast_decode,
+					  const std::vector<std::vector<u_char> > &pkts) {
+  u_int16_t ndpiProtocol;
+  Host *srcHost, *dstHost;
+  Flow *flow;
+
+  iface->decoded.clear();
+  iface->setFastDecode(fast_decode);
+
+  for(u_int i = 0; i < pkts.size(); i++) {
+    struct pcap_pkthdr h;
+
+    h.ts.tv_sec = time(NULL), h.ts.tv_usec = i;
+    h.caplen = h.len = pkts[i].size();
+
+    iface->dissectPacket(DUMMY_BRIDGE_INTERFACE_ID, true /* ingress */, NULL, &h, pkts[i].data(),
+			 &ndpiProtocol, &srcHost, &dstHost, &flow);
+  }
+
+  return(iface->decoded);
+}
+
+static void expectSameDecoding(const char *name, int datalink, const std::vector<std::vector<u_char> > &pkts) {
+  DecodeRecorder *iface = new DecodeRecorder(testPcapPath(name, datalink));
+  std::vector<DecodedPacket> fast, generic;
+
+  initTestInterface(iface, datalink);
+
+  fast = dissect(iface, true, pkts), generic = dissect(iface, false, pkts);
+
+  ASSERT_EQ(fast.size(), pkts.size());
+  ASSERT_EQ(generic.size(), pkts.size());
+
+  for(u_int i = 0; i < pkts.size(); i++) {
+    SCOPED_TRACE(::testing::Message() << name << " packet " << i);
+
+    EXPECT_EQ(fast[i].ingress, generic[i].ingress);
+    EXPECT_EQ(memcmp(fast[i].eth, generic[i].eth, sizeof(fast[i].eth)), 0);
+    EXPECT_EQ(fast[i].vlan_id, generic[i].vlan_id);
+    EXPECT_EQ(fast[i].iph_offset, generic[i].iph_offset);
+    EXPECT_EQ(fast[i].ip6_offset, generic[i].ip6_offset);
+    EXPECT_EQ(fast[i].ip_offset, generic[i].ip_offset);
+    EXPECT_EQ(fast[i].encapsulation_overhead, generic[i].encapsulation_overhead);
+    EXPECT_EQ(fast[i].len_on_wire, generic[i].len_on_wire);
+  }
+}
+
+/* ******************************************* */
+
+TEST(DissectPacketTest, FastDecodeEthernet) {
+  expectSameDecoding("fast_decode_ethernet", DLT_EN10MB, ethernetPackets());
+}
+
+TEST(DissectPacketTest, FastDecodeRawIP) {
+  expectSameDecoding("fast_decode_raw", DLT_RAW, rawPackets());
+}
@@ -0,0 +1,109 @@
+/*
+ *
+ * (C) 2022 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "../include/unit_tests.h"
+
+/*
+  A local host coming back is restored from the record saved when it went
+  idle, binary (HostSnapshot) or JSON (older versions). The record must be
+  added to the traffic seen since the host was created, not replace it.
+*/
+class LocalHostRestoreTest : public ::testing::Test {
+ protected:
+  static NetworkInterface *iface;
+
+  static void SetUpTestCase() {
+    iface = new PcapInterface(testPcapPath("local_host_restore", DLT_EN10MB), 0);
+    initTestInterface(iface, DLT_EN10MB);
+  }
+
+  static LocalHost* newHost(u_int64_t pkts, u_int64_t bytes) {
+    LocalHost *h = new LocalHost(iface, (char*)"192.168.1.10", 0, 0);
+    custom_app_t custom_app;
+
+    memset(&custom_app, 0, sizeof(custom_app));
+    h->incStats(time(NULL), IPPROTO_TCP, NDPI_PROTOCOL_HTTP, NDPI_PROTOCOL_CATEGORY_WEB, custom_app,
+		pkts, bytes, bytes, 0, 0, 0, true /* unicast peer */);
+
+    return(h);
+  }
+
+  static host_restore* newRestore() {
+    host_restore *r = new host_restore;
+
+    r->id = 0 /* Inline */, r->snapshot = NULL, r->legacy = NULL;
+
+    return(r);
+  }
+};
+
+NetworkInterface *LocalHostRestoreTest::iface = NULL;
+
+/* ******************************************* */
+
+TEST_F(LocalHostRestoreTest, SnapshotIsAdded) {
+  LocalHost *saved = newHost(10, 1000), *restored = newHost(1, 100);
+  host_restore *r = newRestore();
+  HostSnapshot snapshot;
+  std::string record;
+
+  /* Save/load round trip as done through redis */
+  saved->getSnapshot(&snapshot);
+  snapshot.encode(&record);
+  r->snapshot = new HostSnapshot();
+  ASSERT_TRUE(r->snapshot->decode(record.data(), record.size()));
+
+  ASSERT_FALSE(restored->isRestorePending());
+  ASSERT_TRUE(restored->restore(r));
+
+  EXPECT_EQ(restored->getNumPktsSent(), 11u);
+  EXPECT_EQ(restored->getNumBytesSent(), 1100u);
+  EXPECT_EQ(restored->getNumBytes(), 1100u);
+
+  HostSerializer::freeRestore(r);
+  delete saved;
+  delete restored;
+}
+
+/* ******************************************* */
+
+TEST_F(LocalHostRestoreTest, LegacyRecordIsAdded) {
+  LocalHost *saved = newHost(10, 1000), *restored = newHost(1, 100);
+  host_restore *r = newRestore();
+  json_object *o = json_object_new_object();
+
+  /* JSON record as saved by the older versions */
+  saved->serialize(o, details_high);
+  r->legacy = json_tokener_parse(json_object_to_json_string(o));
+  json_object_put(o);
+  ASSERT_TRUE(r->legacy != NULL);
+
+  ASSERT_TRUE(restored->restore(r));
+
+  EXPECT_EQ(restored->getNumPktsSent(), 11u);
+  EXPECT_EQ(restored->getNumBytesSent(), 1100u);
+  EXPECT_EQ(restored->getNumBytes(), 1100u);
+
+  HostSerializer::freeRestore(r);
+  delete saved;
+  delete restored;
+}
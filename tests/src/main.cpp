@@ -0,0 +1,110 @@
+/*
+ *
+ * (C) 2022 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+/*
+  Unit tests: built with "make unit_test" and run with ./tests/unit_tests
+*/
+
+#include "../include/unit_tests.h"
+#include "../../tools/bench/bench_redis.h"
+
+AfterShutdownAction afterShutdownAction = after_shutdown_nop;
+
+static char working_dir[MAX_PATH];
+
+/* ******************************************* */
+
+const char* testPcapPath(const char *name, int datalink) {
+  static char path[MAX_PATH];
+  u_int32_t hdr[6] = { 0xa1b2c3d4, 0x00040002 /* 2.4 */, 0, 0, 65535, (u_int32_t)datalink };
+  FILE *fd;
+
+  snprintf(path, sizeof(path), "%s/%s.pcap", working_dir, name);
+
+  if((fd = fopen(path, "w")) == NULL)
+    return(NULL);
+
+  fwrite(hdr, sizeof(hdr), 1, fd);
+  fclose(fd);
+
+  return(path);
+}
+
+/* ******************************************* */
+
+void initTestInterface(NetworkInterface *iface, int datalink) {
+  ntop->registerInterface(iface);
+  iface->allocateStructures();
+  iface->set_datalink(datalink);
+  ntop->initInterface(iface);
+
+  /* Mark the interface running without spawning the pcap polling thread */
+  iface->NetworkInterface::startPacketPolling();
+}
+
+/* ******************************************* */
+
+int main(int argc, char *argv[]) {
+  const char *tmp = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp", *redis_path;
+  std::vector<char*> ntop_argv;
+  BenchRedis redis;
+  Prefs *prefs;
+  int rc;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  snprintf(working_dir, sizeof(working_dir), "%s/ntopng-unit-tests.XXXXXX", tmp);
+
+  if((mkdtemp(working_dir) == NULL) || ((redis_path = redis.start(working_dir)) == NULL)) {
+    fprintf(stderr, "Unable to set up the test environment in %s\n", tmp);
+    _exit(EXIT_FAILURE);
+  }
+
+  ntop_argv.push_back(argv[0]);
+  ntop_argv.push_back((char*)"-r"), ntop_argv.push_back((char*)redis_path);
+  ntop_argv.push_back((char*)"-d"), ntop_argv.push_back(working_dir);
+  ntop_argv.push_back(NULL);
+
+  if((ntop = new(std::nothrow)  Ntop(argv[0])) == NULL) _exit(EXIT_FAILURE);
+  if((prefs = new(std::nothrow) Prefs(ntop)) == NULL)   _exit(EXIT_FAILURE);
+
+  optind = 1; /* Prefs parses its own options with getopt_long */
+  if(prefs->loadFromCLI(ntop_argv.size() - 1, &ntop_argv[0]) < 0)
+    _exit(EXIT_FAILURE);
+
+  Utils::mkdir_tree(ntop->get_working_dir());
+  ntop->registerPrefs(prefs, false);
+  prefs->validate();
+
+  ntop->getRedis()->set(CONST_RUNTIME_IDLE_LOCAL_HOSTS_CACHE_ENABLED, "0");
+  prefs->reloadPrefsFromRedis();
+
+  rc = RUN_ALL_TESTS();
+
+  ntop->getGlobals()->requestShutdown();
+  ntop->shutdownInterfaces();
+  redis.stop();
+
+  /* _exit() below does not flush stdio */
+  fflush(stdout), fflush(stderr);
+  _exit(rc);
+}
@@ -10,10 +10,12 @@ enum {
   NTOP_SNMP_TIMETICKS_TYPE = 0x43,
   NTOP_SNMP_NOSUCHOBJECT = 0x80, /*   SMIv2 IMPLICIT NULL TYPE */
   NTOP_SNMP_NOSUCHINSTANCE = 0x81, /* SMIv2 IMPLICIT NULL TYPE */
+  NTOP_SNMP_ENDOFMIBVIEW = 0x82, /*   SMIv2 IMPLICIT NULL TYPE */
   NTOP_SNMP_GET_REQUEST_TYPE = 0xA0,
   NTOP_SNMP_GETNEXT_REQUEST_TYPE = 0xA1,
   NTOP_SNMP_GET_RESPONSE_TYPE = 0xA2,
-  NTOP_SNMP_SET_REQUEST_TYPE = 0xA3
+  NTOP_SNMP_SET_REQUEST_TYPE = 0xA3,
+  NTOP_SNMP_GETBULK_REQUEST_TYPE = 0xA5 /* SMIv2 only: error/error_index are non-repeaters/max-repetitions */
 };
 
 typedef struct SNMPMessage SNMPMessage;
@@ -36,8 +38,12 @@ SNMPMessage *snmp_parse_message(void *buffer, int len);
 void snmp_print_message(SNMPMessage *message, FILE *stream);
 
 int snmp_get_pdu_type(SNMPMessage *message);
+int snmp_get_request_id(SNMPMessage *message);
+int snmp_get_error(SNMPMessage *message);
+int snmp_get_error_index(SNMPMessage *message);
 
 int snmp_get_varbind_integer(SNMPMessage *message, int num, char **oid, int *type, int *int_value);
+int snmp_get_varbind_integer64(SNMPMessage *message, int num, char **oid, int *type, int64_t *int_value);
 int snmp_get_varbind_string(SNMPMessage *message, int num, char **oid, int *type, char **str_value);
 int snmp_get_varbind_as_string(SNMPMessage *message, int num, char **oid, int *type, char **value_str);
 
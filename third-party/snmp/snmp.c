@@ -238,6 +238,7 @@ SNMPMessage *snmp_parse_message(void *buffer, int len)
         {
 	case NTOP_SNMP_NOSUCHINSTANCE:
 	case NTOP_SNMP_NOSUCHOBJECT:
+	case NTOP_SNMP_ENDOFMIBVIEW:
 	case NTOP_ASN1_NULL_TYPE:
 	  asn1_parse_primitive_value(parser, NULL, &value);
 	  snmp_add_varbind_null(message, oid);
@@ -320,6 +321,21 @@ int snmp_get_pdu_type(SNMPMessage *message)
   return message->pdu_type;
 }
 
+int snmp_get_request_id(SNMPMessage *message)
+{
+  return message->request_id;
+}
+
+int snmp_get_error(SNMPMessage *message)
+{
+  return message->error;
+}
+
+int snmp_get_error_index(SNMPMessage *message)
+{
+  return message->error_index;
+}
+
 static VarbindList *get_varbind(SNMPMessage *message, int num)
 {
   int i = 0;
@@ -377,6 +393,23 @@ int snmp_get_varbind_integer(SNMPMessage *message, int num, char **oid, int *typ
   return 1;
 }
 
+int snmp_get_varbind_integer64(SNMPMessage *message, int num, char **oid, int *type, int64_t *int_value)
+{
+  int render_as_type;
+  Value value;
+
+  if (!get_varbind_value(message, num, oid, type, &render_as_type, &value))
+    return 0;
+
+  if (render_as_type != NTOP_ASN1_INTEGER_TYPE)
+    return 0;
+
+  if (int_value)
+    *int_value = value.int_value;
+
+  return 1;
+}
+
 int snmp_get_varbind_string(SNMPMessage *message, int num, char **oid, int *type, char **str_value)
 {
   int render_as_type;
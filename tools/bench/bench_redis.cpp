@@ -0,0 +1,580 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "bench_redis.h"
+
+#include <poll.h>
+#include <sys/un.h>
+#include <fnmatch.h>
+
+/* ******************************************* */
+
+static void* benchRedisLoop(void *ptr) {
+  Utils::setThreadName("bench-redis");
+  ((BenchRedis*)ptr)->loop();
+  return(NULL);
+}
+
+/* ******************************************* */
+
+BenchRedis::BenchRedis() {
+  path[0] = '\0', listen_fd = -1, running = false;
+}
+
+/* ******************************************* */
+
+BenchRedis::~BenchRedis() {
+  stop();
+}
+
+/* ******************************************* */
+
+const char* BenchRedis::start(const char *dir) {
+  struct sockaddr_un addr;
+
+  snprintf(path, sizeof(path), "%s/bench-redis-%u.sock", dir, (u_int)getpid());
+  unlink(path);
+
+  if((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    return(NULL);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+  if((bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+     || (listen(listen_fd, 16) != 0)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to listen on %s: %s", path, strerror(errno));
+    close(listen_fd), listen_fd = -1;
+    return(NULL);
+  }
+
+  running = true;
+
+  if(pthread_create(&thread, NULL, benchRedisLoop, (void*)this) != 0) {
+    running = false;
+    close(listen_fd), listen_fd = -1;
+    unlink(path);
+    return(NULL);
+  }
+
+  return(path);
+}
+
+/* ******************************************* */
+
+void BenchRedis::stop() {
+  if(!running)
+    return;
+
+  running = false;
+  pthread_join(thread, NULL);
+
+  for(std::vector<BenchRedisClient>::iterator it = clients.begin(); it != clients.end(); ++it)
+    close(it->fd);
+
+  clients.clear();
+  close(listen_fd), listen_fd = -1;
+  unlink(path);
+}
+
+/* ******************************************* */
+
+void BenchRedis::loop() {
+  while(running) {
+    std::vector<struct pollfd> fds(clients.size() + 1);
+
+    fds[0].fd = listen_fd, fds[0].events = POLLIN, fds[0].revents = 0;
+
+    for(size_t i = 0; i < clients.size(); i++)
+      fds[i + 1].fd = clients[i].fd, fds[i + 1].events = POLLIN, fds[i + 1].revents = 0;
+
+    if(poll(&fds[0], fds.size(), 100 /* msec: check running */) <= 0)
+      continue;
+
+    /* Clients first: accepting changes the vector */
+    for(size_t i = fds.size() - 1; i > 0; i--) {
+      if(fds[i].revents == 0)
+	continue;
+
+      if(!serve(&clients[i - 1])) {
+	close(clients[i - 1].fd);
+	clients.erase(clients.begin() + (i - 1));
+      }
+    }
+
+    if(fds[0].revents & POLLIN) {
+      BenchRedisClient c;
+
+      if((c.fd = accept(listen_fd, NULL, NULL)) >= 0)
+	clients.push_back(c);
+    }
+  }
+}
+
+/* ******************************************* */
+
+/* Reads the available data and replies to the complete requests: false when the client is gone */
+bool BenchRedis::serve(BenchRedisClient *c) {
+  std::vector<std::string> argv;
+  char buf[16384];
+  ssize_t len;
+  int rc;
+
+  if((len = read(c->fd, buf, sizeof(buf))) <= 0)
+    return(false);
+
+  c->in.append(buf, len);
+
+  while((rc = parseRequest(c->in, &argv)) > 0) {
+    execute(argv, &c->out);
+    argv.clear();
+  }
+
+  if(rc < 0)
+    return(false);
+
+  while(!c->out.empty()) {
+    if((len = write(c->fd, c->out.data(), c->out.size())) <= 0)
+      return(false);
+
+    c->out.erase(0, len);
+  }
+
+  return(true);
+}
+
+/* ******************************************* */
+
+/* Requests are RESP arrays of bulk strings (as sent by hiredis): 1 = parsed, 0 = incomplete, -1 = error */
+int BenchRedis::parseRequest(std::string &in, std::vector<std::string> *argv) {
+  size_t pos, eol;
+  long n;
+
+  if(in.empty())
+    return(0);
+
+  if((in[0] != '*') || ((eol = in.find("\r\n")) == std::string::npos))
+    return((in[0] != '*') ? -1 : 0);
+
+  n = atol(in.c_str() + 1), pos = eol + 2;
+
+  for(long i = 0; i < n; i++) {
+    long arg_len;
+
+    if(pos >= in.size())
+      return(0);
+
+    if(in[pos] != '$')
+      return(-1);
+
+    if((eol = in.find("\r\n", pos)) == std::string::npos)
+      return(0);
+
+    arg_len = atol(in.c_str() + pos + 1), pos = eol + 2;
+
+    if((arg_len < 0) || (pos + arg_len + 2 > in.size()))
+      return((arg_len < 0) ? -1 : 0);
+
+    argv->push_back(in.substr(pos, arg_len));
+    pos += arg_len + 2;
+  }
+
+  in.erase(0, pos);
+  return(1);
+}
+
+/* ******************************************* */
+
+BenchRedis::BenchRedisValue* BenchRedis::lookup(const std::string &key, BenchRedisType type,
+						bool create, bool *wrong_type) {
+  std::map<std::string, BenchRedisValue>::iterator it = db.find(key);
+
+  *wrong_type = false;
+
+  if((it != db.end()) && it->second.expire && (it->second.expire <= time(NULL)))
+    db.erase(it), it = db.end();
+
+  if(it == db.end()) {
+    if(!create)
+      return(NULL);
+
+    it = db.insert(std::make_pair(key, BenchRedisValue())).first;
+    it->second.type = type, it->second.expire = 0;
+  } else if(it->second.type != type) {
+    *wrong_type = true;
+    return(NULL);
+  }
+
+  return(&it->second);
+}
+
+/* ******************************************* */
+
+void BenchRedis::replyStatus(std::string *out, const char *s) { out->append("+").append(s).append("\r\n"); }
+void BenchRedis::replyError(std::string *out, const char *s)  { out->append("-").append(s).append("\r\n"); }
+void BenchRedis::replyNil(std::string *out)                   { out->append("$-1\r\n"); }
+
+void BenchRedis::replyInt(std::string *out, long long v) {
+  char buf[32];
+
+  snprintf(buf, sizeof(buf), ":%lld\r\n", v);
+  out->append(buf);
+}
+
+void BenchRedis::replyBulk(std::string *out, const std::string &s) {
+  char buf[32];
+
+  snprintf(buf, sizeof(buf), "$%lu\r\n", (unsigned long)s.size());
+  out->append(buf).append(s).append("\r\n");
+}
+
+void BenchRedis::replyArrayHeader(std::string *out, size_t n) {
+  char buf[32];
+
+  snprintf(buf, sizeof(buf), "*%lu\r\n", (unsigned long)n);
+  out->append(buf);
+}
+
+/* ******************************************* */
+
+/* Redis semantic of negative indexes: -1 is the last element */
+static void normalizeRange(long long *start, long long *end, long long len) {
+  if(*start < 0) *start += len;
+  if(*end < 0)   *end += len;
+  if(*start < 0) *start = 0;
+  if(*end >= len) *end = len - 1;
+}
+
+/* ******************************************* */
+
+void BenchRedis::execute(std::vector<std::string> &argv, std::string *out) {
+  std::string cmd;
+  BenchRedisValue *v;
+  bool wrong_type;
+  size_t argc = argv.size();
+
+  if(argc == 0) {
+    replyError(out, "ERR empty command");
+    return;
+  }
+
+  for(size_t i = 0; i < argv[0].size(); i++)
+    cmd += toupper(argv[0][i]);
+
+#define BENCH_REDIS_ARGS(n) if(argc < (n)) { replyError(out, "ERR wrong number of arguments"); return; }
+#define BENCH_REDIS_LOOKUP(type, create) \
+  v = lookup(argv[1], type, create, &wrong_type); \
+  if(wrong_type) { replyError(out, "WRONGTYPE Operation against a key holding the wrong kind of value"); return; }
+
+  /* Connection and server */
+  if(cmd == "PING") {
+    replyStatus(out, "PONG");
+  } else if((cmd == "AUTH") || (cmd == "SELECT")) {
+    replyStatus(out, "OK");
+  } else if(cmd == "INFO") {
+    replyBulk(out, "# Server\r\nredis_version:7.0.0\r\nredis_mode:standalone\r\n");
+  } else if(cmd == "DBSIZE") {
+    time_t now = time(NULL);
+    long long n = 0;
+
+    for(std::map<std::string, BenchRedisValue>::iterator it = db.begin(); it != db.end(); ++it)
+      if(!it->second.expire || (it->second.expire > now)) n++;
+
+    replyInt(out, n);
+  } else if(cmd == "FLUSHDB") {
+    db.clear();
+    replyStatus(out, "OK");
+  }
+
+  /* Keys */
+  else if(cmd == "DEL") {
+    long long n = 0;
+
+    for(size_t i = 1; i < argc; i++)
+      n += db.erase(argv[i]);
+
+    replyInt(out, n);
+  } else if(cmd == "KEYS") {
+    std::vector<std::string> keys;
+    time_t now = time(NULL);
+
+    BENCH_REDIS_ARGS(2);
+
+    for(std::map<std::string, BenchRedisValue>::iterator it = db.begin(); it != db.end(); ++it)
+      if((!it->second.expire || (it->second.expire > now))
+	 && (fnmatch(argv[1].c_str(), it->first.c_str(), 0) == 0))
+	keys.push_back(it->first);
+
+    replyArrayHeader(out, keys.size());
+    for(size_t i = 0; i < keys.size(); i++) replyBulk(out, keys[i]);
+  } else if((cmd == "EXPIRE") || (cmd == "TTL")) {
+    std::map<std::string, BenchRedisValue>::iterator it;
+    time_t now = time(NULL);
+
+    BENCH_REDIS_ARGS((cmd == "EXPIRE") ? 3 : 2);
+
+    if(((it = db.find(argv[1])) != db.end()) && it->second.expire && (it->second.expire <= now))
+      db.erase(it), it = db.end();
+
+    if(cmd == "EXPIRE") {
+      if(it != db.end()) it->second.expire = now + atoll(argv[2].c_str());
+      replyInt(out, (it != db.end()) ? 1 : 0);
+    } else
+      replyInt(out, (it == db.end()) ? -2 : (it->second.expire ? (it->second.expire - now) : -1));
+  } else if(cmd == "DUMP") {
+    /* Opaque serialization not supported: as for a missing key */
+    replyNil(out);
+  }
+
+  /* Strings */
+  else if((cmd == "GET") || (cmd == "STRLEN")) {
+    BENCH_REDIS_ARGS(2);
+    BENCH_REDIS_LOOKUP(bench_redis_string, false);
+
+    if(cmd == "STRLEN")
+      replyInt(out, v ? v->str.size() : 0);
+    else if(v)
+      replyBulk(out, v->str);
+    else
+      replyNil(out);
+  } else if((cmd == "SET") || (cmd == "SETNX")) {
+    BENCH_REDIS_ARGS(3);
+
+    if((cmd == "SETNX")
+       && ((lookup(argv[1], bench_redis_string, false, &wrong_type) != NULL) || wrong_type)) {
+      replyInt(out, 0);
+      return;
+    }
+
+    /* Replaces a value of any type */
+    db.erase(argv[1]);
+    v = lookup(argv[1], bench_redis_string, true, &wrong_type);
+    v->str = argv[2];
+
+    if((argc >= 5) && (strcasecmp(argv[3].c_str(), "EX") == 0))
+      v->expire = time(NULL) + atoll(argv[4].c_str());
+
+    if(cmd == "SETNX")
+      replyInt(out, 1);
+    else
+      replyStatus(out, "OK");
+  } else if(cmd == "INCRBY") {
+    char buf[32];
+    long long n;
+
+    BENCH_REDIS_ARGS(3);
+    BENCH_REDIS_LOOKUP(bench_redis_string, true);
+
+    n = atoll(v->str.c_str()) + atoll(argv[2].c_str());
+    snprintf(buf, sizeof(buf), "%lld", n);
+    v->str = buf;
+    replyInt(out, n);
+  }
+
+  /* Hashes */
+  else if((cmd == "HGET") || (cmd == "HSTRLEN")) {
+    std::map<std::string, std::string>::iterator it;
+
+    BENCH_REDIS_ARGS(3);
+    BENCH_REDIS_LOOKUP(bench_redis_hash, false);
+
+    if(v && ((it = v->hash.find(argv[2])) != v->hash.end())) {
+      if(cmd == "HSTRLEN") replyInt(out, it->second.size()); else replyBulk(out, it->second);
+    } else {
+      if(cmd == "HSTRLEN") replyInt(out, 0); else replyNil(out);
+    }
+  } else if(cmd == "HSET") {
+    long long n = 0;
+
+    BENCH_REDIS_ARGS(4);
+    BENCH_REDIS_LOOKUP(bench_redis_hash, true);
+
+    for(size_t i = 2; i + 1 < argc; i += 2) {
+      n += (v->hash.find(argv[i]) == v->hash.end()) ? 1 : 0;
+      v->hash[argv[i]] = argv[i + 1];
+    }
+
+    replyInt(out, n);
+  } else if(cmd == "HDEL") {
+    long long n = 0;
+
+    BENCH_REDIS_ARGS(3);
+    BENCH_REDIS_LOOKUP(bench_redis_hash, false);
+
+    if(v) {
+      for(size_t i = 2; i < argc; i++) n += v->hash.erase(argv[i]);
+      if(v->hash.empty()) db.erase(argv[1]);
+    }
+
+    replyInt(out, n);
+  } else if((cmd == "HGETALL") || (cmd == "HKEYS")) {
+    bool all = (cmd == "HGETALL");
+
+    BENCH_REDIS_ARGS(2);
+    BENCH_REDIS_LOOKUP(bench_redis_hash, false);
+
+    replyArrayHeader(out, v ? (v->hash.size() * (all ? 2 : 1)) : 0);
+
+    if(v) {
+      for(std::map<std::string, std::string>::iterator it = v->hash.begin(); it != v->hash.end(); ++it) {
+	replyBulk(out, it->first);
+	if(all) replyBulk(out, it->second);
+      }
+    }
+  }
+
+  /* Lists */
+  else if((cmd == "LPUSH") || (cmd == "RPUSH")) {
+    BENCH_REDIS_ARGS(3);
+    BENCH_REDIS_LOOKUP(bench_redis_list, true);
+
+    for(size_t i = 2; i < argc; i++) {
+      if(cmd == "LPUSH") v->list.push_front(argv[i]); else v->list.push_back(argv[i]);
+    }
+
+    replyInt(out, v->list.size());
+  } else if((cmd == "LPOP") || (cmd == "RPOP")) {
+    BENCH_REDIS_ARGS(2);
+    BENCH_REDIS_LOOKUP(bench_redis_list, false);
+
+    if(v == NULL || v->list.empty()) {
+      replyNil(out);
+      return;
+    }
+
+    if(cmd == "LPOP")
+      replyBulk(out, v->list.front()), v->list.pop_front();
+    else
+      replyBulk(out, v->list.back()), v->list.pop_back();
+
+    if(v->list.empty()) db.erase(argv[1]);
+  } else if(cmd == "LLEN") {
+    BENCH_REDIS_ARGS(2);
+    BENCH_REDIS_LOOKUP(bench_redis_list, false);
+    replyInt(out, v ? v->list.size() : 0);
+  } else if((cmd == "LRANGE") || (cmd == "LTRIM")) {
+    long long start, end, len;
+
+    BENCH_REDIS_ARGS(4);
+    BENCH_REDIS_LOOKUP(bench_redis_list, false);
+
+    len = v ? v->list.size() : 0, start = atoll(argv[2].c_str()), end = atoll(argv[3].c_str());
+    normalizeRange(&start, &end, len);
+
+    if(cmd == "LRANGE") {
+      replyArrayHeader(out, (start <= end) ? (end - start + 1) : 0);
+      for(long long i = start; i <= end; i++) replyBulk(out, v->list[i]);
+    } else {
+      if(v) {
+	if(start > end)
+	  db.erase(argv[1]);
+	else {
+	  v->list.erase(v->list.begin() + end + 1, v->list.end());
+	  v->list.erase(v->list.begin(), v->list.begin() + start);
+	}
+      }
+
+      replyStatus(out, "OK");
+    }
+  } else if(cmd == "LINDEX") {
+    long long idx;
+
+    BENCH_REDIS_ARGS(3);
+    BENCH_REDIS_LOOKUP(bench_redis_list, false);
+
+    idx = atoll(argv[2].c_str());
+    if(v && (idx < 0)) idx += v->list.size();
+
+    if(v && (idx >= 0) && (idx < (long long)v->list.size()))
+      replyBulk(out, v->list[idx]);
+    else
+      replyNil(out);
+  } else if(cmd == "LSET") {
+    long long idx;
+
+    BENCH_REDIS_ARGS(4);
+    BENCH_REDIS_LOOKUP(bench_redis_list, false);
+
+    idx = atoll(argv[2].c_str());
+    if(v && (idx < 0)) idx += v->list.size();
+
+    if(v == NULL)
+      replyError(out, "ERR no such key");
+    else if((idx < 0) || (idx >= (long long)v->list.size()))
+      replyError(out, "ERR index out of range");
+    else
+      v->list[idx] = argv[3], replyStatus(out, "OK");
+  } else if(cmd == "LREM") {
+    long long n = 0;
+
+    BENCH_REDIS_ARGS(4);
+    BENCH_REDIS_LOOKUP(bench_redis_list, false);
+
+    /* Only the count 0 (remove all) used by Redis::lrem() */
+    if(v) {
+      for(std::deque<std::string>::iterator it = v->list.begin(); it != v->list.end(); ) {
+	if(*it == argv[3]) it = v->list.erase(it), n++; else ++it;
+      }
+
+      if(v->list.empty()) db.erase(argv[1]);
+    }
+
+    replyInt(out, n);
+  }
+
+  /* Sets */
+  else if((cmd == "SADD") || (cmd == "SREM")) {
+    long long n = 0;
+
+    BENCH_REDIS_ARGS(3);
+    BENCH_REDIS_LOOKUP(bench_redis_set, (cmd == "SADD"));
+
+    if(v) {
+      for(size_t i = 2; i < argc; i++)
+	n += (cmd == "SADD") ? (v->set.insert(argv[i]).second ? 1 : 0) : v->set.erase(argv[i]);
+
+      if(v->set.empty()) db.erase(argv[1]);
+    }
+
+    replyInt(out, n);
+  } else if(cmd == "SMEMBERS") {
+    BENCH_REDIS_ARGS(2);
+    BENCH_REDIS_LOOKUP(bench_redis_set, false);
+
+    replyArrayHeader(out, v ? v->set.size() : 0);
+
+    if(v) {
+      for(std::set<std::string>::iterator it = v->set.begin(); it != v->set.end(); ++it)
+	replyBulk(out, *it);
+    }
+  } else if(cmd == "SISMEMBER") {
+    BENCH_REDIS_ARGS(3);
+    BENCH_REDIS_LOOKUP(bench_redis_set, false);
+    replyInt(out, (v && (v->set.find(argv[2]) != v->set.end())) ? 1 : 0);
+  }
+
+  else
+    replyError(out, "ERR unknown command");
+
+#undef BENCH_REDIS_ARGS
+#undef BENCH_REDIS_LOOKUP
+}
@@ -0,0 +1,89 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _BENCH_REDIS_H_
+#define _BENCH_REDIS_H_
+
+#include "ntop_includes.h"
+
+#include <deque>
+#include <set>
+
+typedef enum {
+  bench_redis_string = 0,
+  bench_redis_hash,
+  bench_redis_list,
+  bench_redis_set
+} BenchRedisType;
+
+/*
+  In-memory stand-in for redis-server, so that the benchmarks run without
+  external services. It serves the commands issued by the Redis class on a
+  unix socket (Redis connects to unix sockets when the -r host is a socket
+  path), keeping everything in memory: strings, hashes, lists and sets, with
+  expiration. Clients are handled by a single thread, like redis-server.
+*/
+class BenchRedis {
+ private:
+  typedef struct {
+    BenchRedisType type;
+    std::string str;
+    std::map<std::string, std::string> hash;
+    std::deque<std::string> list;
+    std::set<std::string> set;
+    time_t expire; /* 0 = never */
+  } BenchRedisValue;
+
+  typedef struct {
+    int fd;
+    std::string in, out;
+  } BenchRedisClient;
+
+  char path[108];
+  int listen_fd;
+  pthread_t thread;
+  volatile bool running;
+  std::map<std::string, BenchRedisValue> db;
+  std::vector<BenchRedisClient> clients;
+
+  BenchRedisValue* lookup(const std::string &key, BenchRedisType type, bool create, bool *wrong_type);
+  int parseRequest(std::string &in, std::vector<std::string> *argv);
+  void execute(std::vector<std::string> &argv, std::string *out);
+  bool serve(BenchRedisClient *c);
+
+  static void replyStatus(std::string *out, const char *s);
+  static void replyError(std::string *out, const char *s);
+  static void replyInt(std::string *out, long long v);
+  static void replyBulk(std::string *out, const std::string &s);
+  static void replyNil(std::string *out);
+  static void replyArrayHeader(std::string *out, size_t n);
+
+ public:
+  BenchRedis();
+  ~BenchRedis();
+
+  /* Listens on a new socket in dir: returns its path (to be passed with -r), or NULL */
+  const char* start(const char *dir);
+  void stop();
+  void loop();
+};
+
+#endif /* _BENCH_REDIS_H_ */
@@ -0,0 +1,261 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+/*
+  Benchmark for the warm restart checkpoint (InterfaceCheckpoint).
+
+  A checkpoint with N synthetic hosts (10.0.0.0/8, each with its own MAC
+  and some nDPI protocols) is written for an empty interface and then
+  loaded back with NetworkInterface::loadCheckpoint(), as done at startup.
+  The report includes the time spent re-creating the hosts, which
+  dominates the load.
+
+  Usage: ntopng-checkpoint-bench [-n <hosts>] [-p <protocols>] [-r] [-o <out.json>] [-- <ntopng options>]
+
+  Hosts are local (-m 10.0.0.0/8) unless -r is given. The hosts hash is
+  sized for N hosts (-x). ntopng options are passed verbatim to Prefs, after
+  the ones above, and redis is served in memory as for ntopng-pcap-bench.
+*/
+
+#include "ntop_includes.h"
+#include "bench_redis.h"
+
+#include <sys/resource.h>
+
+AfterShutdownAction afterShutdownAction = after_shutdown_nop;
+
+/* ******************************************* */
+
+static void usage() {
+  printf("Usage: ntopng-checkpoint-bench [-n <hosts>] [-p <protocols>] [-r] [-o <out.json>] [-- <ntopng options>]\n"
+	 " -n <hosts>     | Number of hosts in the checkpoint (default: 1000000)\n"
+	 " -p <protocols> | nDPI protocols per host (default: 8)\n"
+	 " -r             | Remote hosts (default: local hosts)\n"
+	 " -o <out.json>  | Write the JSON report to a file instead of stdout\n");
+  exit(EXIT_FAILURE);
+}
+
+/* ******************************************* */
+
+/* Empty pcap, so that the interface reads nothing */
+static bool writeEmptyPcap(const char *path) {
+  u_int32_t hdr[6] = { 0xa1b2c3d4, 0x00040002 /* 2.4 */, 0, 0, 65535, DLT_EN10MB };
+  FILE *fd;
+  bool rc;
+
+  if((fd = fopen(path, "w")) == NULL)
+    return(false);
+
+  rc = (fwrite(hdr, sizeof(hdr), 1, fd) == 1);
+  rc &= (fclose(fd) == 0);
+
+  return(rc);
+}
+
+/* ******************************************* */
+
+static bool writeCheckpoint(NetworkInterface *iface, u_int32_t num_hosts, u_int32_t num_protos) {
+  InterfaceCheckpoint checkpoint(iface->get_id());
+  HostSnapshot s;
+  time_t now = time(NULL);
+
+  if(!checkpoint.create())
+    return(false);
+
+  for(u_int32_t i = 0; i < num_hosts; i++) {
+    struct host_snapshot_hdr *h;
+    u_int32_t ipv4 = htonl(0x0A000001 + i); /* 10.0.0.1 + i */
+
+    s.reset(), h = s.get();
+    h->first_seen = now - 3600, h->last_stats_reset = 0;
+    h->mac[0] = 0x02 /* Locally administered */, h->mac[2] = i >> 24;
+    h->mac[3] = (i >> 16) & 0xFF, h->mac[4] = (i >> 8) & 0xFF, h->mac[5] = i & 0xFF;
+    h->pkts[0] = 1000 + i % 1000, h->pkts[1] = 2000 + i % 1000;
+    h->bytes[0] = h->pkts[0] * 500, h->bytes[1] = h->pkts[1] * 700;
+    h->flows[0] = 10, h->flows[1] = 5, h->total_activity_time = 3600;
+
+    for(u_int32_t j = 0; j < num_protos; j++) {
+      struct host_snapshot_proto p;
+
+      memset(&p, 0, sizeof(p));
+      p.proto_id = (1 + j * 7) % NDPI_MAX_SUPPORTED_PROTOCOLS;
+      p.duration = 60, p.total_flows = 2;
+      p.pkts[0] = h->pkts[0] / num_protos, p.pkts[1] = h->pkts[1] / num_protos;
+      p.bytes[0] = h->bytes[0] / num_protos, p.bytes[1] = h->bytes[1] / num_protos;
+      s.addProto(&p);
+    }
+
+    if(!checkpoint.write(checkpoint_record_host, &ipv4, sizeof(ipv4), 0, 0, &s))
+      return(false);
+  }
+
+  return(checkpoint.commit());
+}
+
+/* ******************************************* */
+
+static u_int64_t getLoadStat(lua_State *vm, const char *key) {
+  u_int64_t v;
+
+  lua_getfield(vm, -1, key);
+  v = (u_int64_t)lua_tonumber(vm, -1);
+  lua_pop(vm, 1);
+
+  return(v);
+}
+
+/* ******************************************* */
+
+int main(int argc, char *argv[]) {
+  std::vector<char*> ntop_argv;
+  u_int32_t num_hosts = 1000000, num_protos = 8;
+  const char *out_path = NULL, *redis_path;
+  char max_hosts[16], pcap_path[MAX_PATH];
+  bool local_hosts = true;
+  BenchRedis redis;
+  PcapInterface *iface;
+  json_object *report;
+  struct rusage ru;
+  u_int64_t begin, save_nsec, hosts_usec;
+  lua_State *vm;
+  Prefs *prefs;
+  int c;
+
+  ntop_argv.push_back(argv[0]);
+
+  while((c = getopt(argc, argv, "n:p:ro:h")) != -1) {
+    switch(c) {
+    case 'n':
+      num_hosts = max_val(1, atoi(optarg));
+      break;
+    case 'p':
+      num_protos = max_val(0, atoi(optarg));
+      break;
+    case 'r':
+      local_hosts = false;
+      break;
+    case 'o':
+      out_path = optarg;
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if((redis_path = redis.start(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp")) == NULL) {
+    fprintf(stderr, "Unable to start the in-memory redis\n");
+    _exit(EXIT_FAILURE);
+  }
+
+  snprintf(max_hosts, sizeof(max_hosts), "%u", num_hosts + num_hosts / 10);
+  ntop_argv.push_back((char*)"-r"), ntop_argv.push_back((char*)redis_path);
+  ntop_argv.push_back((char*)"-x"), ntop_argv.push_back(max_hosts);
+  if(local_hosts) ntop_argv.push_back((char*)"-m"), ntop_argv.push_back((char*)"10.0.0.0/8");
+
+  for(int i = optind; i < argc; i++) {
+    if(strcmp(argv[i], "--") != 0)
+      ntop_argv.push_back(argv[i]);
+  }
+
+  ntop_argv.push_back(NULL);
+
+  if((ntop = new(std::nothrow)  Ntop(argv[0])) == NULL) _exit(EXIT_FAILURE);
+  if((prefs = new(std::nothrow) Prefs(ntop)) == NULL)   _exit(EXIT_FAILURE);
+
+  optind = 1; /* Prefs parses its own options with getopt_long */
+  if(prefs->loadFromCLI(ntop_argv.size() - 1, &ntop_argv[0]) < 0)
+    _exit(EXIT_FAILURE);
+
+  Utils::mkdir_tree(ntop->get_working_dir());
+  ntop->registerPrefs(prefs, false);
+  prefs->validate();
+
+  snprintf(pcap_path, sizeof(pcap_path), "%s/checkpoint_bench.pcap", ntop->get_working_dir());
+
+  if((!writeEmptyPcap(pcap_path))
+     || ((iface = new (std::nothrow) PcapInterface(pcap_path, 0)) == NULL)
+     || !ntop->registerInterface(iface)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to create the interface");
+    _exit(EXIT_FAILURE);
+  }
+
+  iface->allocateStructures();
+  iface->set_datalink(DLT_EN10MB);
+  ntop->initInterface(iface);
+
+  begin = Utils::getTimeNsec();
+
+  if(!writeCheckpoint(iface, num_hosts, num_protos)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to write the checkpoint");
+    _exit(EXIT_FAILURE);
+  }
+
+  save_nsec = Utils::getTimeNsec() - begin;
+
+  if(((vm = luaL_newstate()) == NULL) || !iface->loadCheckpoint(vm)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to load the checkpoint");
+    _exit(EXIT_FAILURE);
+  }
+
+  getrusage(RUSAGE_SELF, &ru);
+  hosts_usec = getLoadStat(vm, "hosts_duration_us");
+
+  report = json_object_new_object();
+  json_object_object_add(report, "version", json_object_new_string(PACKAGE_VERSION));
+  json_object_object_add(report, "hosts", json_object_new_int64(num_hosts));
+  json_object_object_add(report, "protocols_per_host", json_object_new_int(num_protos));
+  json_object_object_add(report, "local_hosts", json_object_new_boolean(local_hosts));
+  json_object_object_add(report, "checkpoint_bytes", json_object_new_int64(getLoadStat(vm, "bytes")));
+  json_object_object_add(report, "save_ms", json_object_new_int64(save_nsec / 1000000));
+  json_object_object_add(report, "load_ms", json_object_new_int64(getLoadStat(vm, "duration_ms")));
+  json_object_object_add(report, "hosts_loaded", json_object_new_int64(getLoadStat(vm, "num_hosts")));
+  json_object_object_add(report, "hosts_skipped", json_object_new_int64(getLoadStat(vm, "num_skipped")));
+  json_object_object_add(report, "hosts_ms", json_object_new_int64(hosts_usec / 1000));
+  json_object_object_add(report, "usec_per_host", json_object_new_double((double)hosts_usec / num_hosts));
+  json_object_object_add(report, "peak_rss_kb", json_object_new_int64(ru.ru_maxrss));
+
+  if(out_path) {
+    FILE *fd = fopen(out_path, "w");
+
+    if(fd == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to write %s: %s", out_path, strerror(errno));
+      _exit(EXIT_FAILURE);
+    }
+
+    fprintf(fd, "%s\n", json_object_to_json_string(report));
+    fclose(fd);
+  } else {
+    /* _exit() below does not flush stdio */
+    printf("%s\n", json_object_to_json_string(report));
+    fflush(stdout);
+  }
+
+  json_object_put(report);
+  lua_close(vm);
+
+  /* Stop the checks threads; the remaining global state is reclaimed by the OS */
+  ntop->getGlobals()->requestShutdown();
+  ntop->shutdownInterfaces();
+  redis.stop();
+
+  _exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#
+# (C) 2022 - ntop.org
+#
+# Generates the reference pcaps used by ntopng-pcap-bench.
+# Output is deterministic (fixed seed and timestamps) so that the files
+# can be regenerated and compared byte by byte.
+#
+# Usage: gen_pcaps.py [<output dir>]
+#
+
+import os
+import random
+import struct
+import sys
+
+BASE_TS = 1640995200  # 2022-01-01 00:00:00 UTC
+
+
+def csum(data):
+    if len(data) % 2:
+        data += b'\0'
+    s = sum(struct.unpack('!%dH' % (len(data) // 2), data))
+    while s >> 16:
+        s = (s & 0xFFFF) + (s >> 16)
+    return ~s & 0xFFFF
+
+
+def eth(src_mac, dst_mac, payload):
+    return dst_mac + src_mac + struct.pack('!H', 0x0800) + payload
+
+
+def ipv4(src, dst, proto, payload):
+    hdr = struct.pack('!BBHHHBBH4s4s', 0x45, 0, 20 + len(payload), 0, 0x4000, 64, proto, 0,
+                      bytes(src), bytes(dst))
+    hdr = hdr[:10] + struct.pack('!H', csum(hdr)) + hdr[12:]
+    return hdr + payload
+
+
+def tcp(sport, dport, seq, ack, flags, payload=b''):
+    return struct.pack('!HHIIBBHHH', sport, dport, seq, ack, 5 << 4, flags, 65535, 0, 0) + payload
+
+
+def udp(sport, dport, payload):
+    return struct.pack('!HHHH', sport, dport, 8 + len(payload), 0) + payload
+
+
+def mac(n):
+    return bytes([0x02, 0x00, 0x00, (n >> 16) & 0xFF, (n >> 8) & 0xFF, n & 0xFF])
+
+
+class PcapWriter:
+    def __init__(self, path):
+        self.f = open(path, 'wb')
+        self.f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+
+    def write(self, ts_usec, frame):
+        self.f.write(struct.pack('<IIII', BASE_TS + ts_usec // 1000000, ts_usec % 1000000,
+                                 len(frame), len(frame)))
+        self.f.write(frame)
+
+    def close(self):
+        self.f.close()
+
+
+def client_ip(rnd):
+    return [192, 168, rnd.randint(0, 3), rnd.randint(1, 254)]
+
+
+def server_ip(rnd):
+    return [rnd.choice([8, 31, 93, 104, 142, 151]), rnd.randint(0, 255), rnd.randint(0, 255), rnd.randint(1, 254)]
+
+
+def tcp_session(w, rnd, ts, payload_req, payload_rsp, dport, rsp_segments):
+    c, s = client_ip(rnd), server_ip(rnd)
+    cm, sm = mac(c[2] << 8 | c[3]), mac(0xFFFFFF)
+    sport = rnd.randint(1024, 65000)
+    cseq, sseq = rnd.getrandbits(32), rnd.getrandbits(32)
+
+    def c2s(flags, data=b''):
+        return eth(cm, sm, ipv4(c, s, 6, tcp(sport, dport, cseq, sseq, flags, data)))
+
+    def s2c(flags, data=b''):
+        return eth(sm, cm, ipv4(s, c, 6, tcp(dport, sport, sseq, cseq, flags, data)))
+
+    w.write(ts, c2s(0x02)); cseq = (cseq + 1) & 0xFFFFFFFF; ts += 150
+    w.write(ts, s2c(0x12)); sseq = (sseq + 1) & 0xFFFFFFFF; ts += 150
+    w.write(ts, c2s(0x10)); ts += 50
+    w.write(ts, c2s(0x18, payload_req)); cseq = (cseq + len(payload_req)) & 0xFFFFFFFF; ts += 300
+
+    for _ in range(rsp_segments):
+        w.write(ts, s2c(0x10, payload_rsp)); sseq = (sseq + len(payload_rsp)) & 0xFFFFFFFF; ts += 20
+
+    w.write(ts, c2s(0x11)); cseq = (cseq + 1) & 0xFFFFFFFF; ts += 100
+    w.write(ts, s2c(0x11)); sseq = (sseq + 1) & 0xFFFFFFFF; ts += 100
+    w.write(ts, c2s(0x10))
+    return ts
+
+
+def dns_query(rnd, name):
+    qname = b''.join(bytes([len(p)]) + p.encode() for p in name.split('.')) + b'\0'
+    return struct.pack('!HHHHHH', rnd.getrandbits(16), 0x0100, 1, 0, 0, 0) + qname + struct.pack('!HH', 1, 1)
+
+
+def gen_http(path, rnd):
+    w = PcapWriter(path)
+    ts = 0
+    for i in range(200):
+        host = 'www.example%d.com' % (i % 50)
+        req = ('GET /index%d.html HTTP/1.1\r\nHost: %s\r\nUser-Agent: bench/1.0\r\nAccept: */*\r\n\r\n' % (i, host)).encode()
+        rsp = b'HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 1200\r\n\r\n' + b'x' * 1200
+        ts = tcp_session(w, rnd, ts, req, rsp, 80, 2) + 1000
+    w.close()
+
+
+def gen_dns(path, rnd):
+    w = PcapWriter(path)
+    ts = 0
+    for i in range(2000):
+        c, s = client_ip(rnd), [192, 168, 0, 1]
+        cm, sm = mac(c[2] << 8 | c[3]), mac(0xFFFFFE)
+        sport = rnd.randint(1024, 65000)
+        q = dns_query(rnd, 'host%d.example%d.org' % (i, i % 100))
+        rsp = bytearray(q)
+        rsp[2:4] = struct.pack('!H', 0x8180)
+        rsp[6:8] = struct.pack('!H', 1)
+        rsp += struct.pack('!HHHIH4s', 0xC00C, 1, 1, 300, 4, bytes(server_ip(rnd)))
+        w.write(ts, eth(cm, sm, ipv4(c, s, 17, udp(sport, 53, q)))); ts += 400
+        w.write(ts, eth(sm, cm, ipv4(s, c, 17, udp(53, sport, bytes(rsp))))); ts += 200
+    w.close()
+
+
+def gen_mixed(path, rnd):
+    # Many short-lived flows: stresses flow creation, hash lookups and purging
+    w = PcapWriter(path)
+    ts = 0
+    for i in range(10000):
+        c, s = client_ip(rnd), server_ip(rnd)
+        cm, sm = mac(c[2] << 8 | c[3]), mac(0xFFFFFF)
+        if rnd.random() < 0.6:
+            frame = eth(cm, sm, ipv4(c, s, 6, tcp(rnd.randint(1024, 65000), rnd.choice([443, 22, 25, 8080]),
+                                                  rnd.getrandbits(32), 0, 0x02)))
+        else:
+            frame = eth(cm, sm, ipv4(c, s, 17, udp(rnd.randint(1024, 65000), rnd.choice([123, 443, 5060]),
+                                                   bytes(rnd.getrandbits(8) for _ in range(rnd.randint(16, 200))))))
+        w.write(ts, frame)
+        ts += 50
+    w.close()
+
+
+def main():
+    out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(os.path.abspath(__file__)), 'pcaps')
+    os.makedirs(out, exist_ok=True)
+    gen_http(os.path.join(out, 'http_sessions.pcap'), random.Random(1))
+    gen_dns(os.path.join(out, 'dns_queries.pcap'), random.Random(2))
+    gen_mixed(os.path.join(out, 'short_flows_mix.pcap'), random.Random(3))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,476 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+  Offline replay benchmark for the packet pipeline.
+
+  Every pcap is loaded in memory and then fed to NetworkInterface::dissectPacket()
+  as fast as possible, so that the numbers reflect dissection, flow/host lookup,
+  nDPI and checks only (no disk I/O, no HTTP server, no capture thread).
+
+  Usage: ntopng-pcap-bench [-n <repeats>] [-w <threads>] [-o <out.json>] [-R] [-F] <file.pcap> [<file.pcap> ...] [-- <ntopng options>]
+
+  With -w, threads walking the flows and hosts hashes and pushing every entry
+  to Lua (as the REST/GUI listings do) run during the replay, together with a
+  thread deleting the idle entries (as Ntop::purgeLoopBody), so that the cost
+  of the concurrent readers on the packet thread is measured too.
+
+  ntopng options are passed verbatim to Prefs (e.g. -- -d /tmp/bench).
+  Ntop keeps its runtime state in redis: an in-memory stand-in (BenchRedis) is
+  started on a unix socket and passed with -r, so that no redis-server is needed.
+  With -R the redis given with -- -r <host:port> is used instead.
+
+  With -F dissectPacket only uses its generic decoder, to compare the
+  numbers with and without the fast path (NetworkInterface::fastDecodePacket).
+*/
+
+#include "ntop_includes.h"
+#include "bench_redis.h"
+
+#include <sys/resource.h>
+
+AfterShutdownAction afterShutdownAction = after_shutdown_nop;
+
+typedef struct {
+  struct pcap_pkthdr hdr;
+  u_char *data;
+} BenchPacket;
+
+typedef struct {
+  u_int64_t pkts, bytes, new_flows, ticks;
+  u_int64_t walks, walked_entries; /* Concurrent walkers */
+} BenchRun;
+
+typedef struct {
+  NetworkInterface *iface;
+  u_int num_threads;
+  std::vector<pthread_t> threads;
+  volatile bool stop;
+  std::atomic<u_int64_t> walks, walked_entries;
+} BenchWalkers;
+
+/* ******************************************* */
+
+static void usage() {
+  printf("Usage: ntopng-pcap-bench [-n <repeats>] [-w <threads>] [-o <out.json>] [-R] [-F] <file.pcap> [...] [-- <ntopng options>]\n"
+	 " -n <repeats>   | Number of times each pcap is replayed (default: 5)\n"
+	 " -w <threads>   | Flows/hosts walker threads running during the replay (default: 0)\n"
+	 " -o <out.json>  | Write the JSON report to a file instead of stdout\n"
+	 " -R             | Use the redis-server given with -- -r instead of the in-memory one\n"
+	 " -F             | Disable the fast decoding path of dissectPacket\n");
+  exit(EXIT_FAILURE);
+}
+
+/* ******************************************* */
+
+static int loadPcap(const char *path, std::vector<BenchPacket> *pkts, int *datalink) {
+  char errbuf[PCAP_ERRBUF_SIZE];
+  struct pcap_pkthdr *hdr;
+  const u_char *data;
+  pcap_t *p;
+  int rc;
+
+  if((p = pcap_open_offline(path, errbuf)) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to open %s: %s", path, errbuf);
+    return(-1);
+  }
+
+  *datalink = pcap_datalink(p);
+
+  while((rc = pcap_next_ex(p, &hdr, &data)) > 0) {
+    BenchPacket b;
+
+    if(hdr->caplen == 0) continue;
+
+    b.hdr = *hdr;
+    if((b.data = (u_char*)malloc(hdr->caplen)) == NULL) {
+      pcap_close(p);
+      return(-1);
+    }
+
+    memcpy(b.data, data, hdr->caplen);
+    pkts->push_back(b);
+  }
+
+  pcap_close(p);
+  return(pkts->empty() ? -1 : 0);
+}
+
+/* ******************************************* */
+
+typedef struct {
+  lua_State *vm;
+  WalkerType wtype;
+  u_int64_t num_entries;
+} BenchWalk;
+
+/* ******************************************* */
+
+static bool benchLuaWalker(GenericHashEntry *h, void *user_data, bool *matched) {
+  BenchWalk *walk = (BenchWalk*)user_data;
+
+  if(walk->wtype == walker_flows)
+    ((Flow*)h)->lua(walk->vm, NULL, details_normal, false);
+  else
+    ((Host*)h)->lua(walk->vm, NULL, false, false, false, false);
+
+  lua_settop(walk->vm, 0);
+  walk->num_entries++, *matched = true;
+
+  return(false); /* false = keep on walking */
+}
+
+/* ******************************************* */
+
+static void* benchWalkerFctn(void *ptr) {
+  BenchWalkers *w = (BenchWalkers*)ptr;
+  WalkerType wtypes[] = { walker_flows, walker_hosts };
+  BenchWalk walk;
+
+  Utils::setThreadName("bench-walker");
+
+  if((walk.vm = luaL_newstate()) == NULL)
+    return(NULL);
+
+  while(!w->stop) {
+    for(u_int i = 0; i < sizeof(wtypes) / sizeof(wtypes[0]); i++) {
+      u_int32_t begin_slot = 0;
+
+      walk.wtype = wtypes[i], walk.num_entries = 0;
+      w->iface->walker(&begin_slot, true /* walk all */, walk.wtype, benchLuaWalker, &walk);
+      w->walks++, w->walked_entries += walk.num_entries;
+    }
+  }
+
+  lua_close(walk.vm);
+  return(NULL);
+}
+
+/* ******************************************* */
+
+/* Ntop::purgeLoopBody is not running: delete the entries purged by the replay */
+static void* benchPurgeFctn(void *ptr) {
+  BenchWalkers *w = (BenchWalkers*)ptr;
+
+  Utils::setThreadName("bench-purge");
+
+  while(!w->stop) {
+    w->iface->purgeQueuedIdleEntries();
+    _usleep(10000);
+  }
+
+  return(NULL);
+}
+
+/* ******************************************* */
+
+static void startWalkers(BenchWalkers *w) {
+  pthread_t t;
+
+  w->stop = false;
+
+  if(w->num_threads == 0)
+    return;
+
+  for(u_int i = 0; i < w->num_threads; i++) {
+    if(pthread_create(&t, NULL, benchWalkerFctn, (void*)w) == 0)
+      w->threads.push_back(t);
+  }
+
+  if(pthread_create(&t, NULL, benchPurgeFctn, (void*)w) == 0)
+    w->threads.push_back(t);
+}
+
+/* ******************************************* */
+
+static void stopWalkers(BenchWalkers *w) {
+  w->stop = true;
+
+  for(std::vector<pthread_t>::iterator it = w->threads.begin(); it != w->threads.end(); ++it)
+    pthread_join(*it, NULL);
+
+  w->threads.clear();
+}
+
+/* ******************************************* */
+
+/* shift: seconds added to the packet timestamps, so that time never goes back across iterations */
+static void replay(NetworkInterface *iface, std::vector<BenchPacket> *pkts, time_t shift,
+		   BenchWalkers *walkers, BenchRun *run) {
+  u_int64_t pkts_begin = iface->getNumPackets(), bytes_begin = iface->getNumBytes();
+  u_int64_t flows_begin = iface->getNumNewFlows(), walks_begin, walked_begin;
+  ticks begin, end;
+
+  startWalkers(walkers);
+  walks_begin = walkers->walks, walked_begin = walkers->walked_entries;
+
+  begin = Utils::getticks();
+
+  for(std::vector<BenchPacket>::iterator it = pkts->begin(); it != pkts->end(); ++it) {
+    struct pcap_pkthdr hdr = it->hdr;
+    Host *srcHost = NULL, *dstHost = NULL;
+    Flow *flow = NULL;
+    u_int16_t p;
+
+    hdr.ts.tv_sec += shift;
+    hdr.caplen = min_val(hdr.caplen, iface->getMTU());
+    iface->dissectPacket(DUMMY_BRIDGE_INTERFACE_ID, true /* ingress */,
+			 NULL, &hdr, it->data, &p, &srcHost, &dstHost, &flow);
+  }
+
+  end = Utils::getticks();
+
+  run->walks = walkers->walks - walks_begin, run->walked_entries = walkers->walked_entries - walked_begin;
+  stopWalkers(walkers);
+
+  run->ticks     = end - begin;
+  run->pkts      = iface->getNumPackets() - pkts_begin;
+  run->bytes     = iface->getNumBytes() - bytes_begin;
+  run->new_flows = iface->getNumNewFlows() - flows_begin;
+}
+
+/* ******************************************* */
+
+/*
+  Expires all the entries, as purgeIdle would do once the packet time
+  reaches when. Detached entries are only deleted by the purge following
+  the one that detached them (idle_entries_shadow), hence the second run.
+*/
+static void purgeAll(NetworkInterface *iface, time_t when) {
+  for(int i = 0; i < 2; i++) {
+    iface->purgeIdle(when, true /* force idle */, true /* full scan */);
+    iface->purgeQueuedIdleEntries();
+  }
+}
+
+/* ******************************************* */
+
+static json_object* runToJSON(BenchRun *run, ticks tps) {
+  json_object *r = json_object_new_object();
+  double secs = (double)run->ticks / (double)tps;
+
+  if(secs <= 0) secs = 1e-9;
+
+  json_object_object_add(r, "packets", json_object_new_int64(run->pkts));
+  json_object_object_add(r, "bytes", json_object_new_int64(run->bytes));
+  json_object_object_add(r, "duration_sec", json_object_new_double(secs));
+  json_object_object_add(r, "pps", json_object_new_double(run->pkts / secs));
+  json_object_object_add(r, "gbps", json_object_new_double((run->bytes * 8) / secs / 1e9));
+  json_object_object_add(r, "cycles_per_pkt",
+			 json_object_new_double(run->pkts ? (double)run->ticks / run->pkts : 0));
+  json_object_object_add(r, "new_flows", json_object_new_int64(run->new_flows));
+  json_object_object_add(r, "flows_per_sec", json_object_new_double(run->new_flows / secs));
+  json_object_object_add(r, "walks", json_object_new_int64(run->walks));
+  json_object_object_add(r, "walked_entries_per_sec", json_object_new_double(run->walked_entries / secs));
+
+  return(r);
+}
+
+/* ******************************************* */
+
+static bool cmpRunTicks(const BenchRun &a, const BenchRun &b) {
+  return(a.ticks < b.ticks);
+}
+
+/* ******************************************* */
+
+int main(int argc, char *argv[]) {
+  std::vector<char*> pcaps, ntop_argv;
+  u_int repeats = 5;
+  BenchWalkers walkers;
+  const char *out_path = NULL, *redis_path;
+  bool in_memory_redis = true, fast_decode = true;
+  BenchRedis redis;
+  json_object *report, *results;
+  struct rusage ru;
+  Prefs *prefs;
+  ticks tps;
+  int c;
+
+  ntop_argv.push_back(argv[0]);
+  walkers.num_threads = 0, walkers.walks = 0, walkers.walked_entries = 0;
+
+  while((c = getopt(argc, argv, "n:o:w:RFh")) != -1) {
+    switch(c) {
+    case 'n':
+      repeats = max_val(1, atoi(optarg));
+      break;
+    case 'o':
+      out_path = optarg;
+      break;
+    case 'w':
+      walkers.num_threads = max_val(0, atoi(optarg));
+      break;
+    case 'R':
+      in_memory_redis = false;
+      break;
+    case 'F':
+      fast_decode = false;
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if(in_memory_redis) {
+    if((redis_path = redis.start(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp")) == NULL) {
+      fprintf(stderr, "Unable to start the in-memory redis\n");
+      _exit(EXIT_FAILURE);
+    }
+
+    ntop_argv.push_back((char*)"-r"), ntop_argv.push_back((char*)redis_path);
+  }
+
+  for(int i = optind; i < argc; i++) {
+    if(strcmp(argv[i], "--") == 0) {
+      for(i++; i < argc; i++) ntop_argv.push_back(argv[i]);
+      break;
+    }
+
+    pcaps.push_back(argv[i]);
+  }
+
+  if(pcaps.empty()) usage();
+  ntop_argv.push_back(NULL);
+
+  if((ntop = new(std::nothrow)  Ntop(argv[0])) == NULL) _exit(EXIT_FAILURE);
+  if((prefs = new(std::nothrow) Prefs(ntop)) == NULL)   _exit(EXIT_FAILURE);
+
+  optind = 1; /* Prefs parses its own options with getopt_long */
+  if(prefs->loadFromCLI(ntop_argv.size() - 1, &ntop_argv[0]) < 0)
+    _exit(EXIT_FAILURE);
+
+  Utils::mkdir_tree(ntop->get_working_dir());
+  ntop->registerPrefs(prefs, false);
+  prefs->validate();
+
+  tps = Utils::gettickspersec();
+  report = json_object_new_object(), results = json_object_new_array();
+
+  for(u_int i = 0; i < pcaps.size(); i++) {
+    std::vector<BenchPacket> pkts;
+    std::vector<BenchRun> runs;
+    json_object *res, *iterations;
+    PcapInterface *iface;
+    time_t first_ts, last_ts = 0, idle_timeout, span;
+    int datalink;
+
+    if(loadPcap(pcaps[i], &pkts, &datalink) < 0) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Skipping %s: no packets loaded", pcaps[i]);
+      continue;
+    }
+
+    first_ts = pkts.front().hdr.ts.tv_sec;
+    for(std::vector<BenchPacket>::iterator it = pkts.begin(); it != pkts.end(); ++it)
+      last_ts = max_val(last_ts, (time_t)it->hdr.ts.tv_sec);
+
+    idle_timeout = max_val(prefs->get_pkt_ifaces_flow_max_idle(),
+			   max_val(prefs->get_host_max_idle(true), prefs->get_host_max_idle(false)));
+    /* Every iteration starts one idle timeout after the end of the previous one */
+    span = last_ts - first_ts + idle_timeout + 1;
+
+    if((iface = new (std::nothrow) PcapInterface(pcaps[i], i)) == NULL
+       || !ntop->registerInterface(iface)) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to create interface for %s", pcaps[i]);
+      break;
+    }
+
+    iface->allocateStructures();
+    walkers.iface = iface;
+    iface->set_datalink(datalink);
+    iface->setFastDecode(fast_decode);
+    ntop->initInterface(iface);
+
+    /* Mark the interface running without spawning the pcap polling thread */
+    iface->NetworkInterface::startPacketPolling();
+
+    ntop->reloadFlowChecks(), ntop->reloadHostChecks();
+    ntop->runHousekeepingTasks();
+
+    /* Warm-up: fills the hashes and lets nDPI/checks allocate their state */
+    {
+      BenchRun warmup;
+
+      replay(iface, &pkts, 0, &walkers, &warmup);
+    }
+
+    iterations = json_object_new_array();
+
+    for(u_int r = 0; r < repeats; r++) {
+      BenchRun run;
+
+      /* Start every iteration from empty hashes */
+      purgeAll(iface, last_ts + r * span + idle_timeout);
+
+      replay(iface, &pkts, (r + 1) * span, &walkers, &run);
+      runs.push_back(run);
+      json_object_array_add(iterations, runToJSON(&run, tps));
+    }
+
+    std::sort(runs.begin(), runs.end(), cmpRunTicks);
+
+    res = json_object_new_object();
+    json_object_object_add(res, "pcap", json_object_new_string(pcaps[i]));
+    json_object_object_add(res, "pcap_packets", json_object_new_int64(pkts.size()));
+    json_object_object_add(res, "median", runToJSON(&runs[runs.size() / 2], tps));
+    json_object_object_add(res, "best", runToJSON(&runs[0], tps));
+    json_object_object_add(res, "iterations", iterations);
+    json_object_array_add(results, res);
+
+    for(std::vector<BenchPacket>::iterator it = pkts.begin(); it != pkts.end(); ++it)
+      free(it->data);
+  }
+
+  getrusage(RUSAGE_SELF, &ru);
+
+  json_object_object_add(report, "version", json_object_new_string(PACKAGE_VERSION));
+  json_object_object_add(report, "repeats", json_object_new_int(repeats));
+  json_object_object_add(report, "walker_threads", json_object_new_int(walkers.num_threads));
+  json_object_object_add(report, "fast_decode", json_object_new_boolean(fast_decode));
+  json_object_object_add(report, "ticks_per_sec", json_object_new_int64(tps));
+  json_object_object_add(report, "peak_rss_kb", json_object_new_int64(ru.ru_maxrss));
+  json_object_object_add(report, "results", results);
+
+  if(out_path) {
+    FILE *fd = fopen(out_path, "w");
+
+    if(fd == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to write %s: %s", out_path, strerror(errno));
+      _exit(EXIT_FAILURE);
+    }
+
+    fprintf(fd, "%s\n", json_object_to_json_string(report));
+    fclose(fd);
+  } else {
+    /* _exit() below does not flush stdio */
+    printf("%s\n", json_object_to_json_string(report));
+    fflush(stdout);
+  }
+
+  json_object_put(report);
+
+  /* Stop the checks threads; the remaining global state is reclaimed by the OS */
+  ntop->getGlobals()->requestShutdown();
+  ntop->shutdownInterfaces();
+  redis.stop();
+
+  _exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,665 @@
+/*
+ *
+ * (C) 2013-22 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+  Benchmark for the SNMP interface poller (SNMPPoller).
+
+  N simulated agents are started on 127.0.0.1 (consecutive UDP ports), each
+  exposing the IF-MIB columns walked by the poller for a number of interfaces,
+  and a SNMPPoller walks all of them every poll interval, as ntopng does with
+  the devices set by ntop.snmpPollerSetDevice(). With -e the simulated agents
+  are not started and external ones (e.g. snmpsim) are walked instead.
+
+  Usage: ntopng-snmp-bench [-n <agents>] [-i <interfaces>] [-p <base port>] [-e]
+                           [-c <community>] [-v <version>] [-t <interval>] [-r <max rps>]
+                           [-l <latency ms>] [-d <duration>] [-o <out.json>]
+
+  The in-flight counts (walks in progress, requests waiting for a response
+  and, for the simulated agents, requests not yet answered) are sampled every
+  SNMP_BENCH_SAMPLE_MSEC.
+*/
+
+#include "ntop_includes.h"
+
+#include <poll.h>
+#include <deque>
+#include <sys/resource.h>
+
+extern "C" {
+#include "../../third-party/snmp/_snmp.h"
+#include "../../third-party/snmp/_asn1.h"
+};
+
+AfterShutdownAction afterShutdownAction = after_shutdown_nop;
+
+#define SNMP_BENCH_SAMPLE_MSEC   10 
+#define SNMP_BENCH_HEARTBEAT     60 /* Devices are refreshed as the Lua scripts would */
+
+typedef struct {
+  std::string oid;
+  int type;
+  u_int32_t if_idx, rate;
+} BenchMIBEntry;
+
+typedef std::map<std::vector<u_int32_t>, BenchMIBEntry> BenchMIB;
+
+typedef struct {
+  struct timeval due;
+  int sock;
+  struct sockaddr_in to;
+  std::string pdu;
+} BenchPendingResponse;
+
+typedef struct {
+  u_int num_agents;
+  u_int16_t base_port;
+  u_int32_t latency_msec;
+  std::string community;
+  std::vector<int> socks;
+  BenchMIB mib;
+  pthread_t thread;
+  volatile bool stop;
+  std::atomic<u_int32_t> num_queued; /* Received and not yet answered */
+  std::atomic<u_int64_t> num_requests, num_responses;
+} BenchAgents;
+
+typedef struct {
+  u_int64_t num_samples;
+  u_int64_t polling_sum, polling_max;
+  u_int64_t inflight_sum, inflight_max;
+  u_int64_t queued_sum, queued_max;
+} BenchInflight;
+
+/* ******************************************* */
+
+static void usage() {
+  printf("Usage: ntopng-snmp-bench [-n <agents>] [-i <interfaces>] [-p <base port>] [-e] [-c <community>]\n"
+	 "                         [-v <version>] [-t <interval>] [-r <max rps>] [-l <latency ms>]\n"
+	 "                         [-d <duration>] [-o <out.json>]\n"
+	 " -n <agents>     | Number of agents, on consecutive ports (default: 100)\n"
+	 " -i <interfaces> | Interfaces of every simulated agent (default: 48)\n"
+	 " -p <base port>  | Port of the first agent on 127.0.0.1 (default: 16100)\n"
+	 " -e              | Walk external agents (e.g. snmpsim) instead of the simulated ones\n"
+	 " -c <community>  | Community (default: public)\n"
+	 " -v <version>    | 0 = v1 (GETNEXT), 1 = v2c (GETBULK) (default: 1)\n"
+	 " -t <interval>   | Poll interval of every agent in seconds (default: 1)\n"
+	 " -r <max rps>    | Max requests/sec per agent (default: %u)\n"
+	 " -l <latency ms> | Response delay of the simulated agents (default: 0)\n"
+	 " -d <duration>   | Measurement duration in seconds, after the first walks (default: 10)\n"
+	 " -o <out.json>   | Write the JSON report to a file instead of stdout\n",
+	 SNMP_POLLER_DEFAULT_MAX_RPS);
+  exit(EXIT_FAILURE);
+}
+
+/* ******************************************* */
+
+static void parseOID(const char *oid, std::vector<u_int32_t> *out) {
+  char *end;
+
+  out->clear();
+
+  while(*oid != '\0') {
+    out->push_back(strtoul(oid, &end, 10));
+
+    if((*end != '.') || (end == oid))
+      break;
+
+    oid = end + 1;
+  }
+}
+
+/* ******************************************* */
+
+/* The IF-MIB columns walked by SNMPPoller, for both v1 and v2c */
+static void buildMIB(BenchMIB *mib, u_int num_interfaces) {
+  struct {
+    const char *column;
+    int type;
+    u_int32_t rate; /* Counter increment per second and interface index */
+  } columns[] = {
+    { "1.3.6.1.2.1.2.2.1.8",     NTOP_ASN1_INTEGER_TYPE,   0    }, /* ifOperStatus     */
+    { "1.3.6.1.2.1.2.2.1.10",    NTOP_SNMP_COUNTER_TYPE,   1000 }, /* ifInOctets       */
+    { "1.3.6.1.2.1.2.2.1.11",    NTOP_SNMP_COUNTER_TYPE,   10   }, /* ifInUcastPkts    */
+    { "1.3.6.1.2.1.2.2.1.13",    NTOP_SNMP_COUNTER_TYPE,   1    }, /* ifInDiscards     */
+    { "1.3.6.1.2.1.2.2.1.14",    NTOP_SNMP_COUNTER_TYPE,   1    }, /* ifInErrors       */
+    { "1.3.6.1.2.1.2.2.1.16",    NTOP_SNMP_COUNTER_TYPE,   2000 }, /* ifOutOctets      */
+    { "1.3.6.1.2.1.2.2.1.17",    NTOP_SNMP_COUNTER_TYPE,   20   }, /* ifOutUcastPkts   */
+    { "1.3.6.1.2.1.2.2.1.19",    NTOP_SNMP_COUNTER_TYPE,   1    }, /* ifOutDiscards    */
+    { "1.3.6.1.2.1.2.2.1.20",    NTOP_SNMP_COUNTER_TYPE,   1    }, /* ifOutErrors      */
+    { "1.3.6.1.2.1.31.1.1.1.6",  NTOP_SNMP_COUNTER64_TYPE, 1000 }, /* ifHCInOctets     */
+    { "1.3.6.1.2.1.31.1.1.1.7",  NTOP_SNMP_COUNTER64_TYPE, 10   }, /* ifHCInUcastPkts  */
+    { "1.3.6.1.2.1.31.1.1.1.10", NTOP_SNMP_COUNTER64_TYPE, 2000 }, /* ifHCOutOctets    */
+    { "1.3.6.1.2.1.31.1.1.1.11", NTOP_SNMP_COUNTER64_TYPE, 20   }, /* ifHCOutUcastPkts */
+    { "1.3.6.1.2.1.31.1.1.1.15", NTOP_SNMP_GAUGE_TYPE,     0    }  /* ifHighSpeed, ends the walked columns */
+  };
+
+  for(u_int c = 0; c < sizeof(columns) / sizeof(columns[0]); c++) {
+    for(u_int32_t if_idx = 1; if_idx <= num_interfaces; if_idx++) {
+      std::vector<u_int32_t> key;
+      BenchMIBEntry e;
+      char oid[64];
+
+      snprintf(oid, sizeof(oid), "%s.%u", columns[c].column, if_idx);
+      parseOID(oid, &key);
+
+      e.oid = oid, e.type = columns[c].type, e.if_idx = if_idx, e.rate = columns[c].rate;
+      (*mib)[key] = e;
+    }
+  }
+}
+
+/* ******************************************* */
+
+static void addMIBVarbind(SNMPMessage *response, const BenchMIBEntry *e, time_t now) {
+  int64_t value;
+
+  if(e->type == NTOP_ASN1_INTEGER_TYPE)
+    value = 1; /* up */
+  else if(e->type == NTOP_SNMP_GAUGE_TYPE)
+    value = 1000;
+  else {
+    value = (int64_t)now * e->rate * e->if_idx;
+
+    if(e->type == NTOP_SNMP_COUNTER_TYPE)
+      value &= 0xFFFFFFFF;
+  }
+
+  snmp_add_varbind_integer_type(response, (char*)e->oid.c_str(), e->type, value);
+}
+
+/* ******************************************* */
+
+/*
+  Answers a GETNEXT or GETBULK request as an agent would. Returns the
+  length of the response, or 0 when the request must be dropped.
+*/
+static int buildResponse(BenchAgents *a, u_char *req, int req_len, u_char *buf, int buf_len) {
+  std::vector<std::vector<u_int32_t> > oids;
+  std::vector<std::string> names;
+  SNMPMessage *request, *response;
+  int pdu_type, version, non_repeaters, max_repetitions, len = 0;
+  time_t now = time(NULL);
+  bool end_of_mib = false;
+  char *oid, *community;
+  int type;
+
+  if((request = snmp_parse_message(req, req_len)) == NULL)
+    return(0);
+
+  pdu_type = snmp_get_pdu_type(request);
+
+  for(int i = 0; snmp_get_varbind_as_string(request, i, &oid, &type, NULL); i++) {
+    oids.push_back(std::vector<u_int32_t>()), names.push_back(oid);
+    parseOID(oid, &oids.back());
+  }
+
+  if(((pdu_type != NTOP_SNMP_GETNEXT_REQUEST_TYPE) && (pdu_type != NTOP_SNMP_GETBULK_REQUEST_TYPE))
+     || oids.empty()
+     || ((response = snmp_create_message()) == NULL)) {
+    snmp_destroy_message(request), free(request);
+    return(0);
+  }
+
+  /* The parser does not expose version and community: the requests come from SNMPPoller only */
+  version = (pdu_type == NTOP_SNMP_GETBULK_REQUEST_TYPE) ? 1 : 0;
+  community = (char*)a->community.c_str();
+
+  if(pdu_type == NTOP_SNMP_GETBULK_REQUEST_TYPE) {
+    non_repeaters = min_val(max_val(snmp_get_error(request), 0), (int)oids.size());
+    max_repetitions = max_val(snmp_get_error_index(request), 0);
+  } else
+    non_repeaters = 0, max_repetitions = 1;
+
+  snmp_set_version(response, version);
+  snmp_set_community(response, community);
+  snmp_set_pdu_type(response, NTOP_SNMP_GET_RESPONSE_TYPE);
+  snmp_set_request_id(response, snmp_get_request_id(request));
+
+  for(int r = 0; (r < max_repetitions) && !end_of_mib; r++) {
+    for(u_int i = (r == 0) ? 0 : non_repeaters; i < oids.size(); i++) {
+      BenchMIB::iterator next = a->mib.upper_bound(oids[i]);
+
+      if(next == a->mib.end()) {
+	if(version == 0) {
+	  /* v1: noSuchName, the request varbinds are echoed back */
+	  snmp_destroy_message(response), free(response);
+	  response = snmp_create_message();
+	  snmp_set_version(response, version);
+	  snmp_set_community(response, community);
+	  snmp_set_pdu_type(response, NTOP_SNMP_GET_RESPONSE_TYPE);
+	  snmp_set_request_id(response, snmp_get_request_id(request));
+	  snmp_set_error(response, 2), snmp_set_error_index(response, i + 1);
+
+	  for(int j = 0; snmp_get_varbind_as_string(request, j, &oid, &type, NULL); j++)
+	    snmp_add_varbind_null(response, oid);
+
+	  end_of_mib = true;
+	  break;
+	}
+
+	snmp_add_varbind_integer_type(response, (char*)names[i].c_str(), NTOP_SNMP_ENDOFMIBVIEW, 0);
+	end_of_mib = true;
+	break;
+      }
+
+      addMIBVarbind(response, &next->second, now);
+      oids[i] = next->first, names[i] = next->second.oid;
+    }
+
+    if(r == 0) {
+      /* Non repeaters are answered once */
+      oids.erase(oids.begin(), oids.begin() + non_repeaters);
+      names.erase(names.begin(), names.begin() + non_repeaters);
+      non_repeaters = 0;
+
+      if(oids.empty()) break;
+    }
+  }
+
+  if((len = snmp_message_length(response)) <= buf_len)
+    snmp_render_message(response, buf);
+  else
+    len = 0; /* A real agent would return tooBig */
+
+  snmp_destroy_message(response), free(response);
+  snmp_destroy_message(request), free(request);
+
+  return(len);
+}
+
+/* ******************************************* */
+
+static void* benchAgentsFctn(void *ptr) {
+  BenchAgents *a = (BenchAgents*)ptr;
+  std::vector<struct pollfd> pfds(a->num_agents);
+  std::deque<BenchPendingResponse> pending; /* Constant latency: ordered by due time */
+  u_char req[SNMP_POLLER_MAX_PDU_LEN], buf[SNMP_POLLER_MAX_PDU_LEN];
+
+  Utils::setThreadName("bench-agents");
+
+  for(u_int i = 0; i < a->num_agents; i++)
+    pfds[i].fd = a->socks[i], pfds[i].events = POLLIN;
+
+  while(!a->stop) {
+    struct timeval now;
+    int timeout = 100;
+
+    gettimeofday(&now, NULL);
+
+    while(!pending.empty() && (Utils::msTimevalDiff(&now, &pending.front().due) >= 0)) {
+      BenchPendingResponse *p = &pending.front();
+
+      sendto(p->sock, p->pdu.data(), p->pdu.size(), 0, (struct sockaddr*)&p->to, sizeof(p->to));
+      a->num_responses++, a->num_queued--;
+      pending.pop_front();
+    }
+
+    if(!pending.empty())
+      timeout = max_val(1, (int)-Utils::msTimevalDiff(&now, &pending.front().due));
+
+    if(poll(&pfds[0], pfds.size(), timeout) <= 0)
+      continue;
+
+    gettimeofday(&now, NULL);
+
+    for(u_int i = 0; i < pfds.size(); i++) {
+      if(!(pfds[i].revents & POLLIN))
+	continue;
+
+      for(int j = 0; j < 64; j++) {
+	struct sockaddr_in from;
+	socklen_t from_len = sizeof(from);
+	int len;
+
+	if((len = recvfrom(pfds[i].fd, req, sizeof(req), 0, (struct sockaddr*)&from, &from_len)) <= 0)
+	  break;
+
+	a->num_requests++;
+
+	if((len = buildResponse(a, req, len, buf, sizeof(buf))) == 0)
+	  continue;
+
+	if(a->latency_msec == 0) {
+	  sendto(pfds[i].fd, buf, len, 0, (struct sockaddr*)&from, sizeof(from));
+	  a->num_responses++;
+	} else {
+	  BenchPendingResponse p;
+
+	  p.due = now;
+	  p.due.tv_sec += a->latency_msec / 1000, p.due.tv_usec += (a->latency_msec % 1000) * 1000;
+	  if(p.due.tv_usec >= 1000000) p.due.tv_sec++, p.due.tv_usec -= 1000000;
+
+	  p.sock = pfds[i].fd, p.to = from, p.pdu.assign((char*)buf, len);
+	  pending.push_back(p);
+	  a->num_queued++;
+	}
+      }
+    }
+  }
+
+  return(NULL);
+}
+
+/* ******************************************* */
+
+static bool startAgents(BenchAgents *a, u_int num_interfaces) {
+  buildMIB(&a->mib, num_interfaces);
+
+  for(u_int i = 0; i < a->num_agents; i++) {
+    struct sockaddr_in addr;
+    int sock;
+
+    if((sock = Utils::openSocket(AF_INET, SOCK_DGRAM, 0, "SNMP bench agent")) < 0)
+      return(false);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET, addr.sin_port = htons(a->base_port + i);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to bind 127.0.0.1:%u: %s",
+				   a->base_port + i, strerror(errno));
+      Utils::closeSocket(sock);
+      return(false);
+    }
+
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    a->socks.push_back(sock);
+  }
+
+  a->stop = false;
+  return(pthread_create(&a->thread, NULL, benchAgentsFctn, (void*)a) == 0);
+}
+
+/* ******************************************* */
+
+static u_int64_t getStat(lua_State *vm, const char *key) {
+  u_int64_t v;
+
+  lua_getfield(vm, -1, key);
+  v = (u_int64_t)lua_tointeger(vm, -1);
+  lua_pop(vm, 1);
+
+  return(v);
+}
+
+/* ******************************************* */
+
+static void sampleInflight(SNMPPoller *poller, BenchAgents *agents, lua_State *vm, BenchInflight *s) {
+  u_int64_t polling, inflight, queued;
+
+  poller->lua(vm);
+  polling = getStat(vm, "num_polling"), inflight = getStat(vm, "num_inflight");
+  lua_settop(vm, 0);
+
+  queued = agents ? agents->num_queued.load() : 0;
+
+  s->num_samples++;
+  s->polling_sum += polling, s->polling_max = max_val(s->polling_max, polling);
+  s->inflight_sum += inflight, s->inflight_max = max_val(s->inflight_max, inflight);
+  s->queued_sum += queued, s->queued_max = max_val(s->queued_max, queued);
+}
+
+/* ******************************************* */
+
+static void setDevices(SNMPPoller *poller, u_int num_agents, u_int16_t base_port, const char *community,
+		       u_int8_t version, u_int32_t interval, u_int32_t max_rps) {
+  for(u_int i = 0; i < num_agents; i++) {
+    char agent[32];
+
+    snprintf(agent, sizeof(agent), "127.0.0.1:%u", base_port + i);
+
+    if(!poller->setDevice(agent, community, version, interval, max_rps))
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to set device %s", agent);
+  }
+}
+
+/* ******************************************* */
+
+/* Average and max duration of the last walk of every device */
+static void walkDurations(SNMPPoller *poller, lua_State *vm, double *avg_ms, u_int64_t *max_ms,
+			  u_int64_t *num_interfaces) {
+  u_int64_t sum = 0, n = 0;
+
+  *max_ms = 0, *num_interfaces = 0;
+  poller->luaDeltas(vm, NULL, 0);
+
+  lua_pushnil(vm);
+  while(lua_next(vm, -2) != 0) {
+    u_int64_t ms = getStat(vm, "poll_duration_ms");
+
+    sum += ms, n++, *max_ms = max_val(*max_ms, ms);
+
+    lua_getfield(vm, -1, "interfaces");
+    *num_interfaces += lua_rawlen(vm, -1);
+    lua_pop(vm, 2);
+  }
+
+  lua_settop(vm, 0);
+  *avg_ms = n ? (double)sum / n : 0;
+}
+
+/* ******************************************* */
+
+int main(int argc, char *argv[]) {
+  u_int num_agents = 100, num_interfaces = 48, duration = 10;
+  u_int32_t interval = 1, max_rps = SNMP_POLLER_DEFAULT_MAX_RPS;
+  u_int16_t base_port = 16100;
+  u_int8_t version = 1;
+  const char *community = "public", *out_path = NULL;
+  bool external = false;
+  BenchAgents *agents = NULL;
+  BenchInflight inflight;
+  SNMPPoller *poller;
+  lua_State *vm;
+  json_object *report, *j;
+  u_int64_t polls_begin, failed_begin, requests_begin, polls, failed, requests;
+  u_int64_t timeouts, retries, unexpected, max_walk_ms, walked_interfaces;
+  struct timeval begin, end, last_refresh;
+  struct rusage ru;
+  double secs, avg_walk_ms;
+  u_int32_t latency_msec = 0;
+  int c;
+
+  while((c = getopt(argc, argv, "n:i:p:ec:v:t:r:l:d:o:h")) != -1) {
+    switch(c) {
+    case 'n':
+      num_agents = max_val(1, atoi(optarg));
+      break;
+    case 'i':
+      num_interfaces = max_val(1, atoi(optarg));
+      break;
+    case 'p':
+      base_port = (u_int16_t)atoi(optarg);
+      break;
+    case 'e':
+      external = true;
+      break;
+    case 'c':
+      community = optarg;
+      break;
+    case 'v':
+      version = (u_int8_t)atoi(optarg);
+      break;
+    case 't':
+      interval = max_val(1, atoi(optarg));
+      break;
+    case 'r':
+      max_rps = max_val(1, atoi(optarg));
+      break;
+    case 'l':
+      latency_msec = max_val(0, atoi(optarg));
+      break;
+    case 'd':
+      duration = max_val(1, atoi(optarg));
+      break;
+    case 'o':
+      out_path = optarg;
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if((version > 1) || ((u_int32_t)base_port + num_agents > 65536)) usage();
+
+  if((ntop = new(std::nothrow) Ntop(argv[0])) == NULL) _exit(EXIT_FAILURE);
+
+  if(!external) {
+    if((agents = new (std::nothrow) BenchAgents) == NULL) _exit(EXIT_FAILURE);
+
+    agents->num_agents = num_agents, agents->base_port = base_port;
+    agents->latency_msec = latency_msec, agents->community = community;
+    agents->num_queued = 0, agents->num_requests = 0, agents->num_responses = 0;
+
+    if(!startAgents(agents, num_interfaces)) _exit(EXIT_FAILURE);
+  }
+
+  try {
+    poller = new SNMPPoller();
+  } catch(...) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to create the SNMP poller");
+    _exit(EXIT_FAILURE);
+  }
+
+  if((vm = luaL_newstate()) == NULL) _exit(EXIT_FAILURE);
+
+  setDevices(poller, num_agents, base_port, community, version, interval, max_rps);
+  if(!poller->start()) _exit(EXIT_FAILURE);
+
+  /* Warm-up: the first walk of every device only sets the baseline counters */
+  for(u_int i = 0; i < 10 * (interval + 2 + SNMP_POLLER_TIMEOUT_MSEC / 1000); i++) {
+    poller->lua(vm);
+    polls = getStat(vm, "num_polls"), failed = getStat(vm, "num_failed_polls");
+    lua_settop(vm, 0);
+
+    if(polls + failed >= num_agents) break;
+    _usleep(100000);
+  }
+
+  memset(&inflight, 0, sizeof(inflight));
+
+  poller->lua(vm);
+  polls_begin = getStat(vm, "num_polls"), failed_begin = getStat(vm, "num_failed_polls");
+  requests_begin = getStat(vm, "num_requests");
+  lua_settop(vm, 0);
+
+  gettimeofday(&begin, NULL);
+  last_refresh = begin;
+
+  while(true) {
+    gettimeofday(&end, NULL);
+
+    if(Utils::msTimevalDiff(&end, &begin) >= duration * 1000.)
+      break;
+
+    if(end.tv_sec - last_refresh.tv_sec >= SNMP_BENCH_HEARTBEAT) {
+      setDevices(poller, num_agents, base_port, community, version, interval, max_rps);
+      last_refresh = end;
+    }
+
+    sampleInflight(poller, agents, vm, &inflight);
+    _usleep(SNMP_BENCH_SAMPLE_MSEC * 1000);
+  }
+
+  secs = Utils::msTimevalDiff(&end, &begin) / 1000.;
+
+  poller->lua(vm);
+  polls = getStat(vm, "num_polls") - polls_begin;
+  failed = getStat(vm, "num_failed_polls") - failed_begin;
+  requests = getStat(vm, "num_requests") - requests_begin;
+  timeouts = getStat(vm, "num_timeouts"), retries = getStat(vm, "num_retries");
+  unexpected = getStat(vm, "num_unexpected_responses");
+  lua_settop(vm, 0);
+
+  walkDurations(poller, vm, &avg_walk_ms, &max_walk_ms, &walked_interfaces);
+  getrusage(RUSAGE_SELF, &ru);
+
+  report = json_object_new_object();
+  json_object_object_add(report, "version", json_object_new_string(PACKAGE_VERSION));
+  json_object_object_add(report, "agents", json_object_new_int(num_agents));
+  json_object_object_add(report, "external_agents", json_object_new_boolean(external));
+  json_object_object_add(report, "interfaces", json_object_new_int(external ? 0 : num_interfaces));
+  json_object_object_add(report, "snmp_version", json_object_new_string(version ? "v2c" : "v1"));
+  json_object_object_add(report, "poll_interval_sec", json_object_new_int(interval));
+  json_object_object_add(report, "max_requests_per_sec", json_object_new_int(max_rps));
+  json_object_object_add(report, "agent_latency_ms", json_object_new_int(external ? 0 : latency_msec));
+  json_object_object_add(report, "duration_sec", json_object_new_double(secs));
+  json_object_object_add(report, "walks", json_object_new_int64(polls));
+  json_object_object_add(report, "walks_per_sec", json_object_new_double(polls / secs));
+  json_object_object_add(report, "offered_walks_per_sec", json_object_new_double((double)num_agents / interval));
+  json_object_object_add(report, "failed_walks", json_object_new_int64(failed));
+  json_object_object_add(report, "requests_per_sec", json_object_new_double(requests / secs));
+  json_object_object_add(report, "timeouts", json_object_new_int64(timeouts));
+  json_object_object_add(report, "retries", json_object_new_int64(retries));
+  json_object_object_add(report, "unexpected_responses", json_object_new_int64(unexpected));
+  json_object_object_add(report, "last_walk_avg_ms", json_object_new_double(avg_walk_ms));
+  json_object_object_add(report, "last_walk_max_ms", json_object_new_int64(max_walk_ms));
+  json_object_object_add(report, "walked_interfaces", json_object_new_int64(walked_interfaces));
+
+  j = json_object_new_object();
+  json_object_object_add(j, "samples", json_object_new_int64(inflight.num_samples));
+  json_object_object_add(j, "walks_avg",
+			 json_object_new_double(inflight.num_samples ? (double)inflight.polling_sum / inflight.num_samples : 0));
+  json_object_object_add(j, "walks_max", json_object_new_int64(inflight.polling_max));
+  json_object_object_add(j, "requests_avg",
+			 json_object_new_double(inflight.num_samples ? (double)inflight.inflight_sum / inflight.num_samples : 0));
+  json_object_object_add(j, "requests_max", json_object_new_int64(inflight.inflight_max));
+
+  if(agents) {
+    json_object_object_add(j, "agent_queued_avg",
+			   json_object_new_double(inflight.num_samples ? (double)inflight.queued_sum / inflight.num_samples : 0));
+    json_object_object_add(j, "agent_queued_max", json_object_new_int64(inflight.queued_max));
+  }
+
+  json_object_object_add(report, "inflight", j);
+  json_object_object_add(report, "peak_rss_kb", json_object_new_int64(ru.ru_maxrss));
+
+  if(out_path) {
+    FILE *fd = fopen(out_path, "w");
+
+    if(fd == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to write %s: %s", out_path, strerror(errno));
+      _exit(EXIT_FAILURE);
+    }
+
+    fprintf(fd, "%s\n", json_object_to_json_string(report));
+    fclose(fd);
+  } else {
+    /* _exit() below does not flush stdio */
+    printf("%s\n", json_object_to_json_string(report));
+    fflush(stdout);
+  }
+
+  json_object_put(report);
+  lua_close(vm);
+
+  /* Stops the poller thread (joined by the destructor) and the agents */
+  ntop->getGlobals()->requestShutdown();
+  delete poller;
+
+  if(agents) {
+    agents->stop = true;
+    pthread_join(agents->thread, NULL);
+  }
+
+  _exit(EXIT_SUCCESS);
+}
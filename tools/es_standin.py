@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#
+# (C) 2022 - ntop.org
+#
+# Minimal Elasticsearch stand-in to exercise the ntopng ES flow export
+# (bulk concurrency, gzip bodies, adaptive bulk sizing) without a real cluster.
+#
+# It answers the version query and the template upload, and accepts _bulk
+# requests (optionally gzip-encoded), sleeping to simulate a slow node.
+#
+# Usage:
+#   es_standin.py [--port 9200] [--version 7.17.0] [--delay-ms 0] [--jitter-ms 0]
+#                 [--slow-every N --slow-delay-ms M] [--fail-every N]
+#
+# Run ntopng with:
+#   -F "es;ntopng;ntopng-%Y.%m.%d;http://localhost:9200/_bulk;"
+# and enable gzip bodies with:
+#   redis-cli set ntopng.prefs.es_gzip_requests 1
+#
+# Every 10 seconds the stand-in prints the bulks/flows received, the average
+# bulk size and the number of concurrent requests seen.
+#
+
+import argparse
+import gzip
+import json
+import random
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+lock = threading.Lock()
+stats = {'bulks': 0, 'docs': 0, 'bytes': 0, 'gzip': 0, 'inflight': 0, 'max_inflight': 0, 'failed': 0}
+
+
+class ESHandler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'  # Keep-alive, as ntopng reuses connections
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def reply(self, code, data):
+        body = json.dumps(data).encode()
+        self.send_response(code)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def read_body(self):
+        body = self.rfile.read(int(self.headers.get('Content-Length', 0)))
+        if self.headers.get('Content-Encoding') == 'gzip':
+            with lock:
+                stats['gzip'] += 1
+            body = gzip.decompress(body)
+        return body
+
+    def do_GET(self):
+        self.reply(200, {'name': 'es-standin', 'cluster_name': 'ntop',
+                         'version': {'number': args.version}, 'tagline': 'You Know, for Search'})
+
+    def do_PUT(self):
+        self.read_body()
+        self.reply(200, {'acknowledged': True})
+
+    def do_POST(self):
+        if not self.path.endswith('_bulk'):
+            self.do_PUT()
+            return
+
+        body = self.read_body()
+        docs = body.count(b'\n') // 2
+
+        with lock:
+            stats['inflight'] += 1
+            stats['max_inflight'] = max(stats['max_inflight'], stats['inflight'])
+            seq = stats['bulks'] + stats['failed'] + 1
+
+        delay = args.delay_ms + random.uniform(0, args.jitter_ms)
+        if args.slow_every and seq % args.slow_every == 0:
+            delay += args.slow_delay_ms
+        time.sleep(delay / 1000.)
+
+        failed = args.fail_every and seq % args.fail_every == 0
+
+        with lock:
+            stats['inflight'] -= 1
+            if failed:
+                stats['failed'] += 1
+            else:
+                stats['bulks'] += 1
+                stats['docs'] += docs
+                stats['bytes'] += len(body)
+
+        if failed:
+            self.reply(503, {'error': 'simulated failure'})
+        else:
+            self.reply(200, {'took': int(delay), 'errors': False, 'items': []})
+
+
+def report():
+    while True:
+        time.sleep(10)
+        with lock:
+            s = dict(stats)
+            stats['max_inflight'] = stats['inflight']
+        avg = s['bytes'] // s['bulks'] if s['bulks'] else 0
+        print('bulks=%d docs=%d failed=%d gzip=%d avg_bulk_bytes=%d max_inflight=%d' %
+              (s['bulks'], s['docs'], s['failed'], s['gzip'], avg, s['max_inflight']), flush=True)
+
+
+if __name__ == '__main__':
+    p = argparse.ArgumentParser(description='Elasticsearch stand-in for ntopng flow export tests')
+    p.add_argument('--port', type=int, default=9200)
+    p.add_argument('--version', default='7.17.0')
+    p.add_argument('--delay-ms', type=float, default=0, help='Base latency of every bulk')
+    p.add_argument('--jitter-ms', type=float, default=0, help='Random latency added to every bulk')
+    p.add_argument('--slow-every', type=int, default=0, help='Make one bulk out of N slow')
+    p.add_argument('--slow-delay-ms', type=float, default=2000, help='Extra latency of slow bulks')
+    p.add_argument('--fail-every', type=int, default=0, help='Fail one bulk out of N with HTTP 503')
+    args = p.parse_args()
+
+    threading.Thread(target=report, daemon=True).start()
+    ThreadingHTTPServer(('', args.port), ESHandler).serve_forever()